@@ -0,0 +1,83 @@
+#! /bin/bash
+#
+# Copyright (c) 2020-2022 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Generates a controlled access model of random weights of the given size for the cold start
+# benchmark of the custom loader, ovsa_load_bench. The keystores, the runtime TCB and the license
+# configuration of one of the access_control_*_model.sh samples are reused.
+#
+# Usage: access_control_synthetic_model.sh <weights size in MB> [decrypt segments: binary]
+
+if [[ -z $1 ]]; then
+	echo "Usage: $0 <weights size in MB> [binary]"
+	exit 1
+fi
+SIZE_MB=$1
+if [[ $2 == "binary" ]]; then
+	BINARY_FORMAT="-b"
+fi
+
+FOLDER_NAME=kvm
+export KEYSTORE_PATH="/opt/ovsa/$FOLDER_NAME/keystore"
+export ARTEFACTS_PATH="/opt/ovsa/$FOLDER_NAME/artefacts"
+if [[ -z $OVSA_SAMPLE_ARTEFACTS ]]; then
+export OVSA_SAMPLE_ARTEFACTS="$ARTEFACTS_PATH/fd"
+fi
+export OVSA_DEV_ARTEFACTS="$ARTEFACTS_PATH/synthetic_${SIZE_MB}mb"
+
+for artefact in $KEYSTORE_PATH/isv_keystore $KEYSTORE_PATH/custkeystore \
+		$OVSA_SAMPLE_ARTEFACTS/face_detect_runtime.tcb $OVSA_SAMPLE_ARTEFACTS/30daylicense.config; do
+	if [ ! -f $artefact ]; then
+		echo "$artefact not found, please run access_control_face_detection_model.sh first"
+		exit 1
+	fi
+done
+
+set -x
+mkdir -p $OVSA_DEV_ARTEFACTS/1
+cd /opt/ovsa/$FOLDER_NAME/bin
+
+# Synthetic IR, the weights are random so that they do not compress
+cat << EOF2 > $OVSA_DEV_ARTEFACTS/synthetic.xml
+<?xml version="1.0" ?>
+<net name="synthetic" version="10">
+	<layers/>
+	<edges/>
+</net>
+EOF2
+head -c ${SIZE_MB}M /dev/urandom > $OVSA_DEV_ARTEFACTS/synthetic.bin
+
+uuid=$(uuidgen)
+./ovsatool controlAccess -i $OVSA_DEV_ARTEFACTS/synthetic.xml $OVSA_DEV_ARTEFACTS/synthetic.bin \
+			-n "synthetic" -d "synthetic ${SIZE_MB} MB model" -v 0001 $BINARY_FORMAT \
+			-p $OVSA_DEV_ARTEFACTS/synthetic_model.dat -m $OVSA_DEV_ARTEFACTS/synthetic_model.masterlic \
+			-k $KEYSTORE_PATH/isv_keystore -g $uuid
+./ovsatool sale -m $OVSA_DEV_ARTEFACTS/synthetic_model.masterlic -k $KEYSTORE_PATH/isv_keystore \
+		-l $OVSA_SAMPLE_ARTEFACTS/30daylicense.config -t $OVSA_SAMPLE_ARTEFACTS/face_detect_runtime.tcb \
+		-p $ARTEFACTS_PATH/primary_custkeystore.csr.crt -c $OVSA_DEV_ARTEFACTS/synthetic_model.lic
+cp $OVSA_DEV_ARTEFACTS/synthetic_model.lic $OVSA_DEV_ARTEFACTS/1/synthetic_model.lic
+cp $OVSA_DEV_ARTEFACTS/synthetic_model.dat $OVSA_DEV_ARTEFACTS/1/synthetic_model.dat
+rm -f $OVSA_DEV_ARTEFACTS/synthetic.bin
+set +x
+
+echo ""
+echo "-------------------------------------------------------------------------------------------------"
+echo "The customer license has to be added to the License Server DB as for the sample model:"
+echo "1) $OVSA_DEV_ARTEFACTS/synthetic_model.lic"
+echo "2) $ARTEFACTS_PATH/secondary_custkeystore.csr.crt"
+echo ""
+echo "Cold start benchmark of the model:"
+echo "ovsa_load_bench -b $OVSA_DEV_ARTEFACTS -k $KEYSTORE_PATH/custkeystore -f synthetic_model -e"
+echo "-------------------------------------------------------------------------------------------------"
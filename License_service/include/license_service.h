@@ -35,8 +35,59 @@
 #define MAX_FILE_NAME_LEN       10
 
 #define mbedtls_printf      printf
+/* Bytes per log record of ovsa_license_service_hexdump_mem() */
+#define HEXDUMP_LINE_SIZE   32
 #define READ_TIMEOUT_MS     300000 /* 30 seconds */
+/* Initial size of the buffers a client connection sends and receives messages in */
+#define LICENSE_SERVICE_MSG_BUF_SIZE 4096
+/* Largest message the length prefix of PAYLOAD_LENGTH digits can announce */
+#define LICENSE_SERVICE_MAX_MSG_SIZE 99999999
+/*
+ * Binary framing of the license check messages, offered by the license server in its nonce
+ * message and used by both sides from the reply of the runtime on. In place of the JSON message
+ * blob, a message is OVSA_TLV_MAGIC followed by a command and a payload record, each a type byte,
+ * a 4 byte big endian length and the value. When the nonce message also offers the "trace"
+ * element, the payload may be followed by a record carrying the correlation ID of the tracing
+ * spans of the license check.
+ */
+#define OVSA_FRAMING_TLV            "tlv"
+#define OVSA_FRAMING_TRACE          "cid"
+#define OVSA_TLV_MAGIC              0x01
+#define OVSA_TLV_TYPE_COMMAND       0x01
+#define OVSA_TLV_TYPE_PAYLOAD       0x02
+#define OVSA_TLV_TYPE_TRACE_ID      0x03
+#define OVSA_TLV_RECORD_HEADER_SIZE 5
 #define MBEDTLS_DEBUG_LEVEL 0
+/* Lifetime of TLS session tickets, must cover the license check interval of the runtime */
+#define SESSION_TICKET_LIFETIME 172800 /* 48 hours */
+
+/* Customer licenses checked with a single platform attestation in one connection */
+#define MAX_LICENSE_BATCH_SIZE 64
+
+/* Connection handling: epoll acceptor feeding a fixed pool of worker threads */
+#define DEFAULT_ACCEPT_QUEUE_SIZE 1024
+#define MAX_ACCEPT_QUEUE_SIZE     65536
+#define MAX_WORKER_THREADS        256
+#define EPOLL_MAX_EVENTS          16
+#define STATS_INTERVAL_MS         60000 /* 60 seconds */
+#define ACCEPT_BACKOFF_MS         100   /* Pause of the acceptor when out of descriptors */
+/* Optional overrides, default is one worker per online core */
+#define WORKER_THREADS_ENV    "OVSA_LICENSE_SERVICE_WORKERS"
+#define ACCEPT_QUEUE_SIZE_ENV "OVSA_LICENSE_SERVICE_QUEUE_SIZE"
+
+/* Validity in seconds of the attestation tokens issued after a TPM quote verification */
+#define ATTESTATION_TOKEN_VALIDITY_ENV "OVSA_ATTESTATION_TOKEN_VALIDITY"
+#define MAX_ATTESTATION_TOKEN_VALIDITY 86400 /* 24 hours */
+/* Validity in seconds of the leases issued with a passed license check */
+#define LICENSE_LEASE_VALIDITY_ENV     "OVSA_LICENSE_LEASE_VALIDITY"
+#define MAX_LICENSE_LEASE_VALIDITY     604800 /* 7 days */
+/* Port of the Prometheus /metrics listener, not started unless set */
+#define METRICS_PORT_ENV     "OVSA_LICENSE_SERVICE_METRICS_PORT"
+#define METRICS_ADDR_ENV     "OVSA_LICENSE_SERVICE_METRICS_ADDR"
+#define DEFAULT_METRICS_ADDR "127.0.0.1"
+#define MAX_METRICS_PORT     65535
+/* URL of the rqlite store shared by the nodes of a cluster, OVSA_DB_PATH is used unless set */
+#define DB_URL_ENV "OVSA_LICENSE_SERVICE_DB_URL"
 
 /* ! Size of the HASH key Considering SHA512 for HASHING */
 #define HASH_B64_SIZE            192 /* Actual 130: Considering the length for B64 */
@@ -75,22 +126,12 @@
 #define CURVE_LIST_SIZE   2
 #define CIPHER_SUITE_SIZE 1
 
-#define TPM2_SWQUOTE_MSG        "SW_pcr_quote.plain"
-#define TPM2_AK_HWPUB_PEM_KEY   "HW_pub_key.pub"
-#define TPM2_HWQUOTE_SIG        "HW_pcr_quote.signature"
-#define TPM2_HWQUOTE_MSG        "HW_pcr_quote.plain"
-#define TPM2_HWQUOTE_PCR        "HW_pcr.bin"
-#define TPM2_CREDOUT_FILE       "cred.out"
-#define TPM2_SWQUOTE_PCR        "SW_pcr.bin"
-#define TPM2_SWQUOTE_SIG        "SW_pcr_quote.signature"
-#define TPM2_AK_PUB_PEM_KEY     "SW_pub_key.pub"
-#define TPM2_EK_PUB_KEY         "tpm_ek.pub"
-#define TPM2_SWQUOTE_EK_CERT    "tpm_ek_cert.bin"
-#define TPM2_AK_NAME_HEX        "tpm_ak.name.hex"
-#define QUOTE_NONCE             "server_quote_nonce.bin"
-#define SECRET_NONCE            "secret.bin"
-#define TPM2_HWQUOTE_NONCE_FILE "hw_quote_nonce.bin"
-#define TPM2_SWQUOTE_NONCE_FILE "sw_quote_nonce.bin"
+/* Credential blob as written by tpm2_makecredential and read by tpm2_activatecredential */
+#define TPM2_CREDENTIAL_MAGIC       0xBADCC0DE
+#define TPM2_CREDENTIAL_VERSION     1
+#define TPM2_CREDENTIAL_SECRET_SIZE 16
+#define TPM2_CREDENTIAL_BLOB_SIZE                                                   \
+    (2 * sizeof(UINT32) + sizeof(TPM2B_ID_OBJECT) + sizeof(TPM2B_ENCRYPTED_SECRET))
 
 #ifdef ENABLE_SGX_GRAMINE
 #define SGX_ENCLAVE_HASH_SIZE 65
@@ -110,24 +151,18 @@
 #define DBG_LEVEL (DBG_E)
 #endif
 
-#define OVSA_DBG(class, fmt...)  \
-    do {                         \
-        if ((class) & DBG_LEVEL) \
-            printf(fmt);         \
-    } while (0)
+/* Log level set at startup, records past the level the service is built with are compiled out */
+#define LOG_LEVEL_ENV "OVSA_LICENSE_SERVICE_LOG_LEVEL"
+extern int g_ovsa_log_level;
 
-#define CREATE_TMP_DIR_PATH(tmp_dir_path, client_fd)                                      \
-    char fdbuf[5];                                                                        \
-    snprintf(fdbuf, 5, "%d", client_fd);                                                  \
-    memset_s(tmp_dir_path, sizeof(tmp_dir_path), 0);                                      \
-    strcpy_s(tmp_dir_path, sizeof("/opt/ovsa/tmp_dir/ovsa_"), "/opt/ovsa/tmp_dir/ovsa_"); \
-    strcat_s(tmp_dir_path, MAX_FILE_LEN, fdbuf);                                          \
-    strcat_s(tmp_dir_path, MAX_FILE_LEN, "/");
+void ovsa_license_service_log(int level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
 
-#define CREATE_FILE_PATH(tmp_dir_path, key_file, TPM2_QUOTE_INFO)     \
-    memset_s(key_file, sizeof(key_file), 0);                          \
-    memcpy_s(key_file, MAX_FILE_LEN, tmp_dir_path, sizeof(key_file)); \
-    strcat_s(key_file, MAX_FILE_LEN, TPM2_QUOTE_INFO);
+#define OVSA_DBG(class, fmt...)                                    \
+    do {                                                           \
+        if (((class) & DBG_LEVEL) && ((class) & g_ovsa_log_level)) \
+            ovsa_license_service_log((class), fmt);                \
+    } while (0)
 
 #ifdef ENABLE_SGX_GRAMINE
 typedef int (*sgx_measurements_cb_t)(const char* mrenclave, const char* mrsigner,
@@ -163,6 +198,30 @@ typedef struct {
     TPML_DIGEST pcr_values[TPM2_MAX_PCRS];
 } tpm2_pcrs;
 
+/* Challenges sent to the client of a connection, checked against its quote info */
+typedef struct ovsa_tpm2_challenge {
+    char secret[TPM2_CREDENTIAL_SECRET_SIZE * 2 + 1];
+    char quote_nonce[NONCE_BUF_SIZE];
+    size_t quote_nonce_len;
+    char ak_name[MAX_NAME_SIZE];
+    bool token_requested;   /* client asked for an attestation token after the quote */
+    bool attested_by_token; /* platform attested by a token in place of a quote */
+} ovsa_tpm2_challenge_t;
+
+/* Digest of one selected PCR of a quote */
+typedef struct ovsa_tpm2_pcr_digest {
+    TPMI_ALG_HASH hash;
+    uint32_t pcr_id;
+    TPM2B_DIGEST digest;
+} ovsa_tpm2_pcr_digest_t;
+
+/* PCR data of a quote, with the digests in selection order */
+typedef struct ovsa_tpm2_pcr_digests {
+    TPML_PCR_SELECTION pcr_select;
+    size_t count;
+    ovsa_tpm2_pcr_digest_t* digests;
+} ovsa_tpm2_pcr_digests_t;
+
 typedef enum {
     OVSA_SEND_NONCE = 0,
     OVSA_SEND_EK_AK_BIND,
@@ -174,6 +233,10 @@ typedef enum {
     OVSA_SEND_UPDATE_CUST_LICENSE,
     OVSA_SEND_UPDATE_CUST_LICENSE_ACK,
     OVSA_SEND_LICENSE_CHECK_RESP,
+    OVSA_SEND_CUST_LICENSE_BATCH,
+    OVSA_SEND_LICENSE_CHECK_BATCH_RESP,
+    OVSA_SEND_ATTESTATION_TOKEN,
+    OVSA_SEND_LICENSE_LEASE,
     OVSA_INVALID_CMD
 } ovsa_command_type_t;
 
@@ -254,7 +317,24 @@ typedef enum {
     OVSA_PLATFORM_CERT_VALIDATION_FAILED = -59,
     OVSA_PCR_DIGEST_NOT_VALID            = -60,
     OVSA_TCB_NOT_VALID                   = -61,
-    OVSA_FAIL                            = -99
+
+    /* Connection handling */
+    OVSA_EPOLL_FAIL         = -62,
+    OVSA_THREAD_CREATE_FAIL = -63,
+    OVSA_ACCEPT_QUEUE_FULL  = -64,
+
+    /* TLS session resumption */
+    OVSA_MBEDTLS_SSL_TICKET_SETUP_FAILED = -65,
+
+    /* In-process TPM2 validation */
+    OVSA_TPM2_MARSHAL_FAIL        = -66,
+    OVSA_TPM2_QUOTE_VERIFY_FAILED = -67,
+
+    /* Attestation tokens */
+    OVSA_ATTESTATION_TOKEN_INVALID = -68,
+    OVSA_ATTESTATION_TOKEN_EXPIRED = -69,
+
+    OVSA_FAIL = -99
 } ovsa_status_t;
 
 typedef char GUID[GUID_SIZE + 1];
@@ -473,6 +553,66 @@ ovsa_status_t ovsa_license_service_crypto_compute_hash(const char* in_buff, int
 ovsa_status_t ovsa_license_service_crypto_convert_bin_to_base64(const char* in_buff,
                                                                 size_t in_buff_len,
                                                                 char** out_buff);
+
+/** \brief This function decodes the base64 PCR data generated by tpm2_quote into one digest
+ *         per selected PCR.
+ *
+ * \param[in]  quote_pcr    Base64 PCR data of the quote.
+ * \param[out] pcr_digests  Decoded PCR selection and digests, to be freed with
+ *                          ovsa_license_service_tpm2_free_pcr_digests().
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_license_service_tpm2_decode_pcr_digests(const char* quote_pcr,
+                                                           ovsa_tpm2_pcr_digests_t* pcr_digests);
+
+/** \brief This function frees the digests of decoded PCR data.
+ *
+ * \param[in]  pcr_digests  Decoded PCR data.
+ */
+void ovsa_license_service_tpm2_free_pcr_digests(ovsa_tpm2_pcr_digests_t* pcr_digests);
+
+/** \brief This function compares the quoted PCRs of the pcr_id_set with the golden values.
+ *
+ * \param[in]  pcr_digests     Decoded PCR data of the quote.
+ * \param[in]  golden_digests  Decoded PCR data of the golden quote.
+ * \param[in]  pcr_id_set      Bitmap of the PCR IDs to be compared.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_license_service_tpm2_compare_pcr_digests(
+    const ovsa_tpm2_pcr_digests_t* pcr_digests, const ovsa_tpm2_pcr_digests_t* golden_digests,
+    uint32_t pcr_id_set);
+
+/** \brief This function verifies the quote signature with the AK public key, the quote
+ *         qualification and the PCR digest of the quote.
+ *
+ * \param[in]  quote_info         Quote message, signature, PCRs and AK public key.
+ * \param[in]  qualification      Nonce the quote is expected to be qualified with.
+ * \param[in]  qualification_len  Length of the nonce.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_license_service_tpm2_checkquote(const ovsa_quote_info_t* quote_info,
+                                                   const char* qualification,
+                                                   size_t qualification_len);
+
+/** \brief This function protects the secret to the EK and AK name of the client, in the
+ *         format tpm2_activatecredential reads.
+ *
+ * \param[in]  ek_pub_key     EK public key in PEM format.
+ * \param[in]  ak_name_hex    AK name in hex.
+ * \param[in]  secret         Secret to be protected.
+ * \param[in]  secret_len     Length of the secret.
+ * \param[out] cred_blob      Credential blob.
+ * \param[out] cred_blob_len  Length of the credential blob.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_license_service_tpm2_makecredential(const char* ek_pub_key,
+                                                       const char* ak_name_hex,
+                                                       const char* secret, size_t secret_len,
+                                                       char** cred_blob, size_t* cred_blob_len);
 #ifdef ENABLE_SGX_GRAMINE
 int ra_tls_verify_callback(void* data, mbedtls_x509_crt* crt, int depth, uint32_t* flags);
 void ra_tls_set_measurement_callback(int (*f_cb)(const char* mrenclave, const char* mrsigner,
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "json.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+/* attestation_token.h to be included at end due to dependencies */
+#include "attestation_token.h"
+
+/*
+ * A token is the base64 encoded JSON claims followed by '.' and the hex HMAC-SHA256 of the
+ * encoded claims. The key lives only in the memory of the License Service, the tokens of a
+ * License Service are refused by the others and after a restart, the runtime falls back to a
+ * full attestation then. A token alone does not attest the platform, the client presenting it
+ * has to quote its PCRs with the AK of the token over a fresh nonce of the license check.
+ */
+static unsigned char g_token_key[ATTESTATION_TOKEN_KEY_SIZE];
+static size_t g_token_validity;
+
+ovsa_status_t ovsa_license_service_attestation_token_init(size_t validity) {
+    g_token_validity = 0;
+    if (validity == 0)
+        return OVSA_OK;
+    if (RAND_bytes(g_token_key, sizeof(g_token_key)) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error generating attestation token key failed\n");
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+    g_token_validity = validity;
+    OVSA_DBG(DBG_I, "OVSA:Attestation tokens are valid for %zu seconds\n", validity);
+    return OVSA_OK;
+}
+
+size_t ovsa_license_service_attestation_token_validity(void) {
+    return g_token_validity;
+}
+
+static ovsa_status_t ovsa_license_service_attestation_token_mac(const char* claims,
+                                                                size_t claims_len, char* mac_hex) {
+    unsigned char mac[SHA256_DIGEST_LENGTH];
+    unsigned int mac_len = 0;
+    size_t index         = 0;
+
+    if (HMAC(EVP_sha256(), g_token_key, sizeof(g_token_key), (const unsigned char*)claims,
+             claims_len, mac, &mac_len) == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error computing attestation token signature failed\n");
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+    for (index = 0; index < mac_len; index++)
+        snprintf(&mac_hex[index * 2], 3, "%02x", mac[index]);
+    OPENSSL_cleanse(mac, sizeof(mac));
+    return OVSA_OK;
+}
+
+ovsa_status_t ovsa_license_service_attestation_token_create(const char* ak_name,
+                                                            const char* platform_cert,
+                                                            const ovsa_quote_info_t* sw_quote_info,
+                                                            const ovsa_quote_info_t* hw_quote_info,
+                                                            char** token) {
+    ovsa_status_t ret     = OVSA_OK;
+    char* claims          = NULL;
+    char* claims_b64      = NULL;
+    size_t claims_len     = 0;
+    size_t claims_b64_len = 0;
+    size_t token_len      = 0;
+    char expiry[MAX_NAME_SIZE];
+    char mac_hex[SHA256_DIGEST_LENGTH * 2 + 1];
+    const char* names[] = {"AK_name",      "AK_pub",       "certificate",
+                           "sw_quote_pcr", "hw_quote_pcr", "expiry"};
+    const char* values[6];
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if ((g_token_validity == 0) || (ak_name == NULL) || (platform_cert == NULL) ||
+        (sw_quote_info == NULL) || (sw_quote_info->ak_pub_key == NULL) ||
+        (sw_quote_info->quote_pcr == NULL) || (hw_quote_info == NULL) || (token == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error create attestation token failed with invalid parameter\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    memset_s(mac_hex, sizeof(mac_hex), 0);
+    snprintf(expiry, sizeof(expiry), "%lld", (long long)time(NULL) + (long long)g_token_validity);
+    values[0] = ak_name;
+    values[1] = sw_quote_info->ak_pub_key;
+    values[2] = platform_cert;
+    values[3] = sw_quote_info->quote_pcr;
+    values[4] = hw_quote_info->quote_pcr;
+    values[5] = expiry;
+
+    ret = ovsa_license_service_json_create_string_object(names, values, 6, &claims);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create attestation token claims failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_get_string_length(claims, &claims_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of claims string %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_crypto_convert_bin_to_base64(claims, claims_len, &claims_b64);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error encode attestation token claims failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_get_string_length(claims_b64, &claims_b64_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of claims string %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_attestation_token_mac(claims_b64, claims_b64_len, mac_hex);
+    if (ret < OVSA_OK)
+        goto out;
+
+    token_len = claims_b64_len + 1 + (sizeof(mac_hex) - 1);
+    ret       = ovsa_license_service_safe_malloc(token_len + 1, token);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token memory allocation failed %d\n", ret);
+        goto out;
+    }
+    snprintf(*token, token_len + 1, "%s.%s", claims_b64, mac_hex);
+out:
+    ovsa_license_service_safe_free(&claims);
+    ovsa_license_service_safe_free(&claims_b64);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_attestation_token_verify(const char* token,
+                                                            const char* ak_name,
+                                                            ovsa_quote_info_t* quote_info,
+                                                            const char* nonce, size_t nonce_len,
+                                                            char* platform_cert,
+                                                            ovsa_quote_info_t* sw_quote_info,
+                                                            ovsa_quote_info_t* hw_quote_info) {
+    ovsa_status_t ret     = OVSA_OK;
+    const char* separator = NULL;
+    char* claims          = NULL;
+    char* token_ak_name   = NULL;
+    char* token_cert      = NULL;
+    char* token_expiry    = NULL;
+    char* endptr          = NULL;
+    size_t claims_b64_len = 0;
+    size_t claims_len     = 0;
+    size_t cert_len       = 0;
+    long long expiry      = 0;
+    int indicator         = -1;
+    char mac_hex[SHA256_DIGEST_LENGTH * 2 + 1];
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if ((g_token_validity == 0) || (token == NULL) || (ak_name == NULL) || (quote_info == NULL) ||
+        (quote_info->quote_pcr == NULL) || (nonce == NULL) || (platform_cert == NULL) ||
+        (sw_quote_info == NULL) || (hw_quote_info == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error verify attestation token failed with invalid parameter\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    /* Check the signature before looking into the claims */
+    separator = strrchr(token, '.');
+    if ((separator == NULL) || (separator == token) ||
+        (strnlen_s(separator + 1, sizeof(mac_hex)) != sizeof(mac_hex) - 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token format is invalid\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    claims_b64_len = separator - token;
+    memset_s(mac_hex, sizeof(mac_hex), 0);
+    ret = ovsa_license_service_attestation_token_mac(token, claims_b64_len, mac_hex);
+    if (ret < OVSA_OK)
+        goto out;
+    if (CRYPTO_memcmp(mac_hex, separator + 1, sizeof(mac_hex) - 1) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token signature verify failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+
+    ret = ovsa_license_service_safe_malloc(claims_b64_len + 1, &claims);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token memory allocation failed %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_crypto_convert_base64_to_bin(token, claims_b64_len, claims,
+                                                            &claims_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error decode attestation token claims failed with code %d\n", ret);
+        goto out;
+    }
+    claims[claims_len] = '\0';
+
+    ret = ovsa_license_service_json_extract_element(claims, "expiry", &token_expiry);
+    if ((ret < OVSA_OK) || (token_expiry == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token expiry failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    expiry = strtoll(token_expiry, &endptr, 10);
+    if ((*endptr != '\0') || (expiry <= (long long)time(NULL))) {
+        OVSA_DBG(DBG_I, "OVSA:Attestation token expired\n");
+        ret = OVSA_ATTESTATION_TOKEN_EXPIRED;
+        goto out;
+    }
+    /* The token is only good for the AK it was issued to */
+    ret = ovsa_license_service_json_extract_element(claims, "AK_name", &token_ak_name);
+    if ((ret < OVSA_OK) || (token_ak_name == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token AK name failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    strcmp_s(token_ak_name, MAX_NAME_SIZE, ak_name, &indicator);
+    if (indicator != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token was issued to another AK\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    /* The AK name is sent by the client, the quote over the nonce proves it holds the AK */
+    ret = ovsa_license_service_json_extract_element(claims, "AK_pub", &quote_info->ak_pub_key);
+    if ((ret < OVSA_OK) || (quote_info->ak_pub_key == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token AK public key failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_tpm2_checkquote(quote_info, nonce, nonce_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token quote verify failed with code %d\n", ret);
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_json_extract_element(claims, "certificate", &token_cert);
+    if ((ret < OVSA_OK) || (token_cert == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token platform certificate failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    cert_len = strnlen_s(token_cert, MAX_CERT_SIZE);
+    if ((cert_len == 0) || (cert_len >= MAX_CERT_SIZE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token platform certificate length is invalid\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_json_extract_element(claims, "sw_quote_pcr",
+                                                    &sw_quote_info->quote_pcr);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token SW PCRs failed with code %d\n", ret);
+        goto out;
+    }
+    /* The PCRs quoted now have to be the ones the token was issued for */
+    if ((sw_quote_info->quote_pcr == NULL) ||
+        (strcmp(sw_quote_info->quote_pcr, quote_info->quote_pcr) != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token PCRs differ from the quoted PCRs\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_json_extract_element(claims, "hw_quote_pcr",
+                                                    &hw_quote_info->quote_pcr);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token HW PCRs failed with code %d\n", ret);
+        goto out;
+    }
+    memcpy_s(platform_cert, MAX_CERT_SIZE, token_cert, cert_len);
+    platform_cert[cert_len] = '\0';
+    OVSA_DBG(DBG_I, "OVSA:Platform attested by token of AK %s\n", ak_name);
+out:
+    ovsa_license_service_safe_free(&claims);
+    ovsa_license_service_safe_free(&token_ak_name);
+    ovsa_license_service_safe_free(&token_cert);
+    ovsa_license_service_safe_free(&token_expiry);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_attestation_token_deinit(void) {
+    OPENSSL_cleanse(g_token_key, sizeof(g_token_key));
+    g_token_validity = 0;
+}
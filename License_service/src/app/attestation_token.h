@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __OVSA_ATTESTATION_TOKEN_H_
+#define __OVSA_ATTESTATION_TOKEN_H_
+
+#include "license_service.h"
+
+/* Attestation tokens are signed with a key generated when the License Service starts */
+#define ATTESTATION_TOKEN_KEY_SIZE 32
+
+/* API's */
+/*!
+ * \brief ovsa_license_service_attestation_token_init generates the key the attestation tokens
+ * are signed with. Tokens are not issued if the validity is 0
+ *
+ * \param [in]  validity validity of the tokens in seconds
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_attestation_token_init(size_t validity);
+
+/*!
+ * \brief ovsa_license_service_attestation_token_validity returns the validity of the tokens
+ *
+ * \return validity in seconds, 0 if tokens are not issued
+ */
+
+size_t ovsa_license_service_attestation_token_validity(void);
+
+/*!
+ * \brief ovsa_license_service_attestation_token_create issues a token for a platform whose
+ * TPM quote was verified. The token carries the AK name and public key, the platform
+ * certificate and the PCRs of the quotes, which stand in for the EK/AK binding and the HW quote
+ * of the platform until the token expires
+ *
+ * \param [in]  ak_name name of the AK the quote was verified with
+ * \param [in]  platform_cert platform certificate of the client
+ * \param [in]  sw_quote_info verified SW quote of the client
+ * \param [in]  hw_quote_info verified HW quote of the client
+ * \param [out] token issued token
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_attestation_token_create(const char* ak_name,
+                                                            const char* platform_cert,
+                                                            const ovsa_quote_info_t* sw_quote_info,
+                                                            const ovsa_quote_info_t* hw_quote_info,
+                                                            char** token);
+
+/*!
+ * \brief ovsa_license_service_attestation_token_verify checks the signature and the expiry of
+ * a token presented by a client, and that the client quoted the PCRs of the token with the AK
+ * of the token over the nonce of the license check. The PCRs of the token are returned in the
+ * quote info for the TCB validation
+ *
+ * \param [in]  token token presented by the client
+ * \param [in]  ak_name name of the AK of the client
+ * \param [in]  quote_info quote of the client, the AK public key of the token is set in it
+ * \param [in]  nonce nonce the quote of the client is qualified with
+ * \param [in]  nonce_len length of the nonce
+ * \param [out] platform_cert platform certificate of the client, MAX_CERT_SIZE bytes
+ * \param [out] sw_quote_info SW quote PCRs of the token
+ * \param [out] hw_quote_info HW quote PCRs of the token
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_attestation_token_verify(const char* token,
+                                                            const char* ak_name,
+                                                            ovsa_quote_info_t* quote_info,
+                                                            const char* nonce, size_t nonce_len,
+                                                            char* platform_cert,
+                                                            ovsa_quote_info_t* sw_quote_info,
+                                                            ovsa_quote_info_t* hw_quote_info);
+
+/*!
+ * \brief ovsa_license_service_attestation_token_deinit clears the key of the tokens. To be
+ * called after the worker threads are stopped
+ *
+ * \return void
+ */
+
+void ovsa_license_service_attestation_token_deinit(void);
+
+#endif
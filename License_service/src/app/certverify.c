@@ -19,6 +19,7 @@
 #include <openssl/bio.h>
 #include <openssl/err.h>
 #include <openssl/ocsp.h>
+#include <openssl/pem.h>
 #include <openssl/ssl.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -41,6 +42,8 @@ static int ovsa_license_service_crypto_cert_check(X509_STORE* ctx, const char* c
 
 static X509_STORE* ovsa_license_service_crypto_setup_chain(const char* cafile);
 
+static X509_STORE* ovsa_license_service_crypto_setup_chain_bio(BIO* chain_bio);
+
 static void ovsa_license_service_crypto_nodes_print(const char* name,
                                                     STACK_OF(X509_POLICY_NODE) * nodes);
 
@@ -49,13 +52,13 @@ static void ovsa_license_service_crypto_policies_print(X509_STORE_CTX* ctx);
 static int ovsa_license_service_crypto_verify_cb(int ok, X509_STORE_CTX* ctx);
 
 static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const char* cert,
-                                                                          const char* chain_file,
+                                                                          BIO* chain_bio,
                                                                           const char* chain_cert);
 
 static size_t ovsa_license_service_crypto_write_callback(void* data, size_t size, size_t num_items,
-                                                         FILE* issuer_fp);
+                                                         BIO* issuer_bio);
 
-static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(const char* issuer_file_name,
+static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(BIO* issuer_bio,
                                                                  const char* ca_issuers_uri);
 
 static ovsa_status_t ovsa_license_service_crypto_extract_ca_cert(X509* xcert, char** ca_cert);
@@ -176,6 +179,45 @@ end:
     return NULL;
 }
 
+/* Same as ovsa_license_service_crypto_setup_chain() for a chain of PEM certificates in memory */
+static X509_STORE* ovsa_license_service_crypto_setup_chain_bio(BIO* chain_bio) {
+    STACK_OF(X509_INFO)* infos = NULL;
+    X509_INFO* info            = NULL;
+    X509_STORE* store          = NULL;
+    int index                  = 0;
+
+    if (chain_bio == NULL) {
+        BIO_printf(g_bio_err, "OVSA: Error setting up chain failed with invalid parameter\n");
+        return NULL;
+    }
+
+    store = X509_STORE_new();
+    if (store == NULL) {
+        goto end;
+    }
+
+    infos = PEM_X509_INFO_read_bio(chain_bio, NULL, NULL, NULL);
+    if (infos == NULL) {
+        BIO_printf(g_bio_err, "OVSA: Error setting up chain failed in reading the chain\n");
+        goto end;
+    }
+    for (index = 0; index < sk_X509_INFO_num(infos); index++) {
+        info = sk_X509_INFO_value(infos, index);
+        if ((info->x509 != NULL) && !X509_STORE_add_cert(store, info->x509)) {
+            BIO_printf(g_bio_err, "OVSA: Error setting up chain failed in adding a certificate\n");
+            goto end;
+        }
+    }
+    sk_X509_INFO_pop_free(infos, X509_INFO_free);
+
+    ERR_clear_error();
+    return store;
+end:
+    sk_X509_INFO_pop_free(infos, X509_INFO_free);
+    X509_STORE_free(store);
+    return NULL;
+}
+
 static void ovsa_license_service_crypto_nodes_print(const char* name,
                                                     STACK_OF(X509_POLICY_NODE) * nodes) {
     X509_POLICY_NODE* node = NULL;
@@ -679,32 +721,25 @@ static void ovsa_license_service_crypto_print_name(BIO* out, const char* title,
     return;
 }
 
-/* Write the received certificate into issuer_fp */
+/* Write the received certificate into issuer_bio */
 static size_t ovsa_license_service_crypto_write_callback(void* data, size_t size, size_t num_items,
-                                                         FILE* issuer_fp) {
-    return fwrite(data, size, num_items, issuer_fp);
+                                                         BIO* issuer_bio) {
+    if (BIO_write(issuer_bio, data, size * num_items) != (int)(size * num_items))
+        return 0;
+    return size * num_items;
 }
 
-static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(const char* issuer_file_name,
+static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(BIO* issuer_bio,
                                                                  const char* ca_issuers_uri) {
     ovsa_status_t ret = OVSA_OK;
-    FILE* issuer_fp   = NULL;
 
-    if ((issuer_file_name == NULL) || (ca_issuers_uri == NULL)) {
+    if ((issuer_bio == NULL) || (ca_issuers_uri == NULL)) {
         BIO_printf(g_bio_err,
                    "OVSA: Error getting the issuer certificate failed with "
                    "invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    issuer_fp = fopen(issuer_file_name, "w");
-    if (issuer_fp == NULL) {
-        BIO_printf(g_bio_err,
-                   "OVSA: Error getting the issuer certificate failed in "
-                   "opening the issuer file\n");
-        return OVSA_FILEOPEN_FAIL;
-    }
-
     CURL* curl = curl_easy_init();
     if (curl == NULL) {
         BIO_printf(g_bio_err,
@@ -727,8 +762,8 @@ static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(const char* iss
     /* When data arrives, curl will call ovsa_license_service_crypto_write_callback */
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ovsa_license_service_crypto_write_callback);
 
-    /* Received data will be written to issuer_fp */
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)issuer_fp);
+    /* Received data will be written to issuer_bio */
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)issuer_bio);
 
     /* Perform the request, result will get the return code */
     CURLcode result = curl_easy_perform(curl);
@@ -743,9 +778,6 @@ static ovsa_status_t ovsa_license_service_crypto_get_issuer_cert(const char* iss
     curl_easy_cleanup(curl);
 
 end:
-    if (issuer_fp != NULL) {
-        fclose(issuer_fp);
-    }
     if (ret < OVSA_OK) {
         ERR_print_errors(g_bio_err);
     }
@@ -1407,8 +1439,12 @@ end:
     return ret;
 }
 
+/*
+ * Forms the chain of the certificate in chain_bio, in memory so that the certificates of
+ * concurrent checks do not share any file.
+ */
 static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const char* cert,
-                                                                          const char* chain_file,
+                                                                          BIO* chain_bio,
                                                                           const char* chain_cert) {
     ovsa_status_t ret           = OVSA_OK;
     BIO* ca_issuers_bio         = NULL;
@@ -1422,18 +1458,14 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
     char* d2i_cert              = NULL;
     char* ca_issuers            = NULL;
     char* ca_cert               = NULL;
-    char* issuer_cert           = NULL;
     char* issuer_dup            = NULL;
     const char* exts            = "authorityInfoAccess";
     bool check_ca_cert          = false;
     bool check_cert_trust_store = false;
-    FILE* chain_fp              = NULL;
-    FILE* issuer_fp             = NULL;
     int cert_flag               = 0;
     int safe_exit               = 0;
     size_t ca_cert_len = 0, cert_len = 0;
-    size_t issuer_cert_len = 0, cert_file_size = 0;
-    char* issuer_file_name      = "/opt/ovsa/tmp_dir/issuer_cert.der";
+    size_t issuer_cert_len      = 0;
     size_t ca_issuers_field_len = 0;
     int ca_issuers_uri_len = 0, count = 0;
     char ca_issuers_uri[MAX_URL_SIZE];
@@ -1442,7 +1474,7 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
     char* ocsp_uri = NULL;
 #endif
 
-    if ((cert == NULL) || (chain_file == NULL)) {
+    if ((cert == NULL) || (chain_bio == NULL)) {
         BIO_printf(g_bio_err, "OVSA: Error forming chain failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -1463,14 +1495,7 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
         goto end;
     }
 
-    /* Write the client certificate to chain file */
-    chain_fp = fopen(chain_file, "w");
-    if (chain_fp == NULL) {
-        BIO_printf(g_bio_err, "OVSA: Error forming chain failed in opening the chain file\n");
-        ret = OVSA_FILEOPEN_FAIL;
-        goto end;
-    }
-
+    /* Write the client certificate to the chain */
     if (chain_cert != NULL) {
         ret = ovsa_license_service_get_string_length(chain_cert, &cert_len);
         if ((ret < OVSA_OK) || (cert_len == EOK)) {
@@ -1478,13 +1503,11 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
                 g_bio_err,
                 "OVSA: Error forming chain failed in getting the size of the certificate chain\n");
             ret = OVSA_INVALID_FILE_PATH;
-            fclose(chain_fp);
             goto end;
         }
-        if (!fwrite(chain_cert, cert_len, 1, chain_fp)) {
-            BIO_printf(g_bio_err, "OVSA: Error in writing to certificate chain to chain file\n");
-            fclose(chain_fp);
-            ret = OVSA_FILEIO_FAIL;
+        if (BIO_write(chain_bio, chain_cert, cert_len) != (int)cert_len) {
+            BIO_printf(g_bio_err, "OVSA: Error in writing to certificate chain to chain\n");
+            ret = OVSA_CRYPTO_BIO_ERROR;
             goto end;
         }
     }
@@ -1494,17 +1517,14 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
         BIO_printf(g_bio_err,
                    "OVSA: Error forming chain failed in getting the size of the certificate\n");
         ret = OVSA_INVALID_FILE_PATH;
-        fclose(chain_fp);
         goto end;
     }
 
-    if (!fwrite(cert, cert_len, 1, chain_fp)) {
-        BIO_printf(g_bio_err, "OVSA: Error in writing certificate to chain file\n");
-        fclose(chain_fp);
-        ret = OVSA_FILEIO_FAIL;
+    if (BIO_write(chain_bio, cert, cert_len) != (int)cert_len) {
+        BIO_printf(g_bio_err, "OVSA: Error in writing certificate to chain\n");
+        ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
-    fclose(chain_fp);
 
     while (cert != NULL) {
         if (issuer_cert_len != 0) {
@@ -1620,23 +1640,12 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
                 goto end;
             }
 
-            /* Write the CA certificate to chain file */
-            chain_fp = fopen(chain_file, "a");
-            if (chain_fp == NULL) {
-                BIO_printf(g_bio_err,
-                           "OVSA: Error forming chain failed in opening the chain file\n");
-                ret = OVSA_FILEOPEN_FAIL;
-                goto end;
-            }
-
-            if (!fwrite(ca_cert, ca_cert_len, 1, chain_fp)) {
-                BIO_printf(g_bio_err,
-                           "OVSA: Error forming chain failed in writing to chain file\n");
-                fclose(chain_fp);
-                ret = OVSA_FILEIO_FAIL;
+            /* Write the CA certificate to the chain */
+            if (BIO_write(chain_bio, ca_cert, ca_cert_len) != (int)ca_cert_len) {
+                BIO_printf(g_bio_err, "OVSA: Error forming chain failed in writing to chain\n");
+                ret = OVSA_CRYPTO_BIO_ERROR;
                 goto end;
             }
-            fclose(chain_fp);
             break;
         }
 
@@ -1680,52 +1689,22 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
             goto end;
         }
 
-        /* Get the issuer certificate from CAIssuers URI */
-        ret = ovsa_license_service_crypto_get_issuer_cert(issuer_file_name, ca_issuers_uri);
-        if (ret < OVSA_OK) {
-            BIO_printf(g_bio_err,
-                       "OVSA: Error forming chain failed in getting the issuer certificate\n");
-            ret = OVSA_CRYPTO_X509_ERROR;
-            goto end;
-        }
-
-        /* Read the downloaded issuer certificate */
-        issuer_fp = fopen(issuer_file_name, "rb");
-        if (issuer_fp == NULL) {
-            BIO_printf(g_bio_err, "OVSA: Error forming chain failed in opening the issuer file\n");
-            ret = OVSA_FILEOPEN_FAIL;
-            goto end;
-        }
-
-        safe_exit = 0;
-        ret       = ovsa_license_service_crypto_get_file_size(issuer_fp, &cert_file_size);
-        if (ret < OVSA_OK || cert_file_size == 0) {
-            BIO_printf(g_bio_err, "OVSA: Error getting file size of %s\n", issuer_file_name);
-            ret = OVSA_FILEIO_FAIL;
-            goto exit;
-        }
-
-        ret = ovsa_license_service_safe_malloc(cert_file_size, &issuer_cert);
-        if (ret < OVSA_OK) {
+        safe_exit       = 0;
+        issuer_cert_mem = BIO_new(BIO_s_mem());
+        if (issuer_cert_mem == NULL) {
             BIO_printf(g_bio_err,
-                       "OVSA: Error forming chain failed in allocating memory for issuer "
+                       "OVSA: Error forming chain failed in getting new BIO for issuer "
                        "certificate\n");
-            ret = OVSA_MEMORY_ALLOC_FAIL;
-            goto exit;
-        }
-
-        if (!fread(issuer_cert, 1, cert_file_size, issuer_fp)) {
-            BIO_printf(g_bio_err, "OVSA: Error forming chain failed in reading the issuer file\n");
-            ret = OVSA_FILEIO_FAIL;
+            ret = OVSA_CRYPTO_BIO_ERROR;
             goto exit;
         }
-        issuer_cert[cert_file_size - 1] = '\0';
 
-        issuer_cert_mem = BIO_new_mem_buf(issuer_cert, (cert_file_size - 1));
-        if (issuer_cert_mem == NULL) {
+        /* Get the issuer certificate from CAIssuers URI */
+        ret = ovsa_license_service_crypto_get_issuer_cert(issuer_cert_mem, ca_issuers_uri);
+        if (ret < OVSA_OK) {
             BIO_printf(g_bio_err,
-                       "OVSA: Error forming chain failed in writing to issuer certificate BIO\n");
-            ret = OVSA_CRYPTO_BIO_ERROR;
+                       "OVSA: Error forming chain failed in getting the issuer certificate\n");
+            ret = OVSA_CRYPTO_X509_ERROR;
             goto exit;
         }
 
@@ -1792,31 +1771,19 @@ static ovsa_status_t ovsa_license_service_crypto_form_chain_do_ocsp_check(const
         }
 #endif
 
-        /* Write the Intermediate certificate to chain file */
-        chain_fp = fopen(chain_file, "a");
-        if (chain_fp == NULL) {
-            BIO_printf(g_bio_err, "OVSA: Error forming chain failed in opening the chain file\n");
-            ret = OVSA_FILEOPEN_FAIL;
-            goto exit;
-        }
-
-        if (!fwrite(issuer_cert_ptr->data, issuer_cert_ptr->length, 1, chain_fp)) {
-            BIO_printf(g_bio_err, "OVSA: Error forming chain failed in writing to chain file\n");
-            fclose(chain_fp);
-            ret = OVSA_FILEIO_FAIL;
+        /* Write the Intermediate certificate to the chain */
+        if (BIO_write(chain_bio, issuer_cert_ptr->data, issuer_cert_ptr->length) !=
+            (int)issuer_cert_ptr->length) {
+            BIO_printf(g_bio_err, "OVSA: Error forming chain failed in writing to chain\n");
+            ret = OVSA_CRYPTO_BIO_ERROR;
             goto exit;
         }
-        fclose(chain_fp);
 
         d2i_cert        = issuer_cert_ptr->data;
         issuer_cert_len = issuer_cert_ptr->length;
         safe_exit       = 1;
 
     exit:
-        if (issuer_fp != NULL) {
-            fclose(issuer_fp);
-        }
-        ovsa_license_service_safe_free(&issuer_cert);
         ovsa_license_service_safe_free(&issuer_dup);
         ovsa_license_service_safe_free(&cert_dup);
         (void)BIO_reset(ca_issuers_bio);
@@ -1841,9 +1808,6 @@ end:
     BIO_free_all(issuer_cert_bio);
     X509_free(xcert);
     xcert = NULL;
-    if (remove(issuer_file_name) != 0) {
-        BIO_printf(g_bio_err, "OVSA: Warning could not delete %s file\n", issuer_file_name);
-    }
     if (ret < OVSA_OK) {
         ERR_print_errors(g_bio_err);
     }
@@ -1872,7 +1836,7 @@ ovsa_status_t ovsa_license_service_crypto_verify_certificate(const char* cert,
     ovsa_status_t mutex_unlock_ret = OVSA_OK;
     X509_STORE* store              = NULL;
     X509* xcert                    = NULL;
-    char* chain_file               = "/opt/ovsa/tmp_dir/chain.pem";
+    BIO* chain_bio                 = NULL;
     bool check_self_signed_cert    = false;
     int cert_verify                = 0;
     EVP_PKEY* pkey                 = NULL;
@@ -1938,15 +1902,23 @@ ovsa_status_t ovsa_license_service_crypto_verify_certificate(const char* cert,
     } else
 #endif
     {
-        ret = ovsa_license_service_crypto_form_chain_do_ocsp_check(cert, chain_file, chain_cert);
+        chain_bio = BIO_new(BIO_s_mem());
+        if (chain_bio == NULL) {
+            BIO_printf(g_bio_err,
+                       "OVSA: Error verifying certificate failed in getting new BIO for the "
+                       "chain\n");
+            ret = OVSA_CRYPTO_BIO_ERROR;
+            goto end;
+        }
+        ret = ovsa_license_service_crypto_form_chain_do_ocsp_check(cert, chain_bio, chain_cert);
         if (ret < OVSA_OK) {
             BIO_printf(g_bio_err,
-                       "OVSA: Error verifying certificate failed since chain file "
+                       "OVSA: Error verifying certificate failed since chain "
                        "could not be created\n");
             goto end;
         }
 
-        if ((store = ovsa_license_service_crypto_setup_chain(chain_file)) == NULL) {
+        if ((store = ovsa_license_service_crypto_setup_chain_bio(chain_bio)) == NULL) {
             BIO_printf(g_bio_err,
                        "OVSA: Error verifying certificate failed in storing the "
                        "certificate chain\n");
@@ -1972,11 +1944,7 @@ end:
 exit:
     X509_free(xcert);
     X509_STORE_free(store);
-    if (check_self_signed_cert == false) {
-        if (remove(chain_file) != 0) {
-            BIO_printf(g_bio_err, "OVSA: Warning could not delete %s file\n", chain_file);
-        }
-    }
+    BIO_free_all(chain_bio);
     if (ret < OVSA_OK) {
         ERR_print_errors(g_bio_err);
     }
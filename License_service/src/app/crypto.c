@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "base64.h"
 #include "json.h"
 #include "license_service.h"
 #include "safe_str_lib.h"
@@ -477,11 +478,8 @@ end:
 ovsa_status_t ovsa_license_service_crypto_convert_bin_to_base64(const char* in_buff,
                                                                 size_t in_buff_len,
                                                                 char** out_buff) {
-    ovsa_status_t ret      = OVSA_OK;
-    BIO* pem_bio           = NULL;
-    BIO* write_bio         = NULL;
-    BIO* b64               = NULL;
-    BUF_MEM* pem_write_ptr = NULL;
+    ovsa_status_t ret = OVSA_OK;
+    size_t pem_len    = 0;
 
     if ((in_buff == NULL) || (in_buff_len == 0)) {
         BIO_printf(g_bio_err,
@@ -489,86 +487,26 @@ ovsa_status_t ovsa_license_service_crypto_convert_bin_to_base64(const char* in_b
         return OVSA_INVALID_PARAMETER;
     }
 
-    if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed in getting the b64 encode "
-                   "method\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    pem_bio = BIO_new(BIO_s_mem());
-    if (pem_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed in "
-                   "getting new BIO for the pem\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    write_bio = pem_bio;
-    write_bio = BIO_push(b64, write_bio);
-
-    if (!BIO_write(write_bio, in_buff, in_buff_len)) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed in writing to pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    if (!BIO_flush(write_bio)) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed in "
-                   "flushing the pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    BIO_get_mem_ptr(write_bio, &pem_write_ptr);
-    if (pem_write_ptr == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed to extract the pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
+    /* Wrapped every 64 characters, the same output as the base64 BIO */
+    pem_len = ovsa_base64_encode_len(in_buff_len, true);
 
     /* App needs to free this memory */
-    ret = ovsa_license_service_safe_malloc(pem_write_ptr->length + NULL_TERMINATOR, out_buff);
+    ret = ovsa_license_service_safe_malloc(pem_len + NULL_TERMINATOR, out_buff);
     if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error converting bin to pem failed in allocating memory for "
                    "pem buffer\n");
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        goto end;
-    }
-
-    if (memcpy_s(*out_buff, pem_write_ptr->length, pem_write_ptr->data, pem_write_ptr->length) !=
-        EOK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to pem failed in "
-                   "getting the output buffer\n");
-        ret = OVSA_MEMIO_ERROR;
-        ovsa_license_service_safe_free(out_buff);
-        goto end;
+        return OVSA_MEMORY_ALLOC_FAIL;
     }
 
-end:
-    BIO_free(b64);
-    BIO_free_all(pem_bio);
-    if (ret < OVSA_OK) {
-        ERR_print_errors(g_bio_err);
-    }
+    ovsa_base64_encode((const unsigned char*)in_buff, in_buff_len, true, *out_buff);
     return ret;
 }
 
 ovsa_status_t ovsa_license_service_crypto_convert_base64_to_bin(const char* in_buff,
                                                                 size_t in_buff_len, char* out_buff,
                                                                 size_t* out_buff_len) {
-    ovsa_status_t ret = OVSA_OK;
-    BIO* bin_bio      = NULL;
-    BIO* write_bio    = NULL;
-    BIO* b64          = NULL;
-    size_t bin_len    = 0;
+    size_t bin_len = 0;
 
     if ((in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
@@ -576,89 +514,34 @@ ovsa_status_t ovsa_license_service_crypto_convert_base64_to_bin(const char* in_b
         return OVSA_INVALID_PARAMETER;
     }
 
-    if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting pem to bin failed in getting the b64 encode "
-                   "method\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    bin_bio = BIO_new_mem_buf(in_buff, in_buff_len);
-    if (bin_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting pem to bin failed in writing to bin BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    write_bio = bin_bio;
-    write_bio = BIO_push(b64, write_bio);
-    bin_len   = BIO_read(write_bio, out_buff, in_buff_len);
-    if (bin_len <= 0) {
+    /* The output never exceeds in_buff_len, the size callers have always provided */
+    if ((ovsa_base64_decode(in_buff, in_buff_len, (unsigned char*)out_buff, &bin_len) != 0) ||
+        (bin_len == 0)) {
         BIO_printf(g_bio_err, "LibOVSA: Error converting pem to bin failed in reading the bin\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+        return OVSA_CRYPTO_BIO_ERROR;
     }
     *out_buff_len = bin_len;
-
-end:
-    BIO_free(b64);
-    BIO_free_all(bin_bio);
-    if (ret < OVSA_OK) {
-        ERR_print_errors(g_bio_err);
-    }
-    return ret;
+    return OVSA_OK;
 }
 
 ovsa_status_t ovsa_license_service_create_nonce(char** nonce_buf) {
-    ovsa_status_t ret  = OVSA_OK;
-    BIO* out_bio       = NULL;
-    BIO* nonce_bio     = NULL;
-    BIO* b64           = NULL;
-    BUF_MEM* nonce_ptr = NULL;
-    int bytes, rng = 0;
-    size_t length             = 0;
-    size_t nonce_bin_buff_len = 0;
-    unsigned char nonce[NONCE_SIZE];
-    unsigned char nonce_bin_buff[NONCE_BUF_SIZE];
+    ovsa_status_t ret    = OVSA_OK;
+    int rng              = 0;
     char* nonce_b64_buff = NULL;
+    unsigned char nonce[NONCE_SIZE];
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     memset_s(nonce, sizeof(nonce), 0);
-    memset_s(nonce_bin_buff, sizeof(nonce_bin_buff), 0);
-
-    nonce_bio = BIO_new(BIO_s_mem());
-    if (nonce_bio == NULL) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error generate nonce failed in getting new "
-                 "BIO for the output buffer\n");
-        ret = -1;
-        goto out;
-    }
 
-    /*Generate nonce for customer validation */
+    /* Generate nonce for customer validation. RAND_bytes draws from the DRBG of the calling
+     * thread, so the workers do not contend for it */
     rng = RAND_bytes(nonce, NONCE_SIZE);
     if (rng <= OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error RAND_bytes() returned %d\n", rng);
         return -EINVAL;
     }
 
-    for (int count = 0; count < NONCE_SIZE; count++) {
-        if (BIO_printf(nonce_bio, "%02x", nonce[count]) != 2) {
-            goto out;
-        }
-    }
-
-    if (!BIO_flush(nonce_bio)) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error client license check callback failed in flushing the "
-                 "output buffer\n");
-        ret = -1;
-        goto out;
-    }
-
     size_t nouce_len = sizeof(char) * NONCE_SIZE * 2;
     ret              = ovsa_license_service_safe_malloc(nouce_len, nonce_buf);
     if (ret < OVSA_OK) {
@@ -682,7 +565,6 @@ ovsa_status_t ovsa_license_service_create_nonce(char** nonce_buf) {
     }
 
 out:
-    BIO_free_all(nonce_bio);
     ovsa_license_service_safe_free(&nonce_b64_buff);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
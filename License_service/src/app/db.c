@@ -15,116 +15,324 @@
  *
  */
 
+#include <pthread.h>
 #include <sqlite3.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "db_cluster.h"
+#include "metrics.h"
 #include "safe_str_lib.h"
 #include "utils.h"
 /* db.h to be included at end due to dependencies */
 #include "db.h"
 
-ovsa_status_t ovsa_db_get_customer_primary_certificate(const char* db_name,
-                                                       const char* license_guid,
-                                                       const char* model_guid,
-                                                       char** customer_certificate) {
-    int ret       = 0;
-    int db_status = 0;
-    size_t sqllen = 0, licguid_len = 0, modelguid_len = 0;
-    char sql[SQL_BUFFER_LENGTH];
-
-    sqlite3* db        = NULL;
-    sqlite3_stmt* stmt = NULL;
+/* Prepared statements cached per connection */
+typedef enum {
+    OVSA_DB_STMT_PRIMARY_CERT = 0,
+    OVSA_DB_STMT_SECONDARY_CERT,
+    OVSA_DB_STMT_LICENSE_BLOB,
+    OVSA_DB_STMT_LICENSE_USAGE,
+    OVSA_DB_STMT_FLUSH_USAGE,
+    OVSA_DB_STMT_CONSUME_USAGE,
+    OVSA_DB_STMT_MAX
+} ovsa_db_stmt_id_t;
+
+static const char* g_db_sql[OVSA_DB_STMT_MAX] = {
+    "select customer_license_id, customer_primary_certificate from customer_license_info where "
+    "license_guid = @license_guid and model_guid = @model_guid;",
+    "select customer_license_id, customer_secondary_certificate from customer_license_info where "
+    "license_guid = @license_guid and model_guid = @model_guid;",
+    "select customer_license_id, customer_license_blob from customer_license_info where "
+    "license_guid = @license_guid and model_guid = @model_guid;",
+    "select customer_license_id, license_type, usage_count, time_limit from "
+    "customer_license_info where license_guid = @license_guid and model_guid = @model_guid;",
+    "update customer_license_info set usage_count = max(usage_count - @consumed, 0) where "
+    "license_guid = @license_guid and model_guid = @model_guid;",
+    /* Cluster mode, the usage is only consumed when one is left */
+    "update customer_license_info set usage_count = usage_count - 1 where "
+    "license_guid = @license_guid and model_guid = @model_guid and usage_count > 0;"};
+
+typedef struct ovsa_db_conn {
+    sqlite3* db;
+    sqlite3_stmt* stmt[OVSA_DB_STMT_MAX];
+} ovsa_db_conn_t;
+
+/* In-memory usage ledger of the InstanceLimit licenses. Its counters decide admission and
+ * the consumed usages are written back to the DB in batches by the flush thread. Admission
+ * only decrements remaining, the usages consumed and not written yet are seeded - remaining */
+typedef struct ovsa_usage_entry {
+    GUID license_guid;
+    GUID model_guid;
+    int64_t remaining;
+    /* Usage count of the DB as of the last flush, owned by the flushing thread */
+    int64_t seeded;
+    /* Usages written by the open flush transaction, owned by the flushing thread */
+    int64_t flushing;
+    struct ovsa_usage_entry* next;
+} ovsa_usage_entry_t;
+
+typedef struct {
+    pthread_rwlock_t lock;
+    ovsa_usage_entry_t* buckets[USAGE_LEDGER_BUCKETS];
+    pthread_mutex_t flush_lock;
+    pthread_cond_t flush_cond;
+    pthread_t flush_tid;
+    const char* db_name;
+    bool started;
+    bool shutdown;
+} ovsa_usage_ledger_t;
+
+static ovsa_usage_ledger_t g_usage_ledger = {.lock       = PTHREAD_RWLOCK_INITIALIZER,
+                                             .flush_lock = PTHREAD_MUTEX_INITIALIZER,
+                                             .flush_cond = PTHREAD_COND_INITIALIZER};
+
+/* Each worker thread owns one connection, so the connections are opened without sqlite
+ * mutexes and the statements never cross threads */
+static __thread ovsa_db_conn_t g_thread_db_conn;
+
+/* Set when the nodes of a cluster share the store of ovsa_db_init_cluster() */
+static bool g_db_cluster;
+
+ovsa_status_t ovsa_db_init(const char* db_name) {
+    ovsa_status_t ret   = OVSA_OK;
+    int db_status       = 0;
+    sqlite3* db         = NULL;
+    sqlite3_stmt* stmt  = NULL;
+    const char* journal = NULL;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    memset_s(sql, sizeof(sql), 0);
-    /* open the database */
-    db_status = sqlite3_open(db_name, &db);
-    if (db_status) {
-        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed%s \n", sqlite3_errmsg(db));
+
+    db_status = sqlite3_open_v2(db_name, &db, SQLITE_OPEN_READWRITE, NULL);
+    if (db_status != SQLITE_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed %s \n", sqlite3_errmsg(db));
+        ret = OVSA_DB_INIT_FAIL;
+        goto end;
+    }
+    /* WAL lets the license checks read while the usage count is updated. The journal mode is
+     * persistent, so it applies to every connection opened afterwards. */
+    db_status = sqlite3_prepare_v2(db, "pragma journal_mode = wal;", -1, &stmt, NULL);
+    if ((db_status != SQLITE_OK) || (sqlite3_step(stmt) != SQLITE_ROW)) {
+        OVSA_DBG(DBG_E, "OVSA: Error setting DB journal mode failed %s \n", sqlite3_errmsg(db));
         ret = OVSA_DB_INIT_FAIL;
         goto end;
-    } else {
-        OVSA_DBG(DBG_I, "OVSA: OVSA DB open successful\n");
     }
+    journal = (const char*)sqlite3_column_text(stmt, 0);
+    OVSA_DBG(DBG_I, "OVSA: OVSA DB journal mode %s\n", journal ? journal : "unknown");
+
+end:
+    if (stmt != NULL)
+        sqlite3_finalize(stmt);
+    if (db)
+        sqlite3_close(db);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
 
-    sprintf(sql,
-            "select customer_license_id, customer_primary_certificate from "
-            "customer_license_info where "
-            "license_guid = @license_guid and model_guid = @model_guid;");
-    OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
+ovsa_status_t ovsa_db_init_cluster(const char* db_url) {
+    ovsa_status_t ret = OVSA_OK;
 
-    ret = ovsa_license_service_get_string_length(sql, &sqllen);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of sql %d\n", ret);
+    ret = ovsa_db_cluster_init(db_url);
+    if (ret == OVSA_OK)
+        g_db_cluster = true;
+    return ret;
+}
+
+ovsa_status_t ovsa_db_open_connection(const char* db_name) {
+    ovsa_status_t ret    = OVSA_OK;
+    int db_status        = 0;
+    ovsa_db_conn_t* conn = &g_thread_db_conn;
+
+    if (g_db_cluster)
+        return ovsa_db_cluster_open_connection();
+    if (conn->db != NULL)
+        return ret;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    db_status = sqlite3_open_v2(db_name, &conn->db,
+                                SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                                NULL);
+    if (db_status != SQLITE_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed %s \n", sqlite3_errmsg(conn->db));
+        sqlite3_close(conn->db);
+        conn->db = NULL;
+        ret      = OVSA_DB_INIT_FAIL;
         goto end;
     }
+    sqlite3_busy_timeout(conn->db, DB_BUSY_TIMEOUT_MS);
+    OVSA_DBG(DBG_I, "OVSA: OVSA DB open successful\n");
 
-    db_status = sqlite3_prepare_v2(db, sql, sqllen, &stmt, 0);
-    if (db_status == SQLITE_OK) {
-        int idx = sqlite3_bind_parameter_index(stmt, "@license_guid");
-        ret     = ovsa_license_service_get_string_length(license_guid, &licguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of license_guid %d\n", ret);
-            goto end;
-        }
-        sqlite3_bind_text(stmt, idx, license_guid, licguid_len, SQLITE_STATIC);
+end:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
 
-        idx = sqlite3_bind_parameter_index(stmt, "@model_guid");
-        ret = ovsa_license_service_get_string_length(model_guid, &modelguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of modelguid_len %d\n", ret);
-            goto end;
+void ovsa_db_close_connection(void) {
+    ovsa_db_conn_t* conn = &g_thread_db_conn;
+    int index            = 0;
+
+    if (g_db_cluster) {
+        ovsa_db_cluster_close_connection();
+        return;
+    }
+    for (index = 0; index < OVSA_DB_STMT_MAX; index++) {
+        if (conn->stmt[index] != NULL) {
+            sqlite3_finalize(conn->stmt[index]);
+            conn->stmt[index] = NULL;
         }
-        sqlite3_bind_text(stmt, idx, model_guid, modelguid_len, SQLITE_STATIC);
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
+    }
+    if (conn->db != NULL) {
+        sqlite3_close(conn->db);
+        conn->db = NULL;
+    }
+}
+
+static ovsa_status_t ovsa_db_bind_text(sqlite3_stmt* stmt, const char* name, const char* value) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t len        = 0;
+    int idx           = 0;
+
+    ret = ovsa_license_service_get_string_length(value, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of %s %d\n", name, ret);
+        return ret;
+    }
+    idx = sqlite3_bind_parameter_index(stmt, name);
+    if (sqlite3_bind_text(stmt, idx, value, len, SQLITE_STATIC) != SQLITE_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error failed to bind %s\n", name);
         ret = OVSA_DB_QUERY_FAIL;
-        goto end;
     }
+    return ret;
+}
 
-    db_status = sqlite3_step(stmt);
-    if (db_status == SQLITE_ROW) {
-        /* success */
-        size_t certlen = 0;
-        ret = ovsa_license_service_get_string_length(sqlite3_column_text(stmt, 1), &certlen);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of certificate %d\n", ret);
-            goto end;
+/* Returns the cached statement of this thread's connection bound to the license.
+ * The statement must be handed back with ovsa_db_release_statement() */
+static ovsa_status_t ovsa_db_get_statement(const char* db_name, ovsa_db_stmt_id_t stmt_id,
+                                           const char* license_guid, const char* model_guid,
+                                           sqlite3_stmt** stmt) {
+    ovsa_status_t ret    = OVSA_OK;
+    int db_status        = 0;
+    ovsa_db_conn_t* conn = &g_thread_db_conn;
+
+    ret = ovsa_db_open_connection(db_name);
+    if (ret < OVSA_OK)
+        return ret;
+
+    if (conn->stmt[stmt_id] == NULL) {
+        OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", g_db_sql[stmt_id]);
+        db_status = sqlite3_prepare_v3(conn->db, g_db_sql[stmt_id], -1,
+                                       SQLITE_PREPARE_PERSISTENT, &conn->stmt[stmt_id], NULL);
+        if (db_status != SQLITE_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                     sqlite3_errmsg(conn->db));
+            conn->stmt[stmt_id] = NULL;
+            return OVSA_DB_QUERY_FAIL;
         }
-        if ((!certlen) || (certlen > MAX_CERT_SIZE)) {
-            OVSA_DBG(DBG_E, "OVSA: Error certificate length is invalid \n");
-            ret = OVSA_INVALID_PARAMETER;
+    }
+    ret = ovsa_db_bind_text(conn->stmt[stmt_id], "@license_guid", license_guid);
+    if (ret == OVSA_OK)
+        ret = ovsa_db_bind_text(conn->stmt[stmt_id], "@model_guid", model_guid);
+    if (ret < OVSA_OK) {
+        sqlite3_clear_bindings(conn->stmt[stmt_id]);
+        return ret;
+    }
+    *stmt = conn->stmt[stmt_id];
+    return ret;
+}
+
+static void ovsa_db_release_statement(sqlite3_stmt* stmt) {
+    if (stmt != NULL) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+/* Copies the text column of the license row and returns its rowid */
+static ovsa_status_t ovsa_db_get_customer_column(const char* db_name, ovsa_db_stmt_id_t stmt_id,
+                                                 const char* license_guid,
+                                                 const char* model_guid, const char* name,
+                                                 size_t max_len, char** out_buf) {
+    ovsa_status_t ret  = OVSA_OK;
+    int db_status      = 0;
+    int row_id         = 0;
+    size_t len         = 0;
+    sqlite3_stmt* stmt = NULL;
+    cJSON* result      = NULL;
+    cJSON* row         = NULL;
+    const char* text   = NULL;
+    struct timespec query_start;
+
+    ovsa_license_service_metrics_stage_start(&query_start);
+    if (g_db_cluster) {
+        ret = ovsa_db_cluster_query(g_db_sql[stmt_id], license_guid, model_guid, &result, &row);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_DB_QUERY, &query_start);
+        if (ret < OVSA_OK)
             goto end;
-        }
-        ret = ovsa_license_service_safe_malloc(sizeof(char) * (certlen + 1), customer_certificate);
-        if (ret < OVSA_OK) {
-            sqlite3_finalize(stmt);
-            OVSA_DBG(DBG_E,
-                     "OVSA: Error allocating memory for certificate buffer failed with code %d\n",
-                     ret);
-            ret = OVSA_MEMORY_ALLOC_FAIL;
+        row_id = (int)ovsa_db_cluster_get_int(row, 0);
+        text   = ovsa_db_cluster_get_text(row, 1);
+    } else {
+        ret = ovsa_db_get_statement(db_name, stmt_id, license_guid, model_guid, &stmt);
+        if (ret < OVSA_OK)
+            goto end;
+
+        db_status = sqlite3_step(stmt);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_DB_QUERY, &query_start);
+        if (db_status != SQLITE_ROW) {
+            OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                     sqlite3_errmsg(g_thread_db_conn.db));
+            ret = OVSA_DB_UPDATE_FAIL;
             goto end;
         }
-        sprintf(*customer_certificate, "%s", sqlite3_column_text(stmt, 1));
-        ret = sqlite3_column_int(stmt, 0);
+        row_id = sqlite3_column_int(stmt, 0);
+        text   = (const char*)sqlite3_column_text(stmt, 1);
+    }
 
-        OVSA_DBG(DBG_D, "OVSA: ROWID %s: \n", sqlite3_column_text(stmt, 0));
-        OVSA_DBG(DBG_D, "OVSA: PRIMARY CERT %s\n", sqlite3_column_text(stmt, 1));
-        OVSA_DBG(DBG_I, "OVSA: Customer primary certificate extracted from DB successfully\n");
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-        ret = OVSA_DB_UPDATE_FAIL;
+    /* success */
+    ret = ovsa_license_service_get_string_length(text, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of %s %d\n", name, ret);
+        goto end;
+    }
+    if ((!len) || (len > max_len)) {
+        OVSA_DBG(DBG_E, "OVSA: Error %s length is invalid \n", name);
+        ret = OVSA_INVALID_PARAMETER;
         goto end;
     }
-    sqlite3_finalize(stmt);
+    ret = ovsa_license_service_safe_malloc(sizeof(char) * (len + 1), out_buf);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating memory for %s buffer failed with code %d\n",
+                 name, ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto end;
+    }
+    memcpy_s(*out_buf, len + 1, text, len);
+    ret = row_id;
+
+    OVSA_DBG(DBG_D, "OVSA: ROWID %d: \n", row_id);
+    OVSA_DBG(DBG_D, "OVSA: %s %s\n", name, text);
+    OVSA_DBG(DBG_I, "OVSA: Customer %s extracted from DB successfully\n", name);
 
 end:
-    if (db)
-        sqlite3_close(db);
+    ovsa_db_release_statement(stmt);
+    cJSON_Delete(result);
+    return ret;
+}
+
+ovsa_status_t ovsa_db_get_customer_primary_certificate(const char* db_name,
+                                                       const char* license_guid,
+                                                       const char* model_guid,
+                                                       char** customer_certificate) {
+    ovsa_status_t ret = OVSA_OK;
 
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    ret = ovsa_db_get_customer_column(db_name, OVSA_DB_STMT_PRIMARY_CERT, license_guid,
+                                      model_guid, "primary certificate", MAX_CERT_SIZE,
+                                      customer_certificate);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -134,293 +342,399 @@ ovsa_status_t ovsa_db_get_customer_secondary_certificate(const char* db_name,
                                                          const char* model_guid,
                                                          char** customer_certificate) {
     ovsa_status_t ret = OVSA_OK;
-    int db_status     = 0;
-    size_t sqllen = 0, licguid_len = 0, modelguid_len = 0;
-    char sql[SQL_BUFFER_LENGTH];
-
-    sqlite3* db        = NULL;
-    sqlite3_stmt* stmt = NULL;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    memset_s(sql, sizeof(sql), 0);
-    /* open the database */
-    db_status = sqlite3_open(db_name, &db);
-    if (db_status) {
-        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed%s \n", sqlite3_errmsg(db));
-        ret = OVSA_DB_INIT_FAIL;
-        goto end;
-    } else {
-        OVSA_DBG(DBG_I, "OVSA: OVSA DB open successful\n");
-    }
+    ret = ovsa_db_get_customer_column(db_name, OVSA_DB_STMT_SECONDARY_CERT, license_guid,
+                                      model_guid, "secondary certificate", MAX_CERT_SIZE,
+                                      customer_certificate);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
 
-    sprintf(sql,
-            "select customer_license_id, customer_secondary_certificate from "
-            "customer_license_info where "
-            "license_guid = @license_guid and model_guid = @model_guid;");
-    OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
+ovsa_status_t ovsa_db_get_customer_license_blob(const char* db_name, const char* license_guid,
+                                                const char* model_guid,
+                                                char** customer_license_blob) {
+    ovsa_status_t ret = OVSA_OK;
 
-    ret = ovsa_license_service_get_string_length(sql, &sqllen);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of sql %d\n", ret);
-        goto end;
-    }
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    ret = ovsa_db_get_customer_column(db_name, OVSA_DB_STMT_LICENSE_BLOB, license_guid,
+                                      model_guid, "license blob", SIZE_MAX,
+                                      customer_license_blob);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
 
-    db_status = sqlite3_prepare_v2(db, sql, sqllen, &stmt, 0);
-    if (db_status == SQLITE_OK) {
-        int idx = sqlite3_bind_parameter_index(stmt, "@license_guid");
-        ret     = ovsa_license_service_get_string_length(license_guid, &licguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of license_guid %d\n", ret);
-            goto end;
-        }
-        sqlite3_bind_text(stmt, idx, license_guid, licguid_len, SQLITE_STATIC);
+static uint32_t ovsa_db_usage_hash(const char* license_guid, const char* model_guid) {
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    const char* str[] = {license_guid, model_guid};
+    size_t index      = 0;
 
-        idx = sqlite3_bind_parameter_index(stmt, "@model_guid");
-        ret = ovsa_license_service_get_string_length(model_guid, &modelguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of modelguid_len %d\n", ret);
-            goto end;
+    for (index = 0; index < sizeof(str) / sizeof(str[0]); index++) {
+        for (const char* p = str[index]; *p != '\0'; p++) {
+            hash ^= (unsigned char)*p;
+            hash *= 16777619u;
         }
-        sqlite3_bind_text(stmt, idx, model_guid, modelguid_len, SQLITE_STATIC);
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-        ret = OVSA_DB_QUERY_FAIL;
-        goto end;
     }
+    return hash % USAGE_LEDGER_BUCKETS;
+}
 
-    db_status = sqlite3_step(stmt);
-    if (db_status == SQLITE_ROW) {
-        /* success */
-        size_t certlen = 0;
-        ret = ovsa_license_service_get_string_length(sqlite3_column_text(stmt, 1), &certlen);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of certificate %d\n", ret);
-            goto end;
-        }
-        if ((!certlen) || (certlen > MAX_CERT_SIZE)) {
-            OVSA_DBG(DBG_E, "OVSA: Error certificate length is invalid \n");
-            ret = OVSA_INVALID_PARAMETER;
-            goto end;
-        }
-        ret = ovsa_license_service_safe_malloc(sizeof(char) * (certlen + 1), customer_certificate);
-        if (ret < OVSA_OK) {
-            sqlite3_finalize(stmt);
-            OVSA_DBG(DBG_E,
-                     "OVSA: Error allocating memory for certificate buffer failed with code %d\n",
-                     ret);
-            ret = OVSA_MEMORY_ALLOC_FAIL;
-            goto end;
-        }
-        sprintf(*customer_certificate, "%s", sqlite3_column_text(stmt, 1));
-        ret = sqlite3_column_int(stmt, 0);
-
-        OVSA_DBG(DBG_D, "OVSA: ROWID %s: \n", sqlite3_column_text(stmt, 0));
-        OVSA_DBG(DBG_D, "OVSA: SECONDARY CERT %s\n", sqlite3_column_text(stmt, 1));
-        OVSA_DBG(DBG_I, "OVSA: Customer secondary certificate extracted from DB successfully\n");
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-        ret = OVSA_DB_UPDATE_FAIL;
-        goto end;
+static ovsa_usage_entry_t* ovsa_db_usage_find(uint32_t bucket, const char* license_guid,
+                                              const char* model_guid) {
+    ovsa_usage_entry_t* entry = NULL;
+    int indicator             = -1;
+
+    for (entry = g_usage_ledger.buckets[bucket]; entry != NULL; entry = entry->next) {
+        strcmp_s(entry->license_guid, GUID_SIZE, license_guid, &indicator);
+        if (indicator != 0)
+            continue;
+        strcmp_s(entry->model_guid, GUID_SIZE, model_guid, &indicator);
+        if (indicator == 0)
+            break;
     }
-    sqlite3_finalize(stmt);
+    return entry;
+}
 
-end:
-    if (db)
-        sqlite3_close(db);
+/* Returns the ledger entry of the license, seeding it with the usage count of the DB when
+ * the license is seen for the first time. Entries stay until the ledger is stopped, and are
+ * seeded again from the DB after each flush. */
+static ovsa_status_t ovsa_db_usage_get_entry(const char* license_guid, const char* model_guid,
+                                             int usage_count, ovsa_usage_entry_t** entry) {
+    ovsa_status_t ret = OVSA_OK;
+    uint32_t bucket   = ovsa_db_usage_hash(license_guid, model_guid);
 
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    pthread_rwlock_rdlock(&g_usage_ledger.lock);
+    *entry = ovsa_db_usage_find(bucket, license_guid, model_guid);
+    pthread_rwlock_unlock(&g_usage_ledger.lock);
+    if (*entry != NULL)
+        return ret;
+
+    pthread_rwlock_wrlock(&g_usage_ledger.lock);
+    *entry = ovsa_db_usage_find(bucket, license_guid, model_guid);
+    if (*entry != NULL)
+        goto out;
+
+    ret = ovsa_license_service_safe_malloc(sizeof(ovsa_usage_entry_t), (char**)entry);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating usage ledger entry failed with code %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+    if ((strcpy_s((*entry)->license_guid, sizeof(GUID), license_guid) != EOK) ||
+        (strcpy_s((*entry)->model_guid, sizeof(GUID), model_guid) != EOK)) {
+        OVSA_DBG(DBG_E, "OVSA: Error license guid or model guid length is invalid\n");
+        ovsa_license_service_safe_free((char**)entry);
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    (*entry)->remaining            = usage_count;
+    (*entry)->seeded               = usage_count;
+    (*entry)->next                 = g_usage_ledger.buckets[bucket];
+    g_usage_ledger.buckets[bucket] = *entry;
+
+out:
+    pthread_rwlock_unlock(&g_usage_ledger.lock);
     return ret;
 }
 
-ovsa_status_t ovsa_db_get_customer_license_blob(const char* db_name, const char* license_guid,
-                                                const char* model_guid,
-                                                char** customer_license_blob) {
-    int ret       = 0;
-    int db_status = 0;
-    size_t sqllen = 0, licguid_len = 0, modelguid_len = 0;
-    char sql[SQL_BUFFER_LENGTH];
+static ovsa_status_t ovsa_db_usage_consume(ovsa_usage_entry_t* entry) {
+    int64_t remaining = __atomic_load_n(&entry->remaining, __ATOMIC_ACQUIRE);
 
-    sqlite3* db        = NULL;
+    do {
+        if (remaining <= 0)
+            return OVSA_DB_USAGELIMIT_FAIL;
+    } while (!__atomic_compare_exchange_n(&entry->remaining, &remaining, remaining - 1, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_db_usage_flush_entry(const char* db_name, ovsa_usage_entry_t* entry) {
+    ovsa_status_t ret  = OVSA_OK;
     sqlite3_stmt* stmt = NULL;
+    int idx            = 0;
 
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    memset_s(sql, sizeof(sql), 0);
-    /* open the database */
-    db_status = sqlite3_open(db_name, &db);
-    if (db_status) {
-        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed%s \n", sqlite3_errmsg(db));
-        ret = OVSA_DB_INIT_FAIL;
+    ret = ovsa_db_get_statement(db_name, OVSA_DB_STMT_FLUSH_USAGE, entry->license_guid,
+                                entry->model_guid, &stmt);
+    if (ret < OVSA_OK)
         goto end;
-    } else {
-        OVSA_DBG(DBG_I, "OVSA: OVSA DB open successful\n");
+
+    idx = sqlite3_bind_parameter_index(stmt, "@consumed");
+    if ((sqlite3_bind_int64(stmt, idx, entry->flushing) != SQLITE_OK) ||
+        (sqlite3_step(stmt) != SQLITE_DONE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                 sqlite3_errmsg(g_thread_db_conn.db));
+        ret = OVSA_DB_UPDATE_FAIL;
     }
 
-    sprintf(sql,
-            "select customer_license_id, customer_license_blob from "
-            "customer_license_info where "
-            "license_guid = @license_guid and model_guid = @model_guid;");
-    OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
+end:
+    ovsa_db_release_statement(stmt);
+    return ret;
+}
 
-    ret = ovsa_license_service_get_string_length(sql, &sqllen);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of sql %d\n", ret);
+/* Re-reads the usage count of the license once the consumed usages are in the DB, so that a
+ * usage count provisioned again is picked up. Only the change of the DB since the last flush is
+ * added to remaining, atomically, so the usages consumed meanwhile are kept. */
+static ovsa_status_t ovsa_db_usage_reseed_entry(const char* db_name, ovsa_usage_entry_t* entry) {
+    ovsa_status_t ret   = OVSA_OK;
+    sqlite3_stmt* stmt  = NULL;
+    int db_status       = 0;
+    int64_t usage_count = 0;
+
+    ret = ovsa_db_get_statement(db_name, OVSA_DB_STMT_LICENSE_USAGE, entry->license_guid,
+                                entry->model_guid, &stmt);
+    if (ret < OVSA_OK)
         goto end;
-    }
-
-    db_status = sqlite3_prepare_v2(db, sql, sqllen, &stmt, 0);
-    if (db_status == SQLITE_OK) {
-        int idx = sqlite3_bind_parameter_index(stmt, "@license_guid");
-        ret     = ovsa_license_service_get_string_length(license_guid, &licguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of license_guid %d\n", ret);
-            goto end;
-        }
-        sqlite3_bind_text(stmt, idx, license_guid, licguid_len, SQLITE_STATIC);
 
-        idx = sqlite3_bind_parameter_index(stmt, "@model_guid");
-        ret = ovsa_license_service_get_string_length(model_guid, &modelguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of modelguid_len %d\n", ret);
-            goto end;
-        }
-        sqlite3_bind_text(stmt, idx, model_guid, modelguid_len, SQLITE_STATIC);
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
+    db_status = sqlite3_step(stmt);
+    if (db_status == SQLITE_ROW) {
+        usage_count = sqlite3_column_int64(stmt, 2);
+    } else if (db_status != SQLITE_DONE) {
+        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                 sqlite3_errmsg(g_thread_db_conn.db));
         ret = OVSA_DB_QUERY_FAIL;
         goto end;
     }
+    /* A license removed from the DB has no usages left */
+    if (usage_count != entry->seeded) {
+        __atomic_add_fetch(&entry->remaining, usage_count - entry->seeded, __ATOMIC_ACQ_REL);
+        entry->seeded = usage_count;
+    }
 
-    db_status = sqlite3_step(stmt);
-    if (db_status == SQLITE_ROW) {
-        /* success */
-        size_t bloblen = 0;
-        ret = ovsa_license_service_get_string_length(sqlite3_column_text(stmt, 1), &bloblen);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of customer license blob %d\n", ret);
-            goto end;
+end:
+    ovsa_db_release_statement(stmt);
+    return ret;
+}
+
+/* Writes the consumed usages of all licenses in one transaction and seeds the ledger again
+ * from the DB. On failure the usages are kept for the next flush. Must be called with
+ * flush_lock held. */
+static ovsa_status_t ovsa_db_usage_flush(const char* db_name) {
+    ovsa_status_t ret         = OVSA_OK;
+    ovsa_usage_entry_t* entry = NULL;
+    size_t bucket = 0, flushed = 0;
+    bool in_transaction = false;
+    struct timespec flush_start;
+
+    ret = ovsa_db_open_connection(db_name);
+    if (ret < OVSA_OK)
+        return ret;
+
+    ovsa_license_service_metrics_stage_start(&flush_start);
+
+    pthread_rwlock_rdlock(&g_usage_ledger.lock);
+    for (bucket = 0; bucket < USAGE_LEDGER_BUCKETS; bucket++) {
+        for (entry = g_usage_ledger.buckets[bucket]; entry != NULL; entry = entry->next) {
+            entry->flushing =
+                entry->seeded - __atomic_load_n(&entry->remaining, __ATOMIC_ACQUIRE);
+            if (entry->flushing == 0)
+                continue;
+            if (!in_transaction) {
+                if (sqlite3_exec(g_thread_db_conn.db, "begin immediate;", NULL, NULL, NULL) !=
+                    SQLITE_OK) {
+                    OVSA_DBG(DBG_E, "OVSA: Error failed to begin transaction: %s\n",
+                             sqlite3_errmsg(g_thread_db_conn.db));
+                    ret = OVSA_DB_UPDATE_FAIL;
+                    goto out;
+                }
+                in_transaction = true;
+            }
+            ret = ovsa_db_usage_flush_entry(db_name, entry);
+            if (ret < OVSA_OK)
+                goto out;
+            flushed++;
         }
-        if ((!bloblen) || (bloblen > SIZE_MAX)) {
-            OVSA_DBG(DBG_E, "OVSA: Error customer license blob length is invalid \n");
-            ret = OVSA_INVALID_PARAMETER;
-            goto end;
+    }
+    if (in_transaction &&
+        (sqlite3_exec(g_thread_db_conn.db, "commit;", NULL, NULL, NULL) != SQLITE_OK)) {
+        OVSA_DBG(DBG_E, "OVSA: Error failed to commit transaction: %s\n",
+                 sqlite3_errmsg(g_thread_db_conn.db));
+        ret = OVSA_DB_UPDATE_FAIL;
+        goto out;
+    }
+    if (flushed > 0) {
+        OVSA_DBG(DBG_D, "OVSA: Usage count of %zu licenses updated successfully\n", flushed);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_DB_USAGE_FLUSH, &flush_start);
+    }
+    for (bucket = 0; bucket < USAGE_LEDGER_BUCKETS; bucket++) {
+        for (entry = g_usage_ledger.buckets[bucket]; entry != NULL; entry = entry->next) {
+            entry->seeded -= entry->flushing;
+            if (ovsa_db_usage_reseed_entry(db_name, entry) < OVSA_OK)
+                OVSA_DBG(DBG_E, "OVSA: Error re-reading usage count of license %s failed\n",
+                         entry->license_guid);
         }
-        ret = ovsa_license_service_safe_malloc(sizeof(char) * (bloblen + 1), customer_license_blob);
-        if (ret < OVSA_OK) {
-            sqlite3_finalize(stmt);
-            OVSA_DBG(DBG_E,
-                     "OVSA: Error allocating memory for customer license blob buffer failed with "
-                     "code %d\n",
-                     ret);
-            ret = OVSA_MEMORY_ALLOC_FAIL;
-            goto end;
+    }
+
+out:
+    if (ret < OVSA_OK && in_transaction)
+        sqlite3_exec(g_thread_db_conn.db, "rollback;", NULL, NULL, NULL);
+    for (bucket = 0; bucket < USAGE_LEDGER_BUCKETS; bucket++) {
+        for (entry = g_usage_ledger.buckets[bucket]; entry != NULL; entry = entry->next)
+            entry->flushing = 0;
+    }
+    pthread_rwlock_unlock(&g_usage_ledger.lock);
+    return ret;
+}
+
+static void* ovsa_db_usage_flush_thread(void* data) {
+    struct timespec deadline;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    pthread_mutex_lock(&g_usage_ledger.flush_lock);
+    for (;;) {
+        if (g_usage_ledger.shutdown) {
+            ovsa_db_usage_flush(g_usage_ledger.db_name);
+            break;
+        }
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += USAGE_FLUSH_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (USAGE_FLUSH_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
         }
-        sprintf(*customer_license_blob, "%s", sqlite3_column_text(stmt, 1));
-        ret = sqlite3_column_int(stmt, 0);
+        pthread_cond_timedwait(&g_usage_ledger.flush_cond, &g_usage_ledger.flush_lock,
+                               &deadline);
+        ovsa_db_usage_flush(g_usage_ledger.db_name);
+    }
+    pthread_mutex_unlock(&g_usage_ledger.flush_lock);
 
-        OVSA_DBG(DBG_D, "OVSA: ROWID %s: \n", sqlite3_column_text(stmt, 0));
-        OVSA_DBG(DBG_D, "OVSA: Customer License Blob %s\n", sqlite3_column_text(stmt, 1));
-        OVSA_DBG(DBG_I, "OVSA: Customer License Blob extracted from DB successfully\n");
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-        ret = OVSA_DB_UPDATE_FAIL;
+    ovsa_db_close_connection();
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return NULL;
+}
+
+ovsa_status_t ovsa_db_usage_ledger_start(const char* db_name) {
+    ovsa_status_t ret = OVSA_OK;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    /* The usages are consumed in the shared store, in-memory counters would diverge per node */
+    if (g_db_cluster) {
+        OVSA_DBG(DBG_I, "OVSA: Usage ledger not started in DB cluster mode\n");
+        goto end;
+    }
+    g_usage_ledger.db_name  = db_name;
+    g_usage_ledger.shutdown = false;
+    if (pthread_create(&g_usage_ledger.flush_tid, NULL, ovsa_db_usage_flush_thread, NULL) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error creating usage flush thread failed\n");
+        ret = OVSA_THREAD_CREATE_FAIL;
         goto end;
     }
-    sqlite3_finalize(stmt);
+    g_usage_ledger.started = true;
 
 end:
-    if (db)
-        sqlite3_close(db);
-
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
+void ovsa_db_usage_ledger_stop(void) {
+    ovsa_usage_entry_t* entry = NULL;
+    size_t bucket             = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if (g_usage_ledger.started) {
+        /* The flush thread writes the remaining usages before it exits */
+        pthread_mutex_lock(&g_usage_ledger.flush_lock);
+        g_usage_ledger.shutdown = true;
+        pthread_cond_signal(&g_usage_ledger.flush_cond);
+        pthread_mutex_unlock(&g_usage_ledger.flush_lock);
+        pthread_join(g_usage_ledger.flush_tid, NULL);
+        g_usage_ledger.started = false;
+    }
+
+    pthread_rwlock_wrlock(&g_usage_ledger.lock);
+    for (bucket = 0; bucket < USAGE_LEDGER_BUCKETS; bucket++) {
+        while (g_usage_ledger.buckets[bucket] != NULL) {
+            entry                          = g_usage_ledger.buckets[bucket];
+            g_usage_ledger.buckets[bucket] = entry->next;
+            if (entry->seeded != entry->remaining)
+                OVSA_DBG(DBG_E, "OVSA: Error %ld usages of license %s were not written to DB\n",
+                         (long)(entry->seeded - entry->remaining), entry->license_guid);
+            ovsa_license_service_safe_free((char**)&entry);
+        }
+    }
+    pthread_rwlock_unlock(&g_usage_ledger.lock);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+}
+
 ovsa_status_t ovsa_db_validate_license_usage(const char* db_name, const char* license_guid,
                                              const char* model_guid) {
-    int ret       = 0;
-    int db_status = 0;
-    size_t sqllen = 0, licguid_len = 0, modelguid_len = 0;
-    char sql[SQL_BUFFER_LENGTH];
-
-    sqlite3* db        = NULL;
+    int ret            = 0;
+    int db_status      = 0;
     sqlite3_stmt* stmt = NULL;
+    cJSON* result      = NULL;
+    cJSON* row         = NULL;
 
-    int license_type = 0;
+    int row_id                = 0;
+    int license_type          = 0;
+    int usage_count           = 0;
+    const char* time_limit    = NULL;
+    int64_t rows_affected     = 0;
+    ovsa_usage_entry_t* entry = NULL;
+    struct timespec query_start;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    memset_s(sql, sizeof(sql), 0);
-    /* open the database */
-    db_status = sqlite3_open(db_name, &db);
-    if (db_status) {
-        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB open failed in validating license %s \n",
-                 sqlite3_errmsg(db));
-        ret = OVSA_DB_INIT_FAIL;
-        goto end;
-    } else {
-        OVSA_DBG(DBG_I, "OVSA: OVSA DB open successful\n");
-    }
 
-    sprintf(sql,
-            "select customer_license_id, license_type, usage_count, time_limit "
-            "from customer_license_info where license_guid = @license_guid and "
-            "model_guid = "
-            "@model_guid;");
-    OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
-
-    ret = ovsa_license_service_get_string_length(sql, &sqllen);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of sql %d\n", ret);
-        goto end;
-    }
-    db_status = sqlite3_prepare_v2(db, sql, sqllen, &stmt, 0);
-    if (db_status == SQLITE_OK) {
-        int idx = sqlite3_bind_parameter_index(stmt, "@license_guid");
-        ret     = ovsa_license_service_get_string_length(license_guid, &licguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of license_guid %d\n", ret);
+    ovsa_license_service_metrics_stage_start(&query_start);
+    if (g_db_cluster) {
+        ret = ovsa_db_cluster_query(g_db_sql[OVSA_DB_STMT_LICENSE_USAGE], license_guid,
+                                    model_guid, &result, &row);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_DB_QUERY, &query_start);
+        if (ret < OVSA_OK)
             goto end;
-        }
-        sqlite3_bind_text(stmt, idx, license_guid, licguid_len, SQLITE_STATIC);
-
-        idx = sqlite3_bind_parameter_index(stmt, "@model_guid");
-        ret = ovsa_license_service_get_string_length(model_guid, &modelguid_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of modelguid_len %d\n", ret);
+        row_id       = (int)ovsa_db_cluster_get_int(row, 0);
+        license_type = (int)ovsa_db_cluster_get_int(row, 1);
+        usage_count  = (int)ovsa_db_cluster_get_int(row, 2);
+        time_limit   = ovsa_db_cluster_get_text(row, 3);
+        db_status    = SQLITE_ROW;
+    } else {
+        ret = ovsa_db_get_statement(db_name, OVSA_DB_STMT_LICENSE_USAGE, license_guid,
+                                    model_guid, &stmt);
+        if (ret < OVSA_OK)
             goto end;
+
+        db_status = sqlite3_step(stmt);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_DB_QUERY, &query_start);
+        if (db_status == SQLITE_ROW) {
+            row_id       = sqlite3_column_int(stmt, 0);
+            license_type = sqlite3_column_int(stmt, 1);
+            usage_count  = sqlite3_column_int(stmt, 2);
+            time_limit   = (const char*)sqlite3_column_text(stmt, 3);
         }
-        sqlite3_bind_text(stmt, idx, model_guid, modelguid_len, SQLITE_STATIC);
-    } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-        ret = OVSA_DB_QUERY_FAIL;
-        goto end;
     }
-
-    db_status = sqlite3_step(stmt);
     if (db_status == SQLITE_ROW) {
         /* success */
-        OVSA_DBG(DBG_I, "OVSA:%s: ", sqlite3_column_text(stmt, 0));
+        OVSA_DBG(DBG_I, "OVSA:%d: ", row_id);
 
-        OVSA_DBG(DBG_I, "OVSA:license type - %d ", atoi(sqlite3_column_text(stmt, 1)));
-        OVSA_DBG(DBG_I, "OVSA:usage count - %s ", sqlite3_column_text(stmt, 2));
-        OVSA_DBG(DBG_I, "OVSA:time limit - %s\n", sqlite3_column_text(stmt, 3));
-
-        license_type           = sqlite3_column_int(stmt, 1);
-        int usage_count        = sqlite3_column_int(stmt, 2);
-        const char* time_limit = sqlite3_column_text(stmt, 3);
+        OVSA_DBG(DBG_I, "OVSA:license type - %d ", license_type);
+        OVSA_DBG(DBG_I, "OVSA:usage count - %d ", usage_count);
+        OVSA_DBG(DBG_I, "OVSA:time limit - %s\n", time_limit ? time_limit : "");
 
         if (license_type == 0) {
             ret = OVSA_OK;
-        } else if (license_type == 1) {
-            if (usage_count > 0) {
-                ret = OVSA_OK;
-            } else {
-                sqlite3_finalize(stmt);
-                stmt = NULL;
-
+        } else if ((license_type == 1) && g_db_cluster) {
+            /* Serialized by the store, so the nodes never consume more than usage_count */
+            ret = ovsa_db_cluster_execute(g_db_sql[OVSA_DB_STMT_CONSUME_USAGE], license_guid,
+                                          model_guid, &rows_affected);
+            if (ret < OVSA_OK)
+                goto end;
+            if (rows_affected != 1) {
+                OVSA_DBG(DBG_E, "OVSA: Error usage exceeded, license validation failed\n");
                 ret = OVSA_DB_USAGELIMIT_FAIL;
+                goto end;
+            }
+        } else if (license_type == 1) {
+            ret = ovsa_db_usage_get_entry(license_guid, model_guid, usage_count, &entry);
+            if (ret < OVSA_OK)
+                goto end;
+            ret = ovsa_db_usage_consume(entry);
+            if (ret < OVSA_OK) {
                 OVSA_DBG(DBG_E, "OVSA: Error usage exceeded, license validation failed\n");
                 goto end;
             }
+
         } else if (license_type == 2) {
             time_t t;
             time(&t);
@@ -445,7 +759,12 @@ ovsa_status_t ovsa_db_validate_license_usage(const char* db_name, const char* li
                 goto end;
             }
 
-            strptime(time_limit, "%Y-%m-%d %H:%M:%S", tm);
+            if ((time_limit == NULL) ||
+                (strptime(time_limit, "%Y-%m-%d %H:%M:%S", tm) == NULL)) {
+                OVSA_DBG(DBG_E, "OVSA: Error time limit of the license is invalid\n");
+                ret = OVSA_DB_TIMELIMT_FAIL;
+                goto end;
+            }
             OVSA_DBG(DBG_I, "OVSA:from tm structure - %d-%02d-%02d %02d:%02d:%02d\n",
                      tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min,
                      tm->tm_sec);
@@ -457,80 +776,27 @@ ovsa_status_t ovsa_db_validate_license_usage(const char* db_name, const char* li
             if (diff > 0) {
                 ret = OVSA_OK;
             } else {
-                sqlite3_finalize(stmt);
-                stmt = NULL;
-
                 ret = OVSA_DB_TIMELIMT_FAIL;
                 OVSA_DBG(DBG_E, "OVSA: Error time exceeded, license validation failed\n");
                 goto end;
             }
         }
     } else {
-        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
+        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                 sqlite3_errmsg(g_thread_db_conn.db));
         ret = OVSA_DB_UPDATE_FAIL;
         goto end;
     }
 
-    if (stmt != NULL) {
-        sqlite3_finalize(stmt);
-        stmt = NULL;
-    }
-
-    if (license_type == 1 && ret == OVSA_OK) {
-        sprintf(sql,
-                "update customer_license_info set usage_count = usage_count - 1 "
-                "where license_guid = @license_guid and model_guid = @model_guid;");
-        OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
-        ret = ovsa_license_service_get_string_length(sql, &sqllen);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of sql %d\n", ret);
-            goto end;
-        }
-        db_status = sqlite3_prepare_v2(db, sql, sqllen, &stmt, 0);
-        if (db_status == SQLITE_OK) {
-            int idx = sqlite3_bind_parameter_index(stmt, "@license_guid");
-            ret     = ovsa_license_service_get_string_length(license_guid, &licguid_len);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error could not get length of license_guid %d\n", ret);
-                goto end;
-            }
-            sqlite3_bind_text(stmt, idx, license_guid, licguid_len, SQLITE_STATIC);
-
-            idx = sqlite3_bind_parameter_index(stmt, "@model_guid");
-            ret = ovsa_license_service_get_string_length(model_guid, &modelguid_len);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error could not get length of modelguid_len %d\n", ret);
-                goto end;
-            }
-            sqlite3_bind_text(stmt, idx, model_guid, modelguid_len, SQLITE_STATIC);
-        } else {
-            OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-            ret = OVSA_DB_QUERY_FAIL;
-            goto end;
-        }
-
-        db_status = sqlite3_step(stmt);
-        if (db_status != SQLITE_DONE) {
-            OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n", sqlite3_errmsg(db));
-            ret = OVSA_DB_UPDATE_FAIL;
-            goto end;
-        } else {
-            OVSA_DBG(DBG_D, "OVSA: Usage count incremented successfully\n");
-        }
-
-        if (stmt != NULL) {
-            sqlite3_finalize(stmt);
-            stmt = NULL;
-        }
-    }
-
 end:
-
-    if (stmt != NULL)
-        sqlite3_finalize(stmt);
-
-    if (db)
-        sqlite3_close(db);
+    ovsa_db_release_statement(stmt);
+    cJSON_Delete(result);
+    /* Without the flush thread the usage is written right away */
+    if ((entry != NULL) && (ret == OVSA_OK) && !g_usage_ledger.started) {
+        pthread_mutex_lock(&g_usage_ledger.flush_lock);
+        ovsa_db_usage_flush(db_name);
+        pthread_mutex_unlock(&g_usage_ledger.flush_lock);
+    }
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
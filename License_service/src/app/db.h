@@ -19,10 +19,75 @@
 
 #include "license_service.h"
 
-#define SQL_BUFFER_LENGTH 1024
-#define OVSA_DB_PATH      "/opt/ovsa/DB/ovsa.db"
+#define OVSA_DB_PATH       "/opt/ovsa/DB/ovsa.db"
+#define DB_BUSY_TIMEOUT_MS 5000
+
+/* Usage ledger of the InstanceLimit licenses */
+#define USAGE_LEDGER_BUCKETS    1024
+#define USAGE_FLUSH_INTERVAL_MS 1000
 
 /* API's */
+/*!
+ * \brief ovsa_db_init switches the database to WAL journal mode. To be called once
+ * before the worker threads access the database
+ *
+ * \param [in]  db_name buffer pointing to the database name
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_init(const char* db_name);
+
+/*!
+ * \brief ovsa_db_init_cluster switches the queries below from the sqlite file to the store
+ * shared by the nodes of a cluster, see db_cluster.h. The db_name arguments are ignored
+ * from then on. To be called once instead of ovsa_db_init()
+ *
+ * \param [in]  db_url buffer pointing to the URL of the store
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_init_cluster(const char* db_url);
+
+/*!
+ * \brief ovsa_db_open_connection opens the database connection of the calling thread.
+ * The connection and its prepared statements are reused by the queries below
+ *
+ * \param [in]  db_name buffer pointing to the database name
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_open_connection(const char* db_name);
+
+/*!
+ * \brief ovsa_db_close_connection closes the database connection of the calling thread
+ *
+ * \return void
+ */
+
+void ovsa_db_close_connection(void);
+
+/*!
+ * \brief ovsa_db_usage_ledger_start starts the thread writing the usages consumed by
+ * ovsa_db_validate_license_usage() to the database every USAGE_FLUSH_INTERVAL_MS. The
+ * in-memory counters are seeded from usage_count on the first check of a license and are
+ * authoritative afterwards. In cluster mode the usages are consumed in the store right away
+ * and no thread is started
+ *
+ * \param [in]  db_name buffer pointing to the database name
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_usage_ledger_start(const char* db_name);
+
+/*!
+ * \brief ovsa_db_usage_ledger_stop writes the pending usages to the database and stops the
+ * flush thread. To be called after the worker threads are stopped
+ *
+ * \return void
+ */
+
+void ovsa_db_usage_ledger_stop(void);
+
 /*!
  * \brief ovsa_db_get_customer_primary_certificate
  *
@@ -67,7 +132,8 @@ ovsa_status_t ovsa_db_get_customer_license_blob(const char* db_name, const char*
                                                 const char* model_guid,
                                                 char** customer_license_blob);
 /*!
- * \brief ovsa_db_validate_license_usage
+ * \brief ovsa_db_validate_license_usage checks the license limits and consumes one usage of
+ * an InstanceLimit license
  *
  * \param [in]  db_name buffer pointing to the database name
  * \param [in]  license_guid buffer pointing to the license guid
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <curl/curl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+/* db_cluster.h to be included at end due to dependencies */
+#include "db_cluster.h"
+
+#define DB_CLUSTER_QUERY_PATH   "/db/query"
+#define DB_CLUSTER_EXECUTE_PATH "/db/execute"
+#define DB_CLUSTER_STATUS_PATH  "/status"
+
+typedef struct ovsa_db_cluster_response {
+    char* data;
+    size_t len;
+} ovsa_db_cluster_response_t;
+
+typedef struct ovsa_db_cluster_conn {
+    CURL* curl;
+    struct curl_slist* headers;
+} ovsa_db_cluster_conn_t;
+
+static char g_db_cluster_url[MAX_URL_SIZE];
+
+/* Each worker thread owns one HTTP connection to the store, kept alive across the checks */
+static __thread ovsa_db_cluster_conn_t g_thread_db_cluster_conn;
+
+static size_t ovsa_db_cluster_write_callback(void* data, size_t size, size_t num_items,
+                                             void* user_data) {
+    ovsa_db_cluster_response_t* response = (ovsa_db_cluster_response_t*)user_data;
+    size_t len                           = size * num_items;
+    char* buf                            = NULL;
+
+    if (response->len + len > DB_CLUSTER_MAX_RESPONSE) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster response exceeds %d bytes\n",
+                 DB_CLUSTER_MAX_RESPONSE);
+        return 0;
+    }
+    buf = realloc(response->data, response->len + len + NULL_TERMINATOR);
+    if (buf == NULL)
+        return 0;
+    memcpy_s(buf + response->len, len + NULL_TERMINATOR, data, len);
+    response->data                = buf;
+    response->len                 = response->len + len;
+    response->data[response->len] = '\0';
+    return len;
+}
+
+ovsa_status_t ovsa_db_cluster_open_connection(void) {
+    ovsa_db_cluster_conn_t* conn = &g_thread_db_cluster_conn;
+
+    if (conn->curl != NULL)
+        return OVSA_OK;
+
+    conn->curl = curl_easy_init();
+    if (conn->curl == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing DB cluster connection failed\n");
+        return OVSA_DB_INIT_FAIL;
+    }
+    conn->headers = curl_slist_append(NULL, "Content-Type: application/json");
+    if (conn->headers == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing DB cluster connection failed\n");
+        curl_easy_cleanup(conn->curl);
+        conn->curl = NULL;
+        return OVSA_DB_INIT_FAIL;
+    }
+    curl_easy_setopt(conn->curl, CURLOPT_HTTPHEADER, conn->headers);
+    curl_easy_setopt(conn->curl, CURLOPT_WRITEFUNCTION, ovsa_db_cluster_write_callback);
+    curl_easy_setopt(conn->curl, CURLOPT_TIMEOUT_MS, (long)DB_BUSY_TIMEOUT_MS);
+    curl_easy_setopt(conn->curl, CURLOPT_NOSIGNAL, 1L);
+    /* A follower redirects the writes to the leader of the store, with the same body */
+    curl_easy_setopt(conn->curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(conn->curl, CURLOPT_POSTREDIR, (long)CURL_REDIR_POST_ALL);
+#if LIBCURL_VERSION_NUM >= 0x075500
+    curl_easy_setopt(conn->curl, CURLOPT_PROTOCOLS_STR, "http,https");
+    curl_easy_setopt(conn->curl, CURLOPT_REDIR_PROTOCOLS_STR, "http,https");
+#else
+    curl_easy_setopt(conn->curl, CURLOPT_PROTOCOLS, (long)(CURLPROTO_HTTP | CURLPROTO_HTTPS));
+    curl_easy_setopt(conn->curl, CURLOPT_REDIR_PROTOCOLS,
+                     (long)(CURLPROTO_HTTP | CURLPROTO_HTTPS));
+#endif
+    return OVSA_OK;
+}
+
+void ovsa_db_cluster_close_connection(void) {
+    ovsa_db_cluster_conn_t* conn = &g_thread_db_cluster_conn;
+
+    if (conn->curl != NULL) {
+        curl_easy_cleanup(conn->curl);
+        conn->curl = NULL;
+    }
+    if (conn->headers != NULL) {
+        curl_slist_free_all(conn->headers);
+        conn->headers = NULL;
+    }
+}
+
+/* Sends body to path of the store, data of the response is to be freed by the caller */
+static ovsa_status_t ovsa_db_cluster_request(const char* path, const char* body,
+                                             ovsa_db_cluster_response_t* response) {
+    ovsa_status_t ret = OVSA_OK;
+    CURLcode res      = CURLE_OK;
+    long http_code    = 0;
+    char url[MAX_URL_SIZE];
+    CURL* curl = NULL;
+
+    ret = ovsa_db_cluster_open_connection();
+    if (ret < OVSA_OK)
+        return ret;
+    curl = g_thread_db_cluster_conn.curl;
+
+    if (snprintf(url, sizeof(url), "%s%s", g_db_cluster_url, path) >= (int)sizeof(url)) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster URL is too long\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)response);
+    if (body != NULL) {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    }
+
+    res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster request failed: %s\n", curl_easy_strerror(res));
+        ret = OVSA_DB_QUERY_FAIL;
+        goto end;
+    }
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code != 200) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster request failed with HTTP status %ld\n",
+                 http_code);
+        ret = OVSA_DB_QUERY_FAIL;
+        goto end;
+    }
+    if (response->data == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster response is empty\n");
+        ret = OVSA_DB_QUERY_FAIL;
+    }
+
+end:
+    if (ret < OVSA_OK) {
+        free(response->data);
+        response->data = NULL;
+        response->len  = 0;
+    }
+    return ret;
+}
+
+/* Runs one parameterized statement and returns the parsed response with its single result */
+static ovsa_status_t ovsa_db_cluster_statement(const char* path, const char* sql,
+                                               const char* license_guid, const char* model_guid,
+                                               cJSON** result, cJSON** statement_result) {
+    ovsa_status_t ret                   = OVSA_OK;
+    ovsa_db_cluster_response_t response = {NULL, 0};
+    cJSON* request                      = NULL;
+    cJSON* statement                    = NULL;
+    cJSON* params                       = NULL;
+    cJSON* error                        = NULL;
+    char* body                          = NULL;
+
+    *result = NULL;
+
+    /* [["sql", {"license_guid": "...", "model_guid": "..."}]] */
+    request   = cJSON_CreateArray();
+    statement = cJSON_CreateArray();
+    params    = cJSON_CreateObject();
+    if ((request == NULL) || (statement == NULL) || (params == NULL)) {
+        cJSON_Delete(statement);
+        cJSON_Delete(params);
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        goto end;
+    }
+    cJSON_AddItemToArray(request, statement);
+    cJSON_AddItemToArray(statement, cJSON_CreateString(sql));
+    cJSON_AddItemToArray(statement, params);
+    if ((cJSON_AddStringToObject(params, "license_guid", license_guid) == NULL) ||
+        (cJSON_AddStringToObject(params, "model_guid", model_guid) == NULL)) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        goto end;
+    }
+    body = cJSON_PrintUnformatted(request);
+    if (body == NULL) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        goto end;
+    }
+    OVSA_DBG(DBG_D, "OVSA: SQL: %s\n", sql);
+
+    ret = ovsa_db_cluster_request(path, body, &response);
+    if (ret < OVSA_OK)
+        goto end;
+
+    *result = cJSON_Parse(response.data);
+    if (*result == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error parsing DB cluster response failed\n");
+        ret = OVSA_DB_QUERY_FAIL;
+        goto end;
+    }
+    *statement_result =
+        cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(*result, "results"), 0);
+    if (!cJSON_IsObject(*statement_result)) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster response has no result\n");
+        ret = OVSA_DB_QUERY_FAIL;
+        goto end;
+    }
+    error = cJSON_GetObjectItemCaseSensitive(*statement_result, "error");
+    if (error != NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error failed to execute statement: %s\n",
+                 cJSON_IsString(error) ? error->valuestring : "unknown");
+        ret = OVSA_DB_QUERY_FAIL;
+    }
+
+end:
+    if (ret == OVSA_JSON_ERROR_CREATE_OBJECT)
+        OVSA_DBG(DBG_E, "OVSA: Error creating DB cluster request failed\n");
+    if ((ret < OVSA_OK) && (*result != NULL)) {
+        cJSON_Delete(*result);
+        *result = NULL;
+    }
+    cJSON_free(body);
+    cJSON_Delete(request);
+    free(response.data);
+    return ret;
+}
+
+ovsa_status_t ovsa_db_cluster_query(const char* sql, const char* license_guid,
+                                    const char* model_guid, cJSON** result, cJSON** row) {
+    ovsa_status_t ret       = OVSA_OK;
+    cJSON* statement_result = NULL;
+
+    ret = ovsa_db_cluster_statement(DB_CLUSTER_QUERY_PATH, sql, license_guid, model_guid, result,
+                                    &statement_result);
+    if (ret < OVSA_OK)
+        return ret;
+
+    *row = cJSON_GetArrayItem(cJSON_GetObjectItemCaseSensitive(statement_result, "values"), 0);
+    if (!cJSON_IsArray(*row)) {
+        OVSA_DBG(DBG_E, "OVSA: Error license not found in DB cluster\n");
+        cJSON_Delete(*result);
+        *result = NULL;
+        *row    = NULL;
+        return OVSA_DB_UPDATE_FAIL;
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_db_cluster_execute(const char* sql, const char* license_guid,
+                                      const char* model_guid, int64_t* rows_affected) {
+    ovsa_status_t ret       = OVSA_OK;
+    cJSON* result           = NULL;
+    cJSON* statement_result = NULL;
+    cJSON* rows             = NULL;
+
+    *rows_affected = 0;
+    ret = ovsa_db_cluster_statement(DB_CLUSTER_EXECUTE_PATH, sql, license_guid, model_guid,
+                                    &result, &statement_result);
+    if (ret < OVSA_OK)
+        return OVSA_DB_UPDATE_FAIL;
+
+    /* Left out of the result when no row is changed */
+    rows = cJSON_GetObjectItemCaseSensitive(statement_result, "rows_affected");
+    if (cJSON_IsNumber(rows))
+        *rows_affected = (int64_t)rows->valuedouble;
+    cJSON_Delete(result);
+    return ret;
+}
+
+int64_t ovsa_db_cluster_get_int(const cJSON* row, int column) {
+    const cJSON* item = cJSON_GetArrayItem(row, column);
+
+    if (cJSON_IsNumber(item))
+        return (int64_t)item->valuedouble;
+    /* Columns declared without a numeric type come back as text */
+    if (cJSON_IsString(item))
+        return strtoll(item->valuestring, NULL, 10);
+    return 0;
+}
+
+const char* ovsa_db_cluster_get_text(const cJSON* row, int column) {
+    const cJSON* item = cJSON_GetArrayItem(row, column);
+
+    return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+ovsa_status_t ovsa_db_cluster_init(const char* db_url) {
+    ovsa_status_t ret                   = OVSA_OK;
+    ovsa_db_cluster_response_t response = {NULL, 0};
+    size_t len                          = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if ((strncmp(db_url, "http://", strlen("http://")) != 0) &&
+        (strncmp(db_url, "https://", strlen("https://")) != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster URL must be http:// or https://\n");
+        ret = OVSA_DB_INIT_FAIL;
+        goto end;
+    }
+    if (strcpy_s(g_db_cluster_url, sizeof(g_db_cluster_url), db_url) != EOK) {
+        OVSA_DBG(DBG_E, "OVSA: Error DB cluster URL is too long\n");
+        ret = OVSA_DB_INIT_FAIL;
+        goto end;
+    }
+    len = strnlen_s(g_db_cluster_url, sizeof(g_db_cluster_url));
+    while ((len > 0) && (g_db_cluster_url[len - 1] == '/'))
+        g_db_cluster_url[--len] = '\0';
+
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing curl failed\n");
+        ret = OVSA_DB_INIT_FAIL;
+        goto end;
+    }
+    ret = ovsa_db_cluster_request(DB_CLUSTER_STATUS_PATH, NULL, &response);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error OVSA DB cluster is not reachable\n");
+        ret = OVSA_DB_INIT_FAIL;
+        goto end;
+    }
+    OVSA_DBG(DBG_I, "OVSA: OVSA DB cluster mode, store reachable\n");
+
+end:
+    free(response.data);
+    ovsa_db_cluster_close_connection();
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __OVSA_DB_CLUSTER_H_
+#define __OVSA_DB_CLUSTER_H_
+
+#include <stdint.h>
+
+#include "cJSON.h"
+#include "license_service.h"
+
+/* Largest response accepted from the cluster store, a license blob fits many times over */
+#define DB_CLUSTER_MAX_RESPONSE (16 * 1024 * 1024)
+
+/*
+ * Storage backend of the License Service cluster mode. The nodes share an rqlite store, which
+ * replicates the sqlite schema of OVSA_DB_PATH over Raft, through its HTTP API. The statements
+ * are the ones of db.c, with the license and model GUIDs passed as the named parameters
+ * @license_guid and @model_guid.
+ */
+
+/* API's */
+/*!
+ * \brief ovsa_db_cluster_init checks that the cluster store answers at db_url. To be
+ * called once before the worker threads access the store
+ *
+ * \param [in]  db_url buffer pointing to the URL of the store, http(s)://[user:password@]host:port
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_cluster_init(const char* db_url);
+
+/*!
+ * \brief ovsa_db_cluster_open_connection sets up the HTTP connection of the calling thread,
+ * which is kept alive across the statements below
+ *
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_cluster_open_connection(void);
+
+/*!
+ * \brief ovsa_db_cluster_close_connection closes the HTTP connection of the calling thread
+ *
+ * \return void
+ */
+
+void ovsa_db_cluster_close_connection(void);
+
+/*!
+ * \brief ovsa_db_cluster_query runs a select statement for the license and returns its
+ * first row
+ *
+ * \param [in]  sql buffer pointing to the statement
+ * \param [in]  license_guid buffer pointing to the license guid
+ * \param [in]  model_guid buffer pointing to the model guid
+ * \param [out] result response of the store, to be freed with cJSON_Delete()
+ * \param [out] row array of the column values of the first row, owned by result
+ * \return ovsa_status_t, OVSA_DB_UPDATE_FAIL when there is no row
+ */
+
+ovsa_status_t ovsa_db_cluster_query(const char* sql, const char* license_guid,
+                                    const char* model_guid, cJSON** result, cJSON** row);
+
+/*!
+ * \brief ovsa_db_cluster_execute runs a write statement for the license. The store applies
+ * it on the leader, so that concurrent statements of all the nodes are serialized
+ *
+ * \param [in]  sql buffer pointing to the statement
+ * \param [in]  license_guid buffer pointing to the license guid
+ * \param [in]  model_guid buffer pointing to the model guid
+ * \param [out] rows_affected number of rows changed by the statement
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_db_cluster_execute(const char* sql, const char* license_guid,
+                                      const char* model_guid, int64_t* rows_affected);
+
+/*!
+ * \brief ovsa_db_cluster_get_int returns a column of a row as integer
+ *
+ * \param [in]  row array of the column values
+ * \param [in]  column index of the column
+ * \return value of the column, 0 when it is not a number
+ */
+
+int64_t ovsa_db_cluster_get_int(const cJSON* row, int column);
+
+/*!
+ * \brief ovsa_db_cluster_get_text returns a column of a row as text
+ *
+ * \param [in]  row array of the column values
+ * \param [in]  column index of the column
+ * \return value of the column owned by row, NULL when it is not a string
+ */
+
+const char* ovsa_db_cluster_get_text(const cJSON* row, int column);
+
+#endif
@@ -454,11 +454,382 @@ end:
     return ret;
 }
 
+/* Nesting of objects and arrays accepted by the in-situ JSON reader */
+#define OVSA_JSON_MAX_DEPTH 32
+/* Returned by a reader callback to stop reading the rest of the object or array */
+#define OVSA_JSON_READ_STOP 1
+
+typedef enum {
+    OVSA_JSON_TYPE_NULL = 0,
+    OVSA_JSON_TYPE_BOOL,
+    OVSA_JSON_TYPE_NUMBER,
+    OVSA_JSON_TYPE_STRING,
+    OVSA_JSON_TYPE_OBJECT,
+    OVSA_JSON_TYPE_ARRAY
+} ovsa_json_type_t;
+
+/* JSON value in place in the buffer read, strings are without the quotes and still escaped */
+typedef struct ovsa_json_view {
+    ovsa_json_type_t type;
+    const char* data;
+    size_t len;
+} ovsa_json_view_t;
+
+typedef ovsa_status_t (*ovsa_json_member_cb_t)(void* ctx, const ovsa_json_view_t* key,
+                                               const ovsa_json_view_t* value);
+typedef ovsa_status_t (*ovsa_json_element_cb_t)(void* ctx, size_t index,
+                                                const ovsa_json_view_t* value);
+
+/*
+ * In-situ JSON reader. The members of an object and the elements of an array are read in one
+ * pass over the buffer and handed to a callback as views into the buffer, nothing is copied or
+ * allocated. Nested objects and arrays are handed over as a whole and read again by the callback
+ * if needed. Strings are handed over as they are in the buffer, without the quotes and with the
+ * escapes left in place, and are unescaped only when copied out.
+ */
+static const char* ovsa_json_reader_skip_space(const char* pos, const char* end) {
+    while ((pos < end) && ((*pos == ' ') || (*pos == '\t') || (*pos == '\n') || (*pos == '\r')))
+        pos++;
+    return pos;
+}
+
+static ovsa_status_t ovsa_json_reader_read_value(const char** cursor, const char* end, int depth,
+                                                 ovsa_json_view_t* value);
+
+static ovsa_status_t ovsa_json_reader_read_string(const char** cursor, const char* end,
+                                                  ovsa_json_view_t* value) {
+    const char* pos = *cursor + 1;
+
+    value->type = OVSA_JSON_TYPE_STRING;
+    value->data = pos;
+    while (pos < end) {
+        if (*pos == '"') {
+            value->len = pos - value->data;
+            *cursor    = pos + 1;
+            return OVSA_OK;
+        }
+        if ((unsigned char)*pos < 0x20)
+            break;
+        pos += (*pos == '\\') ? 2 : 1;
+    }
+    OVSA_DBG(DBG_E, "OVSA: Error unterminated json string\n");
+    return OVSA_JSON_PARSE_FAIL;
+}
+
+/* Reads the members or elements of an object or array, cursor is at its opening bracket */
+static ovsa_status_t ovsa_json_reader_read_container(const char** cursor, const char* end,
+                                                     int depth, ovsa_json_member_cb_t member_cb,
+                                                     ovsa_json_element_cb_t element_cb,
+                                                     void* ctx) {
+    ovsa_status_t ret    = OVSA_OK;
+    bool is_object       = (**cursor == '{');
+    char close           = is_object ? '}' : ']';
+    const char* pos      = *cursor + 1;
+    size_t index         = 0;
+    ovsa_json_view_t key = {OVSA_JSON_TYPE_STRING, NULL, 0};
+    ovsa_json_view_t value;
+
+    if (depth > OVSA_JSON_MAX_DEPTH) {
+        OVSA_DBG(DBG_E, "OVSA: Error json nesting exceeds %d levels\n", OVSA_JSON_MAX_DEPTH);
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    pos = ovsa_json_reader_skip_space(pos, end);
+    if ((pos < end) && (*pos == close)) {
+        *cursor = pos + 1;
+        return OVSA_OK;
+    }
+    while (pos < end) {
+        if (is_object) {
+            if (*pos != '"')
+                break;
+            ret = ovsa_json_reader_read_string(&pos, end, &key);
+            if (ret < OVSA_OK)
+                return ret;
+            pos = ovsa_json_reader_skip_space(pos, end);
+            if ((pos >= end) || (*pos != ':'))
+                break;
+            pos = ovsa_json_reader_skip_space(pos + 1, end);
+        }
+        ret = ovsa_json_reader_read_value(&pos, end, depth + 1, &value);
+        if (ret < OVSA_OK)
+            return ret;
+        if (is_object && (member_cb != NULL))
+            ret = member_cb(ctx, &key, &value);
+        else if (!is_object && (element_cb != NULL))
+            ret = element_cb(ctx, index, &value);
+        if (ret != OVSA_OK)
+            return ret;
+        index++;
+
+        pos = ovsa_json_reader_skip_space(pos, end);
+        if ((pos < end) && (*pos == close)) {
+            *cursor = pos + 1;
+            return OVSA_OK;
+        }
+        if ((pos >= end) || (*pos != ','))
+            break;
+        pos = ovsa_json_reader_skip_space(pos + 1, end);
+    }
+    OVSA_DBG(DBG_E, "OVSA: Error malformed json %s\n", is_object ? "object" : "array");
+    return OVSA_JSON_PARSE_FAIL;
+}
+
+static ovsa_status_t ovsa_json_reader_read_value(const char** cursor, const char* end, int depth,
+                                                 ovsa_json_view_t* value) {
+    ovsa_status_t ret = OVSA_OK;
+    const char* pos   = *cursor;
+
+    if (pos >= end)
+        return OVSA_JSON_PARSE_FAIL;
+    value->data = pos;
+    switch (*pos) {
+        case '"':
+            return ovsa_json_reader_read_string(cursor, end, value);
+        case '{':
+        case '[':
+            value->type = (*pos == '{') ? OVSA_JSON_TYPE_OBJECT : OVSA_JSON_TYPE_ARRAY;
+            ret         = ovsa_json_reader_read_container(&pos, end, depth, NULL, NULL, NULL);
+            if (ret < OVSA_OK)
+                return ret;
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+            value->type = (*pos == 'n') ? OVSA_JSON_TYPE_NULL : OVSA_JSON_TYPE_BOOL;
+            while ((pos < end) && (*pos >= 'a') && (*pos <= 'z'))
+                pos++;
+            if (((pos - value->data) != 4 || (memcmp(value->data, "true", 4) != 0 &&
+                                               memcmp(value->data, "null", 4) != 0)) &&
+                ((pos - value->data) != 5 || memcmp(value->data, "false", 5) != 0))
+                return OVSA_JSON_PARSE_FAIL;
+            break;
+        default:
+            value->type = OVSA_JSON_TYPE_NUMBER;
+            while ((pos < end) && (((*pos >= '0') && (*pos <= '9')) || (*pos == '-') ||
+                                   (*pos == '+') || (*pos == '.') || (*pos == 'e') ||
+                                   (*pos == 'E')))
+                pos++;
+            if (pos == value->data)
+                return OVSA_JSON_PARSE_FAIL;
+            break;
+    }
+    value->len = pos - value->data;
+    *cursor    = pos;
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_json_reader_foreach(const char* buf, size_t len, char open,
+                                              ovsa_json_member_cb_t member_cb,
+                                              ovsa_json_element_cb_t element_cb, void* ctx) {
+    ovsa_status_t ret = OVSA_OK;
+    const char* end   = NULL;
+    const char* pos   = NULL;
+
+    if (buf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error json reader input is null\n");
+        return OVSA_JSON_INVALID_INPUT;
+    }
+    /* A NUL ends the buffer as well, it is refused within a value */
+    end = buf + len;
+    pos = ovsa_json_reader_skip_space(buf, end);
+    if ((pos >= end) || (*pos != open)) {
+        OVSA_DBG(DBG_E, "OVSA: Error json %s expected\n", (open == '{') ? "object" : "array");
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    ret = ovsa_json_reader_read_container(&pos, end, 0, member_cb, element_cb, ctx);
+    if (ret == OVSA_JSON_READ_STOP)
+        return OVSA_OK;
+    if (ret < OVSA_OK)
+        return ret;
+    pos = ovsa_json_reader_skip_space(pos, end);
+    if ((pos < end) && (*pos != '\0')) {
+        OVSA_DBG(DBG_E, "OVSA: Error trailing characters after json %s\n",
+                 (open == '{') ? "object" : "array");
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_json_foreach_member(const char* buf, size_t len,
+                                              ovsa_json_member_cb_t cb, void* ctx) {
+    return ovsa_json_reader_foreach(buf, len, '{', cb, NULL, ctx);
+}
+
+static bool ovsa_json_view_equals(const ovsa_json_view_t* view, const char* str) {
+    size_t len = strnlen_s(str, RSIZE_MAX_STR);
+
+    return (view->len == len) && (memcmp(view->data, str, len) == 0);
+}
+
+static int ovsa_json_view_hex_digit(char c) {
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+static ovsa_status_t ovsa_json_view_read_unicode(const char* pos, const char* end,
+                                                 unsigned int* code_point) {
+    int digit = 0;
+    int i     = 0;
+
+    if ((end - pos) < 4)
+        return OVSA_JSON_PARSE_FAIL;
+    *code_point = 0;
+    for (i = 0; i < 4; i++) {
+        digit = ovsa_json_view_hex_digit(pos[i]);
+        if (digit < 0)
+            return OVSA_JSON_PARSE_FAIL;
+        *code_point = (*code_point << 4) | digit;
+    }
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_json_view_copy(const ovsa_json_view_t* view, char* dest,
+                                         size_t dest_size, size_t* copied) {
+    const char* pos   = view->data;
+    const char* end   = view->data + view->len;
+    unsigned int low  = 0;
+    unsigned int code = 0;
+    size_t len        = 0;
+    size_t utf8_len   = 0;
+    size_t i          = 0;
+    char utf8[4];
+
+    if ((view->type != OVSA_JSON_TYPE_STRING) || (dest == NULL))
+        return OVSA_JSON_INVALID_INPUT;
+    while ((pos < end) && (len < dest_size)) {
+        if (*pos != '\\') {
+            /* Runs without escapes, e.g. base64 values, are copied as a whole */
+            const char* run = memchr(pos, '\\', end - pos);
+            size_t run_len  = ((run != NULL) ? run : end) - pos;
+            if (run_len > dest_size - len)
+                run_len = dest_size - len;
+            memcpy_s(dest + len, dest_size - len, pos, run_len);
+            len += run_len;
+            pos += run_len;
+            continue;
+        }
+        if ((end - pos) < 2)
+            return OVSA_JSON_PARSE_FAIL;
+        utf8_len = 1;
+        switch (pos[1]) {
+            case '"':
+            case '\\':
+            case '/':
+                utf8[0] = pos[1];
+                break;
+            case 'b':
+                utf8[0] = '\b';
+                break;
+            case 'f':
+                utf8[0] = '\f';
+                break;
+            case 'n':
+                utf8[0] = '\n';
+                break;
+            case 'r':
+                utf8[0] = '\r';
+                break;
+            case 't':
+                utf8[0] = '\t';
+                break;
+            case 'u':
+                if (ovsa_json_view_read_unicode(pos + 2, end, &code) < OVSA_OK)
+                    return OVSA_JSON_PARSE_FAIL;
+                pos += 4;
+                if ((code >= 0xD800) && (code <= 0xDBFF)) {
+                    /* Surrogate pair */
+                    if (((end - pos) < 8) || (pos[2] != '\\') || (pos[3] != 'u') ||
+                        (ovsa_json_view_read_unicode(pos + 4, end, &low) < OVSA_OK) ||
+                        (low < 0xDC00) || (low > 0xDFFF))
+                        return OVSA_JSON_PARSE_FAIL;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                if (code < 0x80) {
+                    utf8[0] = (char)code;
+                } else if (code < 0x800) {
+                    utf8[0]  = (char)(0xC0 | (code >> 6));
+                    utf8[1]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 2;
+                } else if (code < 0x10000) {
+                    utf8[0]  = (char)(0xE0 | (code >> 12));
+                    utf8[1]  = (char)(0x80 | ((code >> 6) & 0x3F));
+                    utf8[2]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 3;
+                } else {
+                    utf8[0]  = (char)(0xF0 | (code >> 18));
+                    utf8[1]  = (char)(0x80 | ((code >> 12) & 0x3F));
+                    utf8[2]  = (char)(0x80 | ((code >> 6) & 0x3F));
+                    utf8[3]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 4;
+                }
+                break;
+            default:
+                return OVSA_JSON_PARSE_FAIL;
+        }
+        pos += 2;
+        for (i = 0; (i < utf8_len) && (len < dest_size); i++)
+            dest[len++] = utf8[i];
+    }
+    if (copied != NULL)
+        *copied = len;
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_json_view_dup(const ovsa_json_view_t* view, char** value,
+                                        size_t* value_len) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t len        = 0;
+
+    /* The unescaped string is never longer than the escaped one */
+    ret = ovsa_license_service_safe_malloc(view->len + 1, value);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        return OVSA_JSON_MEMORY_ALLOC_FAIL;
+    }
+    ret = ovsa_json_view_copy(view, *value, view->len, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid json string %d\n", ret);
+        ovsa_license_service_safe_free(value);
+        return ret;
+    }
+    (*value)[len] = '\0';
+    if (value_len != NULL)
+        *value_len = len;
+    return OVSA_OK;
+}
+
+typedef struct ovsa_json_element_ctx {
+    const char* key_name;
+    char** key_value;
+} ovsa_json_element_ctx_t;
+
+static ovsa_status_t ovsa_json_read_element(void* ctx, const ovsa_json_view_t* key,
+                                            const ovsa_json_view_t* value) {
+    ovsa_json_element_ctx_t* element = (ovsa_json_element_ctx_t*)ctx;
+    ovsa_status_t ret                = OVSA_OK;
+
+    if (!ovsa_json_view_equals(key, element->key_name))
+        return OVSA_OK;
+    if (value->type == OVSA_JSON_TYPE_STRING) {
+        ret = ovsa_json_view_dup(value, element->key_value, NULL);
+        if (ret < OVSA_OK)
+            return ret;
+    }
+    /* The rest of the message, e.g. the payload following the command, is not read */
+    return OVSA_JSON_READ_STOP;
+}
+
 ovsa_status_t ovsa_license_service_json_extract_element(const char* inputBuf, const char* keyName,
                                                         char** keyValue) {
     ovsa_status_t ret = OVSA_OK;
-    cJSON* parse_json = NULL;
-    cJSON* key        = NULL;
+    size_t len        = 0;
+    ovsa_json_element_ctx_t element;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -468,31 +839,20 @@ ovsa_status_t ovsa_license_service_json_extract_element(const char* inputBuf, co
         goto end;
     }
 
-    parse_json = cJSON_Parse(inputBuf);
-    if (parse_json == NULL) {
-        ret = OVSA_JSON_PARSE_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error json parse failed %d\n", ret);
+    ret = ovsa_license_service_get_string_length(inputBuf, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of input string %d\n", ret);
         goto end;
     }
-    key = cJSON_GetObjectItemCaseSensitive(parse_json, keyName);
-    if (cJSON_IsString(key) && (key->valuestring != NULL)) {
-        size_t str_len = 0;
-        ret            = ovsa_license_service_get_string_length(key->valuestring, &str_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of key string %d\n", ret);
-            goto end;
-        }
-        ret = ovsa_license_service_safe_malloc(str_len + 1, (char**)keyValue);
-        if (ret < OVSA_OK) {
-            ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-            goto end;
-        }
-        memcpy_s(*keyValue, str_len, key->valuestring, str_len);
+    element.key_name  = keyName;
+    element.key_value = keyValue;
+    ret = ovsa_json_foreach_member(inputBuf, len, ovsa_json_read_element, &element);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error json parse failed %d\n", ret);
+        goto end;
     }
 
 end:
-    cJSON_Delete(parse_json);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -515,7 +875,11 @@ ovsa_status_t ovsa_license_service_json_create_message_blob(ovsa_command_type_t
                                   "OVSA_SEND_CUST_LICENSE",
                                   "OVSA_SEND_UPDATE_CUST_LICENSE",
                                   "OVSA_SEND_UPDATE_CUST_LICENSE_ACK",
-                                  "OVSA_SEND_LICENSE_CHECK_RESP"};
+                                  "OVSA_SEND_LICENSE_CHECK_RESP",
+                                  "OVSA_SEND_CUST_LICENSE_BATCH",
+                                  "OVSA_SEND_LICENSE_CHECK_BATCH_RESP",
+                                  "OVSA_SEND_ATTESTATION_TOKEN",
+                                  "OVSA_SEND_LICENSE_LEASE"};
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -550,6 +914,22 @@ ovsa_status_t ovsa_license_service_json_create_message_blob(ovsa_command_type_t
                      strnlen_s((char*)command_type[OVSA_SEND_LICENSE_CHECK_RESP],
                                MAX_COMMAND_TYPE_LENGTH));
             break;
+        case OVSA_SEND_LICENSE_CHECK_BATCH_RESP:
+            memcpy_s(command, MAX_COMMAND_TYPE_LENGTH,
+                     command_type[OVSA_SEND_LICENSE_CHECK_BATCH_RESP],
+                     strnlen_s((char*)command_type[OVSA_SEND_LICENSE_CHECK_BATCH_RESP],
+                               MAX_COMMAND_TYPE_LENGTH));
+            break;
+        case OVSA_SEND_ATTESTATION_TOKEN:
+            memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, command_type[OVSA_SEND_ATTESTATION_TOKEN],
+                     strnlen_s((char*)command_type[OVSA_SEND_ATTESTATION_TOKEN],
+                               MAX_COMMAND_TYPE_LENGTH));
+            break;
+        case OVSA_SEND_LICENSE_LEASE:
+            memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, command_type[OVSA_SEND_LICENSE_LEASE],
+                     strnlen_s((char*)command_type[OVSA_SEND_LICENSE_LEASE],
+                               MAX_COMMAND_TYPE_LENGTH));
+            break;
         default:
             OVSA_DBG(DBG_E, "OVSA: Error json message command not valid \n");
             goto end;
@@ -573,6 +953,20 @@ ovsa_status_t ovsa_license_service_json_create_message_blob(ovsa_command_type_t
         OVSA_DBG(DBG_E, "OVSA: Error add payload to json failed %d\n", ret);
         goto end;
     }
+    /* The nonce opens the protocol, it offers the binary framing to the client */
+    if ((cmdtype == OVSA_SEND_NONCE) &&
+        (cJSON_AddStringToObject(message, "framing", OVSA_FRAMING_TLV) == NULL)) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add framing to json failed %d\n", ret);
+        goto end;
+    }
+    /* It also offers the record with the correlation ID of the tracing spans */
+    if ((cmdtype == OVSA_SEND_NONCE) &&
+        (cJSON_AddStringToObject(message, "trace", OVSA_FRAMING_TRACE) == NULL)) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add trace to json failed %d\n", ret);
+        goto end;
+    }
     str_print = cJSON_Print(message);
     if (str_print == NULL) {
         ret = OVSA_JSON_PRINT_FAIL;
@@ -657,3 +1051,192 @@ end:
     OVSA_DBG(DBG_D, "%s exit\n", __func__);
     return ret;
 }
+
+ovsa_status_t ovsa_license_service_json_create_string_array(char* const* values, size_t count,
+                                                            char** outputBuf) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* array      = NULL;
+    cJSON* item       = NULL;
+    size_t len        = 0;
+    size_t index      = 0;
+    char* str_print   = NULL;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    if (values == NULL || outputBuf == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    array = cJSON_CreateArray();
+    if (array == NULL) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        OVSA_DBG(DBG_E, "OVSA: Error create json array failed %d\n", ret);
+        goto end;
+    }
+    for (index = 0; index < count; index++) {
+        item = cJSON_CreateString(values[index] != NULL ? values[index] : "");
+        if (item == NULL) {
+            ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+            OVSA_DBG(DBG_E, "OVSA: Error add string to json array failed %d\n", ret);
+            goto end;
+        }
+        cJSON_AddItemToArray(array, item);
+    }
+    str_print = cJSON_PrintUnformatted(array);
+    if (str_print == NULL) {
+        ret = OVSA_JSON_PRINT_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error print json array to buffer failed %d\n", ret);
+        goto end;
+    }
+    ret = ovsa_license_service_get_string_length(str_print, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+        goto end;
+    }
+    len = len + 1; /* for NULL termination */
+    ret = ovsa_license_service_safe_malloc(len, outputBuf);
+    if (ret < OVSA_OK || *outputBuf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    memcpy_s(*outputBuf, len, str_print, len);
+
+end:
+    cJSON_Delete(array);
+    ovsa_license_service_safe_free(&str_print);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_json_extract_string_array(const char* inputBuf,
+                                                             size_t max_count, char*** values,
+                                                             size_t* count) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* parse_json = NULL;
+    cJSON* item       = NULL;
+    size_t str_len    = 0;
+    size_t index      = 0;
+    size_t num_items  = 0;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    if (inputBuf == NULL || values == NULL || count == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    *values    = NULL;
+    *count     = 0;
+    parse_json = cJSON_Parse(inputBuf);
+    if (!cJSON_IsArray(parse_json)) {
+        ret = OVSA_JSON_PARSE_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error json array parse failed %d\n", ret);
+        goto end;
+    }
+    num_items = cJSON_GetArraySize(parse_json);
+    if ((num_items == 0) || (num_items > max_count)) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error json array size %zu is invalid\n", num_items);
+        goto end;
+    }
+    *values = (char**)calloc(num_items, sizeof(char*));
+    if (*values == NULL) {
+        ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    *count = num_items;
+    cJSON_ArrayForEach(item, parse_json) {
+        if (!cJSON_IsString(item) || (item->valuestring == NULL)) {
+            ret = OVSA_JSON_INVALID_INPUT;
+            OVSA_DBG(DBG_E, "OVSA: Error json array element %zu is not a string\n", index);
+            goto end;
+        }
+        ret = ovsa_license_service_get_string_length(item->valuestring, &str_len);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+            goto end;
+        }
+        ret = ovsa_license_service_safe_malloc(str_len + 1, &(*values)[index]);
+        if (ret < OVSA_OK) {
+            ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
+            OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+            goto end;
+        }
+        memcpy_s((*values)[index], str_len, item->valuestring, str_len);
+        index++;
+    }
+
+end:
+    if ((ret < OVSA_OK) && (values != NULL) && (count != NULL))
+        ovsa_license_service_json_free_string_array(values, *count);
+    cJSON_Delete(parse_json);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_json_free_string_array(char*** values, size_t count) {
+    size_t index = 0;
+
+    if ((values == NULL) || (*values == NULL))
+        return;
+    for (index = 0; index < count; index++)
+        ovsa_license_service_safe_free(&(*values)[index]);
+    free(*values);
+    *values = NULL;
+}
+
+ovsa_status_t ovsa_license_service_json_create_string_object(const char* const* names,
+                                                             const char* const* values,
+                                                             size_t count, char** outputBuf) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* object     = NULL;
+    size_t len        = 0;
+    size_t index      = 0;
+    char* str_print   = NULL;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    if (names == NULL || values == NULL || outputBuf == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    object = cJSON_CreateObject();
+    if (object == NULL) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        OVSA_DBG(DBG_E, "OVSA: Error create json object failed %d\n", ret);
+        goto end;
+    }
+    for (index = 0; index < count; index++) {
+        if (values[index] == NULL)
+            continue;
+        if (cJSON_AddStringToObject(object, names[index], values[index]) == NULL) {
+            ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+            OVSA_DBG(DBG_E, "OVSA: Error add %s to json object failed %d\n", names[index], ret);
+            goto end;
+        }
+    }
+    str_print = cJSON_PrintUnformatted(object);
+    if (str_print == NULL) {
+        ret = OVSA_JSON_PRINT_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error print json object to buffer failed %d\n", ret);
+        goto end;
+    }
+    ret = ovsa_license_service_get_string_length(str_print, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+        goto end;
+    }
+    len = len + 1; /* for NULL termination */
+    ret = ovsa_license_service_safe_malloc(len, outputBuf);
+    if (ret < OVSA_OK || *outputBuf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    memcpy_s(*outputBuf, len, str_print, len);
+
+end:
+    cJSON_Delete(object);
+    ovsa_license_service_safe_free(&str_print);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
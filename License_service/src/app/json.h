@@ -84,4 +84,49 @@ ovsa_status_t ovsa_license_service_json_create_quote_cred_data_blob(const char*
                                                                     char** outputBuf,
                                                                     size_t* valuelen);
 
+/*!
+ * \brief ovsa_license_service_json_create_string_array
+ *
+ * \param [in]  values    strings to add to the json array
+ * \param [in]  count     number of strings
+ * \param [out] outputBuf Buffer having the json array
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_license_service_json_create_string_array(char* const* values, size_t count,
+                                                            char** outputBuf);
+
+/*!
+ * \brief ovsa_license_service_json_extract_string_array
+ *
+ * \param [in]  inputBuf  Buffer having a json array of strings
+ * \param [in]  max_count maximum number of strings accepted
+ * \param [out] values    strings read, free with ovsa_license_service_json_free_string_array()
+ * \param [out] count     number of strings read
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_license_service_json_extract_string_array(const char* inputBuf,
+                                                             size_t max_count, char*** values,
+                                                             size_t* count);
+
+/*!
+ * \brief ovsa_license_service_json_free_string_array
+ *
+ * \param [in]  values strings to free
+ * \param [in]  count  number of strings
+ */
+void ovsa_license_service_json_free_string_array(char*** values, size_t count);
+
+/*!
+ * \brief ovsa_license_service_json_create_string_object
+ *
+ * \param [in]  names     names of the object members
+ * \param [in]  values    string values of the members, NULL values are left out
+ * \param [in]  count     number of members
+ * \param [out] outputBuf Output buffer containing JSON object
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_license_service_json_create_string_object(const char* const* names,
+                                                             const char* const* values,
+                                                             size_t count, char** outputBuf);
+
 #endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "db.h"
+#include "json.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+/* license_lease.h to be included at end due to dependencies */
+#include "license_lease.h"
+
+/*
+ * A lease is a JSON object of the claims, the base64 signature of the claims with the private
+ * key of the License Service and its certificate. The runtime trusts the certificate if its hash
+ * is one of the license server certificate hashes of the customer license, so the lease can be
+ * verified while the License Service is unreachable.
+ */
+static EVP_PKEY* g_lease_key;
+static char* g_lease_cert;
+static size_t g_lease_validity;
+
+ovsa_status_t ovsa_license_service_license_lease_init(const char* cert_path, const char* key_path,
+                                                      size_t validity) {
+    ovsa_status_t ret = OVSA_OK;
+    char* key         = NULL;
+    size_t size       = 0;
+
+    g_lease_validity = 0;
+    if (validity == 0)
+        return OVSA_OK;
+
+    ret = ovsa_license_service_read_file_content(cert_path, &g_lease_cert, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading license lease certificate failed with code %d\n",
+                 ret);
+        goto out;
+    }
+    ret = ovsa_license_service_read_file_content(key_path, &key, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading license lease key failed with code %d\n", ret);
+        goto out;
+    }
+    g_lease_key = ovsa_license_service_crypto_load_key(key, "private key");
+    if (g_lease_key == NULL) {
+        ret = OVSA_CRYPTO_GENERIC_ERROR;
+        goto out;
+    }
+    g_lease_validity = validity;
+    OVSA_DBG(DBG_I, "OVSA:License leases are valid for %zu seconds\n", validity);
+out:
+    if (key != NULL) {
+        memset_s(key, size, 0);
+        ovsa_license_service_safe_free(&key);
+    }
+    if (ret < OVSA_OK)
+        ovsa_license_service_license_lease_deinit();
+    return ret;
+}
+
+size_t ovsa_license_service_license_lease_validity(void) {
+    return g_lease_validity;
+}
+
+static ovsa_status_t ovsa_license_service_license_lease_sign(const char* claims, size_t claims_len,
+                                                             char** signature) {
+    ovsa_status_t ret  = OVSA_OK;
+    EVP_MD_CTX* mctx   = NULL;
+    unsigned char* sig = NULL;
+    size_t sig_len     = 0;
+
+    mctx = EVP_MD_CTX_new();
+    if ((mctx == NULL) || (EVP_DigestSignInit(mctx, NULL, EVP_sha512(), NULL, g_lease_key) != 1) ||
+        (EVP_DigestSign(mctx, NULL, &sig_len, (const unsigned char*)claims, claims_len) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error setting up the license lease signing failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    ret = ovsa_license_service_safe_malloc(sig_len, (char**)&sig);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error license lease memory allocation failed %d\n", ret);
+        goto out;
+    }
+    if (EVP_DigestSign(mctx, sig, &sig_len, (const unsigned char*)claims, claims_len) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error signing the license lease failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    ret = ovsa_license_service_crypto_convert_bin_to_base64((const char*)sig, sig_len, signature);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error encode license lease signature failed with code %d\n", ret);
+        goto out;
+    }
+out:
+    ovsa_license_service_safe_free((char**)&sig);
+    EVP_MD_CTX_free(mctx);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_license_lease_create(const char* license_guid,
+                                                        const char* model_guid, char** lease) {
+    ovsa_status_t ret   = OVSA_OK;
+    char* customer_cert = NULL;
+    char* claims        = NULL;
+    char* signature     = NULL;
+    size_t claims_len   = 0;
+    char cert_hash[HASH_SIZE];
+    char expiry[MAX_NAME_SIZE];
+    const char* claim_names[] = {"license_guid", "platform_cert_hash", "expiry"};
+    const char* lease_names[] = {"claims", "signature", "certificate"};
+    const char* values[3];
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if ((g_lease_validity == 0) || (license_guid == NULL) || (model_guid == NULL) ||
+        (lease == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error create license lease failed with invalid parameter\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    /* The lease is only good on the platform the customer license was issued for */
+    ret = ovsa_db_get_customer_primary_certificate(OVSA_DB_PATH, license_guid, model_guid,
+                                                   &customer_cert);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error retrieve customer certificate failed with error code %d\n",
+                 ret);
+        goto out;
+    }
+    memset_s(cert_hash, sizeof(cert_hash), 0);
+    ret = ovsa_license_service_crypto_compute_hash(customer_cert, HASH_ALG_SHA384, cert_hash,
+                                                   true /* FORMAT_BASE64 */);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error customer certificate hash failed with code %d\n", ret);
+        goto out;
+    }
+    snprintf(expiry, sizeof(expiry), "%lld", (long long)time(NULL) + (long long)g_lease_validity);
+    values[0] = license_guid;
+    values[1] = cert_hash;
+    values[2] = expiry;
+
+    ret = ovsa_license_service_json_create_string_object(claim_names, values, 3, &claims);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create license lease claims failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_get_string_length(claims, &claims_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of claims string %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_license_service_license_lease_sign(claims, claims_len, &signature);
+    if (ret < OVSA_OK)
+        goto out;
+
+    values[0] = claims;
+    values[1] = signature;
+    values[2] = g_lease_cert;
+    ret       = ovsa_license_service_json_create_string_object(lease_names, values, 3, lease);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create license lease failed with code %d\n", ret);
+        goto out;
+    }
+out:
+    ovsa_license_service_safe_free(&customer_cert);
+    ovsa_license_service_safe_free(&claims);
+    ovsa_license_service_safe_free(&signature);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_license_lease_deinit(void) {
+    g_lease_validity = 0;
+    EVP_PKEY_free(g_lease_key);
+    g_lease_key = NULL;
+    ovsa_license_service_safe_free(&g_lease_cert);
+}
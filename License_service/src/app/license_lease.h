@@ -0,0 +1,69 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __OVSA_LICENSE_LEASE_H_
+#define __OVSA_LICENSE_LEASE_H_
+
+#include "license_service.h"
+
+/* API's */
+/*!
+ * \brief ovsa_license_service_license_lease_init loads the key and certificate of the License
+ * Service the leases are signed with. Leases are not issued if the validity is 0
+ *
+ * \param [in]  cert_path certificate of the License Service
+ * \param [in]  key_path  private key of the License Service
+ * \param [in]  validity  validity of the leases in seconds
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_license_lease_init(const char* cert_path, const char* key_path,
+                                                      size_t validity);
+
+/*!
+ * \brief ovsa_license_service_license_lease_validity returns the validity of the leases
+ *
+ * \return validity in seconds, 0 if leases are not issued
+ */
+
+size_t ovsa_license_service_license_lease_validity(void);
+
+/*!
+ * \brief ovsa_license_service_license_lease_create issues a lease for a customer license that
+ * passed the license check. The lease names the license and the platform certificate of the
+ * customer and lets the runtime keep using the license until the lease expires when the
+ * License Service cannot be reached
+ *
+ * \param [in]  license_guid GUID of the customer license
+ * \param [in]  model_guid   GUID of the model of the customer license
+ * \param [out] lease        signed lease along with the certificate to verify it
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_license_lease_create(const char* license_guid,
+                                                        const char* model_guid, char** lease);
+
+/*!
+ * \brief ovsa_license_service_license_lease_deinit frees the key the leases are signed with.
+ * To be called after the worker threads are stopped
+ *
+ * \return void
+ */
+
+void ovsa_license_service_license_lease_deinit(void);
+
+#endif
@@ -16,7 +16,6 @@
  */
 
 #include <assert.h>
-#include <dirent.h>
 #include <dlfcn.h>
 #include <errno.h>
 #include <netinet/in.h>
@@ -30,20 +29,25 @@
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "attestation_token.h"
 #include "cJSON.h"
 #include "db.h"
 #include "json.h"
+#include "license_lease.h"
 #include "license_service.h"
+#include "log.h"
 #include "mbedtls/config.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/debug.h"
@@ -51,7 +55,11 @@
 #include "mbedtls/error.h"
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
+#include "mbedtls/ssl_ticket.h"
+#include "metrics.h"
 #include "safe_str_lib.h"
+#include "tcb_cache.h"
+#include "trace.h"
 #include "utils.h"
 
 static const char* g_cipher_suitename[CIPHER_SUITE_SIZE] = {
@@ -59,11 +67,27 @@ static const char* g_cipher_suitename[CIPHER_SUITE_SIZE] = {
 static int g_cipher_suite[CIPHER_SUITE_SIZE];
 static mbedtls_ecp_group_id g_curve_list[CURVE_LIST_SIZE];
 
-static pthread_mutex_t g_measurement_lock;
 pthread_mutex_t g_cert_verify_lock;
-static mbedtls_ssl_config g_conf;
+/* One immutable configuration per listener, shared by all handshakes on that port */
+static mbedtls_ssl_config g_tls_conf;
+#ifdef ENABLE_SGX_GRAMINE
+static mbedtls_ssl_config g_ratls_conf;
+#endif
+/* Session ticket keys for TLS session resumption on the TLS port */
+static mbedtls_ssl_ticket_context g_ticket_ctx;
+/* The entropy source is shared by the DRBGs of the server and of the workers, which reseed at
+ * any time */
+static pthread_mutex_t g_entropy_lock = PTHREAD_MUTEX_INITIALIZER;
+/* DRBG of the worker running on this thread, the handshakes of a worker draw their randomness
+ * from it instead of contending for the DRBG of the server */
+static __thread mbedtls_ctr_drbg_context* g_thread_ctr_drbg;
 
 static ovsa_status_t ovsa_license_service_write(void* ssl, const uint8_t* buf, size_t len);
+static ovsa_status_t ovsa_license_service_send_message(void* ssl, const ovsa_command_type_t cmd,
+                                                       const char* payload);
+static ovsa_status_t ovsa_license_service_extract_payload(const char* message, char** payload);
+static ovsa_status_t ovsa_license_service_reserve_buffer(char** buf, size_t* buf_size,
+                                                         size_t size);
 static ovsa_status_t ovsa_license_service_read(void* ssl, uint8_t* buf, size_t len);
 static ovsa_status_t ovsa_license_service_start(const char* in_servers,
                                                 const char* in_ca_chain_path, void** out_ssl);
@@ -73,11 +97,11 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
 #endif
                                                        ovsa_license_service_cb_t f_cb);
 static ovsa_status_t ovsa_license_service_close(void* ssl);
+static ovsa_status_t ovsa_license_service_free_quote_info(ovsa_quote_info_t quote_info);
 
 static char g_ratls_port[MAX_LEN];
 static char g_tls_port[MAX_LEN];
 
-static pthread_mutex_t g_handshake_lock;
 #ifdef ENABLE_SGX_GRAMINE
 typedef struct ovsa_sgx_measurement {
     char quoting_enclave[SGX_ENCLAVE_HASH_SIZE];
@@ -97,11 +121,72 @@ struct ovsa_thread_info {
     unsigned int client_port;
 };
 
+/*
+ * TLS session with a client and the buffers its messages are built and received in, reused from
+ * one message to the next. The handlers get the TLS context, the first member, as the session.
+ */
+typedef struct ovsa_client_connection {
+    mbedtls_ssl_context ssl;
+    char* tx_buf;
+    size_t tx_buf_size;
+    char* rx_buf;
+    size_t rx_buf_size;
+    /* Messages are sent in the binary framing once the client used it */
+    bool binary_framing;
+} ovsa_client_connection_t;
+
+/* Accepted connection waiting for a free worker */
+typedef struct ovsa_accept_entry {
+    mbedtls_net_context client_fd;
+    mbedtls_ssl_config* conf;
+    unsigned int client_port;
+} ovsa_accept_entry_t;
+
+/* Bounded FIFO between the epoll acceptor and the worker pool */
+typedef struct ovsa_accept_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    ovsa_accept_entry_t* entries;
+    size_t capacity;
+    size_t head;
+    size_t depth;
+    size_t max_depth;
+    uint64_t accepted;
+    uint64_t rejected;
+    bool shutdown;
+} ovsa_accept_queue_t;
+
+typedef struct ovsa_worker {
+    pthread_t tid;
+    bool started;
+    ovsa_license_service_cb_t f_cb;
+    struct ovsa_thread_info* ti;
+    mbedtls_entropy_context* entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+} ovsa_worker_t;
+
+static ovsa_accept_queue_t g_accept_queue;
+/* Set on SIGINT/SIGTERM so that the server stops and writes the pending license usages */
+static volatile sig_atomic_t g_shutdown_requested;
+
 #ifdef ENABLE_SGX_GRAMINE
-ovsa_sgx_measurement_t g_sgx_measurement;
-void ovsa_license_service_hexdump_mem(const void* data, size_t size) {
-    uint8_t* ptr = (uint8_t*)data;
-    for (size_t i = 0; i < size; i++) OVSA_DBG(DBG_D, "%02x", ptr[i]);
+/* The RA-TLS measurement callback carries no user data, but it is invoked on the thread
+ * running mbedtls_ssl_handshake(). Each worker points this at the context of the connection
+ * it is serving, so that measurements never cross connections. */
+static __thread ovsa_sgx_measurement_t* g_thread_sgx_measurement;
+void ovsa_license_service_hexdump_mem(const char* label, const void* data, size_t size) {
+    const uint8_t* ptr = (const uint8_t*)data;
+    char hex[HEXDUMP_LINE_SIZE * 2 + 1];
+    size_t offset = 0;
+    size_t index  = 0;
+
+    /* One log record per line of the dump */
+    for (offset = 0; offset < size; offset += HEXDUMP_LINE_SIZE) {
+        for (index = 0; (index < HEXDUMP_LINE_SIZE) && (offset + index < size); index++)
+            snprintf(&hex[index * 2], 3, "%02x", ptr[offset + index]);
+        hex[index * 2] = '\0';
+        OVSA_DBG(DBG_D, "%s%s\n", label, hex);
+    }
 }
 
 static uint16_t ovsa_license_service_convert_to_littleendian(uint8_t* buf) {
@@ -123,44 +208,40 @@ ovsa_status_t ovsa_license_service_sgx_measurements_callback(const char* mrencla
                                                              const char* mrsigner,
                                                              const char* isv_prod_id,
                                                              const char* isv_svn) {
-    ovsa_status_t ret = OVSA_OK;
+    ovsa_status_t ret                       = OVSA_OK;
+    ovsa_sgx_measurement_t* sgx_measurement = NULL;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     assert(mrenclave && mrsigner && isv_prod_id && isv_svn);
-    memset_s(&g_sgx_measurement, sizeof(ovsa_sgx_measurement_t), 0);
 
-    ret = pthread_mutex_lock(&g_measurement_lock);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "Error:mutex lock failed %d\n", ret);
+    sgx_measurement = g_thread_sgx_measurement;
+    if (sgx_measurement == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error no connection context for the SGX measurements\n");
+        ret = OVSA_FAIL;
         goto out;
     }
+    memset_s(sgx_measurement, sizeof(ovsa_sgx_measurement_t), 0);
+
     OVSA_DBG(DBG_D, "OVSA:Received the following measurements from the client:\n");
-    OVSA_DBG(DBG_D, "OVSA:  - MRENCLAVE:   ");
-    ovsa_license_service_hexdump_mem(mrenclave, 32);
-    OVSA_DBG(DBG_D, "OVSA:  - MRSIGNER:    ");
-    ovsa_license_service_hexdump_mem(mrsigner, 32);
+    ovsa_license_service_hexdump_mem("OVSA:  - MRENCLAVE:   ", mrenclave, 32);
+    ovsa_license_service_hexdump_mem("OVSA:  - MRSIGNER:    ", mrsigner, 32);
     OVSA_DBG(DBG_D, "OVSA:  - ISV_PROD_ID: %hu\n", *((uint16_t*)isv_prod_id));
     OVSA_DBG(DBG_D, "OVSA:  - ISV_SVN:     %hu\n", *((uint16_t*)isv_svn));
 
     /* Store the received Quote for later verification with Customer license */
-    ovsa_license_service_convert_to_twodigithex(mrenclave, 32, g_sgx_measurement.quoting_enclave);
-    ovsa_license_service_convert_to_twodigithex(mrsigner, 32, g_sgx_measurement.quoting_signer);
-    g_sgx_measurement.quoting_isv_prod_id =
+    ovsa_license_service_convert_to_twodigithex(mrenclave, 32, sgx_measurement->quoting_enclave);
+    ovsa_license_service_convert_to_twodigithex(mrsigner, 32, sgx_measurement->quoting_signer);
+    sgx_measurement->quoting_isv_prod_id =
         ovsa_license_service_convert_to_littleendian((uint8_t*)isv_prod_id);
-    g_sgx_measurement.quoting_isv_svn =
+    sgx_measurement->quoting_isv_svn =
         ovsa_license_service_convert_to_littleendian((uint8_t*)isv_svn);
 
-    OVSA_DBG(DBG_I, "OVSA:MRENCLAVE   : '%s ' \n", g_sgx_measurement.quoting_enclave);
-    OVSA_DBG(DBG_I, "OVSA:MRSIGNER    : '%s ' \n", g_sgx_measurement.quoting_signer);
-    OVSA_DBG(DBG_I, "OVSA:ISV_SVN     : '%d ' \n", g_sgx_measurement.quoting_isv_svn);
-    OVSA_DBG(DBG_I, "OVSA:ISV_PROD_ID : '%d ' \n", g_sgx_measurement.quoting_isv_prod_id);
+    OVSA_DBG(DBG_I, "OVSA:MRENCLAVE   : '%s ' \n", sgx_measurement->quoting_enclave);
+    OVSA_DBG(DBG_I, "OVSA:MRSIGNER    : '%s ' \n", sgx_measurement->quoting_signer);
+    OVSA_DBG(DBG_I, "OVSA:ISV_SVN     : '%d ' \n", sgx_measurement->quoting_isv_svn);
+    OVSA_DBG(DBG_I, "OVSA:ISV_PROD_ID : '%d ' \n", sgx_measurement->quoting_isv_prod_id);
 
-    ret = pthread_mutex_unlock(&g_measurement_lock);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "Error:mutex unlock failed %d\n", ret);
-        goto out;
-    }
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
 out:
     return ret;
@@ -179,73 +260,7 @@ static void ovsa_license_service_mbedtls_debug_cb(void* ctx, int level, const ch
         }
     }
 
-    mbedtls_printf("%s:%04d: |%d| %s", basename, line, level, str);
-}
-static ovsa_status_t ovsa_license_service_remove_directory(const char* path) {
-    ovsa_status_t ret = OVSA_OK;
-    size_t path_len   = 0;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-
-    DIR* tmpdirectory = opendir(path);
-    ret               = ovsa_license_service_get_string_length((char*)path, &path_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of path string %d\n", ret);
-        return OVSA_FAIL;
-    }
-    if (tmpdirectory) {
-        struct dirent* directory_entry;
-        while (directory_entry = readdir(tmpdirectory)) {
-            char* buf  = NULL;
-            size_t len = 0, dir_name_len = 0;
-
-            /* Skip the names "." and ".." */
-            if (!strcmp(directory_entry->d_name, ".") || !strcmp(directory_entry->d_name, ".."))
-                continue;
-            len = path_len + strnlen_s(directory_entry->d_name, MAX_NAME_SIZE) + 2;
-            ret = ovsa_license_service_safe_malloc(sizeof(char) * len, &buf);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error memory alloc failed with code %d\n", ret);
-                return OVSA_MEMORY_ALLOC_FAIL;
-            }
-            if (buf) {
-                struct stat statbuf;
-                snprintf(buf, len, "%s%s", path, directory_entry->d_name);
-                OVSA_DBG(DBG_D, "OVSA:Deleting '%s' file \n", buf);
-
-                if (!stat(buf, &statbuf)) {
-                    ret = unlink(buf);
-                    if (ret != OVSA_OK) {
-                        ovsa_license_service_safe_free(&buf);
-                        return OVSA_RMFILE_FAIL;
-                    }
-                }
-                ovsa_license_service_safe_free(&buf);
-            }
-        }
-        ret = closedir(tmpdirectory);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error close directory  failed with code %d\n", ret);
-            return OVSA_CLOSEDIR_FAIL;
-        }
-        OVSA_DBG(DBG_D, "OVSA:Deleting '%s' directory \n", path);
-        ret = rmdir(path);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error remove directory  failed with code %d\n", ret);
-            return OVSA_RMDIR_FAIL;
-        }
-    }
-out:
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
-static void ovsa_license_service_remove_quote_files(int client_fd) {
-    ovsa_status_t ret = OVSA_OK;
-    char tmp_dir[MAX_FILE_LEN];
-
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    ret = ovsa_license_service_remove_directory(tmp_dir);
-    OVSA_DBG(DBG_D, "OVSA:Removed the Quote files from /opt/ovsa/tmp_dir directory\n");
+    OVSA_DBG(DBG_D, "%s:%04d: |%d| %s", basename, line, level, str);
 }
 static ovsa_status_t ovsa_license_service_send_nonce_to_client(void** _ssl_session,
                                                                const char* json_payload) {
@@ -274,143 +289,31 @@ out:
     return ret;
 }
 
-static int ovsa_license_service_do_run_tpm2_command(char* const argv[], char* output) {
-    ovsa_status_t ret     = OVSA_OK;
-    size_t cmd_output_len = 0;
-    int child_status = 0, nbytes = 0, link[2];
-    pid_t child_pid;
-    char cmd_output[MAX_BUF_SIZE];
-    char error_output[MAX_BUF_SIZE];
-    int dup2_ret    = 0;
-    int waitpid_ret = 0;
-
-    if ((argv == NULL) || (argv[0] == NULL)) {
-        OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed with invalid parameter\n");
-        return OVSA_INVALID_PARAMETER;
-    }
-
-    if (pipe(link) == -1) {
-        OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed in creating pipe\n");
-        return OVSA_SYSCALL_READ_PIPE_FAIL;
-    }
-    child_pid = fork();
-    if (child_pid == 0) {
-        int err = -1;
-        if (dup2(link[1], STDOUT_FILENO) == -1) {
-            OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed in dup2 syscall\n");
-            close(link[1]);
-            return OVSA_SYSCALL_DUP2_FAIL;
-        }
-        close(link[0]);
-        close(link[1]);
-        err = execve(argv[0], argv, NULL);
-        /* if it got here, it's an error */
-        OVSA_DBG(DBG_E, "OVSA: Error executing %s failed with error %s\n", argv[0],
-                 strerror(errno));
-        return OVSA_SYSCALL_EXECVE_FAIL;
-    } else if (child_pid < 0) {
-        OVSA_DBG(DBG_E, "OVSA: Error TPM2 command failed in fork\n");
-        close(link[0]);
-        close(link[1]);
-        return OVSA_SYSCALL_FORK_FAIL;
-    }
-    close(link[1]);
-
-    if (output != NULL) {
-        memset_s(cmd_output, sizeof(cmd_output), 0);
-        nbytes = read(link[0], cmd_output, sizeof(cmd_output));
-        if (nbytes > 0) {
-            cmd_output_len = strnlen_s(cmd_output, MAX_BUF_SIZE);
-            if (cmd_output_len == EOK) {
-                OVSA_DBG(DBG_E,
-                         "OVSA: Error tpm2 command failed in getting the size of the "
-                         "command output\n");
-                return OVSA_TPM2_GENERIC_ERROR;
-            }
-            if (memcpy_s(output, MAX_BUF_SIZE, cmd_output, cmd_output_len) != EOK) {
-                OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed in getting the output\n");
-                return OVSA_MEMIO_ERROR;
-            }
-        } else {
-            OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed in executing the tpm2 command\n");
-            return OVSA_TPM2_CMD_EXEC_FAIL;
-        }
-    }
-
-    if ((waitpid(child_pid, &child_status, 0)) == -1) {
-        OVSA_DBG(DBG_E, "OVSA: Error tpm2 command failed in waitpid\n");
-        close(link[0]);
-        return OVSA_SYSCALL_WAITPID_FAIL;
-    }
-    if (WIFEXITED(child_status)) {
-        int exit_status = WEXITSTATUS(child_status);
-        if (exit_status != 0) {
-            OVSA_DBG(DBG_E,
-                     "OVSA: Error execution of TPM2 command %s failed with exit_status %d \n",
-                     argv[1], exit_status);
-            memset_s(error_output, sizeof(error_output), 0);
-            nbytes = read(link[0], error_output, (sizeof(error_output) - 1));
-
-            if (nbytes > 0) {
-                int output_len = strnlen_s(error_output, (sizeof(error_output) - 1));
-                if (output_len == EOK) {
-                    OVSA_DBG(DBG_E,
-                             "OVSA: Error tpm2 command failed in getting the size of the "
-                             "command output\n");
-                    close(link[0]);
-                    return OVSA_TPM2_GENERIC_ERROR;
-                }
-                /* Added for KW issue */
-                output_len = (output_len == MAX_BUF_SIZE) ? (output_len - 1) : (output_len);
-                error_output[output_len] = '\0';
-                OVSA_DBG(DBG_E, "%s\n", error_output);
-            }
-            close(link[0]);
-            return OVSA_SYSCALL_WAITPID_FAIL;
-        }
-    }
-    close(link[0]);
-    return ret;
-}
-
 static ovsa_status_t ovsa_license_service_create_hwquote_hash_nonce(
-    char* hw_quote_nonce_file, ovsa_quote_info_t* sw_quote_info) {
+    ovsa_quote_info_t* sw_quote_info, unsigned char* hw_quote_nonce) {
     ovsa_status_t ret = OVSA_OK;
-    unsigned char ek_cert_hash[QUOTE_NONCE_HASH_SIZE];
-    int i = 0;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     /*compute hash of ek_cert*/
-    memset_s(ek_cert_hash, sizeof(ek_cert_hash), 0);
+    memset_s(hw_quote_nonce, QUOTE_NONCE_HASH_SIZE, 0);
 
     ret = ovsa_license_service_crypto_compute_hash(sw_quote_info->ek_cert, HASH_ALG_SHA256,
-                                                   ek_cert_hash, false /* FORMAT_BASE64 */);
+                                                   hw_quote_nonce, false /* FORMAT_BASE64 */);
     if (ret != OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error ek_cert hash generation failed with code %d\n", ret);
         goto out;
     }
 
-    /* write hw quote nounce to file  */
-    FILE* fquote_nonce = fopen(hw_quote_nonce_file, "w");
-    if (fquote_nonce == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error opening hw_quote_nonce.bin !\n");
-        ret = OVSA_FILEOPEN_FAIL;
-        goto out;
-    }
-    fwrite(ek_cert_hash, QUOTE_NONCE_HASH_SIZE, 1, fquote_nonce);
-    fclose(fquote_nonce);
-
 out:
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
 static ovsa_status_t ovsa_license_service_create_swquote_hash_nonce(
-    ovsa_quote_info_t* hw_quote_info, ovsa_quote_info_t* sw_quote_info, char* quote_nonce_file,
-    char* sw_quote_nonce_file) {
+    ovsa_quote_info_t* hw_quote_info, ovsa_quote_info_t* sw_quote_info,
+    const ovsa_tpm2_challenge_t* challenge, unsigned char* swquote_hash_nonce) {
     ovsa_status_t ret = OVSA_OK;
-    unsigned char swquote_hash_nonce[QUOTE_NONCE_HASH_SIZE];
     unsigned char hash[QUOTE_NONCE_HASH_SIZE];
     unsigned char nonce_bin_buff[QUOTE_NONCE_HASH_SIZE];
     int i = 0;
@@ -418,26 +321,16 @@ static ovsa_status_t ovsa_license_service_create_swquote_hash_nonce(
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     memset_s(nonce_bin_buff, sizeof(nonce_bin_buff), 0);
-    /* read quote nounce  */
-    FILE* fserver_nonce = fopen(quote_nonce_file, "rb");
-    if (fserver_nonce == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error opening quote_nonce.bin !\n");
-        ret = OVSA_FILEOPEN_FAIL;
-        goto out;
-    }
-
-    ret = fread(nonce_bin_buff, 1, QUOTE_NONCE_HASH_SIZE, fserver_nonce);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not read quote_nonce.bin failed with code %d\n", ret);
-        goto out;
-    }
-    fclose(fserver_nonce);
+    /* quote nonce sent to the client along with the credential */
+    memcpy_s(nonce_bin_buff, sizeof(nonce_bin_buff), challenge->quote_nonce,
+             (challenge->quote_nonce_len < sizeof(nonce_bin_buff)) ? challenge->quote_nonce_len
+                                                                   : sizeof(nonce_bin_buff));
 
     /* Generate HASH of hw quote details */
 
     /* 1. SHA-256 of HW Quote PCR */
     OVSA_DBG(DBG_I, "OVSA: Generate HASH of hw quote\n");
-    memset_s(swquote_hash_nonce, sizeof(swquote_hash_nonce), 0);
+    memset_s(swquote_hash_nonce, QUOTE_NONCE_HASH_SIZE, 0);
     memset_s(hash, sizeof(hash), 0);
     ret = ovsa_license_service_crypto_compute_hash(hw_quote_info->quote_pcr, HASH_ALG_SHA256, hash,
                                                    false /* FORMAT_BASE64 */);
@@ -495,152 +388,65 @@ static ovsa_status_t ovsa_license_service_create_swquote_hash_nonce(
         swquote_hash_nonce[i] |= nonce_bin_buff[i];
     }
 
-    FILE* fquote_nonce = fopen(sw_quote_nonce_file, "w");
-    if (fquote_nonce == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error opening sw_quote_nonce.bin !\n");
-        ret = OVSA_FILEOPEN_FAIL;
-        goto out;
-    }
-
-    fwrite(swquote_hash_nonce, QUOTE_NONCE_HASH_SIZE, 1, fquote_nonce);
-    fclose(fquote_nonce);
-
 out:
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
-static ovsa_status_t ovsa_license_service_tpm2_verifyquote(int client_fd,
+static ovsa_status_t ovsa_license_service_tpm2_verifyquote(const ovsa_tpm2_challenge_t* challenge,
                                                            ovsa_quote_info_t* hw_quote_info,
                                                            ovsa_quote_info_t* sw_quote_info) {
     ovsa_status_t ret = OVSA_OK;
-    char tmp_dir[MAX_FILE_LEN];
-    char ak_pub_pem_key_file[MAX_FILE_LEN];
-    char quote_nonce_file[MAX_FILE_LEN];
-    char sw_quote_nonce_file[MAX_FILE_LEN];
-    char hw_quote_nonce_file[MAX_FILE_LEN];
-    char swquote_sig_file[MAX_FILE_LEN];
-    char swquote_pcr_file[MAX_FILE_LEN];
-    char hwquote_pcr_file[MAX_FILE_LEN];
-    char hwquote_msg_file[MAX_FILE_LEN];
-    char hwquote_sig_file[MAX_FILE_LEN];
-    char ak_hwpub_pem_key_file[MAX_FILE_LEN];
-    char swquote_msg_file[MAX_FILE_LEN];
+    unsigned char sw_quote_nonce[QUOTE_NONCE_HASH_SIZE];
+    unsigned char hw_quote_nonce[QUOTE_NONCE_HASH_SIZE];
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    CREATE_FILE_PATH(tmp_dir, ak_pub_pem_key_file, TPM2_AK_PUB_PEM_KEY);
-    CREATE_FILE_PATH(tmp_dir, quote_nonce_file, QUOTE_NONCE);
-    CREATE_FILE_PATH(tmp_dir, swquote_sig_file, TPM2_SWQUOTE_SIG);
-    CREATE_FILE_PATH(tmp_dir, swquote_pcr_file, TPM2_SWQUOTE_PCR);
-    CREATE_FILE_PATH(tmp_dir, hwquote_pcr_file, TPM2_HWQUOTE_PCR);
-    CREATE_FILE_PATH(tmp_dir, hwquote_msg_file, TPM2_HWQUOTE_MSG);
-    CREATE_FILE_PATH(tmp_dir, hwquote_sig_file, TPM2_HWQUOTE_SIG);
-    CREATE_FILE_PATH(tmp_dir, ak_hwpub_pem_key_file, TPM2_AK_HWPUB_PEM_KEY);
-    CREATE_FILE_PATH(tmp_dir, swquote_msg_file, TPM2_SWQUOTE_MSG);
-    CREATE_FILE_PATH(tmp_dir, hw_quote_nonce_file, TPM2_HWQUOTE_NONCE_FILE);
-    CREATE_FILE_PATH(tmp_dir, sw_quote_nonce_file, TPM2_SWQUOTE_NONCE_FILE);
 
     if ((sw_quote_info->quote_pcr != NULL) && (hw_quote_info->quote_pcr != NULL)) {
         /* Create Hash challenge nonce for sw quote validation */
         ret = ovsa_license_service_create_swquote_hash_nonce(hw_quote_info, sw_quote_info,
-                                                             quote_nonce_file, sw_quote_nonce_file);
+                                                             challenge, sw_quote_nonce);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "Error create sw quote challenge nonce failed with code %d\n", ret);
             goto out;
         }
         /* Create Hash challenge nonce based SW quote ek_cert */
-        ret = ovsa_license_service_create_hwquote_hash_nonce(hw_quote_nonce_file, sw_quote_info);
+        ret = ovsa_license_service_create_hwquote_hash_nonce(sw_quote_info, hw_quote_nonce);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "Error create hw quote challenge nonce failed with code %d\n", ret);
             goto out;
         }
-
-        char* const verify_hw_quote_argv[] = {"/usr/bin/tpm2_checkquote",
-                                              "--public",
-                                              ak_hwpub_pem_key_file,
-                                              "--message",
-                                              hwquote_msg_file,
-                                              "--signature",
-                                              hwquote_sig_file,
-                                              "--hash-algorithm",
-                                              "sha256",
-                                              "--qualification",
-                                              hw_quote_nonce_file,
-                                              "--pcr",
-                                              hwquote_pcr_file,
-                                              0};
-
-        char* const verify_sw_quote_argv[] = {"/usr/bin/tpm2_checkquote",
-                                              "--public",
-                                              ak_pub_pem_key_file,
-                                              "--message",
-                                              swquote_msg_file,
-                                              "--signature",
-                                              swquote_sig_file,
-                                              "--hash-algorithm",
-                                              "sha256",
-                                              "--qualification",
-                                              sw_quote_nonce_file,
-                                              "--pcr",
-                                              swquote_pcr_file,
-                                              0};
         /* Verify SW quote */
-        ret = ovsa_license_service_do_run_tpm2_command(verify_sw_quote_argv, NULL);
+        ret = ovsa_license_service_tpm2_checkquote(sw_quote_info, (char*)sw_quote_nonce,
+                                                   sizeof(sw_quote_nonce));
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", verify_sw_quote_argv[0]);
+            OVSA_DBG(DBG_E, "OVSA: Error SW quote verification failed with code %d\n", ret);
             goto out;
         }
         OVSA_DBG(DBG_I, "SW Quote verification successful...\n");
 
         /* Verify HW quote */
-        ret = ovsa_license_service_do_run_tpm2_command(verify_hw_quote_argv, NULL);
+        ret = ovsa_license_service_tpm2_checkquote(hw_quote_info, (char*)hw_quote_nonce,
+                                                   sizeof(hw_quote_nonce));
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", verify_hw_quote_argv[0]);
+            OVSA_DBG(DBG_E, "OVSA: Error HW quote verification failed with code %d\n", ret);
             goto out;
         }
         OVSA_DBG(DBG_I, "HW Quote verification successful...\n");
     } else if ((sw_quote_info->quote_pcr != NULL) && (hw_quote_info->quote_pcr == NULL)) {
-        char* const verify_sw_quote_argv[] = {"/usr/bin/tpm2_checkquote",
-                                              "--public",
-                                              ak_pub_pem_key_file,
-                                              "--message",
-                                              swquote_msg_file,
-                                              "--signature",
-                                              swquote_sig_file,
-                                              "--hash-algorithm",
-                                              "sha256",
-                                              "--qualification",
-                                              quote_nonce_file,
-                                              "--pcr",
-                                              swquote_pcr_file,
-                                              0};
         /* Verify SW quote */
-        ret = ovsa_license_service_do_run_tpm2_command(verify_sw_quote_argv, NULL);
+        ret = ovsa_license_service_tpm2_checkquote(sw_quote_info, challenge->quote_nonce,
+                                                   challenge->quote_nonce_len);
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", verify_sw_quote_argv[0]);
+            OVSA_DBG(DBG_E, "OVSA: Error SW quote verification failed with code %d\n", ret);
             goto out;
         }
         OVSA_DBG(DBG_I, "SW Quote verification successful...\n");
     } else if ((hw_quote_info->quote_pcr != NULL) && (sw_quote_info->quote_pcr == NULL)) {
-        char* const verify_hw_quote_argv[] = {"/usr/bin/tpm2_checkquote",
-                                              "--public",
-                                              ak_hwpub_pem_key_file,
-                                              "--message",
-                                              hwquote_msg_file,
-                                              "--signature",
-                                              hwquote_sig_file,
-                                              "--hash-algorithm",
-                                              "sha256",
-                                              "--qualification",
-                                              quote_nonce_file,
-                                              "--pcr",
-                                              hwquote_pcr_file,
-                                              0};
-
         /* Verify HW quote */
-        ret = ovsa_license_service_do_run_tpm2_command(verify_hw_quote_argv, NULL);
+        ret = ovsa_license_service_tpm2_checkquote(hw_quote_info, challenge->quote_nonce,
+                                                   challenge->quote_nonce_len);
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", verify_hw_quote_argv[0]);
+            OVSA_DBG(DBG_E, "OVSA: Error HW quote verification failed with code %d\n", ret);
             goto out;
         }
         OVSA_DBG(DBG_I, "HW Quote verification successful...\n");
@@ -650,821 +456,187 @@ out:
     return ret;
 }
 
-static ovsa_status_t ovsa_license_service_do_verify_pcr_ids(TPML_PCR_SELECTION* pcr_select,
-                                                            tpm2_pcrs* pcrs,
-                                                            TPML_PCR_SELECTION* golden_pcr_select,
-                                                            tpm2_pcrs* golden_pcrs,
-                                                            int pcr_id_set) {
+static ovsa_status_t ovsa_license_service_extract_SW_quote_info(char* payload_quote_info,
+                                                                ovsa_quote_info_t* sw_quote_info) {
     ovsa_status_t ret = OVSA_OK;
-    uint32_t vi = 0, di = 0, i = 0, j = 0;
-    uint32_t result = 0;
-    uint32_t pcr_id = 0, golden_pcr_id = 0;
-    int k = 0, diff = 0;
-    char received_pcrbuf[sizeof(TPMU_HA) + 1];
-    char golden_pcrbuf[sizeof(TPMU_HA) + 1];
-    char pcrval[PCR_VAL_MAX_LEN + 1];
-    bool is_valid_PCR = false;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    if ((pcr_select->count > TPM2_NUM_PCR_BANKS) ||
-        (golden_pcr_select->count > TPM2_NUM_PCR_BANKS)) {
-        ret = OVSA_PCR_COUNT_NOT_VALID;
-        OVSA_DBG(DBG_E, "OVSA: Error pcr_select count is greater than MAX PCR_BANK value %d\n",
-                 TPM2_NUM_PCR_BANKS);
-        goto out;
-    }
-
-    /* Loop through all PCR/hash banks */
-    for (i = 0, j = 0; i < pcr_select->count && j < golden_pcr_select->count; i++, j++) {
-        /* Loop through all PCRs in this bank */
-        for (pcr_id = 0, golden_pcr_id = 0;
-             (pcr_id < pcr_select->pcrSelections[i].sizeofSelect * 8u) &&
-             (golden_pcr_id < golden_pcr_select->pcrSelections[j].sizeofSelect * 8u);
-             pcr_id++, golden_pcr_id++) {
-            TPMS_PCR_SELECTION* pcr_selection = &pcr_select->pcrSelections[i];
-            if ((pcr_id / 8) >= TPM2_PCR_SELECT_MAX) {
-                ret = OVSA_PCR_ID_NOT_VALID;
-                OVSA_DBG(DBG_E, "OVSA: Error pcr_id is greater than Max value %d\n", TPM2_MAX_PCRS);
-                goto out;
-            }
-            if (!(pcr_selection->pcrSelect[((pcr_id) / 8)] & (1 << ((pcr_id) % 8)))) {
-                OVSA_DBG(DBG_D, "OVSA:Skip PCR \n");
-                continue;
-            }
-            TPMS_PCR_SELECTION* golden_pcr_selection = &golden_pcr_select->pcrSelections[i];
-            if ((golden_pcr_id / 8) >= TPM2_PCR_SELECT_MAX) {
-                ret = OVSA_PCR_ID_NOT_VALID;
-                OVSA_DBG(DBG_E, "OVSA: Error golden_pcr_id is greater than Max value %d\n",
-                         TPM2_MAX_PCRS);
-                goto out;
-            }
-            if (!(golden_pcr_selection->pcrSelect[((golden_pcr_id) / 8)] &
-                  (1 << ((golden_pcr_id) % 8)))) {
-                OVSA_DBG(DBG_D, "OVSA:Skip golden PCR \n");
-                continue;
-            }
-            TPM2B_DIGEST* b        = &pcrs->pcr_values[vi].digests[di];
-            TPM2B_DIGEST* golden_b = &golden_pcrs->pcr_values[vi].digests[di];
-
-            /*Step 1: Extract received PCR values */
-            memset_s(received_pcrbuf, sizeof(received_pcrbuf), 0);
-            memset_s(pcrval, sizeof(pcrval), 0);
-            if (b->size > sizeof(TPMU_HA)) {
-                ret = OVSA_PCR_DIGEST_NOT_VALID;
-                OVSA_DBG(DBG_E, "OVSA: Error pcr value digest is greater than MAX value %ld\n",
-                         sizeof(TPMU_HA));
-                goto out;
-            }
-            for (k = 0; k < b->size; k++) {
-                snprintf(pcrval, PCR_VAL_MAX_LEN + 1, "%02X", b->buffer[k]);
-                strcat_s(received_pcrbuf, strnlen_s(pcrval, PCR_VAL_MAX_LEN), pcrval);
-                memset_s(pcrval, sizeof(pcrval), 0);
-            }
-
-            /*Step 2: Extract golden PCR values */
-            memset_s(golden_pcrbuf, sizeof(golden_pcrbuf), 0);
-            memset_s(pcrval, sizeof(pcrval), 0);
-            if (golden_b->size > sizeof(TPMU_HA)) {
-                ret = OVSA_PCR_DIGEST_NOT_VALID;
-                OVSA_DBG(DBG_E,
-                         "OVSA: Error golden pcr value digest is greater than MAX value %ld\n",
-                         sizeof(TPMU_HA));
-                goto out;
-            }
-            for (k = 0; k < golden_b->size; k++) {
-                snprintf(pcrval, PCR_VAL_MAX_LEN + 1, "%02X", (golden_b->buffer[k]));
-                strcat_s(golden_pcrbuf, strnlen_s(pcrval, PCR_VAL_MAX_LEN), pcrval);
-                memset_s(pcrval, sizeof(pcrval), 0);
-            }
-            /*Step 3 : Validate received PCR value */
-            if (pcr_id_set & (1 << pcr_id)) {
-                result = memcmp_s(golden_pcrbuf, golden_b->size, received_pcrbuf, b->size, &diff);
-                if (result != EOK) {
-                    OVSA_DBG(DBG_E, "OVSA: Error while validating pcr_id %d \n", pcr_id);
-                    ret = OVSA_PCR_VALIDATION_FAILED;
-                    goto out;
-                }
-                if (0 == diff) {
-                    is_valid_PCR = true;
-                    OVSA_DBG(DBG_D, "OVSA:Validate pcr_id:%d \n", pcr_id);
-                } else {
-                    OVSA_DBG(DBG_E, "OVSA: Error received pcr_id:%d is not valid \n %2d: 0x%s\n",
-                             pcr_id, pcr_id, received_pcrbuf);
-                    is_valid_PCR = false;
-                    break;
-                }
-            }
-            if (++di < pcrs->pcr_values[vi].count) {
-                continue;
-            }
-            di = 0;
-            if (++vi < pcrs->count) {
-                continue;
-            }
-        }
-    }
-    if (!is_valid_PCR) {
-        OVSA_DBG(DBG_E, "OVSA: Error TPM2_PCR Validation failed\n");
-        ret = OVSA_PCR_VALIDATION_FAILED;
+    /* Read pcr_list from json file */
+    ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_PCR",
+                                                    &sw_quote_info->quote_pcr);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read pcr_list payload from json failed %d\n", ret);
         goto out;
     }
-
+    if (sw_quote_info->quote_pcr != NULL) {
+        /* Read quote_message from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_MSG",
+                                                        &sw_quote_info->quote_message);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read quote_message payload from json failed %d\n", ret);
+            goto out;
+        }
+        /* Read quote_signature from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_SIG",
+                                                        &sw_quote_info->quote_sig);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read quote_signature payload from json failed %d\n", ret);
+            goto out;
+        }
+        /* Read SW_pub_key from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_AK_Pub_key",
+                                                        &sw_quote_info->ak_pub_key);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read SW_pub_key payload from json failed %d\n", ret);
+            goto out;
+        }
+        /* Read sw_ek_cert from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_EK_Cert",
+                                                        &sw_quote_info->ek_cert);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read sw_ek_cert payload from json failed %d\n", ret);
+            goto out;
+        }
+        OVSA_DBG(DBG_D, "OVSA: sw_quote_info.ek_cert %s \n", sw_quote_info->ek_cert);
+    }
 out:
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
-
-static ovsa_status_t ovsa_license_service_do_validate_pcr(char* quote_pcr_file, char* golden_quote,
-                                                          int pcr_id_set) {
-    ovsa_status_t ret              = OVSA_OK;
-    char* golden_pcr_bin_base_addr = NULL;
-    char* golden_pcr_bin_buff      = NULL;
-    size_t golden_pcr_bin_length   = 0;
-    size_t size                    = 0;
-    uint32_t count = 0, golden_count = 0, j = 0;
-    TPML_PCR_SELECTION pcr_selections, golden_pcr_selections;
-    tpm2_pcrs pcrs, golden_pcrs;
+static ovsa_status_t ovsa_license_service_do_validate_tpm_quote(
+    ovsa_customer_license_sig_t* customer_lic_sig, ovsa_quote_info_t hw_quote_info,
+    ovsa_quote_info_t sw_quote_info) {
+    ovsa_status_t ret = OVSA_OK;
+    ovsa_tpm2_pcr_digests_t sw_pcrs, hw_pcrs;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    OVSA_DBG(DBG_D, "OVSA:Read received pcr_bin values\n");
-
-    /* Read pcr_bin to file */
-    FILE* fptr_pcr_bin = fopen(quote_pcr_file, "rb");
-    if (fptr_pcr_bin == NULL) {
-        ret = OVSA_FILEOPEN_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error opening file pcr.bin failed with code %d\n", ret);
-        goto out;
-    }
-
-    /* First read TPML_PCR_SELECTION */
-    if (!fread(&pcr_selections, sizeof(TPML_PCR_SELECTION), 1, fptr_pcr_bin)) {
-        ret = OVSA_FILEIO_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error read received TPML_PCR_SELECTION file failed with code %d\n",
-                 ret);
-        fclose(fptr_pcr_bin);
-        goto out;
-    }
-    if (!fread(&count, sizeof(uint32_t), 1, fptr_pcr_bin)) {
-        ret = OVSA_FILEIO_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error read received pcr_selection count failed with code %d\n", ret);
-        fclose(fptr_pcr_bin);
-        goto out;
-    }
-    if (count > TPM2_MAX_PCRS) {
-        ret = OVSA_PCR_COUNT_NOT_VALID;
-        OVSA_DBG(DBG_E, "OVSA: Error validate pcr failed with return code %d \n", ret);
-        fclose(fptr_pcr_bin);
-        goto out;
-    }
-    pcrs.count = count;
 
-    for (j = 0; j < count; j++) {
-        if (!fread(&pcrs.pcr_values[j], sizeof(TPML_DIGEST), 1, fptr_pcr_bin)) {
-            ret = OVSA_FILEIO_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error read received pcr_values failed with code %d\n", ret);
-            fclose(fptr_pcr_bin);
+    memset_s(&sw_pcrs, sizeof(ovsa_tpm2_pcr_digests_t), 0);
+    memset_s(&hw_pcrs, sizeof(ovsa_tpm2_pcr_digests_t), 0);
+    /* Decode the received PCRs once, they are compared against every TCB of the license */
+    if (sw_quote_info.quote_pcr != NULL) {
+        OVSA_DBG(DBG_D, "OVSA:Read received sw pcr_bin values\n");
+        ret = ovsa_license_service_tpm2_decode_pcr_digests(sw_quote_info.quote_pcr, &sw_pcrs);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read received sw pcr values failed with code %d\n",
+                     ret);
             goto out;
         }
     }
-    fclose(fptr_pcr_bin);
-    OVSA_DBG(DBG_D, "OVSA:Read golden pcr_bin values\n");
-    ret = ovsa_license_service_get_string_length(golden_quote, &size);
-    ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &golden_pcr_bin_base_addr);
-    if (ret < OVSA_OK || golden_pcr_bin_base_addr == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-        goto out;
-    }
-    golden_pcr_bin_buff = golden_pcr_bin_base_addr;
-    ret = ovsa_license_service_crypto_convert_base64_to_bin(golden_quote, size, golden_pcr_bin_buff,
-                                                            &golden_pcr_bin_length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-        goto out;
-    }
-    /* First read TPML_PCR_SELECTION */
-    memcpy_s(&golden_pcr_selections, sizeof(TPML_PCR_SELECTION), golden_pcr_bin_buff,
-             sizeof(TPML_PCR_SELECTION));
-    golden_pcr_bin_buff += sizeof(TPML_PCR_SELECTION);
-    memcpy_s(&golden_count, sizeof(uint32_t), golden_pcr_bin_buff, sizeof(uint32_t));
-    golden_pcrs.count = golden_count;
-    golden_pcr_bin_buff += sizeof(uint32_t);
-
-    if (golden_count > TPM2_MAX_PCRS) {
-        ret = OVSA_PCR_COUNT_NOT_VALID;
-        OVSA_DBG(DBG_E, "OVSA: Error validate pcr failed with return code %d \n", ret);
-        goto out;
-    }
-    for (j = 0; j < golden_count; j++) {
-        memcpy_s(&golden_pcrs.pcr_values[j], sizeof(TPML_DIGEST), golden_pcr_bin_buff,
-                 sizeof(TPML_DIGEST));
-        golden_pcr_bin_buff += sizeof(TPML_DIGEST);
+    if (hw_quote_info.quote_pcr != NULL) {
+        OVSA_DBG(DBG_D, "OVSA:Read received hw pcr_bin values\n");
+        ret = ovsa_license_service_tpm2_decode_pcr_digests(hw_quote_info.quote_pcr, &hw_pcrs);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read received hw pcr values failed with code %d\n",
+                     ret);
+            goto out;
+        }
     }
-    ret = ovsa_license_service_do_verify_pcr_ids(&pcr_selections, &pcrs, &golden_pcr_selections,
-                                                 &golden_pcrs, pcr_id_set);
+    ret = ovsa_license_service_tcb_cache_validate(
+        customer_lic_sig->customer_lic.license_guid, customer_lic_sig->customer_lic.tcb_signatures,
+        (sw_quote_info.quote_pcr != NULL) ? &sw_pcrs : NULL,
+        (hw_quote_info.quote_pcr != NULL) ? &hw_pcrs : NULL);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error validate pcr failed with return code %d \n", ret);
+        OVSA_DBG(DBG_E, "OVSA: Error TCB Validation failed\n");
+        ret = OVSA_TCB_VALIDATION_FAILED;
         goto out;
+    } else {
+        OVSA_DBG(DBG_I, "OVSA:TCB check PASS \n\n");
     }
 
 out:
-    ovsa_license_service_safe_free(&golden_pcr_bin_base_addr);
+    ovsa_license_service_tpm2_free_pcr_digests(&sw_pcrs);
+    ovsa_license_service_tpm2_free_pcr_digests(&hw_pcrs);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
-static ovsa_status_t ovsa_license_service_do_validate_sw_hw_pcrs(ovsa_tcb_sig_t tsig, int client_fd,
-                                                                 ovsa_quote_info_t sw_quote_info,
-                                                                 ovsa_quote_info_t hw_quote_info,
-                                                                 bool* is_valid_TCB) {
+
+static ovsa_status_t ovsa_license_service_do_validate_secret(
+    char* payload_quote_info, const ovsa_tpm2_challenge_t* challenge) {
     ovsa_status_t ret = OVSA_OK;
-    char tmp_dir[MAX_FILE_LEN];
-    bool is_valid_swpcr = false;
-    bool is_valid_hwpcr = false;
+    char* secret_buf  = NULL;
 
-    *is_valid_TCB = false;
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-
-    if (strcmp(tsig.tcbinfo.sw_quote, "")) {
-        char swquote_pcr_file[MAX_FILE_LEN];
-        static char sw_pcr_id[TPM2_MAX_PCRS];
-        char* getenv_swpcr_id  = NULL;
-        int sw_pcr_id_set      = 0;
-        char* sw_pcr_id_endptr = NULL;
-
-        OVSA_DBG(DBG_D, "OVSA:Validate SWPCR\n");
-
-        CREATE_FILE_PATH(tmp_dir, swquote_pcr_file, TPM2_SWQUOTE_PCR);
-
-        strcpy_s(sw_pcr_id, sizeof(sw_pcr_id), tsig.tcbinfo.sw_pcr_id_set);
-        sw_pcr_id_set = (int)strtol(sw_pcr_id, &sw_pcr_id_endptr, 16);
-        if (*sw_pcr_id_endptr != '\0') {
-            OVSA_DBG(DBG_I, "OVSA:WARNING: sw_pcr_id='%s' is not valid hex value \n", sw_pcr_id);
-            OVSA_DBG(DBG_I, "OVSA:Validate SWPCR_ID_SET is set to default value 0xFFFFFF\n");
-            sw_pcr_id_set = (int)strtol(DEFAULT_PCR_ID_SET, NULL, 16);
-        }
-        if (!((sw_pcr_id_set > 0) && (sw_pcr_id_set <= 0xffffff))) {
-            OVSA_DBG(DBG_I,
-                     "OVSA: WARNING: sw_pcr_id=%s is not valid [valid range=0x1:0xffffff] "
-                     "\nValidate SWPCR_ID_SET is set to default value 0xFFFFFF\n",
-                     sw_pcr_id);
-            sw_pcr_id_set = (int)strtol(DEFAULT_PCR_ID_SET, NULL, 16);
-        }
-        /*Validate SW pcr_ids*/
-        OVSA_DBG(DBG_D, "OVSA:Validate sw_pcr_ids ,SET_SWPCR_ID:0x%x \n", sw_pcr_id_set);
-        ret = ovsa_license_service_do_validate_pcr(swquote_pcr_file, tsig.tcbinfo.sw_quote,
-                                                   sw_pcr_id_set);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error TPM2_SWPCR check failed with code %d\n", ret);
-            goto out;
-        } else {
-            is_valid_swpcr = true;
-            OVSA_DBG(DBG_D, "OVSA:TPM2_SWPCR check PASS\n");
-        }
-    }
-
-    if (strcmp(tsig.tcbinfo.hw_quote, "")) {
-        char hwquote_pcr_file[MAX_FILE_LEN];
-        static char hw_pcr_id[TPM2_MAX_PCRS];
-        char* getenv_hwpcr_id  = NULL;
-        int hw_pcr_id_set      = 0;
-        char* hw_pcr_id_endptr = NULL;
-
-        OVSA_DBG(DBG_D, "OVSA:Validate HWPCR\n");
-
-        CREATE_FILE_PATH(tmp_dir, hwquote_pcr_file, TPM2_HWQUOTE_PCR);
-        /*Set HWPCR_IDs for validation*/
-        strcpy_s(hw_pcr_id, sizeof(hw_pcr_id), tsig.tcbinfo.hw_pcr_id_set);
-        hw_pcr_id_set = (int)strtol(hw_pcr_id, &hw_pcr_id_endptr, 16);
-        if (*hw_pcr_id_endptr != '\0') {
-            OVSA_DBG(DBG_I, "OVSA:WARNING: hw_pcr_id='%s' is not valid hex value \n", hw_pcr_id);
-            OVSA_DBG(DBG_I, "OVSA:Validate HWPCR_ID_SET is set to default value 0xFFFFFF\n");
-            hw_pcr_id_set = (int)strtol(DEFAULT_PCR_ID_SET, NULL, 16);
-        }
-        if (!((hw_pcr_id_set > 0) && (hw_pcr_id_set <= 0xffffff))) {
-            OVSA_DBG(DBG_I,
-                     "OVSA: WARNING: hw_pcr_id=%s is not valid [valid range=0x1:0xffffff] "
-                     "\nValidate HWPCR_ID_SET is set to default value 0xFFFFFF\n",
-                     hw_pcr_id);
-            hw_pcr_id_set = (int)strtol(DEFAULT_PCR_ID_SET, NULL, 16);
-        }
-        /*Validate HW pcr_ids*/
-        OVSA_DBG(DBG_D, "OVSA:Validate hw_pcr_ids ,SET_HWPCR_ID:0x%x \n", hw_pcr_id_set);
-        ret = ovsa_license_service_do_validate_pcr(hwquote_pcr_file, tsig.tcbinfo.hw_quote,
-                                                   hw_pcr_id_set);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error TPM2_HWPCR check failed with code %d\n", ret);
-            goto out;
-        } else {
-            is_valid_hwpcr = true;
-            OVSA_DBG(DBG_D, "OVSA:TPM2_HWPCR check PASS\n\n");
-        }
-    }
-    if ((strcmp(tsig.tcbinfo.sw_quote, "") && (!is_valid_swpcr)) ||
-        (strcmp(tsig.tcbinfo.hw_quote, "") && (!is_valid_hwpcr)) ||
-        ((strcmp(tsig.tcbinfo.sw_quote, "") && strcmp(tsig.tcbinfo.hw_quote, "")) &&
-         ((!is_valid_swpcr) && (!is_valid_hwpcr)))) {
-        OVSA_DBG(DBG_E, "OVSA: Error TPM2_PCR Validation failed\n");
-        ret = OVSA_PCR_VALIDATION_FAILED;
+    /* Read received secret from json file */
+    ret = ovsa_license_service_json_extract_element(payload_quote_info, "Secret", &secret_buf);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
         goto out;
+    }
+    /* Compare with the secret protected in the credential */
+    if ((secret_buf != NULL) && (challenge->secret[0] != '\0') &&
+        !(strcmp(secret_buf, challenge->secret))) {
+        OVSA_DBG(DBG_I, "\nOVSA: Secret Validation PASS\n\n");
     } else {
-        OVSA_DBG(DBG_I, "OVSA:TPM2_PCR check PASS \n\n");
-    }
-    /*Is valide TCB */
-    if ((((sw_quote_info.quote_pcr != NULL) && (hw_quote_info.quote_pcr != NULL)) &&
-         ((is_valid_swpcr) && (is_valid_hwpcr))) ||
-        (((sw_quote_info.quote_pcr != NULL) && (hw_quote_info.quote_pcr == NULL)) &&
-         (is_valid_swpcr)) ||
-        (((hw_quote_info.quote_pcr != NULL) && (sw_quote_info.quote_pcr == NULL)) &&
-         (is_valid_hwpcr))) {
-        *is_valid_TCB = true;
-    } else {
-        ret = OVSA_TCB_NOT_VALID;
+        ret = OVSA_TPM2_CREDENTIAL_SECRET_VALIDATION_FAILED;
+        OVSA_DBG(DBG_E, "OVSA: Error secret Validation failed %d\n", ret);
     }
 out:
+    ovsa_license_service_safe_free(&secret_buf);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
-static ovsa_status_t ovsa_license_service_extract_SW_quote_info(char* payload_quote_info,
+static ovsa_status_t ovsa_license_service_extract_HW_quote_info(char* payload_quote_info,
                                                                 ovsa_quote_info_t* sw_quote_info,
-                                                                int client_fd) {
-    ovsa_status_t ret                     = OVSA_OK;
-    char* pcr_quote_message_bin_buff      = NULL;
-    size_t pcr_quote_message_bin_length   = 0;
-    char* pcr_quote_signature_bin_buff    = NULL;
-    size_t pcr_quote_signature_bin_length = 0;
-    char* pcr_bin_buff                    = NULL;
-    size_t pcr_bin_length                 = 0;
-    char* ek_cert_buff                    = NULL;
-    size_t ek_cert_length                 = 0;
-    size_t size                           = 0;
-    char tmp_dir[MAX_FILE_LEN];
-    char swquote_sig_file[MAX_FILE_LEN];
-    char ak_pub_pem_key_file[MAX_FILE_LEN];
-    char swquote_pcr_file[MAX_FILE_LEN];
-    char swquote_msg_file[MAX_FILE_LEN];
-    char swquote_ek_cert_file[MAX_FILE_LEN];
+                                                                ovsa_quote_info_t* hw_quote_info) {
+    ovsa_status_t ret = OVSA_OK;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    CREATE_FILE_PATH(tmp_dir, swquote_sig_file, TPM2_SWQUOTE_SIG);
-    CREATE_FILE_PATH(tmp_dir, ak_pub_pem_key_file, TPM2_AK_PUB_PEM_KEY);
-    CREATE_FILE_PATH(tmp_dir, swquote_pcr_file, TPM2_SWQUOTE_PCR);
-    CREATE_FILE_PATH(tmp_dir, swquote_msg_file, TPM2_SWQUOTE_MSG);
-    CREATE_FILE_PATH(tmp_dir, swquote_ek_cert_file, TPM2_SWQUOTE_EK_CERT);
-
     /* Read pcr_list from json file */
-    ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_PCR",
-                                                    &sw_quote_info->quote_pcr);
+    ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_PCR",
+                                                    &hw_quote_info->quote_pcr);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error read pcr_list payload from json failed %d\n", ret);
         goto out;
     }
-    if (sw_quote_info->quote_pcr != NULL) {
-        ret = ovsa_license_service_get_string_length(sw_quote_info->quote_pcr, &size);
-        ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_bin_buff);
-        if (ret < OVSA_OK || pcr_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(sw_quote_info->quote_pcr, size,
-                                                                pcr_bin_buff, &pcr_bin_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write pcr_bin to file */
-        FILE* fptr_pcr_bin = fopen(swquote_pcr_file, "wb");
-        if (fptr_pcr_bin == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file sw quote pcr.bin failed with code %d\n", ret);
-            goto out;
-        }
-        fwrite(pcr_bin_buff, pcr_bin_length, 1, fptr_pcr_bin);
-        fclose(fptr_pcr_bin);
-
-        /* Read quote_message from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_MSG",
-                                                        &sw_quote_info->quote_message);
+    if (hw_quote_info->quote_pcr != NULL) {
+        /* Read quote_message from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_MSG",
+                                                        &hw_quote_info->quote_message);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error read quote_message payload from json failed %d\n", ret);
             goto out;
         }
-
-        ret = ovsa_license_service_get_string_length(sw_quote_info->quote_message, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_quote_message_bin_buff);
-        if (ret < OVSA_OK || pcr_quote_message_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(sw_quote_info->quote_message, size,
-                                                                pcr_quote_message_bin_buff,
-                                                                &pcr_quote_message_bin_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write pcr_quote_message to file */
-        FILE* fptr_pcr_quote_message = fopen(swquote_msg_file, "w");
-        if (fptr_pcr_quote_message == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file pcr_quote.plain failed with code %d\n", ret);
-            goto out;
-        }
-        fwrite(pcr_quote_message_bin_buff, pcr_quote_message_bin_length, 1, fptr_pcr_quote_message);
-        fclose(fptr_pcr_quote_message);
-
-        /* Read quote_signature from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_Quote_SIG",
-                                                        &sw_quote_info->quote_sig);
+        /* Read quote_signature from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_SIG",
+                                                        &hw_quote_info->quote_sig);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error read quote_signature payload from json failed %d\n", ret);
             goto out;
         }
-
-        ret = ovsa_license_service_get_string_length(sw_quote_info->quote_sig, &size);
+        /* Read HW_pub_key from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_AK_Pub_Key",
+                                                        &hw_quote_info->ak_pub_key);
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            goto out;
-        }
-        ret =
-            ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_quote_signature_bin_buff);
-        if (ret < OVSA_OK || pcr_quote_signature_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
+            OVSA_DBG(DBG_E, "OVSA: Error read HW_pub_key payload from json failed %d\n", ret);
             goto out;
         }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(sw_quote_info->quote_sig, size,
-                                                                pcr_quote_signature_bin_buff,
-                                                                &pcr_quote_signature_bin_length);
+        /* Read hw_ek_cert from json blob */
+        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_EK_Cert",
+                                                        &hw_quote_info->ek_cert);
         if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
+            OVSA_DBG(DBG_E, "OVSA: Error read hw_ek_cert payload from json failed %d\n", ret);
             goto out;
         }
-        /* write pcr_quote_signature to file */
-        FILE* fptr_pcr_quote_signature = fopen(swquote_sig_file, "wb");
-        if (fptr_pcr_quote_signature == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file pcr_quote.signature failed with code %d\n",
-                     ret);
-            goto out;
+        if ((sw_quote_info->quote_pcr != NULL) && (hw_quote_info->quote_pcr != NULL)) {
+            OVSA_DBG(DBG_I, "OVSA: Verifying HW EK Certificate...\n");
+            ret = ovsa_license_service_crypto_verify_certificate(hw_quote_info->ek_cert,
+                                                                 NULL /* Chain Certificate */);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error HW EK certificate verification failed %d\n", ret);
+                goto out;
+            }
+            OVSA_DBG(DBG_I, "OVSA: HW EK Certificate verification successful...\n");
         }
-        fwrite(pcr_quote_signature_bin_buff, pcr_quote_signature_bin_length, 1,
-               fptr_pcr_quote_signature);
-        fclose(fptr_pcr_quote_signature);
-
-        /* Read SW_pub_key from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_AK_Pub_key",
-                                                        &sw_quote_info->ak_pub_key);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read SW_pub_key payload from json failed %d\n", ret);
-            goto out;
-        }
-        /* write SW_pub_key to file */
-        FILE* fptr_SW_pub_key = fopen(ak_pub_pem_key_file, "w+");
-        if (fptr_SW_pub_key == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file SW_pub_key.pub failed with code %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_get_string_length(sw_quote_info->ak_pub_key, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            fclose(fptr_SW_pub_key);
-            goto out;
-        }
-        fwrite(sw_quote_info->ak_pub_key, size, 1, fptr_SW_pub_key);
-        fclose(fptr_SW_pub_key);
-
-        /* Read sw_ek_cert from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "SW_EK_Cert",
-                                                        &sw_quote_info->ek_cert);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read sw_ek_cert payload from json failed %d\n", ret);
-            goto out;
-        }
-        size = 0;
-        ret  = ovsa_license_service_get_string_length(sw_quote_info->ek_cert, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &ek_cert_buff);
-        if (ret < OVSA_OK || ek_cert_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(sw_quote_info->ek_cert, size,
-                                                                ek_cert_buff, &ek_cert_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write ek_cert to file */
-        FILE* fptr_ek_cert = fopen(swquote_ek_cert_file, "wb");
-        if (fptr_ek_cert == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file ek_cert failed with code %d\n", ret);
-            goto out;
-        }
-        fwrite(ek_cert_buff, ek_cert_length, 1, fptr_ek_cert);
-        OVSA_DBG(DBG_D, "OVSA: sw_quote_info.ek_cert %s \n", sw_quote_info->ek_cert);
-        fclose(fptr_ek_cert);
-    }
-out:
-    ovsa_license_service_safe_free(&pcr_quote_message_bin_buff);
-    ovsa_license_service_safe_free(&ek_cert_buff);
-    ovsa_license_service_safe_free(&pcr_bin_buff);
-    ovsa_license_service_safe_free(&pcr_quote_signature_bin_buff);
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
-static ovsa_status_t ovsa_license_service_do_validate_tpm_quote(
-    ovsa_customer_license_sig_t* customer_lic_sig, int client_fd, ovsa_quote_info_t hw_quote_info,
-    ovsa_quote_info_t sw_quote_info) {
-    ovsa_status_t ret             = OVSA_OK;
-    ovsa_tcb_sig_list_t* tcb_list = NULL;
-    char* tcb_signature           = NULL;
-    ovsa_tcb_sig_t tsig;
-    bool is_valid_TCB = false;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-
-    tcb_list                     = customer_lic_sig->customer_lic.tcb_signatures;
-    tsig.tcbinfo.isv_certificate = NULL;
-    if (tcb_list == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error tcb signature empty  \n");
-    } else {
-        while (tcb_list != NULL) {
-            tcb_signature = tcb_list->tcb_signature;
-            /* Read TCB info from tcb_signature */
-            memset_s(&tsig, sizeof(ovsa_tcb_sig_t), 0);
-            ret = ovsa_license_service_json_extract_tcb_signature(tcb_signature, &tsig);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error read tcb_signature failed %d\n", ret);
-                goto out;
-            }
-            ovsa_license_service_safe_free(&tsig.tcbinfo.isv_certificate);
-            OVSA_DBG(DBG_D, "\n\n");
-            OVSA_DBG(DBG_D, "OVSA:TCB_NAME    : '%s' \n", tsig.tcbinfo.tcb_name);
-            if (strcmp(tsig.tcbinfo.sw_quote, "")) {
-                OVSA_DBG(DBG_D, "OVSA:sw_quote    : '%s' \n", tsig.tcbinfo.sw_quote);
-                OVSA_DBG(DBG_D, "OVSA:sw_pub_key  : '%s' \n", tsig.tcbinfo.sw_pub_key);
-            }
-            if (strcmp(tsig.tcbinfo.hw_quote, "")) {
-                OVSA_DBG(DBG_D, "OVSA:hw_quote    : '%s' \n", tsig.tcbinfo.hw_quote);
-                OVSA_DBG(DBG_D, "OVSA:hw_pub_key  : '%s' \n", tsig.tcbinfo.hw_pub_key);
-            }
-            OVSA_DBG(DBG_D, "\n");
-            ret = ovsa_license_service_do_validate_sw_hw_pcrs(tsig, client_fd, sw_quote_info,
-                                                              hw_quote_info, &is_valid_TCB);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_I, "OVSA:Customer '%s' is not valid\n", tsig.tcbinfo.tcb_name);
-            } else if (is_valid_TCB) {
-                OVSA_DBG(DBG_I, "OVSA:Customer '%s' is valid\n", tsig.tcbinfo.tcb_name);
-                break;
-            }
-            tcb_list = tcb_list->next;
-        }
-    }
-    if (!is_valid_TCB) {
-        OVSA_DBG(DBG_E, "OVSA: Error TCB Validation failed\n");
-        ret = OVSA_TCB_VALIDATION_FAILED;
-        goto out;
-    } else {
-        OVSA_DBG(DBG_I, "OVSA:TCB check PASS \n\n");
-    }
-
-out:
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
-
-static ovsa_status_t ovsa_license_service_do_validate_secret(char* payload_quote_info,
-                                                             int client_fd) {
-    ovsa_status_t ret    = OVSA_OK;
-    char* secret_buf     = NULL;
-    char* credsecret_buf = NULL;
-    size_t file_size     = 0;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-
-    /* Read received secret from json file */
-    ret = ovsa_license_service_json_extract_element(payload_quote_info, "Secret", &secret_buf);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
-        goto out;
-    }
-    /* Read credential secret nonce */
-    file_size = 0;
-    char tmp_nonce_file[MAX_FILE_LEN];
-    CREATE_TMP_DIR_PATH(tmp_nonce_file, client_fd);
-    strcat(tmp_nonce_file, SECRET_NONCE);
-    ret = ovsa_license_service_read_file_content(tmp_nonce_file, &credsecret_buf, &file_size);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error reading credential secret nonce file failed with error "
-                 "code %d\n",
-                 ret);
-        goto out;
-    }
-    if (!(strcmp(secret_buf, credsecret_buf))) {
-        OVSA_DBG(DBG_I, "\nOVSA: Secret Validation PASS\n\n");
-    } else {
-        ret = OVSA_TPM2_CREDENTIAL_SECRET_VALIDATION_FAILED;
-        OVSA_DBG(DBG_E, "OVSA: Error secret Validation failed %d\n", ret);
-    }
-out:
-    ovsa_license_service_safe_free(&secret_buf);
-    ovsa_license_service_safe_free(&credsecret_buf);
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
-
-static ovsa_status_t ovsa_license_service_extract_HW_quote_info(char* payload_quote_info,
-                                                                ovsa_quote_info_t* sw_quote_info,
-                                                                ovsa_quote_info_t* hw_quote_info,
-                                                                int client_fd) {
-    ovsa_status_t ret                     = OVSA_OK;
-    char* pcr_quote_message_bin_buff      = NULL;
-    size_t pcr_quote_message_bin_length   = 0;
-    char* pcr_quote_signature_bin_buff    = NULL;
-    size_t pcr_quote_signature_bin_length = 0;
-    char* pcr_bin_buff                    = NULL;
-    size_t pcr_bin_length                 = 0;
-    size_t size                           = 0;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-
-    char tmp_dir[MAX_FILE_LEN];
-    char hwquote_pcr_file[MAX_FILE_LEN];
-    char hwquote_msg_file[MAX_FILE_LEN];
-    char hwquote_sig_file[MAX_FILE_LEN];
-    char ak_hwpub_pem_key_file[MAX_FILE_LEN];
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    CREATE_FILE_PATH(tmp_dir, hwquote_pcr_file, TPM2_HWQUOTE_PCR);
-    CREATE_FILE_PATH(tmp_dir, hwquote_msg_file, TPM2_HWQUOTE_MSG);
-    CREATE_FILE_PATH(tmp_dir, hwquote_sig_file, TPM2_HWQUOTE_SIG);
-    CREATE_FILE_PATH(tmp_dir, ak_hwpub_pem_key_file, TPM2_AK_HWPUB_PEM_KEY);
-
-    /* Read pcr_list from json file */
-    ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_PCR",
-                                                    &hw_quote_info->quote_pcr);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error read pcr_list payload from json failed %d\n", ret);
-        goto out;
-    }
-    if (hw_quote_info->quote_pcr != NULL) {
-        ret = ovsa_license_service_get_string_length(hw_quote_info->quote_pcr, &size);
-        ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_bin_buff);
-        if (ret < OVSA_OK || pcr_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(hw_quote_info->quote_pcr, size,
-                                                                pcr_bin_buff, &pcr_bin_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write pcr_bin to file */
-        FILE* fptr_pcr_bin = fopen(hwquote_pcr_file, "wb");
-        if (fptr_pcr_bin == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file hw quote pcr.bin failed with code %d\n", ret);
-            goto out;
-        }
-        fwrite(pcr_bin_buff, pcr_bin_length, 1, fptr_pcr_bin);
-        fclose(fptr_pcr_bin);
-
-        /* Read quote_message from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_MSG",
-                                                        &hw_quote_info->quote_message);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read quote_message payload from json failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_get_string_length(hw_quote_info->quote_message, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_quote_message_bin_buff);
-        if (ret < OVSA_OK || pcr_quote_message_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(hw_quote_info->quote_message, size,
-                                                                pcr_quote_message_bin_buff,
-                                                                &pcr_quote_message_bin_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write pcr_quote_message to file */
-        FILE* fptr_pcr_quote_message = fopen(hwquote_msg_file, "w");
-        if (fptr_pcr_quote_message == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file HW_pcr_quote.plain failed with code %d\n",
-                     ret);
-            goto out;
-        }
-        fwrite(pcr_quote_message_bin_buff, pcr_quote_message_bin_length, 1, fptr_pcr_quote_message);
-        fclose(fptr_pcr_quote_message);
-
-        /* Read quote_signature from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_Quote_SIG",
-                                                        &hw_quote_info->quote_sig);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read quote_signature payload from json failed %d\n", ret);
-            goto out;
-        }
-
-        size = 0;
-        ret  = ovsa_license_service_get_string_length(hw_quote_info->quote_sig, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            goto out;
-        }
-        ret =
-            ovsa_license_service_safe_malloc((sizeof(char) * size), &pcr_quote_signature_bin_buff);
-        if (ret < OVSA_OK || pcr_quote_signature_bin_buff == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_crypto_convert_base64_to_bin(hw_quote_info->quote_sig, size,
-                                                                pcr_quote_signature_bin_buff,
-                                                                &pcr_quote_signature_bin_length);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-            goto out;
-        }
-        /* write pcr_quote_signature to file */
-        FILE* fptr_pcr_quote_signature = fopen(hwquote_sig_file, "wb");
-        if (fptr_pcr_quote_signature == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file pcr_quote.signature failed with code %d\n",
-                     ret);
-            goto out;
-        }
-        fwrite(pcr_quote_signature_bin_buff, pcr_quote_signature_bin_length, 1,
-               fptr_pcr_quote_signature);
-        fclose(fptr_pcr_quote_signature);
-
-        /* Read HW_pub_key from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_AK_Pub_Key",
-                                                        &hw_quote_info->ak_pub_key);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read HW_pub_key payload from json failed %d\n", ret);
-            goto out;
-        }
-        /* write SW_pub_key to file */
-        FILE* fptr_HW_pub_key = fopen(ak_hwpub_pem_key_file, "w+");
-        if (fptr_HW_pub_key == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening file SW_pub_key.pub failed with code %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_license_service_get_string_length(hw_quote_info->ak_pub_key, &size);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-            fclose(fptr_HW_pub_key);
-            goto out;
-        }
-        fwrite(hw_quote_info->ak_pub_key, size, 1, fptr_HW_pub_key);
-        fclose(fptr_HW_pub_key);
-
-        /* Read hw_ek_cert from json file */
-        ret = ovsa_license_service_json_extract_element(payload_quote_info, "HW_EK_Cert",
-                                                        &hw_quote_info->ek_cert);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error read hw_ek_cert payload from json failed %d\n", ret);
-            goto out;
-        }
-        if ((sw_quote_info->quote_pcr != NULL) && (hw_quote_info->quote_pcr != NULL)) {
-            OVSA_DBG(DBG_I, "OVSA: Verifying HW EK Certificate...\n");
-            ret = ovsa_license_service_crypto_verify_certificate(hw_quote_info->ek_cert,
-                                                                 NULL /* Chain Certificate */);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error HW EK certificate verification failed %d\n", ret);
-                goto out;
-            }
-            OVSA_DBG(DBG_I, "OVSA: HW EK Certificate verification successful...\n");
-        }
-    }
-out:
-    ovsa_license_service_safe_free(&pcr_quote_message_bin_buff);
-    ovsa_license_service_safe_free(&pcr_quote_signature_bin_buff);
-    ovsa_license_service_safe_free(&pcr_bin_buff);
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
+    }
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
 
 ovsa_status_t ovsa_license_service_extract_customer_license_validate_tcb(
     char* cust_lic_payload, ovsa_customer_license_sig_t* customer_lic_sig) {
@@ -1487,57 +659,22 @@ out:
     return ret;
 }
 
-static ovsa_status_t ovsa_license_service_send_license_check_response(void* ssl_session,
-                                                                      const char* response) {
-    ovsa_status_t ret                = OVSA_OK;
-    size_t length                    = 0;
-    char* lic_check_status_buf       = NULL;
-    size_t license_check_payload_len = 0;
-    char* license_check_json_payload = NULL;
+static ovsa_status_t ovsa_license_service_send_license_check_response(
+    void* ssl_session, ovsa_command_type_t cmdtype, const char* response) {
+    ovsa_status_t ret = OVSA_OK;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    /* create json message blob & send response result to client */
-    ret = ovsa_license_service_json_create_message_blob(OVSA_SEND_LICENSE_CHECK_RESP, response,
-                                                        &lic_check_status_buf, &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error response message blob failed with error code %d\n", ret);
-        goto out;
-    }
-    /* Append payload length to json blob */
-    license_check_payload_len = length + PAYLOAD_LENGTH + 1;
-    ret = ovsa_license_service_safe_malloc((sizeof(char) * license_check_payload_len),
-                                           &license_check_json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
-        goto out;
-    }
-    ret = ovsa_license_service_append_payload_len_to_blob(lic_check_status_buf,
-                                                          &license_check_json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json_payload json blob creation failed with %d\n", ret);
-        goto out;
-    }
+    /* send response result to client */
     OVSA_DBG(DBG_I, "OVSA:Sending TCB check/License check response to client\n");
-    OVSA_DBG(DBG_I, "OVSA:CHECK_RESP_json_payload %s\n", license_check_json_payload);
-
-    size_t payload_len = 0;
-    ret = ovsa_license_service_get_string_length(license_check_json_payload, &payload_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of payload string %d\n", ret);
-        goto out;
-    }
-    /* Send License check result to lient */
-    ret = ovsa_license_service_write(ssl_session, license_check_json_payload, payload_len);
+    OVSA_DBG(DBG_I, "OVSA:CHECK_RESP_json_payload %s\n", response);
+    ret = ovsa_license_service_send_message(ssl_session, cmdtype, response);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error send response to client failed %d\n", ret);
         goto out;
     }
 
 out:
-    ovsa_license_service_safe_free(&license_check_json_payload);
-    ovsa_license_service_safe_free(&lic_check_status_buf);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -1555,17 +692,150 @@ static ovsa_command_type_t ovsa_license_service_get_command_type(const char* com
         cmd = OVSA_SEND_CUST_LICENSE;
     else if (!strcmp(command, "OVSA_SEND_UPDATE_CUST_LICENSE_ACK"))
         cmd = OVSA_SEND_UPDATE_CUST_LICENSE_ACK;
+    else if (!strcmp(command, "OVSA_SEND_CUST_LICENSE_BATCH"))
+        cmd = OVSA_SEND_CUST_LICENSE_BATCH;
+    else if (!strcmp(command, "OVSA_SEND_ATTESTATION_TOKEN"))
+        cmd = OVSA_SEND_ATTESTATION_TOKEN;
 
     return cmd;
 }
 
+/* Name of a command the license server sends, as the client reads it */
+static const char* ovsa_license_service_get_command_name(const ovsa_command_type_t cmd) {
+    switch (cmd) {
+        case OVSA_SEND_NONCE:
+            return "OVSA_SEND_NONCE";
+        case OVSA_SEND_EK_AK_BIND:
+            return "OVSA_SEND_EK_AK_BIND";
+        case OVSA_SEND_QUOTE_NONCE:
+            return "OVSA_SEND_QUOTE_NONCE";
+        case OVSA_SEND_UPDATE_CUST_LICENSE:
+            return "OVSA_SEND_UPDATE_CUST_LICENSE";
+        case OVSA_SEND_LICENSE_CHECK_RESP:
+            return "OVSA_SEND_LICENSE_CHECK_RESP";
+        case OVSA_SEND_LICENSE_CHECK_BATCH_RESP:
+            return "OVSA_SEND_LICENSE_CHECK_BATCH_RESP";
+        case OVSA_SEND_ATTESTATION_TOKEN:
+            return "OVSA_SEND_ATTESTATION_TOKEN";
+        case OVSA_SEND_LICENSE_LEASE:
+            return "OVSA_SEND_LICENSE_LEASE";
+        default:
+            return NULL;
+    }
+}
+
+/* Writes a record of the binary framing, returns its size */
+static size_t ovsa_license_service_tlv_put_record(char* buf, const uint8_t type,
+                                                  const char* value, const size_t len) {
+    buf[0] = (char)type;
+    buf[1] = (char)((len >> 24) & 0xFF);
+    buf[2] = (char)((len >> 16) & 0xFF);
+    buf[3] = (char)((len >> 8) & 0xFF);
+    buf[4] = (char)(len & 0xFF);
+    memcpy_s(buf + OVSA_TLV_RECORD_HEADER_SIZE, len, value, len);
+    return OVSA_TLV_RECORD_HEADER_SIZE + len;
+}
+
+/*
+ * Splits a message in the binary framing into its command and payload records. The records must
+ * lie within size bytes of the message; the end of the payload record is returned in end.
+ */
+static ovsa_status_t ovsa_license_service_tlv_split(const char* message, const size_t size,
+                                                    const char** command, size_t* command_len,
+                                                    const char** payload, size_t* payload_len,
+                                                    size_t* end) {
+    const unsigned char* buf = (const unsigned char*)message;
+    const uint8_t types[]    = {OVSA_TLV_TYPE_COMMAND, OVSA_TLV_TYPE_PAYLOAD};
+    const char** values[]    = {command, payload};
+    size_t* lens[]           = {command_len, payload_len};
+    size_t offset            = 1;
+    size_t len               = 0;
+    int index                = 0;
+
+    if ((size < 1) || (buf[0] != OVSA_TLV_MAGIC))
+        return OVSA_INVALID_PARAMETER;
+    for (index = 0; index < 2; index++) {
+        if ((size - offset < OVSA_TLV_RECORD_HEADER_SIZE) || (buf[offset] != types[index]))
+            return OVSA_INVALID_PARAMETER;
+        len = ((size_t)buf[offset + 1] << 24) | ((size_t)buf[offset + 2] << 16) |
+              ((size_t)buf[offset + 3] << 8) | (size_t)buf[offset + 4];
+        offset += OVSA_TLV_RECORD_HEADER_SIZE;
+        if (len > size - offset)
+            return OVSA_INVALID_PARAMETER;
+        *values[index] = message + offset;
+        *lens[index]   = len;
+        offset += len;
+    }
+    *end = offset;
+    return OVSA_OK;
+}
+
+/*
+ * Takes the correlation ID of the tracing spans from the optional record following the payload
+ * record at offset end, the record must be the last one of the message.
+ */
+static ovsa_status_t ovsa_license_service_tlv_trace_id(const char* message, const size_t size,
+                                                       const size_t end) {
+    const unsigned char* buf = (const unsigned char*)message;
+    size_t len               = 0;
+
+    if (end == size)
+        return OVSA_OK;
+    if ((size - end < OVSA_TLV_RECORD_HEADER_SIZE) || (buf[end] != OVSA_TLV_TYPE_TRACE_ID))
+        return OVSA_INVALID_PARAMETER;
+    len = ((size_t)buf[end + 1] << 24) | ((size_t)buf[end + 2] << 16) |
+          ((size_t)buf[end + 3] << 8) | (size_t)buf[end + 4];
+    if (len != size - end - OVSA_TLV_RECORD_HEADER_SIZE)
+        return OVSA_INVALID_PARAMETER;
+    OVSA_TRACE_SET_CORRELATION_ID(message + end + OVSA_TLV_RECORD_HEADER_SIZE, len);
+    return OVSA_OK;
+}
+
+/*
+ * Extracts the payload of a message read with ovsa_license_service_read_payload(), which checked
+ * the records of a message in the binary framing.
+ */
+static ovsa_status_t ovsa_license_service_extract_payload(const char* message, char** payload) {
+    ovsa_status_t ret   = OVSA_OK;
+    const char* command = NULL;
+    const char* value   = NULL;
+    size_t command_len  = 0;
+    size_t len          = 0;
+    size_t end          = 0;
+
+    if ((message == NULL) || (payload == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    if ((unsigned char)message[0] != OVSA_TLV_MAGIC)
+        return ovsa_license_service_json_extract_element(message, "payload", payload);
+
+    ret = ovsa_license_service_tlv_split(message, SIZE_MAX, &command, &command_len, &value, &len,
+                                         &end);
+    if (ret < OVSA_OK)
+        return ret;
+    ret = ovsa_license_service_safe_malloc(len + 1, payload);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error payload allocation failed with code %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    memcpy_s(*payload, len + 1, value, len);
+    return OVSA_OK;
+}
+
 static ovsa_status_t ovsa_license_service_read_payload(void** _ssl_session, char** read_buf,
                                                        char** command) {
-    ovsa_status_t ret = OVSA_OK;
-    void* ssl_session = NULL;
-    ssl_session       = *_ssl_session;
+    ovsa_status_t ret                = OVSA_OK;
+    void* ssl_session                = NULL;
+    ssl_session                      = *_ssl_session;
+    ovsa_client_connection_t* client = (ovsa_client_connection_t*)ssl_session;
+    size_t payload_size              = 0;
+    const char* name                 = NULL;
+    const char* payload              = NULL;
+    size_t name_len                  = 0;
+    size_t payload_len               = 0;
+    size_t end                       = 0;
     unsigned char payload_len_str[PAYLOAD_LENGTH + 1];
-    size_t payload_size = 0;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -1578,25 +848,47 @@ static ovsa_status_t ovsa_license_service_read_payload(void** _ssl_session, char
         goto out;
     }
     payload_size = atoi(payload_len_str);
-    if ((payload_size < OVSA_OK || payload_size > UINT_MAX)) {
+    if ((payload_size < OVSA_OK || payload_size > LICENSE_SERVICE_MAX_MSG_SIZE)) {
         ret = OVSA_INVALID_PARAMETER;
         OVSA_DBG(DBG_E, "OVSA: Error license service read payload size '%ld'  invalid \n",
                  payload_size);
         goto out;
     }
-    ret = ovsa_license_service_safe_malloc((sizeof(char) * payload_size + 1), read_buf);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error memory init failed\n");
+    /* Read payload into the receive buffer of the connection, valid until the next message */
+    ret = ovsa_license_service_reserve_buffer(&client->rx_buf, &client->rx_buf_size,
+                                              payload_size + 1);
+    if (ret < OVSA_OK)
         goto out;
-    }
-    /* Read payload */
-    ret = ovsa_license_service_read(ssl_session, *read_buf, payload_size);
+    *read_buf = client->rx_buf;
+    ret       = ovsa_license_service_read(ssl_session, *read_buf, payload_size);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error license service read communication failed with code %d\n",
                  ret);
         goto out;
     }
+    (*read_buf)[payload_size] = '\0';
+    if ((unsigned char)(*read_buf)[0] == OVSA_TLV_MAGIC) {
+        ret = ovsa_license_service_tlv_split(*read_buf, payload_size, &name, &name_len, &payload,
+                                             &payload_len, &end);
+        if (ret == OVSA_OK)
+            ret = ovsa_license_service_tlv_trace_id(*read_buf, payload_size, end);
+        if (ret < OVSA_OK) {
+            ret = OVSA_INVALID_PARAMETER;
+            OVSA_DBG(DBG_E, "OVSA: Error invalid binary framed message from client\n");
+            goto out;
+        }
+        ret = ovsa_license_service_safe_malloc(name_len + 1, command);
+        if (ret < OVSA_OK) {
+            ret = OVSA_MEMORY_ALLOC_FAIL;
+            OVSA_DBG(DBG_E, "OVSA: Error memory init failed\n");
+            goto out;
+        }
+        memcpy_s(*command, name_len + 1, name, name_len);
+        /* The client took the binary framing offered with the nonce, the replies use it too */
+        client->binary_framing = true;
+        OVSA_DBG(DBG_D, "OVSA:Received %s\n", *command);
+        goto out;
+    }
     OVSA_DBG(DBG_D, "OVSA:Received payload\n'%s'\n", *read_buf);
     /* Read command from json file */
     ret = ovsa_license_service_json_extract_element(*read_buf, "command", command);
@@ -1610,58 +902,86 @@ out:
     return ret;
 }
 
-static ovsa_status_t ovsa_license_service_send_client_request_EK_AK_bind(void** _ssl_session) {
-    ovsa_status_t ret    = OVSA_OK;
-    void* ssl_session    = NULL;
-    ssl_session          = *_ssl_session;
-    char* json_buf       = NULL;
-    char* json_payload   = NULL;
-    char dummy_payload[] = "";
-    size_t length        = 0;
-    size_t payload_len   = 0;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+/* Keeps the quote nonce sent to the client to check the qualification of the client quotes */
+static ovsa_status_t ovsa_license_service_keep_quote_nonce(const char* quote_nonce,
+                                                           ovsa_tpm2_challenge_t* challenge) {
+    ovsa_status_t ret       = OVSA_OK;
+    char* nonce_bin_buff    = NULL;
+    size_t nonce_bin_length = 0, nonce_size = 0;
 
-    /* create json meesage blob */
-    ret = ovsa_license_service_json_create_message_blob(OVSA_SEND_EK_AK_BIND, dummy_payload,
-                                                        &json_buf, &length);
+    ret = ovsa_license_service_get_string_length(quote_nonce, &nonce_size);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error create OVSA_SEND_EK_AK_BIND message blob failed with error code %d\n",
-                 ret);
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of quote_nonce string %d\n", ret);
         goto out;
     }
-    /* Append payload length to json blob */
-    payload_len = length + PAYLOAD_LENGTH + 1;
-    ret         = ovsa_license_service_safe_malloc((sizeof(char) * payload_len), &json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error memory init failed\n");
+    ret = ovsa_license_service_safe_malloc((sizeof(char) * nonce_size), &nonce_bin_buff);
+    if (ret < OVSA_OK || nonce_bin_buff == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error nonce_bin_buff buffer allocation failed %d\n", ret);
         goto out;
     }
-    ret = ovsa_license_service_append_payload_len_to_blob(json_buf, &json_payload);
+    ret = ovsa_license_service_crypto_convert_base64_to_bin(quote_nonce, nonce_size, nonce_bin_buff,
+                                                            &nonce_bin_length);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error append payload length to json blob creation failed with %d\n",
-                 ret);
+        OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
         goto out;
     }
-    /* Send client domain query */
-    ret = ovsa_license_service_get_string_length((char*)json_payload, &payload_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
+    if (nonce_bin_length > sizeof(challenge->quote_nonce)) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote nonce length %ld is invalid\n", nonce_bin_length);
+        ret = OVSA_INVALID_PARAMETER;
         goto out;
     }
+    memcpy_s(challenge->quote_nonce, sizeof(challenge->quote_nonce), nonce_bin_buff,
+             nonce_bin_length);
+    challenge->quote_nonce_len = nonce_bin_length;
+out:
+    ovsa_license_service_safe_free(&nonce_bin_buff);
+    return ret;
+}
+
+/*
+ * Asks the client for its EK/AK bind info. With attestation tokens the request carries a quote
+ * nonce, a client with a token quotes its PCRs over it to show the AK of the token is its own.
+ */
+static ovsa_status_t ovsa_license_service_send_client_request_EK_AK_bind(
+    void** _ssl_session, ovsa_tpm2_challenge_t* challenge) {
+    ovsa_status_t ret    = OVSA_OK;
+    void* ssl_session    = NULL;
+    ssl_session          = *_ssl_session;
+    char dummy_payload[] = "";
+    char* quote_nonce    = NULL;
+    char* request        = NULL;
+    const char* names[]  = {"quote_nonce"};
+    const char* values[1];
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if (ovsa_license_service_attestation_token_validity() > 0) {
+        ret = ovsa_license_service_create_nonce(&quote_nonce);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "Error create nonce failed with code %d\n", ret);
+            goto out;
+        }
+        ret = ovsa_license_service_keep_quote_nonce(quote_nonce, challenge);
+        if (ret < OVSA_OK)
+            goto out;
+        values[0] = quote_nonce;
+        ret       = ovsa_license_service_json_create_string_object(names, values, 1, &request);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error create EK_AK_BIND request failed with code %d\n", ret);
+            goto out;
+        }
+    }
     OVSA_DBG(DBG_I, "OVSA:Sending client EK_AK_BIND info request ...!\n");
-    ret = ovsa_license_service_write(ssl_session, json_payload, payload_len);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_EK_AK_BIND,
+                                            (request != NULL) ? request : dummy_payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error license service write communication failed %d\n", ret);
         goto out;
     }
-    OVSA_DBG(DBG_D, "OVSA:json payload %s\n", json_payload);
 
 out:
-    ovsa_license_service_safe_free(&json_buf);
-    ovsa_license_service_safe_free(&json_payload);
+    ovsa_license_service_safe_free(&quote_nonce);
+    ovsa_license_service_safe_free(&request);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -1731,173 +1051,60 @@ out:
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
-static ovsa_status_t ovsa_license_service_convert_EKpub_to_DER_format(const char* ekpub,
-                                                                      int client_fd) {
-    ovsa_status_t ret       = OVSA_OK;
-    char* ekpub_bin_buff    = NULL;
-    size_t ekpub_size       = 0;
-    size_t ekpub_bin_length = 0;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    ret = ovsa_license_service_get_string_length(ekpub, &ekpub_size);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_safe_malloc((sizeof(char) * ekpub_size), &ekpub_bin_buff);
-    if (ret < OVSA_OK || ekpub_bin_buff == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error pcr quote buffer allocation failed %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_crypto_convert_base64_to_bin(ekpub, ekpub_size, ekpub_bin_buff,
-                                                            &ekpub_bin_length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-        goto out;
-    }
-    char ek_pub_key_file[MAX_FILE_LEN];
-    CREATE_TMP_DIR_PATH(ek_pub_key_file, client_fd);
-    strcat(ek_pub_key_file, TPM2_EK_PUB_KEY);
-    /* write EKpub_bin to file */
-    FILE* fptr_EKpub_bin = fopen(ek_pub_key_file, "wb");
-    if (fptr_EKpub_bin == NULL) {
-        ret = OVSA_FILEOPEN_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error opening file ek_pub failed with code %d\n", ret);
-        goto out;
-    }
-    fwrite(ekpub_bin_buff, ekpub_bin_length, 1, fptr_EKpub_bin);
-    fclose(fptr_EKpub_bin);
-
-out:
-    ovsa_license_service_safe_free(&ekpub_bin_buff);
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
-    return ret;
-}
-
 static ovsa_status_t ovsa_license_service_do_tpm2_makecredential(char* akname_hex,
-                                                                 const char* ekpub, int client_fd) {
+                                                                 const char* ekpub,
+                                                                 ovsa_tpm2_challenge_t* challenge,
+                                                                 char** cred_blob,
+                                                                 size_t* cred_blob_len) {
     ovsa_status_t ret = OVSA_OK;
-    size_t size = 0, buf_len = 0;
-    char tmp_dir[MAX_FILE_LEN];
-    char tmp_nonce_file[MAX_FILE_LEN];
-    char credout_file[MAX_FILE_LEN];
-    char ek_pub_key_file[MAX_FILE_LEN];
-    char ak_name_hex[MAX_FILE_LEN];
+    unsigned char secret[TPM2_CREDENTIAL_SECRET_SIZE];
+    int i = 0;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     strtok(akname_hex, "\n");
-    /* Delete old quote files if already exsists */
-    ovsa_license_service_remove_quote_files(client_fd);
 
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    ret = mkdir(tmp_dir, 0700);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error tmp directory %s creation failed ", tmp_dir);
-        return OVSA_FILEOPEN_FAIL;
-    }
-    CREATE_FILE_PATH(tmp_dir, tmp_nonce_file, SECRET_NONCE);
-    CREATE_FILE_PATH(tmp_dir, credout_file, TPM2_CREDOUT_FILE);
-    CREATE_FILE_PATH(tmp_dir, ek_pub_key_file, TPM2_EK_PUB_KEY);
-    CREATE_FILE_PATH(tmp_dir, ak_name_hex, TPM2_AK_NAME_HEX);
-    /* write AKname hex to file */
-    FILE* fptr_Akname_hex = fopen(ak_name_hex, "wb");
-    if (fptr_Akname_hex == NULL) {
-        ret = OVSA_FILEOPEN_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error opening file tpm_ak.name_hex failed with code %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_get_string_length(akname_hex, &buf_len);
-    if (ret < OVSA_OK) {
-        fclose(fptr_Akname_hex);
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+    /* Secret the client has to recover with tpm2_activatecredential */
+    if (RAND_bytes(secret, sizeof(secret)) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error generating credential secret failed\n");
+        ret = OVSA_CRYPTO_GENERIC_ERROR;
         goto out;
     }
-    fwrite(akname_hex, buf_len, 1, fptr_Akname_hex);
-    fclose(fptr_Akname_hex);
+    memset_s(challenge->secret, sizeof(challenge->secret), 0);
+    for (i = 0; i < TPM2_CREDENTIAL_SECRET_SIZE; i++)
+        snprintf(challenge->secret + (i * 2), 3, "%02x", secret[i]);
 
-    /* write AKname hex to file */
-    FILE* fptr_ekpub = fopen(ek_pub_key_file, "wb");
-    if (fptr_ekpub == NULL) {
-        ret = OVSA_FILEOPEN_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error opening file tpm_ek.pub failed with code %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_get_string_length(ekpub, &buf_len);
+    ret = ovsa_license_service_tpm2_makecredential(ekpub, akname_hex, challenge->secret,
+                                                   TPM2_CREDENTIAL_SECRET_SIZE * 2, cred_blob,
+                                                   cred_blob_len);
     if (ret < OVSA_OK) {
-        fclose(fptr_ekpub);
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+        OVSA_DBG(DBG_E, "OVSA: Error tpm2 makecredential failed with code %d\n", ret);
         goto out;
     }
-    fwrite(ekpub, buf_len, 1, fptr_ekpub);
-    fclose(fptr_ekpub);
-
-    char* const getrand_cmd[] = {"/usr/bin/tpm2_getrandom", "--hex", "-o", tmp_nonce_file, "16", 0};
-    if (ovsa_license_service_do_run_tpm2_command(getrand_cmd, NULL) != 0) {
-        OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", getrand_cmd[0]);
-        return OVSA_TPM2_CMD_EXEC_FAIL;
-    }
-
-    char* const makecredential_argv[] = {"/usr/bin/tpm2_makecredential",
-                                         "--public",
-                                         ek_pub_key_file,
-                                         "--secret",
-                                         tmp_nonce_file,
-                                         "--name",
-                                         akname_hex,
-                                         "--credential-blob",
-                                         credout_file,
-                                         "-G",
-                                         "rsa",
-                                         0};
-
-    /* Run makecredential */
-    ret = ovsa_license_service_do_run_tpm2_command(makecredential_argv, NULL);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error command %s failed to execute \n", makecredential_argv[0]);
-        return OVSA_TPM2_CMD_EXEC_FAIL;
-    }
     OVSA_DBG(DBG_I, "TPM2 makecredential successful...\n");
 
 out:
+    OPENSSL_cleanse(secret, sizeof(secret));
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
 static ovsa_status_t ovsa_license_service_send_credential_quote(void** _ssl_session,
-                                                                int client_fd) {
+                                                                ovsa_tpm2_challenge_t* challenge,
+                                                                const char* cred_blob,
+                                                                size_t cred_blob_len) {
     ovsa_status_t ret        = OVSA_OK;
     void* ssl_session        = NULL;
     ssl_session              = *_ssl_session;
-    size_t file_size         = 0;
-    char* credout_buf        = NULL;
     char* credout_buf_pem    = NULL;
     char* quote_nonce        = NULL;
     char* quote_credout_info = NULL;
-    char* json_buf           = NULL;
-    char* json_payload       = NULL;
     size_t length            = 0;
-    size_t payload_len       = 0;
-    char* nonce_bin_buff     = NULL;
-    size_t nonce_bin_length = 0, nonce_size = 0;
-    char tmp_dir[MAX_FILE_LEN];
-    char credout_file[MAX_FILE_LEN];
-    char quote_nonce_file[MAX_FILE_LEN];
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    CREATE_TMP_DIR_PATH(tmp_dir, client_fd);
-    CREATE_FILE_PATH(tmp_dir, credout_file, TPM2_CREDOUT_FILE);
-    CREATE_FILE_PATH(tmp_dir, quote_nonce_file, QUOTE_NONCE);
-    /* Read credential file */
-    ret = ovsa_license_service_read_file_content(credout_file, &credout_buf, &file_size);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error reading Opening file cred.out file failed with error code %d\n", ret);
-        goto out;
-    }
     /* convert credout bin to pem */
-    ret = ovsa_license_service_crypto_convert_bin_to_base64(credout_buf, file_size - 1,
+    ret = ovsa_license_service_crypto_convert_bin_to_base64(cred_blob, cred_blob_len,
                                                             &credout_buf_pem);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "Error crypto convert_bin_to_pem failed with code %d\n", ret);
@@ -1909,32 +1116,9 @@ static ovsa_status_t ovsa_license_service_send_credential_quote(void** _ssl_sess
         OVSA_DBG(DBG_E, "Error create nonce failed with code %d\n", ret);
         goto out;
     }
-    ret = ovsa_license_service_get_string_length(quote_nonce, &nonce_size);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of quote_nonce string %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_safe_malloc((sizeof(char) * nonce_size), &nonce_bin_buff);
-    if (ret < OVSA_OK || nonce_bin_buff == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error nonce_bin_buff buffer allocation failed %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_license_service_crypto_convert_base64_to_bin(quote_nonce, nonce_size, nonce_bin_buff,
-                                                            &nonce_bin_length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "Error crypto convert_base64_to_bin failed with code %d\n", ret);
-        goto out;
-    }
-
-    /* write quote nounce to file */
-    FILE* fquote_nonce = fopen(quote_nonce_file, "w");
-    if (fquote_nonce == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error opening nonce.bin !");
-        ret = OVSA_FILEOPEN_FAIL;
+    ret = ovsa_license_service_keep_quote_nonce(quote_nonce, challenge);
+    if (ret < OVSA_OK)
         goto out;
-    }
-    fwrite(nonce_bin_buff, nonce_bin_length, 1, fquote_nonce);
-    fclose(fquote_nonce);
 
     ret = ovsa_license_service_json_create_quote_cred_data_blob(credout_buf_pem, quote_nonce,
                                                                 &quote_credout_info, &length);
@@ -1942,103 +1126,38 @@ static ovsa_status_t ovsa_license_service_send_credential_quote(void** _ssl_sess
         OVSA_DBG(DBG_E, "Error create_quote_creadout_info_blob failed with code %d\n", ret);
         goto out;
     }
-    /* create json message blob */
-    ret = ovsa_license_service_json_create_message_blob(OVSA_SEND_QUOTE_NONCE, quote_credout_info,
-                                                        &json_buf, &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create OVSA_SEND_QUOTE_NONCE blob failed with error code %d\n",
-                 ret);
-        goto out;
-    }
-    /* Append payload length to json blob */
-    payload_len = length + PAYLOAD_LENGTH + 1;
-    ret         = ovsa_license_service_safe_malloc((sizeof(char) * payload_len), &json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error memory init failed\n");
-        goto out;
-    }
-    ret = ovsa_license_service_append_payload_len_to_blob(json_buf, &json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json blob creation failed with %d\n", ret);
-        goto out;
-    }
-    payload_len = 0;
-
-    ret = ovsa_license_service_get_string_length((char*)json_payload, &payload_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
-    }
     OVSA_DBG(DBG_I, "OVSA:Sending credout and quote nonce to client...!\n");
-    ret = ovsa_license_service_write(ssl_session, json_payload, payload_len);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_QUOTE_NONCE,
+                                            quote_credout_info);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error license service write communicaton failed %d\n", ret);
         goto out;
     }
-    OVSA_DBG(DBG_D, "OVSA:json payload %s\n", json_payload);
+    OVSA_DBG(DBG_D, "OVSA:json payload %s\n", quote_credout_info);
 
 out:
     ovsa_license_service_safe_free(&credout_buf_pem);
-    ovsa_license_service_safe_free(&credout_buf);
     ovsa_license_service_safe_free(&quote_nonce);
     ovsa_license_service_safe_free(&quote_credout_info);
-    ovsa_license_service_safe_free(&json_buf);
-    ovsa_license_service_safe_free(&nonce_bin_buff);
-    ovsa_license_service_safe_free(&json_payload);
 
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 static ovsa_status_t ovsa_license_service_send_updated_customer_license(void** _ssl_session,
                                                                         char* DB_cust_license) {
-    ovsa_status_t ret  = OVSA_OK;
-    void* ssl_session  = NULL;
-    ssl_session        = *_ssl_session;
-    char* json_buf     = NULL;
-    char* json_payload = NULL;
-    size_t length      = 0;
-    size_t payload_len = 0;
+    ovsa_status_t ret = OVSA_OK;
+    void* ssl_session = NULL;
+    ssl_session       = *_ssl_session;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    /* create json message blob */
-    ret = ovsa_license_service_json_create_message_blob(OVSA_SEND_UPDATE_CUST_LICENSE,
-                                                        DB_cust_license, &json_buf, &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(
-            DBG_E,
-            "OVSA: Error create OVSA_SEND_UPDATE_CUST_LICENSE blob failed with error code %d\n",
-            ret);
-        goto out;
-    }
-    /* Append payload length to json blob */
-    payload_len = length + PAYLOAD_LENGTH + 1;
-    ret         = ovsa_license_service_safe_malloc((sizeof(char) * payload_len), &json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error memory init failed\n");
-        goto out;
-    }
-    ret = ovsa_license_service_append_payload_len_to_blob(json_buf, &json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json blob creation failed with %d\n", ret);
-        goto out;
-    }
-    payload_len = 0;
-    ret         = ovsa_license_service_get_string_length((char*)json_payload, &payload_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
-    }
-    OVSA_DBG(DBG_I, "OVSA: Send updated customer license to runtime: %s\n", json_payload);
-    ret = ovsa_license_service_write(ssl_session, json_payload, payload_len);
+    OVSA_DBG(DBG_I, "OVSA: Send updated customer license to runtime: %s\n", DB_cust_license);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_UPDATE_CUST_LICENSE,
+                                            DB_cust_license);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error license service write communicaton failed %d\n", ret);
         goto out;
     }
 out:
-    ovsa_license_service_safe_free(&json_buf);
-    ovsa_license_service_safe_free(&json_payload);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -2088,6 +1207,7 @@ static ovsa_status_t ovsa_license_service_do_validate_customer_license(
     char* DB_cust_license = NULL;
     char* license_guid    = NULL;
     char* model_guid      = NULL;
+    struct timespec stage_start;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -2100,10 +1220,13 @@ static ovsa_status_t ovsa_license_service_do_validate_customer_license(
     }
     license_guid = customer_lic_sig->customer_lic.license_guid;
     model_guid   = customer_lic_sig->customer_lic.model_guid;
+    ovsa_license_service_log_set_license(license_guid);
 
     /* Extract customer licensce from DB */
+    ovsa_license_service_metrics_stage_start(&stage_start);
     ret =
         ovsa_db_get_customer_license_blob(OVSA_DB_PATH, license_guid, model_guid, &DB_cust_license);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_DB_LOOKUP, &stage_start);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error retrieve customer license from DB failed with error code  %d\n", ret);
@@ -2140,16 +1263,18 @@ out:
     return ret;
 }
 static ovsa_status_t ovsa_license_service_do_validate_EK_AK_bind_info(
-    void** _ssl_session, const char* payload_EK_AK_bind_info, int client_fd,
+    void** _ssl_session, const char* payload_EK_AK_bind_info, ovsa_tpm2_challenge_t* challenge,
     char* client_platform_cert) {
     ovsa_status_t ret = OVSA_OK;
     void* ssl_session = NULL;
     ssl_session       = *_ssl_session;
     char ekpub_key[MAX_KEY_SIZE];
-    size_t ekpub_size   = 0;
-    size_t ekcert_size  = 0;
-    char* cert_bin_buff = NULL;
-    size_t size         = 0;
+    size_t ekpub_size    = 0;
+    size_t ekcert_size   = 0;
+    char* cert_bin_buff  = NULL;
+    size_t size          = 0;
+    char* cred_blob      = NULL;
+    size_t cred_blob_len = 0;
     ovsa_ek_ak_bind_info_t ek_ak_bind_info;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
@@ -2232,21 +1357,23 @@ static ovsa_status_t ovsa_license_service_do_validate_EK_AK_bind_info(
         goto out;
     }
 
-    /* create wrapped credential and encryption key using tpm2_makecredential */
-    ret =
-        ovsa_license_service_do_tpm2_makecredential(ek_ak_bind_info.ak_name, ekpub_key, client_fd);
+    /* create wrapped credential and encryption key for tpm2_activatecredential */
+    ret = ovsa_license_service_do_tpm2_makecredential(ek_ak_bind_info.ak_name, ekpub_key, challenge,
+                                                      &cred_blob, &cred_blob_len);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "Error tpm2_makecredential failed with code %d\n", ret);
         goto out;
     }
     /* Send wrapped credential and quote nonce to client */
-    ret = ovsa_license_service_send_credential_quote(&ssl_session, client_fd);
+    ret = ovsa_license_service_send_credential_quote(&ssl_session, challenge, cred_blob,
+                                                     cred_blob_len);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "Error send credential and quote nonce failed with code %d\n", ret);
         goto out;
     }
 
 out:
+    ovsa_license_service_safe_free(&cred_blob);
     ovsa_license_service_safe_free(&ek_ak_bind_info.ak_name);
     ovsa_license_service_safe_free(&ek_ak_bind_info.ek_pub_key);
     ovsa_license_service_safe_free(&ek_ak_bind_info.ek_pub_sig);
@@ -2288,14 +1415,126 @@ out:
     return ret;
 }
 
+/*
+ * Attests the platform with a token presented in place of the EK/AK bind info and HW quote. The
+ * token comes with a quote of the client over the nonce of the EK_AK_BIND request.
+ */
+static ovsa_status_t ovsa_license_service_do_validate_attestation_token(
+    const char* payload_token, ovsa_tpm2_challenge_t* challenge, ovsa_quote_info_t* sw_quote_info,
+    ovsa_quote_info_t* hw_quote_info, char* client_platform_cert) {
+    ovsa_status_t ret = OVSA_OK;
+    char* token       = NULL;
+    char* ak_name     = NULL;
+    ovsa_quote_info_t quote_info;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(&quote_info, sizeof(ovsa_quote_info_t), 0);
+
+    ret = ovsa_license_service_json_extract_element(payload_token, "token", &token);
+    if ((ret < OVSA_OK) || (token == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token from json failed %d\n", ret);
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_json_extract_element(payload_token, "AK_name", &ak_name);
+    if ((ret < OVSA_OK) || (ak_name == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read AK name from json failed %d\n", ret);
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    if ((ovsa_license_service_json_extract_element(payload_token, "SW_Quote_PCR",
+                                                   &quote_info.quote_pcr) < OVSA_OK) ||
+        (ovsa_license_service_json_extract_element(payload_token, "SW_Quote_MSG",
+                                                   &quote_info.quote_message) < OVSA_OK) ||
+        (ovsa_license_service_json_extract_element(payload_token, "SW_Quote_SIG",
+                                                   &quote_info.quote_sig) < OVSA_OK) ||
+        (quote_info.quote_pcr == NULL) || (quote_info.quote_message == NULL) ||
+        (quote_info.quote_sig == NULL) || (challenge->quote_nonce_len == 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token quote from json failed\n");
+        ret = OVSA_ATTESTATION_TOKEN_INVALID;
+        goto out;
+    }
+    ret = ovsa_license_service_attestation_token_verify(
+        token, ak_name, &quote_info, challenge->quote_nonce, challenge->quote_nonce_len,
+        client_platform_cert, sw_quote_info, hw_quote_info);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_I, "OVSA:Attestation token refused with code %d\n", ret);
+        ovsa_license_service_free_quote_info(*sw_quote_info);
+        ovsa_license_service_free_quote_info(*hw_quote_info);
+        memset_s(sw_quote_info, sizeof(ovsa_quote_info_t), 0);
+        memset_s(hw_quote_info, sizeof(ovsa_quote_info_t), 0);
+        goto out;
+    }
+    challenge->attested_by_token = true;
+out:
+    ovsa_license_service_safe_free(&token);
+    ovsa_license_service_safe_free(&ak_name);
+    ovsa_license_service_safe_free(&quote_info.quote_pcr);
+    ovsa_license_service_safe_free(&quote_info.quote_message);
+    ovsa_license_service_safe_free(&quote_info.quote_sig);
+    ovsa_license_service_safe_free(&quote_info.ak_pub_key);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+/* Issues an attestation token to a client that asked for one after its quote was verified */
+static void ovsa_license_service_send_attestation_token(void* ssl_session,
+                                                        const ovsa_tpm2_challenge_t* challenge,
+                                                        const char* client_platform_cert,
+                                                        const ovsa_quote_info_t* sw_quote_info,
+                                                        const ovsa_quote_info_t* hw_quote_info) {
+    ovsa_status_t ret = OVSA_OK;
+    char* token       = NULL;
+    char* token_blob  = NULL;
+    char validity[MAX_NAME_SIZE];
+    const char* names[] = {"token", "validity"};
+    const char* values[2];
+
+    if (!challenge->token_requested || challenge->attested_by_token ||
+        (ovsa_license_service_attestation_token_validity() == 0))
+        return;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    ret = ovsa_license_service_attestation_token_create(challenge->ak_name, client_platform_cert,
+                                                        sw_quote_info, hw_quote_info, &token);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create attestation token failed with code %d\n", ret);
+        goto out;
+    }
+    snprintf(validity, sizeof(validity), "%zu", ovsa_license_service_attestation_token_validity());
+    values[0] = token;
+    values[1] = validity;
+
+    ret = ovsa_license_service_json_create_string_object(names, values, 2, &token_blob);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create attestation token blob failed with code %d\n", ret);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Sending attestation token to client\n");
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_ATTESTATION_TOKEN, token_blob);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error license service write communicaton failed %d\n", ret);
+        goto out;
+    }
+out:
+    ovsa_license_service_safe_free(&token);
+    ovsa_license_service_safe_free(&token_blob);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+}
+
 static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
-    void* ssl_session, int client_fd, ovsa_quote_info_t* sw_quote_info,
+    void* ssl_session, ovsa_tpm2_challenge_t* challenge, ovsa_quote_info_t* sw_quote_info,
     ovsa_quote_info_t* hw_quote_info, char* response, char* client_platform_cert) {
     char* nonce_buf               = NULL;
     char* json_payload            = NULL;
     char* cust_lic_payload        = NULL;
     char* payload_quote_info      = NULL;
     char* payload_EK_AK_bind_info = NULL;
+    char* payload_token           = NULL;
+    char* ak_name                 = NULL;
+    char* token_request           = NULL;
     char* read_buf                = NULL;
     char* command                 = NULL;
     ovsa_command_type_t cmd       = OVSA_INVALID_CMD;
@@ -2305,7 +1544,7 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
     /*Request EK_AK bind info from client*/
-    ret = ovsa_license_service_send_client_request_EK_AK_bind(&ssl_session);
+    ret = ovsa_license_service_send_client_request_EK_AK_bind(&ssl_session, challenge);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error request_EK_AK_BIND_info failed with error code %d\n", ret);
         goto out;
@@ -2333,8 +1572,7 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
         switch (cmd) {
             case OVSA_SEND_EK_AK_BIND_INFO:
                 /* Read ek_ak bind info from json file */
-                ret = ovsa_license_service_json_extract_element(read_buf, "payload",
-                                                                &payload_EK_AK_bind_info);
+                ret = ovsa_license_service_extract_payload(read_buf, &payload_EK_AK_bind_info);
                 if (ret < OVSA_OK) {
                     OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
                     memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Sending EK_AK_bind_info",
@@ -2342,7 +1580,7 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
                     goto out;
                 }
                 ret = ovsa_license_service_do_validate_EK_AK_bind_info(
-                    &ssl_session, payload_EK_AK_bind_info, client_fd, client_platform_cert);
+                    &ssl_session, payload_EK_AK_bind_info, challenge, client_platform_cert);
                 if (ret < OVSA_OK) {
                     OVSA_DBG(DBG_E,
                              "OVSA: Error ovsa_validate_EK_AK_BIND_info failed with "
@@ -2352,11 +1590,46 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
                              strnlen_s("FAIL: Error in Validate EK_AK_bind_info", MAX_NAME_SIZE));
                     goto out;
                 }
+                /* Keep the AK and whether the client takes an attestation token */
+                ret = ovsa_license_service_json_extract_element(payload_EK_AK_bind_info,
+                                                                "AK_name", &ak_name);
+                if ((ret == OVSA_OK) && (ak_name != NULL)) {
+                    memcpy_s(challenge->ak_name, sizeof(challenge->ak_name) - 1, ak_name,
+                             strnlen_s(ak_name, sizeof(challenge->ak_name) - 1));
+                }
+                ret = ovsa_license_service_json_extract_element(
+                    payload_EK_AK_bind_info, "attestation_token", &token_request);
+                if ((ret == OVSA_OK) && (token_request != NULL) &&
+                    !strcmp(token_request, "request")) {
+                    challenge->token_requested = true;
+                }
+                ret = OVSA_OK;
+                break;
+            case OVSA_SEND_ATTESTATION_TOKEN:
+                ret = ovsa_license_service_extract_payload(read_buf, &payload_token);
+                if ((ret == OVSA_OK) && (payload_token != NULL)) {
+                    ret = ovsa_license_service_do_validate_attestation_token(
+                        payload_token, challenge, sw_quote_info, hw_quote_info,
+                        client_platform_cert);
+                }
+                if (challenge->attested_by_token) {
+                    is_quote_info_received = true;
+                    break;
+                }
+                /* Fall back to a full attestation of the platform */
+                ret = ovsa_license_service_send_client_request_EK_AK_bind(&ssl_session, challenge);
+                if (ret < OVSA_OK) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error request_EK_AK_BIND_info failed with error code %d\n",
+                             ret);
+                    memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Sending EK_AK_bind_info",
+                             strnlen_s("FAIL: Error in Sending EK_AK_bind_info", MAX_NAME_SIZE));
+                    goto out;
+                }
                 break;
             case OVSA_SEND_QUOTE_INFO:
                 /* Read sw quote from json file */
-                ret = ovsa_license_service_json_extract_element(read_buf, "payload",
-                                                                &payload_quote_info);
+                ret = ovsa_license_service_extract_payload(read_buf, &payload_quote_info);
                 if (ret < OVSA_OK) {
                     OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
                     memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Sending SW quote",
@@ -2375,12 +1648,13 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
                 break;
         }
         ovsa_license_service_safe_free((char**)&command);
-        ovsa_license_service_safe_free((char**)&read_buf);
 
     } while (is_quote_info_received == false);
 
+    if (challenge->attested_by_token)
+        goto out;
     /* Validate Secret */
-    ret = ovsa_license_service_do_validate_secret(payload_quote_info, client_fd);
+    ret = ovsa_license_service_do_validate_secret(payload_quote_info, challenge);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error validate secret failed %d\n", ret);
         memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in secret Validation Invalid runtime",
@@ -2388,7 +1662,7 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
         goto out;
     }
     /* Extract SW_quote */
-    ret = ovsa_license_service_extract_SW_quote_info(payload_quote_info, sw_quote_info, client_fd);
+    ret = ovsa_license_service_extract_SW_quote_info(payload_quote_info, sw_quote_info);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error ovsa_license_service_extract_sw_quote_info failed with "
@@ -2400,7 +1674,7 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
     }
     /* Extract HW_quote */
     ret = ovsa_license_service_extract_HW_quote_info(payload_quote_info, sw_quote_info,
-                                                     hw_quote_info, client_fd);
+                                                     hw_quote_info);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error ovsa_license_service_extract_HW_quote_info failed with "
@@ -2412,9 +1686,11 @@ static ovsa_status_t ovsa_license_service_do_exec_client_ek_ak_bind_validation(
     }
 out:
     ovsa_license_service_safe_free((char**)&command);
-    ovsa_license_service_safe_free((char**)&read_buf);
     ovsa_license_service_safe_free(&payload_EK_AK_bind_info);
     ovsa_license_service_safe_free(&payload_quote_info);
+    ovsa_license_service_safe_free(&payload_token);
+    ovsa_license_service_safe_free(&ak_name);
+    ovsa_license_service_safe_free(&token_request);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -2479,7 +1755,8 @@ out:
 #endif
 static ovsa_status_t ovsa_license_service_do_exec_license_check_protocol(
     void* ssl_session, char** nonce_buf, char** payload_signature,
-    ovsa_customer_license_sig_t* customer_lic_sig, char* response, char* client_platform_cert) {
+    ovsa_customer_license_sig_t* customer_lic_sig, char** cust_lic_batch, char* response,
+    char* client_platform_cert) {
     char* json_payload             = NULL;
     char* cust_lic_payload         = NULL;
     char* read_buf                 = NULL;
@@ -2520,8 +1797,7 @@ static ovsa_status_t ovsa_license_service_do_exec_license_check_protocol(
         switch (cmd) {
             case OVSA_SEND_SIGN_NONCE:
                 /* Read signed nonce from json file */
-                ret = ovsa_license_service_json_extract_element(read_buf, "payload",
-                                                                payload_signature);
+                ret = ovsa_license_service_extract_payload(read_buf, payload_signature);
                 if (ret < OVSA_OK) {
                     OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
                     memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Sending Signed Nonce",
@@ -2531,8 +1807,7 @@ static ovsa_status_t ovsa_license_service_do_exec_license_check_protocol(
                 break;
             case OVSA_SEND_CUST_LICENSE:
                 /* Read customer license payload from json file */
-                ret = ovsa_license_service_json_extract_element(read_buf, "payload",
-                                                                &cust_lic_payload);
+                ret = ovsa_license_service_extract_payload(read_buf, &cust_lic_payload);
                 if (ret < OVSA_OK) {
                     OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
                     memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in reading customer license",
@@ -2553,6 +1828,19 @@ static ovsa_status_t ovsa_license_service_do_exec_license_check_protocol(
                     goto out;
                 }
                 break;
+            case OVSA_SEND_CUST_LICENSE_BATCH:
+                /* Read the batch of customer licenses, validated after the protocol */
+                ret = ovsa_license_service_extract_payload(read_buf, cust_lic_batch);
+                if ((ret < OVSA_OK) || (*cust_lic_batch == NULL)) {
+                    OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
+                    memcpy_s(
+                        response, MAX_NAME_SIZE, "FAIL: Error in reading customer license batch",
+                        strnlen_s("FAIL: Error in reading customer license batch", MAX_NAME_SIZE));
+                    ret = (ret < OVSA_OK) ? ret : OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                is_license_param_received = true;
+                break;
             case OVSA_SEND_UPDATE_CUST_LICENSE_ACK:
                 /*Continue licenseing check */
                 OVSA_DBG(DBG_D,
@@ -2567,7 +1855,6 @@ static ovsa_status_t ovsa_license_service_do_exec_license_check_protocol(
                 break;
         }
         ovsa_license_service_safe_free((char**)&command);
-        ovsa_license_service_safe_free((char**)&read_buf);
 
     } while (is_license_param_received == false);
 
@@ -2595,6 +1882,248 @@ static ovsa_status_t ovsa_license_service_free_quote_info(ovsa_quote_info_t quot
 
     return ret;
 }
+/* Sends the leases of the licenses that passed the license check after the check response,
+ * runtimes without leases close the connection on the response and never read them */
+static void ovsa_license_service_send_license_leases(void* ssl_session, char* const* leases,
+                                                     size_t count) {
+    ovsa_status_t ret = OVSA_OK;
+    char* leases_blob = NULL;
+    size_t index      = 0;
+
+    if (ovsa_license_service_license_lease_validity() == 0)
+        return;
+    for (index = 0; (index < count) && (leases[index] == NULL); index++)
+        ;
+    if (index == count)
+        return;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    ret = ovsa_license_service_json_create_string_array(leases, count, &leases_blob);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create license leases blob failed with code %d\n", ret);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Sending license leases to client\n");
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_LICENSE_LEASE, leases_blob);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_I, "OVSA:License leases not delivered, write failed with code %d\n", ret);
+        goto out;
+    }
+out:
+    ovsa_license_service_safe_free(&leases_blob);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+}
+
+/*
+ * Checks one customer license of a batch against the platform attestation done once for the
+ * connection. A license that is not up to date is answered with "UPDATE", the runtime checks it
+ * again in a connection of its own to receive the updated license.
+ */
+static ovsa_status_t ovsa_license_service_do_check_batch_license(
+    void* ssl_session, struct ovsa_thread_info* ti, const char* cust_lic_payload,
+    const char* nonce_buf, char* payload_signature, ovsa_quote_info_t hw_quote_info,
+    ovsa_quote_info_t sw_quote_info, char* response, char** lease) {
+    ovsa_status_t ret     = OVSA_OK;
+    char* DB_cust_license = NULL;
+    char* cert            = NULL;
+    char* license_guid    = NULL;
+    char* model_guid      = NULL;
+    ovsa_customer_license_sig_t customer_lic_sig;
+    struct timespec stage_start;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+
+    ret = ovsa_license_service_json_extract_customer_license(cust_lic_payload, &customer_lic_sig);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error extract customer license json blob failed with code %d\n",
+                 ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in validate customer license",
+                 strnlen_s("FAIL: Error in validate customer license", MAX_NAME_SIZE));
+        goto out;
+    }
+    license_guid = customer_lic_sig.customer_lic.license_guid;
+    model_guid   = customer_lic_sig.customer_lic.model_guid;
+    ovsa_license_service_log_set_license(license_guid);
+
+    ovsa_license_service_metrics_stage_start(&stage_start);
+    ret =
+        ovsa_db_get_customer_license_blob(OVSA_DB_PATH, license_guid, model_guid, &DB_cust_license);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_DB_LOOKUP, &stage_start);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E,
+                 "OVSA: Error retrieve customer license from DB failed with error code  %d\n", ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in validate customer license",
+                 strnlen_s("FAIL: Error in validate customer license", MAX_NAME_SIZE));
+        goto out;
+    }
+    if (strcmp(cust_lic_payload, DB_cust_license)) {
+        OVSA_DBG(DBG_I, "OVSA:Runtime customer license is not UpToDate, check it on its own\n");
+        memcpy_s(response, MAX_NAME_SIZE, "UPDATE", strnlen_s("UPDATE", MAX_NAME_SIZE));
+        goto out;
+    }
+    if (ti->client_port == atoi(g_tls_port)) {
+        /*Validate platform certificate against the valid customer certificate from DB*/
+        ret = ovsa_license_service_do_validate_platform_certificate(&customer_lic_sig,
+                                                                    ti->client_platform_cert);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error validate platform certificate failed %d\n", ret);
+            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in validate platform certificate",
+                     strnlen_s("FAIL: Error in validate platform certificate", MAX_NAME_SIZE));
+            goto out;
+        }
+        /* Validate TCB */
+        ovsa_license_service_metrics_stage_start(&stage_start);
+        ret = ovsa_license_service_do_validate_tpm_quote(&customer_lic_sig, hw_quote_info,
+                                                         sw_quote_info);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_PCR_VALIDATE, &stage_start);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error validate TCB failed %d\n", ret);
+            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in TCB Validation Invalid runtime",
+                     strnlen_s("FAIL: Error in TCB Validation Invalid runtime", MAX_NAME_SIZE));
+            goto out;
+        }
+    }
+#ifdef ENABLE_SGX_GRAMINE
+    if (ti->client_port == atoi(g_ratls_port)) {
+        /*Validate customer tcb */
+        ret = ovsa_license_service_do_validate_sgx_measurement(&customer_lic_sig,
+                                                               ti->sgx_measurement);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error validate SGX measurement failed %d\n", ret);
+            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in TCB Validation Invalid runtime",
+                     strnlen_s("FAIL: Error in TCB Validation Invalid runtime", MAX_NAME_SIZE));
+            goto out;
+        }
+    }
+#endif
+    /* The nonce is signed once with the key the licenses of the batch share */
+    ovsa_license_service_metrics_stage_start(&stage_start);
+    ret = ovsa_db_get_customer_secondary_certificate(OVSA_DB_PATH, license_guid, model_guid, &cert);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_DB_LOOKUP, &stage_start);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error retrieve customer certificate failed with error code  %d\n",
+                 ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Retrieving customer certificate",
+                 strnlen_s("FAIL: Error in Retrieving customer certificate", MAX_NAME_SIZE));
+        goto out;
+    }
+    ret = ovsa_license_service_crypto_verify_mem(cert, nonce_buf, NONCE_SIZE, payload_signature);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_NONCE_VERIFY, &stage_start);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error Nonce verify fail %d\n", ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Nonce Verification",
+                 strnlen_s("FAIL: Error in Nonce Verification", MAX_NAME_SIZE));
+        goto out;
+    }
+    /*Perform License check*/
+    ret =
+        ovsa_license_service_client_license_check(ssl_session, license_guid, model_guid, response);
+    if ((ret == OVSA_OK) && (ovsa_license_service_license_lease_validity() > 0)) {
+        if (ovsa_license_service_license_lease_create(license_guid, model_guid, lease) < OVSA_OK)
+            OVSA_DBG(DBG_E, "OVSA: Error create license lease of %s failed\n", license_guid);
+    }
+out:
+    ovsa_license_service_safe_free(&DB_cust_license);
+    ovsa_license_service_safe_free(&cert);
+    ovsa_license_service_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
+    ovsa_license_service_safe_free_tcb_list(&customer_lic_sig.customer_lic.tcb_signatures);
+    ovsa_license_service_safe_free_url_list(&customer_lic_sig.customer_lic.license_url_list);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+static ovsa_status_t ovsa_license_service_do_exec_license_check_batch(
+    void* ssl_session, struct ovsa_thread_info* ti, const char* cust_lic_batch,
+    const char* nonce_buf, char* payload_signature, ovsa_tpm2_challenge_t* challenge,
+    ovsa_quote_info_t* hw_quote_info, ovsa_quote_info_t* sw_quote_info, char* response,
+    bool* response_sent) {
+    ovsa_status_t ret    = OVSA_OK;
+    char** cust_licenses = NULL;
+    char** responses     = NULL;
+    char** leases        = NULL;
+    char* batch_response = NULL;
+    size_t count         = 0;
+    size_t index         = 0;
+    struct timespec stage_start;
+    OVSA_TRACE_SPAN(span);
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    ret = ovsa_license_service_json_extract_string_array(cust_lic_batch, MAX_LICENSE_BATCH_SIZE,
+                                                         &cust_licenses, &count);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read customer license batch failed with code %d\n", ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in reading customer license batch",
+                 strnlen_s("FAIL: Error in reading customer license batch", MAX_NAME_SIZE));
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Received batch of %zu customer licenses\n", count);
+    if ((ti->client_port == atoi(g_tls_port)) && !challenge->attested_by_token) {
+        /* The quote attests the platform and is verified once for all the licenses */
+        ovsa_license_service_metrics_stage_start(&stage_start);
+        OVSA_TRACE_BEGIN(span, "server_quote_verify");
+        ret = ovsa_license_service_tpm2_verifyquote(challenge, hw_quote_info, sw_quote_info);
+        OVSA_TRACE_END(span);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_QUOTE_VERIFY, &stage_start);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "Error verify quote failed with code %d\n", ret);
+            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Quote Validation Invalid runtime",
+                     strnlen_s("FAIL: Error in Quote Validation Invalid runtime", MAX_NAME_SIZE));
+            goto out;
+        }
+        ovsa_license_service_send_attestation_token(ssl_session, challenge,
+                                                    ti->client_platform_cert, sw_quote_info,
+                                                    hw_quote_info);
+    }
+    responses = (char**)calloc(count, sizeof(char*));
+    leases    = (char**)calloc(count, sizeof(char*));
+    if ((responses == NULL) || (leases == NULL)) {
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error memory allocation of batch responses failed\n");
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in License check",
+                 strnlen_s("FAIL: Error in License check", MAX_NAME_SIZE));
+        goto out;
+    }
+    for (index = 0; index < count; index++) {
+        ret = ovsa_license_service_safe_malloc(MAX_NAME_SIZE + 1, &responses[index]);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error memory allocation of batch response failed\n");
+            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in License check",
+                     strnlen_s("FAIL: Error in License check", MAX_NAME_SIZE));
+            goto out;
+        }
+        ret = ovsa_license_service_do_check_batch_license(
+            ssl_session, ti, cust_licenses[index], nonce_buf, payload_signature, *hw_quote_info,
+            *sw_quote_info, responses[index], &leases[index]);
+        OVSA_DBG(DBG_I, "OVSA:License %zu of the batch: '%s'\n", index, responses[index]);
+        ovsa_license_service_metrics_license_check_result(responses[index]);
+    }
+    ret = ovsa_license_service_json_create_string_array(responses, count, &batch_response);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create batch response failed with code %d\n", ret);
+        memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in License check",
+                 strnlen_s("FAIL: Error in License check", MAX_NAME_SIZE));
+        goto out;
+    }
+    *response_sent = true;
+    ret            = ovsa_license_service_send_license_check_response(
+        ssl_session, OVSA_SEND_LICENSE_CHECK_BATCH_RESP, batch_response);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error send batch response failed with code %d\n", ret);
+        goto out;
+    }
+    ovsa_license_service_send_license_leases(ssl_session, leases, count);
+out:
+    ovsa_license_service_json_free_string_array(&responses, count);
+    ovsa_license_service_json_free_string_array(&leases, count);
+    ovsa_license_service_json_free_string_array(&cust_licenses, count);
+    ovsa_license_service_safe_free(&batch_response);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
 static ovsa_status_t ovsa_license_service_client_license_service_callback(void* ssl_session,
                                                                           void* data) {
     ovsa_status_t ret             = OVSA_OK;
@@ -2608,38 +2137,60 @@ static ovsa_status_t ovsa_license_service_client_license_service_callback(void*
     char* model_guid              = NULL;
     char* read_buf                = NULL;
     char* command                 = NULL;
+    char* cust_lic_batch          = NULL;
+    char* lease                   = NULL;
+    bool response_sent            = false;
+    bool license_passed           = false;
     ovsa_command_type_t cmd       = OVSA_INVALID_CMD;
     ovsa_quote_info_t sw_quote_info;
     ovsa_quote_info_t hw_quote_info;
+    ovsa_tpm2_challenge_t challenge;
     char response[MAX_NAME_SIZE];
     ovsa_customer_license_sig_t customer_lic_sig;
+    struct timespec check_start;
+    struct timespec stage_start;
+    OVSA_TRACE_SPAN(check_span);
+    OVSA_TRACE_SPAN(span);
 
     struct ovsa_thread_info* ti = (struct ovsa_thread_info*)data;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s \n", __func__);
+    ovsa_license_service_metrics_stage_start(&check_start);
+    OVSA_TRACE_BEGIN(check_span, "server_license_check");
 
     memset_s(response, sizeof(response), 0);
     memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
     memset_s(&sw_quote_info, sizeof(ovsa_quote_info_t), 0);
     memset_s(&hw_quote_info, sizeof(ovsa_quote_info_t), 0);
+    memset_s(&challenge, sizeof(ovsa_tpm2_challenge_t), 0);
 
     if (ti->client_port == atoi(g_tls_port)) {
+        ovsa_license_service_metrics_stage_start(&stage_start);
+        OVSA_TRACE_BEGIN(span, "server_ek_ak_bind");
         ret = ovsa_license_service_do_exec_client_ek_ak_bind_validation(
-            ssl_session, ti->client_fd.fd, &sw_quote_info, &hw_quote_info, response,
+            ssl_session, &challenge, &sw_quote_info, &hw_quote_info, response,
             ti->client_platform_cert);
+        OVSA_TRACE_END(span);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_EK_AK_BIND, &stage_start);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error in executing EK AK Bind validation with ret code %d\n",
                      ret);
             goto out1;
         }
     }
-    ret = ovsa_license_service_do_exec_license_check_protocol(ssl_session, &nonce_buf,
-                                                              &payload_signature, &customer_lic_sig,
-                                                              response, ti->client_platform_cert);
+    ret = ovsa_license_service_do_exec_license_check_protocol(
+        ssl_session, &nonce_buf, &payload_signature, &customer_lic_sig, &cust_lic_batch, response,
+        ti->client_platform_cert);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error license check protocol failed with error code  %d\n", ret);
         goto out1;
     }
+    if (cust_lic_batch != NULL) {
+        ret = ovsa_license_service_do_exec_license_check_batch(
+            ssl_session, ti, cust_lic_batch, nonce_buf, payload_signature, &challenge,
+            &hw_quote_info, &sw_quote_info, response, &response_sent);
+        goto out1;
+    }
     if (ti->client_port == atoi(g_tls_port)) {
         /*Validate platform certificate against the valid customer certificate from DB*/
         ret = ovsa_license_service_do_validate_platform_certificate(&customer_lic_sig,
@@ -2654,25 +2205,37 @@ static ovsa_status_t ovsa_license_service_client_license_service_callback(void*
             goto out1;
         }
         /* Validate TCB */
-        ret = ovsa_license_service_do_validate_tpm_quote(&customer_lic_sig, ti->client_fd.fd,
-                                                         hw_quote_info, sw_quote_info);
+        ovsa_license_service_metrics_stage_start(&stage_start);
+        OVSA_TRACE_BEGIN(span, "server_pcr_validate");
+        ret = ovsa_license_service_do_validate_tpm_quote(&customer_lic_sig, hw_quote_info,
+                                                         sw_quote_info);
+        OVSA_TRACE_END(span);
+        ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_PCR_VALIDATE, &stage_start);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error validate TCB failed %d\n", ret);
             memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in TCB Validation Invalid runtime",
                      strnlen_s("FAIL: Error in TCB Validation Invalid runtime", MAX_NAME_SIZE));
             goto out1;
         }
-        /* Verify quote */
-        ret =
-            ovsa_license_service_tpm2_verifyquote(ti->client_fd.fd, &hw_quote_info, &sw_quote_info);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "Error verify quote failed with code %d\n", ret);
-            memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Quote Validation Invalid runtime",
-                     strnlen_s("FAIL: Error in Quote Validation Invalid runtime", MAX_NAME_SIZE));
-            goto out1;
+        /* Verify quote, unless the platform was attested by a token */
+        if (!challenge.attested_by_token) {
+            OVSA_TRACE_BEGIN(span, "server_quote_verify");
+            ret = ovsa_license_service_tpm2_verifyquote(&challenge, &hw_quote_info,
+                                                        &sw_quote_info);
+            OVSA_TRACE_END(span);
+            ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_QUOTE_VERIFY,
+                                                    &stage_start);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "Error verify quote failed with code %d\n", ret);
+                memcpy_s(
+                    response, MAX_NAME_SIZE, "FAIL: Error in Quote Validation Invalid runtime",
+                    strnlen_s("FAIL: Error in Quote Validation Invalid runtime", MAX_NAME_SIZE));
+                goto out1;
+            }
+            ovsa_license_service_send_attestation_token(ssl_session, &challenge,
+                                                        ti->client_platform_cert, &sw_quote_info,
+                                                        &hw_quote_info);
         }
-        /* remove quote files from tmp directory */
-        ovsa_license_service_remove_quote_files(ti->client_fd.fd);
     }
 #ifdef ENABLE_SGX_GRAMINE
     if (ti->client_port == atoi(g_ratls_port)) {
@@ -2704,7 +2267,9 @@ static ovsa_status_t ovsa_license_service_client_license_service_callback(void*
              "%s\n\nExtract customer certificate frm db\n",
              license_guid, model_guid);
 
+    ovsa_license_service_metrics_stage_start(&stage_start);
     ret = ovsa_db_get_customer_secondary_certificate(OVSA_DB_PATH, license_guid, model_guid, &cert);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_DB_LOOKUP, &stage_start);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error retrieve customer certificate failed with error code  %d\n",
                  ret);
@@ -2714,7 +2279,10 @@ static ovsa_status_t ovsa_license_service_client_license_service_callback(void*
     }
     /* Verify Nonce */
     OVSA_DBG(DBG_I, "OVSA:Verify Nonce\n");
+    OVSA_TRACE_BEGIN(span, "server_nonce_verify");
     ret = ovsa_license_service_crypto_verify_mem(cert, nonce_buf, NONCE_SIZE, payload_signature);
+    OVSA_TRACE_END(span);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_NONCE_VERIFY, &stage_start);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error Nonce verify fail. Customer license service failed %d\n", ret);
         memcpy_s(response, MAX_NAME_SIZE, "FAIL: Error in Nonce Verification",
@@ -2728,16 +2296,31 @@ static ovsa_status_t ovsa_license_service_client_license_service_callback(void*
         ovsa_license_service_client_license_check(ssl_session, license_guid, model_guid, response);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error client license check failed with error code %d\n", ret);
+    } else {
+        license_passed = true;
     }
 out1:
     OVSA_DBG(DBG_D, "OVSA:Customer TCB check /license check /quote check:'%s'\n", response);
 
     /* Send check response to client */
-    ret = ovsa_license_service_send_license_check_response(ssl_session, response);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_send_license_check_response failed %d\n",
-                 ret);
+    if (!response_sent) {
+        ret = ovsa_license_service_send_license_check_response(
+            ssl_session, OVSA_SEND_LICENSE_CHECK_RESP, response);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error ovsa_license_service_send_license_check_response failed %d\n",
+                     ret);
+        } else if (license_passed && (ovsa_license_service_license_lease_validity() > 0)) {
+            if (ovsa_license_service_license_lease_create(license_guid, model_guid, &lease) ==
+                OVSA_OK)
+                ovsa_license_service_send_license_leases(ssl_session, &lease, 1);
+        }
     }
+    /* The licenses of a batch are counted one by one */
+    if (!response_sent)
+        ovsa_license_service_metrics_license_check_result(response);
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_LICENSE_CHECK, &check_start);
+    OVSA_TRACE_END(check_span);
     ret = ovsa_license_service_close(ssl_session);
     if (ret < OVSA_OK)
         OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_close failed with code %d\n", ret);
@@ -2745,6 +2328,8 @@ out1:
     ovsa_license_service_safe_free((char**)&read_buf);
     ovsa_license_service_safe_free(&payload_signature);
     ovsa_license_service_safe_free(&cust_lic_payload);
+    ovsa_license_service_safe_free(&cust_lic_batch);
+    ovsa_license_service_safe_free(&lease);
     ovsa_license_service_safe_free(&nonce_buf);
     ovsa_license_service_safe_free(&cert);
     ovsa_license_service_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
@@ -2779,15 +2364,108 @@ static ovsa_status_t ovsa_license_service_write(void* ssl, const uint8_t* buf, s
         if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
             continue;
         if (ret < OVSA_OK) {
-            if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
-                ret = -ECONNRESET;
-            OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_write failed with error code %d\n", ret);
-            return OVSA_MBEDTLS_SSL_WRITE_FAILED;
+            if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+                ret = -ECONNRESET;
+            OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_write failed with error code %d\n", ret);
+            return OVSA_MBEDTLS_SSL_WRITE_FAILED;
+        }
+        written += (size_t)ret;
+    }
+    assert(written == len);
+    return (int)written;
+}
+
+/* Grows a message buffer of a connection to at least size bytes, its content is not kept */
+static ovsa_status_t ovsa_license_service_reserve_buffer(char** buf, size_t* buf_size,
+                                                         size_t size) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t new_size   = (*buf_size > 0) ? *buf_size : LICENSE_SERVICE_MSG_BUF_SIZE;
+    char* new_buf     = NULL;
+
+    if ((*buf != NULL) && (size <= *buf_size))
+        return OVSA_OK;
+    while (new_size < size)
+        new_size *= 2;
+    ret = ovsa_license_service_safe_malloc(new_size, &new_buf);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error message buffer allocation failed with code %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    if (*buf != NULL) {
+        memset_s(*buf, *buf_size, 0);
+        free(*buf);
+    }
+    *buf      = new_buf;
+    *buf_size = new_size;
+    return OVSA_OK;
+}
+
+/*
+ * Sends a message to the client prefixed with its length. The message is laid out in the transmit
+ * buffer of the connection, as a JSON message blob or in the binary framing once the client used
+ * it.
+ */
+static ovsa_status_t ovsa_license_service_send_message(void* ssl, const ovsa_command_type_t cmd,
+                                                       const char* payload) {
+    ovsa_client_connection_t* client = (ovsa_client_connection_t*)ssl;
+    ovsa_status_t ret                = OVSA_OK;
+    const char* name                 = NULL;
+    char* json_buf                   = NULL;
+    size_t name_len                  = 0;
+    size_t payload_len               = 0;
+    size_t offset                    = 0;
+    size_t len                       = 0;
+
+    if ((client == NULL) || (payload == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    if (client->binary_framing) {
+        name = ovsa_license_service_get_command_name(cmd);
+        if ((name == NULL) ||
+            (ovsa_license_service_get_string_length(payload, &payload_len) < OVSA_OK)) {
+            OVSA_DBG(DBG_E, "OVSA: Error invalid message command %d\n", cmd);
+            return OVSA_INVALID_PARAMETER;
+        }
+        name_len = strnlen_s(name, MAX_COMMAND_TYPE_LENGTH);
+        len      = 1 + (2 * OVSA_TLV_RECORD_HEADER_SIZE) + name_len + payload_len;
+    } else {
+        ret = ovsa_license_service_json_create_message_blob(cmd, payload, &json_buf, &len);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error create message blob failed with error code %d\n", ret);
+            goto out;
         }
-        written += (size_t)ret;
+        ret = ovsa_license_service_get_string_length(json_buf, &len);
+        if (ret < OVSA_OK)
+            goto out;
     }
-    assert(written == len);
-    return (int)written;
+    if (len > LICENSE_SERVICE_MAX_MSG_SIZE) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid message length\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    /* Room for the NUL written after the length prefix */
+    ret = ovsa_license_service_reserve_buffer(&client->tx_buf, &client->tx_buf_size,
+                                              PAYLOAD_LENGTH + len + 1);
+    if (ret < OVSA_OK)
+        goto out;
+    snprintf(client->tx_buf, PAYLOAD_LENGTH + 1, "%08zu", len);
+    offset = PAYLOAD_LENGTH;
+    if (client->binary_framing) {
+        client->tx_buf[offset++] = (char)OVSA_TLV_MAGIC;
+        offset += ovsa_license_service_tlv_put_record(client->tx_buf + offset,
+                                                      OVSA_TLV_TYPE_COMMAND, name, name_len);
+        offset += ovsa_license_service_tlv_put_record(client->tx_buf + offset,
+                                                      OVSA_TLV_TYPE_PAYLOAD, payload, payload_len);
+    } else {
+        memcpy_s(client->tx_buf + offset, client->tx_buf_size - offset, json_buf, len);
+        offset += len;
+    }
+    ret = ovsa_license_service_write(ssl, (uint8_t*)client->tx_buf, offset);
+    memset_s(client->tx_buf, offset, 0);
+out:
+    ovsa_license_service_safe_free(&json_buf);
+    return ret;
 }
 
 static ovsa_status_t ovsa_license_service_read(void* ssl, uint8_t* buf, size_t len) {
@@ -2843,61 +2521,58 @@ static ovsa_status_t ovsa_license_service_close(void* ssl) {
     return ret;
 }
 
-static void* ovsa_license_service_client_connection(void* data) {
-    ovsa_status_t ret           = OVSA_OK;
-    int client_port             = 0;
-    struct ovsa_thread_info* ti = (struct ovsa_thread_info*)data;
-    int handshake_status        = 0;
+static ovsa_status_t ovsa_license_service_client_connection(struct ovsa_thread_info* ti) {
+    ovsa_status_t ret = OVSA_OK;
+    int client_port   = 0;
+    struct timespec stage_start;
+    OVSA_TRACE_SPAN(span);
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    mbedtls_ssl_context ssl;
-    mbedtls_ssl_init(&ssl);
+    ovsa_client_connection_t conn;
+    memset_s(&conn, sizeof(conn), 0);
+    mbedtls_ssl_init(&conn.ssl);
+    ovsa_license_service_log_begin_connection();
+    ovsa_license_service_metrics_count(OVSA_METRICS_CONNECTIONS);
+    ovsa_license_service_metrics_stage_start(&stage_start);
+    /* Until the client sends one, the spans of the connection have no correlation ID */
+    OVSA_TRACE_SET_CORRELATION_ID(NULL, 0);
+    OVSA_TRACE_BEGIN(span, "server_tls_handshake");
 
     client_port = ti->client_port;
-    ret         = mbedtls_ssl_setup(&ssl, ti->conf);
+    ret         = mbedtls_ssl_setup(&conn.ssl, ti->conf);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_setup failed with error code %d\n", ret);
         ret = OVSA_MBEDTLS_SSL_SETUP_FAILED;
         goto out;
     }
-    mbedtls_ssl_conf_read_timeout(&g_conf, READ_TIMEOUT_MS);
-    mbedtls_ssl_set_bio(&ssl, &ti->client_fd, mbedtls_net_send, mbedtls_net_recv,
+    mbedtls_ssl_set_bio(&conn.ssl, &ti->client_fd, mbedtls_net_send, mbedtls_net_recv,
                         mbedtls_net_recv_timeout);
+#ifdef ENABLE_SGX_GRAMINE
+    /* RA-TLS measurements of this handshake are reported into the connection context */
+    g_thread_sgx_measurement = &ti->sgx_measurement;
+#endif
     ret = -1;
     while (ret < OVSA_OK) {
         OVSA_DBG(DBG_I, "OVSA:Calling mbedtls_ssl_handshake\n");
-        ret = pthread_mutex_lock(&g_handshake_lock);
-        if (ret != OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error mutex lock failed %d\n", ret);
-            goto out;
-        }
-        handshake_status = mbedtls_ssl_handshake(&ssl);
-#ifdef ENABLE_SGX_GRAMINE
-        if (ti->client_port == atoi(g_ratls_port)) {
-            memcpy_s(&ti->sgx_measurement, sizeof(ovsa_sgx_measurement_t), &g_sgx_measurement,
-                     sizeof(ovsa_sgx_measurement_t));
-        }
-#endif
-        ret = pthread_mutex_unlock(&g_handshake_lock);
-        if (ret != OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error mutex unlock failed %d\n", ret);
-            goto out;
-        }
-        if (handshake_status == MBEDTLS_ERR_SSL_WANT_READ ||
-            handshake_status == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        ret = mbedtls_ssl_handshake(&conn.ssl);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
             OVSA_DBG(DBG_I, "OVSA: MBEDTLS_ERR_SSL_WANT_READ_WRITE\n");
             continue;
         }
-        if (handshake_status < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: mbedtls_ssl_handshake returned error %d\n", handshake_status);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: mbedtls_ssl_handshake returned error %d\n", ret);
+            ovsa_license_service_metrics_count(OVSA_METRICS_HANDSHAKE_FAILURES);
+            OVSA_TRACE_END(span);
             ret = OVSA_MBEDTLS_SSL_HANDSHAKE_FAILED;
             goto out;
         }
     }
+    ovsa_license_service_metrics_stage_done(OVSA_METRICS_STAGE_HANDSHAKE, &stage_start);
+    OVSA_TRACE_END(span);
 #ifdef ENABLE_SGX_GRAMINE
     if (client_port == atoi(g_ratls_port)) {
-        uint32_t flags = mbedtls_ssl_get_verify_result(&ssl);
+        uint32_t flags = mbedtls_ssl_get_verify_result(&conn.ssl);
         if (flags != 0) {
             ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
             goto out;
@@ -2908,29 +2583,360 @@ static void* ovsa_license_service_client_connection(void* data) {
         /* pass ownership of SSL session with client to the caller; it is caller's
          * responsibility to gracefully terminate the session using
          * ovsa_license_service_close() */
-        ti->f_cb(&ssl, ti);
+        ret = ti->f_cb(&conn.ssl, ti);
     } else {
-        ret = ovsa_license_service_close(&ssl);
+        ret = ovsa_license_service_close(&conn.ssl);
         if (ret < OVSA_OK)
             OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_close failed with code %d\n", ret);
     }
 
 out:
-    mbedtls_ssl_free(&ssl);
+#ifdef ENABLE_SGX_GRAMINE
+    g_thread_sgx_measurement = NULL;
+#endif
+    mbedtls_ssl_free(&conn.ssl);
+    if (conn.tx_buf != NULL) {
+        memset_s(conn.tx_buf, conn.tx_buf_size, 0);
+        free(conn.tx_buf);
+    }
+    if (conn.rx_buf != NULL) {
+        memset_s(conn.rx_buf, conn.rx_buf_size, 0);
+        free(conn.rx_buf);
+    }
     mbedtls_net_free(&ti->client_fd);
-    ovsa_license_service_safe_free((char**)&ti);
+    ovsa_license_service_metrics_count(OVSA_METRICS_CONNECTIONS_CLOSED);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    ovsa_license_service_log_end_connection();
+    return ret;
+}
+
+static size_t ovsa_license_service_get_config_value(const char* env_name, size_t default_value,
+                                                    size_t max_value) {
+    char* env_value = NULL;
+    char* endptr    = NULL;
+    size_t value    = 0;
+
+    env_value = getenv(env_name);
+    if (env_value == NULL)
+        return default_value;
+
+    value = (size_t)strtoul(env_value, &endptr, 10);
+    if ((*endptr != '\0') || (value == 0) || (value > max_value)) {
+        OVSA_DBG(DBG_I, "OVSA:WARNING: %s='%s' is not valid [valid range=1:%zu], using %zu\n",
+                 env_name, env_value, max_value, default_value);
+        return default_value;
+    }
+    return value;
+}
+
+static ovsa_status_t ovsa_license_service_accept_queue_init(size_t capacity) {
+    ovsa_status_t ret = OVSA_OK;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(&g_accept_queue, sizeof(g_accept_queue), 0);
+    ret = ovsa_license_service_safe_malloc(capacity * sizeof(ovsa_accept_entry_t),
+                                           (char**)&g_accept_queue.entries);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating accept queue of %zu entries failed\n", capacity);
+        goto out;
+    }
+    g_accept_queue.capacity = capacity;
+
+    ret = pthread_mutex_init(&g_accept_queue.lock, NULL);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error accept queue mutex init failed %d\n", ret);
+        ovsa_license_service_safe_free((char**)&g_accept_queue.entries);
+        goto out;
+    }
+    ret = pthread_cond_init(&g_accept_queue.not_empty, NULL);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error accept queue condition init failed %d\n", ret);
+        pthread_mutex_destroy(&g_accept_queue.lock);
+        ovsa_license_service_safe_free((char**)&g_accept_queue.entries);
+        goto out;
+    }
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+static void ovsa_license_service_accept_queue_deinit(void) {
+    size_t index = 0;
+
+    /* The queue init cleans up after itself when it fails */
+    if (g_accept_queue.entries == NULL)
+        return;
+    /* Connections still waiting for a worker are dropped */
+    for (index = 0; index < g_accept_queue.depth; index++) {
+        mbedtls_net_free(
+            &g_accept_queue.entries[(g_accept_queue.head + index) % g_accept_queue.capacity]
+                 .client_fd);
+    }
+    pthread_cond_destroy(&g_accept_queue.not_empty);
+    pthread_mutex_destroy(&g_accept_queue.lock);
+    ovsa_license_service_safe_free((char**)&g_accept_queue.entries);
+}
+
+/* Hands an accepted connection over to the worker pool. When all workers are busy and the
+ * queue is full the connection is refused so that the client can retry later, instead of
+ * piling up sockets and memory inside the service. */
+static ovsa_status_t ovsa_license_service_accept_queue_push(mbedtls_net_context* client_fd,
+                                                            mbedtls_ssl_config* conf,
+                                                            unsigned int client_port) {
+    ovsa_status_t ret          = OVSA_OK;
+    ovsa_accept_entry_t* entry = NULL;
+
+    ret = pthread_mutex_lock(&g_accept_queue.lock);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error mutex lock failed %d\n", ret);
+        return ret;
+    }
+    if (g_accept_queue.depth == g_accept_queue.capacity) {
+        g_accept_queue.rejected++;
+        ovsa_license_service_metrics_count(OVSA_METRICS_CONNECTIONS_REJECTED);
+        OVSA_DBG(DBG_E, "OVSA: Error accept queue full (%zu), rejected connections: %lu\n",
+                 g_accept_queue.capacity, g_accept_queue.rejected);
+        ret = OVSA_ACCEPT_QUEUE_FULL;
+    } else {
+        entry = &g_accept_queue.entries[(g_accept_queue.head + g_accept_queue.depth) %
+                                        g_accept_queue.capacity];
+        memcpy_s(&entry->client_fd, sizeof(entry->client_fd), client_fd, sizeof(*client_fd));
+        entry->conf        = conf;
+        entry->client_port = client_port;
+        g_accept_queue.depth++;
+        g_accept_queue.accepted++;
+        if (g_accept_queue.depth > g_accept_queue.max_depth)
+            g_accept_queue.max_depth = g_accept_queue.depth;
+        pthread_cond_signal(&g_accept_queue.not_empty);
+    }
+    pthread_mutex_unlock(&g_accept_queue.lock);
+
+    return ret;
+}
+
+/* Blocks until a connection is queued; returns OVSA_FAIL once the pool is shutting down */
+static ovsa_status_t ovsa_license_service_accept_queue_pop(ovsa_accept_entry_t* entry) {
+    ovsa_status_t ret = OVSA_OK;
+
+    ret = pthread_mutex_lock(&g_accept_queue.lock);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error mutex lock failed %d\n", ret);
+        return ret;
+    }
+    while (g_accept_queue.depth == 0 && !g_accept_queue.shutdown)
+        pthread_cond_wait(&g_accept_queue.not_empty, &g_accept_queue.lock);
+
+    if (g_accept_queue.shutdown) {
+        ret = OVSA_FAIL;
+    } else {
+        memcpy_s(entry, sizeof(*entry), &g_accept_queue.entries[g_accept_queue.head],
+                 sizeof(ovsa_accept_entry_t));
+        g_accept_queue.head = (g_accept_queue.head + 1) % g_accept_queue.capacity;
+        g_accept_queue.depth--;
+    }
+    pthread_mutex_unlock(&g_accept_queue.lock);
+
+    return ret;
+}
+
+static void ovsa_license_service_report_queue_stats(void) {
+    size_t depth      = 0;
+    size_t max_depth  = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+
+    if (pthread_mutex_lock(&g_accept_queue.lock) != OVSA_OK)
+        return;
+    depth     = g_accept_queue.depth;
+    max_depth = g_accept_queue.max_depth;
+    accepted  = g_accept_queue.accepted;
+    rejected  = g_accept_queue.rejected;
+    /* High watermark is reported per interval */
+    g_accept_queue.max_depth = depth;
+    pthread_mutex_unlock(&g_accept_queue.lock);
+
+    OVSA_DBG(DBG_I,
+             "OVSA:Accept queue depth %zu/%zu (max %zu), accepted connections %lu, rejected "
+             "connections %lu\n",
+             depth, g_accept_queue.capacity, max_depth, accepted, rejected);
+}
+
+static int ovsa_license_service_entropy_func(void* data, unsigned char* output, size_t len) {
+    int ret = MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+
+    if (pthread_mutex_lock(&g_entropy_lock) != 0)
+        return ret;
+    ret = mbedtls_entropy_func(data, output, len);
+    pthread_mutex_unlock(&g_entropy_lock);
+    return ret;
+}
+
+/* RNG of the SSL configurations, p_rng is the DRBG of the server used outside the workers */
+static int ovsa_license_service_drbg_random(void* p_rng, unsigned char* output, size_t len) {
+    if (g_thread_ctr_drbg != NULL)
+        return mbedtls_ctr_drbg_random(g_thread_ctr_drbg, output, len);
+    return mbedtls_ctr_drbg_random(p_rng, output, len);
+}
+
+static void* ovsa_license_service_worker(void* data) {
+    ovsa_worker_t* worker = (ovsa_worker_t*)data;
+    const char pers[]     = "ovsa-license-service-worker";
+    ovsa_accept_entry_t entry;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    /* Not fatal, the handshakes of the worker use the DRBG of the server instead */
+    mbedtls_ctr_drbg_init(&worker->ctr_drbg);
+    if (mbedtls_ctr_drbg_seed(&worker->ctr_drbg, ovsa_license_service_entropy_func,
+                              worker->entropy, (const uint8_t*)pers, sizeof(pers)) == 0)
+        g_thread_ctr_drbg = &worker->ctr_drbg;
+    else
+        OVSA_DBG(DBG_E, "OVSA: Error seeding worker DRBG failed\n");
+
+    /* Not fatal, the queries retry opening the connection on their own */
+    if (ovsa_db_open_connection(OVSA_DB_PATH) < OVSA_OK)
+        OVSA_DBG(DBG_E, "OVSA: Error opening worker DB connection failed\n");
+
+    while (ovsa_license_service_accept_queue_pop(&entry) == OVSA_OK) {
+        /* The connection context is owned by the worker and reused across connections */
+        struct ovsa_thread_info* ti = worker->ti;
+
+        memset_s(ti, sizeof(struct ovsa_thread_info), 0);
+        memcpy_s(&ti->client_fd, sizeof(ti->client_fd), &entry.client_fd,
+                 sizeof(entry.client_fd));
+        ti->conf        = entry.conf;
+        ti->f_cb        = worker->f_cb;
+        ti->client_port = entry.client_port;
+
+        ovsa_license_service_client_connection(ti);
+    }
+
+    ovsa_db_close_connection();
+    g_thread_ctr_drbg = NULL;
+    mbedtls_ctr_drbg_free(&worker->ctr_drbg);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return NULL;
 }
 
+static ovsa_status_t ovsa_license_service_start_workers(ovsa_worker_t* workers, size_t count,
+                                                        mbedtls_entropy_context* entropy,
+                                                        ovsa_license_service_cb_t f_cb) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t index      = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    for (index = 0; index < count; index++) {
+        workers[index].f_cb    = f_cb;
+        workers[index].entropy = entropy;
+        ret = ovsa_license_service_safe_malloc(sizeof(struct ovsa_thread_info),
+                                               (char**)&workers[index].ti);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error allocating worker context failed\n");
+            goto out;
+        }
+        ret = pthread_create(&workers[index].tid, NULL, ovsa_license_service_worker,
+                             &workers[index]);
+        if (ret != OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error pthread_create failed with error code %d\n", ret);
+            ovsa_license_service_safe_free((char**)&workers[index].ti);
+            ret = OVSA_THREAD_CREATE_FAIL;
+            goto out;
+        }
+        workers[index].started = true;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Started %zu worker threads\n", count);
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+static void ovsa_license_service_stop_workers(ovsa_worker_t* workers, size_t count) {
+    size_t index = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if (pthread_mutex_lock(&g_accept_queue.lock) == OVSA_OK) {
+        g_accept_queue.shutdown = true;
+        pthread_cond_broadcast(&g_accept_queue.not_empty);
+        pthread_mutex_unlock(&g_accept_queue.lock);
+    }
+    for (index = 0; index < count; index++) {
+        if (workers[index].started) {
+            pthread_join(workers[index].tid, NULL);
+            workers[index].started = false;
+        }
+        ovsa_license_service_safe_free((char**)&workers[index].ti);
+    }
+
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+}
+
+static void ovsa_license_service_shutdown_handler(int signum) {
+    g_shutdown_requested = 1;
+}
+
+static ovsa_status_t ovsa_license_service_setup_ssl_config(mbedtls_ssl_config* conf,
+                                                           int authmode,
+                                                           mbedtls_ctr_drbg_context* ctr_drbg,
+                                                           mbedtls_x509_crt* srvcert,
+                                                           mbedtls_pk_context* srvkey) {
+    ovsa_status_t ret = OVSA_OK;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    ret = mbedtls_ssl_config_defaults(conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_config_defaults failed with code %d\n", ret);
+        ret = OVSA_MBEDTLS_SSL_CONFIG_DEFAULTS_FAILED;
+        goto out;
+    }
+    mbedtls_ssl_conf_rng(conf, ovsa_license_service_drbg_random, ctr_drbg);
+    /* mbedtls debug */
+    mbedtls_ssl_conf_dbg(conf, ovsa_license_service_mbedtls_debug_cb, NULL);
+    mbedtls_ssl_conf_curves(conf, g_curve_list);
+    mbedtls_ssl_conf_ciphersuites(conf, g_cipher_suite);
+    mbedtls_ssl_conf_authmode(conf, authmode);
+    mbedtls_ssl_conf_read_timeout(conf, READ_TIMEOUT_MS);
+
+    ret = mbedtls_ssl_conf_own_cert(conf, srvcert, srvkey);
+    if (ret < OVSA_OK) {
+        ret = OVSA_MBEDTLS_SSL_CONFIG_OWN_CERT;
+        OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_conf_own_cert failed with error code %d\n", ret);
+        goto out;
+    }
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
 static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, const char* key_path,
 #ifdef ENABLE_SGX_GRAMINE
                                                        sgx_measurements_cb_t m_cb,
 #endif
                                                        ovsa_license_service_cb_t f_cb) {
-    ovsa_status_t ret = OVSA_OK;
-    int client_port   = 0;
-    int index         = 0;
+    ovsa_status_t ret      = OVSA_OK;
+    int client_port        = 0;
+    int index              = 0;
+    int epoll_fd           = -1;
+    int nfds               = 0;
+    int accept_errno       = 0;
+    size_t worker_count    = 0;
+    size_t queue_size      = 0;
+    size_t metrics_port    = 0;
+    char* metrics_addr     = NULL;
+    char* db_url           = NULL;
+    long online_cores      = 0;
+    ovsa_worker_t* workers = NULL;
+    char metrics_port_str[MAX_LEN];
+    mbedtls_ssl_config* conf;
+    struct epoll_event event;
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    struct sigaction sa;
+    struct timespec now, stats_due, backoff;
+    sigset_t sigset, oldset;
 
     if (!cert_path || !key_path ||
 #ifdef ENABLE_SGX_GRAMINE
@@ -2943,18 +2949,22 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    ret = pthread_mutex_init(&g_handshake_lock, NULL);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error g_handshake_lock mutex init failed %d\n", ret);
-        return ret;
-    }
-
     ret = pthread_mutex_init(&g_cert_verify_lock, NULL);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error g_cert_verify_lock mutex init failed %d\n", ret);
         return ret;
     }
 
+    online_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online_cores < 1)
+        online_cores = 1;
+    worker_count = ovsa_license_service_get_config_value(
+        WORKER_THREADS_ENV,
+        (online_cores > MAX_WORKER_THREADS) ? MAX_WORKER_THREADS : (size_t)online_cores,
+        MAX_WORKER_THREADS);
+    queue_size = ovsa_license_service_get_config_value(
+        ACCEPT_QUEUE_SIZE_ENV, DEFAULT_ACCEPT_QUEUE_SIZE, MAX_ACCEPT_QUEUE_SIZE);
+
     mbedtls_ctr_drbg_context ctr_drbg;
     mbedtls_entropy_context entropy;
     mbedtls_pk_context srvkey;
@@ -2963,7 +2973,11 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
     mbedtls_net_context listen_fd1;
     mbedtls_net_context* lis_fd;
 
-    mbedtls_ssl_config_init(&g_conf);
+    mbedtls_ssl_config_init(&g_tls_conf);
+    mbedtls_ssl_ticket_init(&g_ticket_ctx);
+#ifdef ENABLE_SGX_GRAMINE
+    mbedtls_ssl_config_init(&g_ratls_conf);
+#endif
     mbedtls_ctr_drbg_init(&ctr_drbg);
     mbedtls_entropy_init(&entropy);
     mbedtls_pk_init(&srvkey);
@@ -2975,9 +2989,25 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
 #endif
     mbedtls_net_init(&listen_fd1);
 
+    ret = ovsa_license_service_accept_queue_init(queue_size);
+    if (ret < OVSA_OK)
+        goto out;
+    /* Attestation tokens are not issued unless a validity is set */
+    ret = ovsa_license_service_attestation_token_init(ovsa_license_service_get_config_value(
+        ATTESTATION_TOKEN_VALIDITY_ENV, 0, MAX_ATTESTATION_TOKEN_VALIDITY));
+    if (ret < OVSA_OK)
+        goto out;
+    /* Leases are not issued unless a validity is set */
+    ret = ovsa_license_service_license_lease_init(
+        cert_path, key_path,
+        ovsa_license_service_get_config_value(LICENSE_LEASE_VALIDITY_ENV, 0,
+                                              MAX_LICENSE_LEASE_VALIDITY));
+    if (ret < OVSA_OK)
+        goto out;
+
     const char pers[] = "ovsa-license-service";
-    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, (const uint8_t*)pers,
-                                sizeof(pers));
+    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, ovsa_license_service_entropy_func, &entropy,
+                                (const uint8_t*)pers, sizeof(pers));
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ctr_drbg_seed with failed code %d\n", ret);
         ret = OVSA_MBEDTLS_CTR_DRBG_SEED_FAILED;
@@ -3014,16 +3044,7 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
         ret = OVSA_MBEDTLS_NET_BIND_FAILED;
         goto out;
     }
-    ret = mbedtls_ssl_config_defaults(&g_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
-                                      MBEDTLS_SSL_PRESET_DEFAULT);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_config_defaults failed with code %d\n", ret);
-        ret = OVSA_MBEDTLS_SSL_CONFIG_DEFAULTS_FAILED;
-        goto out;
-    }
-    mbedtls_ssl_conf_rng(&g_conf, mbedtls_ctr_drbg_random, &ctr_drbg);
     /* mbedtls debug */
-    mbedtls_ssl_conf_dbg(&g_conf, ovsa_license_service_mbedtls_debug_cb, NULL);
     mbedtls_debug_set_threshold(MBEDTLS_DEBUG_LEVEL);
 
     /* Add supported Cipher Suites */
@@ -3037,108 +3058,200 @@ static ovsa_status_t ovsa_license_service_start_server(const char* cert_path, co
     g_curve_list[0] = MBEDTLS_ECP_DP_SECP521R1;
     g_curve_list[1] = MBEDTLS_ECP_DP_NONE;
 
-    mbedtls_ssl_conf_curves(&g_conf, g_curve_list);
-    mbedtls_ssl_conf_ciphersuites(&g_conf, g_cipher_suite);
-
-new_client:
-    OVSA_DBG(DBG_D, "OVSA:Waiting for a remote connection ...");
-    fd_set read_fds;
-    memset(&read_fds, 0, sizeof(read_fds));
-    FD_ZERO(&read_fds); /* initialize the fd set */
+    /* The configurations are not modified once the workers are started, which lets
+     * handshakes on both ports run in parallel */
+    ret = ovsa_license_service_setup_ssl_config(&g_tls_conf, MBEDTLS_SSL_VERIFY_OPTIONAL,
+                                                &ctr_drbg, &srvcert, &srvkey);
+    if (ret < OVSA_OK)
+        goto out;
+    /* Let the periodic license checks of the runtime resume their session with an abbreviated
+     * handshake. Not enabled for RA-TLS, where the client attestation must be verified on
+     * every handshake. */
+    ret = mbedtls_ssl_ticket_setup(&g_ticket_ctx, mbedtls_ctr_drbg_random, &ctr_drbg,
+                                   MBEDTLS_CIPHER_AES_256_GCM, SESSION_TICKET_LIFETIME);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_ticket_setup failed with code %d\n", ret);
+        ret = OVSA_MBEDTLS_SSL_TICKET_SETUP_FAILED;
+        goto out;
+    }
+    mbedtls_ssl_conf_session_tickets_cb(&g_tls_conf, mbedtls_ssl_ticket_write,
+                                        mbedtls_ssl_ticket_parse, &g_ticket_ctx);
 #ifdef ENABLE_SGX_GRAMINE
-    FD_SET(listen_fd.fd, &read_fds);
+    ret = ovsa_license_service_setup_ssl_config(&g_ratls_conf, MBEDTLS_SSL_VERIFY_REQUIRED,
+                                                &ctr_drbg, &srvcert, &srvkey);
+    if (ret < OVSA_OK)
+        goto out;
+    mbedtls_ssl_conf_ca_chain(&g_ratls_conf, &srvcert, NULL);
+    OVSA_DBG(DBG_I, "OVSA:Setting ra_tls_set_measurement_callback\n");
+    ra_tls_set_measurement_callback(m_cb);
+    mbedtls_ssl_conf_verify(&g_ratls_conf, ra_tls_verify_callback, NULL);
 #endif
-    FD_SET(listen_fd1.fd, &read_fds); /* add socket fd */
-    ret = select(listen_fd1.fd + 1, &read_fds, 0 /* &write_fds*/, NULL, NULL);
+
+    /* Nodes of a cluster share one store, so that any of them can serve a license check */
+    db_url = getenv(DB_URL_ENV);
+    if ((db_url != NULL) && (db_url[0] != '\0'))
+        ret = ovsa_db_init_cluster(db_url);
+    else
+        ret = ovsa_db_init(OVSA_DB_PATH);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error select() failed with error code %d \n", ret);
+        OVSA_DBG(DBG_E, "OVSA: Error initializing OVSA DB failed with code %d\n", ret);
+        goto out;
+    }
+
+    /* Only the accepting thread handles the shutdown signals, the threads started below
+     * inherit the blocked mask */
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGINT);
+    sigaddset(&sigset, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+
+    ret = ovsa_db_usage_ledger_start(OVSA_DB_PATH);
+    if (ret < OVSA_OK)
+        goto out;
+
+    /* Register the listening sockets with epoll; they are non-blocking so that all pending
+     * connections can be drained on every wakeup */
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error epoll_create1 failed with error code %d\n", errno);
+        ret = OVSA_EPOLL_FAIL;
         goto out;
-    } else if (ret > OVSA_OK) {
+    }
 #ifdef ENABLE_SGX_GRAMINE
-        if (FD_ISSET(listen_fd.fd, &read_fds)) {
-            lis_fd = &listen_fd;
-        }
+    mbedtls_net_set_nonblock(&listen_fd);
+    memset_s(&event, sizeof(event), 0);
+    event.events   = EPOLLIN;
+    event.data.ptr = &listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd.fd, &event) < 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error epoll_ctl failed with error code %d\n", errno);
+        ret = OVSA_EPOLL_FAIL;
+        goto out;
+    }
 #endif
-        if (FD_ISSET(listen_fd1.fd, &read_fds)) {
-            lis_fd = &listen_fd1;
+    mbedtls_net_set_nonblock(&listen_fd1);
+    memset_s(&event, sizeof(event), 0);
+    event.events   = EPOLLIN;
+    event.data.ptr = &listen_fd1;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd1.fd, &event) < 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error epoll_ctl failed with error code %d\n", errno);
+        ret = OVSA_EPOLL_FAIL;
+        goto out;
+    }
+
+    /* The metrics are not collected unless the listener is enabled */
+    metrics_port = ovsa_license_service_get_config_value(METRICS_PORT_ENV, 0, MAX_METRICS_PORT);
+    if (metrics_port > 0) {
+        metrics_addr = getenv(METRICS_ADDR_ENV);
+        snprintf(metrics_port_str, sizeof(metrics_port_str), "%zu", metrics_port);
+        ret = ovsa_license_service_metrics_start(
+            (metrics_addr != NULL) ? metrics_addr : DEFAULT_METRICS_ADDR, metrics_port_str);
+        if (ret < OVSA_OK)
+            goto out;
+    }
+
+    ret = ovsa_license_service_safe_malloc(worker_count * sizeof(ovsa_worker_t),
+                                           (char**)&workers);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating worker pool failed\n");
+        goto out;
+    }
+    ret = ovsa_license_service_start_workers(workers, worker_count, &entropy, f_cb);
+    if (ret < OVSA_OK)
+        goto out;
+
+    memset_s(&sa, sizeof(sa), 0);
+    sa.sa_handler = ovsa_license_service_shutdown_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+
+    OVSA_DBG(DBG_I, "OVSA:Accept queue size %zu\n", queue_size);
+
+    backoff.tv_sec  = 0;
+    backoff.tv_nsec = ACCEPT_BACKOFF_MS * 1000000L;
+    clock_gettime(CLOCK_MONOTONIC, &stats_due);
+    stats_due.tv_sec += STATS_INTERVAL_MS / 1000;
+    for (;;) {
+        OVSA_DBG(DBG_D, "OVSA:Waiting for a remote connection ...");
+        nfds = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, STATS_INTERVAL_MS);
+        if (nfds < 0) {
+            if (errno == EINTR) {
+                if (!g_shutdown_requested)
+                    continue;
+                OVSA_DBG(DBG_I, "OVSA:Shutting down the license service\n");
+                ret = OVSA_OK;
+                goto out;
+            }
+            OVSA_DBG(DBG_E, "OVSA: Error epoll_wait() failed with error code %d \n", errno);
+            ret = OVSA_EPOLL_FAIL;
+            goto out;
         }
-        ret = mbedtls_net_accept(lis_fd, &client_fd, NULL, 0, NULL);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error mbedtls_net_accept failed returned %d\n\n", ret);
-            mbedtls_net_free(&client_fd);
-            goto new_client;
-        }
-        struct sockaddr_in client;
-        socklen_t clientsz = sizeof(client);
-        getsockname(client_fd.fd, (struct sockaddr*)&client, &clientsz);
-        client_port = ntohs(client.sin_port);
-        OVSA_DBG(DBG_D, "OVSA:Connected to client_port:%u \n", client_port);
+        /* Checked on every wakeup, epoll_wait never times out while clients keep connecting */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((now.tv_sec > stats_due.tv_sec) ||
+            ((now.tv_sec == stats_due.tv_sec) && (now.tv_nsec >= stats_due.tv_nsec))) {
+            ovsa_license_service_report_queue_stats();
+            stats_due = now;
+            stats_due.tv_sec += STATS_INTERVAL_MS / 1000;
+        }
+        for (index = 0; index < nfds; index++) {
+            lis_fd = (mbedtls_net_context*)events[index].data.ptr;
+            for (;;) {
+                ret = mbedtls_net_accept(lis_fd, &client_fd, NULL, 0, NULL);
+                if (ret == MBEDTLS_ERR_SSL_WANT_READ)
+                    break;
+                if (ret < OVSA_OK) {
+                    accept_errno = errno;
+                    OVSA_DBG(DBG_E, "OVSA: Error mbedtls_net_accept failed returned %d\n\n",
+                             ret);
+                    mbedtls_net_free(&client_fd);
+                    /* The pending connection keeps the listener readable until descriptors
+                     * are closed, back off instead of spinning on epoll_wait */
+                    if ((accept_errno == EMFILE) || (accept_errno == ENFILE) ||
+                        (accept_errno == ENOBUFS) || (accept_errno == ENOMEM))
+                        nanosleep(&backoff, NULL);
+                    break;
+                }
+                /* Clients are served with blocking I/O on the worker threads */
+                mbedtls_net_set_block(&client_fd);
+                struct sockaddr_in client;
+                socklen_t clientsz = sizeof(client);
+                getsockname(client_fd.fd, (struct sockaddr*)&client, &clientsz);
+                client_port = ntohs(client.sin_port);
+                OVSA_DBG(DBG_D, "OVSA:Connected to client_port:%u \n", client_port);
+                conf = &g_tls_conf;
 #ifdef ENABLE_SGX_GRAMINE
-        if (client_port == atoi(g_ratls_port)) {
-            mbedtls_ssl_conf_authmode(&g_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
-            mbedtls_ssl_conf_ca_chain(&g_conf, &srvcert, NULL);
-            OVSA_DBG(DBG_I, "OVSA:Setting ra_tls_set_measurement_callback\n");
-            ra_tls_set_measurement_callback(m_cb);
-            mbedtls_ssl_conf_verify(&g_conf, ra_tls_verify_callback, NULL);
-        }
+                if (client_port == atoi(g_ratls_port))
+                    conf = &g_ratls_conf;
 #endif
-        if (client_port == atoi(g_tls_port))
-            mbedtls_ssl_conf_authmode(&g_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
 
-        ret = mbedtls_ssl_conf_own_cert(&g_conf, &srvcert, &srvkey);
-        if (ret < OVSA_OK) {
-            ret = OVSA_MBEDTLS_SSL_CONFIG_OWN_CERT;
-            OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_conf_own_cert failed with error code %d\n",
-                     ret);
-            goto out;
-        }
-        OVSA_DBG(DBG_I, "OVSA:Client connection sucessfull\n");
-        struct ovsa_thread_info* ti = calloc(1, sizeof(*ti));
-        if (!ti) {
-            mbedtls_net_free(&client_fd);
-            goto new_client;
-        }
-        /* client_fd is reused for multiple threads, so pass ownership of its copy to
-         * new thread */
-        memcpy_s(&ti->client_fd, sizeof(ti->client_fd), &client_fd, sizeof(client_fd));
-        ti->conf        = &g_conf;
-        ti->f_cb        = f_cb;
-        ti->client_port = client_port;
-
-        pthread_attr_t tattr;
-        ret = pthread_attr_init(&tattr);
-        if (ret < OVSA_OK) {
-            ovsa_license_service_safe_free((char**)&ti);
-            mbedtls_net_free(&client_fd);
-            goto new_client;
-        }
-        ret = pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
-        if (ret < OVSA_OK) {
-            ovsa_license_service_safe_free((char**)&ti);
-            pthread_attr_destroy(&tattr);
-            mbedtls_net_free(&client_fd);
-            goto new_client;
-        }
-        pthread_t tid;
-        ret = pthread_create(&tid, &tattr, ovsa_license_service_client_connection, ti);
-        if (ret < OVSA_OK) {
-            ovsa_license_service_safe_free((char**)&ti);
-            mbedtls_net_free(&client_fd);
+                /* client_fd is reused for every accept, so pass ownership of its copy to
+                 * the worker pool */
+                ret = ovsa_license_service_accept_queue_push(&client_fd, conf, client_port);
+                if (ret < OVSA_OK) {
+                    mbedtls_net_free(&client_fd);
+                    continue;
+                }
+                OVSA_DBG(DBG_I, "OVSA:Client connection sucessfull\n");
+                mbedtls_net_init(&client_fd);
+            }
         }
-        pthread_attr_destroy(&tattr);
-    }
-    goto new_client;
-
-    ret = pthread_mutex_destroy(&g_handshake_lock);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error mutex destroy failed %d\n", ret);
-    }
-    ret = pthread_mutex_destroy(&g_cert_verify_lock);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error g_cert_verify_lock mutex destroy failed %d\n", ret);
     }
 
 out:
+    if (workers != NULL) {
+        ovsa_license_service_stop_workers(workers, worker_count);
+        ovsa_license_service_safe_free((char**)&workers);
+    }
+    ovsa_license_service_metrics_stop();
+    ovsa_db_usage_ledger_stop();
+    ovsa_license_service_tcb_cache_free();
+    ovsa_license_service_attestation_token_deinit();
+    ovsa_license_service_license_lease_deinit();
+    ovsa_license_service_accept_queue_deinit();
+    if (epoll_fd >= 0)
+        close(epoll_fd);
     mbedtls_x509_crt_free(&srvcert);
     mbedtls_pk_free(&srvkey);
 #ifdef ENABLE_SGX_GRAMINE
@@ -3146,10 +3259,18 @@ out:
 #endif
     mbedtls_net_free(&listen_fd1);
     mbedtls_net_free(&client_fd);
-    mbedtls_ssl_config_free(&g_conf);
+    mbedtls_ssl_config_free(&g_tls_conf);
+    mbedtls_ssl_ticket_free(&g_ticket_ctx);
+#ifdef ENABLE_SGX_GRAMINE
+    mbedtls_ssl_config_free(&g_ratls_conf);
+#endif
     mbedtls_ctr_drbg_free(&ctr_drbg);
     mbedtls_entropy_free(&entropy);
 
+    if (pthread_mutex_destroy(&g_cert_verify_lock) != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error g_cert_verify_lock mutex destroy failed\n");
+    }
+
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -3158,11 +3279,10 @@ int main(int argc, char** argv) {
     ovsa_status_t ret = OVSA_OK;
     void* ssl_session = NULL;
 
-    ret = pthread_mutex_init(&g_measurement_lock, NULL);
-    if (ret < OVSA_OK)
-        return ret;
-
-    OVSA_DBG(DBG_I, "OVSA:Starting the Ovsa license service");
+    /* Not fatal, the records are written by the logging threads then */
+    if (ovsa_license_service_log_start() < OVSA_OK)
+        OVSA_DBG(DBG_E, "OVSA: Error starting the log writer failed\n");
+    OVSA_DBG(DBG_I, "OVSA:Starting the Ovsa license service\n");
 
     strcpy_s(g_ratls_port, sizeof(g_ratls_port), DEFAULT_RATLS_PORT);
     strcpy_s(g_tls_port, sizeof(g_tls_port), DEFAULT_TLS_PORT);
@@ -3180,12 +3300,7 @@ int main(int argc, char** argv) {
                                             ovsa_license_service_client_license_service_callback);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_start_server() returned %d\n", ret);
-        return ret;
-    }
-
-    ret = pthread_mutex_destroy(&g_measurement_lock);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error mutex destroy failed %d\n", ret);
     }
+    ovsa_license_service_log_stop();
     return ret;
 }
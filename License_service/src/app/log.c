@@ -0,0 +1,302 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "safe_str_lib.h"
+/* log.h to be included at end due to dependencies */
+#include "log.h"
+
+/* Worker threads plus the acceptor, the usage ledger flush and the metrics threads */
+#define MAX_LOG_THREADS       (MAX_WORKER_THREADS + 8)
+/* Power of two, so that the ring offsets wrap with a mask */
+#define LOG_RING_SIZE         (64 * 1024)
+#define LOG_MAX_RECORD        8192
+#define LOG_DRAIN_INTERVAL_MS 10
+#define LOG_TRUNCATED         "...\n"
+
+/*
+ * Log records of one thread, written by the thread and drained by the log writer, which needs
+ * no lock. A record that does not fit in the free space of the ring is dropped and counted, so
+ * that a slow terminal or disk never stalls the license checks.
+ */
+typedef struct ovsa_log_ring {
+    char buf[LOG_RING_SIZE];
+    /* Written by the owning thread */
+    size_t head;
+    uint64_t dropped;
+    /* Written by the log writer */
+    size_t tail;
+    uint64_t reported;
+} ovsa_log_ring_t;
+
+typedef struct ovsa_log_context {
+    ovsa_log_ring_t* ring;
+    bool no_ring;
+    pid_t thread_id;
+    uint64_t connection_id;
+    char license_guid[GUID_SIZE + 1];
+    char record[LOG_MAX_RECORD];
+} ovsa_log_context_t;
+
+int g_ovsa_log_level = DBG_LEVEL;
+
+static ovsa_log_ring_t* g_log_rings[MAX_LOG_THREADS];
+static uint32_t g_log_ring_count;
+static __thread ovsa_log_context_t g_thread_log;
+static uint64_t g_log_connection_id;
+
+static bool g_log_started;
+static bool g_log_stop;
+static pthread_t g_log_tid;
+
+static const char* ovsa_license_service_log_level_name(int level) {
+    if (level & DBG_E)
+        return "error";
+    if (level & DBG_I)
+        return "info";
+    return "debug";
+}
+
+static ovsa_log_ring_t* ovsa_license_service_log_get_ring(ovsa_log_context_t* log) {
+    ovsa_log_ring_t* ring = NULL;
+    uint32_t slot         = 0;
+
+    if ((log->ring != NULL) || log->no_ring)
+        return log->ring;
+
+    ring = (ovsa_log_ring_t*)calloc(1, sizeof(ovsa_log_ring_t));
+    if (ring != NULL) {
+        slot = __atomic_fetch_add(&g_log_ring_count, 1, __ATOMIC_RELAXED);
+        if (slot < MAX_LOG_THREADS) {
+            __atomic_store_n(&g_log_rings[slot], ring, __ATOMIC_RELEASE);
+            log->ring = ring;
+            return ring;
+        }
+        free(ring);
+    }
+    /* Written by the thread itself from then on */
+    log->no_ring = true;
+    return NULL;
+}
+
+static void ovsa_license_service_log_push(ovsa_log_ring_t* ring, const char* record, size_t len) {
+    size_t head   = ring->head;
+    size_t tail   = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t offset = head & (LOG_RING_SIZE - 1);
+    size_t first  = 0;
+
+    if (len > LOG_RING_SIZE - (head - tail)) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    first = (len < LOG_RING_SIZE - offset) ? len : LOG_RING_SIZE - offset;
+    memcpy_s(ring->buf + offset, LOG_RING_SIZE - offset, record, first);
+    if (first < len)
+        memcpy_s(ring->buf, LOG_RING_SIZE, record + first, len - first);
+    __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+}
+
+void ovsa_license_service_log(int level, const char* format, ...) {
+    ovsa_log_context_t* log = &g_thread_log;
+    ovsa_log_ring_t* ring   = NULL;
+    size_t size             = sizeof(log->record);
+    size_t len              = 0;
+    struct timespec now;
+    struct tm tm;
+    va_list args;
+    int ret = 0;
+
+    if (log->thread_id == 0)
+        log->thread_id = (pid_t)syscall(SYS_gettid);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    gmtime_r(&now.tv_sec, &tm);
+    len = strftime(log->record, size, "%Y-%m-%dT%H:%M:%S", &tm);
+    ret = snprintf(log->record + len, size - len, ".%06ldZ level=%s thread=%d ",
+                   now.tv_nsec / 1000, ovsa_license_service_log_level_name(level),
+                   (int)log->thread_id);
+    len += ret;
+    if (log->connection_id != 0) {
+        ret = snprintf(log->record + len, size - len, "conn=%lu ", log->connection_id);
+        len += ret;
+    }
+    if (log->license_guid[0] != '\0') {
+        ret = snprintf(log->record + len, size - len, "license=%s ", log->license_guid);
+        len += ret;
+    }
+
+    va_start(args, format);
+    ret = vsnprintf(log->record + len, size - len, format, args);
+    va_end(args);
+    if (ret < 0)
+        return;
+    if ((size_t)ret >= size - len) {
+        len = size - 1;
+        memcpy_s(log->record + len - strlen(LOG_TRUNCATED), strlen(LOG_TRUNCATED),
+                 LOG_TRUNCATED, strlen(LOG_TRUNCATED));
+    } else {
+        len += ret;
+    }
+    /* One record per line, messages continued by the next record are ended here */
+    if (log->record[len - 1] != '\n') {
+        if (len == size - 1)
+            len--;
+        log->record[len++] = '\n';
+    }
+
+    if (__atomic_load_n(&g_log_started, __ATOMIC_RELAXED))
+        ring = ovsa_license_service_log_get_ring(log);
+    if (ring != NULL)
+        ovsa_license_service_log_push(ring, log->record, len);
+    else
+        fwrite(log->record, 1, len, stdout);
+}
+
+/* Writes the records of the ring, returns the number of bytes written */
+static size_t ovsa_license_service_log_drain(ovsa_log_ring_t* ring) {
+    size_t tail      = ring->tail;
+    size_t head      = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t offset    = tail & (LOG_RING_SIZE - 1);
+    size_t len       = head - tail;
+    size_t first     = 0;
+    uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+
+    if (len > 0) {
+        first = (len < LOG_RING_SIZE - offset) ? len : LOG_RING_SIZE - offset;
+        fwrite(ring->buf + offset, 1, first, stdout);
+        if (first < len)
+            fwrite(ring->buf, 1, len - first, stdout);
+        __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+    }
+    if (dropped != ring->reported) {
+        fprintf(stdout,
+                "level=error OVSA: Error %lu log records dropped, the log writer is behind\n",
+                dropped - ring->reported);
+        ring->reported = dropped;
+    }
+    return len;
+}
+
+static void* ovsa_license_service_log_writer(void* data) {
+    ovsa_log_ring_t* ring = NULL;
+    struct timespec interval;
+    uint32_t count = 0;
+    uint32_t index = 0;
+    size_t written = 0;
+    bool stop      = false;
+
+    interval.tv_sec  = 0;
+    interval.tv_nsec = LOG_DRAIN_INTERVAL_MS * 1000000L;
+    for (;;) {
+        /* The records pushed before the stop request are all written */
+        stop    = __atomic_load_n(&g_log_stop, __ATOMIC_ACQUIRE);
+        written = 0;
+        count   = __atomic_load_n(&g_log_ring_count, __ATOMIC_RELAXED);
+        if (count > MAX_LOG_THREADS)
+            count = MAX_LOG_THREADS;
+        for (index = 0; index < count; index++) {
+            ring = __atomic_load_n(&g_log_rings[index], __ATOMIC_ACQUIRE);
+            if (ring != NULL)
+                written += ovsa_license_service_log_drain(ring);
+        }
+        if (written > 0)
+            fflush(stdout);
+        if (stop)
+            break;
+        if (written == 0)
+            nanosleep(&interval, NULL);
+    }
+    return NULL;
+}
+
+ovsa_status_t ovsa_license_service_log_start(void) {
+    ovsa_status_t ret = OVSA_OK;
+    char* env_value   = NULL;
+
+    env_value = getenv(LOG_LEVEL_ENV);
+    if (env_value != NULL) {
+        if (strcmp(env_value, "error") == 0) {
+            g_ovsa_log_level = DBG_E;
+        } else if (strcmp(env_value, "info") == 0) {
+            g_ovsa_log_level = DBG_E | DBG_I;
+        } else if (strcmp(env_value, "debug") == 0) {
+            g_ovsa_log_level = DBG_E | DBG_I | DBG_D;
+        } else {
+            OVSA_DBG(DBG_I,
+                     "OVSA:WARNING: %s='%s' is not valid [valid values=error,info,debug]\n",
+                     LOG_LEVEL_ENV, env_value);
+        }
+        if ((g_ovsa_log_level & ~DBG_LEVEL) != 0)
+            OVSA_DBG(DBG_I, "OVSA:WARNING: %s='%s' exceeds the log level of the build\n",
+                     LOG_LEVEL_ENV, env_value);
+    }
+
+    g_log_stop = false;
+    ret        = pthread_create(&g_log_tid, NULL, ovsa_license_service_log_writer, NULL);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error pthread_create failed with error code %d\n", ret);
+        return OVSA_THREAD_CREATE_FAIL;
+    }
+    __atomic_store_n(&g_log_started, true, __ATOMIC_RELEASE);
+    return OVSA_OK;
+}
+
+void ovsa_license_service_log_stop(void) {
+    uint32_t index = 0;
+
+    if (!g_log_started)
+        return;
+
+    __atomic_store_n(&g_log_started, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&g_log_stop, true, __ATOMIC_RELEASE);
+    pthread_join(g_log_tid, NULL);
+    for (index = 0; index < MAX_LOG_THREADS; index++) {
+        free(g_log_rings[index]);
+        g_log_rings[index] = NULL;
+    }
+    g_log_ring_count  = 0;
+    g_thread_log.ring = NULL;
+    fflush(stdout);
+}
+
+void ovsa_license_service_log_begin_connection(void) {
+    g_thread_log.connection_id   = __atomic_add_fetch(&g_log_connection_id, 1, __ATOMIC_RELAXED);
+    g_thread_log.license_guid[0] = '\0';
+}
+
+void ovsa_license_service_log_set_license(const char* license_guid) {
+    if (license_guid == NULL) {
+        g_thread_log.license_guid[0] = '\0';
+        return;
+    }
+    strcpy_s(g_thread_log.license_guid, sizeof(g_thread_log.license_guid), license_guid);
+}
+
+void ovsa_license_service_log_end_connection(void) {
+    g_thread_log.connection_id   = 0;
+    g_thread_log.license_guid[0] = '\0';
+}
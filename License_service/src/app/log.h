@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __OVSA_LOG_H_
+#define __OVSA_LOG_H_
+
+#include "license_service.h"
+
+/* API's */
+/*!
+ * \brief ovsa_license_service_log_start sets the log level from LOG_LEVEL_ENV and starts
+ * the thread writing the log records. Until then records are written by the calling thread
+ *
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_log_start(void);
+
+/*!
+ * \brief ovsa_license_service_log_stop writes the pending log records and stops the log
+ * writer, records are written by the calling thread from then on. To be called once the
+ * other threads are stopped
+ *
+ * \return void
+ */
+
+void ovsa_license_service_log_stop(void);
+
+/*!
+ * \brief ovsa_license_service_log_begin_connection tags the log records of the calling
+ * thread with a new connection ID
+ *
+ * \return void
+ */
+
+void ovsa_license_service_log_begin_connection(void);
+
+/*!
+ * \brief ovsa_license_service_log_set_license tags the log records of the calling thread
+ * with the license being checked
+ *
+ * \param [in]  license_guid GUID of the customer license
+ * \return void
+ */
+
+void ovsa_license_service_log_set_license(const char* license_guid);
+
+/*!
+ * \brief ovsa_license_service_log_end_connection clears the connection ID and license of
+ * the log records of the calling thread
+ *
+ * \return void
+ */
+
+void ovsa_license_service_log_end_connection(void);
+
+#endif
@@ -0,0 +1,465 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+/* metrics.h to be included at end due to dependencies */
+#include "metrics.h"
+
+/* Worker threads plus the acceptor, the usage ledger flush and the metrics threads */
+#define MAX_METRICS_THREADS  (MAX_WORKER_THREADS + 8)
+#define METRICS_POLL_MS      1000
+#define METRICS_READ_TIMEOUT 1000
+#define METRICS_REQUEST_SIZE 1024
+#define METRICS_BODY_SIZE    (64 * 1024)
+#define METRICS_HEADER_SIZE  256
+
+/* Upper bounds of the histogram buckets in microseconds, followed by +Inf */
+static const uint64_t g_metrics_bucket_us[] = {
+    100,   250,    500,    1000,   2500,    5000,    10000,   25000,
+    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+#define METRICS_BUCKETS (sizeof(g_metrics_bucket_us) / sizeof(g_metrics_bucket_us[0]))
+
+/* Responses of the license check, failures past the "FAIL: " prefix are exported as reasons */
+static const char* g_metrics_results[] = {
+    "PASS",
+    "UPDATE",
+    "FAIL: License TimeLimit Exceeded",
+    "FAIL: License UsageLimit Exceeded",
+    "FAIL: Error in License check",
+    "FAIL: Error read payload from client failed",
+    "FAIL: Error get command type from client failed",
+    "FAIL: get command type from client failed",
+    "FAIL: Error received Invalid command from client",
+    "FAIL: Error in Sending EK_AK_bind_info",
+    "FAIL: Error in Validate EK_AK_bind_info",
+    "FAIL: Error in Sending SW quote",
+    "FAIL: Error in Sending Signed Nonce",
+    "FAIL: Error in secret Validation Invalid runtime",
+    "FAIL: Error in SW quote extraction",
+    "FAIL: Error in HW quote extraction",
+    "FAIL: Error in reading customer license",
+    "FAIL: Error in reading customer license batch",
+    "FAIL: Error in validate customer license",
+    "FAIL: Error in validate platform certificate",
+    "FAIL: Error in TCB Validation Invalid runtime",
+    "FAIL: Error in TCB Validation with customer license. Invalid runtime",
+    "FAIL: Error in Quote Validation Invalid runtime",
+    "FAIL: Error in Retrieving customer certificate",
+    "FAIL: Error in Nonce Verification"};
+#define METRICS_RESULT_PASS   0
+#define METRICS_RESULT_UPDATE 1
+#define METRICS_RESULT_FAIL   2
+/* Any other response, including none when the connection failed before it was set */
+#define METRICS_RESULT_OTHER (sizeof(g_metrics_results) / sizeof(g_metrics_results[0]))
+#define METRICS_RESULTS      (METRICS_RESULT_OTHER + 1)
+
+static const struct {
+    const char* name;
+    const char* label;
+    const char* help;
+} g_metrics_hists[OVSA_METRICS_HIST_MAX] = {
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"handshake\"",
+     "Duration of the stages of the license check"},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"ek_ak_bind\"", NULL},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"pcr_validate\"", NULL},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"quote_verify\"", NULL},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"db_lookup\"", NULL},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"nonce_verify\"", NULL},
+    {"ovsa_license_service_stage_duration_seconds", "stage=\"license_check\"", NULL},
+    {"ovsa_license_service_db_duration_seconds", "op=\"query\"",
+     "Duration of the database operations"},
+    {"ovsa_license_service_db_duration_seconds", "op=\"usage_flush\"", NULL}};
+
+/*
+ * Metrics of one thread. Only the owning thread writes them, which needs no atomic
+ * read-modify-write, and the blocks are only summed up when the metrics are scraped.
+ */
+typedef struct ovsa_metrics_thread {
+    uint64_t counters[OVSA_METRICS_COUNTER_MAX];
+    uint64_t results[METRICS_RESULTS];
+    uint64_t buckets[OVSA_METRICS_HIST_MAX][METRICS_BUCKETS + 1];
+    uint64_t sum_us[OVSA_METRICS_HIST_MAX];
+} __attribute__((aligned(64))) ovsa_metrics_thread_t;
+
+typedef struct ovsa_metrics_buf {
+    char* buf;
+    size_t size;
+    size_t len;
+    bool truncated;
+} ovsa_metrics_buf_t;
+
+static ovsa_metrics_thread_t g_metrics_threads[MAX_METRICS_THREADS];
+static uint32_t g_metrics_thread_count;
+/* Shared by the threads started once all blocks are taken, updated atomically */
+static ovsa_metrics_thread_t g_metrics_shared;
+static __thread ovsa_metrics_thread_t* g_thread_metrics;
+
+static bool g_metrics_enabled;
+static volatile bool g_metrics_stop;
+static pthread_t g_metrics_tid;
+static mbedtls_net_context g_metrics_listen_fd;
+
+static ovsa_metrics_thread_t* ovsa_license_service_metrics_get_thread(void) {
+    uint32_t slot = 0;
+
+    if (g_thread_metrics == NULL) {
+        slot             = __atomic_fetch_add(&g_metrics_thread_count, 1, __ATOMIC_RELAXED);
+        g_thread_metrics = (slot < MAX_METRICS_THREADS) ? &g_metrics_threads[slot]
+                                                        : &g_metrics_shared;
+    }
+    return g_thread_metrics;
+}
+
+static void ovsa_license_service_metrics_add(ovsa_metrics_thread_t* metrics, uint64_t* value,
+                                             uint64_t inc) {
+    if (metrics == &g_metrics_shared)
+        __atomic_fetch_add(value, inc, __ATOMIC_RELAXED);
+    else
+        __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + inc,
+                         __ATOMIC_RELAXED);
+}
+
+void ovsa_license_service_metrics_stage_start(struct timespec* stage_start) {
+    if (g_metrics_enabled)
+        clock_gettime(CLOCK_MONOTONIC, stage_start);
+}
+
+void ovsa_license_service_metrics_stage_done(ovsa_metrics_hist_t hist,
+                                             struct timespec* stage_start) {
+    ovsa_metrics_thread_t* metrics = NULL;
+    struct timespec now;
+    uint64_t elapsed_us = 0;
+    size_t bucket       = 0;
+
+    if (!g_metrics_enabled || (hist >= OVSA_METRICS_HIST_MAX))
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed_us = (uint64_t)(now.tv_sec - stage_start->tv_sec) * 1000000 +
+                 (now.tv_nsec - stage_start->tv_nsec) / 1000;
+    *stage_start = now;
+
+    while ((bucket < METRICS_BUCKETS) && (elapsed_us > g_metrics_bucket_us[bucket]))
+        bucket++;
+    metrics = ovsa_license_service_metrics_get_thread();
+    ovsa_license_service_metrics_add(metrics, &metrics->buckets[hist][bucket], 1);
+    ovsa_license_service_metrics_add(metrics, &metrics->sum_us[hist], elapsed_us);
+}
+
+void ovsa_license_service_metrics_count(ovsa_metrics_counter_t counter) {
+    ovsa_metrics_thread_t* metrics = NULL;
+
+    if (!g_metrics_enabled || (counter >= OVSA_METRICS_COUNTER_MAX))
+        return;
+
+    metrics = ovsa_license_service_metrics_get_thread();
+    ovsa_license_service_metrics_add(metrics, &metrics->counters[counter], 1);
+}
+
+void ovsa_license_service_metrics_license_check_result(const char* response) {
+    ovsa_metrics_thread_t* metrics = NULL;
+    size_t result                  = 0;
+
+    if (!g_metrics_enabled)
+        return;
+
+    for (result = 0; result < METRICS_RESULT_OTHER; result++) {
+        if ((response != NULL) &&
+            (strncmp(response, g_metrics_results[result], MAX_NAME_SIZE) == 0))
+            break;
+    }
+    metrics = ovsa_license_service_metrics_get_thread();
+    ovsa_license_service_metrics_add(metrics, &metrics->results[result], 1);
+}
+
+static void ovsa_license_service_metrics_sum(ovsa_metrics_thread_t* total) {
+    ovsa_metrics_thread_t* metrics = NULL;
+    uint64_t* in                   = NULL;
+    uint64_t* out                  = (uint64_t*)total;
+    size_t count                   = 0;
+    size_t index                   = 0;
+    size_t value                   = 0;
+
+    memset_s(total, sizeof(ovsa_metrics_thread_t), 0);
+    count = __atomic_load_n(&g_metrics_thread_count, __ATOMIC_RELAXED);
+    if (count > MAX_METRICS_THREADS)
+        count = MAX_METRICS_THREADS;
+    for (index = 0; index <= count; index++) {
+        metrics = (index < count) ? &g_metrics_threads[index] : &g_metrics_shared;
+        in      = (uint64_t*)metrics;
+        for (value = 0; value < sizeof(ovsa_metrics_thread_t) / sizeof(uint64_t); value++)
+            out[value] += __atomic_load_n(&in[value], __ATOMIC_RELAXED);
+    }
+}
+
+static void ovsa_license_service_metrics_printf(ovsa_metrics_buf_t* out, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void ovsa_license_service_metrics_printf(ovsa_metrics_buf_t* out, const char* format,
+                                                ...) {
+    va_list args;
+    int len = 0;
+
+    if (out->truncated)
+        return;
+    va_start(args, format);
+    len = vsnprintf(out->buf + out->len, out->size - out->len, format, args);
+    va_end(args);
+    if ((len < 0) || ((size_t)len >= out->size - out->len)) {
+        out->truncated = true;
+        return;
+    }
+    out->len += len;
+}
+
+/* Formats the metrics in the Prometheus text exposition format */
+static void ovsa_license_service_metrics_format(ovsa_metrics_buf_t* out) {
+    ovsa_metrics_thread_t total;
+    uint64_t count  = 0;
+    uint64_t failed = 0;
+    uint64_t active = 0;
+    size_t hist     = 0;
+    size_t bucket   = 0;
+    size_t result   = 0;
+
+    ovsa_license_service_metrics_sum(&total);
+    /* A connection closed while the blocks are summed up can be counted as closed only */
+    if (total.counters[OVSA_METRICS_CONNECTIONS] > total.counters[OVSA_METRICS_CONNECTIONS_CLOSED])
+        active = total.counters[OVSA_METRICS_CONNECTIONS] -
+                 total.counters[OVSA_METRICS_CONNECTIONS_CLOSED];
+
+    ovsa_license_service_metrics_printf(
+        out,
+        "# HELP ovsa_license_service_connections_active Client connections being served\n"
+        "# TYPE ovsa_license_service_connections_active gauge\n"
+        "ovsa_license_service_connections_active %lu\n"
+        "# HELP ovsa_license_service_connections_total Client connections served\n"
+        "# TYPE ovsa_license_service_connections_total counter\n"
+        "ovsa_license_service_connections_total %lu\n"
+        "# HELP ovsa_license_service_connections_rejected_total Client connections refused "
+        "with a full accept queue\n"
+        "# TYPE ovsa_license_service_connections_rejected_total counter\n"
+        "ovsa_license_service_connections_rejected_total %lu\n"
+        "# HELP ovsa_license_service_handshake_failures_total Failed TLS handshakes\n"
+        "# TYPE ovsa_license_service_handshake_failures_total counter\n"
+        "ovsa_license_service_handshake_failures_total %lu\n",
+        active, total.counters[OVSA_METRICS_CONNECTIONS],
+        total.counters[OVSA_METRICS_CONNECTIONS_REJECTED],
+        total.counters[OVSA_METRICS_HANDSHAKE_FAILURES]);
+
+    for (result = METRICS_RESULT_FAIL; result < METRICS_RESULTS; result++)
+        failed += total.results[result];
+    ovsa_license_service_metrics_printf(
+        out,
+        "# HELP ovsa_license_service_license_checks_total License check responses\n"
+        "# TYPE ovsa_license_service_license_checks_total counter\n"
+        "ovsa_license_service_license_checks_total{result=\"pass\"} %lu\n"
+        "ovsa_license_service_license_checks_total{result=\"update\"} %lu\n"
+        "ovsa_license_service_license_checks_total{result=\"fail\"} %lu\n"
+        "# HELP ovsa_license_service_license_check_failures_total Failed license checks by "
+        "reason\n"
+        "# TYPE ovsa_license_service_license_check_failures_total counter\n",
+        total.results[METRICS_RESULT_PASS], total.results[METRICS_RESULT_UPDATE], failed);
+    for (result = METRICS_RESULT_FAIL; result < METRICS_RESULTS; result++) {
+        ovsa_license_service_metrics_printf(
+            out, "ovsa_license_service_license_check_failures_total{reason=\"%s\"} %lu\n",
+            (result < METRICS_RESULT_OTHER) ? g_metrics_results[result] + strlen("FAIL: ")
+                                            : "other",
+            total.results[result]);
+    }
+
+    for (hist = 0; hist < OVSA_METRICS_HIST_MAX; hist++) {
+        if (g_metrics_hists[hist].help != NULL) {
+            ovsa_license_service_metrics_printf(out, "# HELP %s %s\n# TYPE %s histogram\n",
+                                                g_metrics_hists[hist].name,
+                                                g_metrics_hists[hist].help,
+                                                g_metrics_hists[hist].name);
+        }
+        count = 0;
+        for (bucket = 0; bucket <= METRICS_BUCKETS; bucket++) {
+            count += total.buckets[hist][bucket];
+            if (bucket < METRICS_BUCKETS) {
+                ovsa_license_service_metrics_printf(
+                    out, "%s_bucket{%s,le=\"%g\"} %lu\n", g_metrics_hists[hist].name,
+                    g_metrics_hists[hist].label, g_metrics_bucket_us[bucket] / 1e6, count);
+            } else {
+                ovsa_license_service_metrics_printf(out, "%s_bucket{%s,le=\"+Inf\"} %lu\n",
+                                                    g_metrics_hists[hist].name,
+                                                    g_metrics_hists[hist].label, count);
+            }
+        }
+        ovsa_license_service_metrics_printf(
+            out, "%s_sum{%s} %.6f\n%s_count{%s} %lu\n", g_metrics_hists[hist].name,
+            g_metrics_hists[hist].label, total.sum_us[hist] / 1e6, g_metrics_hists[hist].name,
+            g_metrics_hists[hist].label, count);
+    }
+}
+
+static ovsa_status_t ovsa_license_service_metrics_send(mbedtls_net_context* client_fd,
+                                                       const char* buf, size_t len) {
+    int ret = 0;
+
+    while (len > 0) {
+        ret = mbedtls_net_send(client_fd, (const unsigned char*)buf, len);
+        if (ret <= 0)
+            return OVSA_FAIL;
+        buf += ret;
+        len -= ret;
+    }
+    return OVSA_OK;
+}
+
+/* Answers one HTTP request, anything but GET /metrics is answered with 404 */
+static void ovsa_license_service_metrics_serve(mbedtls_net_context* client_fd,
+                                               ovsa_metrics_buf_t* body) {
+    char request[METRICS_REQUEST_SIZE];
+    char header[METRICS_HEADER_SIZE];
+    const char* status = "404 Not Found";
+    size_t len         = 0;
+    int ret            = 0;
+
+    memset_s(request, sizeof(request), 0);
+    /* The request line and headers are read so that the client does not get a reset */
+    while ((len < sizeof(request) - 1) && (strstr(request, "\r\n\r\n") == NULL)) {
+        ret = mbedtls_net_recv_timeout(client_fd, (unsigned char*)request + len,
+                                       sizeof(request) - 1 - len, METRICS_READ_TIMEOUT);
+        if (ret <= 0)
+            return;
+        len += ret;
+    }
+    body->len       = 0;
+    body->truncated = false;
+    if ((strncmp(request, "GET /metrics", strlen("GET /metrics")) == 0) &&
+        ((request[strlen("GET /metrics")] == ' ') || (request[strlen("GET /metrics")] == '?'))) {
+        ovsa_license_service_metrics_format(body);
+        status = "200 OK";
+        if (body->truncated) {
+            OVSA_DBG(DBG_E, "OVSA: Error metrics exceed %zu bytes\n", body->size);
+            body->len = 0;
+            status    = "500 Internal Server Error";
+        }
+    }
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+             "%zu\r\nConnection: close\r\n\r\n",
+             status, body->len);
+    if (ovsa_license_service_metrics_send(client_fd, header, strlen(header)) == OVSA_OK)
+        ovsa_license_service_metrics_send(client_fd, body->buf, body->len);
+}
+
+static void* ovsa_license_service_metrics_thread(void* data) {
+    ovsa_metrics_buf_t* body = (ovsa_metrics_buf_t*)data;
+    mbedtls_net_context client_fd;
+    int ret = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    mbedtls_net_init(&client_fd);
+    while (!g_metrics_stop) {
+        ret = mbedtls_net_poll(&g_metrics_listen_fd, MBEDTLS_NET_POLL_READ, METRICS_POLL_MS);
+        if (ret < 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error metrics listener poll failed with code %d\n", ret);
+            break;
+        }
+        if (ret == 0)
+            continue;
+        ret = mbedtls_net_accept(&g_metrics_listen_fd, &client_fd, NULL, 0, NULL);
+        if (ret < 0)
+            continue;
+        mbedtls_net_set_block(&client_fd);
+        ovsa_license_service_metrics_serve(&client_fd, body);
+        mbedtls_net_free(&client_fd);
+    }
+
+    ovsa_license_service_safe_free(&body->buf);
+    ovsa_license_service_safe_free((char**)&body);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return NULL;
+}
+
+ovsa_status_t ovsa_license_service_metrics_start(const char* bind_addr, const char* port) {
+    ovsa_status_t ret        = OVSA_OK;
+    ovsa_metrics_buf_t* body = NULL;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    mbedtls_net_init(&g_metrics_listen_fd);
+    ret = ovsa_license_service_safe_malloc(sizeof(ovsa_metrics_buf_t), (char**)&body);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating metrics buffer failed\n");
+        goto out;
+    }
+    ret = ovsa_license_service_safe_malloc(METRICS_BODY_SIZE, &body->buf);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating metrics buffer failed\n");
+        goto out;
+    }
+    body->size = METRICS_BODY_SIZE;
+
+    ret = mbedtls_net_bind(&g_metrics_listen_fd, bind_addr, port, MBEDTLS_NET_PROTO_TCP);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error mbedtls_net_bind of metrics on %s:%s failed with code %d\n",
+                 bind_addr, port, ret);
+        ret = OVSA_MBEDTLS_NET_BIND_FAILED;
+        goto out;
+    }
+    /* A connection that is gone by the time it is accepted must not block the listener */
+    mbedtls_net_set_nonblock(&g_metrics_listen_fd);
+
+    g_metrics_stop    = false;
+    g_metrics_enabled = true;
+    ret = pthread_create(&g_metrics_tid, NULL, ovsa_license_service_metrics_thread, body);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error pthread_create failed with error code %d\n", ret);
+        g_metrics_enabled = false;
+        ret               = OVSA_THREAD_CREATE_FAIL;
+        goto out;
+    }
+    body = NULL;
+    OVSA_DBG(DBG_I, "OVSA:Serving metrics on %s:%s/metrics\n", bind_addr, port);
+out:
+    if (body != NULL) {
+        ovsa_license_service_safe_free(&body->buf);
+        ovsa_license_service_safe_free((char**)&body);
+    }
+    if (ret < OVSA_OK)
+        mbedtls_net_free(&g_metrics_listen_fd);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_metrics_stop(void) {
+    if (!g_metrics_enabled)
+        return;
+
+    g_metrics_stop = true;
+    pthread_join(g_metrics_tid, NULL);
+    mbedtls_net_free(&g_metrics_listen_fd);
+    g_metrics_enabled = false;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __OVSA_METRICS_H_
+#define __OVSA_METRICS_H_
+
+#include <time.h>
+
+#include "license_service.h"
+
+/* Latency histograms, exported in seconds */
+typedef enum {
+    /* Stages of a client connection */
+    OVSA_METRICS_STAGE_HANDSHAKE = 0,
+    OVSA_METRICS_STAGE_EK_AK_BIND,
+    OVSA_METRICS_STAGE_PCR_VALIDATE,
+    OVSA_METRICS_STAGE_QUOTE_VERIFY,
+    OVSA_METRICS_STAGE_DB_LOOKUP,
+    OVSA_METRICS_STAGE_NONCE_VERIFY,
+    /* From the end of the handshake to the check response */
+    OVSA_METRICS_STAGE_LICENSE_CHECK,
+    /* Database operations */
+    OVSA_METRICS_DB_QUERY,
+    OVSA_METRICS_DB_USAGE_FLUSH,
+    OVSA_METRICS_HIST_MAX
+} ovsa_metrics_hist_t;
+
+typedef enum {
+    OVSA_METRICS_CONNECTIONS = 0,
+    OVSA_METRICS_CONNECTIONS_CLOSED,
+    OVSA_METRICS_CONNECTIONS_REJECTED,
+    OVSA_METRICS_HANDSHAKE_FAILURES,
+    OVSA_METRICS_COUNTER_MAX
+} ovsa_metrics_counter_t;
+
+/* API's */
+/*!
+ * \brief ovsa_license_service_metrics_start starts the thread serving the metrics in the
+ * Prometheus text format on GET /metrics. Metrics are not collected until it is started.
+ * To be called before the worker threads are started
+ *
+ * \param [in]  bind_addr address the listener is bound to
+ * \param [in]  port      port the listener is bound to
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_metrics_start(const char* bind_addr, const char* port);
+
+/*!
+ * \brief ovsa_license_service_metrics_stop stops the metrics listener
+ *
+ * \return void
+ */
+
+void ovsa_license_service_metrics_stop(void);
+
+/*!
+ * \brief ovsa_license_service_metrics_stage_start takes the start time of a stage
+ *
+ * \param [out] stage_start start time of the stage
+ * \return void
+ */
+
+void ovsa_license_service_metrics_stage_start(struct timespec* stage_start);
+
+/*!
+ * \brief ovsa_license_service_metrics_stage_done records the time since the start of the
+ * stage in its histogram and restarts the stage time for the next stage
+ *
+ * \param [in]  hist        histogram of the stage
+ * \param [in]  stage_start start time of the stage, set to the current time
+ * \return void
+ */
+
+void ovsa_license_service_metrics_stage_done(ovsa_metrics_hist_t hist,
+                                             struct timespec* stage_start);
+
+/*!
+ * \brief ovsa_license_service_metrics_count increments a counter
+ *
+ * \param [in]  counter counter to be incremented
+ * \return void
+ */
+
+void ovsa_license_service_metrics_count(ovsa_metrics_counter_t counter);
+
+/*!
+ * \brief ovsa_license_service_metrics_license_check_result counts the response of a license
+ * check, failures are counted by the reason of the response
+ *
+ * \param [in]  response response sent to the client
+ * \return void
+ */
+
+void ovsa_license_service_metrics_license_check_result(const char* response);
+
+#endif
@@ -0,0 +1,395 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+/* tcb_cache.h to be included at end due to dependencies */
+#include "tcb_cache.h"
+
+/* Decoded reference values of one TCB signature of a license */
+typedef struct ovsa_tcb_reference {
+    char tcb_name[MAX_NAME_SIZE];
+    bool is_valid; /* false if the golden quotes of the TCB could not be decoded */
+    bool has_sw_quote;
+    bool has_hw_quote;
+    uint32_t sw_pcr_id_set;
+    uint32_t hw_pcr_id_set;
+    ovsa_tpm2_pcr_digests_t sw_pcrs;
+    ovsa_tpm2_pcr_digests_t hw_pcrs;
+    struct ovsa_tcb_reference* next;
+} ovsa_tcb_reference_t;
+
+typedef struct ovsa_tcb_cache_entry {
+    GUID license_guid;
+    unsigned char fingerprint[SHA256_DIGEST_LENGTH]; /* SHA256 of the TCB signatures */
+    ovsa_tcb_reference_t* references;
+    struct ovsa_tcb_cache_entry* next;
+} ovsa_tcb_cache_entry_t;
+
+static struct {
+    pthread_rwlock_t lock;
+    ovsa_tcb_cache_entry_t* buckets[TCB_CACHE_BUCKETS];
+} g_tcb_cache = {PTHREAD_RWLOCK_INITIALIZER, {NULL}};
+
+static uint32_t ovsa_license_service_tcb_cache_hash(const char* license_guid) {
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    for (const char* p = license_guid; *p != '\0'; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 16777619u;
+    }
+    return hash % TCB_CACHE_BUCKETS;
+}
+
+/* The license server DB is updated by the provisioning tools outside of the license service,
+ * so a cached entry is matched against the fingerprint of the TCB signatures received with
+ * the license instead of being invalidated on write */
+static ovsa_status_t ovsa_license_service_tcb_cache_fingerprint(
+    const ovsa_tcb_sig_list_t* tcb_list, unsigned char* fingerprint) {
+    ovsa_status_t ret = OVSA_OK;
+    EVP_MD_CTX* mdctx = NULL;
+
+    mdctx = EVP_MD_CTX_new();
+    if ((mdctx == NULL) || (EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing TCB signature digest failed\n");
+        ret = OVSA_CRYPTO_GENERIC_ERROR;
+        goto out;
+    }
+    for (; tcb_list != NULL; tcb_list = tcb_list->next) {
+        /* Include the terminating NUL to separate the signatures */
+        if ((tcb_list->tcb_signature != NULL) &&
+            (EVP_DigestUpdate(mdctx, tcb_list->tcb_signature,
+                              strlen(tcb_list->tcb_signature) + 1) != 1)) {
+            OVSA_DBG(DBG_E, "OVSA: Error computing TCB signature digest failed\n");
+            ret = OVSA_CRYPTO_GENERIC_ERROR;
+            goto out;
+        }
+    }
+    if (EVP_DigestFinal_ex(mdctx, fingerprint, NULL) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error finalizing TCB signature digest failed\n");
+        ret = OVSA_CRYPTO_GENERIC_ERROR;
+        goto out;
+    }
+out:
+    EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+static uint32_t ovsa_license_service_tcb_cache_pcr_id_set(const char* pcr_id, const char* type) {
+    char* endptr    = NULL;
+    long pcr_id_set = 0;
+
+    pcr_id_set = strtol(pcr_id, &endptr, 16);
+    if (*endptr != '\0') {
+        OVSA_DBG(DBG_I, "OVSA:WARNING: %s_pcr_id='%s' is not valid hex value \n", type, pcr_id);
+        OVSA_DBG(DBG_I, "OVSA:Validate %sPCR_ID_SET is set to default value 0xFFFFFF\n", type);
+        pcr_id_set = strtol(DEFAULT_PCR_ID_SET, NULL, 16);
+    }
+    if (!((pcr_id_set > 0) && (pcr_id_set <= 0xffffff))) {
+        OVSA_DBG(DBG_I,
+                 "OVSA: WARNING: %s_pcr_id=%s is not valid [valid range=0x1:0xffffff] "
+                 "\nValidate %sPCR_ID_SET is set to default value 0xFFFFFF\n",
+                 type, pcr_id, type);
+        pcr_id_set = strtol(DEFAULT_PCR_ID_SET, NULL, 16);
+    }
+    return (uint32_t)pcr_id_set;
+}
+
+static void ovsa_license_service_tcb_cache_free_entry(ovsa_tcb_cache_entry_t* entry) {
+    ovsa_tcb_reference_t* reference = NULL;
+
+    if (entry == NULL)
+        return;
+    while (entry->references != NULL) {
+        reference         = entry->references;
+        entry->references = reference->next;
+        ovsa_license_service_tpm2_free_pcr_digests(&reference->sw_pcrs);
+        ovsa_license_service_tpm2_free_pcr_digests(&reference->hw_pcrs);
+        ovsa_license_service_safe_free((char**)&reference);
+    }
+    ovsa_license_service_safe_free((char**)&entry);
+}
+
+static ovsa_status_t ovsa_license_service_tcb_cache_decode_reference(
+    const char* tcb_signature, ovsa_tcb_reference_t* reference) {
+    ovsa_status_t ret = OVSA_OK;
+    ovsa_tcb_sig_t tsig;
+
+    /* Read TCB info from tcb_signature */
+    memset_s(&tsig, sizeof(ovsa_tcb_sig_t), 0);
+    ret = ovsa_license_service_json_extract_tcb_signature(tcb_signature, &tsig);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read tcb_signature failed %d\n", ret);
+        goto out;
+    }
+    ovsa_license_service_safe_free(&tsig.tcbinfo.isv_certificate);
+    OVSA_DBG(DBG_D, "OVSA:TCB_NAME    : '%s' \n", tsig.tcbinfo.tcb_name);
+
+    memcpy_s(reference->tcb_name, sizeof(reference->tcb_name), tsig.tcbinfo.tcb_name,
+             sizeof(tsig.tcbinfo.tcb_name));
+    reference->is_valid     = true;
+    reference->has_sw_quote = strcmp(tsig.tcbinfo.sw_quote, "") != 0;
+    reference->has_hw_quote = strcmp(tsig.tcbinfo.hw_quote, "") != 0;
+    if (reference->has_sw_quote) {
+        OVSA_DBG(DBG_D, "OVSA:sw_quote    : '%s' \n", tsig.tcbinfo.sw_quote);
+        reference->sw_pcr_id_set =
+            ovsa_license_service_tcb_cache_pcr_id_set(tsig.tcbinfo.sw_pcr_id_set, "SW");
+        OVSA_DBG(DBG_D, "OVSA:Read golden sw pcr_bin values\n");
+        if (ovsa_license_service_tpm2_decode_pcr_digests(tsig.tcbinfo.sw_quote,
+                                                         &reference->sw_pcrs) < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read golden sw pcr values of '%s' failed\n",
+                     reference->tcb_name);
+            reference->is_valid = false;
+        }
+    }
+    if (reference->has_hw_quote) {
+        OVSA_DBG(DBG_D, "OVSA:hw_quote    : '%s' \n", tsig.tcbinfo.hw_quote);
+        reference->hw_pcr_id_set =
+            ovsa_license_service_tcb_cache_pcr_id_set(tsig.tcbinfo.hw_pcr_id_set, "HW");
+        OVSA_DBG(DBG_D, "OVSA:Read golden hw pcr_bin values\n");
+        if (ovsa_license_service_tpm2_decode_pcr_digests(tsig.tcbinfo.hw_quote,
+                                                         &reference->hw_pcrs) < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read golden hw pcr values of '%s' failed\n",
+                     reference->tcb_name);
+            reference->is_valid = false;
+        }
+    }
+out:
+    return ret;
+}
+
+/* Decodes the TCB signatures of the license. Done outside of the cache lock as the JSON
+ * parsing and base64 decoding is the expensive part of the TCB validation */
+static ovsa_status_t ovsa_license_service_tcb_cache_build_entry(
+    const char* license_guid, const ovsa_tcb_sig_list_t* tcb_list,
+    const unsigned char* fingerprint, ovsa_tcb_cache_entry_t** entry) {
+    ovsa_status_t ret               = OVSA_OK;
+    ovsa_tcb_reference_t* reference = NULL;
+    ovsa_tcb_reference_t** tail     = NULL;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    ret = ovsa_license_service_safe_malloc(sizeof(ovsa_tcb_cache_entry_t), (char**)entry);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error allocating TCB cache entry failed with code %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+    if (strcpy_s((*entry)->license_guid, sizeof(GUID), license_guid) != EOK) {
+        OVSA_DBG(DBG_E, "OVSA: Error license guid length is invalid\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    memcpy_s((*entry)->fingerprint, sizeof((*entry)->fingerprint), fingerprint,
+             SHA256_DIGEST_LENGTH);
+
+    tail = &(*entry)->references;
+    for (; tcb_list != NULL; tcb_list = tcb_list->next) {
+        ret = ovsa_license_service_safe_malloc(sizeof(ovsa_tcb_reference_t), (char**)&reference);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error allocating TCB reference failed with code %d\n", ret);
+            ret = OVSA_MEMORY_ALLOC_FAIL;
+            goto out;
+        }
+        *tail = reference;
+        tail  = &reference->next;
+        ret   = ovsa_license_service_tcb_cache_decode_reference(tcb_list->tcb_signature,
+                                                                reference);
+        if (ret < OVSA_OK)
+            goto out;
+    }
+out:
+    if (ret < OVSA_OK) {
+        ovsa_license_service_tcb_cache_free_entry(*entry);
+        *entry = NULL;
+    }
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+static ovsa_tcb_cache_entry_t* ovsa_license_service_tcb_cache_find(uint32_t bucket,
+                                                                   const char* license_guid) {
+    ovsa_tcb_cache_entry_t* entry = NULL;
+    int indicator                 = -1;
+
+    for (entry = g_tcb_cache.buckets[bucket]; entry != NULL; entry = entry->next) {
+        strcmp_s(entry->license_guid, GUID_SIZE, license_guid, &indicator);
+        if (indicator == 0)
+            break;
+    }
+    return entry;
+}
+
+static bool ovsa_license_service_tcb_cache_is_current(const ovsa_tcb_cache_entry_t* entry,
+                                                      const unsigned char* fingerprint) {
+    int diff = -1;
+
+    if (entry == NULL)
+        return false;
+    memcmp_s(entry->fingerprint, sizeof(entry->fingerprint), fingerprint, SHA256_DIGEST_LENGTH,
+             &diff);
+    return diff == 0;
+}
+
+static bool ovsa_license_service_tcb_cache_validate_reference(
+    const ovsa_tcb_reference_t* reference, const ovsa_tpm2_pcr_digests_t* sw_pcrs,
+    const ovsa_tpm2_pcr_digests_t* hw_pcrs) {
+    bool is_valid_swpcr = false;
+    bool is_valid_hwpcr = false;
+
+    if (!reference->is_valid)
+        return false;
+
+    if (reference->has_sw_quote) {
+        OVSA_DBG(DBG_D, "OVSA:Validate sw_pcr_ids ,SET_SWPCR_ID:0x%x \n",
+                 reference->sw_pcr_id_set);
+        if (sw_pcrs == NULL) {
+            OVSA_DBG(DBG_E, "OVSA: Error quote pcr is not received from client\n");
+            return false;
+        }
+        if (ovsa_license_service_tpm2_compare_pcr_digests(sw_pcrs, &reference->sw_pcrs,
+                                                          reference->sw_pcr_id_set) < OVSA_OK) {
+            OVSA_DBG(DBG_E, "Error TPM2_SWPCR check failed\n");
+            return false;
+        }
+        is_valid_swpcr = true;
+        OVSA_DBG(DBG_D, "OVSA:TPM2_SWPCR check PASS\n");
+    }
+    if (reference->has_hw_quote) {
+        OVSA_DBG(DBG_D, "OVSA:Validate hw_pcr_ids ,SET_HWPCR_ID:0x%x \n",
+                 reference->hw_pcr_id_set);
+        if (hw_pcrs == NULL) {
+            OVSA_DBG(DBG_E, "OVSA: Error quote pcr is not received from client\n");
+            return false;
+        }
+        if (ovsa_license_service_tpm2_compare_pcr_digests(hw_pcrs, &reference->hw_pcrs,
+                                                          reference->hw_pcr_id_set) < OVSA_OK) {
+            OVSA_DBG(DBG_E, "Error TPM2_HWPCR check failed\n");
+            return false;
+        }
+        is_valid_hwpcr = true;
+        OVSA_DBG(DBG_D, "OVSA:TPM2_HWPCR check PASS\n");
+    }
+    /* Is valid TCB */
+    return ((sw_pcrs != NULL) && (hw_pcrs != NULL) && is_valid_swpcr && is_valid_hwpcr) ||
+           ((sw_pcrs != NULL) && (hw_pcrs == NULL) && is_valid_swpcr) ||
+           ((sw_pcrs == NULL) && (hw_pcrs != NULL) && is_valid_hwpcr);
+}
+
+/* To be called with the cache lock held */
+static ovsa_status_t ovsa_license_service_tcb_cache_validate_entry(
+    const ovsa_tcb_cache_entry_t* entry, const ovsa_tpm2_pcr_digests_t* sw_pcrs,
+    const ovsa_tpm2_pcr_digests_t* hw_pcrs) {
+    const ovsa_tcb_reference_t* reference = NULL;
+
+    for (reference = entry->references; reference != NULL; reference = reference->next) {
+        if (ovsa_license_service_tcb_cache_validate_reference(reference, sw_pcrs, hw_pcrs)) {
+            OVSA_DBG(DBG_I, "OVSA:Customer '%s' is valid\n", reference->tcb_name);
+            return OVSA_OK;
+        }
+        OVSA_DBG(DBG_I, "OVSA:Customer '%s' is not valid\n", reference->tcb_name);
+    }
+    return OVSA_TCB_VALIDATION_FAILED;
+}
+
+ovsa_status_t ovsa_license_service_tcb_cache_validate(const char* license_guid,
+                                                      const ovsa_tcb_sig_list_t* tcb_list,
+                                                      const ovsa_tpm2_pcr_digests_t* sw_pcrs,
+                                                      const ovsa_tpm2_pcr_digests_t* hw_pcrs) {
+    ovsa_status_t ret                 = OVSA_OK;
+    ovsa_tcb_cache_entry_t* entry     = NULL;
+    ovsa_tcb_cache_entry_t* new_entry = NULL;
+    ovsa_tcb_cache_entry_t** link     = NULL;
+    unsigned char fingerprint[SHA256_DIGEST_LENGTH];
+    uint32_t bucket = 0;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if ((license_guid == NULL) || (tcb_list == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error tcb signature empty  \n");
+        ret = OVSA_TCB_VALIDATION_FAILED;
+        goto out;
+    }
+    ret = ovsa_license_service_tcb_cache_fingerprint(tcb_list, fingerprint);
+    if (ret < OVSA_OK)
+        goto out;
+    bucket = ovsa_license_service_tcb_cache_hash(license_guid);
+
+    pthread_rwlock_rdlock(&g_tcb_cache.lock);
+    entry = ovsa_license_service_tcb_cache_find(bucket, license_guid);
+    if (ovsa_license_service_tcb_cache_is_current(entry, fingerprint)) {
+        ret = ovsa_license_service_tcb_cache_validate_entry(entry, sw_pcrs, hw_pcrs);
+        pthread_rwlock_unlock(&g_tcb_cache.lock);
+        goto out;
+    }
+    pthread_rwlock_unlock(&g_tcb_cache.lock);
+
+    ret = ovsa_license_service_tcb_cache_build_entry(license_guid, tcb_list, fingerprint,
+                                                     &new_entry);
+    if (ret < OVSA_OK)
+        goto out;
+
+    pthread_rwlock_wrlock(&g_tcb_cache.lock);
+    /* Another worker may have cached the license meanwhile */
+    entry = ovsa_license_service_tcb_cache_find(bucket, license_guid);
+    if (ovsa_license_service_tcb_cache_is_current(entry, fingerprint)) {
+        ovsa_license_service_tcb_cache_free_entry(new_entry);
+    } else {
+        /* Replace the entry of the previous TCB signatures of the license */
+        for (link = &g_tcb_cache.buckets[bucket]; *link != NULL; link = &(*link)->next) {
+            if (*link == entry) {
+                *link = entry->next;
+                ovsa_license_service_tcb_cache_free_entry(entry);
+                break;
+            }
+        }
+        new_entry->next             = g_tcb_cache.buckets[bucket];
+        g_tcb_cache.buckets[bucket] = new_entry;
+        entry                       = new_entry;
+    }
+    ret = ovsa_license_service_tcb_cache_validate_entry(entry, sw_pcrs, hw_pcrs);
+    pthread_rwlock_unlock(&g_tcb_cache.lock);
+
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_tcb_cache_free(void) {
+    ovsa_tcb_cache_entry_t* entry = NULL;
+    size_t bucket                 = 0;
+
+    pthread_rwlock_wrlock(&g_tcb_cache.lock);
+    for (bucket = 0; bucket < TCB_CACHE_BUCKETS; bucket++) {
+        while (g_tcb_cache.buckets[bucket] != NULL) {
+            entry                       = g_tcb_cache.buckets[bucket];
+            g_tcb_cache.buckets[bucket] = entry->next;
+            ovsa_license_service_tcb_cache_free_entry(entry);
+        }
+    }
+    pthread_rwlock_unlock(&g_tcb_cache.lock);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __OVSA_TCB_CACHE_H_
+#define __OVSA_TCB_CACHE_H_
+
+#include "license_service.h"
+
+/* Golden TCB cache of the licenses */
+#define TCB_CACHE_BUCKETS 1024
+
+/* API's */
+/*!
+ * \brief ovsa_license_service_tcb_cache_validate validates the received PCRs against the
+ * TCB signatures of the license. The TCB signatures are decoded on the first check of a
+ * license and the decoded reference values are reused until the TCB signatures of the
+ * license change
+ *
+ * \param [in]  license_guid buffer pointing to the license guid
+ * \param [in]  tcb_list list of TCB signatures of the customer license
+ * \param [in]  sw_pcrs decoded SW quote PCRs, NULL if not received from client
+ * \param [in]  hw_pcrs decoded HW quote PCRs, NULL if not received from client
+ * \return ovsa_status_t
+ */
+
+ovsa_status_t ovsa_license_service_tcb_cache_validate(const char* license_guid,
+                                                      const ovsa_tcb_sig_list_t* tcb_list,
+                                                      const ovsa_tpm2_pcr_digests_t* sw_pcrs,
+                                                      const ovsa_tpm2_pcr_digests_t* hw_pcrs);
+
+/*!
+ * \brief ovsa_license_service_tcb_cache_free frees the decoded TCB reference values of all
+ * licenses. To be called after the worker threads are stopped
+ *
+ * \return void
+ */
+
+void ovsa_license_service_tcb_cache_free(void);
+
+#endif
@@ -0,0 +1,742 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <openssl/bn.h>
+#include <openssl/ecdsa.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/pem.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "license_service.h"
+#include "safe_str_lib.h"
+#include "tss2/tss2_mu.h"
+#include "utils.h"
+
+/* Label of the seed encryption and the KDFa labels, including the terminating zero as
+ * required by the TPM2 specification */
+static const char g_tpm2_identity_label[]  = "IDENTITY";
+static const char g_tpm2_integrity_label[] = "INTEGRITY";
+static const char g_tpm2_storage_label[]   = "STORAGE";
+
+#define TPM2_CREDENTIAL_KEY_SIZE 16 /* AES-128-CFB of the EK template */
+
+static ovsa_status_t ovsa_license_service_tpm2_decode(const char* in_buff, char** out_buff,
+                                                     size_t* out_buff_len) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t size       = 0;
+
+    ret = ovsa_license_service_get_string_length(in_buff, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of quote element %d\n", ret);
+        return ret;
+    }
+    ret = ovsa_license_service_safe_malloc(sizeof(char) * size, out_buff);
+    if (ret < OVSA_OK || *out_buff == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote buffer allocation failed %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    ret = ovsa_license_service_crypto_convert_base64_to_bin(in_buff, size, *out_buff, out_buff_len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
+        ovsa_license_service_safe_free(out_buff);
+    }
+    return ret;
+}
+
+static ovsa_status_t ovsa_license_service_tpm2_read_pcrs(const char* quote_pcr,
+                                                         TPML_PCR_SELECTION* pcr_select,
+                                                         tpm2_pcrs* pcrs) {
+    ovsa_status_t ret    = OVSA_OK;
+    char* pcr_bin_buff   = NULL;
+    size_t pcr_bin_len   = 0;
+    size_t offset        = 0;
+    uint32_t count       = 0;
+    uint32_t j           = 0;
+    const size_t max_dig = sizeof(pcrs->pcr_values[0].digests) / sizeof(TPM2B_DIGEST);
+
+    ret = ovsa_license_service_tpm2_decode(quote_pcr, &pcr_bin_buff, &pcr_bin_len);
+    if (ret < OVSA_OK)
+        goto out;
+
+    /* Layout of the tpm2_quote --pcr output: TPML_PCR_SELECTION, count, TPML_DIGEST[count] */
+    if (pcr_bin_len < sizeof(TPML_PCR_SELECTION) + sizeof(uint32_t)) {
+        ret = OVSA_PCR_COUNT_NOT_VALID;
+        OVSA_DBG(DBG_E, "OVSA: Error pcr data is truncated\n");
+        goto out;
+    }
+    memcpy_s(pcr_select, sizeof(TPML_PCR_SELECTION), pcr_bin_buff, sizeof(TPML_PCR_SELECTION));
+    offset += sizeof(TPML_PCR_SELECTION);
+    memcpy_s(&count, sizeof(uint32_t), pcr_bin_buff + offset, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+    if ((count > TPM2_MAX_PCRS) || (pcr_select->count > TPM2_NUM_PCR_BANKS) ||
+        (pcr_bin_len - offset < count * sizeof(TPML_DIGEST))) {
+        ret = OVSA_PCR_COUNT_NOT_VALID;
+        OVSA_DBG(DBG_E, "OVSA: Error pcr count is not valid\n");
+        goto out;
+    }
+    pcrs->count = count;
+    for (j = 0; j < count; j++) {
+        memcpy_s(&pcrs->pcr_values[j], sizeof(TPML_DIGEST), pcr_bin_buff + offset,
+                 sizeof(TPML_DIGEST));
+        offset += sizeof(TPML_DIGEST);
+        if (pcrs->pcr_values[j].count > max_dig) {
+            ret = OVSA_PCR_COUNT_NOT_VALID;
+            OVSA_DBG(DBG_E, "OVSA: Error pcr digest count is not valid\n");
+            goto out;
+        }
+    }
+
+out:
+    ovsa_license_service_safe_free(&pcr_bin_buff);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_tpm2_decode_pcr_digests(const char* quote_pcr,
+                                                           ovsa_tpm2_pcr_digests_t* pcr_digests) {
+    ovsa_status_t ret = OVSA_OK;
+    uint32_t i = 0, pcr_id = 0;
+    size_t vi = 0, di = 0, selected = 0, index = 0;
+    tpm2_pcrs pcrs;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(pcr_digests, sizeof(ovsa_tpm2_pcr_digests_t), 0);
+    ret = ovsa_license_service_tpm2_read_pcrs(quote_pcr, &pcr_digests->pcr_select, &pcrs);
+    if (ret < OVSA_OK)
+        goto out;
+
+    for (i = 0; i < pcr_digests->pcr_select.count; i++) {
+        TPMS_PCR_SELECTION* pcr_selection = &pcr_digests->pcr_select.pcrSelections[i];
+
+        if (pcr_selection->sizeofSelect > TPM2_PCR_SELECT_MAX) {
+            ret = OVSA_PCR_ID_NOT_VALID;
+            OVSA_DBG(DBG_E, "OVSA: Error pcr selection size is not valid\n");
+            goto out;
+        }
+        for (pcr_id = 0; pcr_id < pcr_selection->sizeofSelect * 8u; pcr_id++) {
+            if (pcr_selection->pcrSelect[pcr_id / 8] & (1 << (pcr_id % 8)))
+                selected++;
+        }
+    }
+    if (selected == 0)
+        goto out;
+    ret = ovsa_license_service_safe_malloc(sizeof(ovsa_tpm2_pcr_digest_t) * selected,
+                                           (char**)&pcr_digests->digests);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error pcr digests allocation failed %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+
+    /* The digests follow the selection order, bank by bank and PCR by PCR */
+    for (i = 0; i < pcr_digests->pcr_select.count; i++) {
+        TPMS_PCR_SELECTION* pcr_selection = &pcr_digests->pcr_select.pcrSelections[i];
+
+        for (pcr_id = 0; pcr_id < pcr_selection->sizeofSelect * 8u; pcr_id++) {
+            if (!(pcr_selection->pcrSelect[pcr_id / 8] & (1 << (pcr_id % 8))))
+                continue;
+            if ((vi >= pcrs.count) || (di >= pcrs.pcr_values[vi].count)) {
+                ret = OVSA_PCR_COUNT_NOT_VALID;
+                OVSA_DBG(DBG_E, "OVSA: Error pcr values do not match the pcr selection\n");
+                goto out;
+            }
+            TPM2B_DIGEST* b = &pcrs.pcr_values[vi].digests[di];
+            if (b->size > sizeof(TPMU_HA)) {
+                ret = OVSA_PCR_DIGEST_NOT_VALID;
+                OVSA_DBG(DBG_E, "OVSA: Error pcr value digest is greater than MAX value %ld\n",
+                         sizeof(TPMU_HA));
+                goto out;
+            }
+            pcr_digests->digests[index].hash   = pcr_selection->hash;
+            pcr_digests->digests[index].pcr_id = pcr_id;
+            memcpy_s(&pcr_digests->digests[index].digest, sizeof(TPM2B_DIGEST), b,
+                     sizeof(TPM2B_DIGEST));
+            index++;
+            if (++di >= pcrs.pcr_values[vi].count) {
+                di = 0;
+                vi++;
+            }
+        }
+    }
+    pcr_digests->count = index;
+
+out:
+    if (ret < OVSA_OK)
+        ovsa_license_service_tpm2_free_pcr_digests(pcr_digests);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+void ovsa_license_service_tpm2_free_pcr_digests(ovsa_tpm2_pcr_digests_t* pcr_digests) {
+    ovsa_license_service_safe_free((char**)&pcr_digests->digests);
+    pcr_digests->count = 0;
+}
+
+ovsa_status_t ovsa_license_service_tpm2_compare_pcr_digests(
+    const ovsa_tpm2_pcr_digests_t* pcr_digests, const ovsa_tpm2_pcr_digests_t* golden_digests,
+    uint32_t pcr_id_set) {
+    const ovsa_tpm2_pcr_digest_t* pcr    = NULL;
+    const ovsa_tpm2_pcr_digest_t* golden = NULL;
+    size_t i = 0, j = 0, compared = 0;
+    int diff = 0;
+
+    for (i = 0; i < pcr_digests->count; i++) {
+        pcr = &pcr_digests->digests[i];
+        if ((pcr->pcr_id >= sizeof(pcr_id_set) * 8) || !(pcr_id_set & (1u << pcr->pcr_id)))
+            continue;
+        /* Both lists are in selection order, the golden PCR is usually at the same index */
+        golden = NULL;
+        for (j = 0; j < golden_digests->count; j++) {
+            const ovsa_tpm2_pcr_digest_t* entry =
+                &golden_digests->digests[(i + j) % golden_digests->count];
+            if ((entry->hash == pcr->hash) && (entry->pcr_id == pcr->pcr_id)) {
+                golden = entry;
+                break;
+            }
+        }
+        if ((golden == NULL) || (golden->digest.size != pcr->digest.size) ||
+            (memcmp_s(golden->digest.buffer, golden->digest.size, pcr->digest.buffer,
+                      pcr->digest.size, &diff) != EOK) ||
+            (diff != 0)) {
+            OVSA_DBG(DBG_E, "OVSA: Error received pcr_id:%d is not valid\n", pcr->pcr_id);
+            return OVSA_PCR_VALIDATION_FAILED;
+        }
+        compared++;
+    }
+    if (compared == 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error no pcr of the pcr_id_set 0x%x is quoted\n", pcr_id_set);
+        return OVSA_PCR_VALIDATION_FAILED;
+    }
+    return OVSA_OK;
+}
+
+/* Hashes the selected PCR values in selection order, as the TPM does for the quote */
+static ovsa_status_t ovsa_license_service_tpm2_compute_pcr_digest(
+    const ovsa_tpm2_pcr_digests_t* pcr_digests, unsigned char* digest, unsigned int* digest_len) {
+    ovsa_status_t ret = OVSA_OK;
+    EVP_MD_CTX* mdctx = NULL;
+    size_t i          = 0;
+
+    mdctx = EVP_MD_CTX_new();
+    if ((mdctx == NULL) || (EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error pcr digest init failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    for (i = 0; i < pcr_digests->count; i++) {
+        if (EVP_DigestUpdate(mdctx, pcr_digests->digests[i].digest.buffer,
+                             pcr_digests->digests[i].digest.size) != 1) {
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto out;
+        }
+    }
+    if (EVP_DigestFinal_ex(mdctx, digest, digest_len) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error pcr digest final failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+    }
+
+out:
+    EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+static ovsa_status_t ovsa_license_service_tpm2_verify_signature(const char* ak_pub_key,
+                                                               const unsigned char* digest,
+                                                               size_t digest_len,
+                                                               TPMT_SIGNATURE* signature) {
+    ovsa_status_t ret        = OVSA_OK;
+    BIO* pub_bio             = NULL;
+    EVP_PKEY* pkey           = NULL;
+    EVP_PKEY_CTX* pkey_ctx   = NULL;
+    ECDSA_SIG* ecdsa_sig     = NULL;
+    BIGNUM* sig_r            = NULL;
+    BIGNUM* sig_s            = NULL;
+    unsigned char* der_sig   = NULL;
+    const unsigned char* sig = NULL;
+    size_t sig_len           = 0;
+    int der_len              = 0;
+
+    pub_bio = BIO_new_mem_buf(ak_pub_key, -1);
+    if (pub_bio == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading AK public key failed in getting BIO\n");
+        ret = OVSA_CRYPTO_BIO_ERROR;
+        goto out;
+    }
+    pkey = PEM_read_bio_PUBKEY(pub_bio, NULL, NULL, NULL);
+    if (pkey == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading AK public key failed\n");
+        ret = OVSA_CRYPTO_PEM_ENCODE_ERROR;
+        goto out;
+    }
+    pkey_ctx = EVP_PKEY_CTX_new(pkey, NULL);
+    if ((pkey_ctx == NULL) || (EVP_PKEY_verify_init(pkey_ctx) != 1) ||
+        (EVP_PKEY_CTX_set_signature_md(pkey_ctx, EVP_sha256()) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing quote signature verification failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+
+    switch (signature->sigAlg) {
+        case TPM2_ALG_RSASSA:
+        case TPM2_ALG_RSAPSS:
+            if ((EVP_PKEY_id(pkey) != EVP_PKEY_RSA) ||
+                (signature->signature.rsassa.hash != TPM2_ALG_SHA256)) {
+                ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+                goto out;
+            }
+            if (signature->sigAlg == TPM2_ALG_RSASSA) {
+                if (EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_PADDING) != 1)
+                    ret = OVSA_CRYPTO_EVP_ERROR;
+            } else {
+                if ((EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_PSS_PADDING) != 1) ||
+                    (EVP_PKEY_CTX_set_rsa_pss_saltlen(pkey_ctx, RSA_PSS_SALTLEN_AUTO) != 1))
+                    ret = OVSA_CRYPTO_EVP_ERROR;
+            }
+            sig     = signature->signature.rsassa.sig.buffer;
+            sig_len = signature->signature.rsassa.sig.size;
+            break;
+        case TPM2_ALG_ECDSA:
+            if ((EVP_PKEY_id(pkey) != EVP_PKEY_EC) ||
+                (signature->signature.ecdsa.hash != TPM2_ALG_SHA256)) {
+                ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+                goto out;
+            }
+            /* The TPM returns r and s, OpenSSL verifies the DER encoded signature */
+            ecdsa_sig = ECDSA_SIG_new();
+            sig_r     = BN_bin2bn(signature->signature.ecdsa.signatureR.buffer,
+                              signature->signature.ecdsa.signatureR.size, NULL);
+            sig_s     = BN_bin2bn(signature->signature.ecdsa.signatureS.buffer,
+                              signature->signature.ecdsa.signatureS.size, NULL);
+            if ((ecdsa_sig == NULL) || (sig_r == NULL) || (sig_s == NULL) ||
+                (ECDSA_SIG_set0(ecdsa_sig, sig_r, sig_s) != 1)) {
+                BN_free(sig_r);
+                BN_free(sig_s);
+                ret = OVSA_CRYPTO_GENERIC_ERROR;
+                goto out;
+            }
+            der_len = i2d_ECDSA_SIG(ecdsa_sig, &der_sig);
+            if (der_len <= 0) {
+                ret = OVSA_CRYPTO_GENERIC_ERROR;
+                goto out;
+            }
+            sig     = der_sig;
+            sig_len = (size_t)der_len;
+            break;
+        default:
+            OVSA_DBG(DBG_E, "OVSA: Error quote signature algorithm 0x%x is not supported\n",
+                     signature->sigAlg);
+            ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+            goto out;
+    }
+    if (ret < OVSA_OK)
+        goto out;
+
+    if (EVP_PKEY_verify(pkey_ctx, sig, sig_len, digest, digest_len) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote signature verification failed\n");
+        ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+    }
+
+out:
+    OPENSSL_free(der_sig);
+    ECDSA_SIG_free(ecdsa_sig);
+    EVP_PKEY_CTX_free(pkey_ctx);
+    EVP_PKEY_free(pkey);
+    BIO_free(pub_bio);
+    return ret;
+}
+
+static bool ovsa_license_service_tpm2_compare_pcr_selection(const TPML_PCR_SELECTION* a,
+                                                            const TPML_PCR_SELECTION* b) {
+    uint32_t i = 0;
+    int diff   = 0;
+
+    if ((a->count != b->count) || (a->count > TPM2_NUM_PCR_BANKS))
+        return false;
+    for (i = 0; i < a->count; i++) {
+        if ((a->pcrSelections[i].hash != b->pcrSelections[i].hash) ||
+            (a->pcrSelections[i].sizeofSelect != b->pcrSelections[i].sizeofSelect) ||
+            (a->pcrSelections[i].sizeofSelect > TPM2_PCR_SELECT_MAX))
+            return false;
+        if (a->pcrSelections[i].sizeofSelect == 0)
+            continue;
+        if ((memcmp_s(a->pcrSelections[i].pcrSelect, a->pcrSelections[i].sizeofSelect,
+                      b->pcrSelections[i].pcrSelect, b->pcrSelections[i].sizeofSelect,
+                      &diff) != EOK) ||
+            (diff != 0))
+            return false;
+    }
+    return true;
+}
+
+ovsa_status_t ovsa_license_service_tpm2_checkquote(const ovsa_quote_info_t* quote_info,
+                                                   const char* qualification,
+                                                   size_t qualification_len) {
+    ovsa_status_t ret     = OVSA_OK;
+    char* msg_bin_buff    = NULL;
+    size_t msg_bin_len    = 0;
+    char* sig_bin_buff    = NULL;
+    size_t sig_bin_len    = 0;
+    size_t offset         = 0;
+    unsigned int hash_len = 0;
+    int diff              = 0;
+    unsigned char msg_hash[EVP_MAX_MD_SIZE];
+    unsigned char pcr_hash[EVP_MAX_MD_SIZE];
+    TPMT_SIGNATURE signature;
+    TPMS_ATTEST attest;
+    ovsa_tpm2_pcr_digests_t pcr_digests;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(&signature, sizeof(signature), 0);
+    memset_s(&attest, sizeof(attest), 0);
+    memset_s(&pcr_digests, sizeof(pcr_digests), 0);
+
+    ret = ovsa_license_service_tpm2_decode(quote_info->quote_message, &msg_bin_buff, &msg_bin_len);
+    if (ret < OVSA_OK)
+        goto out;
+    ret = ovsa_license_service_tpm2_decode(quote_info->quote_sig, &sig_bin_buff, &sig_bin_len);
+    if (ret < OVSA_OK)
+        goto out;
+
+    if (Tss2_MU_TPMT_SIGNATURE_Unmarshal((uint8_t*)sig_bin_buff, sig_bin_len, &offset,
+                                         &signature) != TSS2_RC_SUCCESS) {
+        OVSA_DBG(DBG_E, "OVSA: Error unmarshal of quote signature failed\n");
+        ret = OVSA_TPM2_MARSHAL_FAIL;
+        goto out;
+    }
+    offset = 0;
+    if (Tss2_MU_TPMS_ATTEST_Unmarshal((uint8_t*)msg_bin_buff, msg_bin_len, &offset, &attest) !=
+        TSS2_RC_SUCCESS) {
+        OVSA_DBG(DBG_E, "OVSA: Error unmarshal of quote message failed\n");
+        ret = OVSA_TPM2_MARSHAL_FAIL;
+        goto out;
+    }
+
+    /* 1. The quote message is signed by the AK */
+    if (EVP_Digest(msg_bin_buff, msg_bin_len, msg_hash, &hash_len, EVP_sha256(), NULL) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error computing quote message hash failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    ret = ovsa_license_service_tpm2_verify_signature(quote_info->ak_pub_key, msg_hash, hash_len,
+                                                    &signature);
+    if (ret < OVSA_OK)
+        goto out;
+
+    /* 2. The message is a TPM generated quote over our nonce */
+    if ((attest.magic != TPM2_GENERATED_VALUE) || (attest.type != TPM2_ST_ATTEST_QUOTE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote message is not a TPM generated quote\n");
+        ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+        goto out;
+    }
+    if ((attest.extraData.size != qualification_len) || (qualification_len == 0) ||
+        (memcmp_s(attest.extraData.buffer, attest.extraData.size, qualification,
+                  qualification_len, &diff) != EOK) ||
+        (diff != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote qualification does not match the nonce\n");
+        ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+        goto out;
+    }
+
+    /* 3. The PCR values sent along are the quoted ones */
+    ret = ovsa_license_service_tpm2_decode_pcr_digests(quote_info->quote_pcr, &pcr_digests);
+    if (ret < OVSA_OK)
+        goto out;
+    if (!ovsa_license_service_tpm2_compare_pcr_selection(&pcr_digests.pcr_select,
+                                                         &attest.attested.quote.pcrSelect)) {
+        OVSA_DBG(DBG_E, "OVSA: Error pcr selection does not match the quote\n");
+        ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+        goto out;
+    }
+    ret = ovsa_license_service_tpm2_compute_pcr_digest(&pcr_digests, pcr_hash, &hash_len);
+    if (ret < OVSA_OK)
+        goto out;
+    if ((attest.attested.quote.pcrDigest.size != hash_len) ||
+        (memcmp_s(attest.attested.quote.pcrDigest.buffer, attest.attested.quote.pcrDigest.size,
+                  pcr_hash, hash_len, &diff) != EOK) ||
+        (diff != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error pcr values do not match the quote digest\n");
+        ret = OVSA_TPM2_QUOTE_VERIFY_FAILED;
+        goto out;
+    }
+
+out:
+    ovsa_license_service_tpm2_free_pcr_digests(&pcr_digests);
+    ovsa_license_service_safe_free(&msg_bin_buff);
+    ovsa_license_service_safe_free(&sig_bin_buff);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+/* KDFa of TPM2 Part 1, 11.4.10.2 with HMAC-SHA256, contextV is always empty here */
+static ovsa_status_t ovsa_license_service_tpm2_kdfa(const unsigned char* key, size_t key_len,
+                                                   const char* label, size_t label_len,
+                                                   const unsigned char* context_u,
+                                                   size_t context_u_len, unsigned char* out_buff,
+                                                   size_t out_buff_len) {
+    ovsa_status_t ret     = OVSA_OK;
+    HMAC_CTX* hmac        = NULL;
+    UINT32 counter        = 0;
+    size_t offset         = 0;
+    size_t pos            = 0;
+    size_t copy_len       = 0;
+    unsigned int hash_len = 0;
+    uint8_t counter_buf[sizeof(UINT32)];
+    uint8_t bits_buf[sizeof(UINT32)];
+    unsigned char hash[EVP_MAX_MD_SIZE];
+
+    if (Tss2_MU_UINT32_Marshal((UINT32)(out_buff_len * 8), bits_buf, sizeof(bits_buf), &pos) !=
+        TSS2_RC_SUCCESS)
+        return OVSA_TPM2_MARSHAL_FAIL;
+
+    hmac = HMAC_CTX_new();
+    if (hmac == NULL)
+        return OVSA_CRYPTO_EVP_ERROR;
+
+    while (offset < out_buff_len) {
+        pos = 0;
+        counter++;
+        if (Tss2_MU_UINT32_Marshal(counter, counter_buf, sizeof(counter_buf), &pos) !=
+            TSS2_RC_SUCCESS) {
+            ret = OVSA_TPM2_MARSHAL_FAIL;
+            goto out;
+        }
+        if ((HMAC_Init_ex(hmac, key, key_len, EVP_sha256(), NULL) != 1) ||
+            (HMAC_Update(hmac, counter_buf, sizeof(counter_buf)) != 1) ||
+            (HMAC_Update(hmac, (const unsigned char*)label, label_len) != 1) ||
+            ((context_u_len > 0) && (HMAC_Update(hmac, context_u, context_u_len) != 1)) ||
+            (HMAC_Update(hmac, bits_buf, sizeof(bits_buf)) != 1) ||
+            (HMAC_Final(hmac, hash, &hash_len) != 1)) {
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto out;
+        }
+        copy_len = (out_buff_len - offset < hash_len) ? (out_buff_len - offset) : hash_len;
+        memcpy_s(out_buff + offset, out_buff_len - offset, hash, copy_len);
+        offset += copy_len;
+    }
+
+out:
+    OPENSSL_cleanse(hash, sizeof(hash));
+    HMAC_CTX_free(hmac);
+    return ret;
+}
+
+/* Encrypts the seed to the EK with RSA-OAEP as TPM2_ActivateCredential expects it */
+static ovsa_status_t ovsa_license_service_tpm2_encrypt_seed(const char* ek_pub_key,
+                                                           const unsigned char* seed,
+                                                           size_t seed_len,
+                                                           TPM2B_ENCRYPTED_SECRET* enc_seed) {
+    ovsa_status_t ret      = OVSA_OK;
+    BIO* pub_bio           = NULL;
+    EVP_PKEY* pkey         = NULL;
+    EVP_PKEY_CTX* pkey_ctx = NULL;
+    unsigned char* label   = NULL;
+    size_t enc_len         = sizeof(enc_seed->secret);
+
+    pub_bio = BIO_new_mem_buf(ek_pub_key, -1);
+    if (pub_bio == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading EK public key failed in getting BIO\n");
+        ret = OVSA_CRYPTO_BIO_ERROR;
+        goto out;
+    }
+    pkey = PEM_read_bio_PUBKEY(pub_bio, NULL, NULL, NULL);
+    if ((pkey == NULL) || (EVP_PKEY_id(pkey) != EVP_PKEY_RSA)) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading EK RSA public key failed\n");
+        ret = OVSA_CRYPTO_PEM_ENCODE_ERROR;
+        goto out;
+    }
+    pkey_ctx = EVP_PKEY_CTX_new(pkey, NULL);
+    label    = OPENSSL_memdup(g_tpm2_identity_label, sizeof(g_tpm2_identity_label));
+    if ((pkey_ctx == NULL) || (label == NULL) || (EVP_PKEY_encrypt_init(pkey_ctx) != 1) ||
+        (EVP_PKEY_CTX_set_rsa_padding(pkey_ctx, RSA_PKCS1_OAEP_PADDING) != 1) ||
+        (EVP_PKEY_CTX_set_rsa_oaep_md(pkey_ctx, EVP_sha256()) != 1) ||
+        (EVP_PKEY_CTX_set_rsa_mgf1_md(pkey_ctx, EVP_sha256()) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing seed encryption failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    if (EVP_PKEY_CTX_set0_rsa_oaep_label(pkey_ctx, label, sizeof(g_tpm2_identity_label)) != 1) {
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    /* Owned by pkey_ctx now */
+    label = NULL;
+    if (EVP_PKEY_encrypt(pkey_ctx, enc_seed->secret, &enc_len, seed, seed_len) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error encrypting seed with EK public key failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    enc_seed->size = (UINT16)enc_len;
+
+out:
+    OPENSSL_free(label);
+    EVP_PKEY_CTX_free(pkey_ctx);
+    EVP_PKEY_free(pkey);
+    BIO_free(pub_bio);
+    if (ret < OVSA_OK)
+        ERR_print_errors_fp(stdout);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_tpm2_makecredential(const char* ek_pub_key,
+                                                       const char* ak_name_hex,
+                                                       const char* secret, size_t secret_len,
+                                                       char** cred_blob, size_t* cred_blob_len) {
+    ovsa_status_t ret      = OVSA_OK;
+    EVP_CIPHER_CTX* cipher = NULL;
+    HMAC_CTX* hmac         = NULL;
+    unsigned char* ak_name = NULL;
+    long ak_name_len       = 0;
+    size_t offset          = 0;
+    size_t plain_len       = 0;
+    int enc_len = 0, final_len = 0;
+    unsigned int hmac_len = 0;
+    unsigned char seed[SHA256_DIGEST_LENGTH];
+    unsigned char hmac_key[SHA256_DIGEST_LENGTH];
+    unsigned char enc_key[TPM2_CREDENTIAL_KEY_SIZE];
+    unsigned char iv[TPM2_CREDENTIAL_KEY_SIZE];
+    uint8_t plain[sizeof(TPM2B_DIGEST)];
+    uint8_t enc_identity[sizeof(TPM2B_DIGEST)];
+    TPM2B_DIGEST credential;
+    TPM2B_DIGEST integrity;
+    TPM2B_ID_OBJECT id_object;
+    TPM2B_ENCRYPTED_SECRET enc_seed;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(&credential, sizeof(credential), 0);
+    memset_s(&integrity, sizeof(integrity), 0);
+    memset_s(&id_object, sizeof(id_object), 0);
+    memset_s(&enc_seed, sizeof(enc_seed), 0);
+    memset_s(iv, sizeof(iv), 0);
+
+    if ((secret == NULL) || (secret_len == 0) || (secret_len > sizeof(credential.buffer))) {
+        OVSA_DBG(DBG_E, "OVSA: Error credential secret size is invalid\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    ak_name = OPENSSL_hexstr2buf(ak_name_hex, &ak_name_len);
+    if ((ak_name == NULL) || (ak_name_len <= 0) || (ak_name_len > (long)sizeof(TPMU_NAME))) {
+        OVSA_DBG(DBG_E, "OVSA: Error AK name is not valid\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+
+    /* Seed protecting the credential, only the EK owner can recover it */
+    if (RAND_bytes(seed, sizeof(seed)) != 1) {
+        OVSA_DBG(DBG_E, "OVSA: Error generating credential seed failed\n");
+        ret = OVSA_CRYPTO_GENERIC_ERROR;
+        goto out;
+    }
+    ret = ovsa_license_service_tpm2_encrypt_seed(ek_pub_key, seed, sizeof(seed), &enc_seed);
+    if (ret < OVSA_OK)
+        goto out;
+    ret = ovsa_license_service_tpm2_kdfa(seed, sizeof(seed), g_tpm2_integrity_label,
+                                         sizeof(g_tpm2_integrity_label), NULL, 0, hmac_key,
+                                         sizeof(hmac_key));
+    if (ret < OVSA_OK)
+        goto out;
+    ret = ovsa_license_service_tpm2_kdfa(seed, sizeof(seed), g_tpm2_storage_label,
+                                         sizeof(g_tpm2_storage_label), ak_name, ak_name_len,
+                                         enc_key, sizeof(enc_key));
+    if (ret < OVSA_OK)
+        goto out;
+
+    /* encIdentity = AES-128-CFB(TPM2B_DIGEST(secret)) */
+    credential.size = (UINT16)secret_len;
+    memcpy_s(credential.buffer, sizeof(credential.buffer), secret, secret_len);
+    if (Tss2_MU_TPM2B_DIGEST_Marshal(&credential, plain, sizeof(plain), &plain_len) !=
+        TSS2_RC_SUCCESS) {
+        ret = OVSA_TPM2_MARSHAL_FAIL;
+        goto out;
+    }
+    cipher = EVP_CIPHER_CTX_new();
+    if ((cipher == NULL) ||
+        (EVP_EncryptInit_ex(cipher, EVP_aes_128_cfb(), NULL, enc_key, iv) != 1) ||
+        (EVP_EncryptUpdate(cipher, enc_identity, &enc_len, plain, (int)plain_len) != 1) ||
+        (EVP_EncryptFinal_ex(cipher, enc_identity + enc_len, &final_len) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error encrypting credential failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    enc_len += final_len;
+
+    /* integrityHMAC = HMAC(hmac_key, encIdentity || AK name) */
+    hmac = HMAC_CTX_new();
+    if ((hmac == NULL) ||
+        (HMAC_Init_ex(hmac, hmac_key, sizeof(hmac_key), EVP_sha256(), NULL) != 1) ||
+        (HMAC_Update(hmac, enc_identity, enc_len) != 1) ||
+        (HMAC_Update(hmac, ak_name, ak_name_len) != 1) ||
+        (HMAC_Final(hmac, integrity.buffer, &hmac_len) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error computing credential integrity failed\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto out;
+    }
+    integrity.size = (UINT16)hmac_len;
+
+    if ((Tss2_MU_TPM2B_DIGEST_Marshal(&integrity, id_object.credential,
+                                      sizeof(id_object.credential), &offset) != TSS2_RC_SUCCESS) ||
+        (sizeof(id_object.credential) - offset < (size_t)enc_len)) {
+        ret = OVSA_TPM2_MARSHAL_FAIL;
+        goto out;
+    }
+    memcpy_s(id_object.credential + offset, sizeof(id_object.credential) - offset, enc_identity,
+             enc_len);
+    id_object.size = (UINT16)(offset + enc_len);
+
+    ret = ovsa_license_service_safe_malloc(TPM2_CREDENTIAL_BLOB_SIZE, cred_blob);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error credential blob allocation failed %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+    offset = 0;
+    if ((Tss2_MU_UINT32_Marshal(TPM2_CREDENTIAL_MAGIC, (uint8_t*)*cred_blob,
+                                TPM2_CREDENTIAL_BLOB_SIZE, &offset) != TSS2_RC_SUCCESS) ||
+        (Tss2_MU_UINT32_Marshal(TPM2_CREDENTIAL_VERSION, (uint8_t*)*cred_blob,
+                                TPM2_CREDENTIAL_BLOB_SIZE, &offset) != TSS2_RC_SUCCESS) ||
+        (Tss2_MU_TPM2B_ID_OBJECT_Marshal(&id_object, (uint8_t*)*cred_blob,
+                                         TPM2_CREDENTIAL_BLOB_SIZE, &offset) != TSS2_RC_SUCCESS) ||
+        (Tss2_MU_TPM2B_ENCRYPTED_SECRET_Marshal(&enc_seed, (uint8_t*)*cred_blob,
+                                                TPM2_CREDENTIAL_BLOB_SIZE,
+                                                &offset) != TSS2_RC_SUCCESS)) {
+        OVSA_DBG(DBG_E, "OVSA: Error marshal of credential blob failed\n");
+        ovsa_license_service_safe_free(cred_blob);
+        ret = OVSA_TPM2_MARSHAL_FAIL;
+        goto out;
+    }
+    *cred_blob_len = offset;
+    OVSA_DBG(DBG_I, "OVSA:TPM2 makecredential successful\n");
+
+out:
+    OPENSSL_cleanse(seed, sizeof(seed));
+    OPENSSL_cleanse(hmac_key, sizeof(hmac_key));
+    OPENSSL_cleanse(enc_key, sizeof(enc_key));
+    OPENSSL_cleanse(plain, sizeof(plain));
+    OPENSSL_free(ak_name);
+    HMAC_CTX_free(hmac);
+    EVP_CIPHER_CTX_free(cipher);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
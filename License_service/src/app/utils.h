@@ -54,9 +54,11 @@ void ovsa_license_service_safe_free_url_list(ovsa_license_serv_url_list_t** lhea
 
 /** \brief This function is used to get the hex dump of input data
  *
+ * \param[in] label Text logged ahead of every line of the dump
  * \param[in] data Pointer to input data
+ * \param[in] size Size of input data
  */
-void ovsa_license_service_hexdump_mem(const void* data, size_t size);
+void ovsa_license_service_hexdump_mem(const char* label, const void* data, size_t size);
 
 /** \brief This function is append payload length to received input buffer
  *
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Load generator for the license service. Concurrent clients run the license check of the
+ * runtime against a license server with a mix of customer licenses, the latency of each stage of
+ * the license check protocol is reported along with the throughput. The quotes are generated by
+ * the TPM the tpm2-tools are pointed to, a software TPM such as swtpm can be selected with -T so
+ * that the license server is loaded without a platform per client.
+ */
+
+#include <ctype.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libovsa.h"
+#include "runtime.h"
+#include "safe_mem_lib.h"
+#include "safe_str_lib.h"
+#include "utils.h"
+
+#define MAX_BENCH_THREADS    64
+#define MAX_BENCH_LICENSES   32
+#define DEFAULT_BENCH_CHECKS 100
+
+/* Log-linear histogram, 16 buckets per power of two keep the percentiles within ~6% */
+#define BENCH_HIST_SUB_BITS    4
+#define BENCH_HIST_SUB_BUCKETS (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS     ((64 - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB_BUCKETS)
+
+typedef struct ovsa_bench_hist {
+    uint64_t count;
+    uint64_t max;
+    uint64_t buckets[BENCH_HIST_BUCKETS];
+} ovsa_bench_hist_t;
+
+typedef struct ovsa_bench_stats {
+    ovsa_bench_hist_t stage[OVSA_LICENSE_CHECK_STAGE_MAX];
+    ovsa_bench_hist_t total;
+    uint64_t passed;
+    uint64_t failed;
+} ovsa_bench_stats_t;
+
+typedef struct ovsa_bench_license {
+    const char* file;
+    int weight;
+} ovsa_bench_license_t;
+
+/* Shared by the client threads, remaining is taken atomically when the run is not timed */
+typedef struct ovsa_bench_ctx {
+    int asym_keyslot;
+    ovsa_bench_license_t licenses[MAX_BENCH_LICENSES];
+    int license_count;
+    int total_weight;
+    long remaining;
+    bool timed;
+    struct timespec deadline;
+} ovsa_bench_ctx_t;
+
+typedef struct ovsa_bench_thread {
+    ovsa_bench_ctx_t* ctx;
+    unsigned int seed;
+    ovsa_bench_stats_t stats;
+} ovsa_bench_thread_t;
+
+static const char* g_bench_stage_names[OVSA_LICENSE_CHECK_STAGE_MAX] = {
+    "connect", "nonce", "ek_ak_bind", "quote", "result"};
+
+/* Statistics of the license check in progress on this thread */
+static __thread ovsa_bench_stats_t* g_bench_stats = NULL;
+
+static void ovsa_bench_help(const char* argv) {
+    printf("Help for License service benchmark\n");
+    printf("-k : Keystore name\n");
+    printf("-l : Customer license file, optionally followed by :weight in the license mix\n");
+    printf("-c : Number of concurrent clients, 1 by default\n");
+    printf("-n : Number of license checks, %d by default\n", DEFAULT_BENCH_CHECKS);
+    printf("-d : Duration of the run in seconds, instead of a number of license checks\n");
+    printf("-T : TCTI of the tpm2-tools, e.g. swtpm:port=2321 for a software TPM\n");
+    printf("Example for License service benchmark as below:\n");
+    printf(
+        "%s -k key_store -l face_detect.lic:3 -l age_gender.lic:1 -c 16 -d 60 -T "
+        "swtpm:port=2321\n\n",
+        argv);
+}
+
+static int ovsa_bench_hist_index(uint64_t value) {
+    int msb = 0;
+
+    if (value < BENCH_HIST_SUB_BUCKETS)
+        return (int)value;
+    msb = 63 - __builtin_clzll(value);
+    return (msb - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB_BUCKETS +
+           (int)((value >> (msb - BENCH_HIST_SUB_BITS)) & (BENCH_HIST_SUB_BUCKETS - 1));
+}
+
+/* Highest value counted in a bucket */
+static uint64_t ovsa_bench_hist_value(int index) {
+    int shift = 0;
+
+    if (index < BENCH_HIST_SUB_BUCKETS)
+        return index;
+    shift = index / BENCH_HIST_SUB_BUCKETS - 1;
+    return ((uint64_t)(BENCH_HIST_SUB_BUCKETS + index % BENCH_HIST_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+static void ovsa_bench_hist_record(ovsa_bench_hist_t* hist, uint64_t value) {
+    hist->buckets[ovsa_bench_hist_index(value)]++;
+    hist->count++;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+static void ovsa_bench_hist_merge(ovsa_bench_hist_t* hist, const ovsa_bench_hist_t* from) {
+    int i = 0;
+
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+        hist->buckets[i] += from->buckets[i];
+    hist->count += from->count;
+    if (from->max > hist->max)
+        hist->max = from->max;
+}
+
+static uint64_t ovsa_bench_hist_percentile(const ovsa_bench_hist_t* hist, double percentile) {
+    uint64_t target = (uint64_t)(hist->count * percentile);
+    uint64_t seen   = 0;
+    uint64_t value  = 0;
+    int i           = 0;
+
+    if (target == 0)
+        target = 1;
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            value = ovsa_bench_hist_value(i);
+            return (value < hist->max) ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+static void ovsa_bench_print_hist(const char* name, const ovsa_bench_hist_t* hist) {
+    printf("%-12s %10lu %10lu %10lu %10lu %10lu\n", name, (unsigned long)hist->count,
+           (unsigned long)ovsa_bench_hist_percentile(hist, 0.50),
+           (unsigned long)ovsa_bench_hist_percentile(hist, 0.99),
+           (unsigned long)ovsa_bench_hist_percentile(hist, 0.999), (unsigned long)hist->max);
+}
+
+static uint64_t ovsa_bench_elapsed_us(const struct timespec* start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000ULL + (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void ovsa_bench_stage_cb(ovsa_license_check_stage_t stage, uint64_t elapsed_us) {
+    if ((g_bench_stats != NULL) && (stage < OVSA_LICENSE_CHECK_STAGE_MAX))
+        ovsa_bench_hist_record(&g_bench_stats->stage[stage], elapsed_us);
+}
+
+static ovsa_status_t ovsa_bench_add_license(ovsa_bench_ctx_t* ctx, char* arg) {
+    char* weight = NULL;
+
+    if (ctx->license_count >= MAX_BENCH_LICENSES) {
+        OVSA_DBG(DBG_E, "OVSA: Error more than %d customer licenses not allowed\n",
+                 MAX_BENCH_LICENSES);
+        return OVSA_INVALID_PARAMETER;
+    }
+    ctx->licenses[ctx->license_count].weight = 1;
+    weight                                   = strrchr(arg, ':');
+    if (weight != NULL) {
+        *weight++ = '\0';
+        if (!isdigit(*weight) || (atoi(weight) < 1)) {
+            OVSA_DBG(DBG_E, "OVSA: Error invalid weight of customer license %s\n", arg);
+            return OVSA_INVALID_PARAMETER;
+        }
+        ctx->licenses[ctx->license_count].weight = atoi(weight);
+    }
+    ctx->licenses[ctx->license_count].file = arg;
+    ctx->total_weight += ctx->licenses[ctx->license_count].weight;
+    ctx->license_count++;
+    return OVSA_OK;
+}
+
+static const char* ovsa_bench_pick_license(const ovsa_bench_ctx_t* ctx, unsigned int* seed) {
+    int pick = rand_r(seed) % ctx->total_weight;
+    int i    = 0;
+
+    for (i = 0; i < ctx->license_count - 1; i++) {
+        pick -= ctx->licenses[i].weight;
+        if (pick < 0)
+            break;
+    }
+    return ctx->licenses[i].file;
+}
+
+static bool ovsa_bench_next_check(ovsa_bench_ctx_t* ctx) {
+    struct timespec now;
+
+    if (!ctx->timed)
+        return __atomic_fetch_sub(&ctx->remaining, 1, __ATOMIC_RELAXED) > 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec < ctx->deadline.tv_sec) ||
+           ((now.tv_sec == ctx->deadline.tv_sec) && (now.tv_nsec < ctx->deadline.tv_nsec));
+}
+
+static void* ovsa_bench_worker(void* arg) {
+    ovsa_bench_thread_t* thread = (ovsa_bench_thread_t*)arg;
+    ovsa_bench_ctx_t* ctx       = thread->ctx;
+    ovsa_status_t ret           = OVSA_OK;
+    const char* license         = NULL;
+    struct timespec start;
+    bool status = false;
+
+    g_bench_stats = &thread->stats;
+    while (ovsa_bench_next_check(ctx)) {
+        license = ovsa_bench_pick_license(ctx, &thread->seed);
+        status  = false;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ret = ovsa_perform_tls_license_check(ctx->asym_keyslot, license, &status);
+        if ((ret == OVSA_OK) && status) {
+            ovsa_bench_hist_record(&thread->stats.total, ovsa_bench_elapsed_us(&start));
+            thread->stats.passed++;
+        } else {
+            OVSA_DBG(DBG_E, "OVSA: Error license check of %s failed with code %d\n", license,
+                     ret);
+            thread->stats.failed++;
+        }
+    }
+    g_bench_stats = NULL;
+    return NULL;
+}
+
+static void ovsa_bench_report(ovsa_bench_thread_t* threads, int thread_count,
+                              uint64_t elapsed_us) {
+    ovsa_bench_stats_t* stats = &threads[0].stats;
+    double seconds            = elapsed_us / 1000000.0;
+    int i = 0, stage = 0;
+
+    for (i = 1; i < thread_count; i++) {
+        for (stage = 0; stage < OVSA_LICENSE_CHECK_STAGE_MAX; stage++)
+            ovsa_bench_hist_merge(&stats->stage[stage], &threads[i].stats.stage[stage]);
+        ovsa_bench_hist_merge(&stats->total, &threads[i].stats.total);
+        stats->passed += threads[i].stats.passed;
+        stats->failed += threads[i].stats.failed;
+    }
+
+    printf("License checks: %lu passed, %lu failed in %.2f s with %d clients\n",
+           (unsigned long)stats->passed, (unsigned long)stats->failed, seconds, thread_count);
+    printf("Throughput: %.2f checks/s\n",
+           (seconds > 0) ? (stats->passed + stats->failed) / seconds : 0.0);
+    printf("\n%-12s %10s %10s %10s %10s %10s\n", "stage (us)", "count", "p50", "p99", "p999",
+           "max");
+    for (stage = 0; stage < OVSA_LICENSE_CHECK_STAGE_MAX; stage++)
+        ovsa_bench_print_hist(g_bench_stage_names[stage], &stats->stage[stage]);
+    ovsa_bench_print_hist("total", &stats->total);
+}
+
+int main(int argc, char** argv) {
+    ovsa_status_t ret            = OVSA_OK;
+    ovsa_bench_thread_t* threads = NULL;
+    pthread_t tids[MAX_BENCH_THREADS];
+    ovsa_bench_ctx_t ctx;
+    struct timespec start;
+    char* keystore   = NULL;
+    char* tcti       = NULL;
+    bool crypto_init = false;
+    int thread_count = 1;
+    int duration     = 0;
+    int started      = 0;
+    int i = 0, c = 0;
+
+    memset_s(&ctx, sizeof(ovsa_bench_ctx_t), 0);
+    ctx.asym_keyslot = -1;
+    ctx.remaining    = DEFAULT_BENCH_CHECKS;
+
+    while ((c = getopt(argc, argv, "k:l:c:n:d:T:h")) != -1) {
+        switch (c) {
+            case 'k':
+                keystore = optarg;
+                break;
+            case 'l':
+                ret = ovsa_bench_add_license(&ctx, optarg);
+                if (ret < OVSA_OK)
+                    goto out;
+                break;
+            case 'c':
+            case 'n':
+            case 'd':
+                if (!isdigit(*optarg) || (atoi(optarg) < 1)) {
+                    OVSA_DBG(DBG_E, "OVSA: Error invalid value %s for -%c\n", optarg, c);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                if (c == 'c')
+                    thread_count = atoi(optarg);
+                else if (c == 'n')
+                    ctx.remaining = atoi(optarg);
+                else
+                    duration = atoi(optarg);
+                break;
+            case 'T':
+                tcti = optarg;
+                break;
+            case 'h':
+                ovsa_bench_help(argv[0]);
+                goto out;
+            default:
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error wrong command given. Please follow -help for help option\n");
+                ret = OVSA_INVALID_PARAMETER;
+                goto out;
+        }
+    }
+
+    if ((keystore == NULL) || (ctx.license_count == 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error keystore and customer license are required\n");
+        ovsa_bench_help(argv[0]);
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    if (thread_count > MAX_BENCH_THREADS) {
+        OVSA_DBG(DBG_I, "OVSA: Number of clients limited to %d\n", MAX_BENCH_THREADS);
+        thread_count = MAX_BENCH_THREADS;
+    }
+    /* The tpm2-tools run by the runtime pick their TPM from the environment */
+    if ((tcti != NULL) && (setenv("TPM2TOOLS_TCTI", tcti, 1) != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error set TPM2TOOLS_TCTI failed\n");
+        ret = OVSA_FAIL;
+        goto out;
+    }
+
+    threads = (ovsa_bench_thread_t*)calloc(thread_count, sizeof(ovsa_bench_thread_t));
+    if (threads == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory for client threads\n");
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+
+    ret = ovsa_crypto_init();
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa crypto init failed with code %d\n", ret);
+        goto out;
+    }
+    crypto_init = true;
+    ret         = ovsa_keystore_cache_get(keystore, &ctx.asym_keyslot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error load asymmetric keyslot failed with code %d\n", ret);
+        goto out;
+    }
+    ovsa_set_license_check_stage_cb(ovsa_bench_stage_cb);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (duration > 0) {
+        ctx.timed    = true;
+        ctx.deadline = start;
+        ctx.deadline.tv_sec += duration;
+    }
+    /* The calling thread is one of the clients */
+    for (i = 0; i < thread_count; i++) {
+        threads[i].ctx  = &ctx;
+        threads[i].seed = (unsigned int)time(NULL) ^ (unsigned int)(i * 2654435761U);
+    }
+    for (started = 1; started < thread_count; started++) {
+        if (pthread_create(&tids[started], NULL, ovsa_bench_worker, &threads[started]) != 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not start client thread %d\n", started);
+            break;
+        }
+    }
+    ovsa_bench_worker(&threads[0]);
+    for (i = 1; i < started; i++)
+        pthread_join(tids[i], NULL);
+
+    ovsa_bench_report(threads, started, ovsa_bench_elapsed_us(&start));
+    ovsa_set_license_check_stage_cb(NULL);
+
+out:
+    if (ctx.asym_keyslot >= MIN_KEY_SLOT)
+        ovsa_keystore_cache_put(ctx.asym_keyslot);
+    if (crypto_init) {
+        ovsa_keystore_cache_flush();
+        ovsa_crypto_deinit();
+    }
+    free(threads);
+    return ret;
+}
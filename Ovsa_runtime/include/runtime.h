@@ -59,6 +59,46 @@
 #define mbedtls_printf      printf
 #define READ_TIMEOUT_MS     20000 /* 20 seconds */
 #define MBEDTLS_DEBUG_LEVEL 0
+/* TLS sessions cached for resumption, one per license server URL */
+#define MAX_SESSION_CACHE_ENTRIES  16
+/* Attestation tokens and health of the license servers, one per license server URL */
+#define MAX_ATTESTATION_TOKEN_ENTRIES 16
+#define MAX_SERVER_HEALTH_ENTRIES     16
+/* Keystores cached with their loaded key slots, one per keystore file */
+#define MAX_KEYSTORE_CACHE_ENTRIES 8
+/* Customer licenses checked with a single platform attestation in one connection */
+#define MAX_LICENSE_BATCH_SIZE     64
+/* Leases of the customer licenses kept in memory, they are also stored next to the license */
+#define MAX_LICENSE_LEASE_ENTRIES  64
+/* Verified customer licenses kept in memory, reused while the license file is unchanged */
+#define MAX_VERIFIED_LICENSE_ENTRIES    64
+#define VERIFIED_LICENSE_CACHE_VALIDITY 86400 /* secs, the ISV certificate is verified again */
+#define LICENSE_LEASE_FILE_EXT     ".lease"
+/* Connections attempted at once to the license servers of a customer license */
+#define MAX_LICENSE_SERVER_CONNECTS       16
+#define LICENSE_SERVER_CONNECT_TIMEOUT_MS 5000 /* 5 seconds */
+/* Consecutive failures after which a license server is skipped for a while */
+#define LICENSE_SERVER_BREAKER_FAILURES   3
+#define LICENSE_SERVER_BREAKER_COOLDOWN_S 60
+/* Initial size of the buffers a license server connection sends and receives messages in */
+#define LICENSE_SERVICE_MSG_BUF_SIZE 4096
+/* Largest message the length prefix of PAYLOAD_LENGTH digits can announce */
+#define LICENSE_SERVICE_MAX_MSG_SIZE 99999999
+/*
+ * Binary framing of the license check messages, offered by the license server in its nonce
+ * message and used by both sides from the reply of the runtime on. In place of the JSON message
+ * blob, a message is OVSA_TLV_MAGIC followed by a command and a payload record, each a type byte,
+ * a 4 byte big endian length and the value. When the nonce message also offers the "trace"
+ * element, the payload may be followed by a record carrying the correlation ID of the tracing
+ * spans of the license check.
+ */
+#define OVSA_FRAMING_TLV            "tlv"
+#define OVSA_FRAMING_TRACE          "cid"
+#define OVSA_TLV_MAGIC              0x01
+#define OVSA_TLV_TYPE_COMMAND       0x01
+#define OVSA_TLV_TYPE_PAYLOAD       0x02
+#define OVSA_TLV_TYPE_TRACE_ID      0x03
+#define OVSA_TLV_RECORD_HEADER_SIZE 5
 
 #ifndef ENABLE_SGX_GRAMINE
 typedef struct ovsa_quote_info {
@@ -101,6 +141,12 @@ typedef enum {
     OVSA_SEND_UPDATE_CUST_LICENSE,
     OVSA_SEND_UPDATE_CUST_LICENSE_ACK,
     OVSA_SEND_LICENSE_CHECK_RESP,
+    OVSA_SEND_CUST_LICENSE_BATCH,
+    OVSA_SEND_LICENSE_CHECK_BATCH_RESP,
+#ifndef ENABLE_SGX_GRAMINE
+    OVSA_SEND_ATTESTATION_TOKEN,
+#endif
+    OVSA_SEND_LICENSE_LEASE,
     OVSA_INVALID_CMD
 } ovsa_command_type_t;
 
@@ -138,19 +184,99 @@ ovsa_status_t ovsa_module_loader(int asym_key_slot, int peer_cert_slot,
 ovsa_status_t ovsa_crypto_sign_mem(int asym_key_slot, char* in_buff, size_t in_buff_len,
                                    char* out_buff);
 
+/* Destination of the decrypted model files, receiving the data chunk by chunk */
+typedef struct ovsa_model_file_sink {
+    void* sink_ctx;
+    /* Called before the data of each model file with the maximum length of the file */
+    ovsa_status_t (*open_file)(void* sink_ctx, const char* model_file_name,
+                               size_t max_file_length);
+    /* Called with the decrypted data of the model file opened last */
+    ovsa_crypto_write_cb_t write_file;
+    /*
+     * Optional, returns a buffer for all file_length bytes of the model file opened last. When
+     * set and decrypt_threads is above 1, segments of the files are decrypted into it in
+     * parallel instead of calling write_file.
+     */
+    ovsa_status_t (*get_file_buff)(void* sink_ctx, size_t file_length, char** file_buff);
+    /*
+     * Optional, called before open_file for the segments of a binary controlled access model
+     * with the segment hash from the signed header. Returns true when the sink already holds the
+     * plain text of a segment with this hash, the file is then neither opened nor decrypted.
+     */
+    bool (*reuse_file)(void* sink_ctx, const char* model_file_name, const char* model_file_hash);
+    int decrypt_threads;
+} ovsa_model_file_sink_t;
+
+/*!
+ * \brief Load artefacts ,verify artifacts and perform validation. The model files are
+ * decrypted straight into the sink without intermediate copies.
+ *
+ * \param[in]  keystore_name            keystore info
+ * \param[in]  controlled_access_model  controlled access model json
+ * \param[in]  customer_license         customer_license json
+ * \param[in]  sink                     destination of the decrypted files
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_license_check_module_sink(const char* keystore,
+                                             const char* controlled_access_model,
+                                             const char* customer_license,
+                                             const ovsa_model_file_sink_t* sink);
+
+/* Stages of ovsa_license_check_module_sink() */
+typedef enum {
+    OVSA_MODEL_LOAD_STAGE_KEYSTORE = 0,
+    OVSA_MODEL_LOAD_STAGE_CERT_VERIFY,
+    /* Validation of the customer license and of the controlled access model read from disk */
+    OVSA_MODEL_LOAD_STAGE_LICENSE_VALIDATE,
+    OVSA_MODEL_LOAD_STAGE_LICENSE_CHECK,
+    OVSA_MODEL_LOAD_STAGE_KEY_UNWRAP,
+    /* Decryption of the model files into the sink */
+    OVSA_MODEL_LOAD_STAGE_DECRYPT,
+    OVSA_MODEL_LOAD_STAGE_MAX
+} ovsa_model_load_stage_t;
+
+typedef void (*ovsa_model_load_stage_cb_t)(ovsa_model_load_stage_t stage, uint64_t elapsed_us);
+
+/*!
+ * \brief Set the callback the stages of the model loads are reported to, on the thread loading
+ * the model. The time of a stage runs from the end of the previous one. It must be set before
+ * any model is loaded.
+ *
+ * \param[in]  stage_cb   callback or NULL to stop reporting
+ */
+void ovsa_set_model_load_stage_cb(ovsa_model_load_stage_cb_t stage_cb);
+
+/*!
+ * \brief Load the customer keystore and verify its certificate, without a license check. Used
+ * when a model decrypted before is handed out again.
+ *
+ * \param[in]  keystore  keystore file path
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_verify_keystore(const char* keystore);
+
 /*!
  * \brief Load artefacts ,verify artifacts and perform validation.
  *
  * \param[in]  keystore_name            keystore info
  * \param[in]  controlled_access_model  controlled access model json
  * \param[in]  customer_license         customer_license json
- * \param[in]  decrypted_files          sturcture containing decrypted files info
+ * \param[in]  decrypted_files          sturcture containing decrypted files info, in secure
+ *                                      memory and to be freed with
+ *                                      ovsa_safe_free_decrypted_model_files()
  * \return ovsa_status_t
  */
 ovsa_status_t ovsa_license_check_module(const char* keystore, const char* controlled_access_model,
                                         const char* customer_license,
                                         ovsa_model_files_t** decrypted_files);
 
+/*!
+ * \brief Wipe and free the decrypted files returned by ovsa_license_check_module()
+ *
+ * \param[in]  decrypted_files          sturcture containing decrypted files info
+ */
+void ovsa_safe_free_decrypted_model_files(ovsa_model_files_t** decrypted_files);
+
 /*!
  * \brief Validation for cutomerlicense json and load info to structure
  *
@@ -161,6 +287,20 @@ ovsa_status_t ovsa_license_check_module(const char* keystore, const char* contro
  */
 ovsa_status_t ovsa_validate_customer_license(const char* customer_license, const int asym_keyslot,
                                              char** cust_lic_buff);
+
+/*!
+ * \brief Returns the customer license buffer, verified again with
+ *        ovsa_validate_customer_license() only when the content of the license file differs
+ *        from the one verified last or the verification is older than
+ *        VERIFIED_LICENSE_CACHE_VALIDITY
+ *
+ * \param[in]  customer_license         customer_license json
+ * \param[in]  asym_keyslot             asymmetric keyslot index
+ * \param[out] cust_lic_buff            structure containing customer license buffer
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_get_verified_customer_license(const char* customer_license,
+                                                 const int asym_keyslot, char** cust_lic_buff);
 /*!
  * \brief Validation for controlled access model json and load info to structure
  *
@@ -175,7 +315,9 @@ ovsa_status_t ovsa_validate_controlled_access_model(
     ovsa_controlled_access_model_sig_t* controlled_access_model_sig);
 
 /*!
- * \brief Perform License check with tls connection
+ * \brief Perform License check with tls connection. If none of the license servers can be
+ * reached, status is set from the lease of the customer license and
+ * OVSA_LICENSE_SERVER_CONNECT_FAIL is returned.
  *
  * \param[in]  asym_keyslot       asymmetric keyslot index
  * \param[in]  customer_license   customer_license json
@@ -185,6 +327,68 @@ ovsa_status_t ovsa_validate_controlled_access_model(
 ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char* customer_license,
                                              bool* status);
 
+/*!
+ * \brief Perform License check of several customer licenses with one tls connection. The
+ * licenses served by the license server of the first one are checked together after a single
+ * platform validation, the others and those that were updated by the license server are checked
+ * one by one with ovsa_perform_tls_license_check().
+ *
+ * \param[in]  asym_keyslot       asymmetric keyslot index
+ * \param[in]  customer_licenses  customer license files
+ * \param[in]  count              number of customer licenses, up to MAX_LICENSE_BATCH_SIZE
+ * \param[out] status             status of license check performed for each customer license
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_perform_tls_license_check_batch(const int asym_keyslot,
+                                                   const char** customer_licenses, size_t count,
+                                                   bool* status);
+
+/* Stages of ovsa_perform_tls_license_check(), each one ends when the runtime has answered the
+ * message of the license server that started it */
+typedef enum {
+    OVSA_LICENSE_CHECK_STAGE_CONNECT = 0,
+    OVSA_LICENSE_CHECK_STAGE_NONCE,
+    OVSA_LICENSE_CHECK_STAGE_EK_AK_BIND,
+    OVSA_LICENSE_CHECK_STAGE_QUOTE,
+    OVSA_LICENSE_CHECK_STAGE_RESULT,
+    OVSA_LICENSE_CHECK_STAGE_MAX
+} ovsa_license_check_stage_t;
+
+typedef void (*ovsa_license_check_stage_cb_t)(ovsa_license_check_stage_t stage,
+                                             uint64_t elapsed_us);
+
+/*!
+ * \brief Set the callback the stages of the license checks are reported to, on the thread
+ * performing the check. The time of a stage runs from the end of the previous one and so takes
+ * in the wait for the license server. It must be set before any license check is started.
+ *
+ * \param[in]  stage_cb   callback or NULL to stop reporting
+ */
+void ovsa_set_license_check_stage_cb(ovsa_license_check_stage_cb_t stage_cb);
+
+/*!
+ * \brief Get the asymmetric key slot of a keystore from the per-process keystore cache. The
+ * keystore is loaded on the first use and again whenever the file changes. The key slot is shared
+ * by all the callers and must be used read-only.
+ *
+ * \param[in]  keystore       keystore file path
+ * \param[out] asym_keyslot   asymmetric keyslot index
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_keystore_cache_get(const char* keystore, int* asym_keyslot);
+
+/*!
+ * \brief Drop a reference to a key slot returned by ovsa_keystore_cache_get().
+ *
+ * \param[in]  asym_keyslot   asymmetric keyslot index
+ */
+void ovsa_keystore_cache_put(int asym_keyslot);
+
+/*!
+ * \brief Release the key slots of all the keystores cached, before ovsa_crypto_deinit().
+ */
+void ovsa_keystore_cache_flush(void);
+
 /*!
  * \brief generate TCB signature files.
  *
@@ -265,6 +469,16 @@ ovsa_status_t ovsa_get_pcr_exclusion_set(char* pcr_exclusion, int* pcr_id_set);
  */
 ovsa_status_t ovsa_send_EK_AK_bind_info(const int asym_keyslot, void** _ssl_session);
 
+/*!
+ * \brief send_attestation_token with a quote over the nonce of the license server
+ * \param[in] token attestation token issued by the license server
+ * \param[in] quote_nonce quote nonce of the EK_AK_BIND request
+ * \param[in] _ssl_session ssl_session
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_send_attestation_token(const char* token, char* quote_nonce,
+                                          void** _ssl_session);
+
 /*!
  * \brief remove_quote_files
  * \Remove the quote file
@@ -17,12 +17,21 @@
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <openssl/rand.h>
 #include <openssl/ssl.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/debug.h"
@@ -31,6 +40,7 @@
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
 #include "runtime.h"
+#include "trace.h"
 #include "utils.h"
 
 #ifndef DISABLE_RA_TLS
@@ -45,79 +55,424 @@ extern ovsa_status_t ovsa_start_model_loader(
     ovsa_controlled_access_model_sig_t* controlled_access_model_sig,
     ovsa_model_file_list_t* decrypted_files);
 
-static mbedtls_ctr_drbg_context g_ctr_drbg;
-static mbedtls_entropy_context g_entropy;
-static mbedtls_ssl_config g_conf;
-static mbedtls_net_context g_verifier_fd;
-static mbedtls_ssl_context g_ssl;
+/*
+ * State of one TLS connection to a license server, so that license checks run concurrently. The
+ * SSL context comes first, the session handle passed around is a pointer to it.
+ */
+typedef struct ovsa_tls_session {
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_net_context verifier_fd;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_entropy_context entropy;
 #ifndef DISABLE_RA_TLS
-static mbedtls_pk_context g_my_ratls_key;
-static mbedtls_x509_crt g_my_ratls_cert;
+    mbedtls_pk_context my_ratls_key;
+    mbedtls_x509_crt my_ratls_cert;
 #endif
+    int cipher_suite[CIPHER_SUITE_SIZE];
+    mbedtls_ecp_group_id curve_list[CURVE_LIST_SIZE];
+    /* Messages are built and received in these, reused from one message to the next */
+    char* tx_buf;
+    size_t tx_buf_size;
+    char* rx_buf;
+    size_t rx_buf_size;
+    /* Messages are sent in the binary framing once the license server offered it */
+    bool binary_framing;
+    /* and carry the correlation ID of the tracing spans if it offered the record too */
+    bool trace_record;
+} ovsa_tls_session_t;
+
 static ovsa_status_t ovsa_license_service_close(void* ssl);
 ovsa_status_t ovsa_license_service_write(void* ssl, const char* buf, size_t len);
+ovsa_status_t ovsa_license_service_send_message(void* ssl, const ovsa_command_type_t cmd,
+                                                const char* payload);
+ovsa_status_t ovsa_license_service_extract_payload(const char* message, char** payload);
 static ovsa_status_t ovsa_license_service_read(void* ssl, uint8_t* buf, size_t len);
 static ovsa_status_t ovsa_license_service_start(const char* in_servers,
                                                 const char* in_ca_chain_path, void** out_ssl,
-                                                ovsa_customer_license_sig_t customer_lic_sig);
+                                                ovsa_customer_license_sig_t customer_lic_sig,
+                                                int sockfd);
 
 static const char* g_cipher_suitename[CIPHER_SUITE_SIZE] = {
     "TLS-ECDHE-ECDSA-WITH-AES-256-GCM-SHA384"};
-static int g_cipher_suite[CIPHER_SUITE_SIZE];
-static mbedtls_ecp_group_id g_curve_list[CURVE_LIST_SIZE];
 
-static ovsa_status_t ovsa_send_update_cust_lic_ACK(void** _ssl_session) {
-    ovsa_status_t ret    = OVSA_OK;
-    void* ssl_session    = NULL;
-    char* json_buf       = NULL;
-    char dummy_payload[] = "";
-    char* json_payload   = NULL;
-    size_t buf_len       = 0;
-    size_t length        = 0;
-    size_t payload_len   = 0;
+/*
+ * Fixed size table of the per-process caches below. Each entry starts with its key, a license
+ * server URL or a file name, and in_use tells the entries holding a key from the free ones. The
+ * callers hold the lock of their cache.
+ */
+typedef struct ovsa_keyed_cache {
+    void* entries;
+    size_t entry_size;
+    size_t entry_count;
+    size_t key_size;
+    bool (*in_use)(const void* entry);
+    size_t victim;
+} ovsa_keyed_cache_t;
+
+/* Static initializer of the cache of the entries in table, keyed by their key_member array */
+#define OVSA_KEYED_CACHE(table, key_member, in_use_cb)         \
+    {                                                          \
+        .entries     = (table),                                \
+        .entry_size  = sizeof((table)[0]),                     \
+        .entry_count = sizeof(table) / sizeof((table)[0]),     \
+        .key_size    = sizeof((table)[0].key_member),          \
+        .in_use      = (in_use_cb)                             \
+    }
+
+static void* ovsa_keyed_cache_at(const ovsa_keyed_cache_t* cache, size_t index) {
+    return (char*)cache->entries + index * cache->entry_size;
+}
 
-    ssl_session = *_ssl_session;
+static void* ovsa_keyed_cache_find(const ovsa_keyed_cache_t* cache, const char* key) {
+    void* entry   = NULL;
+    int indicator = -1;
+    size_t index  = 0;
 
-    OVSA_DBG(DBG_I, "OVSA:Entering %s\n", __func__);
+    for (index = 0; index < cache->entry_count; index++) {
+        entry = ovsa_keyed_cache_at(cache, index);
+        if (!cache->in_use(entry))
+            continue;
+        strcmp_s((const char*)entry, cache->key_size - 1, key, &indicator);
+        if (indicator == 0)
+            return entry;
+    }
+    return NULL;
+}
 
-    /* create json message blob */
-    ret = ovsa_json_create_message_blob(OVSA_SEND_UPDATE_CUST_LICENSE_ACK, dummy_payload, &json_buf,
-                                        &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(
-            DBG_E,
-            "OVSA: Error create update customer lickense ACK message failed with error code %d\n",
-            ret);
-        goto out;
+/* Returns the entry of the key, else a free entry or, when the cache is full, the next entry in
+ * round robin order. The caller releases what the entry holds before it stores the key. */
+static void* ovsa_keyed_cache_slot(ovsa_keyed_cache_t* cache, const char* key) {
+    void* entry  = ovsa_keyed_cache_find(cache, key);
+    size_t index = 0;
+
+    for (index = 0; (entry == NULL) && (index < cache->entry_count); index++) {
+        if (!cache->in_use(ovsa_keyed_cache_at(cache, index)))
+            entry = ovsa_keyed_cache_at(cache, index);
     }
-    /* Append payload length to json blob */
-    payload_len = length + PAYLOAD_LENGTH + 1;
-    ret         = ovsa_safe_malloc(sizeof(char) * payload_len, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
-        goto out;
+    if (entry == NULL) {
+        entry         = ovsa_keyed_cache_at(cache, cache->victim);
+        cache->victim = (cache->victim + 1) % cache->entry_count;
+    }
+    return entry;
+}
+
+/* Per-process cache of TLS sessions keyed by license server URL. The periodic license checks
+ * resume the cached session with an abbreviated handshake instead of a full one. */
+typedef struct ovsa_session_cache_entry {
+    char license_serv_url[MAX_URL_SIZE + 1];
+    mbedtls_ssl_session session;
+    bool valid;
+} ovsa_session_cache_entry_t;
+
+static bool ovsa_session_cache_in_use(const void* entry) {
+    return ((const ovsa_session_cache_entry_t*)entry)->valid;
+}
+
+static ovsa_session_cache_entry_t g_session_cache_entries[MAX_SESSION_CACHE_ENTRIES];
+static ovsa_keyed_cache_t g_session_cache =
+    OVSA_KEYED_CACHE(g_session_cache_entries, license_serv_url, ovsa_session_cache_in_use);
+static pthread_mutex_t g_session_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ovsa_session_cache_load(const char* license_serv_url, mbedtls_ssl_context* ssl) {
+    ovsa_session_cache_entry_t* entry = NULL;
+    ovsa_status_t ret                 = OVSA_OK;
+
+    if (pthread_mutex_lock(&g_session_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_find(&g_session_cache, license_serv_url);
+    if (entry != NULL) {
+        ret = mbedtls_ssl_set_session(ssl, &entry->session);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_I, "OVSA: mbedtls_ssl_set_session failed with code %d\n", ret);
+        } else {
+            OVSA_DBG(DBG_I, "OVSA:Resuming TLS session with license server '%s'\n",
+                     license_serv_url);
+        }
     }
-    ret = ovsa_append_json_payload_len_to_blob(json_buf, (char**)&json_payload);
+    pthread_mutex_unlock(&g_session_cache_lock);
+}
+
+static void ovsa_session_cache_store(const char* license_serv_url,
+                                     const mbedtls_ssl_context* ssl) {
+    ovsa_session_cache_entry_t* entry = NULL;
+    ovsa_status_t ret                 = OVSA_OK;
+
+    if (pthread_mutex_lock(&g_session_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_slot(&g_session_cache, license_serv_url);
+    mbedtls_ssl_session_free(&entry->session);
+    mbedtls_ssl_session_init(&entry->session);
+    entry->valid = false;
+
+    ret = mbedtls_ssl_get_session(ssl, &entry->session);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json blob creation failed with %d\n", ret);
-        goto out;
+        OVSA_DBG(DBG_I, "OVSA: mbedtls_ssl_get_session failed with code %d\n", ret);
+        mbedtls_ssl_session_free(&entry->session);
+    } else if (strcpy_s(entry->license_serv_url, sizeof(entry->license_serv_url),
+                        license_serv_url) == EOK) {
+        entry->valid = true;
+    }
+    pthread_mutex_unlock(&g_session_cache_lock);
+}
+
+static void ovsa_session_cache_remove(const char* license_serv_url) {
+    ovsa_session_cache_entry_t* entry = NULL;
+
+    if (pthread_mutex_lock(&g_session_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_find(&g_session_cache, license_serv_url);
+    if (entry != NULL) {
+        mbedtls_ssl_session_free(&entry->session);
+        entry->valid = false;
+    }
+    pthread_mutex_unlock(&g_session_cache_lock);
+}
+
+#ifndef ENABLE_SGX_GRAMINE
+/* Per-process cache of the attestation tokens issued by the license servers, keyed by license
+ * server URL. A token is presented in place of the EK/AK binding and TPM quote until it expires
+ * or the license server refuses it. */
+typedef struct ovsa_attestation_token_cache_entry {
+    char license_serv_url[MAX_URL_SIZE + 1];
+    char* token;
+    time_t expiry;
+} ovsa_attestation_token_cache_entry_t;
+
+static bool ovsa_attestation_token_cache_in_use(const void* entry) {
+    return ((const ovsa_attestation_token_cache_entry_t*)entry)->token != NULL;
+}
+
+static ovsa_attestation_token_cache_entry_t g_token_cache_entries[MAX_ATTESTATION_TOKEN_ENTRIES];
+static ovsa_keyed_cache_t g_token_cache = OVSA_KEYED_CACHE(
+    g_token_cache_entries, license_serv_url, ovsa_attestation_token_cache_in_use);
+static pthread_mutex_t g_token_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* The TPM quote and credential files are at fixed paths, the license checks running concurrently
+ * take turns to generate, send and remove them */
+static pthread_mutex_t g_tpm_quote_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static time_t ovsa_attestation_token_cache_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+/* Returns a copy of the unexpired token of the license server or NULL */
+static char* ovsa_attestation_token_cache_get(const char* license_serv_url) {
+    ovsa_attestation_token_cache_entry_t* entry = NULL;
+    char* token                                 = NULL;
+    size_t len                                  = 0;
+
+    if (pthread_mutex_lock(&g_token_cache_lock) != 0)
+        return NULL;
+    entry = ovsa_keyed_cache_find(&g_token_cache, license_serv_url);
+    if (entry != NULL) {
+        if (entry->expiry <= ovsa_attestation_token_cache_now()) {
+            ovsa_safe_free(&entry->token);
+        } else if ((ovsa_get_string_length(entry->token, &len) == OVSA_OK) &&
+                   (ovsa_safe_malloc(len + 1, &token) == OVSA_OK)) {
+            memcpy_s(token, len + 1, entry->token, len);
+        }
+    }
+    pthread_mutex_unlock(&g_token_cache_lock);
+    return token;
+}
+
+static void ovsa_attestation_token_cache_store(const char* license_serv_url, const char* token,
+                                               size_t validity) {
+    ovsa_attestation_token_cache_entry_t* entry = NULL;
+    size_t len                                  = 0;
+
+    if (ovsa_get_string_length(token, &len) < OVSA_OK)
+        return;
+    if (pthread_mutex_lock(&g_token_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_slot(&g_token_cache, license_serv_url);
+    ovsa_safe_free(&entry->token);
+    if ((strcpy_s(entry->license_serv_url, sizeof(entry->license_serv_url), license_serv_url) ==
+         EOK) &&
+        (ovsa_safe_malloc(len + 1, &entry->token) == OVSA_OK)) {
+        memcpy_s(entry->token, len + 1, token, len);
+        entry->expiry = ovsa_attestation_token_cache_now() + validity;
+    }
+    pthread_mutex_unlock(&g_token_cache_lock);
+}
+
+static void ovsa_attestation_token_cache_remove(const char* license_serv_url) {
+    ovsa_attestation_token_cache_entry_t* entry = NULL;
+
+    if (pthread_mutex_lock(&g_token_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_find(&g_token_cache, license_serv_url);
+    if (entry != NULL)
+        ovsa_safe_free(&entry->token);
+    pthread_mutex_unlock(&g_token_cache_lock);
+}
+#endif
+
+/* Per-process cache of the keystores loaded into asymmetric key slots, keyed by path and
+ * modification time. All models on a node share one keystore, so the license checks borrow the
+ * parsed keys of the cached key slot instead of loading the keystore file again. */
+typedef struct ovsa_keystore_cache_entry {
+    char keystore[MAX_FILE_NAME + 1];
+    struct timespec mtime;
+    off_t size;
+    ino_t ino;
+    int asym_keyslot;
+    unsigned int refcount;
+    /* Cleared once the keystore file changed, the key slot is then released with the last
+     * reference */
+    bool valid;
+} ovsa_keystore_cache_entry_t;
+
+static ovsa_keystore_cache_entry_t g_keystore_cache[MAX_KEYSTORE_CACHE_ENTRIES];
+static pthread_mutex_t g_keystore_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ovsa_keystore_cache_evict(ovsa_keystore_cache_entry_t* entry) {
+    ovsa_crypto_clear_asymmetric_key_slot(entry->asym_keyslot);
+    memset_s(entry, sizeof(ovsa_keystore_cache_entry_t), 0);
+}
+
+static bool ovsa_keystore_cache_match(const ovsa_keystore_cache_entry_t* entry,
+                                      const struct stat* keystore_stat) {
+    return ((entry->mtime.tv_sec == keystore_stat->st_mtim.tv_sec) &&
+            (entry->mtime.tv_nsec == keystore_stat->st_mtim.tv_nsec) &&
+            (entry->size == keystore_stat->st_size) && (entry->ino == keystore_stat->st_ino));
+}
+
+ovsa_status_t ovsa_keystore_cache_get(const char* keystore, int* asym_keyslot) {
+    ovsa_keystore_cache_entry_t* entry      = NULL;
+    ovsa_keystore_cache_entry_t* free_entry = NULL;
+    ovsa_status_t ret                       = OVSA_OK;
+    struct stat keystore_stat;
+    int indicator = -1;
+    size_t index  = 0;
+
+    if ((keystore == NULL) || (asym_keyslot == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error loading keystore failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    if (stat(keystore, &keystore_stat) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not stat keystore '%s'\n", keystore);
+        return OVSA_FILEOPEN_FAIL;
+    }
+    if (pthread_mutex_lock(&g_keystore_cache_lock) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not acquire mutex lock\n");
+        return OVSA_MUTEX_LOCK_FAIL;
+    }
+    for (index = 0; index < MAX_KEYSTORE_CACHE_ENTRIES; index++) {
+        if (!g_keystore_cache[index].valid)
+            continue;
+        strcmp_s(g_keystore_cache[index].keystore, MAX_FILE_NAME, keystore, &indicator);
+        if (indicator != 0)
+            continue;
+        if (ovsa_keystore_cache_match(&g_keystore_cache[index], &keystore_stat)) {
+            entry = &g_keystore_cache[index];
+            break;
+        }
+        /* Keystore file was replaced, load it again */
+        OVSA_DBG(DBG_I, "OVSA: Keystore '%s' changed, reloading it\n", keystore);
+        g_keystore_cache[index].valid = false;
+        if (g_keystore_cache[index].refcount == 0)
+            ovsa_keystore_cache_evict(&g_keystore_cache[index]);
+    }
+    if (entry != NULL) {
+        entry->refcount++;
+        *asym_keyslot = entry->asym_keyslot;
+        goto end;
+    }
+
+    for (index = 0; (free_entry == NULL) && (index < MAX_KEYSTORE_CACHE_ENTRIES); index++) {
+        if ((!g_keystore_cache[index].valid) && (g_keystore_cache[index].refcount == 0))
+            free_entry = &g_keystore_cache[index];
+    }
+    for (index = 0; (free_entry == NULL) && (index < MAX_KEYSTORE_CACHE_ENTRIES); index++) {
+        if (g_keystore_cache[index].refcount == 0) {
+            free_entry = &g_keystore_cache[index];
+            ovsa_keystore_cache_evict(free_entry);
+        }
     }
-    ret = ovsa_get_string_length((char*)json_payload, &buf_len);
+
+    ret = ovsa_crypto_load_asymmetric_key(keystore, asym_keyslot);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
+        OVSA_DBG(DBG_E, "OVSA: Error get keyslot failed with code %d\n", ret);
+        goto end;
+    }
+    /* Key slot is owned by the caller alone if the cache is full of keystores in use */
+    if ((free_entry != NULL) &&
+        (strcpy_s(free_entry->keystore, sizeof(free_entry->keystore), keystore) == EOK)) {
+        free_entry->mtime        = keystore_stat.st_mtim;
+        free_entry->size         = keystore_stat.st_size;
+        free_entry->ino          = keystore_stat.st_ino;
+        free_entry->asym_keyslot = *asym_keyslot;
+        free_entry->refcount     = 1;
+        free_entry->valid        = true;
+    }
+end:
+    pthread_mutex_unlock(&g_keystore_cache_lock);
+    return ret;
+}
+
+void ovsa_keystore_cache_put(int asym_keyslot) {
+    size_t index = 0;
+
+    if (asym_keyslot < MIN_KEY_SLOT)
+        return;
+    if (pthread_mutex_lock(&g_keystore_cache_lock) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not acquire mutex lock\n");
+        return;
+    }
+    for (index = 0; index < MAX_KEYSTORE_CACHE_ENTRIES; index++) {
+        if ((g_keystore_cache[index].refcount > 0) &&
+            (g_keystore_cache[index].asym_keyslot == asym_keyslot))
+            break;
+    }
+    if (index == MAX_KEYSTORE_CACHE_ENTRIES) {
+        /* Key slot was not cached */
+        ovsa_crypto_clear_asymmetric_key_slot(asym_keyslot);
+    } else if ((--g_keystore_cache[index].refcount == 0) && (!g_keystore_cache[index].valid)) {
+        ovsa_keystore_cache_evict(&g_keystore_cache[index]);
+    }
+    pthread_mutex_unlock(&g_keystore_cache_lock);
+}
+
+void ovsa_keystore_cache_flush(void) {
+    size_t index = 0;
+
+    if (pthread_mutex_lock(&g_keystore_cache_lock) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not acquire mutex lock\n");
+        return;
     }
+    for (index = 0; index < MAX_KEYSTORE_CACHE_ENTRIES; index++) {
+        if (!g_keystore_cache[index].valid)
+            continue;
+        /* Key slots still in use are released with the last reference */
+        g_keystore_cache[index].valid = false;
+        if (g_keystore_cache[index].refcount == 0)
+            ovsa_keystore_cache_evict(&g_keystore_cache[index]);
+    }
+    pthread_mutex_unlock(&g_keystore_cache_lock);
+}
+
+static ovsa_status_t ovsa_send_update_cust_lic_ACK(void** _ssl_session) {
+    ovsa_status_t ret    = OVSA_OK;
+    void* ssl_session    = NULL;
+    char dummy_payload[] = "";
+
+    ssl_session = *_ssl_session;
+
+    OVSA_DBG(DBG_I, "OVSA:Entering %s\n", __func__);
+
     /* Send UPDATE_CUST_LICENSE_ACK to Server */
-    ret = ovsa_license_service_write(ssl_session, (char*)json_payload, buf_len);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_UPDATE_CUST_LICENSE_ACK,
+                                            dummy_payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
         goto out;
     }
-    OVSA_DBG(DBG_I, "OVSA:Send UPDATE_CUST_LICENSE_ACK to server\n%s", json_payload);
+    OVSA_DBG(DBG_I, "OVSA:Send UPDATE_CUST_LICENSE_ACK to server\n");
 out:
-    ovsa_safe_free(&json_buf);
-    ovsa_safe_free(&json_payload);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -162,17 +517,49 @@ ovsa_command_type_t ovsa_get_command_type(const char* command) {
         cmd = OVSA_SEND_EK_AK_BIND;
     else if (!strcmp(command, "OVSA_SEND_QUOTE_NONCE"))
         cmd = OVSA_SEND_QUOTE_NONCE;
+    else if (!strcmp(command, "OVSA_SEND_ATTESTATION_TOKEN"))
+        cmd = OVSA_SEND_ATTESTATION_TOKEN;
 #endif
     else if (!strcmp(command, "OVSA_SEND_UPDATE_CUST_LICENSE"))
         cmd = OVSA_SEND_UPDATE_CUST_LICENSE;
     else if (!strcmp(command, "OVSA_SEND_LICENSE_CHECK_RESP"))
         cmd = OVSA_SEND_LICENSE_CHECK_RESP;
+    else if (!strcmp(command, "OVSA_SEND_LICENSE_CHECK_BATCH_RESP"))
+        cmd = OVSA_SEND_LICENSE_CHECK_BATCH_RESP;
+    else if (!strcmp(command, "OVSA_SEND_LICENSE_LEASE"))
+        cmd = OVSA_SEND_LICENSE_LEASE;
     else
         cmd = OVSA_INVALID_CMD;
 
     return cmd;
 }
 
+/* Name of a command the runtime sends, as the license server reads it */
+static const char* ovsa_get_command_name(const ovsa_command_type_t cmd) {
+    switch (cmd) {
+        case OVSA_SEND_SIGN_NONCE:
+            return "OVSA_SEND_SIGN_NONCE";
+        case OVSA_SEND_CUST_LICENSE:
+            return "OVSA_SEND_CUST_LICENSE";
+        case OVSA_SEND_CUST_LICENSE_BATCH:
+            return "OVSA_SEND_CUST_LICENSE_BATCH";
+        case OVSA_SEND_UPDATE_CUST_LICENSE_ACK:
+            return "OVSA_SEND_UPDATE_CUST_LICENSE_ACK";
+#ifndef ENABLE_SGX_GRAMINE
+        case OVSA_SEND_HW_QUOTE:
+            return "OVSA_SEND_HW_QUOTE";
+        case OVSA_SEND_QUOTE_INFO:
+            return "OVSA_SEND_QUOTE_INFO";
+        case OVSA_SEND_EK_AK_BIND_INFO:
+            return "OVSA_SEND_EK_AK_BIND_INFO";
+        case OVSA_SEND_ATTESTATION_TOKEN:
+            return "OVSA_SEND_ATTESTATION_TOKEN";
+#endif
+        default:
+            return NULL;
+    }
+}
+
 static void ovsa_mbedtls_debug_cb(void* ctx, int level, const char* file, int line,
                                   const char* str) {
     const char *p = NULL, *basename = NULL;
@@ -212,6 +599,201 @@ ovsa_status_t ovsa_license_service_write(void* ssl, const char* buf, size_t len)
     return (int)written;
 }
 
+/* Grows a message buffer of a session to at least size bytes, keeping the first used bytes */
+static ovsa_status_t ovsa_tls_session_reserve(char** buf, size_t* buf_size, size_t used,
+                                              size_t size) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t new_size   = (*buf_size > 0) ? *buf_size : LICENSE_SERVICE_MSG_BUF_SIZE;
+    char* new_buf     = NULL;
+
+    if ((*buf != NULL) && (size <= *buf_size))
+        return OVSA_OK;
+    while (new_size < size)
+        new_size *= 2;
+    ret = ovsa_safe_malloc(new_size, &new_buf);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error message buffer allocation failed with code %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    if (*buf != NULL) {
+        memcpy_s(new_buf, new_size, *buf, used);
+        memset_s(*buf, *buf_size, 0);
+        free(*buf);
+    }
+    *buf      = new_buf;
+    *buf_size = new_size;
+    return OVSA_OK;
+}
+
+/* Writes a record of the binary framing, returns its size */
+static size_t ovsa_tlv_put_record(char* buf, const uint8_t type, const char* value,
+                                  const size_t len) {
+    buf[0] = (char)type;
+    buf[1] = (char)((len >> 24) & 0xFF);
+    buf[2] = (char)((len >> 16) & 0xFF);
+    buf[3] = (char)((len >> 8) & 0xFF);
+    buf[4] = (char)(len & 0xFF);
+    memcpy_s(buf + OVSA_TLV_RECORD_HEADER_SIZE, len, value, len);
+    return OVSA_TLV_RECORD_HEADER_SIZE + len;
+}
+
+/*
+ * Splits a message in the binary framing into its command and payload records. The records must
+ * lie within size bytes of the message; the end of the payload record is returned in end.
+ */
+static ovsa_status_t ovsa_tlv_split(const char* message, const size_t size, const char** command,
+                                    size_t* command_len, const char** payload, size_t* payload_len,
+                                    size_t* end) {
+    const unsigned char* buf = (const unsigned char*)message;
+    const uint8_t types[]    = {OVSA_TLV_TYPE_COMMAND, OVSA_TLV_TYPE_PAYLOAD};
+    const char** values[]    = {command, payload};
+    size_t* lens[]           = {command_len, payload_len};
+    size_t offset            = 1;
+    size_t len               = 0;
+    int index                = 0;
+
+    if ((size < 1) || (buf[0] != OVSA_TLV_MAGIC))
+        return OVSA_INVALID_PARAMETER;
+    for (index = 0; index < 2; index++) {
+        if ((size - offset < OVSA_TLV_RECORD_HEADER_SIZE) || (buf[offset] != types[index]))
+            return OVSA_INVALID_PARAMETER;
+        len = ((size_t)buf[offset + 1] << 24) | ((size_t)buf[offset + 2] << 16) |
+              ((size_t)buf[offset + 3] << 8) | (size_t)buf[offset + 4];
+        offset += OVSA_TLV_RECORD_HEADER_SIZE;
+        if (len > size - offset)
+            return OVSA_INVALID_PARAMETER;
+        *values[index] = message + offset;
+        *lens[index]   = len;
+        offset += len;
+    }
+    *end = offset;
+    return OVSA_OK;
+}
+
+/*
+ * Sends messages to the license server, each prefixed with its length, in a single write. The
+ * messages are laid out in the transmit buffer of the session, as JSON message blobs or in the
+ * binary framing when the license server offered it.
+ */
+static ovsa_status_t ovsa_license_service_send_messages(void* ssl, const ovsa_command_type_t* cmds,
+                                                        const char* const* payloads,
+                                                        size_t count) {
+    ovsa_tls_session_t* session = (ovsa_tls_session_t*)ssl;
+    ovsa_status_t ret           = OVSA_OK;
+    const char* name            = NULL;
+    const char* trace_id        = NULL;
+    char* json_buf              = NULL;
+    size_t offset               = 0;
+    size_t index                = 0;
+    size_t name_len             = 0;
+    size_t payload_len          = 0;
+    size_t trace_id_len         = 0;
+    size_t len                  = 0;
+
+    if ((session == NULL) || (cmds == NULL) || (payloads == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid Input parameter \n");
+        return OVSA_INVALID_PARAMETER;
+    }
+#ifdef ENABLE_TRACE
+    if (session->binary_framing && session->trace_record) {
+        trace_id     = ovsa_trace_get_correlation_id();
+        trace_id_len = strnlen_s(trace_id, OVSA_TRACE_ID_SIZE + 1);
+    }
+#endif
+    for (index = 0; index < count; index++) {
+        if (session->binary_framing) {
+            name = ovsa_get_command_name(cmds[index]);
+            if ((name == NULL) ||
+                (ovsa_get_string_length(payloads[index], &payload_len) < OVSA_OK)) {
+                OVSA_DBG(DBG_E, "OVSA: Error invalid message command %d\n", cmds[index]);
+                ret = OVSA_INVALID_PARAMETER;
+                goto out;
+            }
+            name_len = strnlen_s(name, MAX_COMMAND_TYPE_LENGTH);
+            len      = 1 + (2 * OVSA_TLV_RECORD_HEADER_SIZE) + name_len + payload_len;
+            if (trace_id_len > 0)
+                len += OVSA_TLV_RECORD_HEADER_SIZE + trace_id_len;
+        } else {
+            ret = ovsa_json_create_message_blob(cmds[index], payloads[index], &json_buf, &len);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error create message failed with error code %d\n", ret);
+                goto out;
+            }
+            ret = ovsa_get_string_length(json_buf, &len);
+            if (ret < OVSA_OK)
+                goto out;
+        }
+        if (len > LICENSE_SERVICE_MAX_MSG_SIZE) {
+            OVSA_DBG(DBG_E, "OVSA: Error invalid message length\n");
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
+        /* Room for the NUL written after the length prefix */
+        ret = ovsa_tls_session_reserve(&session->tx_buf, &session->tx_buf_size, offset,
+                                       offset + PAYLOAD_LENGTH + len + 1);
+        if (ret < OVSA_OK)
+            goto out;
+        snprintf(session->tx_buf + offset, PAYLOAD_LENGTH + 1, "%08zu", len);
+        offset += PAYLOAD_LENGTH;
+        if (session->binary_framing) {
+            session->tx_buf[offset++] = (char)OVSA_TLV_MAGIC;
+            offset += ovsa_tlv_put_record(session->tx_buf + offset, OVSA_TLV_TYPE_COMMAND, name,
+                                          name_len);
+            offset += ovsa_tlv_put_record(session->tx_buf + offset, OVSA_TLV_TYPE_PAYLOAD,
+                                          payloads[index], payload_len);
+            if (trace_id_len > 0)
+                offset += ovsa_tlv_put_record(session->tx_buf + offset, OVSA_TLV_TYPE_TRACE_ID,
+                                              trace_id, trace_id_len);
+        } else {
+            memcpy_s(session->tx_buf + offset, session->tx_buf_size - offset, json_buf, len);
+            offset += len;
+            ovsa_safe_free(&json_buf);
+        }
+    }
+    ret = ovsa_license_service_write(ssl, session->tx_buf, offset);
+out:
+    ovsa_safe_free(&json_buf);
+    if (offset > 0)
+        memset_s(session->tx_buf, offset, 0);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_service_send_message(void* ssl, const ovsa_command_type_t cmd,
+                                                const char* payload) {
+    return ovsa_license_service_send_messages(ssl, &cmd, &payload, 1);
+}
+
+/*
+ * Extracts the payload of a message read with ovsa_license_service_read_command(), which checked
+ * the records of a message in the binary framing.
+ */
+ovsa_status_t ovsa_license_service_extract_payload(const char* message, char** payload) {
+    ovsa_status_t ret   = OVSA_OK;
+    const char* command = NULL;
+    const char* value   = NULL;
+    size_t command_len  = 0;
+    size_t len          = 0;
+    size_t end          = 0;
+
+    if ((message == NULL) || (payload == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid Input parameter \n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    if ((unsigned char)message[0] != OVSA_TLV_MAGIC)
+        return ovsa_json_extract_element(message, "payload", payload);
+
+    ret = ovsa_tlv_split(message, SIZE_MAX, &command, &command_len, &value, &len, &end);
+    if (ret < OVSA_OK)
+        return ret;
+    ret = ovsa_safe_malloc(len + 1, payload);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error payload allocation failed with code %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    memcpy_s(*payload, len + 1, value, len);
+    return OVSA_OK;
+}
+
 static ovsa_status_t ovsa_license_service_read(void* ssl, uint8_t* buf, size_t len) {
     ovsa_status_t ret         = OVSA_OK;
     mbedtls_ssl_context* _ssl = (mbedtls_ssl_context*)ssl;
@@ -241,6 +823,29 @@ static ovsa_status_t ovsa_license_service_read(void* ssl, uint8_t* buf, size_t l
     return (int)read;
 }
 
+static void ovsa_tls_session_free(ovsa_tls_session_t* session) {
+    if (session == NULL)
+        return;
+    mbedtls_ssl_free(&session->ssl);
+    mbedtls_ssl_config_free(&session->conf);
+    mbedtls_net_free(&session->verifier_fd);
+    mbedtls_ctr_drbg_free(&session->ctr_drbg);
+    mbedtls_entropy_free(&session->entropy);
+#ifndef DISABLE_RA_TLS
+    mbedtls_pk_free(&session->my_ratls_key);
+    mbedtls_x509_crt_free(&session->my_ratls_cert);
+#endif
+    if (session->tx_buf != NULL) {
+        memset_s(session->tx_buf, session->tx_buf_size, 0);
+        free(session->tx_buf);
+    }
+    if (session->rx_buf != NULL) {
+        memset_s(session->rx_buf, session->rx_buf_size, 0);
+        free(session->rx_buf);
+    }
+    free(session);
+}
+
 static ovsa_status_t ovsa_license_service_close(void* ssl) {
     mbedtls_ssl_context* _ssl = (mbedtls_ssl_context*)ssl;
     ovsa_status_t ret         = OVSA_OK;
@@ -254,20 +859,21 @@ static ovsa_status_t ovsa_license_service_close(void* ssl) {
             continue;
         }
         if (ret < OVSA_OK) {
-            mbedtls_ssl_free(&g_ssl);
-            mbedtls_ssl_config_free(&g_conf);
+            ovsa_tls_session_free((ovsa_tls_session_t*)ssl);
             /* use well-known error code for a typical case when remote party closes connection */
             return ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ? -ECONNRESET : ret;
         }
     }
-    mbedtls_ssl_free(&g_ssl);
-    mbedtls_ssl_config_free(&g_conf);
+    ovsa_tls_session_free((ovsa_tls_session_t*)ssl);
     return ret;
 }
 
+/* Connects to the first reachable server of in_servers, or uses sockfd if it is connected
+ * already, and sets up the TLS session. sockfd is owned by the session from then on. */
 static ovsa_status_t ovsa_license_service_start(const char* in_servers,
                                                 const char* in_ca_chain_path, void** out_ssl,
-                                                ovsa_customer_license_sig_t customer_lic_sig) {
+                                                ovsa_customer_license_sig_t customer_lic_sig,
+                                                int sockfd) {
     ovsa_status_t ret    = OVSA_OK;
     char* servers        = NULL;
     char* connected_addr = NULL;
@@ -281,30 +887,40 @@ static ovsa_status_t ovsa_license_service_start(const char* in_servers,
     X509* d2i_xcert                 = NULL;
     int peer_cert_slot              = -1;
     int index                       = 0;
+    ovsa_tls_session_t* session     = NULL;
+    OVSA_TRACE_SPAN(span);
 
     OVSA_DBG(DBG_I, "OVSA:Entering %s\n", __func__);
 
-    mbedtls_ctr_drbg_init(&g_ctr_drbg);
-    mbedtls_entropy_init(&g_entropy);
-#ifndef DISABLE_RA_TLS
-
-    mbedtls_pk_init(&g_my_ratls_key);
-    mbedtls_x509_crt_init(&g_my_ratls_cert);
-#endif
-    mbedtls_net_init(&g_verifier_fd);
-    mbedtls_ssl_config_init(&g_conf);
-    mbedtls_ssl_init(&g_ssl);
-
     if (out_ssl == NULL) {
         OVSA_DBG(DBG_E, "OVSA: Error invalid input to start license service\n");
-        ret = OVSA_INVALID_PARAMETER;
-        goto out;
+        if (sockfd >= 0)
+            close(sockfd);
+        return OVSA_INVALID_PARAMETER;
+    }
+    *out_ssl = NULL;
+    ret      = ovsa_safe_malloc(sizeof(ovsa_tls_session_t), (char**)&session);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error TLS session memory failed with code %d\n", ret);
+        if (sockfd >= 0)
+            close(sockfd);
+        return OVSA_MEMORY_ALLOC_FAIL;
     }
+    mbedtls_ctr_drbg_init(&session->ctr_drbg);
+    mbedtls_entropy_init(&session->entropy);
+#ifndef DISABLE_RA_TLS
+
+    mbedtls_pk_init(&session->my_ratls_key);
+    mbedtls_x509_crt_init(&session->my_ratls_cert);
+#endif
+    mbedtls_net_init(&session->verifier_fd);
+    mbedtls_ssl_config_init(&session->conf);
+    mbedtls_ssl_init(&session->ssl);
 
     OVSA_DBG(DBG_D, "OVSA:calling mbedtls_ctr_drbg_seed\n");
     const char pers[] = "ovsa-license-check";
-    ret = mbedtls_ctr_drbg_seed(&g_ctr_drbg, mbedtls_entropy_func, &g_entropy, (const uint8_t*)pers,
-                                sizeof(pers));
+    ret = mbedtls_ctr_drbg_seed(&session->ctr_drbg, mbedtls_entropy_func, &session->entropy,
+                                (const uint8_t*)pers, sizeof(pers));
     if (ret < 0) {
         OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ctr_drbg_seed failed with error code %d \n", ret);
         goto out;
@@ -334,8 +950,14 @@ static ovsa_status_t ovsa_license_service_start(const char* in_servers,
         if (!connected_port)
             continue;
 
+        if (sockfd >= 0) {
+            session->verifier_fd.fd = sockfd;
+            sockfd                  = -1;
+            ret                     = 0;
+            break;
+        }
         OVSA_DBG(DBG_D, "OVSA:calling mbedtls_net_connect\n");
-        ret = mbedtls_net_connect(&g_verifier_fd, connected_addr, connected_port,
+        ret = mbedtls_net_connect(&session->verifier_fd, connected_addr, connected_port,
                                   MBEDTLS_NET_PROTO_TCP);
         if (!ret)
             break;
@@ -347,8 +969,8 @@ static ovsa_status_t ovsa_license_service_start(const char* in_servers,
     }
 
     OVSA_DBG(DBG_D, "OVSA:calling mbedtls_ssl_config_defaults\n");
-    ret = mbedtls_ssl_config_defaults(&g_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
-                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    ret = mbedtls_ssl_config_defaults(&session->conf, MBEDTLS_SSL_IS_CLIENT,
+                                      MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_config_defaults returned error with code %d\n",
                  ret);
@@ -356,67 +978,74 @@ static ovsa_status_t ovsa_license_service_start(const char* in_servers,
     }
 
     /* Add supported Cipher Suites */
-    memset_s(g_cipher_suite, CIPHER_SUITE_SIZE, 0);
-    memset_s(g_curve_list, CURVE_LIST_SIZE, 0);
+    memset_s(session->cipher_suite, CIPHER_SUITE_SIZE, 0);
+    memset_s(session->curve_list, CURVE_LIST_SIZE, 0);
 
     for (index = 0; index < CIPHER_SUITE_SIZE; index++) {
-        g_cipher_suite[index] = mbedtls_ssl_get_ciphersuite_id(g_cipher_suitename[index]);
+        session->cipher_suite[index] =
+            mbedtls_ssl_get_ciphersuite_id(g_cipher_suitename[index]);
     }
 
-    g_curve_list[0] = MBEDTLS_ECP_DP_SECP521R1;
-    g_curve_list[1] = MBEDTLS_ECP_DP_NONE;
+    session->curve_list[0] = MBEDTLS_ECP_DP_SECP521R1;
+    session->curve_list[1] = MBEDTLS_ECP_DP_NONE;
 
-    mbedtls_ssl_conf_curves(&g_conf, g_curve_list);
-    mbedtls_ssl_conf_ciphersuites(&g_conf, g_cipher_suite);
+    mbedtls_ssl_conf_curves(&session->conf, session->curve_list);
+    mbedtls_ssl_conf_ciphersuites(&session->conf, session->cipher_suite);
     /* setting the peer certificate verification as optional since the peer certificate
      * will be verified using OVSA library api which does the OCSP check as well. */
-    mbedtls_ssl_conf_authmode(&g_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
-    mbedtls_ssl_conf_rng(&g_conf, mbedtls_ctr_drbg_random, &g_ctr_drbg);
+    mbedtls_ssl_conf_authmode(&session->conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_rng(&session->conf, mbedtls_ctr_drbg_random, &session->ctr_drbg);
+    mbedtls_ssl_conf_session_tickets(&session->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
 #ifndef DISABLE_RA_TLS
     OVSA_DBG(DBG_D, "OVSA:calling ratls_create_key_and_crt\n");
-    ret = ra_tls_create_key_and_crt(&g_my_ratls_key, &g_my_ratls_cert);
+    ret = ra_tls_create_key_and_crt(&session->my_ratls_key, &session->my_ratls_cert);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "Error:ratls_create_key_and_crt failed with error code %d \n", ret);
         goto out;
     }
-    ret = mbedtls_ssl_conf_own_cert(&g_conf, &g_my_ratls_cert, &g_my_ratls_key);
+    ret = mbedtls_ssl_conf_own_cert(&session->conf, &session->my_ratls_cert,
+                                    &session->my_ratls_key);
     if (ret < OVSA_OK) {
         goto out;
     }
 #endif
     /* mbedtls debug */
-    mbedtls_ssl_conf_dbg(&g_conf, ovsa_mbedtls_debug_cb, NULL);
+    mbedtls_ssl_conf_dbg(&session->conf, ovsa_mbedtls_debug_cb, NULL);
     mbedtls_debug_set_threshold(MBEDTLS_DEBUG_LEVEL);
 
-    ret = mbedtls_ssl_setup(&g_ssl, &g_conf);
+    ret = mbedtls_ssl_setup(&session->ssl, &session->conf);
     if (ret < OVSA_OK) {
         goto out;
     }
 
-    ret = mbedtls_ssl_set_hostname(&g_ssl, connected_addr);
+    ret = mbedtls_ssl_set_hostname(&session->ssl, connected_addr);
     if (ret < OVSA_OK) {
         goto out;
     }
+    ovsa_session_cache_load(in_servers, &session->ssl);
 
     OVSA_DBG(DBG_D, "OVSA:calling mbedtls_ssl_set_bio\n");
-    mbedtls_ssl_conf_read_timeout(&g_conf, READ_TIMEOUT_MS);
-    mbedtls_ssl_set_bio(&g_ssl, &g_verifier_fd, mbedtls_net_send, mbedtls_net_recv,
-                        mbedtls_net_recv_timeout);
+    mbedtls_ssl_conf_read_timeout(&session->conf, READ_TIMEOUT_MS);
+    mbedtls_ssl_set_bio(&session->ssl, &session->verifier_fd, mbedtls_net_send,
+                        mbedtls_net_recv, mbedtls_net_recv_timeout);
 
     ret = -1;
+    OVSA_TRACE_BEGIN(span, "tls_handshake");
     while (ret < OVSA_OK) {
-        ret = mbedtls_ssl_handshake(&g_ssl);
+        ret = mbedtls_ssl_handshake(&session->ssl);
         if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
             continue;
         }
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_handshake failed with error %d\n", ret);
+            OVSA_TRACE_END(span);
             goto out;
         }
     }
+    OVSA_TRACE_END(span);
 
     /* Extract the peer certificate from ssl context and perform the certificate validation */
-    g_server_cert = (mbedtls_x509_crt*)mbedtls_ssl_get_peer_cert(&g_ssl);
+    g_server_cert = (mbedtls_x509_crt*)mbedtls_ssl_get_peer_cert(&session->ssl);
     if (g_server_cert == NULL) {
         ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;
         OVSA_DBG(DBG_E, "OVSA: Error mbedtls_ssl_get_peer_cert failed with error %d\n", ret);
@@ -486,16 +1115,28 @@ static ovsa_status_t ovsa_license_service_start(const char* in_servers,
         OVSA_DBG(DBG_E, "OVSA: Error validate peer certificate hash failed with code %d\n", ret);
         goto out;
     }
-    /* Verify the peer certificate */
+    /* Verify the peer certificate, the OCSP check included */
+    OVSA_TRACE_BEGIN(span, "server_cert_verify");
     ret = ovsa_crypto_extract_pubkey_verify_cert(
         /* PEER CERT */ true, issuer_dup, /* lifetime_validity_check */ true, &peer_cert_slot);
+    OVSA_TRACE_END(span);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error verifying server certificate failed with code %d\n", ret);
         goto out;
     }
-    *out_ssl = &g_ssl;
+    /* Only sessions with a validated license server are cached for resumption */
+    ovsa_session_cache_store(in_servers, &session->ssl);
+    *out_ssl = &session->ssl;
 
 out:
+    if ((ret < OVSA_OK) && (in_servers != NULL)) {
+        ovsa_session_cache_remove(in_servers);
+    }
+    if (ret < OVSA_OK) {
+        /* The peer certificate is freed along with the session */
+        g_server_cert = NULL;
+        ovsa_tls_session_free(session);
+    }
     mbedtls_x509_crt_free(g_server_cert);
     BIO_free_all(issuer_cert_bio);
     BIO_free_all(issuer_cert_mem);
@@ -506,10 +1147,87 @@ out:
         ovsa_crypto_clear_asymmetric_key_slot(peer_cert_slot);
     }
     ovsa_safe_free(&servers);
+    if (sockfd >= 0)
+        close(sockfd);
     OVSA_DBG(DBG_I, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
+static bool ovsa_is_controlled_access_model_bin(FILE* fcontrol_access_model) {
+    char magic[CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN];
+    int indicator = -1;
+
+    if (fread(magic, 1, sizeof(magic), fcontrol_access_model) != sizeof(magic)) {
+        rewind(fcontrol_access_model);
+        return false;
+    }
+    rewind(fcontrol_access_model);
+    memcmp_s(magic, sizeof(magic), CONTROLLED_ACCESS_MODEL_BIN_MAGIC,
+             CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN, &indicator);
+    return (indicator == 0);
+}
+
+static ovsa_status_t ovsa_map_controlled_access_model(
+    FILE* fcontrol_access_model, ovsa_controlled_access_model_sig_t* controlled_access_model_sig,
+    char** header_buf, size_t* header_buf_len) {
+    ovsa_status_t ret        = OVSA_OK;
+    unsigned char* model_map = NULL;
+    size_t model_map_len     = 0;
+    size_t header_len        = 0;
+    int i                    = 0;
+    struct stat file_stat;
+
+    if ((fstat(fileno(fcontrol_access_model), &file_stat) != 0) ||
+        (file_stat.st_size <= CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN)) {
+        OVSA_DBG(DBG_E, "OVSA: Error get size of binary controlled access model failed\n");
+        return OVSA_FILEIO_FAIL;
+    }
+    model_map_len = (size_t)file_stat.st_size;
+
+    /* The segments are decrypted from the mapping, they are never read into the heap */
+    model_map = (unsigned char*)mmap(NULL, model_map_len, PROT_READ, MAP_PRIVATE,
+                                     fileno(fcontrol_access_model), 0);
+    if (model_map == MAP_FAILED) {
+        OVSA_DBG(DBG_E, "OVSA: Error mapping binary controlled access model failed\n");
+        return OVSA_FILEIO_FAIL;
+    }
+    (void)madvise(model_map, model_map_len, MADV_SEQUENTIAL);
+
+    for (i = 0; i < CONTROLLED_ACCESS_MODEL_BIN_LEN_SIZE; i++) {
+        header_len = (header_len << 8) | model_map[CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN + i];
+    }
+    if ((header_len == 0) ||
+        (header_len > model_map_len - CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN)) {
+        OVSA_DBG(DBG_E, "OVSA: Error binary controlled access model header length invalid\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+
+    /* Only the signed JSON header is copied, null terminated for the JSON parser */
+    ret = ovsa_safe_malloc(header_len + 1, header_buf);
+    if (ret < OVSA_OK) {
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error init memory failed with code %d\n", ret);
+        goto out;
+    }
+    memcpy_s(*header_buf, header_len + 1, model_map + CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN,
+             header_len);
+    (*header_buf)[header_len] = '\0';
+    *header_buf_len           = header_len + 1;
+
+    controlled_access_model_sig->controlled_access_model.enc_model_map     = (char*)model_map;
+    controlled_access_model_sig->controlled_access_model.enc_model_map_len = model_map_len;
+    controlled_access_model_sig->controlled_access_model.enc_model_segments_offset =
+        CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN + header_len;
+    model_map = NULL;
+
+out:
+    if (model_map != NULL) {
+        munmap(model_map, model_map_len);
+    }
+    return ret;
+}
+
 ovsa_status_t ovsa_validate_controlled_access_model(
     const int peer_keyslot, const char* cust_lic_sig_buf, const char* controlled_access_model,
     ovsa_controlled_access_model_sig_t* controlled_access_model_sig) {
@@ -538,31 +1256,48 @@ ovsa_status_t ovsa_validate_controlled_access_model(
                      "OVSA: Error opening controlled access model file failed with code %d\n", ret);
             goto out;
         }
-        ret = ovsa_crypto_get_file_size(fcontrol_access_model, &control_access_model_file_size);
-        if (ret < OVSA_OK || control_access_model_file_size == 0) {
-            OVSA_DBG(DBG_E, "OVSA: Error get file size failed for %s with code %d\n",
-                     controlled_access_model, ret);
-            fclose(fcontrol_access_model);
-            goto out;
-        }
-        ret = ovsa_safe_malloc(control_access_model_file_size * sizeof(char),
-                               &control_access_model_sig_buf);
-        if (ret < OVSA_OK) {
-            ret = OVSA_MEMORY_ALLOC_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error init memory failed with code %d\n", ret);
+        if (ovsa_is_controlled_access_model_bin(fcontrol_access_model)) {
+            /* Binary container, the signed JSON header is validated like the JSON format */
+            ret = ovsa_map_controlled_access_model(fcontrol_access_model,
+                                                   controlled_access_model_sig,
+                                                   &control_access_model_sig_buf,
+                                                   &control_access_model_file_size);
             fclose(fcontrol_access_model);
-            goto out;
-        }
-        if (!fread(control_access_model_sig_buf, 1, control_access_model_file_size,
-                   fcontrol_access_model)) {
-            ret = OVSA_FILEIO_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error read controlled access model file failed with code %d\n",
-                     ret);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error map binary controlled access model failed with code %d\n",
+                         ret);
+                goto out;
+            }
+        } else {
+            ret = ovsa_crypto_get_file_size(fcontrol_access_model,
+                                            &control_access_model_file_size);
+            if (ret < OVSA_OK || control_access_model_file_size == 0) {
+                OVSA_DBG(DBG_E, "OVSA: Error get file size failed for %s with code %d\n",
+                         controlled_access_model, ret);
+                fclose(fcontrol_access_model);
+                goto out;
+            }
+            ret = ovsa_safe_malloc(control_access_model_file_size * sizeof(char),
+                                   &control_access_model_sig_buf);
+            if (ret < OVSA_OK) {
+                ret = OVSA_MEMORY_ALLOC_FAIL;
+                OVSA_DBG(DBG_E, "OVSA: Error init memory failed with code %d\n", ret);
+                fclose(fcontrol_access_model);
+                goto out;
+            }
+            if (!fread(control_access_model_sig_buf, 1, control_access_model_file_size,
+                       fcontrol_access_model)) {
+                ret = OVSA_FILEIO_FAIL;
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error read controlled access model file failed with code %d\n",
+                         ret);
+                fclose(fcontrol_access_model);
+                goto out;
+            }
+            control_access_model_sig_buf[control_access_model_file_size - 1] = '\0';
             fclose(fcontrol_access_model);
-            goto out;
         }
-        control_access_model_sig_buf[control_access_model_file_size - 1] = '\0';
-        fclose(fcontrol_access_model);
         /* Extract controlled access model json blob */
         ret = ovsa_json_extract_controlled_access_model(control_access_model_sig_buf,
                                                         controlled_access_model_sig);
@@ -642,62 +1377,174 @@ out:
     return ret;
 }
 
-ovsa_status_t ovsa_validate_customer_license(const char* customer_license, const int asym_keyslot,
-                                             char** cust_lic_buff) {
+static ovsa_status_t ovsa_read_customer_license(const char* customer_license,
+                                                char** cust_lic_sig_buf, size_t* cust_lic_size) {
     ovsa_status_t ret         = OVSA_OK;
     size_t cust_lic_file_size = 0;
-    size_t peer_certlen       = 0;
-    int peer_keyslot          = -1;
-    int shared_key_slot       = -1;
-    int keyiv_hmac_slot       = -1;
-    char* cust_lic_buf        = NULL;
-    char* peer_cert           = NULL;
-    char* encryption_key      = NULL;
-    char* cust_lic_sig_buf    = NULL;
-
-    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
-    if (customer_license != NULL) {
-        /* Load customer license Artifact */
-        FILE* fcust_lic = fopen(customer_license, "r");
-        if (fcust_lic == NULL) {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error opening customer license file failed with code %d\n", ret);
-            goto out;
-        }
-        ret = ovsa_crypto_get_file_size(fcust_lic, &cust_lic_file_size);
-        if (ret < OVSA_OK || cust_lic_file_size == 0) {
-            OVSA_DBG(DBG_E, "OVSA: Error get file size failed for %s with code %d\n",
-                     customer_license, ret);
-            fclose(fcust_lic);
-            goto out;
-        }
-        ret = ovsa_safe_malloc(cust_lic_file_size * sizeof(char), &cust_lic_sig_buf);
-        if (ret < OVSA_OK) {
-            ret = OVSA_MEMORY_ALLOC_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error init memory failed with code %d\n", ret);
-            fclose(fcust_lic);
-            goto out;
-        }
-        if (!fread(cust_lic_sig_buf, 1, cust_lic_file_size, fcust_lic)) {
-            ret = OVSA_FILEIO_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error read customer license file failed with code %d\n", ret);
-            ovsa_safe_free(&cust_lic_sig_buf);
-            fclose(fcust_lic);
-            goto out;
-        }
-        cust_lic_sig_buf[cust_lic_file_size - 1] = '\0';
-        *cust_lic_buff                           = cust_lic_sig_buf;
-        fclose(fcust_lic);
-
-        /* Extract encryption_key from customer license */
-        ret = ovsa_json_extract_element(cust_lic_sig_buf, "isv_certificate", &peer_cert);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error extract json element failed with error code %d\n", ret);
-            goto out;
-        }
+    FILE* fcust_lic           = NULL;
 
-        OVSA_DBG(DBG_I, "OVSA: Verify PEER certificate\n");
-        /* Verifying customer license ISV Certificate */
+    /* Load customer license Artifact */
+    fcust_lic = fopen(customer_license, "r");
+    if (fcust_lic == NULL) {
+        ret = OVSA_FILEOPEN_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error opening customer license file failed with code %d\n", ret);
+        return ret;
+    }
+    ret = ovsa_crypto_get_file_size(fcust_lic, &cust_lic_file_size);
+    if (ret < OVSA_OK || cust_lic_file_size == 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error get file size failed for %s with code %d\n",
+                 customer_license, ret);
+        goto out;
+    }
+    ret = ovsa_safe_malloc(cust_lic_file_size * sizeof(char), cust_lic_sig_buf);
+    if (ret < OVSA_OK) {
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error init memory failed with code %d\n", ret);
+        goto out;
+    }
+    if (!fread(*cust_lic_sig_buf, 1, cust_lic_file_size, fcust_lic)) {
+        ret = OVSA_FILEIO_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error read customer license file failed with code %d\n", ret);
+        ovsa_safe_free(cust_lic_sig_buf);
+        goto out;
+    }
+    (*cust_lic_sig_buf)[cust_lic_file_size - 1] = '\0';
+    *cust_lic_size                              = cust_lic_file_size;
+out:
+    fclose(fcust_lic);
+    return ret;
+}
+
+/*
+ * Per-process cache of the verified customer licenses, keyed by customer license file. The
+ * periodic license checks only need the license server URLs and certificate hashes from the
+ * license, so they reuse the verified content as long as the license file holds the same bytes.
+ * Entries expire with the ISV certificate and after VERIFIED_LICENSE_CACHE_VALIDITY, so that a
+ * renewed certificate check still happens from time to time.
+ */
+typedef struct ovsa_verified_license_cache_entry {
+    char customer_license[MAX_FILE_NAME + 1];
+    int asym_keyslot;
+    char* cust_lic_sig_buf;
+    size_t cust_lic_size;
+    time_t expiry;
+} ovsa_verified_license_cache_entry_t;
+
+static bool ovsa_verified_license_cache_in_use(const void* entry) {
+    return ((const ovsa_verified_license_cache_entry_t*)entry)->cust_lic_sig_buf != NULL;
+}
+
+static ovsa_verified_license_cache_entry_t
+    g_verified_license_cache_entries[MAX_VERIFIED_LICENSE_ENTRIES];
+static ovsa_keyed_cache_t g_verified_license_cache = OVSA_KEYED_CACHE(
+    g_verified_license_cache_entries, customer_license, ovsa_verified_license_cache_in_use);
+static pthread_mutex_t g_verified_license_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static time_t ovsa_verified_license_cache_now(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+/* Returns true when the verified content of the customer license is the one read from it */
+static bool ovsa_verified_license_cache_check(const char* customer_license,
+                                              const int asym_keyslot, const char* cust_lic_sig_buf,
+                                              size_t cust_lic_size) {
+    ovsa_verified_license_cache_entry_t* entry = NULL;
+    int indicator                              = -1;
+    bool verified                              = false;
+
+    if (pthread_mutex_lock(&g_verified_license_cache_lock) != 0)
+        return false;
+    entry = ovsa_keyed_cache_find(&g_verified_license_cache, customer_license);
+    if (entry != NULL) {
+        if (entry->expiry <= ovsa_verified_license_cache_now()) {
+            ovsa_safe_free(&entry->cust_lic_sig_buf);
+        } else if ((entry->asym_keyslot == asym_keyslot) &&
+                   (entry->cust_lic_size == cust_lic_size)) {
+            memcmp_s(entry->cust_lic_sig_buf, entry->cust_lic_size, cust_lic_sig_buf,
+                     cust_lic_size, &indicator);
+            verified = (indicator == 0);
+        }
+    }
+    pthread_mutex_unlock(&g_verified_license_cache_lock);
+    return verified;
+}
+
+/* Seconds until the customer license is to be verified again, bounded by the ISV certificate */
+static time_t ovsa_verified_license_cache_validity(const char* peer_cert) {
+    time_t validity = VERIFIED_LICENSE_CACHE_VALIDITY;
+    BIO* cert_bio   = NULL;
+    X509* xcert     = NULL;
+    int days        = 0;
+    int secs        = 0;
+
+    cert_bio = BIO_new_mem_buf(peer_cert, -1);
+    if ((cert_bio == NULL) || ((xcert = PEM_read_bio_X509(cert_bio, NULL, 0, NULL)) == NULL) ||
+        (!ASN1_TIME_diff(&days, &secs, NULL, X509_get0_notAfter(xcert)))) {
+        validity = 0;
+    } else if (((time_t)days * 86400 + secs) < validity) {
+        validity = (time_t)days * 86400 + secs;
+    }
+    X509_free(xcert);
+    BIO_free(cert_bio);
+    return (validity > 0) ? validity : 0;
+}
+
+static void ovsa_verified_license_cache_store(const char* customer_license,
+                                              const int asym_keyslot, const char* cust_lic_sig_buf,
+                                              size_t cust_lic_size, time_t validity) {
+    ovsa_verified_license_cache_entry_t* entry = NULL;
+
+    if (validity == 0)
+        return;
+    if (pthread_mutex_lock(&g_verified_license_cache_lock) != 0)
+        return;
+    /* One entry per customer license, verifying it with another keystore replaces it */
+    entry = ovsa_keyed_cache_slot(&g_verified_license_cache, customer_license);
+    ovsa_safe_free(&entry->cust_lic_sig_buf);
+    if ((strcpy_s(entry->customer_license, sizeof(entry->customer_license), customer_license) ==
+         EOK) &&
+        (ovsa_safe_malloc(cust_lic_size, &entry->cust_lic_sig_buf) == OVSA_OK)) {
+        memcpy_s(entry->cust_lic_sig_buf, cust_lic_size, cust_lic_sig_buf, cust_lic_size);
+        entry->cust_lic_size = cust_lic_size;
+        entry->asym_keyslot  = asym_keyslot;
+        entry->expiry        = ovsa_verified_license_cache_now() + validity;
+    }
+    pthread_mutex_unlock(&g_verified_license_cache_lock);
+}
+
+ovsa_status_t ovsa_validate_customer_license(const char* customer_license, const int asym_keyslot,
+                                             char** cust_lic_buff) {
+    ovsa_status_t ret         = OVSA_OK;
+    size_t cust_lic_file_size = 0;
+    size_t peer_certlen       = 0;
+    int peer_keyslot          = -1;
+    int shared_key_slot       = -1;
+    int keyiv_hmac_slot       = -1;
+    char* cust_lic_buf        = NULL;
+    char* peer_cert           = NULL;
+    char* encryption_key      = NULL;
+    char* cust_lic_sig_buf    = NULL;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    if (customer_license != NULL) {
+        ret = ovsa_read_customer_license(customer_license, &cust_lic_sig_buf,
+                                         &cust_lic_file_size);
+        if (ret < OVSA_OK)
+            goto out;
+        *cust_lic_buff = cust_lic_sig_buf;
+
+        /* Extract encryption_key from customer license */
+        ret = ovsa_json_extract_element(cust_lic_sig_buf, "isv_certificate", &peer_cert);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error extract json element failed with error code %d\n", ret);
+            goto out;
+        }
+
+        OVSA_DBG(DBG_I, "OVSA: Verify PEER certificate\n");
+        /* Verifying customer license ISV Certificate */
         ret = ovsa_get_string_length(peer_cert, &peer_certlen);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error could not get length of peer certificate %d\n", ret);
@@ -754,6 +1601,9 @@ ovsa_status_t ovsa_validate_customer_license(const char* customer_license, const
                      ret);
             goto out;
         }
+        ovsa_verified_license_cache_store(customer_license, asym_keyslot, cust_lic_sig_buf,
+                                          cust_lic_file_size,
+                                          ovsa_verified_license_cache_validity(peer_cert));
         ret = peer_keyslot;
     } else {
         OVSA_DBG(DBG_E, "OVSA: Error invalid customer license artifact \n");
@@ -776,6 +1626,43 @@ out:
     return ret;
 }
 
+ovsa_status_t ovsa_get_verified_customer_license(const char* customer_license,
+                                                 const int asym_keyslot, char** cust_lic_buff) {
+    ovsa_status_t ret      = OVSA_OK;
+    size_t cust_lic_size   = 0;
+    int peer_keyslot       = -1;
+    char* cust_lic_sig_buf = NULL;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    if ((customer_license == NULL) || (cust_lic_buff == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid customer license artifact \n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    ret = ovsa_read_customer_license(customer_license, &cust_lic_sig_buf, &cust_lic_size);
+    if (ret < OVSA_OK)
+        goto out;
+    if (ovsa_verified_license_cache_check(customer_license, asym_keyslot, cust_lic_sig_buf,
+                                          cust_lic_size)) {
+        OVSA_DBG(DBG_I, "OVSA: Customer license %s unchanged since verified\n",
+                 customer_license);
+        *cust_lic_buff = cust_lic_sig_buf;
+        goto out;
+    }
+    ovsa_safe_free(&cust_lic_sig_buf);
+
+    /* The license file changed or was not verified yet */
+    peer_keyslot = ovsa_validate_customer_license(customer_license, asym_keyslot, cust_lic_buff);
+    if (peer_keyslot < MIN_KEY_SLOT) {
+        ret = peer_keyslot;
+        goto out;
+    }
+    /* clear peer keys from the key slots */
+    ovsa_crypto_clear_asymmetric_key_slot(peer_keyslot);
+out:
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
 static ovsa_status_t ovsa_do_update_cust_license(char* update_cust_lic_buf,
                                                  const char* cust_lic_file_path,
                                                  void** _ssl_session) {
@@ -787,8 +1674,7 @@ static ovsa_status_t ovsa_do_update_cust_license(char* update_cust_lic_buf,
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    ret =
-        ovsa_json_extract_element((char*)update_cust_lic_buf, "payload", &update_cust_lic_payload);
+    ret = ovsa_license_service_extract_payload(update_cust_lic_buf, &update_cust_lic_payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error read updated customer license payload from json failed %d\n",
                  ret);
@@ -834,8 +1720,7 @@ static ovsa_status_t ovsa_do_get_license_check(const int asym_keyslot,
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
-    ret =
-        ovsa_json_extract_element((char*)cust_lic_check_status_buf, "payload", &lic_check_payload);
+    ret = ovsa_license_service_extract_payload(cust_lic_check_status_buf, &lic_check_payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error read license check status payload from json failed %d\n", ret);
         goto out;
@@ -920,17 +1805,14 @@ out:
 }
 
 static ovsa_status_t ovsa_do_sign_send_nounce(const int asym_keyslot, char* nonce_buf,
+                                              const ovsa_command_type_t cust_lic_cmd,
                                               char* cust_lic_sig_buf, void** _ssl_session) {
     ovsa_status_t ret = OVSA_OK;
     void* ssl_session = NULL;
+    char* payload     = NULL;
     char nonce_signed[MAX_SIGNATURE_SIZE];
-    size_t length               = 0;
-    char* nonce_signbuf_str     = NULL;
-    size_t sign_payload_len     = 0;
-    unsigned char* json_payload = NULL;
-    char* payload               = NULL;
-    char* cust_lic_msg_blob_buf = NULL;
-    char* cust_lic_json_payload = NULL;
+    ovsa_command_type_t cmds[2];
+    const char* payloads[2];
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -938,7 +1820,7 @@ static ovsa_status_t ovsa_do_sign_send_nounce(const int asym_keyslot, char* nonc
     memset_s(nonce_signed, sizeof(nonce_signed), 0);
 
     /* Read payload from json file */
-    ret = ovsa_json_extract_element((char*)nonce_buf, "payload", &payload);
+    ret = ovsa_license_service_extract_payload(nonce_buf, &payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error read payload from json failed %d\n", ret);
         goto out;
@@ -955,131 +1837,1016 @@ static ovsa_status_t ovsa_do_sign_send_nounce(const int asym_keyslot, char* nonc
         OVSA_DBG(DBG_E, "OVSA: Error nonce Signing failed with code %d\n", ret);
         goto out;
     }
-    OVSA_DBG(DBG_I, "OVSA:Send signed nonce to server\n");
+    /* Send signed nonce and customer license to Server, they are read one after the other */
+    OVSA_DBG(DBG_I, "OVSA:Send signed nonce to server\n%s\n", nonce_signed);
+    cmds[0]     = OVSA_SEND_SIGN_NONCE;
+    payloads[0] = nonce_signed;
+    cmds[1]     = cust_lic_cmd;
+    payloads[1] = cust_lic_sig_buf;
+    ret         = ovsa_license_service_send_messages(ssl_session, cmds, payloads, 2);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Send customer license to server\n%s", cust_lic_sig_buf);
+
+out:
+    ovsa_safe_free(&payload);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+/*
+ * Reads the next message from the license server and its command. The message is received in the
+ * receive buffer of the session, read_buf is valid until the next message is read and is not
+ * freed by the caller.
+ */
+static ovsa_status_t ovsa_license_service_read_command(void* ssl_session,
+                                                       unsigned char** read_buf,
+                                                       unsigned char** command,
+                                                       ovsa_command_type_t* cmd) {
+    ovsa_tls_session_t* session = (ovsa_tls_session_t*)ssl_session;
+    ovsa_status_t ret           = OVSA_OK;
+    size_t payload_size         = 0;
+    const char* name            = NULL;
+    const char* payload         = NULL;
+    char* framing               = NULL;
+    char* trace                 = NULL;
+    size_t name_len             = 0;
+    size_t payload_len          = 0;
+    size_t end                  = 0;
+    unsigned char payload_len_str[PAYLOAD_LENGTH + 1];
+
+    /* Read payload length from server */
+    memset_s(payload_len_str, sizeof(payload_len_str), 0);
+    ret = ovsa_license_service_read(ssl_session, payload_len_str, PAYLOAD_LENGTH);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read payload length from server failed with code %d\n", ret);
+        return ret;
+    }
+
+    payload_size = atoi((char*)payload_len_str);
+    if (payload_size < 0 || payload_size > LICENSE_SERVICE_MAX_MSG_SIZE) {
+        OVSA_DBG(DBG_E, "OVSA: Error read payload length from server is wrong\n");
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+
+    /* Read payload from server */
+    ret = ovsa_tls_session_reserve(&session->rx_buf, &session->rx_buf_size, 0, payload_size + 1);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error memory allocation of read buf failed with code %d\n", ret);
+        return ret;
+    }
+    *read_buf = (unsigned char*)session->rx_buf;
+
+    ret = ovsa_license_service_read(ssl_session, *read_buf, payload_size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read payload from server failed with code %d\n", ret);
+        return ret;
+    }
+    (*read_buf)[payload_size] = '\0';
+
+    if ((*read_buf)[0] == OVSA_TLV_MAGIC) {
+        /* The license server answers in the binary framing only once the runtime used it */
+        ret = ovsa_tlv_split((char*)*read_buf, payload_size, &name, &name_len, &payload,
+                             &payload_len, &end);
+        if ((ret < OVSA_OK) || (end != payload_size) || !session->binary_framing) {
+            OVSA_DBG(DBG_E, "OVSA: Error invalid binary framed message from server\n");
+            return OVSA_INVALID_PARAMETER;
+        }
+        ret = ovsa_safe_malloc(name_len + 1, (char**)command);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error command allocation failed with code %d\n", ret);
+            return OVSA_MEMORY_ALLOC_FAIL;
+        }
+        memcpy_s(*command, name_len + 1, name, name_len);
+        OVSA_DBG(DBG_I, "OVSA: Received %s from server\n", *command);
+        *cmd = ovsa_get_command_type((char*)*command);
+        return OVSA_OK;
+    }
+    OVSA_DBG(DBG_I, "OVSA: Received payload from server \n'%s'\n", *read_buf);
 
-    /* create signed nonce json message blob */
-    ret = ovsa_json_create_message_blob(OVSA_SEND_SIGN_NONCE, nonce_signed, &nonce_signbuf_str,
-                                        &length);
+    /* Read command from Payload */
+    ret = ovsa_json_extract_element((char*)*read_buf, "command", (char**)command);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create nonce_message failed with error code %d\n", ret);
+        OVSA_DBG(DBG_E, "OVSA: Error read command from json failed %d\n", ret);
+        return ret;
+    }
+    *cmd = ovsa_get_command_type((char*)*command);
+    if (*cmd == OVSA_SEND_NONCE) {
+        /* The nonce opens the protocol, the license server offers the binary framing in it */
+        ret = ovsa_json_extract_element((char*)*read_buf, "framing", &framing);
+        session->binary_framing =
+            (ret == OVSA_OK) && (framing != NULL) && !strcmp(framing, OVSA_FRAMING_TLV);
+        ovsa_safe_free(&framing);
+        ret = ovsa_json_extract_element((char*)*read_buf, "trace", &trace);
+        session->trace_record = session->binary_framing && (ret == OVSA_OK) && (trace != NULL) &&
+                                !strcmp(trace, OVSA_FRAMING_TRACE);
+        ovsa_safe_free(&trace);
+        ret = OVSA_OK;
+    }
+    return ret;
+}
+
+/*
+ * Per-process cache of the license leases, keyed by customer license file. A lease is signed by
+ * the license server for the license and the platform certificate, it lets the license check
+ * pass while none of the license servers of the customer license can be reached. Leases are also
+ * stored next to the customer license so that they survive a restart of the runtime.
+ */
+typedef struct ovsa_license_lease_cache_entry {
+    char customer_license[MAX_FILE_NAME + 1];
+    GUID license_guid;
+    time_t expiry;
+    bool valid;
+} ovsa_license_lease_cache_entry_t;
+
+static bool ovsa_license_lease_cache_in_use(const void* entry) {
+    return ((const ovsa_license_lease_cache_entry_t*)entry)->valid;
+}
+
+static ovsa_license_lease_cache_entry_t g_lease_cache_entries[MAX_LICENSE_LEASE_ENTRIES];
+static ovsa_keyed_cache_t g_lease_cache =
+    OVSA_KEYED_CACHE(g_lease_cache_entries, customer_license, ovsa_license_lease_cache_in_use);
+static pthread_mutex_t g_lease_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ovsa_license_lease_cache_store(const char* customer_license, const char* license_guid,
+                                           time_t expiry) {
+    ovsa_license_lease_cache_entry_t* entry = NULL;
+
+    if (pthread_mutex_lock(&g_lease_cache_lock) != 0)
+        return;
+    entry = ovsa_keyed_cache_slot(&g_lease_cache, customer_license);
+    entry->valid = false;
+    if ((strcpy_s(entry->customer_license, sizeof(entry->customer_license), customer_license) ==
+         EOK) &&
+        (strcpy_s(entry->license_guid, sizeof(entry->license_guid), license_guid) == EOK)) {
+        entry->expiry = expiry;
+        entry->valid  = true;
+    }
+    pthread_mutex_unlock(&g_lease_cache_lock);
+}
+
+/* Returns true if the cache holds an unexpired lease of the customer license */
+static bool ovsa_license_lease_cache_check(const char* customer_license,
+                                           const char* license_guid) {
+    ovsa_license_lease_cache_entry_t* entry = NULL;
+    int indicator                           = -1;
+    bool valid                              = false;
+
+    if (pthread_mutex_lock(&g_lease_cache_lock) != 0)
+        return false;
+    entry = ovsa_keyed_cache_find(&g_lease_cache, customer_license);
+    if (entry != NULL) {
+        strcmp_s(entry->license_guid, GUID_SIZE, license_guid, &indicator);
+        if ((indicator == 0) && (entry->expiry > time(NULL)))
+            valid = true;
+        else
+            entry->valid = false;
+    }
+    pthread_mutex_unlock(&g_lease_cache_lock);
+    return valid;
+}
+
+/* Computes the hash of a PEM certificate the way the license server certificate is hashed */
+static ovsa_status_t ovsa_license_lease_get_cert_hash(X509* xcert, char* cert_hash) {
+    ovsa_status_t ret = OVSA_OK;
+    BIO* cert_bio     = NULL;
+    BUF_MEM* cert_ptr = NULL;
+    char* cert_dup    = NULL;
+
+    cert_bio = BIO_new(BIO_s_mem());
+    if (cert_bio == NULL) {
+        ret = OVSA_CRYPTO_BIO_ERROR;
+        OVSA_DBG(DBG_E, "OVSA: Error BIO_new failed with error %d\n", ret);
+        goto out;
+    }
+    if (!PEM_write_bio_X509(cert_bio, xcert)) {
+        ret = OVSA_CRYPTO_PEM_ENCODE_ERROR;
+        OVSA_DBG(DBG_E, "OVSA: Error PEM_write_bio_X509 failed with error %d\n", ret);
+        goto out;
+    }
+    BIO_get_mem_ptr(cert_bio, &cert_ptr);
+    if (cert_ptr == NULL) {
+        ret = OVSA_CRYPTO_BIO_ERROR;
+        OVSA_DBG(DBG_E, "OVSA: Error BIO_get_mem_ptr failed with error %d\n", ret);
         goto out;
     }
-    /* Append payload length to json blob */
-    sign_payload_len = length + PAYLOAD_LENGTH + 1;
-    ret              = ovsa_safe_malloc(sizeof(char) * sign_payload_len, (char**)&json_payload);
+    ret = ovsa_safe_malloc(cert_ptr->length + NULL_TERMINATOR, &cert_dup);
     if (ret < OVSA_OK) {
         ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
+        OVSA_DBG(DBG_E, "OVSA: Error lease cert memory failed with code %d\n", ret);
         goto out;
     }
-    ret = ovsa_append_json_payload_len_to_blob(nonce_signbuf_str, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json blob creation failed with %d\n", ret);
+    if (memcpy_s(cert_dup, cert_ptr->length, cert_ptr->data, cert_ptr->length) != EOK) {
+        ret = OVSA_MEMIO_ERROR;
+        OVSA_DBG(DBG_E, "OVSA: Error getting the lease cert failed with error %d\n", ret);
         goto out;
     }
-    ret = ovsa_get_string_length((char*)json_payload, &buf_len);
+    memset_s(cert_hash, HASH_SIZE, 0);
+    ret = ovsa_crypto_compute_hash(cert_dup, HASH_ALG_SHA384, (unsigned char*)cert_hash,
+                                   true /* FORMAT_BASE64 */);
+    if (ret != OVSA_OK)
+        OVSA_DBG(DBG_E, "OVSA: Error lease certificate HASH generation failed with code %d\n",
+                 ret);
+out:
+    BIO_free_all(cert_bio);
+    ovsa_safe_free(&cert_dup);
+    return ret;
+}
+
+/* Verifies the signature of the lease claims with the public key of the lease certificate */
+static ovsa_status_t ovsa_license_lease_verify_signature(X509* xcert, const char* claims,
+                                                         const char* signature) {
+    ovsa_status_t ret  = OVSA_OK;
+    EVP_MD_CTX* mctx   = NULL;
+    char* sig          = NULL;
+    size_t sig_b64_len = 0;
+    size_t sig_len     = 0;
+    size_t claims_len  = 0;
+
+    if ((ovsa_get_string_length(claims, &claims_len) < OVSA_OK) ||
+        (ovsa_get_string_length(signature, &sig_b64_len) < OVSA_OK) || (sig_b64_len == 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error license lease is incomplete\n");
+        return OVSA_LICENSE_LEASE_INVALID;
+    }
+    ret = ovsa_safe_malloc(sig_b64_len + NULL_TERMINATOR, &sig);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error lease signature memory failed with code %d\n", ret);
         goto out;
     }
-    /* Send signed nonce to Server */
-    OVSA_DBG(DBG_I, "OVSA:Send signed nonce to server\n%s\n", json_payload);
-    ret = ovsa_license_service_write(ssl_session, (char*)json_payload, buf_len);
+    ret = ovsa_crypto_convert_base64_to_bin(signature, sig_b64_len, sig, &sig_len);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
+        OVSA_DBG(DBG_E, "OVSA: Error decoding lease signature failed with code %d\n", ret);
+        goto out;
+    }
+    mctx = EVP_MD_CTX_new();
+    if ((mctx == NULL) ||
+        (EVP_DigestVerifyInit(mctx, NULL, EVP_sha512(), NULL, X509_get0_pubkey(xcert)) != 1) ||
+        (EVP_DigestVerify(mctx, (const unsigned char*)sig, sig_len,
+                          (const unsigned char*)claims, claims_len) != 1)) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error license lease signature verification failed\n");
         goto out;
     }
-    length                      = 0;
-    buf_len                     = 0;
-    size_t cust_lic_payload_len = 0;
-    /* create customer license json message blob */
-    ret = ovsa_json_create_message_blob(OVSA_SEND_CUST_LICENSE, cust_lic_sig_buf,
-                                        &cust_lic_msg_blob_buf, &length);
+out:
+    EVP_MD_CTX_free(mctx);
+    ovsa_safe_free(&sig);
+    return ret;
+}
+
+/*
+ * Verifies a lease of the customer license: it has to be signed by a license server of the
+ * customer license, for the license and for the platform certificate of the keystore, and must
+ * not have expired. The expiry of the lease is returned.
+ */
+static ovsa_status_t ovsa_license_lease_verify(const int asym_keyslot, const char* lease,
+                                               ovsa_customer_license_sig_t* customer_lic_sig,
+                                               time_t* expiry) {
+    ovsa_status_t ret        = OVSA_OK;
+    char* claims             = NULL;
+    char* signature          = NULL;
+    char* certificate        = NULL;
+    char* license_guid       = NULL;
+    char* platform_cert_hash = NULL;
+    char* lease_expiry       = NULL;
+    char* platform_cert      = NULL;
+    BIO* cert_bio            = NULL;
+    X509* xcert              = NULL;
+    int indicator            = -1;
+    char cert_hash[HASH_SIZE];
+
+    if ((ovsa_json_extract_element(lease, "claims", &claims) < OVSA_OK) ||
+        (ovsa_json_extract_element(lease, "signature", &signature) < OVSA_OK) ||
+        (ovsa_json_extract_element(lease, "certificate", &certificate) < OVSA_OK)) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error read license lease from json failed\n");
+        goto out;
+    }
+
+    /* The lease has to come from a license server of the customer license */
+    cert_bio = BIO_new_mem_buf(certificate, -1);
+    if ((cert_bio == NULL) || ((xcert = PEM_read_bio_X509(cert_bio, NULL, 0, NULL)) == NULL)) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error read license lease certificate failed\n");
+        goto out;
+    }
+    ret = ovsa_license_lease_get_cert_hash(xcert, cert_hash);
+    if (ret < OVSA_OK)
+        goto out;
+    ret = ovsa_validate_peer_cert_hash(*customer_lic_sig, cert_hash);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create OVSA_SEND_CUST_LICENSE failed with error code %d\n",
-                 ret);
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error license lease certificate is not of the license server\n");
+        goto out;
+    }
+    ret = ovsa_license_lease_verify_signature(xcert, claims, signature);
+    if (ret < OVSA_OK)
+        goto out;
+
+    /* The claims are trusted from here on */
+    if ((ovsa_json_extract_element(claims, "license_guid", &license_guid) < OVSA_OK) ||
+        (ovsa_json_extract_element(claims, "platform_cert_hash", &platform_cert_hash) <
+         OVSA_OK) ||
+        (ovsa_json_extract_element(claims, "expiry", &lease_expiry) < OVSA_OK)) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error read license lease claims from json failed\n");
         goto out;
     }
-    cust_lic_payload_len = length + PAYLOAD_LENGTH + 1;
-    ret = ovsa_safe_malloc(sizeof(char) * cust_lic_payload_len, (char**)&cust_lic_json_payload);
+    strcmp_s(license_guid, GUID_SIZE, customer_lic_sig->customer_lic.license_guid, &indicator);
+    if (indicator != 0) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error license lease is not of the customer license\n");
+        goto out;
+    }
+    ret = ovsa_crypto_get_certificate(asym_keyslot, &platform_cert);
     if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
+        OVSA_DBG(DBG_E, "OVSA: Error get platform certificate failed with code %d\n", ret);
         goto out;
     }
-    ret = ovsa_append_json_payload_len_to_blob(cust_lic_msg_blob_buf, &cust_lic_json_payload);
+    memset_s(cert_hash, HASH_SIZE, 0);
+    ret = ovsa_crypto_compute_hash(platform_cert, HASH_ALG_SHA384, (unsigned char*)cert_hash,
+                                   true /* FORMAT_BASE64 */);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E,
-                 "OVSA: Error customer license append payload json blob creation failed with %d\n",
+        OVSA_DBG(DBG_E, "OVSA: Error platform certificate HASH generation failed with code %d\n",
                  ret);
         goto out;
     }
-    /* Send customer license to Server */
-    ret = ovsa_get_string_length((char*)cust_lic_json_payload, &buf_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of cust_lic_json_payload string %d\n",
+    strcmp_s(platform_cert_hash, HASH_SIZE, cert_hash, &indicator);
+    if (indicator != 0) {
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error license lease is not of this platform\n");
+        goto out;
+    }
+    *expiry = (time_t)strtoll(lease_expiry, NULL, 10);
+    if (*expiry <= time(NULL)) {
+        ret = OVSA_LICENSE_LEASE_EXPIRED;
+        OVSA_DBG(DBG_E, "OVSA: Error license lease expired\n");
+        goto out;
+    }
+out:
+    BIO_free_all(cert_bio);
+    X509_free(xcert);
+    ovsa_safe_free(&platform_cert);
+    ovsa_safe_free(&lease_expiry);
+    ovsa_safe_free(&platform_cert_hash);
+    ovsa_safe_free(&license_guid);
+    ovsa_safe_free(&certificate);
+    ovsa_safe_free(&signature);
+    ovsa_safe_free(&claims);
+    return ret;
+}
+
+static ovsa_status_t ovsa_license_lease_get_file_name(const char* customer_license,
+                                                      char* lease_file) {
+    if ((strcpy_s(lease_file, MAX_FILE_NAME + sizeof(LICENSE_LEASE_FILE_EXT), customer_license) !=
+         EOK) ||
+        (strcat_s(lease_file, MAX_FILE_NAME + sizeof(LICENSE_LEASE_FILE_EXT),
+                  LICENSE_LEASE_FILE_EXT) != EOK)) {
+        OVSA_DBG(DBG_E, "OVSA: Error license lease file name of %s too long\n", customer_license);
+        return OVSA_INVALID_FILE_PATH;
+    }
+    return OVSA_OK;
+}
+
+/* Keeps the lease received with a passed license check, the lease is verified first */
+static void ovsa_license_lease_store(const int asym_keyslot, const char* customer_license,
+                                     const char* cust_lic_sig_buf, const char* lease) {
+    char lease_file[MAX_FILE_NAME + sizeof(LICENSE_LEASE_FILE_EXT)];
+    char lease_tmp_file[MAX_FILE_NAME + sizeof(LICENSE_LEASE_FILE_EXT) + 4];
+    time_t expiry  = 0;
+    size_t len     = 0;
+    size_t written = 0;
+    FILE* fptr     = NULL;
+    bool verified  = false;
+    ovsa_customer_license_sig_t customer_lic_sig;
+
+    if ((lease == NULL) || (lease[0] == '\0'))
+        return;
+    memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+    if ((ovsa_json_extract_customer_license(cust_lic_sig_buf, &customer_lic_sig) == OVSA_OK) &&
+        (ovsa_license_lease_verify(asym_keyslot, lease, &customer_lic_sig, &expiry) == OVSA_OK)) {
+        ovsa_license_lease_cache_store(customer_license,
+                                       customer_lic_sig.customer_lic.license_guid, expiry);
+        verified = true;
+    }
+    ovsa_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
+    ovsa_safe_free_tcb_list(&customer_lic_sig.customer_lic.tcb_signatures);
+    ovsa_safe_free_url_list(&customer_lic_sig.customer_lic.license_url_list);
+    if (!verified)
+        return;
+    OVSA_DBG(DBG_I, "OVSA: License lease of %s valid until %lld\n", customer_license,
+             (long long)expiry);
+
+    /* Replaced atomically, a lease that cannot be stored only lasts as long as the process */
+    if ((ovsa_license_lease_get_file_name(customer_license, lease_file) < OVSA_OK) ||
+        (snprintf(lease_tmp_file, sizeof(lease_tmp_file), "%s.tmp", lease_file) >=
+         (int)sizeof(lease_tmp_file)) ||
+        (ovsa_get_string_length(lease, &len) < OVSA_OK))
+        return;
+    fptr = fopen(lease_tmp_file, "w");
+    if (fptr == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error opening license lease file %s failed\n", lease_tmp_file);
+        return;
+    }
+    written = fwrite(lease, 1, len, fptr);
+    if ((fclose(fptr) != 0) || (written != len) || (rename(lease_tmp_file, lease_file) != 0)) {
+        OVSA_DBG(DBG_E, "OVSA: Error storing license lease file %s failed\n", lease_file);
+        remove(lease_tmp_file);
+    }
+}
+
+/*
+ * Checks if the customer license holds a valid lease, used when none of its license servers can
+ * be reached. The lease is looked up in the cache first, then read from the lease file.
+ */
+static ovsa_status_t ovsa_license_lease_check(const int asym_keyslot, const char* customer_license,
+                                              const char* cust_lic_sig_buf) {
+    ovsa_status_t ret = OVSA_OK;
+    char* lease       = NULL;
+    size_t size       = 0;
+    time_t expiry     = 0;
+    char lease_file[MAX_FILE_NAME + sizeof(LICENSE_LEASE_FILE_EXT)];
+    ovsa_customer_license_sig_t customer_lic_sig;
+
+    memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+    ret = ovsa_json_extract_customer_license(cust_lic_sig_buf, &customer_lic_sig);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error extract customer license json blob failed with code %d\n",
                  ret);
         goto out;
     }
-    ret = ovsa_license_service_write(ssl_session, (char*)cust_lic_json_payload, buf_len);
+    if (ovsa_license_lease_cache_check(customer_license,
+                                       customer_lic_sig.customer_lic.license_guid))
+        goto out;
+
+    ret = ovsa_license_lease_get_file_name(customer_license, lease_file);
+    if (ret < OVSA_OK)
+        goto out;
+    ret = ovsa_read_file_content(lease_file, &lease, &size);
     if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
+        ret = OVSA_LICENSE_LEASE_INVALID;
+        OVSA_DBG(DBG_E, "OVSA: Error no license lease of %s\n", customer_license);
         goto out;
     }
-    OVSA_DBG(DBG_I, "OVSA:Send OVSA_SEND_CUST_LICENSE to server\n%s", cust_lic_json_payload);
+    ret = ovsa_license_lease_verify(asym_keyslot, lease, &customer_lic_sig, &expiry);
+    if (ret < OVSA_OK)
+        goto out;
+    ovsa_license_lease_cache_store(customer_license, customer_lic_sig.customer_lic.license_guid,
+                                   expiry);
+out:
+    if (ret == OVSA_OK)
+        OVSA_DBG(DBG_I, "OVSA: License server unreachable, license lease of %s honoured\n",
+                 customer_license);
+    ovsa_safe_free(&lease);
+    ovsa_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
+    ovsa_safe_free_tcb_list(&customer_lic_sig.customer_lic.tcb_signatures);
+    ovsa_safe_free_url_list(&customer_lic_sig.customer_lic.license_url_list);
+    return ret;
+}
 
+/* Reads the leases the license server may send after a passed license check, their absence is
+ * not an error since license servers without leases close the connection instead */
+static void ovsa_do_get_license_leases(void* ssl_session, size_t count, char*** leases,
+                                       size_t* lease_count) {
+    unsigned char* read_buf = NULL;
+    unsigned char* command  = NULL;
+    char* payload           = NULL;
+    ovsa_command_type_t cmd = OVSA_INVALID_CMD;
+
+    *leases      = NULL;
+    *lease_count = 0;
+    if ((ovsa_license_service_read_command(ssl_session, &read_buf, &command, &cmd) < OVSA_OK) ||
+        (cmd != OVSA_SEND_LICENSE_LEASE)) {
+        OVSA_DBG(DBG_I, "OVSA: No license lease received from server\n");
+        goto out;
+    }
+    if ((ovsa_license_service_extract_payload((char*)read_buf, &payload) < OVSA_OK) ||
+        (ovsa_json_extract_string_array(payload, count, leases, lease_count) < OVSA_OK) ||
+        (*lease_count != count)) {
+        ovsa_json_free_string_array(leases, *lease_count);
+        *lease_count = 0;
+        OVSA_DBG(DBG_E, "OVSA: Error read license leases from json failed\n");
+    }
 out:
-    ovsa_safe_free(&nonce_signbuf_str);
     ovsa_safe_free(&payload);
-    ovsa_safe_free((char**)&json_payload);
-    ovsa_safe_free(&cust_lic_msg_blob_buf);
+    ovsa_safe_free((char**)&command);
+}
 
-    ovsa_safe_free((char**)&cust_lic_json_payload);
-    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+/*
+ * Per-process health of the license servers, keyed by license server URL. The connect latency
+ * of each license server orders the next connection attempts and a license server that failed
+ * LICENSE_SERVER_BREAKER_FAILURES times in a row is skipped for LICENSE_SERVER_BREAKER_COOLDOWN_S
+ * seconds, after which it is tried again.
+ */
+typedef struct ovsa_server_health_entry {
+    char license_serv_url[MAX_URL_SIZE + 1];
+    bool valid;
+    int failures;
+    long latency_ms;
+    time_t retry_time;
+} ovsa_server_health_entry_t;
+
+static bool ovsa_server_health_in_use(const void* entry) {
+    return ((const ovsa_server_health_entry_t*)entry)->valid;
+}
+
+static ovsa_server_health_entry_t g_server_health_entries[MAX_SERVER_HEALTH_ENTRIES];
+static ovsa_keyed_cache_t g_server_health =
+    OVSA_KEYED_CACHE(g_server_health_entries, license_serv_url, ovsa_server_health_in_use);
+static pthread_mutex_t g_server_health_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long ovsa_server_health_elapsed_ms(const struct timespec* start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+static ovsa_server_health_entry_t* ovsa_server_health_find(const char* license_serv_url) {
+    return ovsa_keyed_cache_find(&g_server_health, license_serv_url);
+}
+
+/* Called with g_server_health_lock held */
+static bool ovsa_server_health_skipped(const ovsa_server_health_entry_t* entry, time_t now) {
+    return (entry != NULL) && (entry->failures >= LICENSE_SERVER_BREAKER_FAILURES) &&
+           (entry->retry_time > now);
+}
+
+static bool ovsa_server_health_is_skipped(const char* license_serv_url) {
+    struct timespec now;
+    bool skipped = false;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (pthread_mutex_lock(&g_server_health_lock) != 0)
+        return false;
+    skipped = ovsa_server_health_skipped(ovsa_server_health_find(license_serv_url), now.tv_sec);
+    pthread_mutex_unlock(&g_server_health_lock);
+    return skipped;
+}
+
+/* Returns the entry of the license server, added if needed, called with g_server_health_lock
+ * held */
+static ovsa_server_health_entry_t* ovsa_server_health_get(const char* license_serv_url) {
+    ovsa_server_health_entry_t* entry = ovsa_server_health_find(license_serv_url);
+
+    if (entry == NULL) {
+        entry        = ovsa_keyed_cache_slot(&g_server_health, license_serv_url);
+        entry->valid = false;
+    }
+    if (!entry->valid) {
+        if (strcpy_s(entry->license_serv_url, sizeof(entry->license_serv_url),
+                     license_serv_url) != EOK)
+            return NULL;
+        entry->failures   = 0;
+        entry->latency_ms = -1;
+        entry->retry_time = 0;
+        entry->valid      = true;
+    }
+    return entry;
+}
+
+/* Records the connect time of a license server that accepted the connection, before its TLS
+ * session is known to work */
+static void ovsa_server_health_record_latency(const char* license_serv_url, long latency_ms) {
+    ovsa_server_health_entry_t* entry = NULL;
+
+    if (pthread_mutex_lock(&g_server_health_lock) != 0)
+        return;
+    entry = ovsa_server_health_get(license_serv_url);
+    /* Moving average over about the last 4 connections */
+    if (entry != NULL)
+        entry->latency_ms = (entry->latency_ms < 0) ? latency_ms
+                                                    : (entry->latency_ms * 3 + latency_ms) / 4;
+    pthread_mutex_unlock(&g_server_health_lock);
+}
+
+/* A license server succeeds once its TLS session is established and its certificate verified,
+ * it fails on any error before */
+static void ovsa_server_health_record(const char* license_serv_url, bool success) {
+    ovsa_server_health_entry_t* entry = NULL;
+    struct timespec now;
+
+    if (pthread_mutex_lock(&g_server_health_lock) != 0)
+        return;
+    entry = ovsa_server_health_get(license_serv_url);
+    if (entry == NULL)
+        goto out;
+    if (success) {
+        entry->failures = 0;
+    } else if (++entry->failures >= LICENSE_SERVER_BREAKER_FAILURES) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        entry->retry_time = now.tv_sec + LICENSE_SERVER_BREAKER_COOLDOWN_S;
+        OVSA_DBG(DBG_I, "OVSA: License server '%s' skipped for %d seconds after %d failures\n",
+                 license_serv_url, LICENSE_SERVER_BREAKER_COOLDOWN_S, entry->failures);
+    }
+out:
+    pthread_mutex_unlock(&g_server_health_lock);
+}
+
+/*
+ * Orders the license servers by connect latency, those not connected to yet first since their
+ * latency is unknown and, among equals, in the order of the customer license. The license
+ * servers being skipped are dropped, unless all of them are skipped. Returns the new count.
+ */
+static size_t ovsa_server_health_order(ovsa_license_serv_url_list_t** urls, size_t count) {
+    ovsa_server_health_entry_t* entry = NULL;
+    ovsa_license_serv_url_list_t* url = NULL;
+    struct timespec now;
+    long latency[MAX_LICENSE_SERVER_CONNECTS];
+    bool skipped[MAX_LICENSE_SERVER_CONNECTS];
+    size_t available = 0;
+    size_t index     = 0;
+    size_t pos       = 0;
+    long score       = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (pthread_mutex_lock(&g_server_health_lock) != 0)
+        return count;
+    for (index = 0; index < count; index++) {
+        entry          = ovsa_server_health_find(urls[index]->license_serv_url);
+        latency[index] = ((entry == NULL) || (entry->latency_ms < 0)) ? 0 : entry->latency_ms;
+        skipped[index] = ovsa_server_health_skipped(entry, now.tv_sec);
+        if (!skipped[index])
+            available++;
+    }
+    pthread_mutex_unlock(&g_server_health_lock);
+
+    if (available > 0) {
+        for (index = 0, pos = 0; index < count; index++) {
+            if (skipped[index]) {
+                OVSA_DBG(DBG_I, "OVSA: License server '%s' skipped after repeated failures\n",
+                         urls[index]->license_serv_url);
+                continue;
+            }
+            urls[pos]      = urls[index];
+            latency[pos++] = latency[index];
+        }
+        count = available;
+    }
+    /* Insertion sort, the lists are short and it keeps equals in order */
+    for (index = 1; index < count; index++) {
+        url   = urls[index];
+        score = latency[index];
+        for (pos = index; (pos > 0) && (latency[pos - 1] > score); pos--) {
+            urls[pos]    = urls[pos - 1];
+            latency[pos] = latency[pos - 1];
+        }
+        urls[pos]    = url;
+        latency[pos] = score;
+    }
+    return count;
+}
+
+/*
+ * Starts a connection to each address of the license servers of the customer license at once
+ * and returns the socket of the first one to connect, in the order of their health when several
+ * are ready. Unreachable license servers then cost a single bounded wait instead of a connect
+ * timeout each. license_serv_url is updated with the URL of the connected license server and has
+ * to hold MAX_URL_SIZE + 1 characters.
+ */
+static int ovsa_license_service_race_connect(ovsa_license_serv_url_list_t* license_url_list,
+                                             char* license_serv_url) {
+    struct pollfd fds[MAX_LICENSE_SERVER_CONNECTS];
+    size_t fd_urls[MAX_LICENSE_SERVER_CONNECTS];
+    ovsa_license_serv_url_list_t* urls[MAX_LICENSE_SERVER_CONNECTS];
+    size_t url_pending[MAX_LICENSE_SERVER_CONNECTS];
+    struct addrinfo hints;
+    struct addrinfo* addr_list = NULL;
+    struct addrinfo* cur       = NULL;
+    struct timespec start;
+    char url[MAX_URL_SIZE + 1];
+    char* saveptr    = NULL;
+    char* host       = NULL;
+    char* port       = NULL;
+    int sockfd       = -1;
+    int sock_err     = 0;
+    int timeout_ms   = 0;
+    int rc           = 0;
+    size_t url_count = 0;
+    size_t nfds      = 0;
+    size_t pending   = 0;
+    size_t index     = 0;
+    socklen_t errlen = sizeof(sock_err);
+
+    for (; (license_url_list != NULL) && (url_count < MAX_LICENSE_SERVER_CONNECTS);
+         license_url_list = license_url_list->next)
+        urls[url_count++] = license_url_list;
+    url_count = ovsa_server_health_order(urls, url_count);
+
+    memset_s(&hints, sizeof(hints), 0);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (index = 0; (index < url_count) && (nfds < MAX_LICENSE_SERVER_CONNECTS); index++) {
+        url_pending[index] = 0;
+        if (strcpy_s(url, sizeof(url), urls[index]->license_serv_url) != EOK)
+            continue;
+        host = strtok_r(url, ":", &saveptr);
+        port = strtok_r(NULL, ":", &saveptr);
+        if ((host == NULL) || (port == NULL) ||
+            (getaddrinfo(host, port, &hints, &addr_list) != 0)) {
+            ovsa_server_health_record(urls[index]->license_serv_url, false);
+            continue;
+        }
+        for (cur = addr_list; (cur != NULL) && (nfds < MAX_LICENSE_SERVER_CONNECTS);
+             cur = cur->ai_next) {
+            sockfd = socket(cur->ai_family, cur->ai_socktype | SOCK_NONBLOCK, cur->ai_protocol);
+            if (sockfd < 0)
+                continue;
+            if ((connect(sockfd, cur->ai_addr, cur->ai_addrlen) != 0) && (errno != EINPROGRESS)) {
+                close(sockfd);
+                continue;
+            }
+            fds[nfds].fd      = sockfd;
+            fds[nfds].events  = POLLOUT;
+            fds[nfds].revents = 0;
+            fd_urls[nfds++]   = index;
+            url_pending[index]++;
+        }
+        freeaddrinfo(addr_list);
+        addr_list = NULL;
+        if (url_pending[index] == 0)
+            ovsa_server_health_record(urls[index]->license_serv_url, false);
+    }
+    url_count = index;
+
+    sockfd  = -1;
+    pending = nfds;
+    while ((sockfd < 0) && (pending > 0)) {
+        timeout_ms = LICENSE_SERVER_CONNECT_TIMEOUT_MS - (int)ovsa_server_health_elapsed_ms(&start);
+        if (timeout_ms <= 0)
+            break;
+        rc = poll(fds, nfds, timeout_ms);
+        if ((rc < 0) && (errno == EINTR))
+            continue;
+        if (rc <= 0)
+            break;
+        for (index = 0; (sockfd < 0) && (index < nfds); index++) {
+            if ((fds[index].fd < 0) || (fds[index].revents == 0))
+                continue;
+            sock_err = 0;
+            errlen   = sizeof(sock_err);
+            if ((getsockopt(fds[index].fd, SOL_SOCKET, SO_ERROR, &sock_err, &errlen) == 0) &&
+                (sock_err == 0)) {
+                sockfd = fds[index].fd;
+                strcpy_s(license_serv_url, MAX_URL_SIZE + 1,
+                         urls[fd_urls[index]]->license_serv_url);
+                ovsa_server_health_record_latency(license_serv_url,
+                                                  ovsa_server_health_elapsed_ms(&start));
+            } else {
+                close(fds[index].fd);
+                pending--;
+                if (--url_pending[fd_urls[index]] == 0)
+                    ovsa_server_health_record(urls[fd_urls[index]]->license_serv_url, false);
+            }
+            fds[index].fd = -1;
+        }
+    }
+
+    for (index = 0; index < nfds; index++) {
+        if (fds[index].fd >= 0)
+            close(fds[index].fd);
+    }
+    /* License servers left without an answer timed out, unless another one won the race */
+    for (index = 0; (sockfd < 0) && (index < url_count); index++) {
+        if (url_pending[index] > 0)
+            ovsa_server_health_record(urls[index]->license_serv_url, false);
+    }
+    /* mbedtls expects a blocking socket */
+    if ((sockfd >= 0) && (fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) & ~O_NONBLOCK) < 0)) {
+        close(sockfd);
+        sockfd = -1;
+    }
+    return sockfd;
+}
+
+/* Connects to the first reachable license server of the customer license, license_serv_url is
+ * updated with its URL and has to hold MAX_URL_SIZE + 1 characters */
+static ovsa_status_t ovsa_license_service_connect(ovsa_customer_license_sig_t customer_lic_sig,
+                                                  char* license_serv_url, void** ssl_session) {
+    ovsa_status_t ret = OVSA_OK;
+    ovsa_license_serv_url_list_t* license_url_list = NULL;
+    bool connected_to_license_server = false;
+    int sockfd                       = -1;
+    int indicator                    = -1;
+    char failed_url[MAX_URL_SIZE + 1];
+
+    memset_s(license_serv_url, MAX_URL_SIZE + 1, 0);
+    /* Extract license server URL from customer license */
+    license_url_list = customer_lic_sig.customer_lic.license_url_list;
+
+    OVSA_DBG(DBG_I, "OVSA:Attempting to connect license server url ........\n\n");
+    if (license_url_list == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error license_url_list empty \n");
+        return OVSA_LICENSE_SERVER_CONNECT_FAIL;
+    }
+    sockfd = ovsa_license_service_race_connect(license_url_list, license_serv_url);
+    if (sockfd < 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error none of the license servers is reachable\n");
+        return OVSA_LICENSE_SERVER_CONNECT_FAIL;
+    }
+    ret = ovsa_license_service_start(license_serv_url, NULL, ssl_session, customer_lic_sig, sockfd);
+    if (ret == OVSA_OK) {
+        OVSA_DBG(DBG_I, "OVSA:ovsa_license_service_start() connected to license server '%s'\n\n",
+                 license_serv_url);
+        ovsa_server_health_record(license_serv_url, true);
+        return OVSA_OK;
+    }
+    /* The other license servers are tried one by one if the TLS session failed on the first one */
+    OVSA_DBG(DBG_E, "OVSA: Error TLS session with license server '%s' failed\n\n",
+             license_serv_url);
+    ovsa_server_health_record(license_serv_url, false);
+    strcpy_s(failed_url, sizeof(failed_url), license_serv_url);
+    int url_count = 0;
+    for (; license_url_list != NULL; license_url_list = license_url_list->next) {
+        strcmp_s(license_url_list->license_serv_url, MAX_URL_SIZE, failed_url, &indicator);
+        if ((indicator == 0) ||
+            ovsa_server_health_is_skipped(license_url_list->license_serv_url))
+            continue;
+        int len = strnlen_s(license_url_list->license_serv_url, MAX_URL_SIZE);
+        if (len <= MAX_URL_SIZE) {
+            memcpy_s(license_serv_url, MAX_URL_SIZE, license_url_list->license_serv_url, len);
+            license_serv_url[len] = '\0';
+            OVSA_DBG(DBG_I, "OVSA:License_serv_url_%d: '%s' %s\n", url_count++, license_serv_url,
+                     license_url_list->license_serv_url);
+            ret = ovsa_license_service_start(license_serv_url, NULL, ssl_session, customer_lic_sig,
+                                             -1);
+            ovsa_server_health_record(license_serv_url, ret == OVSA_OK);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error ovsa_license_service_start() failed to connect to license "
+                         "server '%s'\n\n",
+                         license_serv_url);
+            } else {
+                OVSA_DBG(DBG_I,
+                         "OVSA:ovsa_license_service_start() connected to license server '%s' "
+                         "\n\n",
+                         license_serv_url);
+                connected_to_license_server = true;
+                break;
+            }
+        } else {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error incorrect length of URL failed to connect to license server "
+                     "'%s'\n\n",
+                     license_serv_url);
+        }
+    }
+
+    OVSA_DBG(DBG_I, "OVSA:Connect to license server url status %s\n\n",
+             connected_to_license_server ? "true" : "false");
+    if (!(connected_to_license_server == true)) {
+        OVSA_DBG(DBG_E, "OVSA: Error connect to license server url failed with %d\n", ret);
+        return OVSA_LICENSE_SERVER_CONNECT_FAIL;
+    }
+    return OVSA_OK;
+}
+
+#ifndef ENABLE_SGX_GRAMINE
+/* Answers the EK/AK binding request of the license server with the cached attestation token if
+ * there is one. The token goes along with a quote over the nonce of the request, without a nonce
+ * the full EK/AK binding info is sent. The license server asks again if it refuses the token,
+ * the token is then dropped and the full EK/AK binding info is sent. */
+static ovsa_status_t ovsa_do_send_platform_attestation(const int asym_keyslot,
+                                                       const char* license_serv_url,
+                                                       const char* read_buf,
+                                                       bool* token_presented,
+                                                       void** _ssl_session) {
+    ovsa_status_t ret = OVSA_OK;
+    char* token       = NULL;
+    char* payload     = NULL;
+    char* quote_nonce = NULL;
+
+    if (*token_presented) {
+        OVSA_DBG(DBG_I, "OVSA:Attestation token refused by license server '%s'\n",
+                 license_serv_url);
+        ovsa_attestation_token_cache_remove(license_serv_url);
+    } else {
+        *token_presented = true;
+        token            = ovsa_attestation_token_cache_get(license_serv_url);
+        if ((token != NULL) &&
+            (ovsa_license_service_extract_payload(read_buf, &payload) == OVSA_OK) &&
+            (payload != NULL) && (payload[0] != '\0') &&
+            (ovsa_json_extract_element(payload, "quote_nonce", &quote_nonce) == OVSA_OK) &&
+            (quote_nonce != NULL)) {
+            pthread_mutex_lock(&g_tpm_quote_lock);
+            ret = ovsa_send_attestation_token(token, quote_nonce, _ssl_session);
+            ovsa_remove_quote_files();
+            pthread_mutex_unlock(&g_tpm_quote_lock);
+            ovsa_safe_free(&token);
+            ovsa_safe_free(&payload);
+            ovsa_safe_free(&quote_nonce);
+            return ret;
+        }
+        ovsa_safe_free(&token);
+        ovsa_safe_free(&payload);
+        ovsa_safe_free(&quote_nonce);
+    }
+    return ovsa_send_EK_AK_bind_info(asym_keyslot, _ssl_session);
+}
+
+/* Keeps the attestation token issued by the license server after its quote verification */
+static ovsa_status_t ovsa_do_get_attestation_token(const char* license_serv_url,
+                                                   const char* read_buf) {
+    ovsa_status_t ret   = OVSA_OK;
+    char* token_payload = NULL;
+    char* token         = NULL;
+    char* validity      = NULL;
+    char* end           = NULL;
+    unsigned long secs  = 0;
+
+    ret = ovsa_license_service_extract_payload(read_buf, &token_payload);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token payload from json failed %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_json_extract_element(token_payload, "token", &token);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token from json failed %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_json_extract_element(token_payload, "validity", &validity);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read attestation token validity from json failed %d\n", ret);
+        goto out;
+    }
+    secs = strtoul(validity, &end, 10);
+    if ((end == validity) || (*end != '\0') || (secs == 0)) {
+        ret = OVSA_INVALID_PARAMETER;
+        OVSA_DBG(DBG_E, "OVSA: Error attestation token validity '%s' invalid\n", validity);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Attestation token valid for %lu seconds received from '%s'\n", secs,
+             license_serv_url);
+    ovsa_attestation_token_cache_store(license_serv_url, token, secs);
+out:
+    ovsa_safe_free(&token_payload);
+    ovsa_safe_free(&token);
+    ovsa_safe_free(&validity);
     return ret;
 }
+#endif
+
+static ovsa_license_check_stage_cb_t g_license_check_stage_cb = NULL;
+
+void ovsa_set_license_check_stage_cb(ovsa_license_check_stage_cb_t stage_cb) {
+    g_license_check_stage_cb = stage_cb;
+}
+
+/* Reports the time since the start of a stage, the next stage starts from now */
+static void ovsa_license_check_stage_done(ovsa_license_check_stage_t stage,
+                                          struct timespec* stage_start) {
+    struct timespec now;
+
+    if (g_license_check_stage_cb == NULL)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    g_license_check_stage_cb(stage, (now.tv_sec - stage_start->tv_sec) * 1000000ULL +
+                                        (now.tv_nsec - stage_start->tv_nsec) / 1000);
+    *stage_start = now;
+}
 
 ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char* customer_license,
                                              bool* status) {
     ovsa_status_t ret = OVSA_OK;
-    void* ssl_session = NULL;
-    unsigned char payload_len_str[PAYLOAD_LENGTH + 1];
-    size_t payload_size         = 0;
-    int peer_keyslot            = -1;
+    void* ssl_session           = NULL;
     unsigned char* read_buf     = NULL;
     unsigned char* command      = NULL;
     bool license_check_complete = false;
+    bool token_presented        = false;
     ovsa_command_type_t cmd     = OVSA_INVALID_CMD;
     char* cust_lic_sig_buf      = NULL;
+    char** leases               = NULL;
+    size_t lease_count          = 0;
+    char license_serv_url[MAX_URL_SIZE + 1];
+    struct timespec stage_start;
     ovsa_customer_license_sig_t customer_lic_sig;
+    OVSA_TRACE_SPAN(span);
     /* Set all pointers to NULL for KW fix */
     customer_lic_sig.customer_lic.isv_certificate  = NULL;
     customer_lic_sig.customer_lic.tcb_signatures   = NULL;
     customer_lic_sig.customer_lic.license_url_list = NULL;
 
-    ovsa_license_serv_url_list_t* license_url_list = NULL;
-    char license_serv_url[MAX_URL_SIZE + 1];
-    bool connected_to_license_server = false;
-
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    /* The license server joins its spans of this check with the same correlation ID */
+    OVSA_TRACE_NEW_CORRELATION_ID();
+    OVSA_TRACE_BEGIN(span, "license_check");
     /* Input Parameter Validation check */
     if ((asym_keyslot >= MIN_KEY_SLOT) && (customer_license != NULL)) {
-        memset_s(license_serv_url, sizeof(license_serv_url), 0);
-        memset_s(payload_len_str, sizeof(payload_len_str), 0);
         /*
          * Stage #1: Validation of Customer license
          */
-        /* Validate Customer license artefact */
-        peer_keyslot =
-            ovsa_validate_customer_license(customer_license, asym_keyslot, &cust_lic_sig_buf);
-        if ((peer_keyslot < MIN_KEY_SLOT) || (peer_keyslot >= MAX_KEY_SLOT)) {
-            ret = peer_keyslot;
+        /* Validate Customer license artefact, verified again only when the file changed */
+        ret = ovsa_get_verified_customer_license(customer_license, asym_keyslot,
+                                                 &cust_lic_sig_buf);
+        if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E,
                      "OVSA: Error customer license artifact validation failed with code %d\n", ret);
             goto out;
         }
-        /* clear peer keys from the key slots */
-        ovsa_crypto_clear_asymmetric_key_slot(peer_keyslot);
 
         /* Extract customer license json blob */
         memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
@@ -1095,60 +2862,20 @@ ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char*
          * Platform Validation using TLS library
          */
         OVSA_DBG(DBG_I, "OVSA: Perform Platform Validation using TLS \n");
-        /* Extract license server URL from customer license */
-        license_url_list = customer_lic_sig.customer_lic.license_url_list;
-
+        clock_gettime(CLOCK_MONOTONIC, &stage_start);
         /* Connect to license server url */
-        OVSA_DBG(DBG_I, "OVSA:Attempting to connect license server url ........\n\n");
-        if (license_url_list == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error license_url_list empty \n");
-            goto out;
-        } else {
-            int url_count = 0;
-            while (license_url_list != NULL) {
-                int len = strnlen_s(license_url_list->license_serv_url, MAX_URL_SIZE);
-                if (len <= MAX_URL_SIZE) {
-                    memcpy_s(license_serv_url, MAX_URL_SIZE, license_url_list->license_serv_url,
-                             len);
-                    license_serv_url[len] = '\0';
-                    OVSA_DBG(DBG_I, "OVSA:License_serv_url_%d: '%s' %s\n", url_count++,
-                             license_serv_url, license_url_list->license_serv_url);
-                    ret = ovsa_license_service_start(license_serv_url, NULL, &ssl_session,
-                                                     customer_lic_sig);
-                    if (ret < OVSA_OK) {
-                        OVSA_DBG(
-                            DBG_E,
-                            "OVSA: Error ovsa_license_service_start() failed to connect to license "
-                            "server "
-                            "'%s'\n\n",
-                            license_serv_url);
-                    } else {
-                        OVSA_DBG(DBG_I,
-                                 "OVSA:ovsa_license_service_start() connected to license server "
-                                 "'%s' \n\n",
-                                 license_serv_url);
-                        connected_to_license_server = true;
-                        break;
-                    }
-                } else {
-                    OVSA_DBG(
-                        DBG_E,
-                        "OVSA: Error incorrect length of URL failed to connect to license server "
-                        "'%s'\n\n",
-                        license_serv_url);
-                }
-                license_url_list = license_url_list->next;
-            }
-        }
-
-        OVSA_DBG(DBG_I, "OVSA:Connect to license server url status %s\n\n",
-                 connected_to_license_server ? "true" : "false");
-        if (!(connected_to_license_server == true)) {
-            OVSA_DBG(DBG_E, "OVSA: Error connect to license server url failed with %d\n", ret);
-            ret = OVSA_LICENSE_SERVER_CONNECT_FAIL;
+        ret = ovsa_license_service_connect(customer_lic_sig, license_serv_url, &ssl_session);
+        if (ret < OVSA_OK) {
+            /* A valid lease passes the license check, the connect failure is still returned so
+             * that the license check is retried soon */
+            if ((ret == OVSA_LICENSE_SERVER_CONNECT_FAIL) &&
+                (ovsa_license_lease_check(asym_keyslot, customer_license, cust_lic_sig_buf) ==
+                 OVSA_OK))
+                *status = true;
             goto out;
         }
         OVSA_DBG(DBG_I, "OVSA: Platform Validation completed successfully\n");
+        ovsa_license_check_stage_done(OVSA_LICENSE_CHECK_STAGE_CONNECT, &stage_start);
 
         do {
             /*
@@ -1156,75 +2883,53 @@ ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char*
              * Sign the received Nonce and send back
              */
 
-            /* Read payload length from server */
-            memset_s(payload_len_str, sizeof(payload_len_str), 0);
-            ret = ovsa_license_service_read(ssl_session, payload_len_str, PAYLOAD_LENGTH);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error read payload length from server failed with code %d\n",
-                         ret);
-                goto out;
-            }
-
-            payload_size = atoi((char*)payload_len_str);
-            if (payload_size < 0 || payload_size > SIZE_MAX) {
-                ret = OVSA_MEMORY_ALLOC_FAIL;
-                OVSA_DBG(DBG_E, "OVSA: Error read payload length from server is wrong\n");
-                goto out;
-            }
-
-            /* Read payload from server */
-            ret = ovsa_safe_malloc(sizeof(char) * payload_size + 1, (char**)&read_buf);
+            ret = ovsa_license_service_read_command(ssl_session, &read_buf, &command, &cmd);
             if (ret < OVSA_OK) {
-                ret = OVSA_MEMORY_ALLOC_FAIL;
-                OVSA_DBG(DBG_E, "OVSA: Error memory allocation of read buf failed with code %d\n",
-                         ret);
                 goto out;
             }
 
-            ret = ovsa_license_service_read(ssl_session, read_buf, payload_size);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error read payload from server failed with code %d\n", ret);
-                goto out;
-            }
-            OVSA_DBG(DBG_I, "OVSA: Received payload from server \n'%s'\n", read_buf);
-
-            /* Read command from Payload */
-            ret = ovsa_json_extract_element((char*)read_buf, "command", (char**)&command);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error read command from json failed %d\n", ret);
-                goto out;
-            }
-            cmd = ovsa_get_command_type((char*)command);
-
             switch (cmd) {
                 case OVSA_SEND_NONCE:
                     ret = ovsa_do_sign_send_nounce(asym_keyslot + 1, (char*)read_buf,
-                                                   cust_lic_sig_buf, &ssl_session);
+                                                   OVSA_SEND_CUST_LICENSE, cust_lic_sig_buf,
+                                                   &ssl_session);
                     if (ret < OVSA_OK) {
                         OVSA_DBG(DBG_E, "OVSA: Error read nonce from server failed with code %d\n",
                                  ret);
                         goto out;
                     }
+                    ovsa_license_check_stage_done(OVSA_LICENSE_CHECK_STAGE_NONCE, &stage_start);
                     break;
 #ifndef ENABLE_SGX_GRAMINE
                 case OVSA_SEND_EK_AK_BIND:
-                    ret = ovsa_send_EK_AK_bind_info(asym_keyslot, &ssl_session);
+                    ret = ovsa_do_send_platform_attestation(asym_keyslot, license_serv_url,
+                                                            (char*)read_buf, &token_presented,
+                                                            &ssl_session);
                     if (ret < OVSA_OK) {
                         OVSA_DBG(DBG_E, "OVSA: Error process EK_AK binding failed with code %d\n",
                                  ret);
                         goto out;
                     }
+                    ovsa_license_check_stage_done(OVSA_LICENSE_CHECK_STAGE_EK_AK_BIND,
+                                                  &stage_start);
+                    break;
+                case OVSA_SEND_ATTESTATION_TOKEN:
+                    /* The license check goes on without a token */
+                    ovsa_do_get_attestation_token(license_serv_url, (char*)read_buf);
                     break;
                 case OVSA_SEND_QUOTE_NONCE:
+                    pthread_mutex_lock(&g_tpm_quote_lock);
                     ret = ovsa_do_get_quote_nounce(asym_keyslot, (char*)read_buf, cust_lic_sig_buf,
                                                    &ssl_session);
+                    ovsa_remove_quote_files();
+                    pthread_mutex_unlock(&g_tpm_quote_lock);
                     if (ret < OVSA_OK) {
                         OVSA_DBG(DBG_E,
                                  "OVSA: Error read quote nonce from server failed with code %d\n",
                                  ret);
                         goto out;
                     }
-                    ovsa_remove_quote_files();
+                    ovsa_license_check_stage_done(OVSA_LICENSE_CHECK_STAGE_QUOTE, &stage_start);
                     break;
 #endif
                 case OVSA_SEND_UPDATE_CUST_LICENSE:
@@ -1248,6 +2953,7 @@ ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char*
                         goto out;
                     }
                     license_check_complete = true;
+                    ovsa_license_check_stage_done(OVSA_LICENSE_CHECK_STAGE_RESULT, &stage_start);
                     break;
                 default:
                     ret = OVSA_INVALID_CMD_TYPE;
@@ -1256,25 +2962,296 @@ ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char*
                     break;
             }
             ovsa_safe_free((char**)&command);
-            ovsa_safe_free((char**)&read_buf);
 
         } while (license_check_complete == false);
         *status = license_check_complete;
+
+        ovsa_do_get_license_leases(ssl_session, 1, &leases, &lease_count);
+        if (lease_count == 1)
+            ovsa_license_lease_store(asym_keyslot, customer_license, cust_lic_sig_buf, leases[0]);
     } else {
         OVSA_DBG(DBG_E, "OVSA: Error invalid Input parameter \n");
         ret = OVSA_INVALID_PARAMETER;
     }
 out:
+    ovsa_json_free_string_array(&leases, lease_count);
     ovsa_safe_free((char**)&command);
-    ovsa_safe_free((char**)&read_buf);
     ovsa_safe_free(&cust_lic_sig_buf);
     ovsa_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
     ovsa_safe_free_tcb_list(&customer_lic_sig.customer_lic.tcb_signatures);
     ovsa_safe_free_url_list(&customer_lic_sig.customer_lic.license_url_list);
-    mbedtls_net_free(&g_verifier_fd);
-    mbedtls_ctr_drbg_free(&g_ctr_drbg);
-    mbedtls_entropy_free(&g_entropy);
     ovsa_license_service_close(ssl_session);
+    OVSA_TRACE_END(span);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+/*
+ * Runs the license check protocol once for customer licenses served by the same license server,
+ * the licenses are sent together in place of the single customer license and the license server
+ * answers with the result of each of them, followed by their leases if it issues any.
+ */
+static ovsa_status_t ovsa_do_license_check_batch(const int asym_keyslot,
+                                                 ovsa_customer_license_sig_t customer_lic_sig,
+                                                 char* const* cust_lic_sig_bufs, size_t count,
+                                                 char*** responses, char*** leases,
+                                                 size_t* lease_count) {
+    ovsa_status_t ret           = OVSA_OK;
+    void* ssl_session           = NULL;
+    unsigned char* read_buf     = NULL;
+    unsigned char* command      = NULL;
+    char* cust_lic_batch        = NULL;
+    char* lic_check_payload     = NULL;
+    size_t response_count       = 0;
+    bool license_check_complete = false;
+    bool token_presented        = false;
+    ovsa_command_type_t cmd     = OVSA_INVALID_CMD;
+    char license_serv_url[MAX_URL_SIZE + 1];
+    OVSA_TRACE_SPAN(span);
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    OVSA_TRACE_NEW_CORRELATION_ID();
+    OVSA_TRACE_BEGIN(span, "license_check_batch");
+
+    ret = ovsa_json_create_string_array(cust_lic_sig_bufs, count, &cust_lic_batch);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create customer license batch failed with code %d\n", ret);
+        goto out;
+    }
+    /* Connect to license server url */
+    ret = ovsa_license_service_connect(customer_lic_sig, license_serv_url, &ssl_session);
+    if (ret < OVSA_OK) {
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA: Platform Validation completed successfully\n");
+
+    do {
+        ret = ovsa_license_service_read_command(ssl_session, &read_buf, &command, &cmd);
+        if (ret < OVSA_OK) {
+            goto out;
+        }
+
+        switch (cmd) {
+            case OVSA_SEND_NONCE:
+                ret = ovsa_do_sign_send_nounce(asym_keyslot + 1, (char*)read_buf,
+                                               OVSA_SEND_CUST_LICENSE_BATCH, cust_lic_batch,
+                                               &ssl_session);
+                if (ret < OVSA_OK) {
+                    OVSA_DBG(DBG_E, "OVSA: Error read nonce from server failed with code %d\n",
+                             ret);
+                    goto out;
+                }
+                break;
+#ifndef ENABLE_SGX_GRAMINE
+            case OVSA_SEND_EK_AK_BIND:
+                ret = ovsa_do_send_platform_attestation(asym_keyslot, license_serv_url,
+                                                        (char*)read_buf, &token_presented,
+                                                        &ssl_session);
+                if (ret < OVSA_OK) {
+                    OVSA_DBG(DBG_E, "OVSA: Error process EK_AK binding failed with code %d\n",
+                             ret);
+                    goto out;
+                }
+                break;
+            case OVSA_SEND_ATTESTATION_TOKEN:
+                /* The license check goes on without a token */
+                ovsa_do_get_attestation_token(license_serv_url, (char*)read_buf);
+                break;
+            case OVSA_SEND_QUOTE_NONCE:
+                pthread_mutex_lock(&g_tpm_quote_lock);
+                ret = ovsa_do_get_quote_nounce(asym_keyslot, (char*)read_buf, cust_lic_batch,
+                                               &ssl_session);
+                ovsa_remove_quote_files();
+                pthread_mutex_unlock(&g_tpm_quote_lock);
+                if (ret < OVSA_OK) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error read quote nonce from server failed with code %d\n",
+                             ret);
+                    goto out;
+                }
+                break;
+#endif
+            case OVSA_SEND_LICENSE_CHECK_RESP:
+                /* The batch was refused as a whole, e.g. by a license server without batches */
+                ovsa_do_get_license_check(asym_keyslot, (char*)read_buf);
+                ret = OVSA_LICENSE_CHECK_FAIL;
+                OVSA_DBG(DBG_E, "OVSA: Error license check of the batch failed with code %d\n",
+                         ret);
+                goto out;
+            case OVSA_SEND_LICENSE_CHECK_BATCH_RESP:
+                ret = ovsa_license_service_extract_payload((char*)read_buf, &lic_check_payload);
+                if (ret < OVSA_OK) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error read license check status payload from json failed "
+                             "%d\n",
+                             ret);
+                    goto out;
+                }
+                ret = ovsa_json_extract_string_array(lic_check_payload, count, responses,
+                                                     &response_count);
+                if ((ret < OVSA_OK) || (response_count != count)) {
+                    ovsa_json_free_string_array(responses, response_count);
+                    ret = OVSA_LICENSE_CHECK_FAIL;
+                    OVSA_DBG(DBG_E, "OVSA: Error read license check status of the batch failed\n");
+                    goto out;
+                }
+                license_check_complete = true;
+                break;
+            default:
+                ret = OVSA_INVALID_CMD_TYPE;
+                OVSA_DBG(DBG_E, "OVSA: Error received Invalid command %d from Server\n", cmd);
+                goto out;
+                break;
+        }
+        ovsa_safe_free((char**)&command);
+
+    } while (license_check_complete == false);
+    ovsa_do_get_license_leases(ssl_session, count, leases, lease_count);
+out:
+    ovsa_safe_free((char**)&command);
+    ovsa_safe_free(&cust_lic_batch);
+    ovsa_safe_free(&lic_check_payload);
+    ovsa_license_service_close(ssl_session);
+    OVSA_TRACE_END(span);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
+ovsa_status_t ovsa_perform_tls_license_check_batch(const int asym_keyslot,
+                                                   const char** customer_licenses, size_t count,
+                                                   bool* status) {
+    ovsa_status_t ret  = OVSA_OK;
+    size_t index       = 0;
+    size_t batch_count = 0;
+    bool in_batch      = false;
+    char** responses   = NULL;
+    char** leases      = NULL;
+    size_t lease_count = 0;
+    char* cust_lic_sig_bufs[MAX_LICENSE_BATCH_SIZE];
+    char* batch_lic_bufs[MAX_LICENSE_BATCH_SIZE];
+    size_t batch_index[MAX_LICENSE_BATCH_SIZE];
+    bool recheck[MAX_LICENSE_BATCH_SIZE];
+    ovsa_customer_license_sig_t customer_lic_sig;
+    ovsa_customer_license_sig_t lic_sig;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    /* Input Parameter Validation check */
+    if ((asym_keyslot < MIN_KEY_SLOT) || (customer_licenses == NULL) || (status == NULL) ||
+        (count == 0) || (count > MAX_LICENSE_BATCH_SIZE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid Input parameter \n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+    for (index = 0; index < count; index++) {
+        status[index]            = false;
+        recheck[index]           = false;
+        cust_lic_sig_bufs[index] = NULL;
+    }
+
+    /*
+     * Validate the customer licenses, those served by the license server of the first of them
+     * are checked together
+     */
+    for (index = 0; index < count; index++) {
+        if (customer_licenses[index] == NULL)
+            continue;
+        ret = ovsa_get_verified_customer_license(customer_licenses[index], asym_keyslot,
+                                                 &cust_lic_sig_bufs[index]);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error customer license artifact validation of %s failed with code "
+                     "%d\n",
+                     customer_licenses[index], ret);
+            continue;
+        }
+        recheck[index] = true;
+
+        in_batch = false;
+        memset_s(&lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+        ret = ovsa_json_extract_customer_license(cust_lic_sig_bufs[index], &lic_sig);
+        if ((ret == OVSA_OK) && (lic_sig.customer_lic.license_url_list != NULL)) {
+            if (batch_count == 0) {
+                memcpy_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), &lic_sig,
+                         sizeof(ovsa_customer_license_sig_t));
+                memset_s(&lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
+                in_batch = true;
+            } else {
+                in_batch =
+                    !strcmp(lic_sig.customer_lic.license_url_list->license_serv_url,
+                            customer_lic_sig.customer_lic.license_url_list->license_serv_url);
+            }
+        }
+        if (in_batch) {
+            batch_index[batch_count]      = index;
+            batch_lic_bufs[batch_count++] = cust_lic_sig_bufs[index];
+            recheck[index]                = false;
+        }
+        ovsa_safe_free(&lic_sig.customer_lic.isv_certificate);
+        ovsa_safe_free_tcb_list(&lic_sig.customer_lic.tcb_signatures);
+        ovsa_safe_free_url_list(&lic_sig.customer_lic.license_url_list);
+    }
+
+    ret = OVSA_OK;
+    if (batch_count > 1) {
+        OVSA_DBG(DBG_I, "OVSA: Perform License check of %zu customer licenses together\n",
+                 batch_count);
+        ret = ovsa_do_license_check_batch(asym_keyslot, customer_lic_sig, batch_lic_bufs,
+                                          batch_count, &responses, &leases, &lease_count);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error license check of the batch failed with code %d\n", ret);
+            /* Another connection to the same license servers would not fare better, the licenses
+             * with a valid lease pass until the license servers can be reached again */
+            if (ret != OVSA_LICENSE_SERVER_CONNECT_FAIL) {
+                for (index = 0; index < batch_count; index++)
+                    recheck[batch_index[index]] = true;
+                ret = OVSA_OK;
+            } else {
+                for (index = 0; index < batch_count; index++)
+                    status[batch_index[index]] =
+                        (ovsa_license_lease_check(asym_keyslot,
+                                                  customer_licenses[batch_index[index]],
+                                                  batch_lic_bufs[index]) == OVSA_OK);
+            }
+        } else {
+            for (index = 0; index < batch_count; index++) {
+                OVSA_DBG(DBG_I, "OVSA:Received license check result of %s from Server: '%s'\n",
+                         customer_licenses[batch_index[index]], responses[index]);
+                if (!strcmp(responses[index], "PASS")) {
+                    status[batch_index[index]] = true;
+                    if (lease_count == batch_count)
+                        ovsa_license_lease_store(asym_keyslot,
+                                                 customer_licenses[batch_index[index]],
+                                                 batch_lic_bufs[index], leases[index]);
+                } else if (!strcmp(responses[index], "UPDATE")) {
+                    recheck[batch_index[index]] = true;
+                }
+            }
+        }
+    } else if (batch_count == 1) {
+        recheck[batch_index[0]] = true;
+    }
+
+    /* Licenses of other license servers and those to be updated are checked one by one */
+    for (index = 0; index < count; index++) {
+        if (!recheck[index])
+            continue;
+        ovsa_status_t check_ret =
+            ovsa_perform_tls_license_check(asym_keyslot, customer_licenses[index], &status[index]);
+        if (check_ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error license check of %s failed with code %d\n",
+                     customer_licenses[index], check_ret);
+            if (ret == OVSA_OK)
+                ret = check_ret;
+        }
+    }
+
+    ovsa_json_free_string_array(&responses, batch_count);
+    ovsa_json_free_string_array(&leases, lease_count);
+    for (index = 0; index < count; index++)
+        ovsa_safe_free(&cust_lic_sig_bufs[index]);
+    ovsa_safe_free(&customer_lic_sig.customer_lic.isv_certificate);
+    ovsa_safe_free_tcb_list(&customer_lic_sig.customer_lic.tcb_signatures);
+    ovsa_safe_free_url_list(&customer_lic_sig.customer_lic.license_url_list);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
@@ -17,36 +17,428 @@
 
 #include <fnmatch.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "runtime.h"
+#include "trace.h"
 #include "utils.h"
 
 /* json.h to be included at end due to dependencies */
 #include "json.h"
 
+/* Plain text segment each thread of the parallel model loader decrypts at a time */
+#define DECRYPT_SEGMENT_SIZE (4 * 1024 * 1024)
+#define MAX_DECRYPT_THREADS  16
+
+/* Encrypted model file and the sink buffer the parallel model loader decrypts it into */
+typedef struct ovsa_decrypt_file {
+    const char* enc_buff;
+    size_t enc_buff_len;
+    bool b64_format;
+    /* AES-256-GCM segments, decrypted and verified one segment at a time */
+    bool gcm_format;
+    int keyiv_hmac_slot;
+    size_t file_length;
+    char* file_buff;
+} ovsa_decrypt_file_t;
+
+/* Work shared by the decryption threads, each one picks the next segment under the lock */
+typedef struct ovsa_decrypt_pool {
+    ovsa_decrypt_file_t* files;
+    int file_count;
+    int next_file;
+    size_t next_offset;
+    ovsa_status_t ret;
+    pthread_mutex_t lock;
+} ovsa_decrypt_pool_t;
+
+/* Sink of ovsa_license_check_module(), collecting the decrypted files in a list */
+typedef struct ovsa_model_file_list_sink {
+    ovsa_model_files_t* head;
+    ovsa_model_files_t* tail;
+    size_t max_file_length;
+} ovsa_model_file_list_sink_t;
+
+static ovsa_status_t ovsa_model_file_list_open(void* sink_ctx, const char* model_file_name,
+                                               size_t max_file_length) {
+    ovsa_model_file_list_sink_t* list = (ovsa_model_file_list_sink_t*)sink_ctx;
+    ovsa_model_files_t* model_file    = NULL;
+    ovsa_status_t ret                 = OVSA_OK;
+
+    /* Memory allocated and this needs to be freed by consumer */
+    ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&model_file);
+    if (ret < OVSA_OK || model_file == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    memcpy_s(model_file->model_file_name, MAX_NAME_SIZE, model_file_name, MAX_NAME_SIZE);
+    model_file->model_file_length = 0;
+    model_file->next              = NULL;
+    if (list->head == NULL) {
+        list->head = model_file;
+    } else {
+        list->tail->next = model_file;
+    }
+    list->tail            = model_file;
+    list->max_file_length = max_file_length;
+
+    /* The plain text model never reaches swap or a core dump */
+    ret = ovsa_crypto_secure_malloc((max_file_length + 1) * sizeof(char),
+                                    &model_file->model_file_data);
+    if (ret < OVSA_OK) {
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error memory alloc fail for model file with code %d\n", ret);
+    }
+    return ret;
+}
+
+static ovsa_status_t ovsa_model_file_list_write(void* sink_ctx, const char* buff,
+                                                size_t buff_len) {
+    ovsa_model_file_list_sink_t* list = (ovsa_model_file_list_sink_t*)sink_ctx;
+    ovsa_model_files_t* model_file    = list->tail;
+
+    if (memcpy_s(model_file->model_file_data + model_file->model_file_length,
+                 list->max_file_length - model_file->model_file_length, buff,
+                 buff_len) != EOK) {
+        OVSA_DBG(DBG_E, "OVSA: Error decrypted model file exceeds its length\n");
+        return OVSA_MEMIO_ERROR;
+    }
+    model_file->model_file_length += buff_len;
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_get_model_file_segment(
+    const ovsa_controlled_access_model_t* controlled_access_model,
+    const ovsa_model_files_t* enc_model, const char** model_segment, size_t* model_segment_len) {
+    ovsa_status_t ret   = OVSA_OK;
+    const char* segment = NULL;
+    size_t segments_len = 0;
+    size_t segment_len  = 0;
+    int hash_indicator  = -1;
+    char segment_hash[HASH_SIZE];
+
+    segments_len = controlled_access_model->enc_model_map_len -
+                   controlled_access_model->enc_model_segments_offset;
+    segment_len = (size_t)enc_model->model_file_length;
+    if ((controlled_access_model->enc_model_map == NULL) ||
+        (enc_model->model_file_offset > segments_len) ||
+        (segment_len > segments_len - enc_model->model_file_offset)) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment of %s exceeds the controlled access model\n",
+                 enc_model->model_file_name);
+        return OVSA_INVALID_PARAMETER;
+    }
+    /* The tool does not protect empty model files, a segment without cipher text is refused */
+    if (segment_len <= ENCRYPT_HEADER_LEN) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment of %s is empty\n", enc_model->model_file_name);
+        return OVSA_INVALID_PARAMETER;
+    }
+    segment = controlled_access_model->enc_model_map +
+              controlled_access_model->enc_model_segments_offset + enc_model->model_file_offset;
+
+    /* The segment hash is covered by the header signature, check it before decrypting */
+    if (controlled_access_model->gcm_format) {
+        /* Only the tags are hashed, the cipher text is verified against them while decrypting */
+        ret = ovsa_crypto_compute_gcm_tags_hash(segment, segment_len,
+                                                (unsigned char*)segment_hash);
+    } else {
+        ret = ovsa_crypto_compute_buff_hash(segment, segment_len, HASH_ALG_SHA512,
+                                            (unsigned char*)segment_hash, true /*FORMAT_BASE64*/);
+    }
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment HASH generation failed with code %d\n", ret);
+        return ret;
+    }
+    strcmp_s(enc_model->model_file_hash, HASH_SIZE, segment_hash, &hash_indicator);
+    if (hash_indicator != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment HASH of %s does not match\n",
+                 enc_model->model_file_name);
+        return OVSA_CONTROLED_ACCESS_MODEL_HASH_VALIDATION_FAILED;
+    }
+    *model_segment     = segment;
+    *model_segment_len = segment_len;
+    return ret;
+}
+
+static ovsa_status_t ovsa_decrypt_model_file_segment(
+    const int sym_key_slot, const ovsa_controlled_access_model_t* controlled_access_model,
+    const ovsa_model_files_t* enc_model, const ovsa_model_file_sink_t* sink,
+    size_t* decrypt_model_len, int* keyiv_hmac_slot) {
+    ovsa_status_t ret   = OVSA_OK;
+    const char* segment = NULL;
+    size_t segment_len  = 0;
+
+    if ((sink->reuse_file != NULL) &&
+        sink->reuse_file(sink->sink_ctx, enc_model->model_file_name, enc_model->model_file_hash)) {
+        OVSA_DBG(DBG_I, "OVSA: Model file %s reused from a previous version\n",
+                 enc_model->model_file_name);
+        /* No key/IV/HMAC was derived for the segment */
+        *keyiv_hmac_slot = -1;
+        return OVSA_OK;
+    }
+    ret = ovsa_get_model_file_segment(controlled_access_model, enc_model, &segment, &segment_len);
+    if (ret < OVSA_OK) {
+        return ret;
+    }
+
+    if (controlled_access_model->gcm_format) {
+        ret = sink->open_file(sink->sink_ctx, enc_model->model_file_name,
+                              ovsa_crypto_get_gcm_plain_text_len(segment, segment_len));
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not open model file %s with code %d\n",
+                     enc_model->model_file_name, ret);
+            return ret;
+        }
+        return ovsa_crypto_decrypt_gcm_mem_stream(sym_key_slot, segment, segment_len,
+                                                  sink->write_file, sink->sink_ctx,
+                                                  decrypt_model_len, keyiv_hmac_slot);
+    }
+
+    ret = sink->open_file(sink->sink_ctx, enc_model->model_file_name,
+                          ovsa_crypto_get_raw_decrypt_mem_len(segment_len));
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not open model file %s with code %d\n",
+                 enc_model->model_file_name, ret);
+        return ret;
+    }
+    return ovsa_crypto_decrypt_raw_mem_stream(sym_key_slot, segment, segment_len,
+                                              sink->write_file, sink->sink_ctx,
+                                              decrypt_model_len, keyiv_hmac_slot);
+}
+
+static void* ovsa_decrypt_model_file_worker(void* arg) {
+    ovsa_decrypt_pool_t* pool = (ovsa_decrypt_pool_t*)arg;
+    ovsa_decrypt_file_t* file = NULL;
+    ovsa_status_t ret         = OVSA_OK;
+    size_t offset             = 0;
+    size_t length             = 0;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while ((pool->next_file < pool->file_count) &&
+               ((pool->files[pool->next_file].file_buff == NULL) ||
+                (pool->next_offset >= pool->files[pool->next_file].file_length))) {
+            pool->next_file++;
+            pool->next_offset = 0;
+        }
+        if ((pool->ret < OVSA_OK) || (pool->next_file >= pool->file_count)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        file   = &pool->files[pool->next_file];
+        offset = pool->next_offset;
+        length = file->file_length - offset;
+        if (length > (file->gcm_format ? ENCRYPT_GCM_SEGMENT_SIZE : DECRYPT_SEGMENT_SIZE)) {
+            length = file->gcm_format ? ENCRYPT_GCM_SEGMENT_SIZE : DECRYPT_SEGMENT_SIZE;
+        }
+        pool->next_offset += length;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (file->gcm_format) {
+            /* Decrypted and verified against its tag in the same pass */
+            ret = ovsa_crypto_decrypt_gcm_range(file->keyiv_hmac_slot, file->enc_buff,
+                                                file->enc_buff_len, offset, length,
+                                                file->file_buff + offset);
+        } else {
+            /* CTR mode, the segment is decrypted independently of the others */
+            ret = ovsa_crypto_decrypt_mem_range(file->keyiv_hmac_slot, file->enc_buff,
+                                                file->enc_buff_len, file->b64_format, offset,
+                                                length, file->file_buff + offset);
+        }
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error decrypt model file segment failed with code %d\n", ret);
+            pthread_mutex_lock(&pool->lock);
+            if (pool->ret == OVSA_OK) {
+                pool->ret = ret;
+            }
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+    }
+    return NULL;
+}
+
+static ovsa_status_t ovsa_do_decrypt_model_files_parallel(
+    const int sym_key_slot, ovsa_controlled_access_model_t* controlled_access_model,
+    const ovsa_model_file_sink_t* sink) {
+    ovsa_status_t ret                  = OVSA_OK;
+    ovsa_model_files_t* enc_model_list = NULL;
+    ovsa_decrypt_file_t* file          = NULL;
+    int file_count                     = 0;
+    int thread_count                   = 0;
+    int i                              = 0;
+    size_t len                         = 0;
+    pthread_t threads[MAX_DECRYPT_THREADS];
+    ovsa_decrypt_pool_t pool;
+
+    memset_s(&pool, sizeof(ovsa_decrypt_pool_t), 0);
+    for (enc_model_list = controlled_access_model->enc_model; enc_model_list != NULL;
+         enc_model_list = enc_model_list->next) {
+        file_count++;
+    }
+    ret = ovsa_safe_malloc(file_count * sizeof(ovsa_decrypt_file_t), (char**)&pool.files);
+    if (ret < OVSA_OK || pool.files == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    for (i = 0; i < file_count; i++) {
+        pool.files[i].keyiv_hmac_slot = -1;
+    }
+    pool.file_count = file_count;
+
+    /* Derive the key/IV of each file and get the buffers, before any thread is started */
+    for (i = 0, enc_model_list = controlled_access_model->enc_model; enc_model_list != NULL;
+         i++, enc_model_list = enc_model_list->next) {
+        file = &pool.files[i];
+        if (controlled_access_model->binary_format && (sink->reuse_file != NULL) &&
+            sink->reuse_file(sink->sink_ctx, enc_model_list->model_file_name,
+                             enc_model_list->model_file_hash)) {
+            /* Left without a buffer, the threads skip the file */
+            OVSA_DBG(DBG_I, "OVSA: Model file %s reused from a previous version\n",
+                     enc_model_list->model_file_name);
+            continue;
+        }
+        if (controlled_access_model->binary_format) {
+            ret = ovsa_get_model_file_segment(controlled_access_model, enc_model_list,
+                                              &file->enc_buff, &file->enc_buff_len);
+            if (ret < OVSA_OK) {
+                goto out;
+            }
+            file->b64_format = false;
+            file->gcm_format = controlled_access_model->gcm_format;
+            ret = ovsa_crypto_derive_raw_keyiv_hmac(sym_key_slot, file->enc_buff,
+                                                    file->enc_buff_len, &file->keyiv_hmac_slot);
+        } else {
+            len = 0;
+            ret = ovsa_get_string_length(enc_model_list->model_file_data, &len);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error could not get length of model file string %d\n",
+                         ret);
+                goto out;
+            }
+            file->enc_buff     = enc_model_list->model_file_data;
+            file->enc_buff_len = len;
+            file->b64_format   = true;
+            ret = ovsa_crypto_derive_keyiv_hmac(sym_key_slot, file->enc_buff, file->enc_buff_len,
+                                                &file->keyiv_hmac_slot);
+        }
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error deriving key/IV of %s failed with code %d\n",
+                     enc_model_list->model_file_name, ret);
+            goto out;
+        }
+        if (file->gcm_format) {
+            file->file_length =
+                ovsa_crypto_get_gcm_plain_text_len(file->enc_buff, file->enc_buff_len);
+        } else {
+            file->file_length = ovsa_crypto_get_plain_text_len(file->enc_buff, file->enc_buff_len,
+                                                               file->b64_format);
+        }
+        if (file->file_length == 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error model file %s is malformed\n",
+                     enc_model_list->model_file_name);
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
+        ret = sink->open_file(sink->sink_ctx, enc_model_list->model_file_name, file->file_length);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not open model file %s with code %d\n",
+                     enc_model_list->model_file_name, ret);
+            goto out;
+        }
+        /* A NULL buffer means the sink is not interested in the file */
+        ret = sink->get_file_buff(sink->sink_ctx, file->file_length, &file->file_buff);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not get buffer of model file %s with code %d\n",
+                     enc_model_list->model_file_name, ret);
+            goto out;
+        }
+    }
+
+    if (pthread_mutex_init(&pool.lock, NULL) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing the decryption mutex failed\n");
+        ret = OVSA_MUTEX_INIT_FAIL;
+        goto out;
+    }
+    thread_count = sink->decrypt_threads;
+    if (thread_count > MAX_DECRYPT_THREADS) {
+        thread_count = MAX_DECRYPT_THREADS;
+    }
+    /* The calling thread is one of the workers, fewer threads only slow the decryption down */
+    for (i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&threads[i], NULL, ovsa_decrypt_model_file_worker, &pool) != 0) {
+            break;
+        }
+    }
+    thread_count = i;
+    OVSA_DBG(DBG_I, "OVSA: Decrypting model files on %d threads\n", thread_count + 1);
+    ovsa_decrypt_model_file_worker(&pool);
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+    ret = pool.ret;
+    if (ret < OVSA_OK) {
+        goto out;
+    }
+
+    for (enc_model_list = controlled_access_model->enc_model; enc_model_list != NULL;
+         enc_model_list = enc_model_list->next) {
+        OVSA_DBG(DBG_I, "OVSA: Decrypt model file : %s Successful\n",
+                 enc_model_list->model_file_name);
+        /* The encrypted file is not needed anymore */
+        ovsa_safe_free(&enc_model_list->model_file_data);
+    }
+
+out:
+    for (i = 0; i < file_count; i++) {
+        /* clear key/IV/HMAC from the key slot */
+        ovsa_crypto_clear_symmetric_key_slot(pool.files[i].keyiv_hmac_slot);
+    }
+    ovsa_safe_free((char**)&pool.files);
+    return ret;
+}
+
+static ovsa_model_load_stage_cb_t g_model_load_stage_cb = NULL;
+
+void ovsa_set_model_load_stage_cb(ovsa_model_load_stage_cb_t stage_cb) {
+    g_model_load_stage_cb = stage_cb;
+}
+
+/* Reports the time since the start of a stage, the next stage starts from now */
+static void ovsa_model_load_stage_done(ovsa_model_load_stage_t stage,
+                                       struct timespec* stage_start) {
+    struct timespec now;
+
+    if (g_model_load_stage_cb == NULL)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    g_model_load_stage_cb(stage, (now.tv_sec - stage_start->tv_sec) * 1000000ULL +
+                                     (now.tv_nsec - stage_start->tv_nsec) / 1000);
+    *stage_start = now;
+}
+
 static ovsa_status_t ovsa_do_decrypt_model_files(
     const int asym_key_slot, const int peer_slot, ovsa_customer_license_sig_t* customer_lic_sig,
     ovsa_controlled_access_model_sig_t* controlled_access_model_sig,
-    ovsa_model_files_t** decrypted_files) {
-    ovsa_status_t ret         = OVSA_OK;
-    size_t decrypt_model_len  = 0;
-    char* decrypted_model_buf = NULL;
-    int sym_key_slot          = -1;
-    int keyiv_hmac_slot       = -1;
-    char* enc_model           = NULL;
+    const ovsa_model_file_sink_t* sink, struct timespec* stage_start) {
+    ovsa_status_t ret        = OVSA_OK;
+    size_t decrypt_model_len = 0;
+    int sym_key_slot         = -1;
+    int keyiv_hmac_slot      = -1;
+    char* enc_model          = NULL;
     char encryption_key[MAX_EKEY_SIZE];
+    OVSA_TRACE_SPAN(span);
 
     ovsa_model_files_t* enc_model_list = NULL;
     ovsa_model_files_t* enc_model_head = NULL;
-    ovsa_model_files_t* dec_model_head = NULL;
-    ovsa_model_files_t* dec_model_tail = NULL;
-    ovsa_model_files_t* dec_model_cur  = NULL;
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
     memset_s(encryption_key, sizeof(encryption_key), 0);
     memcpy_s(encryption_key, MAX_EKEY_SIZE, customer_lic_sig->customer_lic.encryption_key,
@@ -56,8 +448,10 @@ static ovsa_status_t ovsa_do_decrypt_model_files(
     encrypt_key_buff_len        = strnlen_s(encryption_key, RSIZE_MAX_STR);
 
     /* Unwrap model encryption key */
+    OVSA_TRACE_BEGIN(span, "model_key_unwrap");
     ret = ovsa_crypto_unwrap_key(asym_key_slot, peer_slot, encryption_key, encrypt_key_buff_len,
                                  &sym_key_slot, &keyiv_hmac_slot);
+    OVSA_TRACE_END(span);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error unwrap model encryption key failed with code  %d\n", ret);
         goto out;
@@ -69,13 +463,48 @@ static ovsa_status_t ovsa_do_decrypt_model_files(
     ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
 
     OVSA_DBG(DBG_I, "OVSA: Unwrap model encryption key Successful \n");
+    ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_KEY_UNWRAP, stage_start);
     enc_model_head = controlled_access_model_sig->controlled_access_model.enc_model;
     enc_model_list = enc_model_head;
+    OVSA_TRACE_BEGIN(span, "model_decrypt");
 
     if (enc_model_list == NULL) {
         OVSA_DBG(DBG_E, "OVSA: Error model file empty  \n");
+    } else if (controlled_access_model_sig->controlled_access_model.gcm_format &&
+               !controlled_access_model_sig->controlled_access_model.binary_format) {
+        /* GCM segments are only defined for the binary controlled access model */
+        OVSA_DBG(DBG_E, "OVSA: Error GCM encrypted model files are not in segments\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    } else if ((sink->get_file_buff != NULL) && (sink->decrypt_threads > 1)) {
+        ret = ovsa_do_decrypt_model_files_parallel(
+            sym_key_slot, &controlled_access_model_sig->controlled_access_model, sink);
+        if (ret != OVSA_OK) {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error decrypt controlled access model files failed with code %d\n",
+                     ret);
+            goto out;
+        }
+        OVSA_DBG(DBG_D, "\nControlled Access Model files Decrypted Successfully \n");
     } else {
         while (enc_model_list != NULL) {
+            if (controlled_access_model_sig->controlled_access_model.binary_format) {
+                ret = ovsa_decrypt_model_file_segment(
+                    sym_key_slot, &controlled_access_model_sig->controlled_access_model,
+                    enc_model_list, sink, &decrypt_model_len, &keyiv_hmac_slot);
+                if (ret != OVSA_OK) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error decrypt controlled access model segment failed with "
+                             "code %d\n",
+                             ret);
+                    goto out;
+                }
+                ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+                OVSA_DBG(DBG_I, "OVSA: Decrypt model file : %s Successful\n",
+                         enc_model_list->model_file_name);
+                enc_model_list = enc_model_list->next;
+                continue;
+            }
             enc_model  = enc_model_list->model_file_data;
             size_t len = 0;
             ret        = ovsa_get_string_length(enc_model, &len);
@@ -84,14 +513,21 @@ static ovsa_status_t ovsa_do_decrypt_model_files(
                          ret);
                 goto out;
             }
+            ret = sink->open_file(sink->sink_ctx, enc_model_list->model_file_name,
+                                  ovsa_crypto_get_decrypt_mem_len(len));
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error could not open model file %s with code %d\n",
+                         enc_model_list->model_file_name, ret);
+                goto out;
+            }
             /* Decrypt controlled access model files */
-            ret = ovsa_crypto_decrypt_mem(sym_key_slot, enc_model, len, &decrypted_model_buf,
-                                          &decrypt_model_len, &keyiv_hmac_slot);
-            if (ret != OVSA_OK || decrypted_model_buf == NULL) {
+            ret = ovsa_crypto_decrypt_mem_stream(sym_key_slot, enc_model, len, sink->write_file,
+                                                 sink->sink_ctx, &decrypt_model_len,
+                                                 &keyiv_hmac_slot);
+            if (ret != OVSA_OK) {
                 OVSA_DBG(DBG_E,
                          "OVSA: Error decrypt controlled access model files failed with code %d\n",
                          ret);
-                ovsa_safe_free(&decrypted_model_buf);
                 goto out;
             }
 
@@ -100,53 +536,14 @@ static ovsa_status_t ovsa_do_decrypt_model_files(
             OVSA_DBG(DBG_I, "OVSA: Decrypt model file : %s Successful\n",
                      enc_model_list->model_file_name);
 
-            if (dec_model_head == NULL) {
-                /* Memory allocated and this needs to be freed by consumer */
-                ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&dec_model_head);
-                if (ret < OVSA_OK || dec_model_head == NULL) {
-                    OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-                    ovsa_safe_free(&decrypted_model_buf);
-                    goto out;
-                }
-                memcpy_s(dec_model_head->model_file_name, MAX_NAME_SIZE,
-                         enc_model_list->model_file_name, MAX_NAME_SIZE);
-                dec_model_head->model_file_length = decrypt_model_len;
-                dec_model_head->next              = NULL;
-                dec_model_tail                    = dec_model_head;
-            } else {
-                /* Memory allocated and this needs to be freed by consumer */
-                ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&dec_model_cur);
-                if (ret < OVSA_OK || dec_model_cur == NULL) {
-                    OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-                    ovsa_safe_free_model_file_list(&dec_model_head);
-                    ovsa_safe_free(&decrypted_model_buf);
-                    goto out;
-                }
-                memcpy_s(dec_model_cur->model_file_name, MAX_NAME_SIZE,
-                         enc_model_list->model_file_name, MAX_NAME_SIZE);
-                dec_model_cur->model_file_length = decrypt_model_len;
-                dec_model_cur->next              = NULL;
-                dec_model_tail->next             = dec_model_cur;
-                dec_model_tail                   = dec_model_cur;
-            }
-            ret = ovsa_safe_malloc((decrypt_model_len + 1) * sizeof(char),
-                                   &dec_model_tail->model_file_data);
-            if (ret < OVSA_OK) {
-                ret = OVSA_MEMORY_ALLOC_FAIL;
-                OVSA_DBG(DBG_E, "OVSA: Error memory alloc fail for xml file with code %d\n", ret);
-                ovsa_safe_free_model_file_list(&dec_model_head);
-                ovsa_safe_free(&decrypted_model_buf);
-                goto out;
-            }
-            memcpy_s(dec_model_tail->model_file_data, decrypt_model_len, decrypted_model_buf,
-                     decrypt_model_len);
-            ovsa_safe_free(&decrypted_model_buf);
-            decrypted_model_buf = NULL;
-            enc_model_list      = enc_model_list->next;
+            /* The encrypted file is not needed anymore, release it before the next one */
+            ovsa_safe_free(&enc_model_list->model_file_data);
+            enc_model_list = enc_model_list->next;
         }
-        *decrypted_files = dec_model_head;
         OVSA_DBG(DBG_D, "\nControlled Access Model files Decrypted Successfully \n");
     }
+    ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_DECRYPT, stage_start);
+    OVSA_TRACE_END(span);
 out:
     /* clear key/IV/HMAC from the key slot */
     ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
@@ -159,14 +556,17 @@ out:
 ovsa_status_t ovsa_start_model_loader(
     const int asym_key_slot, const int peer_slot, char* customer_lic_sig_buf,
     ovsa_controlled_access_model_sig_t* controlled_access_model_sig,
-    ovsa_model_files_t** decrypted_files) {
+    const ovsa_model_file_sink_t* sink) {
     ovsa_status_t ret = OVSA_OK;
+    struct timespec stage_start;
     ovsa_customer_license_sig_t customer_lic_sig;
     /* Set all pointers to NULL for KW fix */
     customer_lic_sig.customer_lic.isv_certificate  = NULL;
     customer_lic_sig.customer_lic.tcb_signatures   = NULL;
     customer_lic_sig.customer_lic.license_url_list = NULL;
 
+    /* The extraction of the wrapped key is part of the key unwrap stage */
+    clock_gettime(CLOCK_MONOTONIC, &stage_start);
     /* Extract customer license json blob */
     memset_s(&customer_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
     ret = ovsa_json_extract_customer_license(customer_lic_sig_buf, &customer_lic_sig);
@@ -177,7 +577,7 @@ ovsa_status_t ovsa_start_model_loader(
     }
     /* Decrypt the model files */
     ret = ovsa_do_decrypt_model_files(asym_key_slot, peer_slot, &customer_lic_sig,
-                                      controlled_access_model_sig, decrypted_files);
+                                      controlled_access_model_sig, sink, &stage_start);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Could not decrypt model files\n");
         goto out;
@@ -192,63 +592,109 @@ out:
     return ret;
 }
 
-ovsa_status_t ovsa_license_check_module(const char* keystore, const char* controlled_access_model,
-                                        const char* customer_license,
-                                        ovsa_model_files_t** decrypted_files) {
+/* Loads the customer keystore and verifies its certificate, the key slot is released to the
+ * keystore cache on failure */
+static ovsa_status_t ovsa_load_customer_keystore(const char* keystore, int* asym_keyslot,
+                                                 struct timespec* stage_start) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t certlen    = 0;
+    char* certificate = NULL;
+    OVSA_TRACE_SPAN(span);
+
+    OVSA_DBG(DBG_I, "OVSA: Load Asymmetric Key\n");
+    /* Get Asym Key Slot from Key store */
+    ret = ovsa_keystore_cache_get(keystore, asym_keyslot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error get keyslot failed with code %d\n", ret);
+        *asym_keyslot = -1;
+        return ret;
+    }
+    if (stage_start != NULL)
+        ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_KEYSTORE, stage_start);
+
+    /* Get customer certificate from key slot */
+    ret = ovsa_crypto_get_certificate(*asym_keyslot, &certificate);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error get customer certificate failed with code %d\n", ret);
+        goto out;
+    }
+
+    OVSA_DBG(DBG_I, "OVSA: Verify customer certificate\n");
+    ret = ovsa_get_string_length(certificate, &certlen);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of customer certificate %d\n", ret);
+        goto out;
+    }
+    if ((!certlen) || (certlen > MAX_CERT_SIZE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error cusotmer certificate length is invalid \n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    /*Verify customer certificate*/
+    OVSA_TRACE_BEGIN(span, "customer_cert_verify");
+    ret = ovsa_crypto_verify_certificate(*asym_keyslot, /* PEER CERT */ false, certificate,
+                                         /* lifetime_validity_check */ true);
+    OVSA_TRACE_END(span);
+
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error verify customer certificate failed with code %d\n", ret);
+        goto out;
+    }
+    if (stage_start != NULL)
+        ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_CERT_VERIFY, stage_start);
+
+out:
+    if (ret != OVSA_OK) {
+        ovsa_keystore_cache_put(*asym_keyslot);
+        *asym_keyslot = -1;
+    }
+    ovsa_safe_free(&certificate);
+    return ret;
+}
+
+ovsa_status_t ovsa_verify_keystore(const char* keystore) {
+    ovsa_status_t ret = OVSA_OK;
+    int asym_keyslot  = -1;
+
+    if (keystore == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid keystore \n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    ret = ovsa_load_customer_keystore(keystore, &asym_keyslot, NULL);
+    /* release asymmetric key pairs to the keystore cache */
+    ovsa_keystore_cache_put(asym_keyslot);
+    return ret;
+}
+
+ovsa_status_t ovsa_license_check_module_sink(const char* keystore,
+                                             const char* controlled_access_model,
+                                             const char* customer_license,
+                                             const ovsa_model_file_sink_t* sink) {
     ovsa_status_t ret      = OVSA_OK;
     int asym_keyslot       = -1;
-    size_t certlen         = 0;
-    char* certificate      = NULL;
     char* cust_lic_sig_buf = NULL;
     int peer_keyslot       = -1;
+    struct timespec stage_start;
     ovsa_controlled_access_model_sig_t control_access_model_sig;
     ovsa_customer_license_sig_t cust_lic_sig;
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+    clock_gettime(CLOCK_MONOTONIC, &stage_start);
     memset_s(&control_access_model_sig, sizeof(ovsa_controlled_access_model_sig_t), 0);
     memset_s(&cust_lic_sig, sizeof(ovsa_customer_license_sig_t), 0);
 
     /* Input Parameter Validation check */
-    if ((controlled_access_model != NULL) && (customer_license != NULL) && (keystore != NULL)) {
-        OVSA_DBG(DBG_I, "OVSA: Load Asymmetric Key\n");
-        /* Get Asym Key Slot from Key store */
-        ret = ovsa_crypto_load_asymmetric_key(keystore, &asym_keyslot);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error get keyslot failed with code %d\n", ret);
-            goto out;
-        }
-
-        /* Get customer certificate from key slot */
-        ret = ovsa_crypto_get_certificate(asym_keyslot, &certificate);
-        if (ret != OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error get customer certificate failed with code %d\n", ret);
-            goto out;
-        }
-
-        OVSA_DBG(DBG_I, "OVSA: Verify customer certificate\n");
-        ret = ovsa_get_string_length(certificate, &certlen);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of customer certificate %d\n", ret);
-            goto out;
-        }
-        if ((!certlen) || (certlen > MAX_CERT_SIZE)) {
-            OVSA_DBG(DBG_E, "OVSA: Error cusotmer certificate length is invalid \n");
-            ret = OVSA_INVALID_PARAMETER;
-            goto out;
-        }
-        /*Verify customer certificate*/
-        ret = ovsa_crypto_verify_certificate(asym_keyslot, /* PEER CERT */ false, certificate,
-                                             /* lifetime_validity_check */ true);
-
+    if ((controlled_access_model != NULL) && (customer_license != NULL) && (keystore != NULL) &&
+        (sink != NULL) && (sink->open_file != NULL) && (sink->write_file != NULL)) {
+        ret = ovsa_load_customer_keystore(keystore, &asym_keyslot, &stage_start);
         if (ret != OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error verify customer certificate failed with code %d\n", ret);
             goto out;
         }
         /* Validate Customer license artefact */
         OVSA_DBG(DBG_I, "OVSA: Validate customer license\n");
         peer_keyslot =
             ovsa_validate_customer_license(customer_license, asym_keyslot, &cust_lic_sig_buf);
-        if ((peer_keyslot < MIN_KEY_SLOT) || (peer_keyslot >= MAX_KEY_SLOT)) {
+        if (peer_keyslot < MIN_KEY_SLOT) {
             ret = peer_keyslot;
             OVSA_DBG(DBG_E,
                      "OVSA: Error customer license artifact validation failed with code %d\n", ret);
@@ -265,6 +711,7 @@ ovsa_status_t ovsa_license_check_module(const char* keystore, const char* contro
                 ret);
             goto out;
         }
+        ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_LICENSE_VALIDATE, &stage_start);
     } else {
         OVSA_DBG(DBG_E, "OVSA: Error invalid artifacts \n");
         ret = OVSA_INVALID_PARAMETER;
@@ -273,27 +720,71 @@ ovsa_status_t ovsa_license_check_module(const char* keystore, const char* contro
     /* Perform License Check Sequence */
     bool status = false;
     ret         = ovsa_perform_tls_license_check(asym_keyslot, customer_license, &status);
-    if ((!status) || ret != OVSA_OK) {
+    if ((!status) || ((ret != OVSA_OK) && (ret != OVSA_LICENSE_SERVER_CONNECT_FAIL))) {
         OVSA_DBG(DBG_E, "OVSA: Error TLS Licence check failed with code %d\n", ret);
         goto out;
     }
+    if (ret == OVSA_LICENSE_SERVER_CONNECT_FAIL)
+        OVSA_DBG(DBG_I, "OVSA: License server unreachable, model loaded on its license lease\n");
+    ovsa_model_load_stage_done(OVSA_MODEL_LOAD_STAGE_LICENSE_CHECK, &stage_start);
     OVSA_DBG(DBG_I, "OVSA: Platform and License Validation completed successfully\n");
     OVSA_DBG(DBG_I, "OVSA: Invoking model loader\n");
     /* Invoke Model Loader */
     ret = ovsa_start_model_loader(asym_keyslot, peer_keyslot, cust_lic_sig_buf,
-                                  &control_access_model_sig, decrypted_files);
+                                  &control_access_model_sig, sink);
     if (ret != OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error model Loader Init failed with code %d\n", ret);
     }
 
 out:
-    /* clear asymmetric key pairs from the key slot */
-    ovsa_crypto_clear_asymmetric_key_slot(asym_keyslot);
+    /* release asymmetric key pairs to the keystore cache */
+    ovsa_keystore_cache_put(asym_keyslot);
     /* clear peer keys from the key slots */
     ovsa_crypto_clear_asymmetric_key_slot(peer_keyslot);
     ovsa_safe_free_model_file_list(&control_access_model_sig.controlled_access_model.enc_model);
-    ovsa_safe_free(&certificate);
+    if (control_access_model_sig.controlled_access_model.enc_model_map != NULL) {
+        munmap(control_access_model_sig.controlled_access_model.enc_model_map,
+               control_access_model_sig.controlled_access_model.enc_model_map_len);
+    }
     ovsa_safe_free(&cust_lic_sig_buf);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
+
+void ovsa_safe_free_decrypted_model_files(ovsa_model_files_t** decrypted_files) {
+    ovsa_model_files_t* head = *decrypted_files;
+    ovsa_model_files_t* cur  = NULL;
+
+    while (head != NULL) {
+        cur = head->next;
+        ovsa_crypto_secure_free(&head->model_file_data);
+        ovsa_safe_free((char**)&head);
+        head = cur;
+    }
+    *decrypted_files = NULL;
+}
+
+ovsa_status_t ovsa_license_check_module(const char* keystore, const char* controlled_access_model,
+                                        const char* customer_license,
+                                        ovsa_model_files_t** decrypted_files) {
+    ovsa_status_t ret = OVSA_OK;
+    ovsa_model_file_list_sink_t list;
+    ovsa_model_file_sink_t sink;
+
+    memset_s(&list, sizeof(ovsa_model_file_list_sink_t), 0);
+    sink.sink_ctx        = &list;
+    sink.open_file       = ovsa_model_file_list_open;
+    sink.write_file      = ovsa_model_file_list_write;
+    sink.get_file_buff   = NULL;
+    sink.reuse_file      = NULL;
+    sink.decrypt_threads = 0;
+
+    ret = ovsa_license_check_module_sink(keystore, controlled_access_model, customer_license,
+                                         &sink);
+    if (ret != OVSA_OK) {
+        ovsa_safe_free_decrypted_model_files(&list.head);
+        return ret;
+    }
+    *decrypted_files = list.head;
+    return ret;
+}
@@ -14,6 +14,8 @@
  * limitations under the License.
  *****************************************************************************
  */
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,14 +23,83 @@
 
 #include "runtime.h"
 #include "tpm.h"
+#include "trace.h"
 #include "utils.h"
 /* json.h to be included at end due to dependencies */
 #include "json.h"
 
-extern ovsa_status_t ovsa_license_service_write(void* ssl, const char* buf, size_t len);
+extern ovsa_status_t ovsa_license_service_send_message(void* ssl, const ovsa_command_type_t cmd,
+                                                       const char* payload);
+extern ovsa_status_t ovsa_license_service_extract_payload(const char* message, char** payload);
 extern ovsa_status_t ovsa_do_tpm2_activatecredential(char* cred_outbuf);
 extern ovsa_status_t ovsa_tpm2_generatequote(char* nonce);
 
+/*
+ * The HW quote in TPM NV memory and the EK certificates are written when the platform is
+ * provisioned and do not change while the runtime is up. They are read from the TPM and the
+ * files once, every license check then gets its own copy to free. Re-provisioning the platform
+ * needs a restart of the runtime.
+ */
+typedef struct ovsa_tpm_static_cache {
+#ifdef ENABLE_QUOTE_FROM_NVRAM
+    bool hw_quote_read;
+    ovsa_quote_info_t hw_quote_info;
+#endif
+    char* ek_cert;
+    size_t ek_cert_size;
+#ifdef PTT_EK_ONDIE_CA
+    char* rom_cert;
+    size_t rom_cert_size;
+    char* chain_cert;
+    size_t chain_cert_size;
+#endif
+} ovsa_tpm_static_cache_t;
+
+static ovsa_tpm_static_cache_t g_tpm_static_cache;
+static pthread_mutex_t g_tpm_static_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Copies a buffer of the cache, size includes the null terminator */
+static ovsa_status_t ovsa_tpm_static_cache_copy(const char* cached, size_t size, char** copy) {
+    ovsa_status_t ret = OVSA_OK;
+
+    ret = ovsa_safe_malloc(size, copy);
+    if ((ret < OVSA_OK) || (*copy == NULL)) {
+        OVSA_DBG(DBG_E, "OVSA: Error TPM cache copy allocation failed %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    if (memcpy_s(*copy, size, cached, size) != EOK) {
+        OVSA_DBG(DBG_E, "OVSA: Error TPM cache copy failed\n");
+        ovsa_safe_free(copy);
+        return OVSA_MEMIO_ERROR;
+    }
+    return ret;
+}
+
+/* ovsa_read_file_content() of a file that does not change, served by the cache after the
+ * first read */
+static ovsa_status_t ovsa_tpm_read_static_file(const char* file_name, char** cached,
+                                               size_t* cached_size, char** content,
+                                               size_t* size) {
+    ovsa_status_t ret = OVSA_OK;
+
+    if (pthread_mutex_lock(&g_tpm_static_cache_lock) != 0)
+        return OVSA_FAIL;
+    if (*cached == NULL) {
+        ret = ovsa_read_file_content(file_name, cached, cached_size);
+        if (ret < OVSA_OK) {
+            ovsa_safe_free(cached);
+            *cached_size = 0;
+            goto out;
+        }
+    }
+    ret = ovsa_tpm_static_cache_copy(*cached, *cached_size, content);
+    if (ret == OVSA_OK)
+        *size = *cached_size;
+out:
+    pthread_mutex_unlock(&g_tpm_static_cache_lock);
+    return ret;
+}
+
 static ovsa_status_t ovsa_do_read_runtime_quote(ovsa_quote_info_t* sw_quote_info) {
     ovsa_status_t ret       = OVSA_OK;
     char* pcr_list_buf      = NULL;
@@ -184,7 +255,7 @@ out:
     return ret;
 }
 
-static ovsa_status_t ovsa_get_tpm2_base_host_quote(ovsa_quote_info_t* hw_quote_info) {
+static ovsa_status_t ovsa_read_tpm2_base_host_quote(ovsa_quote_info_t* hw_quote_info) {
     OVSA_DBG(DBG_I, "OVSA: Entering %s\n", __func__);
 
     ovsa_status_t ret      = OVSA_OK;
@@ -285,6 +356,64 @@ out:
     return ret;
 }
 
+static void ovsa_free_hw_quote_info(ovsa_quote_info_t* hw_quote_info) {
+    ovsa_safe_free(&hw_quote_info->quote_pcr);
+    ovsa_safe_free(&hw_quote_info->quote_message);
+    ovsa_safe_free(&hw_quote_info->quote_sig);
+    ovsa_safe_free(&hw_quote_info->ak_pub_key);
+    ovsa_safe_free(&hw_quote_info->ek_pub_key);
+    ovsa_safe_free(&hw_quote_info->ek_cert);
+}
+
+static ovsa_status_t ovsa_copy_hw_quote_element(const char* cached, char** copy) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t len        = 0;
+
+    ret = ovsa_get_string_length(cached, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of HW quote element %d\n", ret);
+        return ret;
+    }
+    return ovsa_tpm_static_cache_copy(cached, len + NULL_TERMINATOR, copy);
+}
+
+/* Returns a copy of the HW quote, which is read from NV memory on the first call only */
+static ovsa_status_t ovsa_get_tpm2_base_host_quote(ovsa_quote_info_t* hw_quote_info) {
+    ovsa_status_t ret         = OVSA_OK;
+    ovsa_quote_info_t* cached = &g_tpm_static_cache.hw_quote_info;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    if (pthread_mutex_lock(&g_tpm_static_cache_lock) != 0)
+        return OVSA_FAIL;
+    if (!g_tpm_static_cache.hw_quote_read) {
+        ret = ovsa_read_tpm2_base_host_quote(cached);
+        if (ret < OVSA_OK) {
+            ovsa_free_hw_quote_info(cached);
+            goto out;
+        }
+        g_tpm_static_cache.hw_quote_read = true;
+    } else {
+        OVSA_DBG(DBG_I, "OVSA:HW quote read from cache\n");
+    }
+
+    ret = ovsa_copy_hw_quote_element(cached->quote_pcr, &hw_quote_info->quote_pcr);
+    if (ret == OVSA_OK)
+        ret = ovsa_copy_hw_quote_element(cached->ak_pub_key, &hw_quote_info->ak_pub_key);
+    if (ret == OVSA_OK)
+        ret = ovsa_copy_hw_quote_element(cached->quote_message, &hw_quote_info->quote_message);
+    if (ret == OVSA_OK)
+        ret = ovsa_copy_hw_quote_element(cached->quote_sig, &hw_quote_info->quote_sig);
+    if (ret == OVSA_OK)
+        ret = ovsa_copy_hw_quote_element(cached->ek_cert, &hw_quote_info->ek_cert);
+    if (ret < OVSA_OK)
+        ovsa_free_hw_quote_info(hw_quote_info);
+out:
+    pthread_mutex_unlock(&g_tpm_static_cache_lock);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
 #endif
 
 static ovsa_status_t ovsa_extract_server_quote_nonce(char* payload, char** quote_nonce) {
@@ -308,7 +437,9 @@ static ovsa_status_t ovsa_read_ek_cert(ovsa_quote_info_t* sw_quote_info) {
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
     /* read ek_cert */
-    ret = ovsa_read_file_content(TPM2_EK_CERT, &sw_quote_info->ek_cert, &file_size);
+    ret = ovsa_tpm_read_static_file(TPM2_EK_CERT, &g_tpm_static_cache.ek_cert,
+                                    &g_tpm_static_cache.ek_cert_size, &sw_quote_info->ek_cert,
+                                    &file_size);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error reading TPM2_EK_CERT file failed with error code %d\n", ret);
         goto out;
@@ -527,19 +658,16 @@ out:
 
 ovsa_status_t ovsa_do_get_quote_nounce(const int asym_keyslot, char* quote_credout_blob,
                                        char* cust_lic_sig_buf, void** _ssl_session) {
-    ovsa_status_t ret           = OVSA_OK;
-    void* ssl_session           = NULL;
-    size_t length               = 0;
-    size_t quote_payload_len    = 0;
-    unsigned char* json_payload = NULL;
-    char* payload               = NULL;
-    char* quote_blob            = NULL;
-    char* quote_buf             = NULL;
-    char* actcred_buf           = NULL;
-    char* quote_nonce           = NULL;
-    size_t buf_len              = 0;
+    ovsa_status_t ret = OVSA_OK;
+    void* ssl_session = NULL;
+    size_t length     = 0;
+    char* payload     = NULL;
+    char* quote_blob  = NULL;
+    char* actcred_buf = NULL;
+    char* quote_nonce = NULL;
     ovsa_quote_info_t hw_quote_info;
     ovsa_quote_info_t quote_info;
+    OVSA_TRACE_SPAN(span);
 
     OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
 
@@ -548,12 +676,14 @@ ovsa_status_t ovsa_do_get_quote_nounce(const int asym_keyslot, char* quote_credo
     memset_s(&hw_quote_info, sizeof(ovsa_quote_info_t), 0);
 
     /* Read quote_credout_blob payload from json file*/
-    ret = ovsa_json_extract_element((char*)quote_credout_blob, "payload", &payload);
+    ret = ovsa_license_service_extract_payload(quote_credout_blob, &payload);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error read quote_credout_blob payload from json failed %d\n", ret);
         goto out;
     }
+    OVSA_TRACE_BEGIN(span, "tpm_activate_credential");
     ret = ovsa_do_tpm2_activatecredential_quote_nonce(payload, &actcred_buf);
+    OVSA_TRACE_END(span);
     if (ret < OVSA_OK) {
         OVSA_DBG(
             DBG_E,
@@ -569,7 +699,9 @@ ovsa_status_t ovsa_do_get_quote_nounce(const int asym_keyslot, char* quote_credo
 
 #ifdef ENABLE_QUOTE_FROM_NVRAM
     /* Read hw quote from NV memory  */
+    OVSA_TRACE_BEGIN(span, "tpm_nv_quote_read");
     ret = ovsa_get_tpm2_base_host_quote(&hw_quote_info);
+    OVSA_TRACE_END(span);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error get Hw quote measurements from NV memory failed with error code %d\n",
@@ -587,12 +719,14 @@ ovsa_status_t ovsa_do_get_quote_nounce(const int asym_keyslot, char* quote_credo
         goto out;
     }
 
+    OVSA_TRACE_BEGIN(span, "tpm_quote");
     ret = ovsa_tpm2_generate_runtime_host_quote(quote_nonce, &quote_info
 #ifdef ENABLE_QUOTE_FROM_NVRAM
                                                 ,
                                                 &hw_quote_info
 #endif
     );
+    OVSA_TRACE_END(span);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error get SW quote measurements failed with error code %d\n", ret);
         goto out;
@@ -604,40 +738,14 @@ ovsa_status_t ovsa_do_get_quote_nounce(const int asym_keyslot, char* quote_credo
                  ret);
         goto out;
     }
-    /* create json message blob */
-    ret = ovsa_json_create_message_blob(OVSA_SEND_QUOTE_INFO, quote_blob, &quote_buf, &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create SW quote message failed with error code %d\n", ret);
-        goto out;
-    }
-    /* Append payload length to json blob*/
-    quote_payload_len = length + PAYLOAD_LENGTH + 1;
-    ret               = ovsa_safe_malloc(sizeof(char) * quote_payload_len, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
-        goto out;
-    }
-
-    ret = ovsa_append_json_payload_len_to_blob(quote_buf, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error quote_buf json blob creation failed with %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_get_string_length((char*)json_payload, &buf_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
-    }
-    OVSA_DBG(DBG_I, "OVSA:Send quote to server\n%s", json_payload);
+    OVSA_DBG(DBG_I, "OVSA:Send quote to server\n%s", quote_blob);
     /* Send pcr quote to Server */
-    ret = ovsa_license_service_write(ssl_session, (char*)json_payload, buf_len);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_QUOTE_INFO, quote_blob);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
         goto out;
     }
 out:
-    ovsa_safe_free(&quote_buf);
     ovsa_safe_free(&payload);
     ovsa_safe_free(&quote_info.quote_pcr);
     ovsa_safe_free(&quote_info.quote_message);
@@ -653,7 +761,6 @@ out:
     ovsa_safe_free(&hw_quote_info.ek_cert);
 #endif
     ovsa_safe_free(&quote_blob);
-    ovsa_safe_free((char**)&json_payload);
     ovsa_safe_free(&actcred_buf);
     ovsa_safe_free(&quote_nonce);
 
@@ -673,8 +780,9 @@ static ovsa_status_t ovsa_do_read_EK_cert_chain_file(ovsa_ek_ak_bind_info_t* ek_
     if (ovsa_check_if_file_exists(TPM2_EKCERT_CHAIN_ROM_CERT) == true) {
         OVSA_DBG(DBG_D, "OVSA:TPM2_SW_EK_Chain ROM certificate file exists \n");
         /* Read ROM cert */
-        ret = ovsa_read_file_content(TPM2_EKCERT_CHAIN_ROM_CERT, &ek_ak_bind_info->ROM_cert,
-                                     &file_size);
+        ret = ovsa_tpm_read_static_file(
+            TPM2_EKCERT_CHAIN_ROM_CERT, &g_tpm_static_cache.rom_cert,
+            &g_tpm_static_cache.rom_cert_size, &ek_ak_bind_info->ROM_cert, &file_size);
         if (ret < OVSA_OK) {
             OVSA_DBG(
                 DBG_E,
@@ -694,8 +802,9 @@ static ovsa_status_t ovsa_do_read_EK_cert_chain_file(ovsa_ek_ak_bind_info_t* ek_
     if (ovsa_check_if_file_exists(TPM2_EKCERT_ONDIE_CHAIN) == true) {
         OVSA_DBG(DBG_D, "OVSA:TPM2_SW_EKcert on_diechain_certificate file exists \n");
         /* Read ROM cert */
-        ret = ovsa_read_file_content(TPM2_EKCERT_ONDIE_CHAIN, &ek_ak_bind_info->Chain_cert,
-                                     &file_size);
+        ret = ovsa_tpm_read_static_file(
+            TPM2_EKCERT_ONDIE_CHAIN, &g_tpm_static_cache.chain_cert,
+            &g_tpm_static_cache.chain_cert_size, &ek_ak_bind_info->Chain_cert, &file_size);
         if (ret < OVSA_OK) {
             OVSA_DBG(
                 DBG_E,
@@ -732,7 +841,9 @@ static ovsa_status_t ovsa_do_sign_EKpub_EKcert(const int asym_keyslot,
     if (ovsa_check_if_file_exists(TPM2_EK_CERT) == true) {
         OVSA_DBG(DBG_D, "OVSA:TPM2_SW_EK certificate file exists \n");
         /* Read EK cert */
-        ret = ovsa_read_file_content(TPM2_EK_CERT, &ek_ak_bind_info->ek_cert, &file_size);
+        ret = ovsa_tpm_read_static_file(TPM2_EK_CERT, &g_tpm_static_cache.ek_cert,
+                                        &g_tpm_static_cache.ek_cert_size,
+                                        &ek_ak_bind_info->ek_cert, &file_size);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E,
                      "OVSA: Error reading TPM2_SW_EK Certificate failed with error code %d\n", ret);
@@ -800,10 +911,6 @@ ovsa_status_t ovsa_send_EK_AK_bind_info(const int asym_keyslot, void** _ssl_sess
     void* ssl_session          = NULL;
     char* EK_AK_bind_info_json = NULL;
     size_t length              = 0;
-    char* json_buf             = NULL;
-    char* json_payload         = NULL;
-    size_t payload_len         = 0;
-    size_t buf_len             = 0;
     ovsa_ek_ak_bind_info_t ek_ak_bind_info;
 
     ssl_session = *_ssl_session;
@@ -847,35 +954,10 @@ ovsa_status_t ovsa_send_EK_AK_bind_info(const int asym_keyslot, void** _ssl_sess
                  ret);
         goto out;
     }
-    /* create json message blob */
-    ret = ovsa_json_create_message_blob(OVSA_SEND_EK_AK_BIND_INFO, EK_AK_bind_info_json, &json_buf,
-                                        &length);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create EK_AK_BIND_INFO message failed with error code %d\n",
-                 ret);
-        goto out;
-    }
-    /* Append payload length to json blob */
-    payload_len = length + PAYLOAD_LENGTH + 1;
-    ret         = ovsa_safe_malloc(sizeof(char) * payload_len, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error create json blob memory init failed\n");
-        goto out;
-    }
-    ret = ovsa_append_json_payload_len_to_blob(json_buf, (char**)&json_payload);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error json blob creation failed with %d\n", ret);
-        goto out;
-    }
-    ret = ovsa_get_string_length((char*)json_payload, &buf_len);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error could not get length of json_payload string %d\n", ret);
-        goto out;
-    }
-    OVSA_DBG(DBG_I, "OVSA:Send EK_AK_BIND_INFO to server\n%s", json_payload);
+    OVSA_DBG(DBG_I, "OVSA:Send EK_AK_BIND_INFO to server\n%s", EK_AK_bind_info_json);
     /* Send EK_AK_BIND_INFO to Server */
-    ret = ovsa_license_service_write(ssl_session, (char*)json_payload, buf_len);
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_EK_AK_BIND_INFO,
+                                            EK_AK_bind_info_json);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
         goto out;
@@ -892,13 +974,97 @@ out:
     ovsa_safe_free(&ek_ak_bind_info.ROM_cert);
     ovsa_safe_free(&ek_ak_bind_info.Chain_cert);
 #endif
-    ovsa_safe_free(&json_buf);
-    ovsa_safe_free(&json_payload);
     ovsa_safe_free(&EK_AK_bind_info_json);
     OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
     return ret;
 }
 
+ovsa_status_t ovsa_send_attestation_token(const char* token, char* quote_nonce,
+                                          void** _ssl_session) {
+    ovsa_status_t ret       = OVSA_OK;
+    void* ssl_session       = NULL;
+    char* ak_name           = NULL;
+    char* token_json        = NULL;
+    char* nonce_bin_buff    = NULL;
+    size_t file_size        = 0;
+    size_t length           = 0;
+    size_t size             = 0;
+    size_t nonce_bin_length = 0;
+    ovsa_quote_info_t quote_info;
+
+    ssl_session = *_ssl_session;
+
+    OVSA_DBG(DBG_D, "OVSA:Entering %s\n", __func__);
+
+    memset_s(&quote_info, sizeof(ovsa_quote_info_t), 0);
+    /* The token is bound to the AK it was issued for */
+    ret = ovsa_read_file_content(TPM2_AK_NAME_HEX, &ak_name, &file_size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading TPM2_AK_NAME_HEX file failed with error code %d\n",
+                 ret);
+        goto out;
+    }
+    /* Quote the PCRs over the nonce of the license server to show the AK is ours */
+    ret = ovsa_get_string_length(quote_nonce, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of quote nonce %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_safe_malloc((sizeof(char) * size), &nonce_bin_buff);
+    if (ret < OVSA_OK || nonce_bin_buff == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error quote nonce buffer allocation failed %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_crypto_convert_base64_to_bin(quote_nonce, size, nonce_bin_buff, &nonce_bin_length);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error crypto convert_base64_to_bin failed with code %d\n", ret);
+        goto out;
+    }
+    FILE* fquote_nonce = fopen(CHALLENGE_NONCE, "w");
+    if (fquote_nonce == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error opening quote_nonce.bin !\n");
+        ret = OVSA_FILEOPEN_FAIL;
+        goto out;
+    }
+    fwrite(nonce_bin_buff, nonce_bin_length, 1, fquote_nonce);
+    fclose(fquote_nonce);
+
+    ret = ovsa_tpm2_generatequote(CHALLENGE_NONCE);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa_tpm2_generatequote failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_do_read_runtime_quote(&quote_info);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error read_SW_quote info failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_json_create_attestation_token_blob(token, ak_name, quote_info, &token_json,
+                                                  &length);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create attestation token blob failed with error code %d\n",
+                 ret);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA:Send ATTESTATION_TOKEN to server\n");
+    /* Send ATTESTATION_TOKEN to Server */
+    ret = ovsa_license_service_send_message(ssl_session, OVSA_SEND_ATTESTATION_TOKEN, token_json);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa_license_service_write() returned %d\n", ret);
+        goto out;
+    }
+out:
+    ovsa_safe_free(&ak_name);
+    ovsa_safe_free(&token_json);
+    ovsa_safe_free(&nonce_bin_buff);
+    ovsa_safe_free(&quote_info.quote_pcr);
+    ovsa_safe_free(&quote_info.quote_message);
+    ovsa_safe_free(&quote_info.quote_sig);
+    ovsa_safe_free(&quote_info.ak_pub_key);
+    OVSA_DBG(DBG_D, "OVSA:%s Exit\n", __func__);
+    return ret;
+}
+
 void ovsa_remove_quote_files(void) {
     remove(TPM2_SWQUOTE_PCR);
     remove(TPM2_SWQUOTE_MSG);
@@ -15,6 +15,7 @@
 //*****************************************************************************
 
 #include <assert.h>
+#include <string.h>
 
 #include <chrono>
 #include <iostream>
@@ -25,26 +26,35 @@
 #include <vector>
 
 #include "customloaderinterface.hpp"
+#include "ovsa_license_scheduler.hpp"
+#include "ovsa_model_cache.hpp"
 #include "ovsa_model_instance.hpp"
+#include "ovsa_model_table.hpp"
 #include "rapidjson/document.h"
 
 using namespace ovms;
 
 extern "C" {
-#define MAX_NAME_SIZE 256
-typedef struct ovsa_model_files {
-    char model_file_name[MAX_NAME_SIZE];
-    char* model_file_data;
-    int model_file_length;
-    struct ovsa_model_files* next;
-} ovsa_model_files_t;
-
-ovsa_status_t ovsa_license_check_module(const char* keystore, const char* controlled_access_model,
-                                        const char* customer_license,
-                                        ovsa_model_files_t** decrypted_files);
+typedef ovsa_status_t (*ovsa_crypto_write_cb_t)(void* write_ctx, const char* buff,
+                                                size_t buff_len);
+typedef struct ovsa_model_file_sink {
+    void* sink_ctx;
+    ovsa_status_t (*open_file)(void* sink_ctx, const char* model_file_name,
+                               size_t max_file_length);
+    ovsa_crypto_write_cb_t write_file;
+    ovsa_status_t (*get_file_buff)(void* sink_ctx, size_t file_length, char** file_buff);
+    bool (*reuse_file)(void* sink_ctx, const char* model_file_name, const char* model_file_hash);
+    int decrypt_threads;
+} ovsa_model_file_sink_t;
+
+ovsa_status_t ovsa_license_check_module_sink(const char* keystore,
+                                             const char* controlled_access_model,
+                                             const char* customer_license,
+                                             const ovsa_model_file_sink_t* sink);
+ovsa_status_t ovsa_verify_keystore(const char* keystore);
+void ovsa_keystore_cache_flush(void);
 ovsa_status_t ovsa_crypto_init();
 void ovsa_crypto_deinit();
-void ovsa_safe_free_model_file_list(ovsa_model_files_t** listhead);
 };
 
 // Time in seconds at which model status will be checked
@@ -59,8 +69,192 @@ void ovsa_safe_free_model_file_list(ovsa_model_files_t** listhead);
 #define VALIDITY_CHECK_INTERVAL (OVMS_LICCHECK_MINS * 60 * 1000)
 #endif
 
-typedef std::pair<std::string, int> map_key_t;
 typedef std::pair<std::string, uint8_t> model_file_t;
+
+enum class OvsaModelFileType { UNKNOWN, IR_XML, IR_BIN, BLOB, ONNX };
+
+// The type of a model file is given by the extension of its name
+static OvsaModelFileType ovsa_get_model_file_type(const char* model_file_name) {
+    static const struct {
+        const char* ext;
+        OvsaModelFileType type;
+    } file_types[] = {{".xml", OvsaModelFileType::IR_XML},
+                      {".bin", OvsaModelFileType::IR_BIN},
+                      {".blob", OvsaModelFileType::BLOB},
+                      {".onnx", OvsaModelFileType::ONNX}};
+    const char* ext = strrchr(model_file_name, '.');
+
+    if (ext == nullptr)
+        return OvsaModelFileType::UNKNOWN;
+    for (auto& file_type : file_types) {
+        if (!strcmp(ext, file_type.ext))
+            return file_type.type;
+    }
+    return OvsaModelFileType::UNKNOWN;
+}
+
+/*
+ * Decrypted model files are written chunk by chunk straight into the buffers handed
+ * over to the model server, so that there is a single copy of the plain text model.
+ */
+struct OvsaModelFileSink {
+    std::vector<uint8_t>& modelBuffer;
+    std::vector<uint8_t>& weights;
+    std::vector<uint8_t>* current;
+    OvsaModelCache& modelCache;
+    // Segment hashes of the files in modelBuffer and weights, kept with them in the model cache
+    std::string modelHash;
+    std::string weightsHash;
+    std::string pendingHash;
+    // Identity of the keystore the model is loaded with, cached files are reused only for it
+    std::string keystoreKey;
+    CustomLoaderStatus retStatus;
+    bool file_type_ir;
+
+    OvsaModelFileSink(std::vector<uint8_t>& modelBuffer, std::vector<uint8_t>& weights,
+                      OvsaModelCache& modelCache) :
+        modelBuffer(modelBuffer),
+        weights(weights),
+        current(nullptr),
+        modelCache(modelCache),
+        retStatus(CustomLoaderStatus::MODEL_LOAD_ERROR),
+        file_type_ir(false) {}
+
+    // Called before openFile for the segments of a binary controlled access model. A file whose
+    // segment a cached model was decrypted from is copied from the cache instead.
+    static bool reuseFile(void* sink_ctx, const char* model_file_name,
+                          const char* model_file_hash) {
+        OvsaModelFileSink* sink      = static_cast<OvsaModelFileSink*>(sink_ctx);
+        OvsaModelFileType type       = ovsa_get_model_file_type(model_file_name);
+        std::vector<uint8_t>* buffer = sink->getBuffer(type);
+
+        sink->pendingHash = model_file_hash;
+        if ((buffer == nullptr) || !buffer->empty() ||
+            !sink->modelCache.getFile(sink->keystoreKey, sink->pendingHash, *buffer))
+            return false;
+        sink->current = nullptr;
+        sink->setFileType(type);
+        sink->getBufferHash(buffer) = sink->pendingHash;
+        sink->pendingHash.clear();
+        std::cout << "OvsaCustomLoader: " << model_file_name << " reused from the model cache"
+                  << std::endl;
+        return true;
+    }
+
+    static ovsa_status_t openFile(void* sink_ctx, const char* model_file_name,
+                                  size_t max_file_length) {
+        OvsaModelFileSink* sink = static_cast<OvsaModelFileSink*>(sink_ctx);
+        OvsaModelFileType type  = ovsa_get_model_file_type(model_file_name);
+
+        sink->current = sink->getBuffer(type);
+        if (sink->current == nullptr) {
+            sink->pendingHash.clear();
+            return OVSA_OK;
+        }
+        sink->setFileType(type);
+        // A buffer is only found again by the hash of a single file
+        sink->getBufferHash(sink->current) =
+            sink->current->empty() ? sink->pendingHash : std::string();
+        sink->pendingHash.clear();
+        std::cout << "OvsaCustomLoader: " << model_file_name << std::endl;
+        try {
+            sink->current->reserve(sink->current->size() + max_file_length);
+        } catch (const std::exception& e) {
+            OVSA_DBG(DBG_E, "OvsaCustomLoader: Error reserving model buffer failed: %s\n",
+                     e.what());
+            return OVSA_MEMORY_ALLOC_FAIL;
+        }
+        return OVSA_OK;
+    }
+
+    static ovsa_status_t writeFile(void* sink_ctx, const char* buff, size_t buff_len) {
+        OvsaModelFileSink* sink = static_cast<OvsaModelFileSink*>(sink_ctx);
+
+        if (sink->current == nullptr) {
+            return OVSA_OK;
+        }
+        try {
+            sink->current->insert(sink->current->end(), reinterpret_cast<const uint8_t*>(buff),
+                                  reinterpret_cast<const uint8_t*>(buff) + buff_len);
+        } catch (const std::exception& e) {
+            OVSA_DBG(DBG_E, "OvsaCustomLoader: Error writing model buffer failed: %s\n",
+                     e.what());
+            return OVSA_MEMORY_ALLOC_FAIL;
+        }
+        return OVSA_OK;
+    }
+
+    // Used by the parallel model loader instead of writeFile, the segments of the file are
+    // decrypted straight into the returned buffer
+    static ovsa_status_t getFileBuff(void* sink_ctx, size_t file_length, char** file_buff) {
+        OvsaModelFileSink* sink = static_cast<OvsaModelFileSink*>(sink_ctx);
+
+        *file_buff = nullptr;
+        if (sink->current == nullptr) {
+            return OVSA_OK;
+        }
+        // A later resize of the same buffer would move the data decrypted in parallel
+        if (!sink->current->empty()) {
+            OVSA_DBG(DBG_E,
+                     "OvsaCustomLoader: Error model buffer already holds a file, use "
+                     "decrypt_threads 1\n");
+            return OVSA_INVALID_PARAMETER;
+        }
+        try {
+            sink->current->resize(file_length);
+        } catch (const std::exception& e) {
+            OVSA_DBG(DBG_E, "OvsaCustomLoader: Error resizing model buffer failed: %s\n",
+                     e.what());
+            return OVSA_MEMORY_ALLOC_FAIL;
+        }
+        *file_buff = reinterpret_cast<char*>(sink->current->data());
+        return OVSA_OK;
+    }
+
+   private:
+    // Buffer handed over to the model server for the file, nullptr when it does not load the file
+    std::vector<uint8_t>* getBuffer(OvsaModelFileType type) {
+        switch (type) {
+            case OvsaModelFileType::IR_XML:
+            case OvsaModelFileType::BLOB:
+            case OvsaModelFileType::ONNX:
+                return &modelBuffer;
+            case OvsaModelFileType::IR_BIN:
+                return &weights;
+            default:
+                return nullptr;
+        }
+    }
+
+    std::string& getBufferHash(const std::vector<uint8_t>* buffer) {
+        return (buffer == &weights) ? weightsHash : modelHash;
+    }
+
+    void setFileType(OvsaModelFileType type) {
+        switch (type) {
+            case OvsaModelFileType::IR_XML:
+            case OvsaModelFileType::IR_BIN:
+                setIR();
+                break;
+            case OvsaModelFileType::BLOB:
+                retStatus = CustomLoaderStatus::MODEL_TYPE_BLOB;
+                break;
+            case OvsaModelFileType::ONNX:
+                retStatus = CustomLoaderStatus::MODEL_TYPE_ONNX;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void setIR() {
+        if (file_type_ir) {
+            retStatus = CustomLoaderStatus::MODEL_TYPE_IR;
+        } else {
+            file_type_ir = true;
+        }
+    }
+};
 /*
  * This class implements am example custom model loader for OVMS.
  * It derives the implementation from base class CustomLoaderInterface
@@ -78,16 +272,29 @@ typedef std::pair<std::string, uint8_t> model_file_t;
 
 class OvsaCustomLoader : public CustomLoaderInterface {
    private:
-    std::map<map_key_t, std::shared_ptr<OvsaModelInstance>> model_map;
-    std::mutex critical_ops;
+    model_map_t model_map;
+    // Snapshot of model_map for getModelBlacklistStatus, published with models_watched_mutex held
+    OvsaModelTable model_table;
     std::mutex models_watched_mutex;
+    OvsaLicenseScheduler license_scheduler;
+    OvsaModelCache model_cache{VALIDITY_CHECK_INTERVAL};
 
    protected:
     CustomLoaderStatus ovsa_json_extract_input_params(const std::string& basePath,
                                                       const int version,
                                                       const std::string& loaderOptions,
                                                       std::string& loaderName, std::string& ksFile,
-                                                      std::string& licFile, std::string& datFile);
+                                                      std::string& licFile, std::string& datFile,
+                                                      int& decryptThreads);
+    CustomLoaderStatus registerModel(const std::string& modelName, const int version,
+                                     const std::string& ksFile, const std::string& licFile,
+                                     const std::string& datFile, CustomLoaderStatus retStatus,
+                                     const std::string& cacheKey,
+                                     const std::string& keystoreKey, bool cached,
+                                     const std::vector<uint8_t>& modelBuffer,
+                                     const std::vector<uint8_t>& weights,
+                                     const std::string& modelHash,
+                                     const std::string& weightsHash);
 
    public:
     OvsaCustomLoader();
@@ -123,12 +330,14 @@ CustomLoaderStatus OvsaCustomLoader::loaderInit(const std::string& loader_path)
         OVSA_DBG(DBG_E, "OvsaCustomLoader: Crypto init failed with code %d\n", ret);
         return CustomLoaderStatus::MODEL_LOAD_ERROR;
     }
+    model_cache.init();
     return CustomLoaderStatus::OK;
 }
 
 CustomLoaderStatus OvsaCustomLoader::ovsa_json_extract_input_params(
     const std::string& basePath, const int version, const std::string& loaderOptions,
-    std::string& loaderName, std::string& ksFile, std::string& licFile, std::string& datFile) {
+    std::string& loaderName, std::string& ksFile, std::string& licFile, std::string& datFile,
+    int& decryptThreads) {
     CustomLoaderStatus ret = CustomLoaderStatus::OK;
     rapidjson::Document doc;
 
@@ -169,6 +378,17 @@ CustomLoaderStatus OvsaCustomLoader::ovsa_json_extract_input_params(
         std::cout << "keystore:" << ksFile << std::endl;
     }
 
+    if (doc.HasMember("decrypt_threads")) {
+        try {
+            decryptThreads = std::stoi(doc["decrypt_threads"].GetString());
+        } catch (const std::exception& e) {
+            std::cout << "OvsaCustomLoader: Error invalid decrypt_threads " << e.what()
+                      << std::endl;
+            return CustomLoaderStatus::MODEL_LOAD_ERROR;
+        }
+        std::cout << "decrypt_threads:" << decryptThreads << std::endl;
+    }
+
     return ret;
 }
 
@@ -187,24 +407,55 @@ CustomLoaderStatus OvsaCustomLoader::loadModel(const std::string& modelName,
     std::string ksFile;
     std::string licFile;
     std::string datFile;
-    ovsa_model_files_t* decrypted_files = NULL;
-    CustomLoaderStatus retStatus        = CustomLoaderStatus::MODEL_LOAD_ERROR;
+    std::string cacheKey;
+    int decryptThreads           = 1;
+    bool cached                  = false;
+    CustomLoaderStatus retStatus = CustomLoaderStatus::MODEL_LOAD_ERROR;
+    OvsaModelFileSink fileSink(modelBuffer, weights, model_cache);
+    ovsa_model_file_sink_t sink;
 
     if (modelName.empty() || basePath.empty() || loaderOptions.empty()) {
         std::cout << "OvsaCustomLoader: Error invalid input parameters to loadModel" << std::endl;
         return CustomLoaderStatus::MODEL_LOAD_ERROR;
     }
 
-    CustomLoaderStatus st = ovsa_json_extract_input_params(basePath, version, loaderOptions,
-                                                           loaderName, ksFile, licFile, datFile);
+    CustomLoaderStatus st = ovsa_json_extract_input_params(
+        basePath, version, loaderOptions, loaderName, ksFile, licFile, datFile, decryptThreads);
     if (st != CustomLoaderStatus::OK || ksFile.empty() || licFile.empty() || datFile.empty()) {
         std::cout << "OvsaCustomLoader: Error invalid custom loader options" << std::endl;
         return CustomLoaderStatus::MODEL_LOAD_ERROR;
     }
 
-    std::unique_lock<std::mutex> lockGuard(critical_ops);
-    ovsa_status_t rets = ovsa_license_check_module(ksFile.c_str(), datFile.c_str(), licFile.c_str(),
-                                                   &decrypted_files);
+    fileSink.keystoreKey = OvsaModelCache::getKeystoreKey(ksFile);
+    cacheKey             = model_cache.getKey(datFile, licFile, ksFile);
+    cached               = model_cache.get(cacheKey, modelBuffer, weights, retStatus);
+    if (cached) {
+        // The decrypted model is only handed out to the keystore it was licensed to
+        ovsa_status_t rets = ovsa_verify_keystore(ksFile.c_str());
+        if (rets != OVSA_OK) {
+            OVSA_DBG(DBG_E, "OvsaCustomLoader: Error keystore verification failed with %d\n",
+                     rets);
+            modelBuffer.clear();
+            weights.clear();
+            return CustomLoaderStatus::MODEL_LOAD_ERROR;
+        }
+        OVSA_DBG(DBG_I, "OvsaCustomLoader: Model %s version %d loaded from the model cache\n",
+                 (char*)modelName.c_str(), version);
+        return registerModel(modelName, version, ksFile, licFile, datFile, retStatus, cacheKey,
+                             fileSink.keystoreKey, cached, modelBuffer, weights, std::string(),
+                             std::string());
+    }
+
+    sink.sink_ctx        = &fileSink;
+    sink.open_file       = OvsaModelFileSink::openFile;
+    sink.write_file      = OvsaModelFileSink::writeFile;
+    sink.get_file_buff   = OvsaModelFileSink::getFileBuff;
+    sink.reuse_file      = OvsaModelFileSink::reuseFile;
+    sink.decrypt_threads = decryptThreads;
+
+    // Each license check has its own connection to the license server, models load concurrently
+    ovsa_status_t rets = ovsa_license_check_module_sink(ksFile.c_str(), datFile.c_str(),
+                                                        licFile.c_str(), &sink);
     if (rets != OVSA_OK) {
         if (rets == OVSA_LICENSE_SERVER_CONNECT_FAIL) {
             OVSA_DBG(DBG_E,
@@ -217,79 +468,39 @@ CustomLoaderStatus OvsaCustomLoader::loadModel(const std::string& modelName,
             OVSA_DBG(DBG_E, "OvsaCustomLoader: Error ovsa_license_check_module with code %d\n",
                      rets);
         }
-        ovsa_safe_free_model_file_list(&decrypted_files);
         return CustomLoaderStatus::MODEL_LOAD_ERROR;
     }
-    lockGuard.unlock();
-
-    std::vector<std::pair<std::string, uint8_t>> modelFileVec;
-    ovsa_model_files_t* head = decrypted_files;
-    bool file_type_ir        = false;
-
-    while (head != NULL) {
-        // model_file_t file_data =  std::make_pair(head->model_file_name,head->model_file_data);
-        // modelFileVec.pushback(file_data);
-        //
-
-        std::string filename(head->model_file_name);
-        size_t found = filename.find(".xml");
-        if (found != std::string::npos) {
-            std::cout << "OvsaCustomLoader: " << head->model_file_name << std::endl;
-            std::vector<uint8_t> mdl(&head->model_file_data[0],
-                                     &head->model_file_data[head->model_file_length]);
-            modelBuffer.insert(modelBuffer.end(), mdl.begin(), mdl.end());
-            if (file_type_ir) {
-                retStatus = CustomLoaderStatus::MODEL_TYPE_IR;
-            } else {
-                file_type_ir = true;
-            }
-        }
-
-        found = filename.find(".bin");
-        if (found != std::string::npos) {
-            std::cout << "OvsaCustomLoader: " << head->model_file_name << std::endl;
-            std::vector<uint8_t> wts(&head->model_file_data[0],
-                                     &head->model_file_data[head->model_file_length]);
-            weights.insert(weights.end(), wts.begin(), wts.end());
-            if (file_type_ir) {
-                retStatus = CustomLoaderStatus::MODEL_TYPE_IR;
-            } else {
-                file_type_ir = true;
-            }
-        }
 
-        found = filename.find(".blob");
-        if (found != std::string::npos) {
-            std::cout << "OvsaCustomLoader: " << head->model_file_name << std::endl;
-            std::vector<uint8_t> mdl(&head->model_file_data[0],
-                                     &head->model_file_data[head->model_file_length]);
-            modelBuffer.insert(modelBuffer.end(), mdl.begin(), mdl.end());
-            retStatus = CustomLoaderStatus::MODEL_TYPE_BLOB;
-        }
-
-        found = filename.find(".onnx");
-        if (found != std::string::npos) {
-            std::cout << "OvsaCustomLoader: " << head->model_file_name << std::endl;
-            std::vector<uint8_t> mdl(&head->model_file_data[0],
-                                     &head->model_file_data[head->model_file_length]);
-            modelBuffer.insert(modelBuffer.end(), mdl.begin(), mdl.end());
-            retStatus = CustomLoaderStatus::MODEL_TYPE_ONNX;
-        }
+    return registerModel(modelName, version, ksFile, licFile, datFile, fileSink.retStatus,
+                         cacheKey, fileSink.keystoreKey, cached, modelBuffer, weights,
+                         fileSink.modelHash, fileSink.weightsHash);
+}
 
-        head = head->next;
-    }
+// Watches the license of a loaded model and keeps the decrypted model in the model cache
+CustomLoaderStatus OvsaCustomLoader::registerModel(
+    const std::string& modelName, const int version, const std::string& ksFile,
+    const std::string& licFile, const std::string& datFile, CustomLoaderStatus retStatus,
+    const std::string& cacheKey, const std::string& keystoreKey, bool cached,
+    const std::vector<uint8_t>& modelBuffer, const std::vector<uint8_t>& weights,
+    const std::string& modelHash, const std::string& weightsHash) {
     if (retStatus != CustomLoaderStatus::MODEL_LOAD_ERROR) {
         std::lock_guard<std::mutex> guard(models_watched_mutex);
-        map_key_t key  = std::make_pair(modelName, version);
-        model_map[key] = std::make_shared<OvsaModelInstance>(modelName, ksFile, licFile, datFile,
-                                                             false, version, ref(critical_ops));
-        auto itr       = model_map.find(key);
+        map_key_t key = std::make_pair(modelName, version);
+        auto itr      = model_map.find(key);
         if (itr != model_map.end()) {
-            itr->second->startWatcher(VALIDITY_CHECK_INTERVAL);
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            license_scheduler.removeModel(itr->second);
+            model_cache.detachInstance(itr->second);
         }
+        model_map[key] = std::make_shared<OvsaModelInstance>(modelName, ksFile, licFile, datFile,
+                                                             false, version);
+        if (cached)
+            model_cache.setInstance(cacheKey, model_map[key]);
+        else
+            model_cache.put(cacheKey, keystoreKey, modelBuffer, weights, modelHash, weightsHash,
+                            retStatus, model_map[key]);
+        license_scheduler.addModel(model_map[key], VALIDITY_CHECK_INTERVAL);
+        model_table.publish(model_map);
     }
-    ovsa_safe_free_model_file_list(&decrypted_files);
     return retStatus;
 }
 
@@ -305,8 +516,11 @@ CustomLoaderStatus OvsaCustomLoader::retireModel(const std::string& modelName) {
     }
 
     for (auto itr : toDelete) {
+        license_scheduler.removeModel(model_map[itr]);
         model_map.erase(itr);
     }
+    model_table.publish(model_map);
+    model_cache.removeModel(modelName);
     return CustomLoaderStatus::OK;
 }
 
@@ -321,14 +535,19 @@ CustomLoaderStatus OvsaCustomLoader::unloadModel(const std::string& modelName, c
     if (it == model_map.end()) {
         std::cout << modelName << " is not loaded" << std::endl;
     } else {
-        it->second->releaseResources();
+        license_scheduler.removeModel(it->second);
+        model_cache.detachInstance(it->second);
         model_map.erase(it);
+        model_table.publish(model_map);
     }
     return CustomLoaderStatus::OK;
 }
 
 CustomLoaderStatus OvsaCustomLoader::loaderDeInit() {
     std::cout << "OvsaCustomLoader: Custom loaderDeInit" << std::endl;
+    license_scheduler.stop();
+    model_cache.clear();
+    ovsa_keystore_cache_flush();
     ovsa_crypto_deinit();
     return CustomLoaderStatus::OK;
 }
@@ -337,17 +556,20 @@ CustomLoaderStatus OvsaCustomLoader::getModelBlacklistStatus(const std::string&
                                                              const int version) {
     OVSA_DBG(DBG_D, "OvsaCustomLoader: Custom getModelBlacklistStatus\n");
 
-    map_key_t toFind = std::make_pair(modelName, version);
-    auto it          = model_map.find(toFind);
-    if (it == model_map.end()) {
+    // Called often by the model server, the lookup does not take a lock
+    std::shared_ptr<OvsaModelInstance> instance =
+        model_table.find(std::make_pair(modelName, version));
+    if (instance == nullptr) {
         OVSA_DBG(DBG_D, "OvsaCustomLoader: Model:%s Version:%d not loaded\n",
 			(char*)modelName.c_str(), version);
         return CustomLoaderStatus::OK;
     }
 
-    bool status = it->second->getBlackListStatus();
-    if (status)
+    bool status = instance->getBlackListStatus();
+    if (status) {
+        model_cache.removeInstance(instance);
         return CustomLoaderStatus::MODEL_BLACKLISTED;
+    }
     else
         return CustomLoaderStatus::OK;
 }
@@ -0,0 +1,296 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include "ovsa_license_scheduler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+OvsaLicenseScheduler::OvsaLicenseScheduler()
+    : wheel(LICENSE_SCHEDULER_SLOTS), jitterGen(std::random_device{}()) {}
+
+OvsaLicenseScheduler::~OvsaLicenseScheduler() {
+    stop();
+}
+
+// Models share a license check if they use the same keystore and customer license. The license
+// is compared by content since each model version comes with its own copy of the file.
+std::string OvsaLicenseScheduler::getCheckKey(const std::string& ksFile,
+                                              const std::string& licFile) {
+    std::ifstream lic(licFile, std::ios::binary);
+    std::ostringstream content;
+
+    content << ksFile << '\0';
+    if (lic.is_open()) {
+        content << lic.rdbuf();
+    } else {
+        content << licFile;
+    }
+    return content.str();
+}
+
+// Called with scheduler_mutex held
+void OvsaLicenseScheduler::schedule(const std::shared_ptr<LicenseCheck>& check,
+                                    const int delayMs) {
+    int jitter = delayMs * LICENSE_SCHEDULER_JITTER_PC / 100;
+    std::uniform_int_distribution<int> dist(-jitter, jitter);
+    size_t ticks = std::max(delayMs + dist(jitterGen), LICENSE_SCHEDULER_TICK_MS) /
+                   LICENSE_SCHEDULER_TICK_MS;
+
+    check->slot   = (currentSlot + ticks) % LICENSE_SCHEDULER_SLOTS;
+    check->rounds = (ticks - 1) / LICENSE_SCHEDULER_SLOTS;
+    wheel[check->slot].push_back(check);
+}
+
+bool OvsaLicenseScheduler::performCheck(const LicenseCheck& check, bool& unreachable) {
+    int asym_keyslot = -1;
+    bool status      = false;
+
+    ovsa_status_t ret = ovsa_keystore_cache_get(check.ksFile.c_str(), &asym_keyslot);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OvsaLicenseScheduler: Error load asymmetric keyslot failed with code %d\n",
+                 ret);
+        return false;
+    }
+    ret         = ovsa_perform_tls_license_check(asym_keyslot, check.licFile.c_str(), &status);
+    unreachable = (ret == OVSA_LICENSE_SERVER_CONNECT_FAIL);
+    if (ret != OVSA_OK) {
+        if (ret == OVSA_LICENSE_SERVER_CONNECT_FAIL)
+            OVSA_DBG(DBG_E,
+                     "OvsaLicenseScheduler: Error TLS license check service connection failed\n");
+        else if (ret == OVSA_LICENSE_CHECK_FAIL)
+            OVSA_DBG(DBG_E,
+                     "OvsaLicenseScheduler: Error TLS license check service failed with License "
+                     "expiry\n");
+        else
+            OVSA_DBG(DBG_E,
+                     "OvsaLicenseScheduler: Error TLS license check service failed with code %d\n",
+                     ret);
+    }
+    ovsa_keystore_cache_put(asym_keyslot);
+    return status;
+}
+
+std::vector<bool> OvsaLicenseScheduler::performChecks(
+    const std::vector<std::shared_ptr<LicenseCheck>>& batch, bool& unreachable) {
+    unreachable = false;
+    if (batch.size() == 1)
+        return std::vector<bool>(1, performCheck(*batch.front(), unreachable));
+
+    std::vector<bool> results(batch.size(), false);
+    std::vector<const char*> licFiles;
+    std::unique_ptr<bool[]> status(new bool[batch.size()]());
+    int asym_keyslot = -1;
+
+    ovsa_status_t ret = ovsa_keystore_cache_get(batch.front()->ksFile.c_str(), &asym_keyslot);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OvsaLicenseScheduler: Error load asymmetric keyslot failed with code %d\n",
+                 ret);
+        return results;
+    }
+    for (auto& check : batch)
+        licFiles.push_back(check->licFile.c_str());
+    ret = ovsa_perform_tls_license_check_batch(asym_keyslot, licFiles.data(), licFiles.size(),
+                                               status.get());
+    unreachable = (ret == OVSA_LICENSE_SERVER_CONNECT_FAIL);
+    if (ret != OVSA_OK)
+        OVSA_DBG(DBG_E,
+                 "OvsaLicenseScheduler: Error TLS license check of %zu licenses failed with code "
+                 "%d\n",
+                 batch.size(), ret);
+    ovsa_keystore_cache_put(asym_keyslot);
+    for (size_t i = 0; i < batch.size(); i++)
+        results[i] = status[i];
+    return results;
+}
+
+// Called with scheduler_mutex held through lock, it is released while the checks are performed
+void OvsaLicenseScheduler::runChecks(std::unique_lock<std::mutex>& lock,
+                                     const std::vector<std::shared_ptr<LicenseCheck>>& batch) {
+    // The checks may take a while, models can be added and removed meanwhile
+    lock.unlock();
+    OVSA_DBG(DBG_I, "OvsaLicenseScheduler: License check of %zu licenses with keystore %s\n",
+             batch.size(), (char*)batch.front()->ksFile.c_str());
+    bool unreachable          = false;
+    std::vector<bool> results = performChecks(batch, unreachable);
+    lock.lock();
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        auto& check = batch[i];
+        if (check->removed)
+            continue;
+
+        for (auto& weak : check->instances) {
+            std::shared_ptr<OvsaModelInstance> instance = weak.lock();
+            if (instance != nullptr)
+                instance->setBlackListStatus(!results[i]);
+        }
+        if (results[i] && unreachable) {
+            // Passed on a lease, the license server is tried again sooner than the interval
+            int retryMs = (check->retryMs == 0) ? LICENSE_SCHEDULER_RETRY_MS
+                                                : check->retryMs * 2;
+            check->retryMs = std::min(retryMs, check->intervalMs);
+            schedule(check, check->retryMs);
+        } else if (results[i]) {
+            check->retryMs = 0;
+            schedule(check, check->intervalMs);
+        } else {
+            // Blacklisted models are checked again only when they are loaded again
+            check->removed = true;
+            checks.erase(check->key);
+        }
+    }
+}
+
+void OvsaLicenseScheduler::threadFunction() {
+    OVSA_DBG(DBG_I, "OvsaLicenseScheduler: Thread Start\n");
+    auto nextTick = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(scheduler_mutex);
+
+    while (!stopRequested) {
+        nextTick += std::chrono::milliseconds(LICENSE_SCHEDULER_TICK_MS);
+        if (scheduler_cv.wait_until(lock, nextTick, [this] { return stopRequested; }))
+            break;
+
+        currentSlot = (currentSlot + 1) % LICENSE_SCHEDULER_SLOTS;
+        std::list<std::shared_ptr<LicenseCheck>> due;
+        auto& slot = wheel[currentSlot];
+        for (auto it = slot.begin(); it != slot.end();) {
+            if ((*it)->removed) {
+                it = slot.erase(it);
+            } else if ((*it)->rounds > 0) {
+                (*it)->rounds--;
+                ++it;
+            } else {
+                due.push_back(*it);
+                it = slot.erase(it);
+            }
+        }
+
+        while (!due.empty()) {
+            std::shared_ptr<LicenseCheck> first = due.front();
+            due.pop_front();
+            if (first->removed)
+                continue;
+
+            // Checks of the same keystore share the platform attestation, the ones not due yet
+            // are taken off the wheel and done early
+            std::vector<std::shared_ptr<LicenseCheck>> batch{first};
+            for (auto it = due.begin(); it != due.end();) {
+                if (!(*it)->removed && ((*it)->ksFile == first->ksFile)) {
+                    batch.push_back(*it);
+                    it = due.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (auto& entry : checks) {
+                auto& check = entry.second;
+                if ((check->ksFile != first->ksFile) || check->removed ||
+                    (std::find(batch.begin(), batch.end(), check) != batch.end()))
+                    continue;
+                auto& pending = wheel[check->slot];
+                auto found    = std::find(pending.begin(), pending.end(), check);
+                if (found == pending.end())
+                    continue;
+                pending.erase(found);
+                batch.push_back(check);
+            }
+
+            for (size_t i = 0; i < batch.size(); i += LICENSE_SCHEDULER_BATCH_SIZE) {
+                size_t end = std::min(batch.size(), i + LICENSE_SCHEDULER_BATCH_SIZE);
+                runChecks(lock, std::vector<std::shared_ptr<LicenseCheck>>(
+                                    batch.begin() + i, batch.begin() + end));
+            }
+        }
+    }
+    OVSA_DBG(DBG_I, "OvsaLicenseScheduler: Thread END\n");
+}
+
+void OvsaLicenseScheduler::addModel(const std::shared_ptr<OvsaModelInstance>& instance,
+                                    const int intervalMs) {
+    if ((instance == nullptr) || (intervalMs <= 0))
+        return;
+
+    std::string key = getCheckKey(instance->getKeystoreFile(), instance->getLicenseFile());
+    std::lock_guard<std::mutex> guard(scheduler_mutex);
+
+    auto itr = checks.find(key);
+    if (itr == checks.end()) {
+        std::shared_ptr<LicenseCheck> check = std::make_shared<LicenseCheck>();
+        check->ksFile                       = instance->getKeystoreFile();
+        check->licFile                      = instance->getLicenseFile();
+        check->key                          = key;
+        check->intervalMs                   = intervalMs;
+        check->retryMs                      = 0;
+        check->slot                         = 0;
+        check->rounds                       = 0;
+        check->removed                      = false;
+        itr = checks.insert(std::make_pair(key, check)).first;
+        schedule(check, check->intervalMs);
+    } else {
+        OVSA_DBG(DBG_I, "OvsaLicenseScheduler: Model %s shares the license check of %s\n",
+                 (char*)instance->getModelName().c_str(), (char*)itr->second->licFile.c_str());
+    }
+    itr->second->instances.push_back(instance);
+
+    if (!schedulerStarted) {
+        stopRequested    = false;
+        scheduler_thread = std::thread(&OvsaLicenseScheduler::threadFunction, this);
+        schedulerStarted = true;
+    }
+}
+
+void OvsaLicenseScheduler::removeModel(const std::shared_ptr<OvsaModelInstance>& instance) {
+    std::lock_guard<std::mutex> guard(scheduler_mutex);
+
+    for (auto itr = checks.begin(); itr != checks.end(); ++itr) {
+        auto& instances = itr->second->instances;
+        auto found      = std::find_if(instances.begin(), instances.end(),
+                                  [&instance](const std::weak_ptr<OvsaModelInstance>& weak) {
+                                      return weak.lock() == instance;
+                                  });
+        if (found == instances.end())
+            continue;
+
+        instances.erase(found);
+        if (instances.empty()) {
+            // Dropped from the wheel when its slot comes up
+            itr->second->removed = true;
+            checks.erase(itr);
+        }
+        break;
+    }
+}
+
+void OvsaLicenseScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> guard(scheduler_mutex);
+        if (!schedulerStarted)
+            return;
+        stopRequested = true;
+    }
+    scheduler_cv.notify_all();
+    if (scheduler_thread.joinable())
+        scheduler_thread.join();
+
+    std::lock_guard<std::mutex> guard(scheduler_mutex);
+    schedulerStarted = false;
+    checks.clear();
+    for (auto& slot : wheel)
+        slot.clear();
+}
@@ -0,0 +1,93 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ovsa_model_instance.hpp"
+
+// Resolution of the timer wheel and number of its slots, one revolution is ~8.5 minutes
+#define LICENSE_SCHEDULER_TICK_MS    1000
+#define LICENSE_SCHEDULER_SLOTS      512
+// Check intervals are spread by up to this percentage to avoid synchronized bursts
+#define LICENSE_SCHEDULER_JITTER_PC  10
+// Checks done in one connection to the license server, MAX_LICENSE_BATCH_SIZE of the runtime
+#define LICENSE_SCHEDULER_BATCH_SIZE 64
+// First retry of a check passed on a lease while the license server is unreachable, the delay
+// doubles with each retry up to the check interval
+#define LICENSE_SCHEDULER_RETRY_MS   5000
+
+/*
+ * Single thread running the periodic license checks of all the loaded models. The models that
+ * share a keystore and a customer license, and hence the license server, are checked once per
+ * interval and the result updates the blacklist status of each of them. The checks are kept in
+ * a hashed timer wheel. When a check is due, the other checks of the same keystore are done
+ * along with it in one connection to the license server and rescheduled from then on. A check
+ * that passes on the lease of the license while the license server is unreachable is retried
+ * with an exponential backoff.
+ */
+class OvsaLicenseScheduler {
+   private:
+    struct LicenseCheck {
+        std::string ksFile;
+        std::string licFile;
+        std::string key;
+        int intervalMs;
+        // Delay of the next retry while the license server is unreachable, 0 otherwise
+        int retryMs;
+        // Wheel slot of the check and number of revolutions left before it is due
+        size_t slot;
+        size_t rounds;
+        bool removed;
+        std::vector<std::weak_ptr<OvsaModelInstance>> instances;
+    };
+
+    std::mutex scheduler_mutex;
+    std::condition_variable scheduler_cv;
+    std::thread scheduler_thread;
+    bool schedulerStarted = false;
+    bool stopRequested    = false;
+    std::map<std::string, std::shared_ptr<LicenseCheck>> checks;
+    std::vector<std::list<std::shared_ptr<LicenseCheck>>> wheel;
+    size_t currentSlot = 0;
+    std::mt19937 jitterGen;
+
+    std::string getCheckKey(const std::string& ksFile, const std::string& licFile);
+    void schedule(const std::shared_ptr<LicenseCheck>& check, const int delayMs);
+    bool performCheck(const LicenseCheck& check, bool& unreachable);
+    std::vector<bool> performChecks(const std::vector<std::shared_ptr<LicenseCheck>>& batch,
+                                    bool& unreachable);
+    void runChecks(std::unique_lock<std::mutex>& lock,
+                   const std::vector<std::shared_ptr<LicenseCheck>>& batch);
+    void threadFunction();
+
+   public:
+    OvsaLicenseScheduler();
+    ~OvsaLicenseScheduler();
+    void addModel(const std::shared_ptr<OvsaModelInstance>& instance, const int intervalMs);
+    void removeModel(const std::shared_ptr<OvsaModelInstance>& instance);
+    void stop();
+};
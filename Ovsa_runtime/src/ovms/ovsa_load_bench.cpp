@@ -0,0 +1,291 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+// Cold start model load benchmark of the OVSA custom loader. The loader is created through
+// createCustomLoader() as the model server does, and each load runs on a new loader instance so
+// that the keystore and model caches are cold. The time of each stage of the load is reported
+// along with the peak RSS of the process during the load.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "customloaderinterface.hpp"
+#include "ovsa_errors.h"
+
+using namespace ovms;
+
+// Same as runtime.h
+extern "C" {
+typedef enum {
+    OVSA_LICENSE_CHECK_STAGE_CONNECT = 0,
+    OVSA_LICENSE_CHECK_STAGE_NONCE,
+    OVSA_LICENSE_CHECK_STAGE_EK_AK_BIND,
+    OVSA_LICENSE_CHECK_STAGE_QUOTE,
+    OVSA_LICENSE_CHECK_STAGE_RESULT,
+    OVSA_LICENSE_CHECK_STAGE_MAX
+} ovsa_license_check_stage_t;
+
+typedef enum {
+    OVSA_MODEL_LOAD_STAGE_KEYSTORE = 0,
+    OVSA_MODEL_LOAD_STAGE_CERT_VERIFY,
+    OVSA_MODEL_LOAD_STAGE_LICENSE_VALIDATE,
+    OVSA_MODEL_LOAD_STAGE_LICENSE_CHECK,
+    OVSA_MODEL_LOAD_STAGE_KEY_UNWRAP,
+    OVSA_MODEL_LOAD_STAGE_DECRYPT,
+    OVSA_MODEL_LOAD_STAGE_MAX
+} ovsa_model_load_stage_t;
+
+typedef void (*ovsa_license_check_stage_cb_t)(ovsa_license_check_stage_t stage,
+                                             uint64_t elapsed_us);
+typedef void (*ovsa_model_load_stage_cb_t)(ovsa_model_load_stage_t stage, uint64_t elapsed_us);
+
+void ovsa_set_license_check_stage_cb(ovsa_license_check_stage_cb_t stage_cb);
+void ovsa_set_model_load_stage_cb(ovsa_model_load_stage_cb_t stage_cb);
+CustomLoaderInterface* createCustomLoader();
+};
+
+// Model load stages, followed by the copy into the model cache and the registration of the
+// model by the loader once the model files are decrypted, then the network license check stages
+static const char* loadStageNames[] = {
+    "keystore", "cert_verify", "license_validate", "license_check", "key_unwrap", "decrypt",
+    "copy",     "total",       "  connect",        "  nonce",       "  ek_ak_bind", "  quote",
+    "  result"};
+#define LOAD_STAGE_COPY        OVSA_MODEL_LOAD_STAGE_MAX
+#define LOAD_STAGE_TOTAL       (OVSA_MODEL_LOAD_STAGE_MAX + 1)
+#define LOAD_STAGE_CHECK_FIRST (OVSA_MODEL_LOAD_STAGE_MAX + 2)
+#define LOAD_STAGE_COUNT       (LOAD_STAGE_CHECK_FIRST + OVSA_LICENSE_CHECK_STAGE_MAX)
+
+struct LoadStats {
+    std::vector<std::vector<uint64_t>> stageUs;
+    std::vector<uint64_t> peakRssKb;
+    std::vector<uint64_t> baseRssKb;
+    uint64_t current[LOAD_STAGE_COUNT];
+
+    LoadStats() : stageUs(LOAD_STAGE_COUNT) {}
+};
+
+// Single threaded, the stages are reported on the thread calling loadModel()
+static LoadStats* loadStats = nullptr;
+
+static void modelLoadStageCb(ovsa_model_load_stage_t stage, uint64_t elapsed_us) {
+    if ((loadStats != nullptr) && (stage < OVSA_MODEL_LOAD_STAGE_MAX))
+        loadStats->current[stage] += elapsed_us;
+}
+
+static void licenseCheckStageCb(ovsa_license_check_stage_t stage, uint64_t elapsed_us) {
+    if ((loadStats != nullptr) && (stage < OVSA_LICENSE_CHECK_STAGE_MAX))
+        loadStats->current[LOAD_STAGE_CHECK_FIRST + stage] += elapsed_us;
+}
+
+// Value in kB of a field of /proc/self/status
+static uint64_t getProcStatusKb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size(), field) == 0)
+            return std::stoull(line.substr(field.size() + 1));
+    }
+    return 0;
+}
+
+// Resets the peak RSS so that it is measured per load
+static void resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+
+    clearRefs << "5";
+}
+
+// Evicts the controlled access model from the page cache for a load from disk
+static void evictFile(const std::string& file) {
+    int fd = open(file.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        OVSA_DBG(DBG_E, "OvsaLoadBench: Error opening %s failed\n", (char*)file.c_str());
+        return;
+    }
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void printHelp(const char* argv) {
+    std::cout << "Help for OVSA custom loader cold start benchmark\n"
+              << "-b : Base path of the model, holding a directory per version\n"
+              << "-v : Version of the model, 1 by default\n"
+              << "-k : Customer keystore\n"
+              << "-f : Controlled access file name, without the .dat and .lic extensions\n"
+              << "-j : Number of decrypt threads of the loader, 1 by default\n"
+              << "-n : Number of loads, 5 by default\n"
+              << "-e : Evict the controlled access model from the page cache before each load\n"
+              << "Example for OVSA custom loader cold start benchmark as below:\n"
+              << argv << " -b /opt/ovsa/kvm/artefacts/fd -k /opt/ovsa/kvm/keystore/custkeystore"
+              << " -f face_detection_model -j 4 -n 10 -e\n"
+              << std::endl;
+}
+
+static void printStats(const LoadStats& stats) {
+    std::cout << std::endl
+              << std::left << std::setw(20) << "stage (ms)" << std::right << std::setw(12)
+              << "mean" << std::setw(12) << "min" << std::setw(12) << "max" << std::endl;
+    for (int i = 0; i < LOAD_STAGE_COUNT; i++) {
+        const std::vector<uint64_t>& us = stats.stageUs[i];
+        uint64_t sum                    = 0;
+        for (uint64_t v : us)
+            sum += v;
+        std::cout << std::left << std::setw(20) << loadStageNames[i] << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << sum / 1000.0 / us.size()
+                  << std::setw(12) << *std::min_element(us.begin(), us.end()) / 1000.0
+                  << std::setw(12) << *std::max_element(us.begin(), us.end()) / 1000.0
+                  << std::endl;
+    }
+    std::cout << std::left << std::setw(20) << "peak RSS (MB)" << std::right
+              << std::setprecision(1) << std::setw(12)
+              << *std::max_element(stats.peakRssKb.begin(), stats.peakRssKb.end()) / 1024.0
+              << std::endl
+              << std::left << std::setw(20) << "RSS before (MB)" << std::right << std::setw(12)
+              << *std::max_element(stats.baseRssKb.begin(), stats.baseRssKb.end()) / 1024.0
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::string basePath;
+    std::string ksFile;
+    std::string accessFile;
+    int version        = 1;
+    int decryptThreads = 1;
+    int loads          = 5;
+    bool evict         = false;
+    LoadStats stats;
+    int c = 0;
+
+    while ((c = getopt(argc, argv, "b:v:k:f:j:n:eh")) != -1) {
+        switch (c) {
+            case 'b':
+                basePath = optarg;
+                break;
+            case 'k':
+                ksFile = optarg;
+                break;
+            case 'f':
+                accessFile = optarg;
+                break;
+            case 'v':
+            case 'j':
+            case 'n':
+                if (!isdigit(*optarg) || (atoi(optarg) < 1)) {
+                    OVSA_DBG(DBG_E, "OvsaLoadBench: Error invalid value %s for -%c\n", optarg, c);
+                    return OVSA_INVALID_PARAMETER;
+                }
+                if (c == 'v')
+                    version = atoi(optarg);
+                else if (c == 'j')
+                    decryptThreads = atoi(optarg);
+                else
+                    loads = atoi(optarg);
+                break;
+            case 'e':
+                evict = true;
+                break;
+            case 'h':
+                printHelp(argv[0]);
+                return OVSA_OK;
+            default:
+                OVSA_DBG(DBG_E,
+                         "OvsaLoadBench: Error wrong command given. Please follow -help for help "
+                         "option\n");
+                return OVSA_INVALID_PARAMETER;
+        }
+    }
+    if (basePath.empty() || ksFile.empty() || accessFile.empty()) {
+        OVSA_DBG(DBG_E, "OvsaLoadBench: Error base path, keystore and controlled access file "
+                        "are required\n");
+        printHelp(argv[0]);
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    // Custom loader options of the model server configuration
+    std::ostringstream options;
+    options << "{\"loader_name\":\"ovsa\",\"keystore\":\"" << ksFile
+            << "\",\"controlled_access_file\":\"" << accessFile << "\",\"decrypt_threads\":\""
+            << decryptThreads << "\"}";
+    std::string datFile = basePath + "/" + std::to_string(version) + "/" + accessFile + ".dat";
+
+    ovsa_set_model_load_stage_cb(modelLoadStageCb);
+    ovsa_set_license_check_stage_cb(licenseCheckStageCb);
+    loadStats = &stats;
+    for (int i = 0; i < loads; i++) {
+        std::unique_ptr<CustomLoaderInterface> loader(createCustomLoader());
+        std::vector<uint8_t> modelBuffer;
+        std::vector<uint8_t> weights;
+
+        if (loader->loaderInit("") != CustomLoaderStatus::OK) {
+            OVSA_DBG(DBG_E, "OvsaLoadBench: Error custom loader init failed\n");
+            return OVSA_FAIL;
+        }
+        if (evict)
+            evictFile(datFile);
+        std::fill(stats.current, stats.current + LOAD_STAGE_COUNT, 0);
+        resetPeakRss();
+        stats.baseRssKb.push_back(getProcStatusKb("VmRSS"));
+
+        auto start = std::chrono::steady_clock::now();
+        CustomLoaderStatus ret =
+            loader->loadModel("ovsa_load_bench", basePath, version, options.str(), modelBuffer,
+                              weights);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stats.peakRssKb.push_back(getProcStatusKb("VmHWM"));
+        if (ret == CustomLoaderStatus::MODEL_LOAD_ERROR) {
+            OVSA_DBG(DBG_E, "OvsaLoadBench: Error load %d of the model failed\n", i);
+            loader->loaderDeInit();
+            return OVSA_FAIL;
+        }
+
+        uint64_t totalUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        uint64_t stageUs = 0;
+        for (int stage = 0; stage < OVSA_MODEL_LOAD_STAGE_MAX; stage++)
+            stageUs += stats.current[stage];
+        stats.current[LOAD_STAGE_COPY]  = (totalUs > stageUs) ? totalUs - stageUs : 0;
+        stats.current[LOAD_STAGE_TOTAL] = totalUs;
+        for (int stage = 0; stage < LOAD_STAGE_COUNT; stage++)
+            stats.stageUs[stage].push_back(stats.current[stage]);
+        std::cout << "OvsaLoadBench: Load " << i << " of " << modelBuffer.size() << " + "
+                  << weights.size() << " bytes in " << totalUs / 1000.0 << " ms" << std::endl;
+
+        loader->unloadModel("ovsa_load_bench", version);
+        loader->loaderDeInit();
+    }
+    loadStats = nullptr;
+    ovsa_set_license_check_stage_cb(nullptr);
+    ovsa_set_model_load_stage_cb(nullptr);
+
+    printStats(stats);
+    return OVSA_OK;
+}
@@ -0,0 +1,293 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include "ovsa_model_cache.hpp"
+
+#include <openssl/crypto.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+OvsaModelCache::OvsaModelCache(const int validityMs) : validity(validityMs) {}
+
+OvsaModelCache::~OvsaModelCache() {
+    clear();
+}
+
+void OvsaModelCache::init() {
+    const char* size = std::getenv(MODEL_CACHE_SIZE_ENV);
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    budget = (size != nullptr) ? std::strtoul(size, nullptr, 10) * 1024 * 1024 : 0;
+    if (budget > 0)
+        OVSA_DBG(DBG_I, "OvsaModelCache: Decrypted models cached up to %zu MB\n",
+                 budget / (1024 * 1024));
+}
+
+bool OvsaModelCache::allocBuffer(LockedBuffer& buffer, const std::vector<uint8_t>& content) {
+    // An empty buffer still gets a page so that it can be told from a failed allocation
+    buffer.length = content.size();
+    buffer.size   = std::max(content.size(), (size_t)1);
+    void* data    = mmap(nullptr, buffer.size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        buffer.data = nullptr;
+        return false;
+    }
+    buffer.data = static_cast<uint8_t*>(data);
+    madvise(buffer.data, buffer.size, MADV_DONTDUMP);
+    if (mlock(buffer.data, buffer.size) != 0) {
+        OVSA_DBG(DBG_E, "OvsaModelCache: Error locking %zu bytes failed, check RLIMIT_MEMLOCK\n",
+                 buffer.size);
+        munmap(buffer.data, buffer.size);
+        buffer.data = nullptr;
+        return false;
+    }
+    std::copy(content.begin(), content.end(), buffer.data);
+    return true;
+}
+
+void OvsaModelCache::freeBuffer(LockedBuffer& buffer) {
+    if (buffer.data == nullptr)
+        return;
+    OPENSSL_cleanse(buffer.data, buffer.size);
+    munlock(buffer.data, buffer.size);
+    munmap(buffer.data, buffer.size);
+    buffer.data = nullptr;
+}
+
+// Called with cache_mutex held
+void OvsaModelCache::evict(std::list<CacheEntry>::iterator entry) {
+    OVSA_DBG(DBG_I, "OvsaModelCache: Model %s dropped from the cache\n",
+             (char*)entry->modelName.c_str());
+    used -= entry->model.size + entry->weights.size;
+    freeBuffer(entry->model);
+    freeBuffer(entry->weights);
+    entries.erase(entry);
+}
+
+// Called with cache_mutex held. An entry is valid while the model that loaded it is not
+// blacklisted and its license was checked within the license check interval.
+bool OvsaModelCache::isValid(const CacheEntry& entry) {
+    auto checkedAt = entry.checkedAt;
+    std::shared_ptr<OvsaModelInstance> instance = entry.instance.lock();
+
+    if (instance != nullptr) {
+        if (instance->getBlackListStatus())
+            return false;
+        checkedAt = std::max(checkedAt, instance->getLastLicenseCheck());
+    }
+    return (std::chrono::steady_clock::now() - checkedAt) < validity;
+}
+
+// Identity of the keystore file, a model is only handed out again for the keystore it was
+// decrypted with
+std::string OvsaModelCache::getKeystoreKey(const std::string& ksFile) {
+    struct stat ksStat;
+    std::ostringstream key;
+
+    if (stat(ksFile.c_str(), &ksStat) != 0)
+        return std::string();
+    key << ksFile << '\0' << ksStat.st_dev << ':' << ksStat.st_ino << ':' << ksStat.st_size << ':'
+        << ksStat.st_mtim.tv_sec << '.' << ksStat.st_mtim.tv_nsec;
+    return key.str();
+}
+
+// The customer license holds the license GUID and the hash of the controlled access model it was
+// issued for, the identity of the controlled access model file guards against its replacement
+std::string OvsaModelCache::getKey(const std::string& datFile, const std::string& licFile,
+                                   const std::string& ksFile) {
+    struct stat datStat;
+    std::ostringstream key;
+    std::string keystoreKey;
+
+    {
+        std::lock_guard<std::mutex> guard(cache_mutex);
+        if (budget == 0)
+            return std::string();
+    }
+    keystoreKey = getKeystoreKey(ksFile);
+    std::ifstream lic(licFile, std::ios::binary);
+    if (keystoreKey.empty() || !lic.is_open() || (stat(datFile.c_str(), &datStat) != 0))
+        return std::string();
+
+    key << keystoreKey << '\0' << datFile << '\0' << datStat.st_dev << ':' << datStat.st_ino << ':'
+        << datStat.st_size << ':' << datStat.st_mtim.tv_sec << '.' << datStat.st_mtim.tv_nsec
+        << '\0' << lic.rdbuf();
+    return key.str();
+}
+
+bool OvsaModelCache::get(const std::string& key, std::vector<uint8_t>& modelBuffer,
+                         std::vector<uint8_t>& weights, ovms::CustomLoaderStatus& status) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    if (key.empty())
+        return false;
+    for (auto itr = entries.begin(); itr != entries.end(); ++itr) {
+        if (itr->key != key)
+            continue;
+        if (!isValid(*itr)) {
+            evict(itr);
+            return false;
+        }
+        try {
+            modelBuffer.assign(itr->model.data, itr->model.data + itr->model.length);
+            weights.assign(itr->weights.data, itr->weights.data + itr->weights.length);
+        } catch (const std::exception& e) {
+            OVSA_DBG(DBG_E, "OvsaModelCache: Error copying cached model failed: %s\n", e.what());
+            modelBuffer.clear();
+            weights.clear();
+            return false;
+        }
+        status = itr->status;
+        entries.splice(entries.begin(), entries, itr);
+        return true;
+    }
+    return false;
+}
+
+// The segment hash is covered by the signature of the controlled access model header, the same
+// hash in a new version means the same cipher text. Only entries of models loaded with the same
+// keystore and whose license is still valid are used.
+bool OvsaModelCache::getFile(const std::string& keystoreKey, const std::string& fileHash,
+                             std::vector<uint8_t>& buffer) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    if (keystoreKey.empty() || fileHash.empty())
+        return false;
+    for (auto itr = entries.begin(); itr != entries.end(); ++itr) {
+        const LockedBuffer* file = nullptr;
+        if (itr->keystoreKey != keystoreKey)
+            continue;
+        if (itr->modelHash == fileHash)
+            file = &itr->model;
+        else if (itr->weightsHash == fileHash)
+            file = &itr->weights;
+        if ((file == nullptr) || !isValid(*itr))
+            continue;
+        try {
+            buffer.assign(file->data, file->data + file->length);
+        } catch (const std::exception& e) {
+            OVSA_DBG(DBG_E, "OvsaModelCache: Error copying cached model file failed: %s\n",
+                     e.what());
+            buffer.clear();
+            return false;
+        }
+        entries.splice(entries.begin(), entries, itr);
+        return true;
+    }
+    return false;
+}
+
+void OvsaModelCache::put(const std::string& key, const std::string& keystoreKey,
+                         const std::vector<uint8_t>& modelBuffer,
+                         const std::vector<uint8_t>& weights, const std::string& modelHash,
+                         const std::string& weightsHash, ovms::CustomLoaderStatus status,
+                         const std::shared_ptr<OvsaModelInstance>& instance) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+    size_t size = std::max(modelBuffer.size(), (size_t)1) + std::max(weights.size(), (size_t)1);
+
+    if (key.empty() || keystoreKey.empty() || (instance == nullptr) || (size > budget))
+        return;
+    for (auto itr = entries.begin(); itr != entries.end(); ++itr) {
+        if (itr->key == key) {
+            evict(itr);
+            break;
+        }
+    }
+    while ((used + size > budget) && !entries.empty())
+        evict(std::prev(entries.end()));
+
+    CacheEntry entry;
+    entry.key         = key;
+    entry.keystoreKey = keystoreKey;
+    entry.modelName   = instance->getModelName();
+    entry.status      = status;
+    entry.modelHash   = modelHash;
+    entry.weightsHash = weightsHash;
+    entry.checkedAt   = std::chrono::steady_clock::now();
+    entry.instance    = instance;
+    if (!allocBuffer(entry.model, modelBuffer) || !allocBuffer(entry.weights, weights)) {
+        freeBuffer(entry.model);
+        freeBuffer(entry.weights);
+        return;
+    }
+    used += entry.model.size + entry.weights.size;
+    entries.push_front(std::move(entry));
+}
+
+// A model loaded from the cache takes over the license checks of the entry, it was last checked
+// when the entry was
+void OvsaModelCache::setInstance(const std::string& key,
+                                 const std::shared_ptr<OvsaModelInstance>& instance) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    for (auto& entry : entries) {
+        if (entry.key == key) {
+            std::shared_ptr<OvsaModelInstance> previous = entry.instance.lock();
+            if (previous != nullptr)
+                entry.checkedAt = std::max(entry.checkedAt, previous->getLastLicenseCheck());
+            instance->setLastLicenseCheck(entry.checkedAt);
+            entry.modelName = instance->getModelName();
+            entry.instance  = instance;
+            break;
+        }
+    }
+}
+
+// Keeps the time of the last license check of a model that is unloaded, the entry stays valid
+// for the rest of the license check interval
+void OvsaModelCache::detachInstance(const std::shared_ptr<OvsaModelInstance>& instance) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    for (auto& entry : entries) {
+        if (entry.instance.lock() == instance)
+            entry.checkedAt = std::max(entry.checkedAt, instance->getLastLicenseCheck());
+    }
+}
+
+void OvsaModelCache::removeInstance(const std::shared_ptr<OvsaModelInstance>& instance) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    for (auto itr = entries.begin(); itr != entries.end();) {
+        auto next = std::next(itr);
+        if (itr->instance.lock() == instance)
+            evict(itr);
+        itr = next;
+    }
+}
+
+void OvsaModelCache::removeModel(const std::string& modelName) {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    for (auto itr = entries.begin(); itr != entries.end();) {
+        auto next = std::next(itr);
+        if (itr->modelName == modelName)
+            evict(itr);
+        itr = next;
+    }
+}
+
+void OvsaModelCache::clear() {
+    std::lock_guard<std::mutex> guard(cache_mutex);
+
+    while (!entries.empty())
+        evict(entries.begin());
+}
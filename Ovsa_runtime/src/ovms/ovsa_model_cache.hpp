@@ -0,0 +1,100 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "customloaderinterface.hpp"
+#include "ovsa_model_instance.hpp"
+
+// Size of the cache of decrypted models in MB, the cache is disabled if it is not set
+#define MODEL_CACHE_SIZE_ENV "OVSA_MODEL_CACHE_MB"
+
+/*
+ * Decrypted models kept in memory across reloads of the model server, so that a model that is
+ * loaded again, e.g. after a change of the configuration, skips the license check and the
+ * decryption. A model is looked up by its controlled access model file, customer license and
+ * keystore, and is reused as long as the license check of the model that loaded it passed within
+ * the license check interval and the keystore still verifies. The models are held in locked
+ * memory that is excluded from core dumps, and is wiped when the model is evicted, retired or
+ * blacklisted.
+ *
+ * The model and weights of an entry are also found by the segment hash of the file they were
+ * decrypted from, so that a new version of the model that reuses the segment of an unchanged
+ * file only decrypts the files that changed. Only entries loaded with the same keystore are
+ * used.
+ */
+class OvsaModelCache {
+   private:
+    struct LockedBuffer {
+        uint8_t* data = nullptr;
+        size_t size   = 0;
+        size_t length = 0;
+    };
+    struct CacheEntry {
+        std::string key;
+        std::string keystoreKey;
+        std::string modelName;
+        ovms::CustomLoaderStatus status;
+        LockedBuffer model;
+        LockedBuffer weights;
+        // Segment hash of the file held by the buffer, empty when it holds none or several
+        std::string modelHash;
+        std::string weightsHash;
+        std::chrono::steady_clock::time_point checkedAt;
+        std::weak_ptr<OvsaModelInstance> instance;
+    };
+
+    std::mutex cache_mutex;
+    // Most recently used first
+    std::list<CacheEntry> entries;
+    size_t budget = 0;
+    size_t used   = 0;
+    std::chrono::milliseconds validity;
+
+    static bool allocBuffer(LockedBuffer& buffer, const std::vector<uint8_t>& content);
+    static void freeBuffer(LockedBuffer& buffer);
+    void evict(std::list<CacheEntry>::iterator entry);
+    bool isValid(const CacheEntry& entry);
+
+   public:
+    OvsaModelCache(const int validityMs);
+    ~OvsaModelCache();
+    void init();
+    static std::string getKeystoreKey(const std::string& ksFile);
+    std::string getKey(const std::string& datFile, const std::string& licFile,
+                       const std::string& ksFile);
+    bool get(const std::string& key, std::vector<uint8_t>& modelBuffer,
+             std::vector<uint8_t>& weights, ovms::CustomLoaderStatus& status);
+    bool getFile(const std::string& keystoreKey, const std::string& fileHash,
+                 std::vector<uint8_t>& buffer);
+    void put(const std::string& key, const std::string& keystoreKey,
+             const std::vector<uint8_t>& modelBuffer, const std::vector<uint8_t>& weights,
+             const std::string& modelHash, const std::string& weightsHash,
+             ovms::CustomLoaderStatus status,
+             const std::shared_ptr<OvsaModelInstance>& instance);
+    void setInstance(const std::string& key, const std::shared_ptr<OvsaModelInstance>& instance);
+    void detachInstance(const std::shared_ptr<OvsaModelInstance>& instance);
+    void removeInstance(const std::shared_ptr<OvsaModelInstance>& instance);
+    void removeModel(const std::string& modelName);
+    void clear();
+};
@@ -14,20 +14,25 @@
 // limitations under the License.
 //*****************************************************************************
 
+#pragma once
+
 #include <string.h>
 
-#include <future>
+#include <atomic>
+#include <chrono>
 #include <iostream>
-#include <mutex>
-#include <thread>
+#include <string>
 
 #include "ovsa_errors.h"
 
 extern "C" {
 ovsa_status_t ovsa_perform_tls_license_check(const int asym_keyslot, const char* customer_license,
                                              bool* status);
-ovsa_status_t ovsa_crypto_load_asymmetric_key(const char* keystore_name, int* asym_key_slot);
-void ovsa_crypto_clear_asymmetric_key_slot(int asym_key_slot);
+ovsa_status_t ovsa_perform_tls_license_check_batch(const int asym_keyslot,
+                                                   const char** customer_licenses, size_t count,
+                                                   bool* status);
+ovsa_status_t ovsa_keystore_cache_get(const char* keystore, int* asym_keyslot);
+void ovsa_keystore_cache_put(int asym_keyslot);
 ovsa_status_t ovsa_crypto_init();
 void ovsa_crypto_deinit();
 };
@@ -39,26 +44,23 @@ class OvsaModelInstance {
     std::string model_licFile;
     std::string model_datFile;
     int model_version;
-    bool model_is_blacklisted;
-    std::mutex& mutex_lock;
-
-   protected:
-    std::promise<void> exitSignal;
-    int watchIntervalSecs = 0;
-    bool watcherStarted   = false;
-    std::thread watcher_thread;
+    // Updated by the license check scheduler thread
+    std::atomic<bool> model_is_blacklisted;
+    std::atomic<std::chrono::steady_clock::rep> model_license_checked;
 
    public:
-    OvsaModelInstance(std::mutex& mutex);
+    OvsaModelInstance();
     OvsaModelInstance(const std::string modelName, const std::string& ksFile,
                       const std::string& licFile, const std::string& datFile, bool licState,
-                      int model_version, std::mutex& mutex);
+                      int model_version);
     OvsaModelInstance(const OvsaModelInstance& s);
     OvsaModelInstance& operator=(const OvsaModelInstance& s);
     ~OvsaModelInstance();
     bool getBlackListStatus();
-    void releaseResources();
-    void threadFunction(std::future<void> futureObj);
-    void startWatcher(const int intervalSec);
-    void watcherJoin();
+    void setBlackListStatus(bool status);
+    std::chrono::steady_clock::time_point getLastLicenseCheck() const;
+    void setLastLicenseCheck(std::chrono::steady_clock::time_point checked);
+    const std::string& getModelName() const;
+    const std::string& getKeystoreFile() const;
+    const std::string& getLicenseFile() const;
 };
@@ -0,0 +1,50 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include "ovsa_model_table.hpp"
+
+OvsaModelTable::OvsaModelTable() : current(new model_map_t()), readers(0) {}
+
+OvsaModelTable::~OvsaModelTable() {
+    for (auto models : retired)
+        delete models;
+    delete current.load();
+}
+
+void OvsaModelTable::publish(const model_map_t& models) {
+    const model_map_t* previous = current.exchange(new model_map_t(models));
+    retired.push_back(previous);
+
+    // A lookup that starts from now on reads the new copy, none reads the retired ones if there
+    // is no lookup in progress
+    if (readers.load() != 0)
+        return;
+    for (auto copy : retired)
+        delete copy;
+    retired.clear();
+}
+
+std::shared_ptr<OvsaModelInstance> OvsaModelTable::find(const map_key_t& key) const {
+    std::shared_ptr<OvsaModelInstance> instance;
+
+    readers.fetch_add(1);
+    const model_map_t* models = current.load();
+    auto itr                  = models->find(key);
+    if (itr != models->end())
+        instance = itr->second;
+    readers.fetch_sub(1);
+    return instance;
+}
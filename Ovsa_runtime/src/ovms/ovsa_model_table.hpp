@@ -0,0 +1,52 @@
+//*****************************************************************************
+// Copyright 2020-2022 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ovsa_model_instance.hpp"
+
+typedef std::pair<std::string, int> map_key_t;
+typedef std::map<map_key_t, std::shared_ptr<OvsaModelInstance>> model_map_t;
+
+/*
+ * Read-mostly snapshot of the loaded models, looked up by the model server on each check of the
+ * blacklist status. The loads and unloads of models publish a new copy of the map and the lookups
+ * read the current copy without taking a lock. A copy that is replaced is freed by a later
+ * publish once no lookup is in progress.
+ */
+class OvsaModelTable {
+   private:
+    std::atomic<const model_map_t*> current;
+    mutable std::atomic<int> readers;
+    // Replaced copies that lookups may still be reading, only accessed by publish
+    std::vector<const model_map_t*> retired;
+
+   public:
+    OvsaModelTable();
+    ~OvsaModelTable();
+    OvsaModelTable(const OvsaModelTable&) = delete;
+    OvsaModelTable& operator=(const OvsaModelTable&) = delete;
+    // The callers of publish are serialized by the custom loader
+    void publish(const model_map_t& models);
+    std::shared_ptr<OvsaModelInstance> find(const map_key_t& key) const;
+};
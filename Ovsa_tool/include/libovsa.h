@@ -42,7 +42,6 @@
 #define MAX_BUF_SIZE                                     4096
 #define KEYSTORE_BLOB_TEXT_SIZE                          155
 #define MIN_KEY_SLOT                                     0
-#define MAX_KEY_SLOT                                     64
 #define SYMMETRIC_KEY_SIZE                               32
 #define ENC_KEYSTORE_BLOB_TEXT_SIZE                      20
 #define SIGNATURE_BLOB_TEXT_SIZE                         18
@@ -54,6 +53,9 @@
 #define HASH_ALG_SHA256                                  1
 #define HASH_ALG_SHA384                                  2
 #define HASH_ALG_SHA512                                  3
+#define ENCRYPT_HEADER_LEN                               16 /* Magic and salt */
+#define ENCRYPT_GCM_SEGMENT_SIZE                         (4 * 1024 * 1024)
+#define ENCRYPT_GCM_TAG_LEN                              16
 
 /* As per the ASN1_STRING_TABLE, computed max size of the attribute types
    found in the Distinguished Name are around ~129K and added certain buffer
@@ -325,6 +327,20 @@ ovsa_status_t ovsa_crypto_extract_pubkey_certificate(const char* cert, char* pub
 ovsa_status_t ovsa_crypto_compute_hash(const char* in_buff, int hash_alg, unsigned char* out_buff,
                                        bool b64_format);
 
+/** \brief This function computes the hash of a binary memory buffer of the specified length.
+ *
+ * \param[in]  in_buff     Input buffer for hashing.
+ * \param[in]  in_buff_len Length of input buffer for hashing.
+ * \param[in]  hash_alg    Hashing algorithm.
+ * \param[out] out_buff    Output buffer to store the computed hash, HASH_SIZE bytes.
+ * \param[in]  b64_format  Flag to base64 encode the computed hash.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_compute_buff_hash(const char* in_buff, size_t in_buff_len,
+                                            int hash_alg, unsigned char* out_buff,
+                                            bool b64_format);
+
 /** \brief This function verifies the entire certificate chain along with OCSP check.
  *
  * \param[in]  asym_key_slot            Asymmetric key slot index.
@@ -408,6 +424,22 @@ ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, siz
                                       char* magic_salt_buff, char** out_buff, size_t* out_buff_len,
                                       int* keyiv_hmac_slot);
 
+/** \brief This function encrypts the contents of memory specified as input using the
+ *         encryption key and returns the raw cipher text, not base64 encoded.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[in]  in_buff         Input buffer for encryption.
+ * \param[in]  in_buff_len     Length of input buffer for encryption.
+ * \param[out] out_buff        Output buffer to store encrypted data.
+ * \param[out] out_buff_len    Length of the output buffer.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_encrypt_raw_mem(int sym_key_slot, const char* in_buff,
+                                          size_t in_buff_len, char** out_buff,
+                                          size_t* out_buff_len, int* keyiv_hmac_slot);
+
 /** \brief This function decrypts the contents of memory specified as input using the
  *         decryption key.
  *
@@ -423,6 +455,267 @@ ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, siz
 ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, size_t in_buff_len,
                                       char** out_buff, size_t* out_buff_len, int* keyiv_hmac_slot);
 
+/** \brief Callback receiving the data decrypted by ovsa_crypto_decrypt_mem_stream() chunk by
+ *         chunk.
+ *
+ * \param[in]  write_ctx  Context passed to ovsa_crypto_decrypt_mem_stream().
+ * \param[in]  buff       Decrypted data.
+ * \param[in]  buff_len   Length of the decrypted data.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+typedef ovsa_status_t (*ovsa_crypto_write_cb_t)(void* write_ctx, const char* buff,
+                                                size_t buff_len);
+
+/** \brief This function decrypts the contents of memory specified as input using the
+ *         decryption key and hands the decrypted data over to the callback chunk by chunk,
+ *         without buffering it.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[in]  in_buff         Input buffer for decryption.
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ * \param[in]  write_cb        Callback receiving the decrypted data.
+ * \param[in]  write_ctx       Context passed to the callback.
+ * \param[out] out_buff_len    Length of the decrypted data.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_decrypt_mem_stream(int sym_key_slot, const char* in_buff,
+                                             size_t in_buff_len, ovsa_crypto_write_cb_t write_cb,
+                                             void* write_ctx, size_t* out_buff_len,
+                                             int* keyiv_hmac_slot);
+
+/** \brief This function decrypts raw (not base64 encoded) cipher text, as stored in the binary
+ *         controlled access model, straight from the input buffer and hands over the plain
+ *         text chunk by chunk to the callback.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[in]  in_buff         Raw input buffer for decryption, may be memory mapped.
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ * \param[in]  write_cb        Callback receiving the decrypted data.
+ * \param[in]  write_ctx       Context passed to the callback.
+ * \param[out] out_buff_len    Length of the decrypted data.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_decrypt_raw_mem_stream(int sym_key_slot, const char* in_buff,
+                                                 size_t in_buff_len,
+                                                 ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                                 size_t* out_buff_len, int* keyiv_hmac_slot);
+
+/** \brief This function derives key, IV and HMAC from the magic and salt of raw (not base64
+ *         encoded) cipher text.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[in]  in_buff         Raw input buffer for extracting salt.
+ * \param[in]  in_buff_len     Length of input buffer.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_derive_raw_keyiv_hmac(int sym_key_slot, const char* in_buff,
+                                                size_t in_buff_len, int* keyiv_hmac_slot);
+
+/** \brief This function returns the exact length of the plain text of an encrypted buffer.
+ *
+ * \param[in]  in_buff     Input buffer for decryption.
+ * \param[in]  in_buff_len Length of input buffer for decryption.
+ * \param[in]  b64_format  Flag indicating the input buffer is base64 encoded.
+ *
+ * \return Length of the plain text, 0 if the buffer is malformed
+ */
+size_t ovsa_crypto_get_plain_text_len(const char* in_buff, size_t in_buff_len, bool b64_format);
+
+/** \brief This function decrypts the plain text range [offset, offset + length) of an
+ *         encrypted buffer. The CTR mode counter is moved to the offset, so ranges of the same
+ *         buffer can be decrypted independently of each other, e.g. on several threads.
+ *
+ * \param[in]  keyiv_hmac_slot key/IV/HMAC slot index derived for the input buffer.
+ * \param[in]  in_buff         Input buffer for decryption.
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ * \param[in]  b64_format      Flag indicating the input buffer is base64 encoded.
+ * \param[in]  offset          Offset of the range in the plain text.
+ * \param[in]  length          Length of the range.
+ * \param[out] out_buff        Output buffer of length bytes to store the decrypted range.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_decrypt_mem_range(int keyiv_hmac_slot, const char* in_buff,
+                                            size_t in_buff_len, bool b64_format, size_t offset,
+                                            size_t length, char* out_buff);
+
+/** \brief This function starts the encryption of a buffer in ranges. A new salt is generated and
+ *         the key/IV/HMAC is derived from it, the same as ovsa_crypto_encrypt_mem() does.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[out] magic_salt      Buffer of ENCRYPT_HEADER_LEN bytes to store the raw magic and salt.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_init_encrypt_range(int sym_key_slot, char* magic_salt,
+                                             int* keyiv_hmac_slot);
+
+/** \brief This function encrypts the plain text range [offset, offset + length) of a buffer.
+ *         The output is the part of the encrypted buffer holding the range, including the magic
+ *         and salt for offset 0. Ranges can be encrypted independently of each other, e.g. on
+ *         several threads, and concatenated in the order of their offsets to the same output as
+ *         ovsa_crypto_encrypt_mem() or ovsa_crypto_encrypt_raw_mem() produce.
+ *         For base64 output, ENCRYPT_HEADER_LEN + offset of a range other than the first one and
+ *         ENCRYPT_HEADER_LEN + offset + length of a range other than the last one must be a
+ *         multiple of 3.
+ *
+ * \param[in]  keyiv_hmac_slot key/IV/HMAC slot index from ovsa_crypto_init_encrypt_range().
+ * \param[in]  magic_salt      Raw magic and salt from ovsa_crypto_init_encrypt_range().
+ * \param[in]  in_buff         Plain text of the range.
+ * \param[in]  offset          Offset of the range in the plain text.
+ * \param[in]  length          Length of the range.
+ * \param[in]  b64_format      Flag indicating the output is base64 encoded.
+ * \param[out] out_buff        Output buffer to store the encrypted range, see
+ *                             ovsa_crypto_get_encrypt_mem_pos(). No null terminator is added.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_encrypt_mem_range(int keyiv_hmac_slot, const char* magic_salt,
+                                            const char* in_buff, size_t offset, size_t length,
+                                            bool b64_format, char* out_buff);
+
+/** \brief This function returns the position of a plain text offset in the output of
+ *         ovsa_crypto_encrypt_mem() or ovsa_crypto_encrypt_raw_mem(). The position of the plain
+ *         text length is the length of the encrypted buffer, the length of an encrypted range is
+ *         the difference of the positions of its end and its offset.
+ *
+ * \param[in]  offset          Offset in the plain text, 0 is the start of the magic and salt.
+ * \param[in]  b64_format      Flag indicating the output is base64 encoded.
+ *
+ * \return Position in the encrypted buffer
+ */
+size_t ovsa_crypto_get_encrypt_mem_pos(size_t offset, bool b64_format);
+
+/** \brief This function returns the position of a plain text offset in the output of the
+ *         AES-256-GCM encryption. The output is the magic and salt followed by the segments of
+ *         ENCRYPT_GCM_SEGMENT_SIZE bytes of plain text, each one with its cipher text and its
+ *         ENCRYPT_GCM_TAG_LEN bytes tag. The position of the plain text length is the length of
+ *         the encrypted buffer.
+ *
+ * \param[in]  offset          Offset in the plain text, 0 is the start of the magic and salt.
+ *
+ * \return Position in the encrypted buffer
+ */
+size_t ovsa_crypto_get_gcm_encrypt_pos(size_t offset);
+
+/** \brief This function returns the exact length of the plain text of an AES-256-GCM encrypted
+ *         buffer.
+ *
+ * \param[in]  in_buff     Input buffer for decryption.
+ * \param[in]  in_buff_len Length of input buffer for decryption.
+ *
+ * \return Length of the plain text, 0 if the buffer is malformed
+ */
+size_t ovsa_crypto_get_gcm_plain_text_len(const char* in_buff, size_t in_buff_len);
+
+/** \brief This function encrypts and authenticates one segment of a buffer with AES-256-GCM.
+ *         Segments get a nonce of their own and can be encrypted independently of each other,
+ *         e.g. on several threads. The magic, salt and plain text length are authenticated
+ *         with every segment.
+ *
+ * \param[in]  keyiv_hmac_slot key/IV/HMAC slot index from ovsa_crypto_init_encrypt_range().
+ * \param[in]  magic_salt      Raw magic and salt from ovsa_crypto_init_encrypt_range().
+ * \param[in]  plain_len       Length of the whole plain text.
+ * \param[in]  in_buff         Plain text of the segment.
+ * \param[in]  offset          Offset of the segment, a multiple of ENCRYPT_GCM_SEGMENT_SIZE.
+ * \param[in]  length          Length of the segment, ENCRYPT_GCM_SEGMENT_SIZE but for the last.
+ * \param[out] out_buff        Output buffer at ovsa_crypto_get_gcm_encrypt_pos() of the offset,
+ *                             the magic and salt are written in front of the first segment.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_encrypt_gcm_range(int keyiv_hmac_slot, const char* magic_salt,
+                                            size_t plain_len, const char* in_buff, size_t offset,
+                                            size_t length, char* out_buff);
+
+/** \brief This function decrypts and verifies one segment of an AES-256-GCM encrypted buffer.
+ *         The output is cleared if the tag does not match.
+ *
+ * \param[in]  keyiv_hmac_slot key/IV/HMAC slot index derived for the input buffer.
+ * \param[in]  in_buff         Raw input buffer for decryption, may be memory mapped.
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ * \param[in]  offset          Offset of the segment, a multiple of ENCRYPT_GCM_SEGMENT_SIZE.
+ * \param[in]  length          Length of the segment, ENCRYPT_GCM_SEGMENT_SIZE but for the last.
+ * \param[out] out_buff        Output buffer of length bytes to store the decrypted segment.
+ *
+ * \return ovsa_status_t: OVSA_OK, OVSA_CRYPTO_TAG_VALIDATION_FAILED or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_decrypt_gcm_range(int keyiv_hmac_slot, const char* in_buff,
+                                            size_t in_buff_len, size_t offset, size_t length,
+                                            char* out_buff);
+
+/** \brief This function decrypts an AES-256-GCM encrypted buffer segment by segment and hands
+ *         over the plain text of each verified segment to the callback.
+ *
+ * \param[in]  sym_key_slot    Symmetric key slot index.
+ * \param[in]  in_buff         Raw input buffer for decryption, may be memory mapped.
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ * \param[in]  write_cb        Callback receiving the decrypted data.
+ * \param[in]  write_ctx       Context passed to the callback.
+ * \param[out] out_buff_len    Length of the decrypted data.
+ * \param[out] keyiv_hmac_slot key/IV/HMAC slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK, OVSA_CRYPTO_TAG_VALIDATION_FAILED or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_decrypt_gcm_mem_stream(int sym_key_slot, const char* in_buff,
+                                                 size_t in_buff_len,
+                                                 ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                                 size_t* out_buff_len, int* keyiv_hmac_slot);
+
+/** \brief This function computes the HMAC-SHA512 of the plain text of a model file, keyed with
+ *         the model encryption key. It addresses the content of the file in the controlled
+ *         access model without giving it away, so that a file that did not change is found
+ *         again in the next version of the model.
+ *
+ * \param[in]  sym_key_slot Symmetric key slot index of the model encryption key.
+ * \param[in]  in_buff      Plain text of the model file.
+ * \param[in]  in_buff_len  Length of the plain text.
+ * \param[out] out_buff     Output buffer to store the base64 encoded hash, HASH_SIZE bytes.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_compute_content_hash(int sym_key_slot, const char* in_buff,
+                                               size_t in_buff_len, unsigned char* out_buff);
+
+/** \brief This function computes the SHA-512 hash of the magic, salt and segment tags of an
+ *         AES-256-GCM encrypted buffer. As the tags authenticate the segments, the hash binds
+ *         the whole buffer without reading its cipher text.
+ *
+ * \param[in]  in_buff     Raw input buffer.
+ * \param[in]  in_buff_len Length of input buffer.
+ * \param[out] out_buff    Output buffer to store the base64 encoded hash, HASH_SIZE bytes.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_compute_gcm_tags_hash(const char* in_buff, size_t in_buff_len,
+                                                unsigned char* out_buff);
+
+/** \brief This function returns the maximum length of the data decrypted from an input buffer
+ *         of the specified length.
+ *
+ * \param[in]  in_buff_len     Length of input buffer for decryption.
+ *
+ * \return Maximum length of the decrypted data
+ */
+size_t ovsa_crypto_get_decrypt_mem_len(size_t in_buff_len);
+
+/** \brief This function returns the maximum length of the data decrypted from a raw input
+ *         buffer of the specified length.
+ *
+ * \param[in]  in_buff_len     Length of raw input buffer for decryption.
+ *
+ * \return Maximum length of the decrypted data
+ */
+size_t ovsa_crypto_get_raw_decrypt_mem_len(size_t in_buff_len);
+
 /** \brief This function clears the asymmetric primary and secondary key pairs from the
  *         asymmetric key slot.
  *
@@ -436,6 +729,23 @@ void ovsa_crypto_clear_asymmetric_key_slot(int asym_key_slot);
  */
 void ovsa_crypto_clear_symmetric_key_slot(int sym_key_slot);
 
+/** \brief This function allocates a zeroed buffer for decrypted model files or key material. The
+ *         buffer is locked into memory and excluded from core dumps, large buffers are backed by
+ *         huge pages when available.
+ *
+ * \param[in]  size  Buffer size for allocation.
+ * \param[out] buff  Allocated buffer, to be freed with ovsa_crypto_secure_free().
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_secure_malloc(size_t size, char** buff);
+
+/** \brief This function wipes and frees a buffer allocated with ovsa_crypto_secure_malloc().
+ *
+ * \param[in,out] buff  Buffer to be freed, set to NULL.
+ */
+void ovsa_crypto_secure_free(char** buff);
+
 /** \brief This function converts binary contents to base64 format.
  *
  * \param[in]  in_buff         Input buffer for conversion.
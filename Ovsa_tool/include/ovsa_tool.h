@@ -23,13 +23,26 @@
 /* Needs to be updated based on the json blob key names */
 #define LICENSE_CONFIG_BLOB_TEXT_SIZE          147
 #define LICENSE_URL_BLOB_TEXT_SIZE             190
-#define CONTROLLED_ACCESS_MODEL_BLOB_TEXT_SIZE 110
+#define CONTROLLED_ACCESS_MODEL_BLOB_TEXT_SIZE 145
 #define MODEL_FILE_BLOB_TEXT_SIZE              15
 #define MASTER_LICENSE_BLOB_TEXT_SIZE          131
 #define CUSTOMER_LICENSE_BLOB_TEXT_SIZE        300
 #define TCB_NAME_BLOB_TEXT_SIZE                15
 #define MAX_FILE_NAME_LEN                      20
 
+/*
+ * Binary controlled access model container: magic, big endian length of the signed JSON
+ * header, the signed JSON header and the raw cipher text segments of the model files
+ */
+#define CONTROLLED_ACCESS_MODEL_BIN_MAGIC     "OVSACAM1"
+#define CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN 8
+#define CONTROLLED_ACCESS_MODEL_BIN_LEN_SIZE  8
+#define CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN \
+    (CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN + CONTROLLED_ACCESS_MODEL_BIN_LEN_SIZE)
+
+/* Value of "file_encryption" in the controlled access model, absent for AES-256-CTR */
+#define CONTROLLED_ACCESS_MODEL_GCM_ENCRYPTION "aes-256-gcm"
+
 #define TCB_INFO_BLOB_TEXT_SIZE 435
 #define TPM2_QUOTE_SIZE         3072
 #define TPM2_PUBKEY_SIZE        512
@@ -169,6 +182,11 @@ typedef struct ovsa_model_files {
     char model_file_name[MAX_NAME_SIZE];
     char* model_file_data;
     int model_file_length;
+    /* Offset of the segment and its hash, binary controlled access model only */
+    size_t model_file_offset;
+    char model_file_hash[HASH_SIZE];
+    /* Keyed hash of the plain text, finds the segment again in the next version of the model */
+    char model_file_content_hash[HASH_SIZE];
     struct ovsa_model_files* next;
 } ovsa_model_files_t;
 
@@ -184,6 +202,14 @@ typedef struct ovsa_controlled_access_model {
     char* isv_certificate;
     GUID model_guid;
     ovsa_model_files_t* enc_model;
+    /* Model files are stored as raw segments after the JSON header */
+    bool binary_format;
+    /* Model files are encrypted with AES-256-GCM, binary controlled access model only */
+    bool gcm_format;
+    /* Mapping of the binary controlled access model and offset of its segments */
+    char* enc_model_map;
+    size_t enc_model_map_len;
+    size_t enc_model_segments_offset;
 } ovsa_controlled_access_model_t;
 
 /* Controlled Access Model Struct with Signature */
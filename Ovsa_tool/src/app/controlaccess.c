@@ -17,10 +17,14 @@
 
 #include <ctype.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "libovsa.h"
 #include "ovsa_tool.h"
@@ -38,6 +42,35 @@ static char* g_model_description = NULL;
 static char* g_model_version     = NULL;
 static char g_model_guid[GUID_SIZE];
 
+/* Raw bytes of the encrypted stream per segment, a multiple of 3 so base64 segments line up */
+#define ENCRYPT_SEGMENT_SIZE (3 * 1024 * 1024)
+#define MAX_ENCRYPT_THREADS  16
+
+/* Model file encrypted segment by segment straight from the file */
+typedef struct ovsa_encrypt_file {
+    const char* name;
+    int fd;
+    size_t file_length;
+    int keyiv_hmac_slot;
+    char magic_salt[ENCRYPT_HEADER_LEN];
+    char* enc_buff;
+    /* Unchanged since the previous version of the model, its segment is copied over */
+    bool reused;
+} ovsa_encrypt_file_t;
+
+/* Work shared by the encryption threads, each one picks the next segment under the lock */
+typedef struct ovsa_encrypt_pool {
+    ovsa_encrypt_file_t* files;
+    int file_count;
+    int next_file;
+    size_t next_offset;
+    bool b64_format;
+    /* AES-256-GCM segments with a tag each, instead of a CTR mode stream */
+    bool gcm_format;
+    ovsa_status_t ret;
+    pthread_mutex_t lock;
+} ovsa_encrypt_pool_t;
+
 static void ovsa_controlaccess_help(const char* argv) {
     printf("Help for Control Access command\n");
     printf(
@@ -49,6 +82,12 @@ static void ovsa_controlaccess_help(const char* argv) {
     printf("-m : Master license file\n");
     printf("-k : Keystore name\n");
     printf("-g : License GUID\n");
+    printf("-b : Store the model files as raw segments in a binary controlled access model\n");
+    printf("-j : Number of threads encrypting the model files, 1 by default\n");
+    printf("-a : Authenticated AES-256-GCM encryption of the model files, requires -b\n");
+    printf("-u : Previous version of the binary controlled access model, the segments of the "
+           "files that did not change are reused, requires -b and -l\n");
+    printf("-l : Master license file of the previous version of the model\n");
     printf("Example for controllAccess as below:\n");
     printf(
         "-i <Intermediate File> <Model weights file> <additional files> -n <Model name> -d <Model "
@@ -61,38 +100,479 @@ static void ovsa_controlaccess_help(const char* argv) {
         "face_detection_model_master.lic -k key_store -g "
         "\"50934a64-5d1b-4655-bcb4-80080fcb8858\"\n",
         argv);
+    printf("Example for an update of the model as below:\n");
+    printf(
+        "%s controlAccess -i face_detection.xml face_detection.bin face_detection.txt -n \"Face "
+        "Detection\" -d \"Face person detection retail\" -v 0003 -b -p face_detection_model_v3.dat "
+        "-m face_detection_model_master_v3.lic -u face_detection_model.dat -l "
+        "face_detection_model_master.lic -k key_store -g "
+        "\"2bbd9e2c-0d7a-4ff4-8f25-2c2d1ef0f6a1\"\n",
+        argv);
+}
+
+static const char* ovsa_get_model_file_basename(const char* model_file_name) {
+    char* filename = NULL;
+
+    /* The controlled access model only holds the file names, see
+     * ovsa_json_create_controlled_access_model() */
+    if (strlastchar_s((char*)model_file_name, strnlen_s(model_file_name, MAX_NAME_SIZE), '/',
+                      &filename) == EOK) {
+        return filename + 1;
+    }
+    return model_file_name;
+}
+
+/* Model encryption key of the previous version of the model, unwrapped from its master license */
+static ovsa_status_t ovsa_read_previous_master_license(int asymm_keyslot,
+                                                       const char* prev_masterlic_file,
+                                                       int* sym_keyslot, char* model_hash) {
+    ovsa_status_t ret     = OVSA_OK;
+    char* master_lic_buf  = NULL;
+    char* master_lic_json = NULL;
+    char* encryption_key  = NULL;
+    char* prev_model_hash = NULL;
+    size_t size           = 0;
+    int keyiv_hmac_slot   = -1;
+
+    OVSA_DBG(DBG_I, "OVSA: Read Previous Master License\n");
+    ret = ovsa_read_file_content(prev_masterlic_file, &master_lic_buf, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading master license %s failed with code %d\n",
+                 prev_masterlic_file, ret);
+        goto out;
+    }
+    ret = ovsa_json_extract_element(master_lic_buf, "encryption_key", &encryption_key);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error extract json element failed with error code %d\n", ret);
+        goto out;
+    }
+
+    /* The key was wrapped with the ECDH key of the primary and secondary keys of the keystore */
+    ret = ovsa_crypto_unwrap_key(asymm_keyslot + 1, asymm_keyslot, encryption_key,
+                                 strnlen_s(encryption_key, MAX_EKEY_SIZE), sym_keyslot,
+                                 &keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error unwrap model encryption key failed with code %d\n", ret);
+        goto out;
+    }
+
+    /* Verifies the HMAC for master license */
+    ret = ovsa_safe_malloc(size, &master_lic_json);
+    if (ret < OVSA_OK || master_lic_json == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error buffer allocation failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_crypto_verify_hmac_json_blob(keyiv_hmac_slot, master_lic_buf, size,
+                                            master_lic_json, size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error verify master license failed with error code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_json_extract_element(master_lic_buf, "model_hash", &prev_model_hash);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error extract json element failed with error code %d\n", ret);
+        goto out;
+    }
+    memcpy_s(model_hash, HASH_SIZE, prev_model_hash, strnlen_s(prev_model_hash, HASH_SIZE));
+    OVSA_DBG(DBG_I, "OVSA: %s file verified successfully\n", prev_masterlic_file);
+
+out:
+    /* Clear key/IV/HMAC from the key slot */
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        ovsa_crypto_clear_symmetric_key_slot(*sym_keyslot);
+        *sym_keyslot = -1;
+    }
+    if (encryption_key != NULL) {
+        memset_s(encryption_key, strnlen_s(encryption_key, MAX_EKEY_SIZE), 0);
+    }
+    ovsa_safe_free(&encryption_key);
+    ovsa_safe_free(&prev_model_hash);
+    ovsa_safe_free(&master_lic_json);
+    ovsa_safe_free(&master_lic_buf);
+    return ret;
+}
+
+/* Maps the binary controlled access model of the previous version, the segments are copied from
+ * the mapping once its signed header is verified */
+static ovsa_status_t ovsa_read_previous_model(int asymm_keyslot, const char* prev_model_file,
+                                              const char* model_hash,
+                                              ovsa_controlled_access_model_sig_t* prev_model_sig) {
+    ovsa_status_t ret        = OVSA_OK;
+    FILE* fptr               = NULL;
+    unsigned char* model_map = NULL;
+    size_t model_map_len     = 0;
+    size_t header_len        = 0;
+    char* header_buf         = NULL;
+    char* header_json        = NULL;
+    int indicator            = -1;
+    int i                    = 0;
+    char header_hash[HASH_SIZE];
+    struct stat file_stat;
+
+    OVSA_DBG(DBG_I, "OVSA: Read Previous Controlled Access Model\n");
+    fptr = fopen(prev_model_file, "rb");
+    if (fptr == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error opening controlled access model %s\n", prev_model_file);
+        return OVSA_FILEOPEN_FAIL;
+    }
+    if ((fstat(fileno(fptr), &file_stat) != 0) ||
+        (file_stat.st_size <= CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN)) {
+        OVSA_DBG(DBG_E, "OVSA: Error get size of binary controlled access model failed\n");
+        fclose(fptr);
+        return OVSA_FILEIO_FAIL;
+    }
+    model_map_len = (size_t)file_stat.st_size;
+    model_map     = (unsigned char*)mmap(NULL, model_map_len, PROT_READ, MAP_PRIVATE,
+                                         fileno(fptr), 0);
+    fclose(fptr);
+    if (model_map == MAP_FAILED) {
+        OVSA_DBG(DBG_E, "OVSA: Error mapping binary controlled access model failed\n");
+        return OVSA_FILEIO_FAIL;
+    }
+
+    memcmp_s(model_map, CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN, CONTROLLED_ACCESS_MODEL_BIN_MAGIC,
+             CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN, &indicator);
+    if (indicator != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error %s is not a binary controlled access model\n",
+                 prev_model_file);
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    for (i = 0; i < CONTROLLED_ACCESS_MODEL_BIN_LEN_SIZE; i++) {
+        header_len = (header_len << 8) | model_map[CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN + i];
+    }
+    if ((header_len == 0) ||
+        (header_len > model_map_len - CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN)) {
+        OVSA_DBG(DBG_E, "OVSA: Error binary controlled access model header length invalid\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+
+    /* The signed JSON header, null terminated for the JSON parser */
+    ret = ovsa_safe_malloc(header_len + 1, &header_buf);
+    if (ret < OVSA_OK || header_buf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error buffer allocation failed with code %d\n", ret);
+        goto out;
+    }
+    memcpy_s(header_buf, header_len + 1, model_map + CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN,
+             header_len);
+    ret = ovsa_safe_malloc(header_len + 1, &header_json);
+    if (ret < OVSA_OK || header_json == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error buffer allocation failed with code %d\n", ret);
+        goto out;
+    }
+    ret = ovsa_crypto_verify_json_blob(asymm_keyslot, header_buf, header_len + 1, header_json,
+                                       header_len + 1);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error verify controlled access model failed with code %d\n", ret);
+        goto out;
+    }
+
+    /* The master license the key was unwrapped from has to be the one of this model */
+    ret = ovsa_crypto_compute_hash(header_json, HASH_ALG_SHA512, (unsigned char*)header_hash,
+                                   true /*FORMAT_BASE64*/);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error model HASH generation failed with code %d\n", ret);
+        goto out;
+    }
+    indicator = -1;
+    strcmp_s(model_hash, HASH_SIZE, header_hash, &indicator);
+    if (indicator != 0) {
+        OVSA_DBG(DBG_E,
+                 "OVSA: Error previous master license was not issued for the controlled access "
+                 "model %s\n",
+                 prev_model_file);
+        ret = OVSA_CONTROLED_ACCESS_MODEL_HASH_VALIDATION_FAILED;
+        goto out;
+    }
+
+    ret = ovsa_json_extract_controlled_access_model(header_buf, prev_model_sig);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E,
+                 "OVSA: Error extract controlled access model json failed with code %d\n", ret);
+        goto out;
+    }
+    prev_model_sig->controlled_access_model.enc_model_map     = (char*)model_map;
+    prev_model_sig->controlled_access_model.enc_model_map_len = model_map_len;
+    prev_model_sig->controlled_access_model.enc_model_segments_offset =
+        CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN + header_len;
+    model_map = NULL;
+    OVSA_DBG(DBG_I, "OVSA: %s file verified successfully\n", prev_model_file);
+
+out:
+    if (model_map != NULL) {
+        munmap(model_map, model_map_len);
+    }
+    ovsa_safe_free(&header_json);
+    ovsa_safe_free(&header_buf);
+    return ret;
+}
+
+static void ovsa_free_previous_model(ovsa_controlled_access_model_sig_t* prev_model_sig) {
+    ovsa_controlled_access_model_t* prev_model = &prev_model_sig->controlled_access_model;
+
+    if (prev_model->enc_model_map != NULL) {
+        munmap(prev_model->enc_model_map, prev_model->enc_model_map_len);
+        prev_model->enc_model_map = NULL;
+    }
+    ovsa_safe_free_model_file_list(&prev_model->enc_model);
+    ovsa_safe_free(&prev_model->isv_certificate);
+}
+
+/* Segment of the previous version holding the same file, found by its name and content hash */
+static const ovsa_model_files_t* ovsa_find_previous_model_file(
+    const ovsa_controlled_access_model_t* prev_model, const char* model_file_name,
+    const char* content_hash) {
+    const ovsa_model_files_t* prev_file = NULL;
+    const char* filename                = ovsa_get_model_file_basename(model_file_name);
+    int name_indicator                  = -1;
+    int hash_indicator                  = -1;
+
+    for (prev_file = prev_model->enc_model; prev_file != NULL; prev_file = prev_file->next) {
+        /* Models created before the content hashes were added have none to match */
+        if (prev_file->model_file_content_hash[0] == '\0') {
+            continue;
+        }
+        strcmp_s(prev_file->model_file_name, MAX_NAME_SIZE, filename, &name_indicator);
+        strcmp_s(prev_file->model_file_content_hash, HASH_SIZE, content_hash, &hash_indicator);
+        if ((name_indicator == 0) && (hash_indicator == 0)) {
+            return prev_file;
+        }
+    }
+    return NULL;
+}
+
+/* Copies the cipher text of an unchanged file, the segment is checked against the signed hash of
+ * the previous header first */
+static ovsa_status_t ovsa_reuse_previous_model_file(
+    const ovsa_controlled_access_model_t* prev_model, const ovsa_model_files_t* prev_file,
+    ovsa_model_files_t* enc_model) {
+    ovsa_status_t ret   = OVSA_OK;
+    const char* segment = NULL;
+    size_t segments_len = 0;
+    size_t segment_len  = (size_t)prev_file->model_file_length;
+    int hash_indicator  = -1;
+    char segment_hash[HASH_SIZE];
+
+    segments_len = prev_model->enc_model_map_len - prev_model->enc_model_segments_offset;
+    if ((prev_file->model_file_length <= 0) || (prev_file->model_file_offset > segments_len) ||
+        (segment_len > segments_len - prev_file->model_file_offset)) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment of %s exceeds the controlled access model\n",
+                 prev_file->model_file_name);
+        return OVSA_INVALID_PARAMETER;
+    }
+    segment = prev_model->enc_model_map + prev_model->enc_model_segments_offset +
+              prev_file->model_file_offset;
+
+    if (prev_model->gcm_format) {
+        ret = ovsa_crypto_compute_gcm_tags_hash(segment, segment_len,
+                                                (unsigned char*)segment_hash);
+    } else {
+        ret = ovsa_crypto_compute_buff_hash(segment, segment_len, HASH_ALG_SHA512,
+                                            (unsigned char*)segment_hash, true /*FORMAT_BASE64*/);
+    }
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment HASH generation failed with code %d\n", ret);
+        return ret;
+    }
+    strcmp_s(prev_file->model_file_hash, HASH_SIZE, segment_hash, &hash_indicator);
+    if (hash_indicator != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error segment HASH of %s does not match\n",
+                 prev_file->model_file_name);
+        return OVSA_CONTROLED_ACCESS_MODEL_HASH_VALIDATION_FAILED;
+    }
+
+    ret = ovsa_safe_malloc(segment_len + NULL_TERMINATOR, &enc_model->model_file_data);
+    if (ret < OVSA_OK || enc_model->model_file_data == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error encryption buffer allocation failed with code %d\n", ret);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    memcpy_s(enc_model->model_file_data, segment_len + NULL_TERMINATOR, segment, segment_len);
+    memcpy_s(enc_model->model_file_hash, HASH_SIZE, prev_file->model_file_hash, HASH_SIZE);
+    enc_model->model_file_length = prev_file->model_file_length;
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_compute_model_file_content_hash(int keyslot,
+                                                          const ovsa_encrypt_file_t* file,
+                                                          char* content_hash) {
+    ovsa_status_t ret = OVSA_OK;
+    void* file_map    = NULL;
+
+    /* Hashed straight from the page cache, like the segments the plain text is not copied */
+    file_map = mmap(NULL, file->file_length, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (file_map == MAP_FAILED) {
+        OVSA_DBG(DBG_E, "OVSA: Error mapping model file %s failed\n", file->name);
+        return OVSA_FILEIO_FAIL;
+    }
+    (void)madvise(file_map, file->file_length, MADV_SEQUENTIAL);
+    ret = ovsa_crypto_compute_content_hash(keyslot, (const char*)file_map, file->file_length,
+                                           (unsigned char*)content_hash);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error content HASH generation of %s failed with code %d\n",
+                 file->name, ret);
+    }
+    munmap(file_map, file->file_length);
+    return ret;
+}
+
+static ovsa_status_t ovsa_read_model_file_range(const ovsa_encrypt_file_t* file, char* buff,
+                                                size_t offset, size_t length) {
+    ssize_t read_len = 0;
+    size_t done      = 0;
+
+    while (done < length) {
+        read_len = pread(file->fd, buff + done, length - done, (off_t)(offset + done));
+        if (read_len <= 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error reading model file %s\n", file->name);
+            return OVSA_FILEIO_FAIL;
+        }
+        done += (size_t)read_len;
+    }
+    return OVSA_OK;
+}
+
+static void* ovsa_encrypt_model_file_worker(void* arg) {
+    ovsa_encrypt_pool_t* pool = (ovsa_encrypt_pool_t*)arg;
+    ovsa_encrypt_file_t* file = NULL;
+    ovsa_status_t ret         = OVSA_OK;
+    char* plain_buff          = NULL;
+    size_t segment_size       = ENCRYPT_SEGMENT_SIZE;
+    size_t offset             = 0;
+    size_t length             = 0;
+
+    if (pool->gcm_format) {
+        /* The segments are the ones the tags are computed over */
+        segment_size = ENCRYPT_GCM_SEGMENT_SIZE;
+    }
+    ret = ovsa_safe_malloc(segment_size, &plain_buff);
+    if (ret < OVSA_OK || plain_buff == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error encryption buffer allocation failed with code %d\n", ret);
+        goto out;
+    }
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        while ((pool->next_file < pool->file_count) &&
+               (pool->next_offset >= pool->files[pool->next_file].file_length)) {
+            pool->next_file++;
+            pool->next_offset = 0;
+        }
+        if ((pool->ret < OVSA_OK) || (pool->next_file >= pool->file_count)) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        file   = &pool->files[pool->next_file];
+        offset = pool->next_offset;
+        /* The first CTR segment of a file also carries the magic and salt */
+        length = segment_size - ((offset == 0 && !pool->gcm_format) ? ENCRYPT_HEADER_LEN : 0);
+        if (length > file->file_length - offset) {
+            length = file->file_length - offset;
+        }
+        pool->next_offset += length;
+        pthread_mutex_unlock(&pool->lock);
+
+        /* Only the segment is read, the plain text of the file is never held in memory */
+        ret = ovsa_read_model_file_range(file, plain_buff, offset, length);
+        if ((ret == OVSA_OK) && pool->gcm_format) {
+            ret = ovsa_crypto_encrypt_gcm_range(
+                file->keyiv_hmac_slot, file->magic_salt, file->file_length, plain_buff, offset,
+                length, file->enc_buff + ovsa_crypto_get_gcm_encrypt_pos(offset));
+        } else if (ret == OVSA_OK) {
+            ret = ovsa_crypto_encrypt_mem_range(
+                file->keyiv_hmac_slot, file->magic_salt, plain_buff, offset, length,
+                pool->b64_format,
+                file->enc_buff + ovsa_crypto_get_encrypt_mem_pos(offset, pool->b64_format));
+        }
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error encryption of %s segment failed with code %d\n",
+                     file->name, ret);
+            break;
+        }
+    }
+
+out:
+    if (ret < OVSA_OK) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->ret == OVSA_OK) {
+            pool->ret = ret;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (plain_buff != NULL) {
+        memset_s(plain_buff, segment_size, 0);
+    }
+    ovsa_safe_free(&plain_buff);
+    return NULL;
 }
 
 static ovsa_status_t ovsa_encrypt_model_files(int keyslot, const ovsa_input_files_t* input_list,
+                                              bool binary_format, bool gcm_format,
+                                              int encrypt_threads,
+                                              const ovsa_controlled_access_model_t* prev_model,
                                               ovsa_model_files_t** enc_model_list, size_t* filelen,
                                               int* file_count) {
-    ovsa_status_t ret                  = OVSA_OK;
-    size_t size                        = 0;
-    size_t outlen                      = 0;
-    char* model_buf                    = NULL;
-    ovsa_model_files_t* enc_model_cur  = NULL;
-    ovsa_model_files_t* enc_model_tail = NULL;
-    ovsa_model_files_t* enc_model_head = NULL;
-    const ovsa_input_files_t* cur_file = NULL;
-    int keyiv_hmac_slot                = -1;
-    int len                            = 0;
-    int count                          = 0;
-
-    if ((keyslot < MIN_KEY_SLOT) || (keyslot >= MAX_KEY_SLOT) || input_list == NULL) {
+    ovsa_status_t ret                   = OVSA_OK;
+    size_t size                         = 0;
+    ovsa_model_files_t* enc_model_cur   = NULL;
+    ovsa_model_files_t* enc_model_tail  = NULL;
+    ovsa_model_files_t* enc_model_head  = NULL;
+    const ovsa_input_files_t* cur_file  = NULL;
+    const ovsa_model_files_t* prev_file = NULL;
+    ovsa_encrypt_file_t* file           = NULL;
+    FILE* fcur_file                     = NULL;
+    struct stat file_stat;
+    int thread_count                    = 0;
+    int i                               = 0;
+    int len                             = 0;
+    int count                           = 0;
+    pthread_t threads[MAX_ENCRYPT_THREADS];
+    ovsa_encrypt_pool_t pool;
+
+    memset_s(&pool, sizeof(ovsa_encrypt_pool_t), 0);
+    if ((keyslot < MIN_KEY_SLOT) || input_list == NULL) {
         ret = OVSA_INVALID_PARAMETER;
         OVSA_DBG(DBG_E, "OVSA: Error invalid input parameters\n");
         goto out;
     }
 
-    cur_file = input_list;
-    while (cur_file != NULL) {
-        FILE* fcur_file = fopen(cur_file->name, "r");
+    for (cur_file = input_list; cur_file != NULL; cur_file = cur_file->next) {
+        pool.file_count++;
+    }
+    ret = ovsa_safe_malloc(pool.file_count * sizeof(ovsa_encrypt_file_t), (char**)&pool.files);
+    if (ret < OVSA_OK || pool.files == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error encryption list allocation failed with code %d\n", ret);
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+    for (i = 0; i < pool.file_count; i++) {
+        pool.files[i].fd              = -1;
+        pool.files[i].keyiv_hmac_slot = -1;
+    }
+    pool.b64_format = !binary_format;
+    pool.gcm_format = gcm_format;
+
+    /* Derive the key/IV of each file and allocate its output, before any thread is started */
+    for (i = 0, cur_file = input_list; cur_file != NULL; i++, cur_file = cur_file->next) {
+        file       = &pool.files[i];
+        file->name = cur_file->name;
+        fcur_file  = fopen(cur_file->name, "r");
         if (fcur_file == NULL) {
             OVSA_DBG(DBG_E, "OVSA: Error opening model file %s\n", cur_file->name);
             ret = OVSA_FILEOPEN_FAIL;
             goto out;
         }
 
+        /* Empty model files are refused, as ovsa_crypto_get_file_size() always did, a segment
+         * holds at least one byte of cipher text and the runtime refuses empty segments */
+        if ((fstat(fileno(fcur_file), &file_stat) == 0) && (file_stat.st_size == 0)) {
+            OVSA_DBG(DBG_E, "OVSA: Error model file %s is empty and cannot be protected\n",
+                     cur_file->name);
+            fclose(fcur_file);
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
         /* Get size of file data */
         ret = ovsa_crypto_get_file_size(fcur_file, &size);
         if (ret < OVSA_OK || size == 0) {
@@ -103,15 +583,15 @@ static ovsa_status_t ovsa_encrypt_model_files(int keyslot, const ovsa_input_file
         }
         size -= 1; /* Encryption to be calculated without null terminator */
 
-        /* Read the content of the file */
-        ret = ovsa_safe_malloc(size + NULL_TERMINATOR, &model_buf);
-        if (ret < OVSA_OK || model_buf == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error encryption buffer allocation failed with code %d\n", ret);
-            fclose(fcur_file);
+        /* The segments are read with pread(), on a descriptor of its own */
+        file->fd = dup(fileno(fcur_file));
+        fclose(fcur_file);
+        if (file->fd < 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error opening model file %s\n", cur_file->name);
+            ret = OVSA_FILEOPEN_FAIL;
             goto out;
         }
-        ret = fread(model_buf, 1, size, fcur_file);
-        fclose(fcur_file);
+        file->file_length = size;
 
         if (enc_model_head == NULL) {
             ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&enc_model_head);
@@ -137,39 +617,174 @@ static ovsa_status_t ovsa_encrypt_model_files(int keyslot, const ovsa_input_file
         }
         memcpy_s(enc_model_tail->model_file_name, MAX_FILE_NAME, cur_file->name,
                  strnlen_s(cur_file->name, MAX_FILE_NAME));
-        /* Encrypt model file */
-        ret = ovsa_crypto_encrypt_mem(keyslot, model_buf, size, NULL,
-                                      &enc_model_tail->model_file_data, &outlen, &keyiv_hmac_slot);
-        if (ret != OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error encryption of %s failed with code %d\n", cur_file->name,
-                     ret);
-            /* Clear key/IV/HMAC from the key slot */
-            ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
-            goto out;
+
+        prev_file = NULL;
+        if (binary_format) {
+            /* Addresses the file in the next version of the model */
+            ret = ovsa_compute_model_file_content_hash(keyslot, file,
+                                                       enc_model_tail->model_file_content_hash);
+            if (ret < OVSA_OK) {
+                goto out;
+            }
+            if (prev_model != NULL) {
+                prev_file = ovsa_find_previous_model_file(prev_model, cur_file->name,
+                                                          enc_model_tail->model_file_content_hash);
+            }
+        }
+        if (prev_file != NULL) {
+            ret = ovsa_reuse_previous_model_file(prev_model, prev_file, enc_model_tail);
+            if (ret < OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error reuse of the segment of %s failed with code %d\n",
+                         cur_file->name, ret);
+                goto out;
+            }
+            /* Nothing is left to encrypt, the threads skip the file */
+            file->reused      = true;
+            file->file_length = 0;
+            OVSA_DBG(DBG_I, "OVSA: Model file %s did not change, its segment is reused\n",
+                     cur_file->name);
+        } else {
+            ret = ovsa_crypto_init_encrypt_range(keyslot, file->magic_salt,
+                                                 &file->keyiv_hmac_slot);
+            if (ret != OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error encryption of %s failed with code %d\n",
+                         cur_file->name, ret);
+                goto out;
+            }
+            /* Same layout as ovsa_crypto_encrypt_mem() or ovsa_crypto_encrypt_raw_mem() output */
+            if (gcm_format) {
+                enc_model_tail->model_file_length = (int)ovsa_crypto_get_gcm_encrypt_pos(size);
+            } else {
+                enc_model_tail->model_file_length =
+                    (int)ovsa_crypto_get_encrypt_mem_pos(size, pool.b64_format);
+            }
+            ret = ovsa_safe_malloc(enc_model_tail->model_file_length + NULL_TERMINATOR,
+                                   &enc_model_tail->model_file_data);
+            if (ret < OVSA_OK || enc_model_tail->model_file_data == NULL) {
+                OVSA_DBG(DBG_E, "OVSA: Error encryption buffer allocation failed with code %d\n",
+                         ret);
+                goto out;
+            }
+            file->enc_buff = enc_model_tail->model_file_data;
+        }
+        if (binary_format) {
+            /* Segments are stored back to back, the signed header carries their hashes */
+            enc_model_tail->model_file_offset = len;
         }
-        enc_model_tail->model_file_length = outlen;
         count++;
-        len += outlen;
-        OVSA_DBG(DBG_D, "OVSA: Encryption of Model file %s successful\n", cur_file->name);
-        cur_file = cur_file->next;
+        len += enc_model_tail->model_file_length;
+    }
 
-        /* Clear key/IV/HMAC from the key slot */
-        ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    if (pthread_mutex_init(&pool.lock, NULL) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing the encryption mutex failed\n");
+        ret = OVSA_MUTEX_INIT_FAIL;
+        goto out;
+    }
+    thread_count = encrypt_threads;
+    if (thread_count > MAX_ENCRYPT_THREADS) {
+        thread_count = MAX_ENCRYPT_THREADS;
+    }
+    /* The calling thread is one of the workers, the output does not depend on their number */
+    for (i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&threads[i], NULL, ovsa_encrypt_model_file_worker, &pool) != 0) {
+            break;
+        }
+    }
+    thread_count = i;
+    OVSA_DBG(DBG_D, "OVSA: Encrypting model files on %d threads\n", thread_count + 1);
+    ovsa_encrypt_model_file_worker(&pool);
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+    ret = pool.ret;
+    if (ret < OVSA_OK) {
+        goto out;
+    }
 
-        ovsa_safe_free(&model_buf);
+    for (i = 0, enc_model_cur = enc_model_head; enc_model_cur != NULL;
+         i++, enc_model_cur = enc_model_cur->next) {
+        if (pool.files[i].reused) {
+            /* The hash comes with the segment */
+            continue;
+        }
+        if (gcm_format) {
+            /* The tags authenticate the segments, the signed hash only has to bind the tags */
+            ret = ovsa_crypto_compute_gcm_tags_hash(
+                enc_model_cur->model_file_data, enc_model_cur->model_file_length,
+                (unsigned char*)enc_model_cur->model_file_hash);
+            if (ret != OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error HASH generation of %s failed with code %d\n",
+                         enc_model_cur->model_file_name, ret);
+                goto out;
+            }
+        } else if (binary_format) {
+            ret = ovsa_crypto_compute_buff_hash(
+                enc_model_cur->model_file_data, enc_model_cur->model_file_length,
+                HASH_ALG_SHA512, (unsigned char*)enc_model_cur->model_file_hash,
+                true /*FORMAT_BASE64*/);
+            if (ret != OVSA_OK) {
+                OVSA_DBG(DBG_E, "OVSA: Error HASH generation of %s failed with code %d\n",
+                         enc_model_cur->model_file_name, ret);
+                goto out;
+            }
+        }
+        OVSA_DBG(DBG_D, "OVSA: Encryption of Model file %s successful\n",
+                 enc_model_cur->model_file_name);
     }
 
     *filelen        = len;
     *file_count     = count;
     *enc_model_list = enc_model_head;
+    enc_model_head  = NULL;
 out:
-    ovsa_safe_free(&model_buf);
+    for (i = 0; i < pool.file_count && pool.files != NULL; i++) {
+        if (pool.files[i].fd >= 0) {
+            close(pool.files[i].fd);
+        }
+        /* Clear key/IV/HMAC from the key slot */
+        ovsa_crypto_clear_symmetric_key_slot(pool.files[i].keyiv_hmac_slot);
+    }
+    ovsa_safe_free((char**)&pool.files);
+    ovsa_safe_free_model_file_list(&enc_model_head);
     return ret;
 }
 
+static ovsa_status_t ovsa_write_controlled_access_model_bin(FILE* fptr, const char* header,
+                                                            size_t header_len,
+                                                            const ovsa_model_files_t* enc_model) {
+    unsigned char prefix[CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN];
+    int i = 0;
+
+    /* Magic followed by the length of the signed header in big endian */
+    memcpy_s(prefix, sizeof(prefix), CONTROLLED_ACCESS_MODEL_BIN_MAGIC,
+             CONTROLLED_ACCESS_MODEL_BIN_MAGIC_LEN);
+    for (i = 0; i < CONTROLLED_ACCESS_MODEL_BIN_LEN_SIZE; i++) {
+        prefix[CONTROLLED_ACCESS_MODEL_BIN_PREFIX_LEN - 1 - i] =
+            (unsigned char)(((uint64_t)header_len >> (i * 8)) & 0xff);
+    }
+    if ((fwrite(prefix, sizeof(prefix), 1, fptr) != 1) ||
+        (fwrite(header, header_len, 1, fptr) != 1)) {
+        OVSA_DBG(DBG_E, "OVSA: Error writing the binary controlled access model header\n");
+        return OVSA_FILEIO_FAIL;
+    }
+
+    /* Raw cipher text segments in the order of their offsets */
+    while (enc_model != NULL) {
+        if (fwrite(enc_model->model_file_data, enc_model->model_file_length, 1, fptr) != 1) {
+            OVSA_DBG(DBG_E, "OVSA: Error writing the segment of %s\n",
+                     enc_model->model_file_name);
+            return OVSA_FILEIO_FAIL;
+        }
+        enc_model = enc_model->next;
+    }
+    return OVSA_OK;
+}
+
 static ovsa_status_t ovsa_do_create_controlled_access_model_file(
     int asymm_keyslot, int sym_keyslot, const ovsa_input_files_t* input_list,
-    const char* controlled_access_file) {
+    const char* controlled_access_file, bool binary_format, bool gcm_format, int encrypt_threads,
+    const ovsa_controlled_access_model_t* prev_model) {
     ovsa_status_t ret                  = OVSA_OK;
     int file_count                     = 0;
     size_t size                        = 0;
@@ -180,8 +795,7 @@ static ovsa_status_t ovsa_do_create_controlled_access_model_file(
     FILE* fptr                         = NULL;
     ovsa_controlled_access_model_sig_t controlled_access_sig_model;
 
-    if ((asymm_keyslot < MIN_KEY_SLOT) || (asymm_keyslot >= MAX_KEY_SLOT) ||
-        (sym_keyslot < MIN_KEY_SLOT) || (sym_keyslot >= MAX_KEY_SLOT) || input_list == NULL ||
+    if ((asymm_keyslot < MIN_KEY_SLOT) || (sym_keyslot < MIN_KEY_SLOT) || input_list == NULL ||
         controlled_access_file == NULL) {
         ret = OVSA_INVALID_PARAMETER;
         OVSA_DBG(DBG_E,
@@ -243,7 +857,8 @@ static ovsa_status_t ovsa_do_create_controlled_access_model_file(
 
     /* Read and encrypt input model files */
     OVSA_DBG(DBG_I, "OVSA: Encrypt Model Files\n");
-    ret = ovsa_encrypt_model_files(sym_keyslot, input_list,
+    ret = ovsa_encrypt_model_files(sym_keyslot, input_list, binary_format, gcm_format,
+                                   encrypt_threads, prev_model,
                                    &controlled_access_sig_model.controlled_access_model.enc_model,
                                    &model_file_len, &file_count);
     if (ret != OVSA_OK) {
@@ -263,6 +878,12 @@ static ovsa_status_t ovsa_do_create_controlled_access_model_file(
 
     /* Create controlled access model JSON blob */
     OVSA_DBG(DBG_I, "OVSA: Create Controlled Access Model JSON Blob\n");
+    controlled_access_sig_model.controlled_access_model.binary_format = binary_format;
+    controlled_access_sig_model.controlled_access_model.gcm_format    = gcm_format;
+    if (binary_format) {
+        /* The cipher text is stored after the JSON header, not inside it */
+        model_file_len = 0;
+    }
     controlaccess_buf_len = model_file_len + sizeof(ovsa_controlled_access_model_t) +
                             CONTROLLED_ACCESS_MODEL_BLOB_TEXT_SIZE + g_isvcert_len +
                             (file_count * sizeof(ovsa_model_files_t) * MODEL_FILE_BLOB_TEXT_SIZE);
@@ -319,7 +940,17 @@ static ovsa_status_t ovsa_do_create_controlled_access_model_file(
                 fclose(fptr);
                 goto out;
             }
-            fwrite(controlaccess_buf_sig_string, size, 1, fptr);
+            if (binary_format) {
+                ret = ovsa_write_controlled_access_model_bin(
+                    fptr, controlaccess_buf_sig_string, size,
+                    controlled_access_sig_model.controlled_access_model.enc_model);
+                if (ret < OVSA_OK) {
+                    fclose(fptr);
+                    goto out;
+                }
+            } else {
+                fwrite(controlaccess_buf_sig_string, size, 1, fptr);
+            }
             fclose(fptr);
         } else {
             ret = OVSA_FILEOPEN_FAIL;
@@ -353,8 +984,7 @@ ovsa_status_t ovsa_do_create_master_license_file(int asymm_keyslot, int sym_keys
     size_t outlen               = 0;
     ovsa_master_license_sig_t master_sig_license;
 
-    if ((asymm_keyslot < MIN_KEY_SLOT) || (asymm_keyslot >= MAX_KEY_SLOT) ||
-        (sym_keyslot < MIN_KEY_SLOT) || (sym_keyslot >= MAX_KEY_SLOT) || license_guid == NULL ||
+    if ((asymm_keyslot < MIN_KEY_SLOT) || (sym_keyslot < MIN_KEY_SLOT) || license_guid == NULL ||
         masterlic_file == NULL) {
         ret = OVSA_INVALID_PARAMETER;
         OVSA_DBG(DBG_E, "OVSA: Error wrong input parameters to create master license\n");
@@ -487,8 +1117,17 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
     char* keystore                 = NULL;
     char* masterlic_file           = NULL;
     char* controlled_access_file   = NULL;
+    char* prev_model_file          = NULL;
+    char* prev_masterlic_file      = NULL;
+    bool binary_format             = false;
+    bool gcm_format                = false;
+    int encrypt_threads            = 1;
+    char prev_model_hash[HASH_SIZE];
+    ovsa_controlled_access_model_sig_t prev_model_sig;
 
     OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    memset_s(prev_model_hash, sizeof(prev_model_hash), 0);
+    memset_s(&prev_model_sig, sizeof(ovsa_controlled_access_model_sig_t), 0);
 
     if (argc > MAX_SAFE_ARGC) {
         ret = OVSA_INVALID_PARAMETER;
@@ -511,7 +1150,7 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
         }
     }
 
-    while ((c = getopt(argc, argv, "i:n:d:v:p:m:k:g:h")) != -1) {
+    while ((c = getopt(argc, argv, "i:n:d:v:p:m:k:g:bj:au:l:h")) != -1) {
         switch (c) {
             case 'i': {
                 int index = 0;
@@ -608,6 +1247,30 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
                 masterlic_file = optarg;
                 OVSA_DBG(DBG_D, "OVSA: masterlic_file = %s\n", masterlic_file);
             } break;
+            case 'u': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Previous controlled access model file path greater than %d "
+                             "characters not allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_FILE_PATH;
+                    goto out;
+                }
+                prev_model_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: prev_model_file = %s\n", prev_model_file);
+            } break;
+            case 'l': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Previous master license file path greater than %d characters "
+                             "not allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_FILE_PATH;
+                    goto out;
+                }
+                prev_masterlic_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: prev_masterlic_file = %s\n", prev_masterlic_file);
+            } break;
             case 'g': {
                 if (strnlen_s(optarg, RSIZE_MAX_STR) > GUID_SIZE) {
                     OVSA_DBG(DBG_E,
@@ -625,6 +1288,33 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
 
                 OVSA_DBG(DBG_D, "OVSA: license_guid = %s\n", license_guid);
             } break;
+            case 'b': {
+                binary_format = true;
+                OVSA_DBG(DBG_D, "OVSA: binary controlled access model\n");
+            } break;
+            case 'a': {
+                gcm_format = true;
+                OVSA_DBG(DBG_D, "OVSA: AES-256-GCM encryption of the model files\n");
+            } break;
+            case 'j': {
+                if (isdigit((int)(unsigned char)*optarg)) {
+                    encrypt_threads = atoi(optarg);
+                    OVSA_DBG(DBG_D, "OVSA: encrypt_threads = %d\n", encrypt_threads);
+                    if (encrypt_threads <= 0) {
+                        OVSA_DBG(DBG_E,
+                                 "OVSA: Number of encryption threads should be greater than zero."
+                                 " Please follow -help for help option\n");
+                        ret = OVSA_INVALID_PARAMETER;
+                        goto out;
+                    }
+                } else {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Number of encryption threads should be a positive integer."
+                             " Please follow -help for help option\n");
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+            } break;
             case 'h': {
                 ovsa_controlaccess_help(argv[0]);
                 goto out;
@@ -643,6 +1333,22 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
         OVSA_DBG(DBG_I, "extra arguments: %s\n", argv[optind]);
     }
 
+    if (gcm_format && !binary_format) {
+        OVSA_DBG(DBG_E,
+                 "OVSA: Error GCM encryption needs the binary controlled access model. Please "
+                 "follow -help for help option\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    if (((prev_model_file != NULL) != (prev_masterlic_file != NULL)) ||
+        ((prev_model_file != NULL) && !binary_format)) {
+        OVSA_DBG(DBG_E,
+                 "OVSA: Error update of a model needs the previous binary controlled access model "
+                 "and its master license. Please follow -help for help option\n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+
     /* Validate Input parameters */
     if ((input_list != NULL) && (g_model_name != NULL) && (g_model_description != NULL) &&
         (g_model_version != NULL) && (keystore != NULL) && (controlled_access_file != NULL) &&
@@ -668,15 +1374,45 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
         goto out;
     }
 
-    /* Get Sym Key Slot from Key store */
-    OVSA_DBG(DBG_I, "OVSA: Generate Symmetric Key\n");
-    ret = ovsa_crypto_generate_symmetric_key(SYMMETRIC_KEY_SIZE, &sym_keyslot);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error generation of Encryption key failed with code %d\n", ret);
-        goto out;
+    if (prev_model_file != NULL) {
+        /*
+         * The new version keeps the key of the previous one, so that the segments of the files
+         * that did not change are reused as they are, and a runtime that holds them decrypted
+         * finds them by their segment hash. Files that changed are encrypted under a salt of
+         * their own, segments are never encrypted twice under the same key/IV.
+         */
+        ret = ovsa_read_previous_master_license(asymm_keyslot, prev_masterlic_file, &sym_keyslot,
+                                                prev_model_hash);
+        if (ret < OVSA_OK) {
+            goto out;
+        }
+        ret = ovsa_read_previous_model(asymm_keyslot, prev_model_file, prev_model_hash,
+                                       &prev_model_sig);
+        if (ret < OVSA_OK) {
+            goto out;
+        }
+        if (prev_model_sig.controlled_access_model.gcm_format != gcm_format) {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error previous controlled access model is encrypted in another mode, "
+                     "%s -a\n",
+                     gcm_format ? "drop" : "add");
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
+    } else {
+        /* Get Sym Key Slot from Key store */
+        OVSA_DBG(DBG_I, "OVSA: Generate Symmetric Key\n");
+        ret = ovsa_crypto_generate_symmetric_key(SYMMETRIC_KEY_SIZE, &sym_keyslot);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error generation of Encryption key failed with code %d\n",
+                     ret);
+            goto out;
+        }
     }
-    ret = ovsa_do_create_controlled_access_model_file(asymm_keyslot, sym_keyslot, input_list,
-                                                      controlled_access_file);
+    ret = ovsa_do_create_controlled_access_model_file(
+        asymm_keyslot, sym_keyslot, input_list, controlled_access_file, binary_format, gcm_format,
+        encrypt_threads,
+        (prev_model_file != NULL) ? &prev_model_sig.controlled_access_model : NULL);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error generation of controlled access model failed with code %d\n",
                  ret);
@@ -693,6 +1429,7 @@ ovsa_status_t ovsa_controlaccess_main(int argc, char* argv[]) {
     OVSA_DBG(DBG_I, "OVSA: Generation of %s file successful.\n", masterlic_file);
 
 out:
+    ovsa_free_previous_model(&prev_model_sig);
     /* De-initialize crypto */
     ovsa_crypto_deinit();
     ovsa_safe_free_input_list(&input_list);
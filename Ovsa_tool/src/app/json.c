@@ -264,6 +264,14 @@ ovsa_status_t ovsa_json_create_controlled_access_model(
                  ret);
         goto end;
     }
+    if (control_access_model_sig->controlled_access_model.gcm_format &&
+        (cJSON_AddStringToObject(controlled_access_model, "file_encryption",
+                                 CONTROLLED_ACCESS_MODEL_GCM_ENCRYPTION) == NULL)) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add file_encryption to controlled access model failed %d\n",
+                 ret);
+        goto end;
+    }
     cJSON* model_files = cJSON_CreateArray();
     if (model_files == NULL) {
         OVSA_DBG(DBG_E, "OVSA: Error could not create object model_files\n");
@@ -314,14 +322,47 @@ ovsa_status_t ovsa_json_create_controlled_access_model(
             }
             cJSON_AddItemToObject(enc_file, name, file_name);
 
-            snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_body_%d", (i++) % 100u);
-            cJSON* file = cJSON_CreateString(list->model_file_data);
-            if (file == NULL) {
-                ret = OVSA_JSON_ERROR_CREATE_OBJECT;
-                OVSA_DBG(DBG_E, "OVSA: Error could not create string file\n");
-                goto end;
+            if (control_access_model_sig->controlled_access_model.binary_format) {
+                /* The segment follows the header, only its position and hash are stored */
+                snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_offset_%d", (i) % 100u);
+                if (cJSON_AddNumberToObject(enc_file, name, (double)list->model_file_offset) ==
+                    NULL) {
+                    ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+                    OVSA_DBG(DBG_E, "OVSA: Error add file offset to controlled access model\n");
+                    goto end;
+                }
+                snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_length_%d", (i) % 100u);
+                if (cJSON_AddNumberToObject(enc_file, name, list->model_file_length) == NULL) {
+                    ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+                    OVSA_DBG(DBG_E, "OVSA: Error add file length to controlled access model\n");
+                    goto end;
+                }
+                if (list->model_file_content_hash[0] != '\0') {
+                    snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_content_hash_%d", (i) % 100u);
+                    if (cJSON_AddStringToObject(enc_file, name, list->model_file_content_hash) ==
+                        NULL) {
+                        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+                        OVSA_DBG(DBG_E,
+                                 "OVSA: Error add file content hash to controlled access model\n");
+                        goto end;
+                    }
+                }
+                snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_hash_%d", (i++) % 100u);
+                if (cJSON_AddStringToObject(enc_file, name, list->model_file_hash) == NULL) {
+                    ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+                    OVSA_DBG(DBG_E, "OVSA: Error add file hash to controlled access model\n");
+                    goto end;
+                }
+            } else {
+                snprintf_s_i(name, MAX_FILE_NAME_LEN, "file_body_%d", (i++) % 100u);
+                cJSON* file = cJSON_CreateString(list->model_file_data);
+                if (file == NULL) {
+                    ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+                    OVSA_DBG(DBG_E, "OVSA: Error could not create string file\n");
+                    goto end;
+                }
+                cJSON_AddItemToObject(enc_file, name, file);
             }
-            cJSON_AddItemToObject(enc_file, name, file);
 
             OVSA_DBG(DBG_D, "%s\n", name);
             if (list->next != NULL) {
@@ -803,6 +844,346 @@ end:
     return ret;
 }
 
+/*
+ * In-situ JSON reader. The members of an object and the elements of an array are read in one
+ * pass over the buffer and handed to a callback as views into the buffer, nothing is copied or
+ * allocated. Nested objects and arrays are handed over as a whole and read again by the callback
+ * if needed. Strings are handed over as they are in the buffer, without the quotes and with the
+ * escapes left in place, and are unescaped only when copied out.
+ */
+static const char* ovsa_json_reader_skip_space(const char* pos, const char* end) {
+    while ((pos < end) && ((*pos == ' ') || (*pos == '\t') || (*pos == '\n') || (*pos == '\r')))
+        pos++;
+    return pos;
+}
+
+static ovsa_status_t ovsa_json_reader_read_value(const char** cursor, const char* end, int depth,
+                                                 ovsa_json_view_t* value);
+
+static ovsa_status_t ovsa_json_reader_read_string(const char** cursor, const char* end,
+                                                  ovsa_json_view_t* value) {
+    const char* pos = *cursor + 1;
+
+    value->type = OVSA_JSON_TYPE_STRING;
+    value->data = pos;
+    while (pos < end) {
+        if (*pos == '"') {
+            value->len = pos - value->data;
+            *cursor    = pos + 1;
+            return OVSA_OK;
+        }
+        if ((unsigned char)*pos < 0x20)
+            break;
+        pos += (*pos == '\\') ? 2 : 1;
+    }
+    OVSA_DBG(DBG_E, "OVSA: Error unterminated json string\n");
+    return OVSA_JSON_PARSE_FAIL;
+}
+
+/* Reads the members or elements of an object or array, cursor is at its opening bracket */
+static ovsa_status_t ovsa_json_reader_read_container(const char** cursor, const char* end,
+                                                     int depth, ovsa_json_member_cb_t member_cb,
+                                                     ovsa_json_element_cb_t element_cb,
+                                                     void* ctx) {
+    ovsa_status_t ret    = OVSA_OK;
+    bool is_object       = (**cursor == '{');
+    char close           = is_object ? '}' : ']';
+    const char* pos      = *cursor + 1;
+    size_t index         = 0;
+    ovsa_json_view_t key = {OVSA_JSON_TYPE_STRING, NULL, 0};
+    ovsa_json_view_t value;
+
+    if (depth > OVSA_JSON_MAX_DEPTH) {
+        OVSA_DBG(DBG_E, "OVSA: Error json nesting exceeds %d levels\n", OVSA_JSON_MAX_DEPTH);
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    pos = ovsa_json_reader_skip_space(pos, end);
+    if ((pos < end) && (*pos == close)) {
+        *cursor = pos + 1;
+        return OVSA_OK;
+    }
+    while (pos < end) {
+        if (is_object) {
+            if (*pos != '"')
+                break;
+            ret = ovsa_json_reader_read_string(&pos, end, &key);
+            if (ret < OVSA_OK)
+                return ret;
+            pos = ovsa_json_reader_skip_space(pos, end);
+            if ((pos >= end) || (*pos != ':'))
+                break;
+            pos = ovsa_json_reader_skip_space(pos + 1, end);
+        }
+        ret = ovsa_json_reader_read_value(&pos, end, depth + 1, &value);
+        if (ret < OVSA_OK)
+            return ret;
+        if (is_object && (member_cb != NULL))
+            ret = member_cb(ctx, &key, &value);
+        else if (!is_object && (element_cb != NULL))
+            ret = element_cb(ctx, index, &value);
+        if (ret != OVSA_OK)
+            return ret;
+        index++;
+
+        pos = ovsa_json_reader_skip_space(pos, end);
+        if ((pos < end) && (*pos == close)) {
+            *cursor = pos + 1;
+            return OVSA_OK;
+        }
+        if ((pos >= end) || (*pos != ','))
+            break;
+        pos = ovsa_json_reader_skip_space(pos + 1, end);
+    }
+    OVSA_DBG(DBG_E, "OVSA: Error malformed json %s\n", is_object ? "object" : "array");
+    return OVSA_JSON_PARSE_FAIL;
+}
+
+static ovsa_status_t ovsa_json_reader_read_value(const char** cursor, const char* end, int depth,
+                                                 ovsa_json_view_t* value) {
+    ovsa_status_t ret = OVSA_OK;
+    const char* pos   = *cursor;
+
+    if (pos >= end)
+        return OVSA_JSON_PARSE_FAIL;
+    value->data = pos;
+    switch (*pos) {
+        case '"':
+            return ovsa_json_reader_read_string(cursor, end, value);
+        case '{':
+        case '[':
+            value->type = (*pos == '{') ? OVSA_JSON_TYPE_OBJECT : OVSA_JSON_TYPE_ARRAY;
+            ret         = ovsa_json_reader_read_container(&pos, end, depth, NULL, NULL, NULL);
+            if (ret < OVSA_OK)
+                return ret;
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+            value->type = (*pos == 'n') ? OVSA_JSON_TYPE_NULL : OVSA_JSON_TYPE_BOOL;
+            while ((pos < end) && (*pos >= 'a') && (*pos <= 'z'))
+                pos++;
+            if (((pos - value->data) != 4 || (memcmp(value->data, "true", 4) != 0 &&
+                                               memcmp(value->data, "null", 4) != 0)) &&
+                ((pos - value->data) != 5 || memcmp(value->data, "false", 5) != 0))
+                return OVSA_JSON_PARSE_FAIL;
+            break;
+        default:
+            value->type = OVSA_JSON_TYPE_NUMBER;
+            while ((pos < end) && (((*pos >= '0') && (*pos <= '9')) || (*pos == '-') ||
+                                   (*pos == '+') || (*pos == '.') || (*pos == 'e') ||
+                                   (*pos == 'E')))
+                pos++;
+            if (pos == value->data)
+                return OVSA_JSON_PARSE_FAIL;
+            break;
+    }
+    value->len = pos - value->data;
+    *cursor    = pos;
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_json_reader_foreach(const char* buf, size_t len, char open,
+                                              ovsa_json_member_cb_t member_cb,
+                                              ovsa_json_element_cb_t element_cb, void* ctx) {
+    ovsa_status_t ret = OVSA_OK;
+    const char* end   = NULL;
+    const char* pos   = NULL;
+
+    if (buf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error json reader input is null\n");
+        return OVSA_JSON_INVALID_INPUT;
+    }
+    /* A NUL ends the buffer as well, it is refused within a value */
+    end = buf + len;
+    pos = ovsa_json_reader_skip_space(buf, end);
+    if ((pos >= end) || (*pos != open)) {
+        OVSA_DBG(DBG_E, "OVSA: Error json %s expected\n", (open == '{') ? "object" : "array");
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    ret = ovsa_json_reader_read_container(&pos, end, 0, member_cb, element_cb, ctx);
+    if (ret == OVSA_JSON_READ_STOP)
+        return OVSA_OK;
+    if (ret < OVSA_OK)
+        return ret;
+    pos = ovsa_json_reader_skip_space(pos, end);
+    if ((pos < end) && (*pos != '\0')) {
+        OVSA_DBG(DBG_E, "OVSA: Error trailing characters after json %s\n",
+                 (open == '{') ? "object" : "array");
+        return OVSA_JSON_PARSE_FAIL;
+    }
+    return OVSA_OK;
+}
+
+ovsa_status_t ovsa_json_foreach_member(const char* buf, size_t len, ovsa_json_member_cb_t cb,
+                                       void* ctx) {
+    return ovsa_json_reader_foreach(buf, len, '{', cb, NULL, ctx);
+}
+
+ovsa_status_t ovsa_json_foreach_element(const char* buf, size_t len, ovsa_json_element_cb_t cb,
+                                        void* ctx) {
+    return ovsa_json_reader_foreach(buf, len, '[', NULL, cb, ctx);
+}
+
+bool ovsa_json_view_equals(const ovsa_json_view_t* view, const char* str) {
+    size_t len = strnlen_s(str, RSIZE_MAX_STR);
+
+    return (view->len == len) && (memcmp(view->data, str, len) == 0);
+}
+
+ovsa_status_t ovsa_json_view_get_number(const ovsa_json_view_t* view, double* number) {
+    char digits[OVSA_JSON_MAX_NUMBER_LEN + 1];
+    char* end = NULL;
+
+    if ((view->type != OVSA_JSON_TYPE_NUMBER) || (view->len > OVSA_JSON_MAX_NUMBER_LEN))
+        return OVSA_JSON_UNSUPPORTED_DATA;
+    memcpy_s(digits, sizeof(digits), view->data, view->len);
+    digits[view->len] = '\0';
+    *number           = strtod(digits, &end);
+    return (*end == '\0') ? OVSA_OK : OVSA_JSON_PARSE_FAIL;
+}
+
+static int ovsa_json_view_hex_digit(char c) {
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    return -1;
+}
+
+static ovsa_status_t ovsa_json_view_read_unicode(const char* pos, const char* end,
+                                                 unsigned int* code_point) {
+    int digit = 0;
+    int i     = 0;
+
+    if ((end - pos) < 4)
+        return OVSA_JSON_PARSE_FAIL;
+    *code_point = 0;
+    for (i = 0; i < 4; i++) {
+        digit = ovsa_json_view_hex_digit(pos[i]);
+        if (digit < 0)
+            return OVSA_JSON_PARSE_FAIL;
+        *code_point = (*code_point << 4) | digit;
+    }
+    return OVSA_OK;
+}
+
+ovsa_status_t ovsa_json_view_copy(const ovsa_json_view_t* view, char* dest, size_t dest_size,
+                                  size_t* copied) {
+    const char* pos   = view->data;
+    const char* end   = view->data + view->len;
+    unsigned int low  = 0;
+    unsigned int code = 0;
+    size_t len        = 0;
+    size_t utf8_len   = 0;
+    size_t i          = 0;
+    char utf8[4];
+
+    if ((view->type != OVSA_JSON_TYPE_STRING) || (dest == NULL))
+        return OVSA_JSON_INVALID_INPUT;
+    while ((pos < end) && (len < dest_size)) {
+        if (*pos != '\\') {
+            /* Runs without escapes, e.g. base64 values, are copied as a whole */
+            const char* run = memchr(pos, '\\', end - pos);
+            size_t run_len  = ((run != NULL) ? run : end) - pos;
+            if (run_len > dest_size - len)
+                run_len = dest_size - len;
+            memcpy_s(dest + len, dest_size - len, pos, run_len);
+            len += run_len;
+            pos += run_len;
+            continue;
+        }
+        if ((end - pos) < 2)
+            return OVSA_JSON_PARSE_FAIL;
+        utf8_len = 1;
+        switch (pos[1]) {
+            case '"':
+            case '\\':
+            case '/':
+                utf8[0] = pos[1];
+                break;
+            case 'b':
+                utf8[0] = '\b';
+                break;
+            case 'f':
+                utf8[0] = '\f';
+                break;
+            case 'n':
+                utf8[0] = '\n';
+                break;
+            case 'r':
+                utf8[0] = '\r';
+                break;
+            case 't':
+                utf8[0] = '\t';
+                break;
+            case 'u':
+                if (ovsa_json_view_read_unicode(pos + 2, end, &code) < OVSA_OK)
+                    return OVSA_JSON_PARSE_FAIL;
+                pos += 4;
+                if ((code >= 0xD800) && (code <= 0xDBFF)) {
+                    /* Surrogate pair */
+                    if (((end - pos) < 8) || (pos[2] != '\\') || (pos[3] != 'u') ||
+                        (ovsa_json_view_read_unicode(pos + 4, end, &low) < OVSA_OK) ||
+                        (low < 0xDC00) || (low > 0xDFFF))
+                        return OVSA_JSON_PARSE_FAIL;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                if (code < 0x80) {
+                    utf8[0] = (char)code;
+                } else if (code < 0x800) {
+                    utf8[0]  = (char)(0xC0 | (code >> 6));
+                    utf8[1]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 2;
+                } else if (code < 0x10000) {
+                    utf8[0]  = (char)(0xE0 | (code >> 12));
+                    utf8[1]  = (char)(0x80 | ((code >> 6) & 0x3F));
+                    utf8[2]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 3;
+                } else {
+                    utf8[0]  = (char)(0xF0 | (code >> 18));
+                    utf8[1]  = (char)(0x80 | ((code >> 12) & 0x3F));
+                    utf8[2]  = (char)(0x80 | ((code >> 6) & 0x3F));
+                    utf8[3]  = (char)(0x80 | (code & 0x3F));
+                    utf8_len = 4;
+                }
+                break;
+            default:
+                return OVSA_JSON_PARSE_FAIL;
+        }
+        pos += 2;
+        for (i = 0; (i < utf8_len) && (len < dest_size); i++)
+            dest[len++] = utf8[i];
+    }
+    if (copied != NULL)
+        *copied = len;
+    return OVSA_OK;
+}
+
+ovsa_status_t ovsa_json_view_dup(const ovsa_json_view_t* view, char** value, size_t* value_len) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t len        = 0;
+
+    /* The unescaped string is never longer than the escaped one */
+    ret = ovsa_safe_malloc(view->len + 1, value);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        return OVSA_JSON_MEMORY_ALLOC_FAIL;
+    }
+    ret = ovsa_json_view_copy(view, *value, view->len, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error invalid json string %d\n", ret);
+        ovsa_safe_free(value);
+        return ret;
+    }
+    (*value)[len] = '\0';
+    if (value_len != NULL)
+        *value_len = len;
+    return OVSA_OK;
+}
+
 /* Extract json blob */
 ovsa_status_t ovsa_json_extract_license_config(const char* inputBuf,
                                                ovsa_license_config_sig_t* lic_conf_sig) {
@@ -946,153 +1327,204 @@ end:
 }
 
 #ifdef OVSA_RUNTIME
-ovsa_status_t ovsa_json_extract_controlled_access_model(
-    const char* inputBuf, ovsa_controlled_access_model_sig_t* control_access_model_sig) {
-    ovsa_status_t ret        = OVSA_OK;
-    cJSON* name              = NULL;
-    cJSON* description       = NULL;
-    cJSON* version           = NULL;
-    cJSON* model_guid        = NULL;
-    cJSON* isv_certificate   = NULL;
-    cJSON* signature         = NULL;
-    cJSON* parse_json        = NULL;
-    cJSON* file              = NULL;
-    ovsa_model_files_t* head = NULL;
-    ovsa_model_files_t* cur  = NULL;
-    ovsa_model_files_t* tail = NULL;
-    char* tail_enc_model     = NULL;
-    int i                    = 0;
+/* Members of an entry of the files of a controlled access model, suffixed by the entry index */
+typedef struct ovsa_json_model_file {
+    int index;
+    ovsa_json_view_t name;
+    ovsa_json_view_t offset;
+    ovsa_json_view_t length;
+    ovsa_json_view_t hash;
+    ovsa_json_view_t content_hash;
+    ovsa_json_view_t body;
+} ovsa_json_model_file_t;
+
+typedef struct ovsa_json_model_ctx {
+    ovsa_controlled_access_model_sig_t* sig;
+    ovsa_model_files_t* tail;
+} ovsa_json_model_ctx_t;
+
+static bool ovsa_json_view_equals_indexed(const ovsa_json_view_t* key, const char* prefix,
+                                          int index) {
     char fname[MAX_FILE_NAME_LEN];
 
-    OVSA_DBG(DBG_D, "%s entry\n", __func__);
-
-    if (inputBuf == NULL || control_access_model_sig == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error input is null %d\n", ret);
-        ret = OVSA_JSON_INVALID_INPUT;
-        goto end;
-    }
-    memset_s(fname, sizeof(fname), 0);
-    parse_json = cJSON_Parse(inputBuf);
-    if (parse_json == NULL) {
-        ret = OVSA_JSON_PARSE_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error could not parse %d\n", ret);
-        goto end;
-    }
-
-    name = cJSON_GetObjectItemCaseSensitive(parse_json, "name");
-    if (cJSON_IsString(name) && (name->valuestring != NULL)) {
-        memcpy_s(control_access_model_sig->controlled_access_model.model_name, MAX_NAME_SIZE,
-                 name->valuestring, strnlen_s(name->valuestring, MAX_NAME_SIZE));
-        OVSA_DBG(DBG_D, "name %s\n", name->valuestring);
-    }
+    snprintf_s_si(fname, MAX_FILE_NAME_LEN, "%s%d", (char*)prefix, index % 100);
+    return ovsa_json_view_equals(key, fname);
+}
 
-    description = cJSON_GetObjectItemCaseSensitive(parse_json, "description");
-    if (cJSON_IsString(description) && (description->valuestring != NULL)) {
-        memcpy_s(control_access_model_sig->controlled_access_model.description, MAX_NAME_SIZE,
-                 description->valuestring, strnlen_s(description->valuestring, MAX_NAME_SIZE));
-        OVSA_DBG(DBG_D, "description %s\n", description->valuestring);
-    }
+static ovsa_status_t ovsa_json_read_model_file_member(void* ctx, const ovsa_json_view_t* key,
+                                                      const ovsa_json_view_t* value) {
+    ovsa_json_model_file_t* file = (ovsa_json_model_file_t*)ctx;
+
+    if (ovsa_json_view_equals_indexed(key, "file_name_", file->index))
+        file->name = *value;
+    else if (ovsa_json_view_equals_indexed(key, "file_offset_", file->index))
+        file->offset = *value;
+    else if (ovsa_json_view_equals_indexed(key, "file_length_", file->index))
+        file->length = *value;
+    else if (ovsa_json_view_equals_indexed(key, "file_hash_", file->index))
+        file->hash = *value;
+    else if (ovsa_json_view_equals_indexed(key, "file_content_hash_", file->index))
+        file->content_hash = *value;
+    else if (ovsa_json_view_equals_indexed(key, "file_body_", file->index))
+        file->body = *value;
+    return OVSA_OK;
+}
 
-    version = cJSON_GetObjectItemCaseSensitive(parse_json, "version");
-    if (cJSON_IsString(version) && (version->valuestring != NULL)) {
-        memcpy_s(control_access_model_sig->controlled_access_model.version, MAX_VERSION_SIZE,
-                 version->valuestring, strnlen_s(version->valuestring, MAX_VERSION_SIZE));
-        OVSA_DBG(DBG_D, "version %s\n", version->valuestring);
+static ovsa_status_t ovsa_json_read_model_file(void* ctx, size_t index,
+                                               const ovsa_json_view_t* value) {
+    ovsa_json_model_ctx_t* model = (ovsa_json_model_ctx_t*)ctx;
+    ovsa_model_files_t* cur      = NULL;
+    ovsa_status_t ret            = OVSA_OK;
+    double offset                = -1;
+    double length                = 0;
+    size_t body_len              = 0;
+    ovsa_json_model_file_t file;
+
+    if (value->type != OVSA_JSON_TYPE_OBJECT)
+        return OVSA_OK;
+    memset_s(&file, sizeof(file), 0);
+    file.index = (int)index;
+    ret = ovsa_json_foreach_member(value->data, value->len, ovsa_json_read_model_file_member,
+                                   &file);
+    if (ret < OVSA_OK)
+        return ret;
+    if (file.name.type != OVSA_JSON_TYPE_STRING)
+        return OVSA_OK;
+    if ((ovsa_json_view_get_number(&file.offset, &offset) < OVSA_OK) ||
+        (ovsa_json_view_get_number(&file.length, &length) < OVSA_OK))
+        offset = -1;
+    if (((offset < 0) || ((int)length <= 0) || (file.hash.type != OVSA_JSON_TYPE_STRING)) &&
+        (file.body.type != OVSA_JSON_TYPE_STRING))
+        return OVSA_OK;
+
+    /* Memory allocated and this needs to be freed by consumer */
+    ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&cur);
+    if (ret < OVSA_OK || cur == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        return OVSA_JSON_MEMORY_ALLOC_FAIL;
     }
-
-    model_guid = cJSON_GetObjectItemCaseSensitive(parse_json, "model_guid");
-    if (cJSON_IsString(model_guid) && (model_guid->valuestring != NULL)) {
-        memcpy_s(control_access_model_sig->controlled_access_model.model_guid, GUID_SIZE,
-                 model_guid->valuestring, strnlen_s(model_guid->valuestring, GUID_SIZE));
-        OVSA_DBG(DBG_D, "model_guid %s\n", model_guid->valuestring);
+    cur->model_file_data = NULL;
+    cur->next            = NULL;
+    if (model->tail == NULL) {
+        model->sig->controlled_access_model.enc_model = cur;
+    } else {
+        model->tail->next = cur;
     }
+    model->tail = cur;
+    ret         = ovsa_json_view_copy(&file.name, cur->model_file_name, MAX_NAME_SIZE, NULL);
+    if (ret < OVSA_OK)
+        return ret;
 
-    isv_certificate = cJSON_GetObjectItemCaseSensitive(parse_json, "isv_certificate");
-    if (cJSON_IsString(isv_certificate) && (isv_certificate->valuestring != NULL)) {
-        /* Memory allocated and this needs to be freed by consumer */
-        size_t str_len = 0;
-        ret            = ovsa_get_string_length(isv_certificate->valuestring, &str_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of isv_certificate string %d\n", ret);
-            goto end;
+    if ((offset >= 0) && ((int)length > 0) && (file.hash.type == OVSA_JSON_TYPE_STRING)) {
+        /* Segment of the binary controlled access model, the cipher text is not in the JSON */
+        ret = ovsa_json_view_copy(&file.hash, cur->model_file_hash, HASH_SIZE - 1, NULL);
+        if (ret < OVSA_OK)
+            return ret;
+        /* Missing in the models created before the incremental model update */
+        if (file.content_hash.type == OVSA_JSON_TYPE_STRING) {
+            ret = ovsa_json_view_copy(&file.content_hash, cur->model_file_content_hash,
+                                      HASH_SIZE - 1, NULL);
+            if (ret < OVSA_OK)
+                return ret;
         }
-        ret = ovsa_safe_malloc(str_len + 1,
-                               &control_access_model_sig->controlled_access_model.isv_certificate);
-        if (ret < OVSA_OK ||
-            control_access_model_sig->controlled_access_model.isv_certificate == NULL) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-            goto end;
-        }
-        memcpy_s(control_access_model_sig->controlled_access_model.isv_certificate, str_len,
-                 isv_certificate->valuestring, str_len);
-        control_access_model_sig->controlled_access_model.isv_certificate[str_len] = '\0';
-        OVSA_DBG(DBG_D, "isv_certificate %s\n", isv_certificate->valuestring);
-    }
+        cur->model_file_offset                            = (size_t)offset;
+        cur->model_file_length                            = (int)length;
+        model->sig->controlled_access_model.binary_format = true;
+    } else {
+        /* The encrypted file is copied once out of the JSON, it is not unescaped by a parser
+         * and copied again */
+        ret = ovsa_json_view_dup(&file.body, &cur->model_file_data, &body_len);
+        if (ret < OVSA_OK)
+            return ret;
+        cur->model_file_length = (int)body_len;
+    }
+    OVSA_DBG(DBG_D, "%s\n", cur->model_file_name);
+    return OVSA_OK;
+}
 
-    signature = cJSON_GetObjectItemCaseSensitive(parse_json, "signature");
-    if (cJSON_IsString(signature) && (signature->valuestring != NULL)) {
-        memcpy_s(control_access_model_sig->signature, MAX_SIGNATURE_SIZE, signature->valuestring,
-                 strnlen_s(signature->valuestring, MAX_SIGNATURE_SIZE));
-        OVSA_DBG(DBG_D, "signature %s\n", signature->valuestring);
-    }
+static ovsa_status_t ovsa_json_read_model_member(void* ctx, const ovsa_json_view_t* key,
+                                                 const ovsa_json_view_t* value) {
+    ovsa_json_model_ctx_t* model                 = (ovsa_json_model_ctx_t*)ctx;
+    ovsa_controlled_access_model_t* access_model = &model->sig->controlled_access_model;
+    ovsa_status_t ret                            = OVSA_OK;
+    int indicator                                = -1;
+    char file_encryption[MAX_NAME_SIZE];
+
+    if (ovsa_json_view_equals(key, "files")) {
+        if (value->type != OVSA_JSON_TYPE_ARRAY)
+            return OVSA_OK;
+        return ovsa_json_foreach_element(value->data, value->len, ovsa_json_read_model_file,
+                                         model);
+    }
+    if (ovsa_json_view_equals(key, "file_encryption")) {
+        /* A model encrypted in a mode this runtime does not know is not loaded */
+        memset_s(file_encryption, sizeof(file_encryption), 0);
+        if ((value->type != OVSA_JSON_TYPE_STRING) ||
+            (ovsa_json_view_copy(value, file_encryption, sizeof(file_encryption) - 1, NULL) <
+             OVSA_OK) ||
+            (strcmp_s(file_encryption, RSIZE_MAX_STR, CONTROLLED_ACCESS_MODEL_GCM_ENCRYPTION,
+                      &indicator) != EOK) ||
+            (indicator != 0)) {
+            ret = OVSA_JSON_UNSUPPORTED_DATA;
+            OVSA_DBG(DBG_E, "OVSA: Error unsupported model file encryption %d\n", ret);
+            return ret;
+        }
+        access_model->gcm_format = true;
+        OVSA_DBG(DBG_D, "file_encryption %s\n", file_encryption);
+        return OVSA_OK;
+    }
+    if (value->type != OVSA_JSON_TYPE_STRING)
+        return OVSA_OK;
+
+    if (ovsa_json_view_equals(key, "name"))
+        ret = ovsa_json_view_copy(value, access_model->model_name, MAX_NAME_SIZE, NULL);
+    else if (ovsa_json_view_equals(key, "description"))
+        ret = ovsa_json_view_copy(value, access_model->description, MAX_NAME_SIZE, NULL);
+    else if (ovsa_json_view_equals(key, "version"))
+        ret = ovsa_json_view_copy(value, access_model->version, MAX_VERSION_SIZE, NULL);
+    else if (ovsa_json_view_equals(key, "model_guid"))
+        ret = ovsa_json_view_copy(value, access_model->model_guid, GUID_SIZE, NULL);
+    else if (ovsa_json_view_equals(key, "signature"))
+        ret = ovsa_json_view_copy(value, model->sig->signature, MAX_SIGNATURE_SIZE, NULL);
+    else if (ovsa_json_view_equals(key, "isv_certificate"))
+        /* Memory allocated and this needs to be freed by consumer */
+        ret = ovsa_json_view_dup(value, &access_model->isv_certificate, NULL);
+    if (ret < OVSA_OK)
+        OVSA_DBG(DBG_E, "OVSA: Error could not read controlled access model %d\n", ret);
+    return ret;
+}
 
-    cJSON* model_files = cJSON_GetObjectItemCaseSensitive(parse_json, "files");
-    cJSON_ArrayForEach(file, model_files) {
-        snprintf_s_i(fname, MAX_FILE_NAME_LEN, "file_name_%d", (i) % 100u);
-        cJSON* file_name = cJSON_GetObjectItemCaseSensitive(file, fname);
+/* Read in one pass with the in-situ reader, the files of a controlled access model in the JSON
+ * format may be hundreds of MB */
+ovsa_status_t ovsa_json_extract_controlled_access_model(
+    const char* inputBuf, ovsa_controlled_access_model_sig_t* control_access_model_sig) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t len        = 0;
+    ovsa_json_model_ctx_t model;
 
-        snprintf_s_i(fname, MAX_FILE_NAME_LEN, "file_body_%d", (i++) % 100u);
-        cJSON* file_body = cJSON_GetObjectItemCaseSensitive(file, fname);
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
 
-        if (cJSON_IsString(file_body) && (file_body->valuestring != NULL) &&
-            cJSON_IsString(file_name) && (file_name->valuestring != NULL)) {
-            if (head == NULL) {
-                /* Memory allocated and this needs to be freed by consumer */
-                ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&head);
-                if (ret < OVSA_OK || head == NULL) {
-                    OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-                    goto end;
-                }
-                head->model_file_data = NULL;
-                head->next            = NULL;
-                tail                  = head;
-            } else {
-                /* Memory allocated and this needs to be freed by consumer */
-                ret = ovsa_safe_malloc(sizeof(ovsa_model_files_t), (char**)&cur);
-                if (ret < OVSA_OK || cur == NULL) {
-                    OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-                    goto end;
-                }
-                cur->model_file_data = NULL;
-                cur->next            = NULL;
-                tail->next           = cur;
-                tail                 = cur;
-            }
-            /* Memory allocated and this needs to be freed by consumer */
-            size_t str_len = 0;
-            ret            = ovsa_get_string_length(file_body->valuestring, &str_len);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error could not get length of file_body string %d\n", ret);
-                goto end;
-            }
-            ret                   = ovsa_safe_malloc(str_len + 1, &tail_enc_model);
-            tail->model_file_data = tail_enc_model;
-            if (ret < OVSA_OK || tail->model_file_data == NULL) {
-                OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-                goto end;
-            }
-            memcpy_s(tail->model_file_data, str_len, file_body->valuestring, str_len);
-            tail->model_file_data[str_len] = '\0';
-            memcpy_s(tail->model_file_name, MAX_NAME_SIZE, file_name->valuestring,
-                     strnlen_s(file_name->valuestring, MAX_NAME_SIZE));
-            tail->model_file_length = str_len;
-            OVSA_DBG(DBG_D, "%s\n", file_name->valuestring);
-        }
+    if (inputBuf == NULL || control_access_model_sig == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error input is null %d\n", ret);
+        ret = OVSA_JSON_INVALID_INPUT;
+        goto end;
+    }
+    ret = ovsa_get_string_length(inputBuf, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of input string %d\n", ret);
+        goto end;
+    }
+    model.sig                                                   = control_access_model_sig;
+    model.tail                                                  = NULL;
+    control_access_model_sig->controlled_access_model.enc_model = NULL;
+    ret = ovsa_json_foreach_member(inputBuf, len, ovsa_json_read_model_member, &model);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not parse %d\n", ret);
+        goto end;
     }
-    control_access_model_sig->controlled_access_model.enc_model = head;
+    OVSA_DBG(DBG_D, "name %s\n", control_access_model_sig->controlled_access_model.model_name);
 
 end:
-    cJSON_Delete(parse_json);
     OVSA_DBG(DBG_D, "%s exit\n", __func__);
     return ret;
 }
@@ -1347,11 +1779,32 @@ end:
     return ret;
 }
 
+typedef struct ovsa_json_element_ctx {
+    const char* key_name;
+    char** key_value;
+} ovsa_json_element_ctx_t;
+
+static ovsa_status_t ovsa_json_read_element(void* ctx, const ovsa_json_view_t* key,
+                                            const ovsa_json_view_t* value) {
+    ovsa_json_element_ctx_t* element = (ovsa_json_element_ctx_t*)ctx;
+    ovsa_status_t ret                = OVSA_OK;
+
+    if (!ovsa_json_view_equals(key, element->key_name))
+        return OVSA_OK;
+    if (value->type == OVSA_JSON_TYPE_STRING) {
+        ret = ovsa_json_view_dup(value, element->key_value, NULL);
+        if (ret < OVSA_OK)
+            return ret;
+    }
+    /* The rest of the message, e.g. the payload following the command, is not read */
+    return OVSA_JSON_READ_STOP;
+}
+
 ovsa_status_t ovsa_json_extract_element(const char* inputBuf, const char* keyName,
                                         char** keyValue) {
     ovsa_status_t ret = OVSA_OK;
-    cJSON* parse_json = NULL;
-    cJSON* key        = NULL;
+    size_t len        = 0;
+    ovsa_json_element_ctx_t element;
 
     OVSA_DBG(DBG_D, "%s entry\n", __func__);
     if (inputBuf == NULL || keyName == NULL) {
@@ -1359,30 +1812,19 @@ ovsa_status_t ovsa_json_extract_element(const char* inputBuf, const char* keyNam
         OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
         goto end;
     }
-    parse_json = cJSON_Parse(inputBuf);
-    if (parse_json == NULL) {
-        ret = OVSA_JSON_PARSE_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error Json parse failed %d\n", ret);
+    ret = ovsa_get_string_length(inputBuf, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of input string %d\n", ret);
         goto end;
     }
-    key = cJSON_GetObjectItemCaseSensitive(parse_json, keyName);
-    if (cJSON_IsString(key) && (key->valuestring != NULL)) {
-        size_t str_len = 0;
-        ret            = ovsa_get_string_length(key->valuestring, &str_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of key string %d\n", ret);
-            goto end;
-        }
-        ret = ovsa_safe_malloc(str_len + 1, (char**)keyValue);
-        if (ret < OVSA_OK) {
-            ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
-            goto end;
-        }
-        memcpy_s(*keyValue, str_len, key->valuestring, str_len);
+    element.key_name  = keyName;
+    element.key_value = keyValue;
+    ret = ovsa_json_foreach_member(inputBuf, len, ovsa_json_read_element, &element);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error Json parse failed %d\n", ret);
+        goto end;
     }
 end:
-    cJSON_Delete(parse_json);
     OVSA_DBG(DBG_D, "%s exit\n", __func__);
     return ret;
 }
@@ -1668,6 +2110,9 @@ ovsa_status_t ovsa_json_create_message_blob(ovsa_command_type_t cmdtype, const c
     } else if (cmdtype == OVSA_SEND_CUST_LICENSE) {
         memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, "OVSA_SEND_CUST_LICENSE",
                  strnlen_s("OVSA_SEND_CUST_LICENSE", RSIZE_MAX_STR));
+    } else if (cmdtype == OVSA_SEND_CUST_LICENSE_BATCH) {
+        memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, "OVSA_SEND_CUST_LICENSE_BATCH",
+                 strnlen_s("OVSA_SEND_CUST_LICENSE_BATCH", RSIZE_MAX_STR));
     }
 #ifndef ENABLE_SGX_GRAMINE
     else if (cmdtype == OVSA_SEND_HW_QUOTE) {
@@ -1679,6 +2124,9 @@ ovsa_status_t ovsa_json_create_message_blob(ovsa_command_type_t cmdtype, const c
     } else if (cmdtype == OVSA_SEND_EK_AK_BIND_INFO) {
         memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, "OVSA_SEND_EK_AK_BIND_INFO",
                  strnlen_s("OVSA_SEND_EK_AK_BIND_INFO", RSIZE_MAX_STR));
+    } else if (cmdtype == OVSA_SEND_ATTESTATION_TOKEN) {
+        memcpy_s(command, MAX_COMMAND_TYPE_LENGTH, "OVSA_SEND_ATTESTATION_TOKEN",
+                 strnlen_s("OVSA_SEND_ATTESTATION_TOKEN", RSIZE_MAX_STR));
     }
 #endif
     else if (cmdtype == OVSA_SEND_UPDATE_CUST_LICENSE_ACK) {
@@ -1737,6 +2185,138 @@ end:
     return ret;
 }
 
+ovsa_status_t ovsa_json_create_string_array(char* const* values, size_t count, char** outputBuf) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* array      = NULL;
+    cJSON* item       = NULL;
+    size_t len        = 0;
+    size_t index      = 0;
+    char* str_print   = NULL;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    if (values == NULL || outputBuf == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    array = cJSON_CreateArray();
+    if (array == NULL) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        OVSA_DBG(DBG_E, "OVSA: Error create json array failed %d\n", ret);
+        goto end;
+    }
+    for (index = 0; index < count; index++) {
+        item = cJSON_CreateString(values[index] != NULL ? values[index] : "");
+        if (item == NULL) {
+            ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+            OVSA_DBG(DBG_E, "OVSA: Error add string to json array failed %d\n", ret);
+            goto end;
+        }
+        cJSON_AddItemToArray(array, item);
+    }
+    str_print = cJSON_PrintUnformatted(array);
+    if (str_print == NULL) {
+        ret = OVSA_JSON_PRINT_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error print json array to buffer failed %d\n", ret);
+        goto end;
+    }
+    ret = ovsa_get_string_length(str_print, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+        goto end;
+    }
+    /* For NULL termination */
+    len = len + 1;
+    ret = ovsa_safe_malloc(len, outputBuf);
+    if (ret < OVSA_OK || *outputBuf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    memcpy_s(*outputBuf, len, str_print, len);
+
+end:
+    cJSON_Delete(array);
+    ovsa_safe_free(&str_print);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
+
+ovsa_status_t ovsa_json_extract_string_array(const char* inputBuf, size_t max_count,
+                                             char*** values, size_t* count) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* parse_json = NULL;
+    cJSON* item       = NULL;
+    size_t str_len    = 0;
+    size_t index      = 0;
+    size_t num_items  = 0;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+    if (inputBuf == NULL || values == NULL || count == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    *values    = NULL;
+    *count     = 0;
+    parse_json = cJSON_Parse(inputBuf);
+    if (!cJSON_IsArray(parse_json)) {
+        ret = OVSA_JSON_PARSE_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error json array parse failed %d\n", ret);
+        goto end;
+    }
+    num_items = cJSON_GetArraySize(parse_json);
+    if ((num_items == 0) || (num_items > max_count)) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error json array size %zu is invalid\n", num_items);
+        goto end;
+    }
+    *values = (char**)calloc(num_items, sizeof(char*));
+    if (*values == NULL) {
+        ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    *count = num_items;
+    cJSON_ArrayForEach(item, parse_json) {
+        if (!cJSON_IsString(item) || (item->valuestring == NULL)) {
+            ret = OVSA_JSON_INVALID_INPUT;
+            OVSA_DBG(DBG_E, "OVSA: Error json array element %zu is not a string\n", index);
+            goto end;
+        }
+        ret = ovsa_get_string_length(item->valuestring, &str_len);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+            goto end;
+        }
+        ret = ovsa_safe_malloc(str_len + 1, &(*values)[index]);
+        if (ret < OVSA_OK) {
+            ret = OVSA_JSON_MEMORY_ALLOC_FAIL;
+            OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+            goto end;
+        }
+        memcpy_s((*values)[index], str_len, item->valuestring, str_len);
+        index++;
+    }
+
+end:
+    if ((ret < OVSA_OK) && (values != NULL) && (count != NULL))
+        ovsa_json_free_string_array(values, *count);
+    cJSON_Delete(parse_json);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
+
+void ovsa_json_free_string_array(char*** values, size_t count) {
+    size_t index = 0;
+
+    if ((values == NULL) || (*values == NULL))
+        return;
+    for (index = 0; index < count; index++)
+        ovsa_safe_free(&(*values)[index]);
+    free(*values);
+    *values = NULL;
+}
+
 #ifndef ENABLE_SGX_GRAMINE
 ovsa_status_t ovsa_json_create_EK_AK_binding_info_blob(ovsa_ek_ak_bind_info_t ek_ak_bind_info,
                                                        char** outputBuf, size_t* valuelen) {
@@ -1810,6 +2390,89 @@ ovsa_status_t ovsa_json_create_EK_AK_binding_info_blob(ovsa_ek_ak_bind_info_t ek
         goto end;
     }
 #endif
+    /* Ask for an attestation token to present on the next license checks */
+    if (cJSON_AddStringToObject(message, "attestation_token", "request") == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add attestation_token to json failed %d\n", ret);
+        goto end;
+    }
+    str_print = cJSON_Print(message);
+    if (str_print == NULL) {
+        ret = OVSA_JSON_PRINT_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error print message json to buffer failed %d\n", ret);
+        goto end;
+    }
+    ret = ovsa_get_string_length(str_print, &len);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not get length of string %d\n", ret);
+        goto end;
+    }
+    /* For NULL termination */
+    len = len + 1;
+    ret = ovsa_safe_malloc(len, (char**)outputBuf);
+    if (ret < OVSA_OK || *outputBuf == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory %d\n", ret);
+        goto end;
+    }
+    *valuelen = len;
+    memcpy_s(*outputBuf, len, str_print, len);
+
+end:
+    cJSON_Delete(message);
+    ovsa_safe_free(&str_print);
+    OVSA_DBG(DBG_D, "%s exit\n", __func__);
+    return ret;
+}
+
+ovsa_status_t ovsa_json_create_attestation_token_blob(const char* token, const char* ak_name,
+                                                      ovsa_quote_info_t quote_info,
+                                                      char** outputBuf, size_t* valuelen) {
+    ovsa_status_t ret = OVSA_OK;
+    cJSON* message    = NULL;
+    size_t len        = 0;
+    char* str_print   = NULL;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+
+    if (token == NULL || ak_name == NULL || quote_info.quote_pcr == NULL ||
+        quote_info.quote_message == NULL || quote_info.quote_sig == NULL) {
+        ret = OVSA_JSON_INVALID_INPUT;
+        OVSA_DBG(DBG_E, "OVSA: Error input parameters invalid %d\n", ret);
+        goto end;
+    }
+    /* Create json object */
+    message = cJSON_CreateObject();
+    if (message == NULL) {
+        ret = OVSA_JSON_ERROR_CREATE_OBJECT;
+        OVSA_DBG(DBG_E, "OVSA: Error create json message object failed %d\n", ret);
+        goto end;
+    }
+    /* Populate the json */
+    if (cJSON_AddStringToObject(message, "token", token) == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add token to json failed %d\n", ret);
+        goto end;
+    }
+    if (cJSON_AddStringToObject(message, "AK_name", ak_name) == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add AK_name to json failed %d\n", ret);
+        goto end;
+    }
+    if (cJSON_AddStringToObject(message, "SW_Quote_PCR", quote_info.quote_pcr) == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add SW_Quote_PCR to json failed %d\n", ret);
+        goto end;
+    }
+    if (cJSON_AddStringToObject(message, "SW_Quote_MSG", quote_info.quote_message) == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add SW_Quote_MSG to json failed %d\n", ret);
+        goto end;
+    }
+    if (cJSON_AddStringToObject(message, "SW_Quote_SIG", quote_info.quote_sig) == NULL) {
+        ret = OVSA_JSON_ERROR_ADD_ELEMENT;
+        OVSA_DBG(DBG_E, "OVSA: Error add SW_Quote_SIG to json failed %d\n", ret);
+        goto end;
+    }
     str_print = cJSON_Print(message);
     if (str_print == NULL) {
         ret = OVSA_JSON_PRINT_FAIL;
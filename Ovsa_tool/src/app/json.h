@@ -22,6 +22,33 @@
 #include "runtime.h"
 #endif
 
+/* Nesting of objects and arrays accepted by the in-situ JSON reader */
+#define OVSA_JSON_MAX_DEPTH      32
+#define OVSA_JSON_MAX_NUMBER_LEN 32
+/* Returned by a reader callback to stop reading the rest of the object or array */
+#define OVSA_JSON_READ_STOP 1
+
+typedef enum {
+    OVSA_JSON_TYPE_NULL = 0,
+    OVSA_JSON_TYPE_BOOL,
+    OVSA_JSON_TYPE_NUMBER,
+    OVSA_JSON_TYPE_STRING,
+    OVSA_JSON_TYPE_OBJECT,
+    OVSA_JSON_TYPE_ARRAY
+} ovsa_json_type_t;
+
+/* JSON value in place in the buffer read, strings are without the quotes and still escaped */
+typedef struct ovsa_json_view {
+    ovsa_json_type_t type;
+    const char* data;
+    size_t len;
+} ovsa_json_view_t;
+
+typedef ovsa_status_t (*ovsa_json_member_cb_t)(void* ctx, const ovsa_json_view_t* key,
+                                               const ovsa_json_view_t* value);
+typedef ovsa_status_t (*ovsa_json_element_cb_t)(void* ctx, size_t index,
+                                                const ovsa_json_view_t* value);
+
 /* API's */
 
 /*!
@@ -144,6 +171,70 @@ ovsa_status_t ovsa_json_extract_customer_license(const char* inputBuf,
  */
 ovsa_status_t ovsa_json_extract_element(const char* inputBuf, const char* keyName, char** keyValue);
 
+/*!
+ * \brief ovsa_json_foreach_member
+ *
+ * \param [in]  buf Buffer having a json object, read up to its terminating NUL or len bytes
+ * \param [in]  len Size of the buffer
+ * \param [in]  cb  Called with each member of the object in the order of the buffer
+ * \param [in]  ctx Context passed to the callback
+ * \return ovsa_status_t: OVSA_OK, the error of the reader or the error returned by cb
+ */
+ovsa_status_t ovsa_json_foreach_member(const char* buf, size_t len, ovsa_json_member_cb_t cb,
+                                       void* ctx);
+
+/*!
+ * \brief ovsa_json_foreach_element
+ *
+ * \param [in]  buf Buffer having a json array, read up to its terminating NUL or len bytes
+ * \param [in]  len Size of the buffer
+ * \param [in]  cb  Called with each element of the array in the order of the buffer
+ * \param [in]  ctx Context passed to the callback
+ * \return ovsa_status_t: OVSA_OK, the error of the reader or the error returned by cb
+ */
+ovsa_status_t ovsa_json_foreach_element(const char* buf, size_t len, ovsa_json_element_cb_t cb,
+                                        void* ctx);
+
+/*!
+ * \brief ovsa_json_view_equals
+ *
+ * \param [in]  view JSON string, e.g. the key of a member
+ * \param [in]  str  String compared with the escaped content of the view
+ * \return true if they are the same
+ */
+bool ovsa_json_view_equals(const ovsa_json_view_t* view, const char* str);
+
+/*!
+ * \brief ovsa_json_view_get_number
+ *
+ * \param [in]  view   JSON number
+ * \param [out] number Value of the number
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_view_get_number(const ovsa_json_view_t* view, double* number);
+
+/*!
+ * \brief ovsa_json_view_copy
+ *
+ * \param [in]  view      JSON string
+ * \param [out] dest      Updated with the unescaped string, not NUL terminated
+ * \param [in]  dest_size Size of dest, longer strings are truncated
+ * \param [out] copied    Number of bytes copied, may be NULL
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_view_copy(const ovsa_json_view_t* view, char* dest, size_t dest_size,
+                                  size_t* copied);
+
+/*!
+ * \brief ovsa_json_view_dup
+ *
+ * \param [in]  view      JSON string
+ * \param [out] value     Allocated NUL terminated unescaped string, freed by the caller
+ * \param [out] value_len Length of the string, may be NULL
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_view_dup(const ovsa_json_view_t* view, char** value, size_t* value_len);
+
 #ifdef OVSA_RUNTIME
 #ifndef ENABLE_SGX_GRAMINE
 /*!
@@ -156,6 +247,20 @@ ovsa_status_t ovsa_json_extract_element(const char* inputBuf, const char* keyNam
  */
 ovsa_status_t ovsa_json_create_EK_AK_binding_info_blob(ovsa_ek_ak_bind_info_t ek_ak_bind_info,
                                                        char** outputBuf, size_t* valuelen);
+
+/*!
+ * \brief ovsa_json_create_attestation_token_blob
+ *
+ * \param [in]  token attestation token issued by the license server
+ * \param [in]  ak_name name of the attestation key the token was issued for
+ * \param [in]  quote_info quote over the nonce of the license server
+ * \param [out] outputBuf buffer content
+ * \param [out] valuelen output size
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_create_attestation_token_blob(const char* token, const char* ak_name,
+                                                      ovsa_quote_info_t quote_info,
+                                                      char** outputBuf, size_t* valuelen);
 #endif
 
 /*!
@@ -170,6 +275,36 @@ ovsa_status_t ovsa_json_create_EK_AK_binding_info_blob(ovsa_ek_ak_bind_info_t ek
 ovsa_status_t ovsa_json_create_message_blob(ovsa_command_type_t cmdtype, const char* payload,
                                             char** outputBuf, size_t* length);
 
+/*!
+ * \brief ovsa_json_create_string_array
+ *
+ * \param [in]  values    strings to add to the json array
+ * \param [in]  count     number of strings
+ * \param [out] outputBuf Output buffer containing JSON array
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_create_string_array(char* const* values, size_t count, char** outputBuf);
+
+/*!
+ * \brief ovsa_json_extract_string_array
+ *
+ * \param [in]  inputBuf  Buffer having a json array of strings
+ * \param [in]  max_count maximum number of strings accepted
+ * \param [out] values    strings read, free with ovsa_json_free_string_array()
+ * \param [out] count     number of strings read
+ * \return ovsa_status_t
+ */
+ovsa_status_t ovsa_json_extract_string_array(const char* inputBuf, size_t max_count,
+                                             char*** values, size_t* count);
+
+/*!
+ * \brief ovsa_json_free_string_array
+ *
+ * \param [in]  values strings to free
+ * \param [in]  count  number of strings
+ */
+void ovsa_json_free_string_array(char*** values, size_t count);
+
 #ifndef ENABLE_SGX_GRAMINE
 /*!
  * \brief ovsa_json_create_quote_info
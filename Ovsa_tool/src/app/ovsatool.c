@@ -71,6 +71,10 @@ static void ovsa_help(const char* argv) {
         "list of TCB "
         "Signature files  > -p <Customer Certificate> -c <Customer license> -g <License GUID>\n\n",
         argv);
+    printf(
+        "%s sale -m <Master license file> -k <key store file> -l <license conf file> -t <  "
+        "list of TCB Signature files  > -b <Customer manifest> [-j <Threads>] [-d <SQL file>]\n\n",
+        argv);
     printf(
         "%s updatecustlicense -k <key store file> -l <Customer License File> -p <Customer "
         "Certificate> -u <License URL> <Future server certificate [-u <License URL> <Future server "
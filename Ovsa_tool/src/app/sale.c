@@ -17,6 +17,7 @@
 
 #include <ctype.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,6 +31,42 @@
 /* json.h to be included at end due to dependencies */
 #include "json.h"
 
+#define MAX_SALE_THREADS 16
+
+/* ISV material of a sale, verified once and shared read-only by the licenses issued from it */
+typedef struct ovsa_sale_ctx {
+    int asymm_keyslot;
+    int req_lic_days;
+    time_t lic_end_time;
+    char* isv_certificate;
+    size_t cust_lic_size;
+    ovsa_license_config_sig_t lic_conf_sig;
+    ovsa_master_license_sig_t master_lic_sig;
+    /* Customer license but for the encryption key, which is rewrapped for each customer */
+    ovsa_customer_license_sig_t customer_license;
+} ovsa_sale_ctx_t;
+
+/* Customer of a bulk sale, one line of the manifest */
+typedef struct ovsa_sale_entry {
+    char cert_file[MAX_FILE_NAME];
+    char lic_file[MAX_FILE_NAME];
+    char secondary_cert_file[MAX_FILE_NAME];
+    GUID license_guid;
+    /* Signed customer license, kept for the DB rows */
+    char* lic_sig_string;
+    ovsa_status_t ret;
+} ovsa_sale_entry_t;
+
+/* Customers shared by the sale threads, each one picks the next customer under the lock */
+typedef struct ovsa_sale_pool {
+    const ovsa_sale_ctx_t* ctx;
+    ovsa_sale_entry_t* entries;
+    int entry_count;
+    int next_entry;
+    bool keep_licenses;
+    pthread_mutex_t lock;
+} ovsa_sale_pool_t;
+
 static void ovsa_sale_help(const char* argv) {
     printf("Help for Sale command\n");
     printf("-m : Master license file\n");
@@ -38,6 +75,14 @@ static void ovsa_sale_help(const char* argv) {
     printf("-t : List of TCB signature files\n");
     printf("-p : Customer certificate\n");
     printf("-c : Customer license\n");
+    printf("-b : Manifest of the customers to generate licenses for, in place of -p and -c\n");
+    printf(
+        "     One customer per line: <Customer certificate> <Customer license> [<Customer "
+        "secondary certificate> [<License GUID>]]\n");
+    printf("-j : Number of threads generating the licenses of a manifest, 1 by default\n");
+    printf(
+        "-d : SQL file of the customer license DB rows of a manifest, requires the secondary "
+        "certificates\n");
     printf("Example for sale as below:\n");
     printf(
         "-m <Master license file> -k <key store file> -l <license conf file> -t <  list of TCB "
@@ -46,6 +91,10 @@ static void ovsa_sale_help(const char* argv) {
         "%s sale -m face_detection_model_master.lic -k key_store.json -l license_conf.json "
         "-t tcb1.sig tcb2.sig -p customer_cert.crl -c face_detection_model_customer.lic\"\n",
         argv);
+    printf(
+        "%s sale -m face_detection_model_master.lic -k key_store.json -l license_conf.json "
+        "-t tcb1.sig tcb2.sig -b customers.txt -j 8 -d customers.sql\n",
+        argv);
 }
 
 static int ovsa_get_list_file_count(ovsa_license_serv_url_list_t* url_list) {
@@ -101,36 +150,11 @@ static ovsa_status_t ovsa_check_is_master_license_expired(const char* master_lic
     return OVSA_OK;
 }
 
-static ovsa_status_t ovsa_check_cert_validity(const char* isv_cert, const char* cust_cert,
-                                              int req_lic_days) {
-    char isv_cert_issue_date[MAX_DATE_TIME_SIZE];
-    char customer_cert_issue_date[MAX_DATE_TIME_SIZE];
-    char isv_cert_end_date[MAX_DATE_TIME_SIZE];
-    char customer_cert_end_date[MAX_DATE_TIME_SIZE];
-    ovsa_status_t ret = OVSA_OK;
-
-    time_t current_time, isv_cert_time, customer_cert_time;
-    struct tm *current_time_tm, isv_cert_tm, customer_cert_tm;
-    int elapsedtime = 0;
-
-    memset_s(&customer_cert_tm, sizeof(struct tm), 0);
-    memset_s(&isv_cert_tm, sizeof(struct tm), 0);
-    memset_s(isv_cert_issue_date, sizeof(isv_cert_issue_date), 0);
-    memset_s(customer_cert_issue_date, sizeof(customer_cert_issue_date), 0);
-    memset_s(isv_cert_end_date, sizeof(isv_cert_end_date), 0);
-    memset_s(customer_cert_end_date, sizeof(customer_cert_end_date), 0);
-
-    ret = ovsa_crypto_extract_cert_date(isv_cert, isv_cert_issue_date, isv_cert_end_date);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "ERROR: Could not extract start and end date from ISV certificate\n");
-        return ret;
-    }
-    ret =
-        ovsa_crypto_extract_cert_date(cust_cert, customer_cert_issue_date, customer_cert_end_date);
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "ERROR: Could not extract start and end date from customer certificate\n");
-        return ret;
-    }
+/* Time at which the requested license duration ends, the certificates must be valid till then */
+static ovsa_status_t ovsa_get_license_end_time(int req_lic_days, time_t* lic_end_time) {
+    time_t current_time;
+    struct tm* current_time_tm = NULL;
+    ovsa_status_t ret          = OVSA_OK;
 
     ret = ovsa_get_current_time(&current_time, &current_time_tm);
     if (ret != OVSA_OK) {
@@ -139,43 +163,49 @@ static ovsa_status_t ovsa_check_cert_validity(const char* isv_cert, const char*
 
     /* Check requested duration is with in Certificate validity */
     current_time_tm->tm_mday += req_lic_days;
-    current_time = mktime(current_time_tm);
+    *lic_end_time = mktime(current_time_tm);
     OVSA_DBG(DBG_D, "OVSA: Current date + license req time: %s", asctime(current_time_tm));
+    return OVSA_OK;
+}
 
-    /* Check ISV Certificate validity */
-    strptime(isv_cert_issue_date, "%b %d %H:%M:%S %Y", &isv_cert_tm);
-    isv_cert_tm.tm_mon += MAX_CERT_VALIDITY_PERIOD;
-    isv_cert_time = mktime(&isv_cert_tm);
+/* Called from the sale threads for the customer certificates, hence asctime_r() */
+static ovsa_status_t ovsa_check_cert_validity(const char* cert, const char* cert_owner,
+                                              int req_lic_days, time_t lic_end_time) {
+    char cert_issue_date[MAX_DATE_TIME_SIZE];
+    char cert_end_date[MAX_DATE_TIME_SIZE];
+    char cert_time_str[MAX_DATE_TIME_SIZE];
+    ovsa_status_t ret = OVSA_OK;
+    time_t cert_time;
+    struct tm cert_tm;
+    int elapsedtime = 0;
 
-    OVSA_DBG(DBG_I, "OVSA: ISV Certificte validity expires on: %s", asctime(&isv_cert_tm));
+    memset_s(&cert_tm, sizeof(struct tm), 0);
+    memset_s(cert_issue_date, sizeof(cert_issue_date), 0);
+    memset_s(cert_end_date, sizeof(cert_end_date), 0);
+    memset_s(cert_time_str, sizeof(cert_time_str), 0);
 
-    elapsedtime = difftime(current_time, isv_cert_time);
-    if (elapsedtime > 0) {
-        int days = TIMECONVERT_SECSTODAYS(elapsedtime); /* Convert seconds to days */
-        OVSA_DBG(
-            DBG_E,
-            "ERROR: ISV Certificate with requested license of %d days exceeds MAX certificate limit"
-            " Please request license for less than %d days\n",
-            req_lic_days, req_lic_days - days);
-        return OVSA_TIME_DURATIONEXCEEDS_ERROR;
+    ret = ovsa_crypto_extract_cert_date(cert, cert_issue_date, cert_end_date);
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "ERROR: Could not extract start and end date from %s certificate\n",
+                 cert_owner);
+        return ret;
     }
 
-    /* Check Customer Certificate validity */
-    strptime(customer_cert_issue_date, "%b %d %H:%M:%S %Y", &customer_cert_tm);
-    customer_cert_tm.tm_mon += MAX_CERT_VALIDITY_PERIOD;
-    customer_cert_time = mktime(&customer_cert_tm);
+    strptime(cert_issue_date, "%b %d %H:%M:%S %Y", &cert_tm);
+    cert_tm.tm_mon += MAX_CERT_VALIDITY_PERIOD;
+    cert_time = mktime(&cert_tm);
 
-    OVSA_DBG(DBG_I, "OVSA: Customer Certificate validity time expires on : %s",
-             asctime(&customer_cert_tm));
+    OVSA_DBG(DBG_I, "OVSA: %s Certificate validity expires on: %s", cert_owner,
+             asctime_r(&cert_tm, cert_time_str));
 
-    elapsedtime = difftime(current_time, customer_cert_time);
+    elapsedtime = difftime(lic_end_time, cert_time);
     if (elapsedtime > 0) {
         int days = TIMECONVERT_SECSTODAYS(elapsedtime); /* Convert seconds to days */
         OVSA_DBG(DBG_E,
-                 "ERROR: Customer Certificate with requested license of %d days exceeds MAX "
+                 "ERROR: %s Certificate with requested license of %d days exceeds MAX "
                  "certificate limit."
                  " Please request license for less than %d days\n",
-                 req_lic_days, req_lic_days - days);
+                 cert_owner, req_lic_days, req_lic_days - days);
         return OVSA_TIME_DURATIONEXCEEDS_ERROR;
     }
     return OVSA_OK;
@@ -192,7 +222,7 @@ static ovsa_status_t ovsa_verify_artefacts(int asymm_keyslot, const char* input_
     int shared_key_slot  = -1;
     int keyiv_hmac_slot  = -1;
 
-    if ((asymm_keyslot < MIN_KEY_SLOT) || (asymm_keyslot >= MAX_KEY_SLOT) || input_file == NULL) {
+    if ((asymm_keyslot < MIN_KEY_SLOT) || input_file == NULL) {
         ret = OVSA_INVALID_PARAMETER;
         OVSA_DBG(DBG_E, "OVSA: Error wrong input parameters to verify file\n");
         return ret;
@@ -276,252 +306,55 @@ out:
     return ret;
 }
 
-ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
-    ovsa_status_t ret                 = OVSA_OK;
-    int asymm_keyslot                 = -1;
-    int peer_slot                     = -1;
-    int keyiv_hmac_slot               = -1;
-    int c                             = 0;
-    int file_count                    = 0;
-    int tcb_signature_size            = 0;
-    int url_file_count                = 0;
-    int i                             = 0;
-    size_t argv_len                   = 0;
-    size_t outlen                     = 0;
-    size_t size                       = 0;
-    size_t cert_size                  = 0;
-    size_t cust_lic_size              = 0;
-    ovsa_input_files_t* tcb_list_head = NULL;
-    char* keystore                    = NULL;
-    char* lic_cnf_file                = NULL;
-    char* customer_cert_file          = NULL;
-    char* isv_certificate             = NULL;
-    char* customer_lic_file           = NULL;
-    char* masterlic_file              = NULL;
-    char* cert_buff                   = NULL;
-    char* customer_lic_sig_string     = NULL;
-    char* customer_lic_string         = NULL;
-    char* lic_cnf_sig_buf             = NULL;
-    char* lic_cnf_buf                 = NULL;
-    char* master_lic_sig_buf          = NULL;
-    char* master_lic_buf              = NULL;
-    char* tcb_sig_buf                 = NULL;
-    time_t today                      = time(NULL);
-    char* time_str                    = NULL;
-    char* enc_key                     = NULL;
-    ovsa_tcb_sig_list_t* tcb_list     = NULL;
-    ovsa_input_files_t* tcb_list_tail = NULL;
-    ovsa_customer_license_sig_t customer_license;
-    ovsa_license_config_sig_t lic_conf_sig;
-    ovsa_master_license_sig_t master_lic_sig;
-
-    memset_s(&master_lic_sig, sizeof(ovsa_master_license_sig_t), 0);
-    memset_s(&lic_conf_sig, sizeof(ovsa_license_config_sig_t), 0);
-    memset_s(&customer_license, sizeof(ovsa_customer_license_sig_t), 0);
-
-    OVSA_DBG(DBG_D, "%s entry\n", __func__);
-
-    if (argc > MAX_SAFE_ARGC) {
-        ret = OVSA_INVALID_PARAMETER;
-        OVSA_DBG(DBG_E, "OVSA: Error wrong command given. Please follow -help for help option\n");
-        goto out;
-    }
-    for (i = 0; argc > i; i++) {
-        ret = ovsa_get_string_length(argv[i], &argv_len);
-        if (ret < OVSA_OK) {
-            OVSA_DBG(DBG_E, "OVSA: Error could not get length of argv string %d\n", ret);
-            goto out;
-        }
-        if (argv_len > RSIZE_MAX_STR) {
-            OVSA_DBG(DBG_E,
-                     "OVSA: Error sale argument'%s' greater than %ld characters not allowed \n",
-                     argv[i], RSIZE_MAX_STR);
-            ret = OVSA_INVALID_PARAMETER;
-            goto out;
-        }
-    }
-
-    while ((c = getopt(argc, argv, "m:k:l:t:p:c:h")) != -1) {
-        switch (c) {
-            case 'm': {
-                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
-                    OVSA_DBG(
-                        DBG_E,
-                        "OVSA: Master license file path greater than %d characters not allowed \n",
-                        MAX_FILE_NAME);
-                    ret = OVSA_INVALID_FILE_PATH;
-                    goto out;
-                }
-                masterlic_file = optarg;
-                OVSA_DBG(DBG_D, "OVSA: masterlic_file = %s\n", masterlic_file);
-            } break;
-            case 'k': {
-                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
-                    OVSA_DBG(DBG_E,
-                             "OVSA: Error keystore path greater than %d characters not allowed \n",
-                             MAX_FILE_NAME);
-                    ret = OVSA_INVALID_FILE_PATH;
-                    goto out;
-                }
-                keystore = optarg;
-                OVSA_DBG(DBG_D, "OVSA: keystore = %s\n", keystore);
-            } break;
-            case 'l': {
-                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
-                    OVSA_DBG(
-                        DBG_E,
-                        "OVSA: License config file path greater than %d characters not allowed \n",
-                        MAX_FILE_NAME);
-                    ret = OVSA_INVALID_PARAMETER;
-                    goto out;
-                }
-                lic_cnf_file = optarg;
-                OVSA_DBG(DBG_D, "OVSA: lic_cnf_file = %s\n", lic_cnf_file);
-            } break;
-            case 't': {
-                int index;
-                index = optind - 1;
-                while (index < argc) {
-                    if (strnlen_s(argv[index], RSIZE_MAX_STR) < MAX_FILE_NAME) {
-                        if (argv[index][0] != '-') {
-                            ret = ovsa_store_input_file_list(argv[index], &tcb_list_head,
-                                                             &tcb_list_tail);
-                            if (ret < OVSA_OK) {
-                                OVSA_DBG(DBG_E,
-                                         "OVSA: Error store TCB file list failed with code %d\n",
-                                         ret);
-                                goto out;
-                            }
-                            optind = index + 1;
-                        } else {
-                            break;
-                        }
-                        index++;
-                    } else {
-                        OVSA_DBG(DBG_E,
-                                 "OVSA: Error name greater than %d characters not allowed \n",
-                                 MAX_FILE_NAME);
-                        ret = OVSA_INVALID_PARAMETER;
-                        goto out;
-                    }
-                }
-            } break;
-            case 'p': {
-                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
-                    OVSA_DBG(DBG_E,
-                             "OVSA: Customer certificate file path greater than %d characters not "
-                             "allowed \n",
-                             MAX_FILE_NAME);
-                    ret = OVSA_INVALID_PARAMETER;
-                    goto out;
-                }
-                customer_cert_file = optarg;
-                OVSA_DBG(DBG_D, "OVSA: customer_cert_file = %s\n", customer_cert_file);
-            } break;
-            case 'c': {
-                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
-                    OVSA_DBG(DBG_E,
-                             "OVSA: Customer license file path greater than %d characters not "
-                             "allowed \n",
-                             MAX_FILE_NAME);
-                    ret = OVSA_INVALID_PARAMETER;
-                    goto out;
-                }
-                customer_lic_file = optarg;
-                OVSA_DBG(DBG_D, "OVSA: customer_lic_file = %s\n", customer_lic_file);
-            } break;
-            case 'h': {
-                ovsa_sale_help(argv[0]);
-                goto out;
-            }
-            default: {
-                OVSA_DBG(DBG_E,
-                         "OVSA: Error wrong command given. Please follow -help for help option "
-                         "c = %d\n",
-                         c);
-                ret = OVSA_INVALID_PARAMETER;
-                goto out;
-            }
-        }
-    }
-
-    /* optind is for the extra arguments which are not parsed */
-    for (; optind < argc; optind++) {
-        OVSA_DBG(DBG_I, "extra arguments: %s\n", argv[optind]);
-    }
-
-    if ((masterlic_file == NULL) || (keystore == NULL) || (lic_cnf_file == NULL) ||
-        (tcb_list_head == NULL) || (customer_cert_file == NULL) || (customer_lic_file == NULL)) {
-        ret = OVSA_INVALID_PARAMETER;
-        OVSA_DBG(DBG_E, "OVSA: Error wrong command given. Please follow -help for help option\n");
-        goto out;
-    }
+static void ovsa_sale_free_ctx(ovsa_sale_ctx_t* ctx) {
+    ovsa_safe_free(&ctx->isv_certificate);
+    ovsa_safe_free(&ctx->customer_license.customer_lic.isv_certificate);
+    ovsa_safe_free(&ctx->master_lic_sig.master_lic.isv_certificate);
+    ovsa_safe_free(&ctx->lic_conf_sig.lic_config.isv_certificate);
+    /* The URL list of the customer license is the one of the license config */
+    ovsa_safe_free_url_list(&ctx->lic_conf_sig.lic_config.license_url_list);
+    ovsa_safe_free_tcb_list(&ctx->customer_license.customer_lic.tcb_signatures);
+}
 
-    /* Initialize crypto */
-    ret = ovsa_crypto_init();
-    if (ret != OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error ovsa crypto init failed with code %d\n", ret);
-        goto out;
-    }
+/* Verifies the ISV material of a sale and fills the part of the customer license it makes up */
+static ovsa_status_t ovsa_sale_init_ctx(ovsa_sale_ctx_t* ctx, const char* keystore,
+                                        const char* lic_cnf_file, const char* masterlic_file,
+                                        const ovsa_input_files_t* tcb_list_head) {
+    ovsa_status_t ret                  = OVSA_OK;
+    int file_count                     = 0;
+    int tcb_signature_size             = 0;
+    int url_file_count                 = 0;
+    size_t size                        = 0;
+    size_t cert_size                   = 0;
+    size_t certlen                     = 0;
+    char* lic_cnf_sig_buf              = NULL;
+    char* master_lic_sig_buf           = NULL;
+    char* tcb_sig_buf                  = NULL;
+    char* time_str                     = NULL;
+    time_t today                       = time(NULL);
+    ovsa_tcb_sig_list_t* tcb_list      = NULL;
+    ovsa_tcb_sig_list_t* tcb_cur_list  = NULL;
+    ovsa_tcb_sig_list_t* tcb_tail_list = NULL;
+    const ovsa_input_files_t* tcb_file = tcb_list_head;
+    ovsa_customer_license_t* cust_lic  = &ctx->customer_license.customer_lic;
 
     /* Get Asym Key Slot from Key store */
     OVSA_DBG(DBG_I, "OVSA: Load Asymmetric Key\n");
-    ret = ovsa_crypto_load_asymmetric_key(keystore, &asymm_keyslot);
+    ret = ovsa_crypto_load_asymmetric_key(keystore, &ctx->asymm_keyslot);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error get keyslot failed with code %d\n", ret);
         goto out;
     }
 
-    /* Read certficate from on disk file */
-    FILE* fptr = fopen(customer_cert_file, "r");
-    if (fptr == NULL) {
-        ret = OVSA_FILEOPEN_FAIL;
-        OVSA_DBG(DBG_E, "OVSA: Error opening certificate file failed with code %d\n", ret);
-        goto out;
-    }
-
-    /* Get length of certificate file */
-    ret = ovsa_crypto_get_file_size(fptr, &size);
-    if (ret < OVSA_OK || size == 0) {
-        OVSA_DBG(DBG_E, "OVSA: Error get file size failed for %s with code %d\n",
-                 customer_cert_file, ret);
-        fclose(fptr);
-        goto out;
-    }
-    ret = ovsa_safe_malloc(size, &cert_buff);
-    if (ret < OVSA_OK || cert_buff == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error certificate file buffer allocation failed with code %d\n",
-                 ret);
-        fclose(fptr);
-        goto out;
-    }
-    ret = fread(cert_buff, 1, size, fptr);
-    fclose(fptr);
-
-    OVSA_DBG(DBG_I, "OVSA: Verify Input Certificate\n");
-
-    if ((!size) || (size > MAX_CERT_SIZE)) {
-        OVSA_DBG(DBG_E, "OVSA: Error customer certificate length is invalid \n");
-        ret = OVSA_INVALID_PARAMETER;
-        goto out;
-    }
-    ret = ovsa_crypto_extract_pubkey_verify_cert(/*PEER Cert*/ true, cert_buff,
-                                                 /* lifetime_validity_check */ true, &peer_slot);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error verify customer certificate failed with code %d\n", ret);
-        goto out;
-    }
-
     /* Extract ISV certificate from key slot */
-    ret = ovsa_crypto_get_certificate(asymm_keyslot, &isv_certificate);
+    ret = ovsa_crypto_get_certificate(ctx->asymm_keyslot, &ctx->isv_certificate);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error extract ISV certificate failed with error code %d\n", ret);
         goto out;
     }
 
     /* Verify ISV certificate */
-    size_t certlen = 0;
-    ret            = ovsa_get_string_length(isv_certificate, &certlen);
+    ret = ovsa_get_string_length(ctx->isv_certificate, &certlen);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error could not get length of ISV certificate %d\n", ret);
         goto out;
@@ -531,7 +364,8 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
         ret = OVSA_INVALID_PARAMETER;
         goto out;
     }
-    ret = ovsa_crypto_verify_certificate(asymm_keyslot, /*PEER Cert*/ false, isv_certificate,
+    ret = ovsa_crypto_verify_certificate(ctx->asymm_keyslot, /*PEER Cert*/ false,
+                                         ctx->isv_certificate,
                                          /* lifetime_validity_check */ true);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error verify certificate failed with code %d\n", ret);
@@ -539,27 +373,24 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
     }
 
     /* Verify License config file */
-    ret = ovsa_verify_artefacts(asymm_keyslot, lic_cnf_file, SIGN_VERIFY, &lic_cnf_sig_buf);
+    ret = ovsa_verify_artefacts(ctx->asymm_keyslot, lic_cnf_file, SIGN_VERIFY, &lic_cnf_sig_buf);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error verify certificate failed with code %d\n", ret);
         goto out;
     }
 
     /* Verify Master License config file */
-    ret = ovsa_verify_artefacts(asymm_keyslot, masterlic_file, HMAC_VERIFY, &master_lic_sig_buf);
+    ret = ovsa_verify_artefacts(ctx->asymm_keyslot, masterlic_file, HMAC_VERIFY,
+                                &master_lic_sig_buf);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error verify certificate failed with code %d\n", ret);
         goto out;
     }
 
-    ovsa_tcb_sig_list_t* tcb_cur_list  = NULL;
-    ovsa_tcb_sig_list_t* tcb_tail_list = NULL;
-    ovsa_input_files_t* tcb_file       = tcb_list_head;
-    file_count                         = 0;
-    tcb_signature_size                 = 0;
     while (tcb_file != NULL) {
         /* Verify TCB Signature file */
-        ret = ovsa_verify_artefacts(asymm_keyslot, tcb_file->name, SIGN_VERIFY, &tcb_sig_buf);
+        ret = ovsa_verify_artefacts(ctx->asymm_keyslot, tcb_file->name, SIGN_VERIFY,
+                                    &tcb_sig_buf);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error verify certificate failed with code %d\n", ret);
             goto out;
@@ -576,8 +407,9 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
                 OVSA_DBG(DBG_E, "OVSA: Error init encoded list failed %d\n", ret);
                 goto out;
             }
-            tcb_list->next = NULL;
-            tcb_tail_list  = tcb_list;
+            tcb_list->next           = NULL;
+            tcb_tail_list            = tcb_list;
+            cust_lic->tcb_signatures = tcb_list;
         } else {
             ret = ovsa_safe_malloc(sizeof(ovsa_tcb_sig_list_t), (char**)&tcb_cur_list);
             if (ret < OVSA_OK || tcb_cur_list == NULL) {
@@ -600,10 +432,9 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
         ovsa_safe_free(&tcb_sig_buf);
         tcb_sig_buf = NULL;
     }
-    customer_license.customer_lic.tcb_signatures = tcb_list;
     /* Extract License config */
     OVSA_DBG(DBG_I, "OVSA: Extract License Config\n");
-    ret = ovsa_json_extract_license_config(lic_cnf_sig_buf, &lic_conf_sig);
+    ret = ovsa_json_extract_license_config(lic_cnf_sig_buf, &ctx->lic_conf_sig);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error extract license config failed with error code %d\n", ret);
         goto out;
@@ -611,21 +442,21 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
 
     /* Extract Master license */
     OVSA_DBG(DBG_I, "OVSA: Extract Master License\n");
-    ret = ovsa_json_extract_master_license(master_lic_sig_buf, &master_lic_sig);
+    ret = ovsa_json_extract_master_license(master_lic_sig_buf, &ctx->master_lic_sig);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error extract master license failed with error code %d\n", ret);
         goto out;
     }
 
-    int req_lic_days = lic_conf_sig.lic_config.time_limit;
-    if (req_lic_days > 0) {
+    ctx->req_lic_days = ctx->lic_conf_sig.lic_config.time_limit;
+    if (ctx->req_lic_days > 0) {
         /*
          * Validate Master License
          * Step #1: Check Model encryption time has not expired
          * Step #2: Requested license duration should not exceed license validity
          */
-        ret = ovsa_check_is_master_license_expired(master_lic_sig.master_lic.creation_date,
-                                                   req_lic_days);
+        ret = ovsa_check_is_master_license_expired(ctx->master_lic_sig.master_lic.creation_date,
+                                                   ctx->req_lic_days);
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error master license time check failed with error code %d\n",
                      ret);
@@ -633,99 +464,162 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
         }
         /*
          * Step #3: ISV & Customer cert + Requested license duration should not exceed license
-         * validity
+         * validity, the customer certificates are checked as their licenses are issued
          */
-        ret = ovsa_check_cert_validity(isv_certificate, cert_buff, req_lic_days);
+        ret = ovsa_get_license_end_time(ctx->req_lic_days, &ctx->lic_end_time);
+        if (ret == OVSA_OK) {
+            ret = ovsa_check_cert_validity(ctx->isv_certificate, "ISV", ctx->req_lic_days,
+                                           ctx->lic_end_time);
+        }
         if (ret < OVSA_OK) {
             OVSA_DBG(DBG_E, "OVSA: Error master license validity check failed with error code %d\n",
                      ret);
             goto out;
         }
-        OVSA_DBG(DBG_I, "OVSA: Approved Model license duration is %d days\n", req_lic_days);
+        OVSA_DBG(DBG_I, "OVSA: Approved Model license duration is %d days\n", ctx->req_lic_days);
     }
 
-    /* Rewrap Key */
-    OVSA_DBG(DBG_I, "OVSA: Rewrap encryption key with customer certificate\n");
-    ret = ovsa_crypto_rewrap_key(asymm_keyslot, peer_slot, master_lic_sig.master_lic.encryption_key,
-                                 strnlen_s(master_lic_sig.master_lic.encryption_key, MAX_EKEY_SIZE),
-                                 &enc_key, &outlen, &keyiv_hmac_slot);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error master license wrapkey failed with error code %d\n", ret);
-        goto out;
-    }
-    memcpy_s(customer_license.customer_lic.encryption_key, MAX_EKEY_SIZE, enc_key,
-             strnlen_s(enc_key, MAX_EKEY_SIZE));
-
     /* Set creation date and time */
     time_str           = ctime(&today);
     size               = strnlen_s(time_str, MAX_NAME_SIZE);
     time_str[size - 1] = '\0';
-    memcpy_s(customer_license.customer_lic.creation_date, MAX_NAME_SIZE, time_str, size);
+    memcpy_s(cust_lic->creation_date, MAX_NAME_SIZE, time_str, size);
 
     /* Set all values of Customer License from master license */
-    ret = ovsa_get_string_length(master_lic_sig.master_lic.isv_certificate, &cert_size);
+    ret = ovsa_get_string_length(ctx->master_lic_sig.master_lic.isv_certificate, &cert_size);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error could not get length of isv_certificate string %d\n", ret);
         goto out;
     }
-    ret = ovsa_safe_malloc(cert_size + 1, &customer_license.customer_lic.isv_certificate);
-    if (ret < OVSA_OK || customer_license.customer_lic.isv_certificate == NULL) {
+    ret = ovsa_safe_malloc(cert_size + 1, &cust_lic->isv_certificate);
+    if (ret < OVSA_OK || cust_lic->isv_certificate == NULL) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error customer license isv certificate allocation failed with code %d\n",
                  ret);
         goto out;
     }
-    memcpy_s(customer_license.customer_lic.isv_certificate, cert_size,
-             master_lic_sig.master_lic.isv_certificate, cert_size);
-    customer_license.customer_lic.isv_certificate[cert_size] = '\0';
-    memcpy_s(customer_license.customer_lic.model_hash, HASH_SIZE,
-             master_lic_sig.master_lic.model_hash,
-             strnlen_s(master_lic_sig.master_lic.model_hash, HASH_SIZE));
-    memcpy_s(customer_license.customer_lic.model_guid, GUID_SIZE,
-             master_lic_sig.master_lic.model_guid,
-             strnlen_s(master_lic_sig.master_lic.model_guid, GUID_SIZE));
-    memcpy_s(customer_license.customer_lic.license_guid, GUID_SIZE,
-             master_lic_sig.master_lic.license_guid,
-             strnlen_s(master_lic_sig.master_lic.license_guid, GUID_SIZE));
+    memcpy_s(cust_lic->isv_certificate, cert_size, ctx->master_lic_sig.master_lic.isv_certificate,
+             cert_size);
+    cust_lic->isv_certificate[cert_size] = '\0';
+    memcpy_s(cust_lic->model_hash, HASH_SIZE, ctx->master_lic_sig.master_lic.model_hash,
+             strnlen_s(ctx->master_lic_sig.master_lic.model_hash, HASH_SIZE));
+    memcpy_s(cust_lic->model_guid, GUID_SIZE, ctx->master_lic_sig.master_lic.model_guid,
+             strnlen_s(ctx->master_lic_sig.master_lic.model_guid, GUID_SIZE));
+    memcpy_s(cust_lic->license_guid, GUID_SIZE, ctx->master_lic_sig.master_lic.license_guid,
+             strnlen_s(ctx->master_lic_sig.master_lic.license_guid, GUID_SIZE));
 
     /* Set all values of Customer License from license config */
-    memcpy_s(customer_license.customer_lic.license_name, MAX_NAME_SIZE,
-             lic_conf_sig.lic_config.license_name,
-             strnlen_s(lic_conf_sig.lic_config.license_name, MAX_NAME_SIZE));
-    memcpy_s(customer_license.customer_lic.license_version, MAX_VERSION_SIZE,
-             lic_conf_sig.lic_config.license_version,
-             strnlen_s(lic_conf_sig.lic_config.license_version, MAX_VERSION_SIZE));
-    customer_license.customer_lic.license_type     = lic_conf_sig.lic_config.license_type;
-    customer_license.customer_lic.usage_count      = lic_conf_sig.lic_config.usage_count;
-    customer_license.customer_lic.time_limit       = lic_conf_sig.lic_config.time_limit;
-    customer_license.customer_lic.license_url_list = lic_conf_sig.lic_config.license_url_list;
+    memcpy_s(cust_lic->license_name, MAX_NAME_SIZE, ctx->lic_conf_sig.lic_config.license_name,
+             strnlen_s(ctx->lic_conf_sig.lic_config.license_name, MAX_NAME_SIZE));
+    memcpy_s(cust_lic->license_version, MAX_VERSION_SIZE,
+             ctx->lic_conf_sig.lic_config.license_version,
+             strnlen_s(ctx->lic_conf_sig.lic_config.license_version, MAX_VERSION_SIZE));
+    cust_lic->license_type     = ctx->lic_conf_sig.lic_config.license_type;
+    cust_lic->usage_count      = ctx->lic_conf_sig.lic_config.usage_count;
+    cust_lic->time_limit       = ctx->lic_conf_sig.lic_config.time_limit;
+    cust_lic->license_url_list = ctx->lic_conf_sig.lic_config.license_url_list;
 
     /* Find the file count for license URL */
-    url_file_count = ovsa_get_list_file_count(lic_conf_sig.lic_config.license_url_list);
+    url_file_count = ovsa_get_list_file_count(ctx->lic_conf_sig.lic_config.license_url_list);
 
-    /* Create customer license JSON blob */
-    OVSA_DBG(DBG_I, "OVSA: Create Customer License blob\n");
-    cust_lic_size =
+    ctx->cust_lic_size =
         sizeof(ovsa_customer_license_t) + (cert_size + 1) + CUSTOMER_LICENSE_BLOB_TEXT_SIZE +
         (file_count * TCB_NAME_BLOB_TEXT_SIZE) + tcb_signature_size +
         (url_file_count * (LICENSE_URL_BLOB_TEXT_SIZE + sizeof(ovsa_license_serv_url_list_t)));
 
-    ret = ovsa_safe_malloc(cust_lic_size, &customer_lic_string);
-    if (ret < OVSA_OK || customer_lic_string == NULL) {
-        OVSA_DBG(DBG_E, "OVSA: Error customer license buffer allocation failed with code %d\n",
-                 ret);
-        goto out;
-    }
-    ret = ovsa_json_create_customer_license(&customer_license, cust_lic_size, customer_lic_string);
-    if (ret < OVSA_OK) {
-        OVSA_DBG(DBG_E, "OVSA: Error create customer license failed with error code %d\n", ret);
-        goto out;
-    }
-
-    /* Sign customer license JSON blob */
-    OVSA_DBG(DBG_I, "OVSA: Sign Customer License JSON blob\n");
-    size = MAX_SIGNATURE_SIZE + SIGNATURE_BLOB_TEXT_SIZE + cust_lic_size;
-    ret  = ovsa_safe_malloc(size, &customer_lic_sig_string);
+out:
+    ovsa_safe_free(&lic_cnf_sig_buf);
+    ovsa_safe_free(&master_lic_sig_buf);
+    ovsa_safe_free(&tcb_sig_buf);
+    return ret;
+}
+
+/* Issues the customer license of a certificate, called from the sale threads */
+static ovsa_status_t ovsa_sale_issue_license(const ovsa_sale_ctx_t* ctx,
+                                             const char* customer_cert_file,
+                                             const char* license_guid, char** lic_sig_string) {
+    ovsa_status_t ret             = OVSA_OK;
+    int peer_slot                 = -1;
+    int keyiv_hmac_slot           = -1;
+    size_t size                   = 0;
+    size_t outlen                 = 0;
+    char* cert_buff               = NULL;
+    char* enc_key                 = NULL;
+    char* customer_lic_string     = NULL;
+    char* customer_lic_sig_string = NULL;
+    ovsa_customer_license_sig_t customer_license;
+
+    memcpy_s(&customer_license, sizeof(ovsa_customer_license_sig_t), &ctx->customer_license,
+             sizeof(ovsa_customer_license_sig_t));
+
+    /* Read certficate from on disk file */
+    ret = ovsa_read_file_content(customer_cert_file, &cert_buff, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading certificate file %s failed with code %d\n",
+                 customer_cert_file, ret);
+        goto out;
+    }
+
+    OVSA_DBG(DBG_I, "OVSA: Verify Input Certificate %s\n", customer_cert_file);
+
+    if ((!size) || (size > MAX_CERT_SIZE)) {
+        OVSA_DBG(DBG_E, "OVSA: Error customer certificate length is invalid \n");
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    ret = ovsa_crypto_extract_pubkey_verify_cert(/*PEER Cert*/ true, cert_buff,
+                                                 /* lifetime_validity_check */ true, &peer_slot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error verify customer certificate failed with code %d\n", ret);
+        goto out;
+    }
+
+    if (ctx->req_lic_days > 0) {
+        ret = ovsa_check_cert_validity(cert_buff, "Customer", ctx->req_lic_days,
+                                       ctx->lic_end_time);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error master license validity check failed with error code %d\n",
+                     ret);
+            goto out;
+        }
+    }
+
+    /* Rewrap Key */
+    OVSA_DBG(DBG_I, "OVSA: Rewrap encryption key with customer certificate\n");
+    ret = ovsa_crypto_rewrap_key(
+        ctx->asymm_keyslot, peer_slot, ctx->master_lic_sig.master_lic.encryption_key,
+        strnlen_s(ctx->master_lic_sig.master_lic.encryption_key, MAX_EKEY_SIZE), &enc_key,
+        &outlen, &keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error master license wrapkey failed with error code %d\n", ret);
+        goto out;
+    }
+    memcpy_s(customer_license.customer_lic.encryption_key, MAX_EKEY_SIZE, enc_key,
+             strnlen_s(enc_key, MAX_EKEY_SIZE));
+    if (license_guid != NULL) {
+        memcpy_s(customer_license.customer_lic.license_guid, GUID_SIZE, license_guid,
+                 strnlen_s(license_guid, GUID_SIZE));
+    }
+
+    /* Create customer license JSON blob */
+    OVSA_DBG(DBG_I, "OVSA: Create Customer License blob\n");
+    ret = ovsa_safe_malloc(ctx->cust_lic_size, &customer_lic_string);
+    if (ret < OVSA_OK || customer_lic_string == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error customer license buffer allocation failed with code %d\n",
+                 ret);
+        goto out;
+    }
+    ret = ovsa_json_create_customer_license(&customer_license, ctx->cust_lic_size,
+                                            customer_lic_string);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error create customer license failed with error code %d\n", ret);
+        goto out;
+    }
+
+    /* Sign customer license JSON blob */
+    OVSA_DBG(DBG_I, "OVSA: Sign Customer License JSON blob\n");
+    size = MAX_SIGNATURE_SIZE + SIGNATURE_BLOB_TEXT_SIZE + ctx->cust_lic_size;
+    ret  = ovsa_safe_malloc(size, &customer_lic_sig_string);
     if (ret < OVSA_OK || customer_lic_sig_string == NULL) {
         OVSA_DBG(DBG_E,
                  "OVSA: Error customer license signature buffer allocation failed with code %d\n",
@@ -734,54 +628,662 @@ ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
     }
 
     /* Computes HMAC for customer license */
-    ret = ovsa_crypto_hmac_json_blob(keyiv_hmac_slot, customer_lic_string, cust_lic_size,
+    ret = ovsa_crypto_hmac_json_blob(keyiv_hmac_slot, customer_lic_string, ctx->cust_lic_size,
                                      customer_lic_sig_string, size);
     if (ret < OVSA_OK) {
         OVSA_DBG(DBG_E, "OVSA: Error customer license signing failed with error code %d\n", ret);
         goto out;
     }
+    *lic_sig_string         = customer_lic_sig_string;
+    customer_lic_sig_string = NULL;
+
+out:
+    /* Clear key/IV/HMAC and the customer public key from the key slots */
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    ovsa_crypto_clear_asymmetric_key_slot(peer_slot);
+    ovsa_safe_free(&cert_buff);
+    ovsa_safe_free(&enc_key);
+    ovsa_safe_free(&customer_lic_string);
+    ovsa_safe_free(&customer_lic_sig_string);
+    return ret;
+}
+
+static ovsa_status_t ovsa_sale_store_license(const char* customer_lic_file,
+                                             const char* customer_lic_sig_string) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t size       = 0;
+    FILE* fptr        = NULL;
 
     /* Store customer license JSON blob on specified output file */
     OVSA_DBG(DBG_I, "OVSA: Store Customer License JSON blob\n");
-    if (customer_lic_sig_string != NULL) {
-        if ((fptr = fopen(customer_lic_file, "w+")) != NULL) {
-            ret = ovsa_get_string_length(customer_lic_sig_string, &size);
-            if (ret < OVSA_OK) {
-                OVSA_DBG(DBG_E, "OVSA: Error could not get length of signature string %d\n", ret);
-                fclose(fptr);
+    if ((fptr = fopen(customer_lic_file, "w+")) != NULL) {
+        ret = ovsa_get_string_length(customer_lic_sig_string, &size);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not get length of signature string %d\n", ret);
+            fclose(fptr);
+            return ret;
+        }
+        fwrite(customer_lic_sig_string, size, 1, fptr);
+        fclose(fptr);
+        OVSA_DBG(DBG_I, "OVSA: Customer license file %s generated successfully\n",
+                 customer_lic_file);
+    } else {
+        ret = OVSA_FILEOPEN_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error create file %s failed with error code %d\n",
+                 customer_lic_file, ret);
+    }
+    return ret;
+}
+
+static ovsa_status_t ovsa_sale_set_manifest_field(char* field, size_t max_len, char* value) {
+    if (strnlen_s(value, RSIZE_MAX_STR) >= max_len) {
+        OVSA_DBG(DBG_E, "OVSA: Error manifest field %s greater than %zu characters not allowed\n",
+                 value, max_len - 1);
+        return OVSA_INVALID_PARAMETER;
+    }
+    memcpy_s(field, max_len, value, strnlen_s(value, max_len));
+    return OVSA_OK;
+}
+
+/*
+ * The manifest has one customer per line, its certificate, the customer license to generate and
+ * optionally its secondary certificate and the license GUID replacing the one of the master
+ * license. Blank lines and lines starting with '#' are skipped.
+ */
+static ovsa_status_t ovsa_sale_read_manifest(const char* manifest_file,
+                                             ovsa_sale_entry_t** entries, int* entry_count) {
+    ovsa_status_t ret        = OVSA_OK;
+    char* manifest           = NULL;
+    char* line               = NULL;
+    char* line_ctx           = NULL;
+    char* field_ctx          = NULL;
+    char* fields[5]          = {NULL};
+    ovsa_sale_entry_t* entry = NULL;
+    size_t size              = 0;
+    size_t i                 = 0;
+    int field_count          = 0;
+    int max_count            = 1;
+
+    ret = ovsa_read_file_content(manifest_file, &manifest, &size);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error reading manifest file %s failed with code %d\n",
+                 manifest_file, ret);
+        goto out;
+    }
+    for (i = 0; i < size; i++) {
+        if (manifest[i] == '\n') {
+            max_count++;
+        }
+    }
+    ret = ovsa_safe_malloc(max_count * sizeof(ovsa_sale_entry_t), (char**)entries);
+    if (ret < OVSA_OK || *entries == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error manifest entries allocation failed with code %d\n", ret);
+        goto out;
+    }
+
+    *entry_count = 0;
+    for (line = strtok_r(manifest, "\n", &line_ctx); line != NULL;
+         line = strtok_r(NULL, "\n", &line_ctx)) {
+        field_count = 0;
+        fields[0]   = strtok_r(line, " \t\r", &field_ctx);
+        while ((fields[field_count] != NULL) && (field_count < 4)) {
+            fields[++field_count] = strtok_r(NULL, " \t\r", &field_ctx);
+        }
+        if ((field_count == 0) || (fields[0][0] == '#')) {
+            continue;
+        }
+        if ((field_count < 2) || (fields[field_count] != NULL)) {
+            OVSA_DBG(DBG_E, "OVSA: Error manifest entry of %s is invalid\n", fields[0]);
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
+
+        entry = &(*entries)[*entry_count];
+        ret   = ovsa_sale_set_manifest_field(entry->cert_file, MAX_FILE_NAME, fields[0]);
+        if (ret == OVSA_OK) {
+            ret = ovsa_sale_set_manifest_field(entry->lic_file, MAX_FILE_NAME, fields[1]);
+        }
+        if ((ret == OVSA_OK) && (field_count > 2)) {
+            ret = ovsa_sale_set_manifest_field(entry->secondary_cert_file, MAX_FILE_NAME,
+                                               fields[2]);
+        }
+        if ((ret == OVSA_OK) && (field_count > 3)) {
+            if ((strnlen_s(fields[3], RSIZE_MAX_STR) != GUID_SIZE) ||
+                (ovsa_is_guid_valid((unsigned char*)fields[3]) != true)) {
+                OVSA_DBG(DBG_E, "OVSA: Error license GUID of %s is not valid...\n", fields[0]);
+                ret = OVSA_INVALID_PARAMETER;
+            } else {
+                ret = ovsa_sale_set_manifest_field(entry->license_guid, sizeof(GUID), fields[3]);
+            }
+        }
+        if (ret < OVSA_OK) {
+            goto out;
+        }
+        (*entry_count)++;
+    }
+    if (*entry_count == 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error manifest file %s has no customers\n", manifest_file);
+        ret = OVSA_INVALID_PARAMETER;
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA: Manifest %s lists %d customers\n", manifest_file, *entry_count);
+
+out:
+    if ((ret < OVSA_OK) && (*entries != NULL)) {
+        free(*entries);
+        *entries = NULL;
+    }
+    ovsa_safe_free(&manifest);
+    return ret;
+}
+
+static void* ovsa_sale_worker(void* arg) {
+    ovsa_sale_pool_t* pool   = (ovsa_sale_pool_t*)arg;
+    ovsa_sale_entry_t* entry = NULL;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next_entry >= pool->entry_count) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        entry = &pool->entries[pool->next_entry++];
+        pthread_mutex_unlock(&pool->lock);
+
+        /* A customer failing does not hold back the licenses of the others */
+        entry->ret = ovsa_sale_issue_license(pool->ctx, entry->cert_file, entry->license_guid,
+                                             &entry->lic_sig_string);
+        if (entry->ret == OVSA_OK) {
+            entry->ret = ovsa_sale_store_license(entry->lic_file, entry->lic_sig_string);
+        }
+        if (entry->ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error customer license %s failed with code %d\n",
+                     entry->lic_file, entry->ret);
+        }
+        if ((entry->ret < OVSA_OK) || !pool->keep_licenses) {
+            ovsa_safe_free(&entry->lic_sig_string);
+        }
+    }
+    return NULL;
+}
+
+/* The DB rows are keyed by license and model GUID, each customer needs a license GUID of its own */
+static ovsa_status_t ovsa_sale_check_db_entries(const ovsa_sale_entry_t* entries,
+                                                int entry_count) {
+    int indicator = -1;
+    int i         = 0;
+    int j         = 0;
+
+    for (i = 0; i < entry_count; i++) {
+        if (entries[i].secondary_cert_file[0] == '\0') {
+            OVSA_DBG(DBG_E, "OVSA: Error manifest entry of %s has no secondary certificate\n",
+                     entries[i].cert_file);
+            return OVSA_INVALID_PARAMETER;
+        }
+        for (j = i + 1; j < entry_count; j++) {
+            strcmp_s(entries[i].license_guid, GUID_SIZE, entries[j].license_guid, &indicator);
+            if (indicator == 0) {
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error license GUID %s is used by more than one customer of the "
+                         "manifest\n",
+                         entries[i].license_guid);
+                return OVSA_INVALID_PARAMETER;
+            }
+        }
+    }
+    return OVSA_OK;
+}
+
+/* Writes a string as an SQL literal, its quotes doubled */
+static void ovsa_sale_write_sql_string(FILE* fptr, const char* str) {
+    fputc('\'', fptr);
+    for (; *str != '\0'; str++) {
+        if (*str == '\'') {
+            fputc('\'', fptr);
+        }
+        fputc(*str, fptr);
+    }
+    fputc('\'', fptr);
+}
+
+/*
+ * Writes the customer_license_info rows of the issued licenses as one transaction, to be applied
+ * with sqlite3 <DB file> < <SQL file>. The rows are those DB/ovsa_store_customer_lic_cert_db.py
+ * stores for a license, a license already in the DB gets its certificates and blob updated.
+ */
+static ovsa_status_t ovsa_sale_store_db_rows(const char* db_file, const ovsa_sale_ctx_t* ctx,
+                                             const ovsa_sale_entry_t* entries, int entry_count) {
+    const ovsa_customer_license_t* cust_lic = &ctx->customer_license.customer_lic;
+    ovsa_status_t ret                       = OVSA_OK;
+    char* primary_cert                      = NULL;
+    char* secondary_cert                    = NULL;
+    FILE* fptr                              = NULL;
+    size_t size                             = 0;
+    int limit_count                         = cust_lic->usage_count + cust_lic->time_limit;
+    int i                                   = 0;
+
+    fptr = fopen(db_file, "w");
+    if (fptr == NULL) {
+        ret = OVSA_FILEOPEN_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error create file %s failed with error code %d\n", db_file, ret);
+        goto out;
+    }
+
+    fputs("BEGIN TRANSACTION;\n", fptr);
+    fputs("CREATE TEMP TABLE ovsa_sale (license_guid text, customer_primary_certificate text, "
+          "customer_secondary_certificate text, customer_license_blob text);\n",
+          fptr);
+    for (i = 0; i < entry_count; i++) {
+        if (entries[i].ret < OVSA_OK) {
+            continue;
+        }
+        ret = ovsa_read_file_content(entries[i].cert_file, &primary_cert, &size);
+        if (ret == OVSA_OK) {
+            ret = ovsa_read_file_content(entries[i].secondary_cert_file, &secondary_cert, &size);
+        }
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error reading certificates of %s failed with code %d\n",
+                     entries[i].cert_file, ret);
+            goto out;
+        }
+        fputs("INSERT INTO ovsa_sale VALUES (", fptr);
+        ovsa_sale_write_sql_string(fptr, entries[i].license_guid);
+        fputs(", ", fptr);
+        ovsa_sale_write_sql_string(fptr, primary_cert);
+        fputs(", ", fptr);
+        ovsa_sale_write_sql_string(fptr, secondary_cert);
+        fputs(", ", fptr);
+        ovsa_sale_write_sql_string(fptr, entries[i].lic_sig_string);
+        fputs(");\n", fptr);
+        ovsa_safe_free(&primary_cert);
+        ovsa_safe_free(&secondary_cert);
+    }
+
+    fputs("UPDATE customer_license_info SET isv_certificate = ", fptr);
+    ovsa_sale_write_sql_string(fptr, cust_lic->isv_certificate);
+    fputs(", customer_primary_certificate = (SELECT customer_primary_certificate FROM ovsa_sale s "
+          "WHERE s.license_guid = customer_license_info.license_guid), "
+          "customer_secondary_certificate = (SELECT customer_secondary_certificate FROM ovsa_sale "
+          "s WHERE s.license_guid = customer_license_info.license_guid), customer_license_blob = "
+          "(SELECT customer_license_blob FROM ovsa_sale s WHERE s.license_guid = "
+          "customer_license_info.license_guid), updated_date = STRFTIME('%Y-%m-%d %H:%M:%f', "
+          "'NOW') WHERE license_guid IN (SELECT license_guid FROM ovsa_sale) AND model_guid = ",
+          fptr);
+    ovsa_sale_write_sql_string(fptr, cust_lic->model_guid);
+    fputs(";\n", fptr);
+
+    fputs("INSERT INTO customer_license_info (license_guid, model_guid, isv_certificate, "
+          "customer_primary_certificate, customer_secondary_certificate, customer_license_blob, "
+          "license_type, limit_count, usage_count, time_limit, created_date, updated_date) SELECT "
+          "s.license_guid, ",
+          fptr);
+    ovsa_sale_write_sql_string(fptr, cust_lic->model_guid);
+    fputs(", ", fptr);
+    ovsa_sale_write_sql_string(fptr, cust_lic->isv_certificate);
+    fprintf(fptr,
+            ", s.customer_primary_certificate, s.customer_secondary_certificate, "
+            "s.customer_license_blob, %d, %d, %d, ",
+            cust_lic->license_type, limit_count,
+            (cust_lic->license_type == INSTANCELIMIT) ? limit_count : 0);
+    if (cust_lic->license_type == TIMELIMIT) {
+        fprintf(fptr, "STRFTIME('%%Y-%%m-%%d %%H:%%M:%%f', 'NOW', 'localtime', '+%d days')",
+                limit_count);
+    } else {
+        fputs("0", fptr);
+    }
+    fputs(", STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW', 'localtime'), STRFTIME('%Y-%m-%d %H:%M:%f', "
+          "'NOW', 'localtime') FROM ovsa_sale s WHERE NOT EXISTS (SELECT 1 FROM "
+          "customer_license_info c WHERE c.license_guid = s.license_guid AND c.model_guid = ",
+          fptr);
+    ovsa_sale_write_sql_string(fptr, cust_lic->model_guid);
+    fputs(");\n", fptr);
+    fputs("DROP TABLE ovsa_sale;\n", fptr);
+    fputs("COMMIT;\n", fptr);
+
+    if (ferror(fptr)) {
+        ret = OVSA_FILEIO_FAIL;
+        OVSA_DBG(DBG_E, "OVSA: Error writing file %s failed with error code %d\n", db_file, ret);
+        goto out;
+    }
+    OVSA_DBG(DBG_I, "OVSA: Customer license DB rows %s generated successfully\n", db_file);
+
+out:
+    if (fptr != NULL) {
+        if ((fclose(fptr) != 0) && (ret == OVSA_OK)) {
+            ret = OVSA_FILEIO_FAIL;
+            OVSA_DBG(DBG_E, "OVSA: Error writing file %s failed with error code %d\n", db_file,
+                     ret);
+        }
+    }
+    ovsa_safe_free(&primary_cert);
+    ovsa_safe_free(&secondary_cert);
+    return ret;
+}
+
+/* Issues the licenses of a manifest, the calling thread is one of the sale threads */
+static ovsa_status_t ovsa_sale_issue_licenses(const ovsa_sale_ctx_t* ctx,
+                                              ovsa_sale_entry_t* entries, int entry_count,
+                                              int sale_threads, const char* db_file) {
+    ovsa_status_t ret = OVSA_OK;
+    int thread_count  = 0;
+    int issued        = 0;
+    int i             = 0;
+    pthread_t threads[MAX_SALE_THREADS];
+    ovsa_sale_pool_t pool;
+
+    memset_s(&pool, sizeof(ovsa_sale_pool_t), 0);
+    pool.ctx           = ctx;
+    pool.entries       = entries;
+    pool.entry_count   = entry_count;
+    pool.keep_licenses = (db_file != NULL);
+    if (pthread_mutex_init(&pool.lock, NULL) != 0) {
+        OVSA_DBG(DBG_E, "OVSA: Error initializing the sale mutex failed\n");
+        return OVSA_MUTEX_INIT_FAIL;
+    }
+    thread_count = sale_threads;
+    if (thread_count > MAX_SALE_THREADS) {
+        thread_count = MAX_SALE_THREADS;
+    }
+    for (i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&threads[i], NULL, ovsa_sale_worker, &pool) != 0) {
+            break;
+        }
+    }
+    thread_count = i;
+    OVSA_DBG(DBG_D, "OVSA: Issuing customer licenses on %d threads\n", thread_count + 1);
+    ovsa_sale_worker(&pool);
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    for (i = 0; i < entry_count; i++) {
+        if (entries[i].ret == OVSA_OK) {
+            issued++;
+        } else if (ret == OVSA_OK) {
+            ret = entries[i].ret;
+        }
+    }
+    OVSA_DBG(DBG_I, "OVSA: %d of %d customer licenses generated successfully\n", issued,
+             entry_count);
+
+    /* The rows of the licenses issued are stored even if some customers failed */
+    if ((db_file != NULL) && (issued > 0)) {
+        ovsa_status_t db_ret = ovsa_sale_store_db_rows(db_file, ctx, entries, entry_count);
+        if (ret == OVSA_OK) {
+            ret = db_ret;
+        }
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_sale_main(int argc, char* argv[]) {
+    ovsa_status_t ret                 = OVSA_OK;
+    int c                             = 0;
+    int i                             = 0;
+    int sale_threads                  = 1;
+    int entry_count                   = 0;
+    size_t argv_len                   = 0;
+    bool customer_args                = false;
+    ovsa_input_files_t* tcb_list_head = NULL;
+    ovsa_input_files_t* tcb_list_tail = NULL;
+    ovsa_sale_entry_t* entries        = NULL;
+    char* keystore                    = NULL;
+    char* lic_cnf_file                = NULL;
+    char* customer_cert_file          = NULL;
+    char* customer_lic_file           = NULL;
+    char* masterlic_file              = NULL;
+    char* manifest_file               = NULL;
+    char* db_file                     = NULL;
+    char* customer_lic_sig_string     = NULL;
+    ovsa_sale_ctx_t ctx;
+
+    memset_s(&ctx, sizeof(ovsa_sale_ctx_t), 0);
+    ctx.asymm_keyslot = -1;
+
+    OVSA_DBG(DBG_D, "%s entry\n", __func__);
+
+    if (argc > MAX_SAFE_ARGC) {
+        ret = OVSA_INVALID_PARAMETER;
+        OVSA_DBG(DBG_E, "OVSA: Error wrong command given. Please follow -help for help option\n");
+        goto out;
+    }
+    for (i = 0; argc > i; i++) {
+        ret = ovsa_get_string_length(argv[i], &argv_len);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not get length of argv string %d\n", ret);
+            goto out;
+        }
+        if (argv_len > RSIZE_MAX_STR) {
+            OVSA_DBG(DBG_E,
+                     "OVSA: Error sale argument'%s' greater than %ld characters not allowed \n",
+                     argv[i], RSIZE_MAX_STR);
+            ret = OVSA_INVALID_PARAMETER;
+            goto out;
+        }
+    }
+
+    while ((c = getopt(argc, argv, "m:k:l:t:p:c:b:j:d:h")) != -1) {
+        switch (c) {
+            case 'm': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(
+                        DBG_E,
+                        "OVSA: Master license file path greater than %d characters not allowed \n",
+                        MAX_FILE_NAME);
+                    ret = OVSA_INVALID_FILE_PATH;
+                    goto out;
+                }
+                masterlic_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: masterlic_file = %s\n", masterlic_file);
+            } break;
+            case 'k': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error keystore path greater than %d characters not allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_FILE_PATH;
+                    goto out;
+                }
+                keystore = optarg;
+                OVSA_DBG(DBG_D, "OVSA: keystore = %s\n", keystore);
+            } break;
+            case 'l': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(
+                        DBG_E,
+                        "OVSA: License config file path greater than %d characters not allowed \n",
+                        MAX_FILE_NAME);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                lic_cnf_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: lic_cnf_file = %s\n", lic_cnf_file);
+            } break;
+            case 't': {
+                int index;
+                index = optind - 1;
+                while (index < argc) {
+                    if (strnlen_s(argv[index], RSIZE_MAX_STR) < MAX_FILE_NAME) {
+                        if (argv[index][0] != '-') {
+                            ret = ovsa_store_input_file_list(argv[index], &tcb_list_head,
+                                                             &tcb_list_tail);
+                            if (ret < OVSA_OK) {
+                                OVSA_DBG(DBG_E,
+                                         "OVSA: Error store TCB file list failed with code %d\n",
+                                         ret);
+                                goto out;
+                            }
+                            optind = index + 1;
+                        } else {
+                            break;
+                        }
+                        index++;
+                    } else {
+                        OVSA_DBG(DBG_E,
+                                 "OVSA: Error name greater than %d characters not allowed \n",
+                                 MAX_FILE_NAME);
+                        ret = OVSA_INVALID_PARAMETER;
+                        goto out;
+                    }
+                }
+            } break;
+            case 'p': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Customer certificate file path greater than %d characters not "
+                             "allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                customer_cert_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: customer_cert_file = %s\n", customer_cert_file);
+            } break;
+            case 'c': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Customer license file path greater than %d characters not "
+                             "allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                customer_lic_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: customer_lic_file = %s\n", customer_lic_file);
+            } break;
+            case 'b': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Manifest file path greater than %d characters not allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                manifest_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: manifest_file = %s\n", manifest_file);
+            } break;
+            case 'j': {
+                if (isdigit((int)(unsigned char)*optarg)) {
+                    sale_threads = atoi(optarg);
+                    OVSA_DBG(DBG_D, "OVSA: sale_threads = %d\n", sale_threads);
+                    if (sale_threads <= 0) {
+                        OVSA_DBG(DBG_E,
+                                 "OVSA: Number of sale threads should be greater than zero."
+                                 " Please follow -help for help option\n");
+                        ret = OVSA_INVALID_PARAMETER;
+                        goto out;
+                    }
+                } else {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: Error number of sale threads is invalid. Please follow -help "
+                             "for help option\n");
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+            } break;
+            case 'd': {
+                if (strnlen_s(optarg, RSIZE_MAX_STR) > MAX_FILE_NAME) {
+                    OVSA_DBG(DBG_E,
+                             "OVSA: SQL file path greater than %d characters not allowed \n",
+                             MAX_FILE_NAME);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                db_file = optarg;
+                OVSA_DBG(DBG_D, "OVSA: db_file = %s\n", db_file);
+            } break;
+            case 'h': {
+                ovsa_sale_help(argv[0]);
                 goto out;
             }
-            fwrite(customer_lic_sig_string, size, 1, fptr);
-            fclose(fptr);
-            OVSA_DBG(DBG_I, "OVSA: Customer license file %s generated successfully\n",
-                     customer_lic_file);
-        } else {
-            ret = OVSA_FILEOPEN_FAIL;
-            OVSA_DBG(DBG_E, "OVSA: Error create file %s failed with error code %d\n",
-                     customer_lic_file, ret);
+            default: {
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error wrong command given. Please follow -help for help option "
+                         "c = %d\n",
+                         c);
+                ret = OVSA_INVALID_PARAMETER;
+                goto out;
+            }
+        }
+    }
+
+    /* optind is for the extra arguments which are not parsed */
+    for (; optind < argc; optind++) {
+        OVSA_DBG(DBG_I, "extra arguments: %s\n", argv[optind]);
+    }
+
+    /* A manifest comes in place of the customer certificate and license */
+    if (manifest_file != NULL) {
+        customer_args = (customer_cert_file == NULL) && (customer_lic_file == NULL);
+    } else {
+        customer_args = (customer_cert_file != NULL) && (customer_lic_file != NULL);
+    }
+    if ((masterlic_file == NULL) || (keystore == NULL) || (lic_cnf_file == NULL) ||
+        (tcb_list_head == NULL) || !customer_args ||
+        ((db_file != NULL) && (manifest_file == NULL))) {
+        ret = OVSA_INVALID_PARAMETER;
+        OVSA_DBG(DBG_E, "OVSA: Error wrong command given. Please follow -help for help option\n");
+        goto out;
+    }
+
+    /* The manifest is checked before any crypto work is done */
+    if (manifest_file != NULL) {
+        ret = ovsa_sale_read_manifest(manifest_file, &entries, &entry_count);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error read manifest failed with code %d\n", ret);
             goto out;
         }
     }
 
+    /* Initialize crypto */
+    ret = ovsa_crypto_init();
+    if (ret != OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa crypto init failed with code %d\n", ret);
+        goto out;
+    }
+
+    /* The ISV material is verified once for all the customers */
+    ret = ovsa_sale_init_ctx(&ctx, keystore, lic_cnf_file, masterlic_file, tcb_list_head);
+    if (ret < OVSA_OK) {
+        goto out;
+    }
+
+    if (manifest_file == NULL) {
+        ret = ovsa_sale_issue_license(&ctx, customer_cert_file, NULL, &customer_lic_sig_string);
+        if (ret == OVSA_OK) {
+            ret = ovsa_sale_store_license(customer_lic_file, customer_lic_sig_string);
+        }
+        goto out;
+    }
+
+    /* Customers without a license GUID of their own get the one of the master license */
+    for (i = 0; i < entry_count; i++) {
+        if (entries[i].license_guid[0] == '\0') {
+            memcpy_s(entries[i].license_guid, GUID_SIZE,
+                     ctx.customer_license.customer_lic.license_guid, GUID_SIZE);
+        }
+    }
+    if (db_file != NULL) {
+        ret = ovsa_sale_check_db_entries(entries, entry_count);
+        if (ret < OVSA_OK) {
+            goto out;
+        }
+    }
+    ret = ovsa_sale_issue_licenses(&ctx, entries, entry_count, sale_threads, db_file);
+
 out:
     /* De-initialize crypto */
     ovsa_crypto_deinit();
-    ovsa_safe_free(&cert_buff);
-    ovsa_safe_free(&enc_key);
-    ovsa_safe_free(&lic_cnf_sig_buf);
-    ovsa_safe_free(&lic_cnf_buf);
-    ovsa_safe_free(&master_lic_sig_buf);
-    ovsa_safe_free(&master_lic_buf);
-    ovsa_safe_free(&customer_lic_string);
-    ovsa_safe_free(&tcb_sig_buf);
+    ovsa_sale_free_ctx(&ctx);
     ovsa_safe_free(&customer_lic_sig_string);
-    ovsa_safe_free(&isv_certificate);
-    ovsa_safe_free(&customer_license.customer_lic.isv_certificate);
-    ovsa_safe_free(&master_lic_sig.master_lic.isv_certificate);
-    ovsa_safe_free(&lic_conf_sig.lic_config.isv_certificate);
-    ovsa_safe_free_url_list(&customer_license.customer_lic.license_url_list);
+    if (entries != NULL) {
+        for (i = 0; i < entry_count; i++) {
+            ovsa_safe_free(&entries[i].lic_sig_string);
+        }
+        free(entries);
+    }
     ovsa_safe_free_input_list(&tcb_list_head);
-    ovsa_safe_free_tcb_list(&tcb_list);
     OVSA_DBG(DBG_D, "%s exit\n", __func__);
     return ret;
 }
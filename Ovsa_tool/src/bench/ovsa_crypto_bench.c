@@ -0,0 +1,630 @@
+/*
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Microbenchmark of the libovsa crypto primitives. Each primitive is run for a fixed time for
+ * every payload size, from 64 bytes up by powers of 4, and every thread count, from 1 up by
+ * powers of 2. One CSV line is written per measurement so that the results of two builds can be
+ * compared. The OpenSSL code paths are selected at run time, OPENSSL_ia32cap=~0x200000200000000
+ * for instance turns off AES-NI and PCLMULQDQ to compare the generic code with the SIMD one.
+ */
+
+#include <ctype.h>
+#include <getopt.h>
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "asymmetric.h"
+#include "libovsa.h"
+#include "safe_mem_lib.h"
+#include "safe_str_lib.h"
+
+#define MAX_BENCH_THREADS      64
+#define MIN_BENCH_PAYLOAD_SIZE 64ULL
+#define MAX_BENCH_PAYLOAD_SIZE (4ULL * 1024 * 1024 * 1024)
+/* Default payload sizes, up to 16 MB keeps the run short and the memory used low */
+#define DEFAULT_BENCH_MAX_SIZE (16ULL * 1024 * 1024)
+#define DEFAULT_BENCH_TIME_MS  1000
+
+/* Inputs of the primitives for one payload size, shared read-only by the threads */
+typedef struct ovsa_bench_input {
+    char* plain;
+    size_t size;
+    char* encrypted;
+    size_t encrypted_len;
+    char* b64;
+    size_t b64_len;
+    char signature[MAX_SIGNATURE_SIZE];
+} ovsa_bench_input_t;
+
+typedef struct ovsa_bench_ctx {
+    int asym_keyslot;
+    int sym_keyslot;
+    int keyiv_hmac_slot;
+    char* wrapped_key;
+    size_t wrapped_key_len;
+    ovsa_bench_input_t* input;
+    struct timespec deadline;
+} ovsa_bench_ctx_t;
+
+typedef struct ovsa_bench_thread {
+    ovsa_bench_ctx_t* ctx;
+    const struct ovsa_bench_primitive* primitive;
+    /* Output buffer of the base64 decoding */
+    char* scratch;
+    size_t scratch_len;
+    uint64_t ops;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    ovsa_status_t ret;
+} ovsa_bench_thread_t;
+
+typedef ovsa_status_t (*ovsa_bench_op_t)(ovsa_bench_thread_t* thread);
+
+typedef struct ovsa_bench_primitive {
+    const char* name;
+    ovsa_bench_op_t op;
+    /* Run for each payload size, the key wrapping works on the symmetric key only */
+    bool sized;
+    bool asymmetric;
+    bool selected;
+} ovsa_bench_primitive_t;
+
+/*
+ * The output of the primitives is released within the measurement, as it is by their callers.
+ * The keyslots are lock-free, the threads only share the key slots set up beforehand.
+ */
+static ovsa_status_t ovsa_bench_encrypt(ovsa_bench_thread_t* thread) {
+    ovsa_bench_ctx_t* ctx = thread->ctx;
+    char* out_buff        = NULL;
+    size_t out_buff_len   = 0;
+    int keyiv_hmac_slot   = -1;
+    ovsa_status_t ret     = OVSA_OK;
+
+    ret = ovsa_crypto_encrypt_mem(ctx->sym_keyslot, ctx->input->plain, ctx->input->size, NULL,
+                                  &out_buff, &out_buff_len, &keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    OPENSSL_free(out_buff);
+    return ret;
+}
+
+static ovsa_status_t ovsa_bench_decrypt(ovsa_bench_thread_t* thread) {
+    ovsa_bench_ctx_t* ctx = thread->ctx;
+    char* out_buff        = NULL;
+    size_t out_buff_len   = 0;
+    int keyiv_hmac_slot   = -1;
+    ovsa_status_t ret     = OVSA_OK;
+
+    ret = ovsa_crypto_decrypt_mem(ctx->sym_keyslot, ctx->input->encrypted,
+                                  ctx->input->encrypted_len, &out_buff, &out_buff_len,
+                                  &keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    OPENSSL_free(out_buff);
+    return ret;
+}
+
+static ovsa_status_t ovsa_bench_sign(ovsa_bench_thread_t* thread) {
+    char signature[MAX_SIGNATURE_SIZE];
+
+    return ovsa_crypto_sign_mem(thread->ctx->asym_keyslot, thread->ctx->input->plain,
+                                thread->ctx->input->size, signature);
+}
+
+static ovsa_status_t ovsa_bench_verify(ovsa_bench_thread_t* thread) {
+    return ovsa_crypto_verify_mem(thread->ctx->asym_keyslot, thread->ctx->input->plain,
+                                  thread->ctx->input->size, thread->ctx->input->signature);
+}
+
+static ovsa_status_t ovsa_bench_hmac(ovsa_bench_thread_t* thread) {
+    char hmac[MAX_MAC_SIZE];
+
+    return ovsa_crypto_compute_hmac(thread->ctx->keyiv_hmac_slot, thread->ctx->input->plain,
+                                    thread->ctx->input->size, hmac);
+}
+
+static ovsa_status_t ovsa_bench_base64_encode(ovsa_bench_thread_t* thread) {
+    char* out_buff    = NULL;
+    ovsa_status_t ret = OVSA_OK;
+
+    ret = ovsa_crypto_convert_bin_to_base64(thread->ctx->input->plain, thread->ctx->input->size,
+                                            &out_buff);
+    OPENSSL_free(out_buff);
+    return ret;
+}
+
+static ovsa_status_t ovsa_bench_base64_decode(ovsa_bench_thread_t* thread) {
+    size_t out_buff_len = 0;
+
+    return ovsa_crypto_convert_base64_to_bin(thread->ctx->input->b64, thread->ctx->input->b64_len,
+                                             thread->scratch, &out_buff_len);
+}
+
+static ovsa_status_t ovsa_bench_wrap_key(ovsa_bench_thread_t* thread) {
+    ovsa_bench_ctx_t* ctx = thread->ctx;
+    char* out_buff        = NULL;
+    size_t out_buff_len   = 0;
+    int keyiv_hmac_slot   = -1;
+    ovsa_status_t ret     = OVSA_OK;
+
+    ret = ovsa_crypto_wrap_key(ctx->asym_keyslot, ctx->sym_keyslot, &out_buff, &out_buff_len,
+                               &keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    OPENSSL_free(out_buff);
+    return ret;
+}
+
+/* The wrapping key is the ECDH key of the primary and secondary keys of the keystore */
+static ovsa_status_t ovsa_bench_unwrap_key(ovsa_bench_thread_t* thread) {
+    ovsa_bench_ctx_t* ctx = thread->ctx;
+    int keyiv_hmac_slot   = -1;
+    int sym_keyslot       = -1;
+    ovsa_status_t ret     = OVSA_OK;
+
+    ret = ovsa_crypto_unwrap_key(ctx->asym_keyslot + 1, ctx->asym_keyslot, ctx->wrapped_key,
+                                 ctx->wrapped_key_len, &sym_keyslot, &keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(sym_keyslot);
+    return ret;
+}
+
+static ovsa_bench_primitive_t g_bench_primitives[] = {
+    {"encrypt", ovsa_bench_encrypt, true, false, true},
+    {"decrypt", ovsa_bench_decrypt, true, false, true},
+    {"sign", ovsa_bench_sign, true, true, true},
+    {"verify", ovsa_bench_verify, true, true, true},
+    {"hmac", ovsa_bench_hmac, true, false, true},
+    {"base64_encode", ovsa_bench_base64_encode, true, false, true},
+    {"base64_decode", ovsa_bench_base64_decode, true, false, true},
+    {"wrap_key", ovsa_bench_wrap_key, false, true, true},
+    {"unwrap_key", ovsa_bench_unwrap_key, false, true, true}};
+
+#define BENCH_PRIMITIVE_COUNT (sizeof(g_bench_primitives) / sizeof(g_bench_primitives[0]))
+
+static void ovsa_bench_help(const char* argv) {
+    size_t i = 0;
+
+    printf("Help for libovsa crypto benchmark\n");
+    printf("-k : Keystore name, required by sign, verify, wrap_key and unwrap_key\n");
+    printf("-p : Comma separated list of primitives, all by default:\n    ");
+    for (i = 0; i < BENCH_PRIMITIVE_COUNT; i++)
+        printf("%s%s", g_bench_primitives[i].name, (i + 1 < BENCH_PRIMITIVE_COUNT) ? "," : "\n");
+    printf("-s : Payload sizes as [min:]max with a K, M or G suffix, 64:16M by default, up to "
+           "4G\n");
+    printf("-t : Maximum number of threads, 1 by default\n");
+    printf("-d : Time of each measurement in milliseconds, %d by default\n",
+           DEFAULT_BENCH_TIME_MS);
+    printf("-o : CSV file to write the results to, stdout by default\n");
+    printf("Example for libovsa crypto benchmark as below:\n");
+    printf("%s -k key_store -p encrypt,decrypt,sign -s 1K:1G -t 8 -o results.csv\n\n", argv);
+}
+
+static bool ovsa_bench_parse_size(const char* arg, size_t* size) {
+    unsigned long long value = 0;
+    char* end                = NULL;
+
+    if (!isdigit(*arg))
+        return false;
+    value = strtoull(arg, &end, 10);
+    switch (toupper(*end)) {
+        case 'G':
+            value *= 1024;
+            /* fall through */
+        case 'M':
+            value *= 1024;
+            /* fall through */
+        case 'K':
+            value *= 1024;
+            end++;
+            break;
+        default:
+            break;
+    }
+    if ((*end != '\0') || (value < MIN_BENCH_PAYLOAD_SIZE) || (value > MAX_BENCH_PAYLOAD_SIZE))
+        return false;
+    *size = (size_t)value;
+    return true;
+}
+
+static ovsa_status_t ovsa_bench_select_primitives(char* list) {
+    char* save = NULL;
+    char* name = NULL;
+    size_t i   = 0;
+    int ind    = 0;
+
+    for (i = 0; i < BENCH_PRIMITIVE_COUNT; i++)
+        g_bench_primitives[i].selected = false;
+    for (name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        for (i = 0; i < BENCH_PRIMITIVE_COUNT; i++) {
+            strcmp_s(name, RSIZE_MAX_STR, g_bench_primitives[i].name, &ind);
+            if (ind == 0)
+                break;
+        }
+        if (i == BENCH_PRIMITIVE_COUNT) {
+            OVSA_DBG(DBG_E, "OVSA: Error unknown primitive %s\n", name);
+            return OVSA_INVALID_PARAMETER;
+        }
+        g_bench_primitives[i].selected = true;
+    }
+    return OVSA_OK;
+}
+
+static uint64_t ovsa_bench_elapsed_ns(const struct timespec* start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000ULL + (now.tv_nsec - start->tv_nsec);
+}
+
+static bool ovsa_bench_expired(const struct timespec* deadline) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > deadline->tv_sec) ||
+           ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec));
+}
+
+/* Runs the primitive till the deadline, at least once */
+static void* ovsa_bench_worker(void* arg) {
+    ovsa_bench_thread_t* thread = (ovsa_bench_thread_t*)arg;
+    struct timespec start;
+    uint64_t elapsed_ns = 0;
+
+    thread->ops      = 0;
+    thread->total_ns = 0;
+    thread->min_ns   = UINT64_MAX;
+    thread->max_ns   = 0;
+    thread->ret      = OVSA_OK;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        thread->ret = thread->primitive->op(thread);
+        elapsed_ns  = ovsa_bench_elapsed_ns(&start);
+        if (thread->ret < OVSA_OK)
+            break;
+        thread->ops++;
+        thread->total_ns += elapsed_ns;
+        if (elapsed_ns < thread->min_ns)
+            thread->min_ns = elapsed_ns;
+        if (elapsed_ns > thread->max_ns)
+            thread->max_ns = elapsed_ns;
+    } while (!ovsa_bench_expired(&thread->ctx->deadline));
+    return NULL;
+}
+
+/* The calling thread is one of the threads measured */
+static ovsa_status_t ovsa_bench_run(ovsa_bench_ctx_t* ctx, const ovsa_bench_primitive_t* primitive,
+                                    ovsa_bench_thread_t* threads, int thread_count, int time_ms,
+                                    size_t size, FILE* out) {
+    pthread_t tids[MAX_BENCH_THREADS];
+    uint64_t ops = 0, total_ns = 0, min_ns = UINT64_MAX, max_ns = 0;
+    ovsa_status_t ret = OVSA_OK;
+    struct timespec start;
+    double seconds = 0;
+    int started    = 0;
+    int i          = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ctx->deadline = start;
+    ctx->deadline.tv_sec += time_ms / 1000;
+    ctx->deadline.tv_nsec += (time_ms % 1000) * 1000000L;
+    if (ctx->deadline.tv_nsec >= 1000000000L) {
+        ctx->deadline.tv_sec++;
+        ctx->deadline.tv_nsec -= 1000000000L;
+    }
+    for (i = 0; i < thread_count; i++) {
+        threads[i].ctx       = ctx;
+        threads[i].primitive = primitive;
+    }
+    for (started = 1; started < thread_count; started++) {
+        if (pthread_create(&tids[started], NULL, ovsa_bench_worker, &threads[started]) != 0) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not start benchmark thread %d\n", started);
+            ret = OVSA_FAIL;
+            break;
+        }
+    }
+    ovsa_bench_worker(&threads[0]);
+    for (i = 1; i < started; i++)
+        pthread_join(tids[i], NULL);
+    seconds = ovsa_bench_elapsed_ns(&start) / 1e9;
+    if (ret < OVSA_OK)
+        return ret;
+
+    for (i = 0; i < thread_count; i++) {
+        if (threads[i].ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error %s of %zu bytes failed with code %d\n", primitive->name,
+                     size, threads[i].ret);
+            return threads[i].ret;
+        }
+        ops += threads[i].ops;
+        total_ns += threads[i].total_ns;
+        if (threads[i].min_ns < min_ns)
+            min_ns = threads[i].min_ns;
+        if (threads[i].max_ns > max_ns)
+            max_ns = threads[i].max_ns;
+    }
+    fprintf(out, "%s,%zu,%d,%lu,%.3f,%.1f,%.2f,%.1f,%.1f,%.1f\n", primitive->name, size,
+            thread_count, (unsigned long)ops, seconds, ops / seconds,
+            ops * (double)size / seconds / (1024 * 1024), total_ns / 1e3 / ops, min_ns / 1e3,
+            max_ns / 1e3);
+    fflush(out);
+    return OVSA_OK;
+}
+
+static void ovsa_bench_free_input(ovsa_bench_input_t* input) {
+    OPENSSL_free(input->encrypted);
+    OPENSSL_free(input->b64);
+    free(input->plain);
+    memset_s(input, sizeof(ovsa_bench_input_t), 0);
+}
+
+/* Sets up the inputs of all the primitives selected for a payload size */
+static ovsa_status_t ovsa_bench_init_input(ovsa_bench_ctx_t* ctx, ovsa_bench_input_t* input,
+                                           size_t size) {
+    ovsa_status_t ret   = OVSA_OK;
+    int keyiv_hmac_slot = -1;
+    size_t i            = 0;
+
+    input->size  = size;
+    input->plain = (char*)malloc(size);
+    if (input->plain == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate %zu bytes of payload\n", size);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+    for (i = 0; i < size; i++)
+        input->plain[i] = (char)(i * 131 + 7);
+
+    ret = ovsa_crypto_encrypt_mem(ctx->sym_keyslot, input->plain, size, NULL, &input->encrypted,
+                                  &input->encrypted_len, &keyiv_hmac_slot);
+    ovsa_crypto_clear_symmetric_key_slot(keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error encrypt payload failed with code %d\n", ret);
+        return ret;
+    }
+    ret = ovsa_crypto_convert_bin_to_base64(input->plain, size, &input->b64);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error base64 encode payload failed with code %d\n", ret);
+        return ret;
+    }
+    input->b64_len = strlen(input->b64);
+    if (ctx->asym_keyslot >= MIN_KEY_SLOT) {
+        ret = ovsa_crypto_sign_mem(ctx->asym_keyslot, input->plain, size, input->signature);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error sign payload failed with code %d\n", ret);
+            return ret;
+        }
+    }
+    return OVSA_OK;
+}
+
+static ovsa_status_t ovsa_bench_run_thread_counts(ovsa_bench_ctx_t* ctx,
+                                                  const ovsa_bench_primitive_t* primitive,
+                                                  ovsa_bench_thread_t* threads, int max_threads,
+                                                  int time_ms, size_t size, FILE* out) {
+    ovsa_status_t ret = OVSA_OK;
+    int thread_count  = 1;
+
+    for (thread_count = 1; ret == OVSA_OK; thread_count *= 2) {
+        if (thread_count > max_threads)
+            thread_count = max_threads;
+        ret = ovsa_bench_run(ctx, primitive, threads, thread_count, time_ms, size, out);
+        if (thread_count == max_threads)
+            break;
+    }
+    return ret;
+}
+
+static ovsa_status_t ovsa_bench_prepare_scratch(ovsa_bench_thread_t* threads, int max_threads,
+                                                size_t size) {
+    int i = 0;
+
+    for (i = 0; i < max_threads; i++) {
+        if (threads[i].scratch_len >= size)
+            continue;
+        free(threads[i].scratch);
+        threads[i].scratch_len = 0;
+        threads[i].scratch     = (char*)malloc(size);
+        if (threads[i].scratch == NULL) {
+            OVSA_DBG(DBG_E, "OVSA: Error could not allocate %zu bytes of output\n", size);
+            return OVSA_MEMORY_ALLOC_FAIL;
+        }
+        threads[i].scratch_len = size;
+    }
+    return OVSA_OK;
+}
+
+int main(int argc, char** argv) {
+    ovsa_status_t ret            = OVSA_OK;
+    ovsa_bench_thread_t* threads = NULL;
+    ovsa_bench_input_t input;
+    ovsa_bench_ctx_t ctx;
+    size_t min_size  = MIN_BENCH_PAYLOAD_SIZE;
+    size_t max_size  = DEFAULT_BENCH_MAX_SIZE;
+    size_t size      = 0;
+    size_t i         = 0;
+    char* keystore   = NULL;
+    char* out_file   = NULL;
+    char* sep        = NULL;
+    FILE* out        = stdout;
+    bool crypto_init = false;
+    int max_threads  = 1;
+    int time_ms      = DEFAULT_BENCH_TIME_MS;
+    int keyiv_slot   = -1;
+    int c            = 0;
+
+    memset_s(&ctx, sizeof(ovsa_bench_ctx_t), 0);
+    memset_s(&input, sizeof(ovsa_bench_input_t), 0);
+    ctx.asym_keyslot    = -1;
+    ctx.sym_keyslot     = -1;
+    ctx.keyiv_hmac_slot = -1;
+    ctx.input           = &input;
+
+    while ((c = getopt(argc, argv, "k:p:s:t:d:o:h")) != -1) {
+        switch (c) {
+            case 'k':
+                keystore = optarg;
+                break;
+            case 'p':
+                ret = ovsa_bench_select_primitives(optarg);
+                if (ret < OVSA_OK)
+                    goto out;
+                break;
+            case 's':
+                sep = strchr(optarg, ':');
+                if (sep != NULL)
+                    *sep++ = '\0';
+                if (((sep != NULL) && !ovsa_bench_parse_size(optarg, &min_size)) ||
+                    !ovsa_bench_parse_size((sep != NULL) ? sep : optarg, &max_size) ||
+                    (min_size > max_size)) {
+                    OVSA_DBG(DBG_E, "OVSA: Error invalid payload sizes for -s\n");
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                break;
+            case 't':
+            case 'd':
+                if (!isdigit(*optarg) || (atoi(optarg) < 1)) {
+                    OVSA_DBG(DBG_E, "OVSA: Error invalid value %s for -%c\n", optarg, c);
+                    ret = OVSA_INVALID_PARAMETER;
+                    goto out;
+                }
+                if (c == 't')
+                    max_threads = atoi(optarg);
+                else
+                    time_ms = atoi(optarg);
+                break;
+            case 'o':
+                out_file = optarg;
+                break;
+            case 'h':
+                ovsa_bench_help(argv[0]);
+                goto out;
+            default:
+                OVSA_DBG(DBG_E,
+                         "OVSA: Error wrong command given. Please follow -help for help option\n");
+                ret = OVSA_INVALID_PARAMETER;
+                goto out;
+        }
+    }
+
+    if (max_threads > MAX_BENCH_THREADS) {
+        OVSA_DBG(DBG_I, "OVSA: Number of threads limited to %d\n", MAX_BENCH_THREADS);
+        max_threads = MAX_BENCH_THREADS;
+    }
+    if (out_file != NULL) {
+        out = fopen(out_file, "w");
+        if (out == NULL) {
+            OVSA_DBG(DBG_E, "OVSA: Error opening file %s failed\n", out_file);
+            out = stdout;
+            ret = OVSA_FILEOPEN_FAIL;
+            goto out;
+        }
+    }
+    threads = (ovsa_bench_thread_t*)calloc(max_threads, sizeof(ovsa_bench_thread_t));
+    if (threads == NULL) {
+        OVSA_DBG(DBG_E, "OVSA: Error could not allocate memory for benchmark threads\n");
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto out;
+    }
+
+    ret = ovsa_crypto_init();
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error ovsa crypto init failed with code %d\n", ret);
+        goto out;
+    }
+    crypto_init = true;
+    if (keystore != NULL) {
+        ret = ovsa_crypto_load_asymmetric_key(keystore, &ctx.asym_keyslot);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error load asymmetric keyslot failed with code %d\n", ret);
+            goto out;
+        }
+    }
+    ret = ovsa_crypto_generate_symmetric_key(SYMMETRIC_KEY_SIZE, &ctx.sym_keyslot);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error generation of symmetric key failed with code %d\n", ret);
+        goto out;
+    }
+    /* The HMAC key is derived along with the encryption key, as for the licenses */
+    ret = ovsa_bench_init_input(&ctx, &input, MIN_BENCH_PAYLOAD_SIZE);
+    if (ret == OVSA_OK)
+        ret = ovsa_crypto_derive_keyiv_hmac(ctx.sym_keyslot, input.encrypted, input.encrypted_len,
+                                            &ctx.keyiv_hmac_slot);
+    ovsa_bench_free_input(&input);
+    if (ret < OVSA_OK) {
+        OVSA_DBG(DBG_E, "OVSA: Error derive HMAC key failed with code %d\n", ret);
+        goto out;
+    }
+    if (ctx.asym_keyslot >= MIN_KEY_SLOT) {
+        ret = ovsa_crypto_wrap_key(ctx.asym_keyslot, ctx.sym_keyslot, &ctx.wrapped_key,
+                                   &ctx.wrapped_key_len, &keyiv_slot);
+        ovsa_crypto_clear_symmetric_key_slot(keyiv_slot);
+        if (ret < OVSA_OK) {
+            OVSA_DBG(DBG_E, "OVSA: Error wrap key failed with code %d\n", ret);
+            goto out;
+        }
+    }
+
+    fprintf(out, "primitive,size,threads,ops,seconds,ops_per_s,mb_per_s,mean_us,min_us,max_us\n");
+    for (size = min_size; size <= max_size; size *= 4) {
+        ret = ovsa_bench_init_input(&ctx, &input, size);
+        if (ret == OVSA_OK)
+            ret = ovsa_bench_prepare_scratch(threads, max_threads, size);
+        for (i = 0; (ret == OVSA_OK) && (i < BENCH_PRIMITIVE_COUNT); i++) {
+            if (!g_bench_primitives[i].selected || !g_bench_primitives[i].sized ||
+                (g_bench_primitives[i].asymmetric && (ctx.asym_keyslot < MIN_KEY_SLOT)))
+                continue;
+            ret = ovsa_bench_run_thread_counts(&ctx, &g_bench_primitives[i], threads,
+                                               max_threads, time_ms, size, out);
+        }
+        ovsa_bench_free_input(&input);
+        if (ret < OVSA_OK)
+            goto out;
+    }
+    for (i = 0; i < BENCH_PRIMITIVE_COUNT; i++) {
+        if (!g_bench_primitives[i].selected || g_bench_primitives[i].sized ||
+            (ctx.asym_keyslot < MIN_KEY_SLOT))
+            continue;
+        ret = ovsa_bench_run_thread_counts(&ctx, &g_bench_primitives[i], threads, max_threads,
+                                           time_ms, SYMMETRIC_KEY_SIZE, out);
+        if (ret < OVSA_OK)
+            goto out;
+    }
+    if (ctx.asym_keyslot < MIN_KEY_SLOT)
+        OVSA_DBG(DBG_I, "OVSA: No keystore given, the asymmetric primitives were skipped\n");
+
+out:
+    OPENSSL_free(ctx.wrapped_key);
+    if (crypto_init) {
+        ovsa_crypto_clear_symmetric_key_slot(ctx.keyiv_hmac_slot);
+        ovsa_crypto_clear_symmetric_key_slot(ctx.sym_keyslot);
+        ovsa_crypto_clear_asymmetric_key_slot(ctx.asym_keyslot);
+        ovsa_crypto_deinit();
+    }
+    if (threads != NULL) {
+        for (c = 0; c < max_threads; c++)
+            free(threads[c].scratch);
+        free(threads);
+    }
+    if (out != stdout)
+        fclose(out);
+    return ret;
+}
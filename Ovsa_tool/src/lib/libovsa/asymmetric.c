@@ -171,108 +171,63 @@ end:
     return ret;
 }
 
-ovsa_status_t ovsa_crypto_add_asymmetric_keystore_array(const ovsa_isv_keystore_t* isv_keystore,
-                                                        int* asym_key_slot) {
-    ovsa_status_t ret        = OVSA_OK;
-    size_t keystore_cert_len = 0;
-    int asymmetric_index     = 0;
-    char* empty_string       = "";
-    int isv_name_indicator   = -1;
-    int public_key_indicator = -1, private_key_indicator = -1;
-    int key_guid_indicator = -1, cert_indicator = -1;
-
-    if ((isv_keystore == NULL) || (asym_key_slot == NULL)) {
+ovsa_status_t ovsa_crypto_add_asymmetric_keystore_array(
+    const ovsa_isv_keystore_t* primary_keystore, const ovsa_isv_keystore_t* secondary_keystore,
+    int* asym_key_slot) {
+    ovsa_status_t ret             = OVSA_OK;
+    ovsa_isv_keystore_t* keystore = NULL;
+    int asymmetric_index          = -1;
+
+    if ((primary_keystore == NULL) || (secondary_keystore == NULL) || (asym_key_slot == NULL)) {
         BIO_printf(
             g_bio_err,
             "LibOVSA: Error adding to asymmetric keystore array failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    /* Find the empty asymmetric index */
-    for (asymmetric_index = 0; asymmetric_index < MAX_KEY_SLOT; asymmetric_index++) {
-        if (strcmp_s(g_key_store[asymmetric_index].isv_name, MAX_NAME_SIZE, empty_string,
-                     &isv_name_indicator) != EOK) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error adding to asymmetric keystore array failed in comparing the "
-                       "keystore name\n");
-            return OVSA_CRYPTO_GENERIC_ERROR;
-        }
-
-        if (strcmp_s(g_key_store[asymmetric_index].public_key, MAX_KEY_SIZE, empty_string,
-                     &public_key_indicator) != EOK) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error adding to asymmetric keystore array failed in comparing the "
-                       "public key\n");
-            return OVSA_CRYPTO_GENERIC_ERROR;
-        }
-
-        if (strcmp_s(g_key_store[asymmetric_index].private_key, MAX_KEY_SIZE, empty_string,
-                     &private_key_indicator) != EOK) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error adding to asymmetric keystore array failed in comparing the "
-                       "private key\n");
-            return OVSA_CRYPTO_GENERIC_ERROR;
-        }
-
-        if (strcmp_s(g_key_store[asymmetric_index].key_guid, sizeof(GUID), empty_string,
-                     &key_guid_indicator) != EOK) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error adding to asymmetric keystore array failed in comparing the "
-                       "guid\n");
-            return OVSA_CRYPTO_GENERIC_ERROR;
-        }
-
-        if (g_key_store[asymmetric_index].isv_certificate != NULL) {
-            ret = ovsa_get_string_length(g_key_store[asymmetric_index].isv_certificate,
-                                         &keystore_cert_len);
-            if (ret < OVSA_OK) {
-                BIO_printf(
-                    g_bio_err,
-                    "LibOVSA: Error adding to asymmetric keystore array failed in getting the "
-                    "keystore certificate length\n");
-                return ret;
-            }
-
-            if (keystore_cert_len == 0) {
-                cert_indicator = 0;
-            }
-        } else {
-            cert_indicator = 0;
-        }
-
-        if ((isv_name_indicator == 0) && (public_key_indicator == 0) &&
-            (private_key_indicator == 0) && (key_guid_indicator == 0) && (cert_indicator == 0)) {
-            if (memcpy_s(&g_key_store[asymmetric_index], sizeof(ovsa_isv_keystore_t), isv_keystore,
-                         sizeof(ovsa_isv_keystore_t)) != EOK) {
-                BIO_printf(
-                    g_bio_err,
-                    "LibOVSA: Error adding to asymmetric keystore array failed in getting the "
-                    "keystore data\n");
-                return OVSA_MEMIO_ERROR;
-            }
+    ret = ovsa_crypto_alloc_asymmetric_key_slot(&asymmetric_index);
+    if (ret < OVSA_OK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error adding to asymmetric keystore array failed since not able to "
+                   "store the asymmetric key\n");
+        return ret;
+    }
 
-            *asym_key_slot = asymmetric_index;
-            break;
-        } else {
-            continue;
-        }
+    keystore = ovsa_crypto_get_asymmetric_keystore(asymmetric_index);
+    if (memcpy_s(keystore, sizeof(ovsa_isv_keystore_t), primary_keystore,
+                 sizeof(ovsa_isv_keystore_t)) != EOK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error adding to asymmetric keystore array failed in getting the "
+                   "keystore data\n");
+        ret = OVSA_MEMIO_ERROR;
+        goto end;
     }
 
-    if (asymmetric_index == MAX_KEY_SLOT) {
+    keystore = ovsa_crypto_get_asymmetric_keystore(asymmetric_index + 1);
+    if (memcpy_s(keystore, sizeof(ovsa_isv_keystore_t), secondary_keystore,
+                 sizeof(ovsa_isv_keystore_t)) != EOK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error adding to asymmetric keystore array failed since not able to "
-                   "store the asymmetric key\n");
-        return OVSA_CRYPTO_GENERIC_ERROR;
+                   "LibOVSA: Error adding to asymmetric keystore array failed in getting the "
+                   "keystore data\n");
+        ret = OVSA_MEMIO_ERROR;
+        goto end;
     }
 
+    *asym_key_slot = asymmetric_index;
+
+end:
+    if (ret < OVSA_OK) {
+        ovsa_crypto_release_asymmetric_key_slot(asymmetric_index);
+    }
     return ret;
 }
 
 ovsa_status_t ovsa_crypto_add_cert_keystore_array(int asym_key_slot, const char* cert) {
-    ovsa_status_t ret = OVSA_OK;
-    size_t cert_len   = 0;
+    ovsa_status_t ret             = OVSA_OK;
+    size_t cert_len               = 0;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (cert == NULL)) {
+    if ((keystore == NULL) || (cert == NULL)) {
         BIO_printf(
             g_bio_err,
             "LibOVSA: Error adding certificate to keystore array failed with invalid parameter\n");
@@ -288,13 +243,13 @@ ovsa_status_t ovsa_crypto_add_cert_keystore_array(int asym_key_slot, const char*
         return ret;
     }
 
-    if (g_key_store[asym_key_slot].isv_certificate != NULL) {
-        ovsa_crypto_openssl_free(&g_key_store[asym_key_slot].isv_certificate);
+    if (keystore->isv_certificate != NULL) {
+        ovsa_crypto_openssl_free(&keystore->isv_certificate);
     }
 
-    g_key_store[asym_key_slot].isv_certificate =
+    keystore->isv_certificate =
         (char*)ovsa_crypto_app_malloc(cert_len + NULL_TERMINATOR, "certificate");
-    if (g_key_store[asym_key_slot].isv_certificate == NULL) {
+    if (keystore->isv_certificate == NULL) {
         BIO_printf(
             g_bio_err,
             "LibOVSA: Error adding certificate to keystore array failed in allocating memory "
@@ -302,7 +257,7 @@ ovsa_status_t ovsa_crypto_add_cert_keystore_array(int asym_key_slot, const char*
         return OVSA_MEMORY_ALLOC_FAIL;
     }
 
-    if (memcpy_s(g_key_store[asym_key_slot].isv_certificate, cert_len, cert, cert_len) != EOK) {
+    if (memcpy_s(keystore->isv_certificate, cert_len, cert, cert_len) != EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error adding certificate to keystore array failed in getting the "
                    "certificate\n");
@@ -453,41 +408,12 @@ ovsa_status_t ovsa_crypto_generate_asymmetric_key_pair(ovsa_key_alg_t alg_type,
         goto end;
     }
 
-    if (pthread_mutex_lock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error generating asymmetric key pair failed in acquiring the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_LOCK_FAIL;
-        goto end;
-    }
-
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[0], asym_key_slot);
-    if (ret < OVSA_OK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error generating asymmetric key pair failed in adding to asymmetric "
-                   "keystore array\n");
-        goto exit;
-    }
-
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[1], asym_key_slot);
+    /* Return primary keyslot */
+    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[0], &keystore[1], asym_key_slot);
     if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error generating asymmetric key pair failed in adding to asymmetric "
                    "keystore array\n");
-        goto exit;
-    }
-
-    /* Return primary keyslot */
-    *asym_key_slot = *asym_key_slot - 1;
-
-exit:
-    if (pthread_mutex_unlock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error generating asymmetric key pair failed in releasing the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_UNLOCK_FAIL;
         goto end;
     }
 
@@ -681,43 +607,15 @@ ovsa_status_t ovsa_crypto_load_asymmetric_key(const char* keystore_name, int* as
         goto end;
     }
 
-    if (pthread_mutex_lock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error loading asymmetric key failed in acquiring the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_LOCK_FAIL;
-        goto end;
-    }
-
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[0], asym_key_slot);
-    if (ret < OVSA_OK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error loading asymmetric key failed in adding to asymmetric keystore "
-                   "array\n");
-        goto exit;
-    }
-
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[1], asym_key_slot);
+    /* Return primary keyslot */
+    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore[0], &keystore[1], asym_key_slot);
     if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error loading asymmetric key failed in adding to asymmetric keystore "
                    "array\n");
-        goto exit;
-    }
-
-    /* Return primary keyslot */
-    *asym_key_slot = *asym_key_slot - 1;
-
-exit:
-    if (pthread_mutex_unlock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error loading asymmetric key failed in releasing the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_UNLOCK_FAIL;
         goto end;
     }
+
 end:
     memset_s(&keystore, sizeof(ovsa_isv_keystore_t) * MAX_KEYPAIR, 0);
     if (ret < OVSA_OK) {
@@ -729,9 +627,11 @@ end:
 ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int* asym_key_slot) {
     ovsa_status_t ret = OVSA_OK;
     size_t cert_len = 0, keystore_cert_len = 0;
-    int asymmetric_index = 0, isv_name_indicator = -1;
+    uint32_t asymmetric_index = 0, slot_count = 0;
+    int key_slot = -1, isv_name_indicator = -1;
     int public_key_indicator = -1, private_key_indicator = -1;
     int key_guid_indicator = -1, cert_indicator = -1;
+    ovsa_isv_keystore_t* isv_keystore = NULL;
     ovsa_isv_keystore_t keystore[MAX_KEYPAIR];
 
     if ((keystore_name == NULL) || (asym_key_slot == NULL)) {
@@ -760,8 +660,15 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
         }
     }
 
-    for (asymmetric_index = 0; asymmetric_index < MAX_KEY_SLOT; asymmetric_index++) {
-        if (strcmp_s(g_key_store[asymmetric_index].isv_name, MAX_NAME_SIZE, keystore[0].isv_name,
+    slot_count = ovsa_crypto_get_asymmetric_key_slot_count();
+    for (asymmetric_index = 0; asymmetric_index < slot_count; asymmetric_index++) {
+        key_slot     = ovsa_crypto_get_asymmetric_key_slot_at(asymmetric_index);
+        isv_keystore = ovsa_crypto_get_asymmetric_keystore(key_slot);
+        if (isv_keystore == NULL) {
+            continue;
+        }
+
+        if (strcmp_s(isv_keystore->isv_name, MAX_NAME_SIZE, keystore[0].isv_name,
                      &isv_name_indicator) != EOK) {
             BIO_printf(g_bio_err,
                        "LibOVSA: Error getting asymmetric key slot failed in comparing the "
@@ -770,7 +677,7 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
             goto end;
         }
 
-        if (strcmp_s(g_key_store[asymmetric_index].public_key, MAX_KEY_SIZE, keystore[0].public_key,
+        if (strcmp_s(isv_keystore->public_key, MAX_KEY_SIZE, keystore[0].public_key,
                      &public_key_indicator) != EOK) {
             BIO_printf(
                 g_bio_err,
@@ -779,8 +686,8 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
             goto end;
         }
 
-        if (strcmp_s(g_key_store[asymmetric_index].private_key, MAX_KEY_SIZE,
-                     keystore[0].private_key, &private_key_indicator) != EOK) {
+        if (strcmp_s(isv_keystore->private_key, MAX_KEY_SIZE, keystore[0].private_key,
+                     &private_key_indicator) != EOK) {
             BIO_printf(
                 g_bio_err,
                 "LibOVSA: Error getting asymmetric key slot failed in comparing the private key\n");
@@ -788,7 +695,7 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
             goto end;
         }
 
-        if (strcmp_s(g_key_store[asymmetric_index].key_guid, sizeof(GUID), keystore[0].key_guid,
+        if (strcmp_s(isv_keystore->key_guid, sizeof(GUID), keystore[0].key_guid,
                      &key_guid_indicator) != EOK) {
             BIO_printf(g_bio_err,
                        "LibOVSA: Error getting asymmetric key slot failed in comparing the guid\n");
@@ -796,9 +703,8 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
             goto end;
         }
 
-        if (g_key_store[asymmetric_index].isv_certificate != NULL) {
-            ret = ovsa_get_string_length(g_key_store[asymmetric_index].isv_certificate,
-                                         &keystore_cert_len);
+        if (isv_keystore->isv_certificate != NULL) {
+            ret = ovsa_get_string_length(isv_keystore->isv_certificate, &keystore_cert_len);
             if (ret < OVSA_OK) {
                 BIO_printf(g_bio_err,
                            "LibOVSA: Error getting asymmetric key slot failed in getting the "
@@ -808,9 +714,8 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
         }
 
         if ((cert_len != 0) && (keystore_cert_len != 0)) {
-            if ((g_key_store[asymmetric_index].isv_certificate != NULL) &&
-                (keystore[0].isv_certificate != NULL)) {
-                ret = ovsa_compare_strings(g_key_store[asymmetric_index].isv_certificate,
+            if ((isv_keystore->isv_certificate != NULL) && (keystore[0].isv_certificate != NULL)) {
+                ret = ovsa_compare_strings(isv_keystore->isv_certificate,
                                            keystore[0].isv_certificate, &cert_indicator);
                 if (ret < OVSA_OK) {
                     BIO_printf(g_bio_err,
@@ -829,12 +734,12 @@ ovsa_status_t ovsa_crypto_get_asymmetric_key_slot(const char* keystore_name, int
         /* If matching keyslot found, return the keyslot */
         if ((isv_name_indicator == 0) && (public_key_indicator == 0) &&
             (private_key_indicator == 0) && (key_guid_indicator == 0) && (cert_indicator == 0)) {
-            *asym_key_slot = asymmetric_index;
+            *asym_key_slot = key_slot;
             break;
         }
     }
 
-    if (asymmetric_index >= MAX_KEY_SLOT) {
+    if (asymmetric_index >= slot_count) {
         BIO_printf(g_bio_err, "LibOVSA: Error matching keyslot could not be found\n");
         *asym_key_slot = -1;
         ret            = OVSA_CRYPTO_GENERIC_ERROR;
@@ -853,18 +758,18 @@ ovsa_status_t ovsa_crypto_store_certificate_keystore(int asym_key_slot, bool pee
                                                      const char* cert, bool lifetime_validity_check,
                                                      const char* keystore_name) {
     size_t cert_len = 0, keystore_size = 0;
-    ovsa_status_t ret        = OVSA_OK;
-    size_t keystore_buff_len = 0;
-    char* keystore_buff      = NULL;
-    BIO* keystore_bio        = NULL;
-    int sym_key_slot         = -1;
-    int store_key_slot       = -1;
-    EVP_PKEY* pkey           = NULL;
-    X509* xcert              = NULL;
+    ovsa_status_t ret                 = OVSA_OK;
+    size_t keystore_buff_len          = 0;
+    char* keystore_buff               = NULL;
+    BIO* keystore_bio                 = NULL;
+    int sym_key_slot                  = -1;
+    int store_key_slot                = -1;
+    EVP_PKEY* pkey                    = NULL;
+    X509* xcert                       = NULL;
+    ovsa_isv_keystore_t* isv_keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
     char magic_salt_buff[MAX_MAGIC_SALT_LENGTH];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (cert == NULL) ||
-        (keystore_name == NULL)) {
+    if ((isv_keystore == NULL) || (cert == NULL) || (keystore_name == NULL)) {
         BIO_printf(
             g_bio_err,
             "LibOVSA: Error storing certificate to keystore failed with invalid parameter\n");
@@ -938,8 +843,7 @@ ovsa_status_t ovsa_crypto_store_certificate_keystore(int asym_key_slot, bool pee
         goto end;
     }
 
-    ret = ovsa_json_create_isv_keystore(&g_key_store[asym_key_slot], keystore_buff,
-                                        (keystore_size * MAX_KEYPAIR));
+    ret = ovsa_json_create_isv_keystore(isv_keystore, keystore_buff, (keystore_size * MAX_KEYPAIR));
     if (ret < OVSA_OK) {
         BIO_printf(
             g_bio_err,
@@ -1002,16 +906,17 @@ end:
 }
 
 ovsa_status_t ovsa_crypto_get_certificate(int asym_key_slot, char** cert) {
-    ovsa_status_t ret    = OVSA_OK;
-    size_t cert_buff_len = 0;
-    char* cert_buff      = NULL;
+    ovsa_status_t ret             = OVSA_OK;
+    size_t cert_buff_len          = 0;
+    char* cert_buff               = NULL;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (cert == NULL)) {
+    if ((keystore == NULL) || (cert == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error getting certificate failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    if (g_key_store[asym_key_slot].isv_certificate == NULL) {
+    if (keystore->isv_certificate == NULL) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error getting certificate failed since certificate is not stored in "
                    "keystore\n");
@@ -1019,8 +924,8 @@ ovsa_status_t ovsa_crypto_get_certificate(int asym_key_slot, char** cert) {
         goto end;
     }
 
-    cert_buff = g_key_store[asym_key_slot].isv_certificate;
-    ret       = ovsa_get_string_length(g_key_store[asym_key_slot].isv_certificate, &cert_buff_len);
+    cert_buff = keystore->isv_certificate;
+    ret       = ovsa_get_string_length(keystore->isv_certificate, &cert_buff_len);
     if ((ret < OVSA_OK) || (cert_buff_len == EOK)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error getting certificate failed in getting the size of the "
@@ -1056,19 +961,19 @@ end:
 ovsa_status_t ovsa_crypto_store_certificate_file(int asym_key_slot, bool peer_cert,
                                                  bool lifetime_validity_check,
                                                  const char* cert_file_name) {
-    ovsa_status_t ret    = OVSA_OK;
-    size_t cert_buff_len = 0;
-    char* cert_buff      = NULL;
-    BIO* cert_bio        = NULL;
+    ovsa_status_t ret             = OVSA_OK;
+    size_t cert_buff_len          = 0;
+    char* cert_buff               = NULL;
+    BIO* cert_bio                 = NULL;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (cert_file_name == NULL)) {
+    if ((keystore == NULL) || (cert_file_name == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error storing certificate to file failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    if (g_key_store[asym_key_slot].isv_certificate == NULL) {
+    if (keystore->isv_certificate == NULL) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error storing certificate to file failed since certificate is not "
                    "stored in keystore\n");
@@ -1076,8 +981,8 @@ ovsa_status_t ovsa_crypto_store_certificate_file(int asym_key_slot, bool peer_ce
         goto end;
     }
 
-    cert_buff = g_key_store[asym_key_slot].isv_certificate;
-    ret       = ovsa_get_string_length(g_key_store[asym_key_slot].isv_certificate, &cert_buff_len);
+    cert_buff = keystore->isv_certificate;
+    ret       = ovsa_get_string_length(keystore->isv_certificate, &cert_buff_len);
     if ((ret < OVSA_OK) || (cert_buff_len == EOK)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error storing certificate to file failed in getting the size of the "
@@ -1124,27 +1029,27 @@ end:
 ovsa_status_t ovsa_crypto_sign_file(int asym_key_slot, const char* file_to_sign,
                                     const char* signed_file) {
     int siglen = 0, sign = 0;
-    ovsa_status_t ret       = OVSA_OK;
-    unsigned char* sign_buf = NULL;
-    FILE* file_to_sign_fp   = NULL;
-    const EVP_MD* md        = NULL;
-    EVP_PKEY* sigkey        = NULL;
-    BIO* input_file         = NULL;
-    BIO* write_bio          = NULL;
-    BIO* read_file          = NULL;
-    BIO* signature          = NULL;
-    BIO* bmd                = NULL;
-    BIO* b64                = NULL;
+    ovsa_status_t ret             = OVSA_OK;
+    unsigned char* sign_buf       = NULL;
+    FILE* file_to_sign_fp         = NULL;
+    const EVP_MD* md              = NULL;
+    EVP_PKEY* sigkey              = NULL;
+    BIO* input_file               = NULL;
+    BIO* write_bio                = NULL;
+    BIO* read_file                = NULL;
+    BIO* signature                = NULL;
+    BIO* bmd                      = NULL;
+    BIO* b64                      = NULL;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
     size_t private_key_len = 0, sign_file_size = 0;
     char private_key[MAX_KEY_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (file_to_sign == NULL) || (signed_file == NULL)) {
+    if ((keystore == NULL) || (file_to_sign == NULL) || (signed_file == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error signing the file failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    private_key_len = strnlen_s(g_key_store[asym_key_slot].private_key, MAX_KEY_SIZE);
+    private_key_len = strnlen_s(keystore->private_key, MAX_KEY_SIZE);
     if (private_key_len == EOK) {
         BIO_printf(
             g_bio_err,
@@ -1154,8 +1059,7 @@ ovsa_status_t ovsa_crypto_sign_file(int asym_key_slot, const char* file_to_sign,
 
     memset_s(private_key, MAX_KEY_SIZE, 0);
 
-    if (memcpy_s(private_key, MAX_KEY_SIZE, g_key_store[asym_key_slot].private_key,
-                 private_key_len) != EOK) {
+    if (memcpy_s(private_key, MAX_KEY_SIZE, keystore->private_key, private_key_len) != EOK) {
         BIO_printf(g_bio_err, "LibOVSA: Error signing the file failed to get the private key\n");
         return OVSA_MEMIO_ERROR;
     }
@@ -1284,29 +1188,29 @@ end:
 
 ovsa_status_t ovsa_crypto_sign_mem(int asym_key_slot, const char* in_buff, size_t in_buff_len,
                                    char* out_buff) {
-    ovsa_status_t ret            = OVSA_OK;
-    unsigned char* sign_mem_buff = NULL;
-    size_t private_key_len       = 0;
-    BUF_MEM* signed_ptr          = NULL;
-    const EVP_MD* md             = NULL;
-    EVP_PKEY* sigkey             = NULL;
-    BIO* input_bio               = NULL;
-    BIO* write_bio               = NULL;
-    BIO* read_bio                = NULL;
-    BIO* out_bio                 = NULL;
-    BIO* bmd                     = NULL;
-    BIO* b64                     = NULL;
+    ovsa_status_t ret             = OVSA_OK;
+    unsigned char* sign_mem_buff  = NULL;
+    size_t private_key_len        = 0;
+    BUF_MEM* signed_ptr           = NULL;
+    const EVP_MD* md              = NULL;
+    EVP_PKEY* sigkey              = NULL;
+    BIO* input_bio                = NULL;
+    BIO* write_bio                = NULL;
+    BIO* read_bio                 = NULL;
+    BIO* out_bio                  = NULL;
+    BIO* bmd                      = NULL;
+    BIO* b64                      = NULL;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
     int siglen = 0, sign = 0;
     char private_key[MAX_KEY_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
-        (in_buff_len == 0) || (out_buff == NULL)) {
+    if ((keystore == NULL) || (in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error signing the memory buffer failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    private_key_len = strnlen_s(g_key_store[asym_key_slot].private_key, MAX_KEY_SIZE);
+    private_key_len = strnlen_s(keystore->private_key, MAX_KEY_SIZE);
     if (private_key_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error signing the memory buffer failed in getting the size for "
@@ -1316,8 +1220,7 @@ ovsa_status_t ovsa_crypto_sign_mem(int asym_key_slot, const char* in_buff, size_
 
     memset_s(private_key, MAX_KEY_SIZE, 0);
 
-    if (memcpy_s(private_key, MAX_KEY_SIZE, g_key_store[asym_key_slot].private_key,
-                 private_key_len) != EOK) {
+    if (memcpy_s(private_key, MAX_KEY_SIZE, keystore->private_key, private_key_len) != EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error signing the memory buffer failed in getting the private key\n");
         return OVSA_MEMIO_ERROR;
@@ -1463,8 +1366,8 @@ ovsa_status_t ovsa_crypto_verify_file(int asym_key_slot, const char* file_to_ver
     int siglen = 0, verify = 0;
     char public_key[MAX_KEY_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (file_to_verify == NULL) || (signature == NULL)) {
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (file_to_verify == NULL) ||
+        (signature == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error verifying the file failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -1635,7 +1538,7 @@ ovsa_status_t ovsa_crypto_verify_mem(int asym_key_slot, const char* in_buff, siz
     int siglen = 0, verify = 0;
     char public_key[MAX_KEY_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (signature == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying the memory buffer failed with invalid parameter\n");
@@ -1802,19 +1705,20 @@ end:
 
 ovsa_status_t ovsa_crypto_compute_hmac(int keyiv_hmac_slot, const char* in_buff, size_t in_buff_len,
                                        char* out_buff) {
-    ovsa_status_t ret        = OVSA_OK;
-    unsigned char* hmac_buff = NULL;
-    EVP_MD_CTX* ctx          = NULL;
-    BUF_MEM* hmac_ptr        = NULL;
-    const EVP_MD* md         = EVP_sha512();
-    const EVP_CIPHER* cipher = NULL;
-    EVP_PKEY* pkey           = NULL;
-    BIO* write_bio           = NULL;
-    BIO* out_bio             = NULL;
-    BIO* keyiv_hmac_bio      = NULL;
-    BIO* keyiv_hmac_read_bio = NULL;
-    BIO* b64                 = NULL;
-    BIO* keyiv_hmac_b64      = NULL;
+    ovsa_status_t ret              = OVSA_OK;
+    unsigned char* hmac_buff       = NULL;
+    EVP_MD_CTX* ctx                = NULL;
+    BUF_MEM* hmac_ptr              = NULL;
+    const EVP_MD* md               = EVP_sha512();
+    const EVP_CIPHER* cipher       = NULL;
+    EVP_PKEY* pkey                 = NULL;
+    BIO* write_bio                 = NULL;
+    BIO* out_bio                   = NULL;
+    BIO* keyiv_hmac_bio            = NULL;
+    BIO* keyiv_hmac_read_bio       = NULL;
+    BIO* b64                       = NULL;
+    BIO* keyiv_hmac_b64            = NULL;
+    ovsa_sym_key_t* keyiv_hmac_key = ovsa_crypto_get_symmetric_key(keyiv_hmac_slot);
     size_t keyiv_hmac_len = 0, siglen = 0;
     size_t hmac_key_len = 0, hmaclen = 0;
     size_t buff_len = 0;
@@ -1822,8 +1726,7 @@ ovsa_status_t ovsa_crypto_compute_hmac(int keyiv_hmac_slot, const char* in_buff,
     unsigned char keyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
     unsigned char hmac[MAX_HMAC_LENGTH];
 
-    if ((keyiv_hmac_slot < MIN_KEY_SLOT) || (keyiv_hmac_slot >= MAX_KEY_SLOT) ||
-        (in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
+    if ((keyiv_hmac_key == NULL) || (in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error computing hmac failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -1841,7 +1744,7 @@ ovsa_status_t ovsa_crypto_compute_hmac(int keyiv_hmac_slot, const char* in_buff,
     }
 
     keyiv_hmac_bio = keyiv_hmac_read_bio;
-    if (BIO_puts(keyiv_hmac_read_bio, g_sym_key[keyiv_hmac_slot]) <= 0) {
+    if (BIO_puts(keyiv_hmac_read_bio, keyiv_hmac_key->sym_key) <= 0) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error computing hmac failed in writing to keyiv_hmac BIO\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
@@ -1857,7 +1760,7 @@ ovsa_status_t ovsa_crypto_compute_hmac(int keyiv_hmac_slot, const char* in_buff,
     }
 
     keyiv_hmac_bio = BIO_push(keyiv_hmac_b64, keyiv_hmac_bio);
-    keyiv_hmac_len = strnlen_s(g_sym_key[keyiv_hmac_slot], MAX_KEYIV_HMAC_LENGTH);
+    keyiv_hmac_len = strnlen_s(keyiv_hmac_key->sym_key, MAX_KEYIV_HMAC_LENGTH);
     if (keyiv_hmac_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error computing hmac failed in getting the size for keyiv_hmac\n");
@@ -2013,18 +1916,19 @@ end:
 
 static ovsa_status_t ovsa_crypto_verify_hmac(int keyiv_hmac_slot, const char* in_buff,
                                              size_t in_buff_len, const char* signature) {
-    ovsa_status_t ret        = OVSA_OK;
-    EVP_MD_CTX* ctx          = NULL;
-    const EVP_MD* md         = EVP_sha512();
-    EVP_PKEY* pkey           = NULL;
-    BIO* out_bio             = NULL;
-    BIO* sigbio              = NULL;
-    BIO* keyiv_hmac_read_bio = NULL;
-    BIO* keyiv_hmac_bio      = NULL;
-    BIO* b64                 = NULL;
-    BIO* keyiv_hmac_b64      = NULL;
-    unsigned char* sigbuff   = NULL;
-    const EVP_CIPHER* cipher = NULL;
+    ovsa_status_t ret              = OVSA_OK;
+    EVP_MD_CTX* ctx                = NULL;
+    const EVP_MD* md               = EVP_sha512();
+    EVP_PKEY* pkey                 = NULL;
+    BIO* out_bio                   = NULL;
+    BIO* sigbio                    = NULL;
+    BIO* keyiv_hmac_read_bio       = NULL;
+    BIO* keyiv_hmac_bio            = NULL;
+    BIO* b64                       = NULL;
+    BIO* keyiv_hmac_b64            = NULL;
+    unsigned char* sigbuff         = NULL;
+    const EVP_CIPHER* cipher       = NULL;
+    ovsa_sym_key_t* keyiv_hmac_key = ovsa_crypto_get_symmetric_key(keyiv_hmac_slot);
     unsigned char verify_buff[EVP_MAX_MD_SIZE];
     size_t hmac_key_len = 0, siglen = 0;
     size_t keyiv_hmac_len = 0, buff_len = 0;
@@ -2033,8 +1937,8 @@ static ovsa_status_t ovsa_crypto_verify_hmac(int keyiv_hmac_slot, const char* in
     unsigned char keyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
     unsigned char hmac[MAX_HMAC_LENGTH];
 
-    if ((keyiv_hmac_slot < MIN_KEY_SLOT) || (keyiv_hmac_slot >= MAX_KEY_SLOT) ||
-        (in_buff == NULL) || (in_buff_len == 0) || (signature == NULL)) {
+    if ((keyiv_hmac_key == NULL) || (in_buff == NULL) || (in_buff_len == 0) ||
+        (signature == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error verifying hmac failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -2052,7 +1956,7 @@ static ovsa_status_t ovsa_crypto_verify_hmac(int keyiv_hmac_slot, const char* in
     }
 
     keyiv_hmac_bio = keyiv_hmac_read_bio;
-    if (BIO_puts(keyiv_hmac_read_bio, g_sym_key[keyiv_hmac_slot]) <= 0) {
+    if (BIO_puts(keyiv_hmac_read_bio, keyiv_hmac_key->sym_key) <= 0) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying hmac failed in writing to keyiv_hmac BIO\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
@@ -2068,7 +1972,7 @@ static ovsa_status_t ovsa_crypto_verify_hmac(int keyiv_hmac_slot, const char* in
     }
 
     keyiv_hmac_bio = BIO_push(keyiv_hmac_b64, keyiv_hmac_bio);
-    keyiv_hmac_len = strnlen_s(g_sym_key[keyiv_hmac_slot], MAX_KEYIV_HMAC_LENGTH);
+    keyiv_hmac_len = strnlen_s(keyiv_hmac_key->sym_key, MAX_KEYIV_HMAC_LENGTH);
     if (keyiv_hmac_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying hmac failed in getting the size for keyiv_hmac\n");
@@ -2222,7 +2126,7 @@ ovsa_status_t ovsa_crypto_sign_json_blob(int asym_key_slot, const char* in_buff,
     ovsa_status_t ret = OVSA_OK;
     char sig_buff[MAX_SIGNATURE_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error signing the JSON blob failed with invalid parameter\n");
@@ -2258,7 +2162,7 @@ ovsa_status_t ovsa_crypto_verify_json_blob(int asym_key_slot, const char* in_buf
     ovsa_status_t ret = OVSA_OK;
     char sig_buff[MAX_SIGNATURE_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying the JSON blob failed with invalid parameter\n");
@@ -2296,8 +2200,8 @@ ovsa_status_t ovsa_crypto_hmac_json_blob(int keyiv_hmac_slot, const char* in_buf
     ovsa_status_t ret = OVSA_OK;
     char hmac_buff[MAX_MAC_SIZE];
 
-    if ((keyiv_hmac_slot < MIN_KEY_SLOT) || (keyiv_hmac_slot >= MAX_KEY_SLOT) ||
-        (in_buff == NULL) || (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
+    if ((ovsa_crypto_get_symmetric_key(keyiv_hmac_slot) == NULL) || (in_buff == NULL) ||
+        (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error hmac JSON blob failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -2330,8 +2234,8 @@ ovsa_status_t ovsa_crypto_verify_hmac_json_blob(int keyiv_hmac_slot, const char*
     ovsa_status_t ret = OVSA_OK;
     char hmac_buff[MAX_MAC_SIZE];
 
-    if ((keyiv_hmac_slot < MIN_KEY_SLOT) || (keyiv_hmac_slot >= MAX_KEY_SLOT) ||
-        (in_buff == NULL) || (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
+    if ((ovsa_crypto_get_symmetric_key(keyiv_hmac_slot) == NULL) || (in_buff == NULL) ||
+        (in_buff_len == 0) || (out_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying the hmac JSON blob failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
@@ -2366,13 +2270,13 @@ end:
 
 ovsa_status_t ovsa_crypto_wrap_key(int asym_key_slot, int sym_key_slot, char** out_buff,
                                    size_t* out_buff_len, int* keyiv_hmac_slot) {
-    ovsa_status_t ret   = OVSA_OK;
-    size_t sym_key_len  = 0;
-    int shared_key_slot = -1;
+    ovsa_status_t ret       = OVSA_OK;
+    size_t sym_key_len      = 0;
+    int shared_key_slot     = -1;
+    ovsa_sym_key_t* sym_key = ovsa_crypto_get_symmetric_key(sym_key_slot);
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (sym_key_slot < MIN_KEY_SLOT) || (sym_key_slot >= MAX_KEY_SLOT) || (out_buff == NULL) ||
-        (out_buff_len == NULL) || (keyiv_hmac_slot == NULL)) {
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (sym_key == NULL) ||
+        (out_buff == NULL) || (out_buff_len == NULL) || (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error wrapping the key failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -2385,15 +2289,15 @@ ovsa_status_t ovsa_crypto_wrap_key(int asym_key_slot, int sym_key_slot, char** o
         return ret;
     }
 
-    sym_key_len = strnlen_s(g_sym_key[sym_key_slot], MAX_EKEY_SIZE);
+    sym_key_len = strnlen_s(sym_key->sym_key, MAX_EKEY_SIZE);
     if (sym_key_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error wrapping the key failed in getting the size of symmetric key\n");
         return OVSA_CRYPTO_GENERIC_ERROR;
     }
 
-    ret = ovsa_crypto_encrypt_mem(shared_key_slot, g_sym_key[sym_key_slot], sym_key_len, NULL,
-                                  out_buff, out_buff_len, keyiv_hmac_slot);
+    ret = ovsa_crypto_encrypt_mem(shared_key_slot, sym_key->sym_key, sym_key_len, NULL, out_buff,
+                                  out_buff_len, keyiv_hmac_slot);
     if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error wrapping the key failed in encrypting the memory buffer\n");
@@ -2414,8 +2318,8 @@ ovsa_status_t ovsa_crypto_rewrap_key(int asym_key_slot, int peer_key_slot, const
     char* decrypt_buff      = NULL;
     size_t decrypt_buff_len = 0;
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (peer_key_slot < MIN_KEY_SLOT) || (peer_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) ||
+        (ovsa_crypto_get_asymmetric_keystore(peer_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (out_buff == NULL) || (out_buff_len == NULL) ||
         (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error rewrapping the key failed with invalid parameter\n");
@@ -2472,8 +2376,8 @@ ovsa_status_t ovsa_crypto_unwrap_key(int asym_key_slot, int peer_key_slot, const
     char* unwrapped_key = NULL;
     size_t out_buff_len = 0;
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (peer_key_slot < MIN_KEY_SLOT) || (peer_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) ||
+        (ovsa_crypto_get_asymmetric_keystore(peer_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (sym_key_slot == NULL) || (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error unwrapping the key failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
@@ -18,25 +18,26 @@
 #ifndef __OVSA_ASYMMETRIC_H_
 #define __OVSA_ASYMMETRIC_H_
 
+#include "keyslot.h"
 #include "utils.h"
 
 #define MAX_KEYPAIR 2
 
 extern BIO* g_bio_err;
 extern pthread_mutex_t g_asymmetric_index_lock;
-extern pthread_mutex_t g_symmetric_index_lock;
-extern ovsa_isv_keystore_t g_key_store[MAX_KEY_SLOT];
-extern char g_sym_key[MAX_KEY_SLOT][MAX_EKEY_SIZE];
 
-/** \brief This function adds keystore contents to the asymmetric keystore array.
+/** \brief This function adds the primary and secondary keystore contents to a new asymmetric key
+ *         slot. The secondary key is at the returned key slot + 1.
  *
- * \param[in]  isv_keystore   ovsa_isv_keystore_t contents.
- * \param[out] asym_key_slot  Asymmetric key slot index.
+ * \param[in]  primary_keystore    ovsa_isv_keystore_t contents of the primary key.
+ * \param[in]  secondary_keystore  ovsa_isv_keystore_t contents of the secondary key.
+ * \param[out] asym_key_slot       Asymmetric key slot index of the primary key.
  *
  * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
  */
-ovsa_status_t ovsa_crypto_add_asymmetric_keystore_array(const ovsa_isv_keystore_t* isv_keystore,
-                                                        int* asym_key_slot);
+ovsa_status_t ovsa_crypto_add_asymmetric_keystore_array(
+    const ovsa_isv_keystore_t* primary_keystore, const ovsa_isv_keystore_t* secondary_keystore,
+    int* asym_key_slot);
 
 /** \brief This function adds certificate to the specified asymmetric keystore array.
  *
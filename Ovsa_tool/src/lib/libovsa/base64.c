@@ -0,0 +1,397 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#include "base64.h"
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define BASE64_LINE_LEN   64
+#define BASE64_LINE_BYTES 48 /* Input bytes encoded per line */
+#define BASE64_INVALID    0x80
+
+static const char g_base64_enc[BASE64_LINE_LEN + 1] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Sextet of every character, BASE64_INVALID for anything outside of the alphabet */
+static const uint8_t g_base64_dec[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+static size_t ovsa_base64_encode_scalar(const unsigned char* in, size_t len, char* out) {
+    char* start = out;
+    uint32_t triple;
+
+    while (len >= 3) {
+        triple = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+        *out++ = g_base64_enc[(triple >> 18) & 0x3f];
+        *out++ = g_base64_enc[(triple >> 12) & 0x3f];
+        *out++ = g_base64_enc[(triple >> 6) & 0x3f];
+        *out++ = g_base64_enc[triple & 0x3f];
+        in += 3;
+        len -= 3;
+    }
+
+    if (len > 0) {
+        triple = (uint32_t)in[0] << 16;
+        if (len == 2) {
+            triple |= (uint32_t)in[1] << 8;
+        }
+        *out++ = g_base64_enc[(triple >> 18) & 0x3f];
+        *out++ = g_base64_enc[(triple >> 12) & 0x3f];
+        *out++ = (len == 2) ? g_base64_enc[(triple >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+    return out - start;
+}
+
+/*
+ * Decodes the complete quads from the start of the buffer and stops at the first character that
+ * is not in the alphabet. Returns the number of characters consumed, always a multiple of four.
+ */
+static size_t ovsa_base64_decode_scalar(const unsigned char* in, size_t len, unsigned char* out) {
+    const unsigned char* start = in;
+    uint8_t s0, s1, s2, s3;
+    uint32_t quad;
+
+    while (len >= 4) {
+        s0 = g_base64_dec[in[0]];
+        s1 = g_base64_dec[in[1]];
+        s2 = g_base64_dec[in[2]];
+        s3 = g_base64_dec[in[3]];
+        if ((s0 | s1 | s2 | s3) & BASE64_INVALID) {
+            break;
+        }
+        quad = ((uint32_t)s0 << 18) | ((uint32_t)s1 << 12) | ((uint32_t)s2 << 6) | s3;
+        *out++ = (unsigned char)(quad >> 16);
+        *out++ = (unsigned char)(quad >> 8);
+        *out++ = (unsigned char)quad;
+        in += 4;
+        len -= 4;
+    }
+    return in - start;
+}
+
+#if defined(__x86_64__)
+/*
+ * AVX2 kernels, 24 bytes to 32 characters per iteration. The bit shuffling follows the SSSE3 and
+ * AVX2 codecs of the aklomp/base64 project.
+ */
+__attribute__((target("avx2"))) static size_t ovsa_base64_encode_avx2(const unsigned char* in,
+                                                                       size_t len, char* out) {
+    const unsigned char* start = in;
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0,
+                                          2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16,
+                                         0, 0, 65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19,
+                                         -16, 0, 0);
+    __m128i lo, hi;
+    __m256i str, t0, t1, idx, mask;
+
+    while (len >= 24) {
+        /* Bytes 0-11 in the low lane and 12-23 in the high lane, without reading past 24 */
+        lo  = _mm_loadu_si128((const __m128i*)in);
+        hi  = _mm_srli_si128(_mm_loadu_si128((const __m128i*)(in + 8)), 4);
+        str = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        str = _mm256_shuffle_epi8(str, shuf);
+
+        /* Split every 3 bytes into 4 sextets */
+        t0  = _mm256_mulhi_epu16(_mm256_and_si256(str, _mm256_set1_epi32(0x0fc0fc00)),
+                                _mm256_set1_epi32(0x04000040));
+        t1  = _mm256_mullo_epi16(_mm256_and_si256(str, _mm256_set1_epi32(0x003f03f0)),
+                                _mm256_set1_epi32(0x01000010));
+        str = _mm256_or_si256(t0, t1);
+
+        /* Sextets to ASCII, the offset depends on the range the sextet falls in */
+        idx  = _mm256_subs_epu8(str, _mm256_set1_epi8(51));
+        mask = _mm256_cmpgt_epi8(str, _mm256_set1_epi8(25));
+        idx  = _mm256_sub_epi8(idx, mask);
+        str  = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut, idx));
+
+        _mm256_storeu_si256((__m256i*)out, str);
+        in += 24;
+        out += 32;
+        len -= 24;
+    }
+    return in - start;
+}
+
+__attribute__((target("avx2"))) static size_t ovsa_base64_decode_avx2(const unsigned char* in,
+                                                                       size_t len,
+                                                                       unsigned char* out) {
+    const unsigned char* start = in;
+    const __m256i lut_lo  = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b,
+        0x1a, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b,
+        0x1b, 0x1a);
+    const __m256i lut_hi  = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0,
+                                              0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0,
+                                              0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack    = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                                          -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                                          -1);
+    __m256i str, hi_nibbles, lo_nibbles, roll;
+
+    while (len >= 32) {
+        str        = _mm256_loadu_si256((const __m256i*)in);
+        hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        lo_nibbles = _mm256_and_si256(str, mask_2f);
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo_nibbles),
+                                _mm256_shuffle_epi8(lut_hi, hi_nibbles))) {
+            /* Padding, white space or garbage, left to the scalar code */
+            break;
+        }
+
+        roll = _mm256_shuffle_epi8(lut_roll,
+                                   _mm256_add_epi8(_mm256_cmpeq_epi8(str, mask_2f), hi_nibbles));
+        str  = _mm256_add_epi8(str, roll);
+
+        /* Pack 4 sextets into 3 bytes, 24 bytes in the low 6 dwords */
+        str = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        str = _mm256_madd_epi16(str, _mm256_set1_epi32(0x00011000));
+        str = _mm256_shuffle_epi8(str, pack);
+        str = _mm256_permutevar8x32_epi32(str, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(str));
+        _mm_storel_epi64((__m128i*)(out + 16), _mm256_extracti128_si256(str, 1));
+        in += 32;
+        out += 24;
+        len -= 32;
+    }
+    return in - start;
+}
+
+/*
+ * AVX-512 VBMI kernels, 48 bytes to 64 characters per iteration, using the multishift and byte
+ * permute approach described by Wojciech Mula.
+ */
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) static size_t ovsa_base64_encode_avx512(
+    const unsigned char* in, size_t len, char* out) {
+    const unsigned char* start = in;
+    const __m512i shuf   = _mm512_setr_epi32(
+        0x01020001, 0x04050304, 0x07080607, 0x0a0b090a, 0x0d0e0c0d, 0x10110f10, 0x13141213,
+        0x16171516, 0x191a1819, 0x1c1d1b1c, 0x1f201e1f, 0x22232122, 0x25262425, 0x28292728,
+        0x2b2c2a2b, 0x2e2f2d2e);
+    const __m512i shifts = _mm512_set1_epi64(0x3036242a1016040aLL);
+    const __m512i lut    = _mm512_loadu_si512((const void*)g_base64_enc);
+    __m512i str;
+
+    while (len >= 48) {
+        str = _mm512_maskz_loadu_epi8((__mmask64)0xffffffffffffULL, in);
+        str = _mm512_permutexvar_epi8(shuf, str);
+        /* Every output byte gets its sextet in the low 6 bits */
+        str = _mm512_multishift_epi64_epi8(shifts, str);
+        str = _mm512_permutexvar_epi8(str, lut);
+
+        _mm512_storeu_si512((void*)out, str);
+        in += 48;
+        out += 64;
+        len -= 48;
+    }
+    return in - start;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi"))) static size_t ovsa_base64_decode_avx512(
+    const unsigned char* in, size_t len, unsigned char* out) {
+    const unsigned char* start = in;
+    const __m512i lut_lo = _mm512_loadu_si512((const void*)g_base64_dec);
+    const __m512i lut_hi = _mm512_loadu_si512((const void*)(g_base64_dec + 64));
+    const __m512i pack   = _mm512_setr_epi32(
+        0x06000102, 0x090a0405, 0x0c0d0e08, 0x16101112, 0x191a1415, 0x1c1d1e18, 0x26202122,
+        0x292a2425, 0x2c2d2e28, 0x36303132, 0x393a3435, 0x3c3d3e38, 0, 0, 0, 0);
+    __m512i str, sextets;
+
+    while (len >= 64) {
+        str     = _mm512_loadu_si512((const void*)in);
+        sextets = _mm512_permutex2var_epi8(lut_lo, str, lut_hi);
+        /* Non ASCII characters have bit 7 set in str, the others outside the alphabet in the
+         * looked up value */
+        if (_mm512_movepi8_mask(_mm512_or_si512(sextets, str))) {
+            break;
+        }
+
+        str = _mm512_maddubs_epi16(sextets, _mm512_set1_epi32(0x01400140));
+        str = _mm512_madd_epi16(str, _mm512_set1_epi32(0x00011000));
+        str = _mm512_permutexvar_epi8(pack, str);
+
+        _mm512_mask_storeu_epi8(out, (__mmask64)0xffffffffffffULL, str);
+        in += 64;
+        out += 48;
+        len -= 64;
+    }
+    return in - start;
+}
+#endif
+
+/* Encodes the complete triples with the widest kernel the CPU has, the tail is left to the
+ * caller */
+static size_t ovsa_base64_encode_block(const unsigned char* in, size_t len, char* out) {
+    size_t done = 0;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        done = ovsa_base64_encode_avx512(in, len, out);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        done += ovsa_base64_encode_avx2(in + done, len - done, out + done / 3 * 4);
+    }
+#endif
+    return done;
+}
+
+static size_t ovsa_base64_decode_block(const unsigned char* in, size_t len, unsigned char* out) {
+    size_t done = 0;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) {
+        done = ovsa_base64_decode_avx512(in, len, out);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        done += ovsa_base64_decode_avx2(in + done, len - done, out + done / 4 * 3);
+    }
+#endif
+    done += ovsa_base64_decode_scalar(in + done, len - done, out + done / 4 * 3);
+    return done;
+}
+
+size_t ovsa_base64_encode_len(size_t in_buff_len, bool wrap) {
+    size_t len = (in_buff_len + 2) / 3 * 4;
+
+    if (wrap && len > 0) {
+        len += (len + BASE64_LINE_LEN - 1) / BASE64_LINE_LEN;
+    }
+    return len;
+}
+
+size_t ovsa_base64_encode(const unsigned char* in_buff, size_t in_buff_len, bool wrap,
+                          char* out_buff) {
+    char* out = out_buff;
+    size_t line_len, done;
+
+    if (!wrap) {
+        done = ovsa_base64_encode_block(in_buff, in_buff_len, out);
+        out += done / 3 * 4;
+        out += ovsa_base64_encode_scalar(in_buff + done, in_buff_len - done, out);
+    } else {
+        while (in_buff_len > 0) {
+            line_len = (in_buff_len < BASE64_LINE_BYTES) ? in_buff_len : BASE64_LINE_BYTES;
+            done     = ovsa_base64_encode_block(in_buff, line_len, out);
+            out += done / 3 * 4;
+            out += ovsa_base64_encode_scalar(in_buff + done, line_len - done, out);
+            *out++ = '\n';
+            in_buff += line_len;
+            in_buff_len -= line_len;
+        }
+    }
+    *out = '\0';
+    return out - out_buff;
+}
+
+size_t ovsa_base64_decode_len(size_t in_buff_len) {
+    return (in_buff_len + 3) / 4 * 3;
+}
+
+int ovsa_base64_decode(const char* in_buff, size_t in_buff_len, unsigned char* out_buff,
+                       size_t* out_buff_len) {
+    const unsigned char* in  = (const unsigned char*)in_buff;
+    const unsigned char* end = in + in_buff_len;
+    unsigned char* out       = out_buff;
+    uint32_t quad            = 0;
+    size_t count             = 0;
+    size_t pad               = 0;
+    size_t done;
+    uint8_t sextet;
+
+    while (in < end) {
+        if (count == 0 && pad == 0) {
+            done = ovsa_base64_decode_block(in, end - in, out);
+            in += done;
+            out += done / 4 * 3;
+            if (in == end) {
+                break;
+            }
+        }
+
+        if (*in == '\0') {
+            break;
+        }
+        if (*in == '\n' || *in == '\r' || *in == ' ' || *in == '\t') {
+            in++;
+            continue;
+        }
+        if (*in == '=') {
+            /* At most two padding characters and only to complete the last quad */
+            if (count < 2 || count + pad == 4) {
+                return -1;
+            }
+            pad++;
+            in++;
+            continue;
+        }
+
+        sextet = g_base64_dec[*in++];
+        if (pad > 0 || (sextet & BASE64_INVALID)) {
+            return -1;
+        }
+        quad = (quad << 6) | sextet;
+        if (++count == 4) {
+            *out++ = (unsigned char)(quad >> 16);
+            *out++ = (unsigned char)(quad >> 8);
+            *out++ = (unsigned char)quad;
+            quad   = 0;
+            count  = 0;
+        }
+    }
+
+    /* Last quad, padded or not */
+    if (count == 1 || (pad > 0 && count + pad != 4)) {
+        return -1;
+    }
+    if (count > 1) {
+        quad <<= 6 * (4 - count);
+        *out++ = (unsigned char)(quad >> 16);
+        if (count == 3) {
+            *out++ = (unsigned char)(quad >> 8);
+        }
+    }
+
+    *out_buff_len = out - out_buff;
+    return 0;
+}
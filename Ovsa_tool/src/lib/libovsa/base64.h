@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#ifndef __OVSA_BASE64_H_
+#define __OVSA_BASE64_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Base64 codec shared by libovsa and the License Service. It has no dependency on the rest of
+ * libovsa, the vector code paths are picked at run time based on the CPU.
+ */
+
+/** \brief This function returns the length of the base64 encoding of a buffer, without the
+ *         null terminator.
+ *
+ * \param[in]  in_buff_len  Length of the input buffer.
+ * \param[in]  wrap         Flag indicating a new line after every 64 characters and at the end,
+ *                          the same as the OpenSSL base64 BIO.
+ *
+ * \return Length of the encoding
+ */
+size_t ovsa_base64_encode_len(size_t in_buff_len, bool wrap);
+
+/** \brief This function encodes a buffer to base64 and null terminates the output.
+ *
+ * \param[in]  in_buff      Input buffer to encode.
+ * \param[in]  in_buff_len  Length of the input buffer.
+ * \param[in]  wrap         Flag indicating the output is wrapped, see ovsa_base64_encode_len().
+ * \param[out] out_buff     Output buffer of ovsa_base64_encode_len() + 1 bytes.
+ *
+ * \return Length of the encoding
+ */
+size_t ovsa_base64_encode(const unsigned char* in_buff, size_t in_buff_len, bool wrap,
+                          char* out_buff);
+
+/** \brief This function returns the maximum length of the data decoded from a base64 buffer.
+ *
+ * \param[in]  in_buff_len  Length of the base64 buffer.
+ *
+ * \return Maximum length of the decoded data
+ */
+size_t ovsa_base64_decode_len(size_t in_buff_len);
+
+/** \brief This function decodes a base64 buffer. White space is skipped and the decoding stops
+ *         at a null character.
+ *
+ * \param[in]  in_buff      Base64 buffer to decode.
+ * \param[in]  in_buff_len  Length of the base64 buffer.
+ * \param[out] out_buff     Output buffer of ovsa_base64_decode_len() bytes.
+ * \param[out] out_buff_len Length of the decoded data.
+ *
+ * \return 0 on success, -1 if the buffer is not valid base64
+ */
+int ovsa_base64_decode(const char* in_buff, size_t in_buff_len, unsigned char* out_buff,
+                       size_t* out_buff_len);
+
+#endif /* __OVSA_BASE64_H_ */
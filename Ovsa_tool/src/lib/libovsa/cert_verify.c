@@ -18,8 +18,11 @@
 #include <curl/curl.h>
 #include <openssl/err.h>
 #include <openssl/ocsp.h>
+#include <openssl/sha.h>
 #include <openssl/ssl.h>
+#include <pthread.h>
 #include <string.h>
+#include <time.h>
 
 #include "asymmetric.h"
 
@@ -31,6 +34,31 @@
 #define MAX_VALIDITY_PERIOD (10 * 60)
 /* Specify the timeout for OCSP request in seconds */
 #define OCSP_REQ_TIMEOUT 10
+/* Number of verified certificates and OCSP responses kept per process */
+#define CERT_CACHE_MAX_ENTRIES 64
+/* Time in seconds a verified certificate chain is reused for */
+#define CERT_CACHE_TTL (60 * 60)
+/* Time in seconds an OCSP response without nextUpdate is reused for */
+#define OCSP_CACHE_DEFAULT_TTL (5 * 60)
+
+/* Certificate verified earlier in the process, keyed by its SHA256 fingerprint */
+typedef struct ovsa_cert_cache_entry {
+    unsigned char fingerprint[SHA256_DIGEST_LENGTH];
+    time_t valid_until;
+    uint64_t last_used;
+    bool in_use;
+} ovsa_cert_cache_entry_t;
+
+typedef struct ovsa_cert_cache {
+    pthread_mutex_t lock;
+    uint64_t use_count;
+    ovsa_cert_cache_entry_t entries[CERT_CACHE_MAX_ENTRIES];
+} ovsa_cert_cache_t;
+
+static ovsa_cert_cache_t g_verified_chain_cache = {PTHREAD_MUTEX_INITIALIZER};
+#ifdef ENABLE_OCSP_CHECK
+static ovsa_cert_cache_t g_ocsp_response_cache = {PTHREAD_MUTEX_INITIALIZER};
+#endif
 
 static int ovsa_crypto_cert_check(X509_STORE* ctx, const char* cert);
 
@@ -42,7 +70,8 @@ static void ovsa_crypto_policies_print(X509_STORE_CTX* ctx);
 
 static int ovsa_crypto_verify_cb(int ok, X509_STORE_CTX* ctx);
 
-static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert, const char* chain_file);
+static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert, const char* chain_file,
+                                                          time_t* valid_until);
 
 static size_t ovsa_crypto_write_callback(void* data, size_t size, size_t num_items,
                                          FILE* issuer_fp);
@@ -50,7 +79,8 @@ static size_t ovsa_crypto_write_callback(void* data, size_t size, size_t num_ite
 static ovsa_status_t ovsa_crypto_get_issuer_cert(const char* issuer_file_name,
                                                  const char* ca_issuers_uri);
 
-static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert);
+static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert,
+                                                  time_t* valid_until);
 
 static void ovsa_crypto_print_name(BIO* out, const char* title, const X509_NAME* name,
                                    unsigned long flags);
@@ -63,7 +93,8 @@ static ovsa_status_t ovsa_crypto_check_issuer_subject_match(const X509* issuer_c
 
 #ifdef ENABLE_OCSP_CHECK
 static ovsa_status_t ovsa_crypto_ocsp_revocation_check(char* ocsp_uri, const X509* xcert,
-                                                       const char* issuer_cert);
+                                                       const char* issuer_cert,
+                                                       time_t* valid_until);
 
 static ovsa_status_t ovsa_crypto_extract_ocsp_uri(X509* xcert, char** ocsp_uri);
 
@@ -86,10 +117,107 @@ static OCSP_RESPONSE* ovsa_crypto_query_responder(BIO* connect_bio, const char*
                                                   int req_timeout);
 #endif /* ENABLE_OCSP_CHECK */
 
+static ovsa_status_t ovsa_crypto_get_cert_fingerprint(const X509* xcert,
+                                                      unsigned char* fingerprint) {
+    unsigned int fingerprint_len = 0;
+
+    if (!X509_digest(xcert, EVP_sha256(), fingerprint, &fingerprint_len) ||
+        (fingerprint_len != SHA256_DIGEST_LENGTH)) {
+        BIO_printf(g_bio_err, "LibOVSA: Error computing the certificate fingerprint failed\n");
+        return OVSA_CRYPTO_X509_ERROR;
+    }
+    return OVSA_OK;
+}
+
+/* Converts the ASN1 time to time_t, returns 0 if the time could not be decoded */
+static time_t ovsa_crypto_get_asn1_time(const ASN1_TIME* asn1_time) {
+    int days = 0, secs = 0;
+
+    if ((asn1_time == NULL) || !ASN1_TIME_diff(&days, &secs, NULL, asn1_time)) {
+        return 0;
+    }
+    return time(NULL) + (time_t)days * 24 * 60 * 60 + secs;
+}
+
+/*
+ * Returns true if the certificate is cached and not expired. Expired entries are
+ * dropped so that the certificate is verified again.
+ */
+static bool ovsa_crypto_cert_cache_lookup(ovsa_cert_cache_t* cache,
+                                          const unsigned char* fingerprint,
+                                          time_t* valid_until) {
+    ovsa_cert_cache_entry_t* entry = NULL;
+    bool cached                    = false;
+    int diff = 0, i = 0;
+
+    if (pthread_mutex_lock(&cache->lock) != 0) {
+        return false;
+    }
+    for (i = 0; i < CERT_CACHE_MAX_ENTRIES; i++) {
+        entry = &cache->entries[i];
+        if (entry->in_use == false) {
+            continue;
+        }
+        memcmp_s(entry->fingerprint, SHA256_DIGEST_LENGTH, fingerprint, SHA256_DIGEST_LENGTH,
+                 &diff);
+        if (diff != 0) {
+            continue;
+        }
+        if (entry->valid_until > time(NULL)) {
+            entry->last_used = ++cache->use_count;
+            if (valid_until != NULL) {
+                *valid_until = entry->valid_until;
+            }
+            cached = true;
+        } else {
+            entry->in_use = false;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return cached;
+}
+
+/* Adds the certificate to the cache, evicting the least recently used entry if full */
+static void ovsa_crypto_cert_cache_insert(ovsa_cert_cache_t* cache,
+                                          const unsigned char* fingerprint,
+                                          time_t valid_until) {
+    ovsa_cert_cache_entry_t* entry  = NULL;
+    ovsa_cert_cache_entry_t* victim = NULL;
+    int diff = 0, i = 0;
+
+    if (valid_until <= time(NULL)) {
+        return;
+    }
+    if (pthread_mutex_lock(&cache->lock) != 0) {
+        return;
+    }
+    for (i = 0; i < CERT_CACHE_MAX_ENTRIES; i++) {
+        entry = &cache->entries[i];
+        if (entry->in_use == true) {
+            memcmp_s(entry->fingerprint, SHA256_DIGEST_LENGTH, fingerprint,
+                     SHA256_DIGEST_LENGTH, &diff);
+            if (diff == 0) {
+                victim = entry;
+                break;
+            }
+        }
+        if ((victim == NULL) || (victim->in_use == true && entry->in_use == false) ||
+            (victim->in_use == entry->in_use && entry->last_used < victim->last_used)) {
+            victim = entry;
+        }
+    }
+    memcpy_s(victim->fingerprint, SHA256_DIGEST_LENGTH, fingerprint, SHA256_DIGEST_LENGTH);
+    victim->valid_until = valid_until;
+    victim->last_used   = ++cache->use_count;
+    victim->in_use      = true;
+    pthread_mutex_unlock(&cache->lock);
+}
+
 ovsa_status_t ovsa_crypto_extract_pubkey_verify_cert(bool peer_cert, const char* cert,
                                                      bool lifetime_validity_check, int* peer_slot) {
     ovsa_status_t ret = OVSA_OK;
-    int asym_key_slot = -1, asym_key_slot_dup = -1;
+    int asym_key_slot = -1;
     ovsa_isv_keystore_t keystore;
 
     if ((cert == NULL) || (peer_slot == NULL)) {
@@ -110,40 +238,12 @@ ovsa_status_t ovsa_crypto_extract_pubkey_verify_cert(bool peer_cert, const char*
         goto end;
     }
 
-    if (pthread_mutex_lock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error extracting public key and verifying certificate failed in "
-                   "acquiring the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_LOCK_FAIL;
-        goto end;
-    }
-
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore, &asym_key_slot);
+    /* Make a copy of the peer's public key to the secondary key as well */
+    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore, &keystore, &asym_key_slot);
     if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error extracting public key and verifying certificate failed in "
                    "adding to asymmetric keystore array\n");
-        goto exit;
-    }
-
-    /* Make a copy of the peer's public key to next index */
-    ret = ovsa_crypto_add_asymmetric_keystore_array(&keystore, &asym_key_slot_dup);
-    if (ret < OVSA_OK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error extracting public key and verifying certificate failed in "
-                   "adding the peer's public key copy to asymmetric keystore array\n");
-        goto exit;
-    }
-
-    if (pthread_mutex_unlock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error extracting public key and verifying certificate failed in "
-                   "releasing the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_UNLOCK_FAIL;
         goto end;
     }
 
@@ -152,23 +252,12 @@ ovsa_status_t ovsa_crypto_extract_pubkey_verify_cert(bool peer_cert, const char*
         BIO_printf(g_bio_err,
                    "LibOVSA: Error extracting public key and verifying certificate failed in "
                    "verifying the certificate\n");
+        ovsa_crypto_clear_asymmetric_key_slot(asym_key_slot);
         goto end;
     }
 
     /* Return the peer slot containing public key and certificate */
     *peer_slot = asym_key_slot;
-    goto end;
-
-exit:
-    if (pthread_mutex_unlock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error extracting public key and verifying certificate failed in "
-                   "releasing the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_UNLOCK_FAIL;
-        goto end;
-    }
 
 end:
     memset_s(&keystore, sizeof(ovsa_isv_keystore_t), 0);
@@ -635,6 +724,34 @@ static ovsa_status_t ovsa_crypto_print_ocsp_summary(BIO* out, OCSP_BASICRESP* ba
 
     return ret;
 }
+
+/*
+ * Returns the time until which the OCSP response can be reused, 0 if the status of any
+ * of the certificates is not good
+ */
+static time_t ovsa_crypto_get_ocsp_valid_until(OCSP_BASICRESP* basic_response,
+                                               STACK_OF(OCSP_CERTID) * ids) {
+    ASN1_GENERALIZEDTIME* next_update = NULL;
+    time_t valid_until = 0, cert_valid_until = 0;
+    int cert_id_count = 0, status = 0;
+
+    for (cert_id_count = 0; cert_id_count < sk_OCSP_CERTID_num(ids); cert_id_count++) {
+        if (!OCSP_resp_find_status(basic_response, sk_OCSP_CERTID_value(ids, cert_id_count),
+                                   &status, NULL, NULL, NULL, &next_update) ||
+            (status != V_OCSP_CERTSTATUS_GOOD)) {
+            return 0;
+        }
+        if (next_update != NULL) {
+            cert_valid_until = ovsa_crypto_get_asn1_time(next_update);
+        } else {
+            cert_valid_until = time(NULL) + OCSP_CACHE_DEFAULT_TTL;
+        }
+        if ((valid_until == 0) || (cert_valid_until < valid_until)) {
+            valid_until = cert_valid_until;
+        }
+    }
+    return valid_until;
+}
 #endif
 
 static ovsa_status_t ovsa_crypto_print_x509v3_exts(BIO* bio, const X509* xcert,
@@ -999,7 +1116,8 @@ end:
     return ret;
 }
 
-static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert) {
+static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert,
+                                                  time_t* valid_until) {
     ovsa_status_t ret     = OVSA_OK;
     X509_STORE* store     = NULL;
     X509_STORE_CTX* csc   = NULL;
@@ -1010,10 +1128,11 @@ static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert) {
     static int vflags     = 0;
     int verify_cert = 0, chain_count = 0;
 #ifdef ENABLE_OCSP_CHECK
-    char* ocsp_uri = NULL;
+    char* ocsp_uri          = NULL;
+    time_t ocsp_valid_until = 0;
 #endif
 
-    if ((xcert == NULL) || (ca_cert == NULL)) {
+    if ((xcert == NULL) || (ca_cert == NULL) || (valid_until == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error extracting ca certificate failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
@@ -1139,13 +1258,17 @@ static ovsa_status_t ovsa_crypto_extract_ca_cert(X509* xcert, char** ca_cert) {
             }
 
             /* If OCSP URI available, check for OCSP revocation */
-            ret = ovsa_crypto_ocsp_revocation_check(ocsp_uri, xcert, *ca_cert);
+            ret = ovsa_crypto_ocsp_revocation_check(ocsp_uri, xcert, *ca_cert,
+                                                    &ocsp_valid_until);
             if (ret < OVSA_OK) {
                 BIO_printf(g_bio_err,
                            "LibOVSA: Error extracting ca certificate failed to perform the OCSP "
                            "revocation check\n");
                 goto end;
             }
+            if (ocsp_valid_until < *valid_until) {
+                *valid_until = ocsp_valid_until;
+            }
 #endif
             break;
         }
@@ -1163,7 +1286,8 @@ end:
 
 #ifdef ENABLE_OCSP_CHECK
 static ovsa_status_t ovsa_crypto_ocsp_revocation_check(char* ocsp_uri_field, const X509* xcert,
-                                                       const char* issuer_cert) {
+                                                       const char* issuer_cert,
+                                                       time_t* valid_until) {
     ovsa_status_t ret                  = OVSA_OK;
     STACK_OF(X509)* issuers            = NULL;
     X509* issuer                       = NULL;
@@ -1184,12 +1308,26 @@ static ovsa_status_t ovsa_crypto_ocsp_revocation_check(char* ocsp_uri_field, con
     size_t ocsp_uri_field_len = 0;
     long nsec = MAX_VALIDITY_PERIOD, maxage = -1;
     char ocsp_uri[MAX_URL_SIZE];
+    unsigned char fingerprint[SHA256_DIGEST_LENGTH];
 
-    if ((ocsp_uri_field == NULL) || (xcert == NULL) || (issuer_cert == NULL)) {
+    if ((ocsp_uri_field == NULL) || (xcert == NULL) || (issuer_cert == NULL) ||
+        (valid_until == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error ocsp revocation check failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
+    *valid_until = 0;
+
+    /* Reuse the OCSP response of the certificate until its nextUpdate */
+    ret = ovsa_crypto_get_cert_fingerprint(xcert, fingerprint);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+    if (ovsa_crypto_cert_cache_lookup(&g_ocsp_response_cache, fingerprint, valid_until) ==
+        true) {
+        BIO_printf(g_bio_err, "LibOVSA: OCSP status of certificate is good (cached)\n");
+        goto end;
+    }
 
     issuer = ovsa_crypto_load_cert(issuer_cert, "certificate");
     if (issuer == NULL) {
@@ -1380,6 +1518,9 @@ static ovsa_status_t ovsa_crypto_ocsp_revocation_check(char* ocsp_uri_field, con
         goto end;
     }
 
+    *valid_until = ovsa_crypto_get_ocsp_valid_until(basic_response, ids);
+    ovsa_crypto_cert_cache_insert(&g_ocsp_response_cache, fingerprint, *valid_until);
+
 end:
     ovsa_crypto_openssl_free(&ocsp_uri_field);
     sk_X509_pop_free(issuers, X509_free);
@@ -1530,7 +1671,8 @@ end:
 }
 
 static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert,
-                                                          const char* chain_file) {
+                                                          const char* chain_file,
+                                                          time_t* valid_until) {
     ovsa_status_t ret           = OVSA_OK;
     BIO* ca_issuers_bio         = NULL;
     BIO* issuer_cert_bio        = NULL;
@@ -1560,10 +1702,11 @@ static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert,
     char ca_issuers_uri[MAX_URL_SIZE];
     char ca_issuers_field[MAX_URL_SIZE];
 #ifdef ENABLE_OCSP_CHECK
-    char* ocsp_uri = NULL;
+    char* ocsp_uri          = NULL;
+    time_t ocsp_valid_until = 0;
 #endif
 
-    if ((cert == NULL) || (chain_file == NULL)) {
+    if ((cert == NULL) || (chain_file == NULL) || (valid_until == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error forming chain failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
@@ -1705,7 +1848,7 @@ static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert,
          */
         if (ca_issuers == NULL) {
             /* Extract the CA certificate from host */
-            ret = ovsa_crypto_extract_ca_cert(xcert, &ca_cert);
+            ret = ovsa_crypto_extract_ca_cert(xcert, &ca_cert, valid_until);
             if (ret < OVSA_OK) {
                 BIO_printf(g_bio_err,
                            "LibOVSA: Error forming chain failed to extract the CA certificate\n");
@@ -1890,13 +2033,16 @@ static ovsa_status_t ovsa_crypto_form_chain_do_ocsp_check(const char* cert,
         }
 
         /* If OCSP URI available, check for OCSP revocation */
-        ret = ovsa_crypto_ocsp_revocation_check(ocsp_uri, xcert, issuer_dup);
+        ret = ovsa_crypto_ocsp_revocation_check(ocsp_uri, xcert, issuer_dup, &ocsp_valid_until);
         if (ret < OVSA_OK) {
             BIO_printf(g_bio_err,
                        "LibOVSA: Error forming chain failed to perform the OCSP revocation "
                        "check\n");
             goto exit;
         }
+        if (ocsp_valid_until < *valid_until) {
+            *valid_until = ocsp_valid_until;
+        }
 #endif
         /* Write the Intermediate certificate to chain file */
         chain_fp = fopen(chain_file, "a");
@@ -1981,9 +2127,13 @@ ovsa_status_t ovsa_crypto_verify_certificate(int asym_key_slot, bool peer_cert,
     EVP_PKEY* pkey              = NULL;
     X509* xcert                 = NULL;
     int cert_verify             = 0;
+    bool cert_cached            = false;
+    time_t valid_until          = 0;
+    time_t not_after            = 0;
     char public_key[MAX_KEY_SIZE];
+    unsigned char fingerprint[SHA256_DIGEST_LENGTH];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (cert == NULL)) {
+    if ((ovsa_crypto_get_asymmetric_keystore(asym_key_slot) == NULL) || (cert == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying certificate failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
@@ -2061,30 +2211,51 @@ ovsa_status_t ovsa_crypto_verify_certificate(int asym_key_slot, bool peer_cert,
     } else
 #endif
     {
-
-        ret = ovsa_crypto_form_chain_do_ocsp_check(cert, chain_file);
+        /* Skip forming and verifying the chain if the certificate was verified earlier */
+        ret = ovsa_crypto_get_cert_fingerprint(xcert, fingerprint);
         if (ret < OVSA_OK) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error verifying certificate failed since chain file could not be "
-                       "created\n");
             goto end;
         }
+        cert_cached = ovsa_crypto_cert_cache_lookup(&g_verified_chain_cache, fingerprint, NULL);
+        if (cert_cached == true) {
+            BIO_printf(g_bio_err, "LibOVSA: Certificate chain verified OK (cached)\n");
+        } else {
+            /*
+             * The chain is reused until the earliest of the cache TTL, the expiry of the
+             * certificate and the nextUpdate of the OCSP responses of the chain
+             */
+            valid_until = time(NULL) + CERT_CACHE_TTL;
+            not_after   = ovsa_crypto_get_asn1_time(X509_get0_notAfter(xcert));
+            if (not_after < valid_until) {
+                valid_until = not_after;
+            }
 
-        if ((store = ovsa_crypto_setup_chain(chain_file)) == NULL) {
-            BIO_printf(
-                g_bio_err,
-                "LibOVSA: Error verifying certificate failed in storing the certificate chain\n");
-            ret = OVSA_CRYPTO_X509_ERROR;
-            goto end;
-        }
+            ret = ovsa_crypto_form_chain_do_ocsp_check(cert, chain_file, &valid_until);
+            if (ret < OVSA_OK) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error verifying certificate failed since chain file could "
+                           "not be created\n");
+                goto end;
+            }
 
-        X509_STORE_set_verify_cb(store, ovsa_crypto_verify_cb);
+            if ((store = ovsa_crypto_setup_chain(chain_file)) == NULL) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error verifying certificate failed in storing the "
+                           "certificate chain\n");
+                ret = OVSA_CRYPTO_X509_ERROR;
+                goto end;
+            }
 
-        if (ovsa_crypto_cert_check(store, cert) != 0) {
-            BIO_printf(g_bio_err,
-                       "LibOVSA: Error verifying certificate failed in certificate verification\n");
-            ret = OVSA_CRYPTO_X509_ERROR;
-            goto end;
+            X509_STORE_set_verify_cb(store, ovsa_crypto_verify_cb);
+
+            if (ovsa_crypto_cert_check(store, cert) != 0) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error verifying certificate failed in certificate "
+                           "verification\n");
+                ret = OVSA_CRYPTO_X509_ERROR;
+                goto end;
+            }
+            ovsa_crypto_cert_cache_insert(&g_verified_chain_cache, fingerprint, valid_until);
         }
     }
 
@@ -2134,7 +2305,7 @@ end:
     if (store != NULL) {
         X509_STORE_free(store);
     }
-    if (check_self_signed_cert == false) {
+    if ((check_self_signed_cert == false) && (cert_cached == false)) {
         if (remove(chain_file) != 0) {
             BIO_printf(g_bio_err, "LibOVSA: Warning could not delete %s file\n", chain_file);
         }
@@ -2147,19 +2318,20 @@ end:
 
 ovsa_status_t ovsa_crypto_compare_certkey_and_keystore(int asym_key_slot, const char* cert,
                                                        EVP_PKEY** pkey, X509** xcert) {
-    EVP_PKEY* cert_pkey   = NULL;
-    ovsa_status_t ret     = OVSA_OK;
-    size_t public_key_len = 0;
-    int cert_verify       = 0;
+    EVP_PKEY* cert_pkey           = NULL;
+    ovsa_status_t ret             = OVSA_OK;
+    size_t public_key_len         = 0;
+    int cert_verify               = 0;
+    ovsa_isv_keystore_t* keystore = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
     char public_key[MAX_KEY_SIZE];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) || (cert == NULL)) {
+    if ((keystore == NULL) || (cert == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying certificate failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    public_key_len = strnlen_s(g_key_store[asym_key_slot].public_key, MAX_KEY_SIZE);
+    public_key_len = strnlen_s(keystore->public_key, MAX_KEY_SIZE);
     if (public_key_len == EOK) {
         BIO_printf(
             g_bio_err,
@@ -2170,8 +2342,7 @@ ovsa_status_t ovsa_crypto_compare_certkey_and_keystore(int asym_key_slot, const
 
     memset_s(public_key, MAX_KEY_SIZE, 0);
 
-    if (memcpy_s(public_key, public_key_len, g_key_store[asym_key_slot].public_key,
-                 public_key_len) != EOK) {
+    if (memcpy_s(public_key, public_key_len, keystore->public_key, public_key_len) != EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error verifying certificate failed in getting the public key\n");
         ret = OVSA_MEMIO_ERROR;
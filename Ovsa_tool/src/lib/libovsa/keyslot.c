@@ -0,0 +1,351 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#include "keyslot.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * The entries of a table are carved out of chunks that are allocated when the table grows and
+ * never moved or freed before ovsa_crypto_free_key_slots(), so an entry looked up by a thread
+ * stays valid while the others allocate. Released entries are kept in a lock-free free-list
+ * whose head carries a tag against the ABA problem. The chunks are secure memory, so that the
+ * keys never reach swap or a core dump.
+ */
+#define KEY_SLOT_CHUNK_SIZE 64
+#define KEY_SLOT_MAX_CHUNKS ((KEY_SLOT_INDEX_MASK + 1) / KEY_SLOT_CHUNK_SIZE)
+
+/* Header of each table entry */
+typedef struct ovsa_key_slot_hdr {
+    uint32_t generation;
+    uint32_t in_use;
+    uint32_t next_free; /* Index + 1 of the next free entry, 0 ends the list */
+} ovsa_key_slot_hdr_t;
+
+typedef struct ovsa_asym_key_entry {
+    ovsa_key_slot_hdr_t hdr;
+    ovsa_isv_keystore_t keystore[KEY_PAIR_SIZE];
+} ovsa_asym_key_entry_t;
+
+typedef struct ovsa_sym_key_entry {
+    ovsa_key_slot_hdr_t hdr;
+    ovsa_sym_key_t key;
+} ovsa_sym_key_entry_t;
+
+typedef struct ovsa_key_table {
+    char* chunks[KEY_SLOT_MAX_CHUNKS];
+    size_t entry_size;
+    uint32_t max_entries;
+    uint32_t used_entries; /* Entries handed out so far, free or not */
+    uint64_t free_list;    /* Tag in the upper half and index + 1 of the head in the lower */
+} ovsa_key_table_t;
+
+/* Indices of the asymmetric handles address the keys of the pairs, hence half the entries */
+static ovsa_key_table_t g_asym_key_table = {.entry_size  = sizeof(ovsa_asym_key_entry_t),
+                                            .max_entries = (KEY_SLOT_INDEX_MASK + 1) / 2};
+static ovsa_key_table_t g_sym_key_table  = {.entry_size  = sizeof(ovsa_sym_key_entry_t),
+                                           .max_entries = KEY_SLOT_INDEX_MASK + 1};
+
+extern BIO* g_bio_err;
+
+static ovsa_key_slot_hdr_t* ovsa_crypto_get_key_table_entry(ovsa_key_table_t* table,
+                                                            uint32_t index) {
+    char* chunk = NULL;
+
+    if (index >= __atomic_load_n(&table->used_entries, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    chunk = __atomic_load_n(&table->chunks[index / KEY_SLOT_CHUNK_SIZE], __ATOMIC_ACQUIRE);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    return (ovsa_key_slot_hdr_t*)(chunk + (index % KEY_SLOT_CHUNK_SIZE) * table->entry_size);
+}
+
+static ovsa_key_slot_hdr_t* ovsa_crypto_lookup_key_table_entry(ovsa_key_table_t* table,
+                                                               uint32_t index,
+                                                               uint32_t generation) {
+    ovsa_key_slot_hdr_t* hdr = ovsa_crypto_get_key_table_entry(table, index);
+
+    if ((hdr == NULL) || (__atomic_load_n(&hdr->in_use, __ATOMIC_ACQUIRE) == 0) ||
+        ((__atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE) & KEY_SLOT_GENERATION_MASK) !=
+         generation)) {
+        return NULL;
+    }
+    return hdr;
+}
+
+static ovsa_key_slot_hdr_t* ovsa_crypto_grow_key_table(ovsa_key_table_t* table,
+                                                       uint32_t* index) {
+    char* chunk        = NULL;
+    char* expected     = NULL;
+    char** chunk_entry = NULL;
+
+    *index = __atomic_load_n(&table->used_entries, __ATOMIC_RELAXED);
+    do {
+        if (*index >= table->max_entries) {
+            BIO_printf(g_bio_err, "LibOVSA: Error growing the key slots failed since all the %u "
+                                  "key slots are in use\n",
+                       table->max_entries);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&table->used_entries, index, *index + 1, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    /* The first thread needing a chunk publishes it, the threads losing the race free theirs */
+    chunk_entry = &table->chunks[*index / KEY_SLOT_CHUNK_SIZE];
+    if (__atomic_load_n(chunk_entry, __ATOMIC_ACQUIRE) == NULL) {
+        if (ovsa_crypto_secure_malloc(table->entry_size * KEY_SLOT_CHUNK_SIZE, &chunk) < OVSA_OK) {
+            /* The index is lost, the other entries of the chunk retry the allocation */
+            return NULL;
+        }
+        if (!__atomic_compare_exchange_n(chunk_entry, &expected, chunk, false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE)) {
+            ovsa_crypto_secure_free(&chunk);
+        }
+    }
+
+    return ovsa_crypto_get_key_table_entry(table, *index);
+}
+
+static ovsa_status_t ovsa_crypto_alloc_key_table_entry(ovsa_key_table_t* table, uint32_t* index,
+                                                       uint32_t* generation) {
+    uint64_t head            = __atomic_load_n(&table->free_list, __ATOMIC_ACQUIRE);
+    uint64_t next            = 0;
+    ovsa_key_slot_hdr_t* hdr = NULL;
+
+    while ((uint32_t)head != 0) {
+        hdr  = ovsa_crypto_get_key_table_entry(table, (uint32_t)head - 1);
+        next = (((head >> 32) + 1) << 32) | __atomic_load_n(&hdr->next_free, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&table->free_list, &head, next, true, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            *index = (uint32_t)head - 1;
+            goto end;
+        }
+    }
+
+    hdr = ovsa_crypto_grow_key_table(table, index);
+    if (hdr == NULL) {
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+
+end:
+    *generation = __atomic_load_n(&hdr->generation, __ATOMIC_RELAXED) & KEY_SLOT_GENERATION_MASK;
+    __atomic_store_n(&hdr->in_use, 1, __ATOMIC_RELEASE);
+    return OVSA_OK;
+}
+
+/*
+ * Moves the generation of the entry past the one of the handle, which refuses the outstanding
+ * handles before the key is wiped. Only one of the threads releasing the same handle wins, the
+ * others must leave the entry alone.
+ */
+static bool ovsa_crypto_claim_key_table_entry(ovsa_key_slot_hdr_t* hdr, uint32_t generation) {
+    uint32_t current = __atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE);
+
+    do {
+        if ((current & KEY_SLOT_GENERATION_MASK) != generation) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&hdr->generation, &current, current + 1, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return true;
+}
+
+/* Wipes an entry claimed by ovsa_crypto_claim_key_table_entry() and returns it to the free-list */
+static void ovsa_crypto_release_key_table_entry(ovsa_key_table_t* table, uint32_t index,
+                                                ovsa_key_slot_hdr_t* hdr) {
+    uint64_t head = 0;
+    uint64_t next = 0;
+
+    OPENSSL_cleanse((char*)hdr + sizeof(ovsa_key_slot_hdr_t),
+                    table->entry_size - sizeof(ovsa_key_slot_hdr_t));
+    __atomic_store_n(&hdr->in_use, 0, __ATOMIC_RELEASE);
+
+    head = __atomic_load_n(&table->free_list, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&hdr->next_free, (uint32_t)head, __ATOMIC_RELAXED);
+        next = (((head >> 32) + 1) << 32) | (index + 1);
+    } while (!__atomic_compare_exchange_n(&table->free_list, &head, next, true, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+static void ovsa_crypto_free_key_table(ovsa_key_table_t* table) {
+    uint32_t chunk_index = 0;
+
+    for (chunk_index = 0; chunk_index < KEY_SLOT_MAX_CHUNKS; chunk_index++) {
+        if (table->chunks[chunk_index] != NULL) {
+            ovsa_crypto_secure_free(&table->chunks[chunk_index]);
+        }
+    }
+    table->used_entries = 0;
+    table->free_list    = 0;
+}
+
+static ovsa_asym_key_entry_t* ovsa_crypto_lookup_asym_key_entry(int asym_key_slot) {
+    if (asym_key_slot < MIN_KEY_SLOT) {
+        return NULL;
+    }
+    return (ovsa_asym_key_entry_t*)ovsa_crypto_lookup_key_table_entry(
+        &g_asym_key_table, (asym_key_slot & KEY_SLOT_INDEX_MASK) >> 1,
+        asym_key_slot >> KEY_SLOT_INDEX_BITS);
+}
+
+static void ovsa_crypto_free_keystore_certificates(ovsa_asym_key_entry_t* entry) {
+    size_t cert_len = 0;
+    int index       = 0;
+
+    /* Clear primary & secondary certificate from the keystore array */
+    for (index = 0; index < KEY_PAIR_SIZE; index++) {
+        if (entry->keystore[index].isv_certificate != NULL) {
+            ovsa_get_string_length(entry->keystore[index].isv_certificate, &cert_len);
+            if (cert_len != 0) {
+                ovsa_crypto_openssl_free(&entry->keystore[index].isv_certificate);
+            }
+        }
+    }
+}
+
+ovsa_status_t ovsa_crypto_alloc_asymmetric_key_slot(int* asym_key_slot) {
+    ovsa_status_t ret   = OVSA_OK;
+    uint32_t index      = 0;
+    uint32_t generation = 0;
+
+    if (asym_key_slot == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error allocating asymmetric key slot failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    ret = ovsa_crypto_alloc_key_table_entry(&g_asym_key_table, &index, &generation);
+    if (ret < OVSA_OK) {
+        BIO_printf(g_bio_err, "LibOVSA: Error allocating asymmetric key slot failed\n");
+        return ret;
+    }
+
+    *asym_key_slot = (int)((generation << KEY_SLOT_INDEX_BITS) | (index << 1));
+    return ret;
+}
+
+ovsa_isv_keystore_t* ovsa_crypto_get_asymmetric_keystore(int asym_key_slot) {
+    ovsa_asym_key_entry_t* entry = ovsa_crypto_lookup_asym_key_entry(asym_key_slot);
+
+    if (entry == NULL) {
+        return NULL;
+    }
+    return &entry->keystore[asym_key_slot & 1];
+}
+
+uint32_t ovsa_crypto_get_asymmetric_key_slot_count(void) {
+    return __atomic_load_n(&g_asym_key_table.used_entries, __ATOMIC_ACQUIRE);
+}
+
+int ovsa_crypto_get_asymmetric_key_slot_at(uint32_t index) {
+    ovsa_key_slot_hdr_t* hdr = ovsa_crypto_get_key_table_entry(&g_asym_key_table, index);
+
+    if ((hdr == NULL) || (__atomic_load_n(&hdr->in_use, __ATOMIC_ACQUIRE) == 0)) {
+        return -1;
+    }
+    return (int)(((__atomic_load_n(&hdr->generation, __ATOMIC_ACQUIRE) &
+                   KEY_SLOT_GENERATION_MASK)
+                  << KEY_SLOT_INDEX_BITS) |
+                 (index << 1));
+}
+
+void ovsa_crypto_release_asymmetric_key_slot(int asym_key_slot) {
+    ovsa_asym_key_entry_t* entry = ovsa_crypto_lookup_asym_key_entry(asym_key_slot);
+
+    if ((entry == NULL) ||
+        !ovsa_crypto_claim_key_table_entry(&entry->hdr, asym_key_slot >> KEY_SLOT_INDEX_BITS)) {
+        return;
+    }
+
+    ovsa_crypto_free_keystore_certificates(entry);
+    ovsa_crypto_release_key_table_entry(&g_asym_key_table,
+                                        (asym_key_slot & KEY_SLOT_INDEX_MASK) >> 1, &entry->hdr);
+}
+
+ovsa_status_t ovsa_crypto_alloc_symmetric_key_slot(int* sym_key_slot) {
+    ovsa_status_t ret   = OVSA_OK;
+    uint32_t index      = 0;
+    uint32_t generation = 0;
+
+    if (sym_key_slot == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error allocating symmetric key slot failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    ret = ovsa_crypto_alloc_key_table_entry(&g_sym_key_table, &index, &generation);
+    if (ret < OVSA_OK) {
+        BIO_printf(g_bio_err, "LibOVSA: Error allocating symmetric key slot failed\n");
+        return ret;
+    }
+
+    *sym_key_slot = (int)((generation << KEY_SLOT_INDEX_BITS) | index);
+    return ret;
+}
+
+ovsa_sym_key_t* ovsa_crypto_get_symmetric_key(int sym_key_slot) {
+    ovsa_sym_key_entry_t* entry = NULL;
+
+    if (sym_key_slot < MIN_KEY_SLOT) {
+        return NULL;
+    }
+
+    entry = (ovsa_sym_key_entry_t*)ovsa_crypto_lookup_key_table_entry(
+        &g_sym_key_table, sym_key_slot & KEY_SLOT_INDEX_MASK, sym_key_slot >> KEY_SLOT_INDEX_BITS);
+    if (entry == NULL) {
+        return NULL;
+    }
+    return &entry->key;
+}
+
+void ovsa_crypto_release_symmetric_key_slot(int sym_key_slot) {
+    ovsa_sym_key_t* key      = ovsa_crypto_get_symmetric_key(sym_key_slot);
+    ovsa_key_slot_hdr_t* hdr = NULL;
+
+    if (key == NULL) {
+        return;
+    }
+
+    hdr = (ovsa_key_slot_hdr_t*)((char*)key - offsetof(ovsa_sym_key_entry_t, key));
+    if (!ovsa_crypto_claim_key_table_entry(hdr, sym_key_slot >> KEY_SLOT_INDEX_BITS)) {
+        return;
+    }
+    ovsa_crypto_release_key_table_entry(&g_sym_key_table, sym_key_slot & KEY_SLOT_INDEX_MASK,
+                                        hdr);
+}
+
+void ovsa_crypto_free_key_slots(void) {
+    ovsa_key_slot_hdr_t* hdr = NULL;
+    uint32_t index           = 0;
+
+    for (index = 0; index < g_asym_key_table.used_entries; index++) {
+        hdr = ovsa_crypto_get_key_table_entry(&g_asym_key_table, index);
+        if ((hdr != NULL) && (hdr->in_use != 0)) {
+            ovsa_crypto_free_keystore_certificates((ovsa_asym_key_entry_t*)hdr);
+        }
+    }
+
+    /* Clear all the keys in asymmetric and symmetric key slots */
+    ovsa_crypto_free_key_table(&g_asym_key_table);
+    ovsa_crypto_free_key_table(&g_sym_key_table);
+}
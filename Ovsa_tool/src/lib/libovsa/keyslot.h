@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#ifndef __OVSA_KEYSLOT_H_
+#define __OVSA_KEYSLOT_H_
+
+#include <stdint.h>
+
+#include "utils.h"
+
+/*
+ * Key slots are handles into growable tables of asymmetric key pairs and symmetric keys. The
+ * lower bits of a handle are the index of the key in its table and the upper bits the generation
+ * of the entry, which changes whenever the entry is released so that stale handles are refused.
+ * The primary key of a pair has an even index and its secondary key is the handle + 1.
+ */
+#define KEY_SLOT_INDEX_BITS      16
+#define KEY_SLOT_INDEX_MASK      ((1 << KEY_SLOT_INDEX_BITS) - 1)
+#define KEY_SLOT_GENERATION_MASK 0x7FFF
+
+/* Structure of symmetric key slot */
+typedef struct ovsa_sym_key {
+    char sym_key[MAX_EKEY_SIZE];
+    /* key/IV/HMAC in raw form, decoded once when the slot is derived */
+    unsigned char keyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
+    size_t keyiv_hmac_len;
+} ovsa_sym_key_t;
+
+/** \brief This function allocates a zeroed asymmetric key pair.
+ *
+ * \param[out] asym_key_slot  Asymmetric key slot index of the primary key.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_alloc_asymmetric_key_slot(int* asym_key_slot);
+
+/** \brief This function returns the keystore of an asymmetric key slot.
+ *
+ * \param[in]  asym_key_slot  Asymmetric key slot index.
+ *
+ * \return Pointer to keystore or NULL if the slot is not allocated
+ */
+ovsa_isv_keystore_t* ovsa_crypto_get_asymmetric_keystore(int asym_key_slot);
+
+/** \brief This function returns the number of asymmetric key pairs handed out so far, the upper
+ *         bound of the indices to ovsa_crypto_get_asymmetric_key_slot_at().
+ *
+ * \return Number of asymmetric key pairs
+ */
+uint32_t ovsa_crypto_get_asymmetric_key_slot_count(void);
+
+/** \brief This function returns the primary asymmetric key slot of the key pair at an index.
+ *
+ * \param[in]  index  Index of the key pair.
+ *
+ * \return Asymmetric key slot index or -1 if the key pair is not allocated
+ */
+int ovsa_crypto_get_asymmetric_key_slot_at(uint32_t index);
+
+/** \brief This function frees the certificates and zeroes the asymmetric key pair of a key slot
+ *         and returns the pair to the table.
+ *
+ * \param[in]  asym_key_slot  Asymmetric key slot index of the primary or secondary key.
+ */
+void ovsa_crypto_release_asymmetric_key_slot(int asym_key_slot);
+
+/** \brief This function allocates a zeroed symmetric key slot.
+ *
+ * \param[out] sym_key_slot  Symmetric key slot index.
+ *
+ * \return ovsa_status_t: OVSA_OK or OVSA_ERROR
+ */
+ovsa_status_t ovsa_crypto_alloc_symmetric_key_slot(int* sym_key_slot);
+
+/** \brief This function returns the key of a symmetric key slot.
+ *
+ * \param[in]  sym_key_slot  Symmetric key slot index.
+ *
+ * \return Pointer to symmetric key or NULL if the slot is not allocated
+ */
+ovsa_sym_key_t* ovsa_crypto_get_symmetric_key(int sym_key_slot);
+
+/** \brief This function zeroes the key of a symmetric key slot and returns the slot to the table.
+ *
+ * \param[in]  sym_key_slot  Symmetric key slot index.
+ */
+void ovsa_crypto_release_symmetric_key_slot(int sym_key_slot);
+
+/** \brief This function zeroes and frees all the key slots, the handles handed out so far must
+ *         not be used afterwards. It must not run concurrently with any use of the key slots.
+ */
+void ovsa_crypto_free_key_slots(void);
+
+#endif /* __OVSA_KEYSLOT_H_ */
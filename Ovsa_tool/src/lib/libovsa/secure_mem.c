@@ -0,0 +1,131 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#include <openssl/crypto.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+/*
+ * Secure buffers hold decrypted model files and key material. Each buffer is a private anonymous
+ * mapping of its own, locked into memory so that it is never written to swap and excluded from
+ * core dumps. Buffers of a huge page or more are mapped from huge pages when the system has them
+ * reserved, and are otherwise advised for transparent huge pages, which saves page faults and TLB
+ * misses while a large model is decrypted and copied. The header in front of the buffer records
+ * the mapping for ovsa_crypto_secure_free().
+ */
+#define SECURE_MEM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+/* Keeps the buffer aligned for the vector instructions of the cipher and of memcpy */
+#define SECURE_MEM_HEADER_SIZE 64
+#define SECURE_MEM_MAGIC       0x4f56534153454d31ULL /* "OVSASEM1" */
+
+typedef struct ovsa_secure_mem_hdr {
+    uint64_t magic;
+    size_t map_len;
+    size_t size;
+    bool locked;
+} ovsa_secure_mem_hdr_t;
+
+extern BIO* g_bio_err;
+
+static size_t ovsa_crypto_secure_round_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+ovsa_status_t ovsa_crypto_secure_malloc(size_t size, char** buff) {
+    ovsa_secure_mem_hdr_t* hdr = NULL;
+    void* map                  = MAP_FAILED;
+    size_t map_len             = 0;
+    long page_size             = sysconf(_SC_PAGESIZE);
+    static bool lock_warned    = false;
+
+    if ((buff == NULL) || (size == 0) || (size > SIZE_MAX - SECURE_MEM_HUGE_PAGE_SIZE)) {
+        BIO_printf(g_bio_err, "LibOVSA: Error secure memory allocation failed with invalid "
+                              "input parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+    *buff = NULL;
+    if (page_size <= 0)
+        page_size = 4096;
+
+    if (size + SECURE_MEM_HEADER_SIZE >= SECURE_MEM_HUGE_PAGE_SIZE) {
+        map_len = ovsa_crypto_secure_round_up(size + SECURE_MEM_HEADER_SIZE,
+                                              SECURE_MEM_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        map = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (map == MAP_FAILED) {
+            map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (map != MAP_FAILED)
+                (void)madvise(map, map_len, MADV_HUGEPAGE);
+#endif
+        }
+    } else {
+        map_len = ovsa_crypto_secure_round_up(size + SECURE_MEM_HEADER_SIZE, (size_t)page_size);
+        map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (map == MAP_FAILED) {
+        BIO_printf(g_bio_err, "LibOVSA: Error in allocating %zu bytes of secure memory\n", size);
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+
+#ifdef MADV_DONTDUMP
+    (void)madvise(map, map_len, MADV_DONTDUMP);
+#endif
+    hdr          = (ovsa_secure_mem_hdr_t*)map;
+    hdr->magic   = SECURE_MEM_MAGIC;
+    hdr->map_len = map_len;
+    hdr->size    = size;
+    /* Not fatal, locking beyond RLIMIT_MEMLOCK fails for large models unless it is raised */
+    hdr->locked = (mlock(map, map_len) == 0);
+    if (!hdr->locked && !__atomic_exchange_n(&lock_warned, true, __ATOMIC_RELAXED)) {
+        BIO_printf(g_bio_err, "LibOVSA: Warning secure memory could not be locked, check "
+                              "RLIMIT_MEMLOCK\n");
+    }
+
+    /* Anonymous mappings are zeroed */
+    *buff = (char*)map + SECURE_MEM_HEADER_SIZE;
+    return OVSA_OK;
+}
+
+void ovsa_crypto_secure_free(char** buff) {
+    ovsa_secure_mem_hdr_t* hdr = NULL;
+    size_t map_len             = 0;
+
+    if ((buff == NULL) || (*buff == NULL))
+        return;
+
+    hdr = (ovsa_secure_mem_hdr_t*)(*buff - SECURE_MEM_HEADER_SIZE);
+    if (hdr->magic != SECURE_MEM_MAGIC) {
+        BIO_printf(g_bio_err, "LibOVSA: Error freeing secure memory failed since the buffer was "
+                              "not allocated by ovsa_crypto_secure_malloc\n");
+        return;
+    }
+    /* OPENSSL_cleanse zeroes whole words with the vectorized memset and is not optimized out */
+    OPENSSL_cleanse(*buff, hdr->size);
+    map_len = hdr->map_len;
+    if (hdr->locked)
+        (void)munlock(hdr, map_len);
+    OPENSSL_cleanse(hdr, sizeof(ovsa_secure_mem_hdr_t));
+    munmap(hdr, map_len);
+    *buff = NULL;
+}
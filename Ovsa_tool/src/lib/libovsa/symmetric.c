@@ -29,16 +29,45 @@
 #ifndef ENABLE_SGX_GRAMINE
 #include "tpm.h"
 #endif
+#include "base64.h"
 #include "utils.h"
 /* Include at last due to dependency */
 #include "symmetric.h"
 
+/* Size of the chunks ovsa_crypto_decrypt_mem_stream() hands over the plain text in */
+#define DECRYPT_STREAM_CHUNK_SIZE (64 * 1024)
+
+/* AES block, the unit the CTR mode counter is incremented by */
+#define AES_CTR_BLOCK_SIZE 16
+
+/* Size of the chunks ovsa_crypto_encrypt_mem_range() encodes, a multiple of 3 for base64 */
+#define ENCRYPT_STREAM_CHUNK_SIZE (48 * 1024)
+
+/* Nonce length of AES-256-GCM, the first bytes of the derived IV */
+#define GCM_NONCE_LEN 12
+
 static ovsa_status_t ovsa_crypto_RNG(int key_size, char* symmetric_key);
 
 static EVP_PKEY_CTX* ovsa_crypto_init_ctx(EVP_PKEY* pkey);
 
 static int ovsa_crypto_setup_peer(EVP_PKEY_CTX* ctx, EVP_PKEY* pkey);
 
+static ovsa_status_t ovsa_crypto_do_encrypt_mem(int sym_key_slot, const char* in_buff,
+                                                size_t in_buff_len, char* magic_salt_buff_ptr,
+                                                bool b64_format, char** out_buff,
+                                                size_t* out_buff_len, int* keyiv_hmac_slot);
+
+static ovsa_status_t ovsa_crypto_get_keyiv(int keyiv_hmac_slot, unsigned char* key,
+                                           unsigned char* iv);
+
+static ovsa_status_t ovsa_crypto_init_cipher_ctx(int keyiv_hmac_slot, size_t offset, int enc,
+                                                 EVP_CIPHER_CTX* ctx);
+
+static ovsa_status_t ovsa_crypto_decrypt_chunk(EVP_CIPHER_CTX* ctx, const unsigned char* buff,
+                                               int buff_len, unsigned char* plain_buff,
+                                               ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                               size_t* out_buff_len);
+
 static ovsa_status_t ovsa_crypto_RNG(int key_size, char* symmetric_key) {
     ovsa_status_t ret   = OVSA_OK;
     BUF_MEM* symkey_ptr = NULL;
@@ -160,32 +189,32 @@ static int ovsa_crypto_setup_peer(EVP_PKEY_CTX* ctx, EVP_PKEY* pkey) {
 }
 
 ovsa_status_t ovsa_crypto_create_ecdh_key(int asym_key_slot, int peer_key_slot, int* sym_key_slot) {
-    ovsa_status_t ret       = OVSA_OK;
-    BUF_MEM* shared_key_ptr = NULL;
-    BIO* shared_key_mem     = NULL;
-    BIO* shared_key_bio     = NULL;
-    unsigned char* buff     = NULL;
-    EVP_PKEY* peerkey       = NULL;
-    EVP_PKEY_CTX* ctx       = NULL;
-    EVP_PKEY* pkey          = NULL;
-    size_t buff_len         = 0;
-    char* cert              = NULL;
-    BIO* b64                = NULL;
-    int status              = -1;
+    ovsa_status_t ret                  = OVSA_OK;
+    BUF_MEM* shared_key_ptr            = NULL;
+    BIO* shared_key_mem                = NULL;
+    BIO* shared_key_bio                = NULL;
+    unsigned char* buff                = NULL;
+    EVP_PKEY* peerkey                  = NULL;
+    EVP_PKEY_CTX* ctx                  = NULL;
+    EVP_PKEY* pkey                     = NULL;
+    size_t buff_len                    = 0;
+    char* cert                         = NULL;
+    BIO* b64                           = NULL;
+    int status                         = -1;
+    ovsa_isv_keystore_t* keystore      = ovsa_crypto_get_asymmetric_keystore(asym_key_slot);
+    ovsa_isv_keystore_t* peer_keystore = ovsa_crypto_get_asymmetric_keystore(peer_key_slot);
     size_t private_key_len = 0, public_key_len = 0;
     char peer_key[MAX_KEY_SIZE];
     char private_key[MAX_KEY_SIZE];
     char shared_key[MAX_EKEY_SIZE];
     unsigned char sha512[SHA512_DIGEST_LENGTH];
 
-    if ((asym_key_slot < MIN_KEY_SLOT) || (asym_key_slot >= MAX_KEY_SLOT) ||
-        (peer_key_slot < MIN_KEY_SLOT) || (peer_key_slot >= MAX_KEY_SLOT) ||
-        (sym_key_slot == NULL)) {
+    if ((keystore == NULL) || (peer_keystore == NULL) || (sym_key_slot == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error creating ecdh key failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    private_key_len = strnlen_s(g_key_store[asym_key_slot].private_key, MAX_KEY_SIZE);
+    private_key_len = strnlen_s(keystore->private_key, MAX_KEY_SIZE);
     if (private_key_len == EOK) {
         BIO_printf(
             g_bio_err,
@@ -195,8 +224,7 @@ ovsa_status_t ovsa_crypto_create_ecdh_key(int asym_key_slot, int peer_key_slot,
 
     memset_s(private_key, MAX_KEY_SIZE, 0);
 
-    if (memcpy_s(private_key, MAX_KEY_SIZE, g_key_store[asym_key_slot].private_key,
-                 private_key_len) != EOK) {
+    if (memcpy_s(private_key, MAX_KEY_SIZE, keystore->private_key, private_key_len) != EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error creating ecdh key failed in getting the private key\n");
         return OVSA_MEMIO_ERROR;
@@ -204,7 +232,7 @@ ovsa_status_t ovsa_crypto_create_ecdh_key(int asym_key_slot, int peer_key_slot,
 
     memset_s(peer_key, MAX_KEY_SIZE, 0);
 
-    public_key_len = strnlen_s(g_key_store[peer_key_slot].public_key, MAX_KEY_SIZE);
+    public_key_len = strnlen_s(peer_keystore->public_key, MAX_KEY_SIZE);
     if (public_key_len == EOK) {
         BIO_printf(
             g_bio_err,
@@ -212,8 +240,7 @@ ovsa_status_t ovsa_crypto_create_ecdh_key(int asym_key_slot, int peer_key_slot,
         return OVSA_CRYPTO_GENERIC_ERROR;
     }
 
-    if (memcpy_s(peer_key, MAX_KEY_SIZE, g_key_store[peer_key_slot].public_key, public_key_len) !=
-        EOK) {
+    if (memcpy_s(peer_key, MAX_KEY_SIZE, peer_keystore->public_key, public_key_len) != EOK) {
         BIO_printf(g_bio_err, "LibOVSA: Error creating ecdh key failed in getting the peer key\n");
         return OVSA_MEMIO_ERROR;
     }
@@ -347,8 +374,9 @@ end:
 ovsa_status_t ovsa_crypto_add_symmetric_keystore_array(const char* symmetric_key,
                                                        int* sym_key_slot) {
     ovsa_status_t ret        = OVSA_OK;
-    int symmetric_index      = 0;
-    size_t symmetric_key_len = 0, sym_key_len = 0;
+    int symmetric_index      = -1;
+    size_t symmetric_key_len = 0;
+    ovsa_sym_key_t* sym_key  = NULL;
 
     if ((symmetric_key == NULL) || (sym_key_slot == NULL)) {
         BIO_printf(
@@ -357,60 +385,32 @@ ovsa_status_t ovsa_crypto_add_symmetric_keystore_array(const char* symmetric_key
         return OVSA_INVALID_PARAMETER;
     }
 
-    if (pthread_mutex_lock(&g_symmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error adding to symmetric keystore array failed in acquiring the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        return OVSA_MUTEX_LOCK_FAIL;
-    }
-
     symmetric_key_len = strnlen_s(symmetric_key, MAX_EKEY_SIZE);
     if (symmetric_key_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error adding to symmetric keystore array failed in getting the size "
                    "of the symmetric key\n");
-        ret = OVSA_CRYPTO_GENERIC_ERROR;
-        goto end;
-    }
-
-    for (symmetric_index = 0; symmetric_index < MAX_KEY_SLOT; symmetric_index++) {
-        sym_key_len = strnlen_s(g_sym_key[symmetric_index], MAX_EKEY_SIZE);
-        if (sym_key_len == 0) {
-            if (memcpy_s(g_sym_key[symmetric_index], MAX_EKEY_SIZE, symmetric_key,
-                         symmetric_key_len) != EOK) {
-                BIO_printf(
-                    g_bio_err,
-                    "LibOVSA: Error adding to symmetric keystore array failed in getting the "
-                    "symmetric key\n");
-                ret = OVSA_MEMIO_ERROR;
-                goto end;
-            }
-
-            *sym_key_slot = symmetric_index;
-            break;
-        } else {
-            continue;
-        }
+        return OVSA_CRYPTO_GENERIC_ERROR;
     }
 
-    if (symmetric_index == MAX_KEY_SLOT) {
-        ret = OVSA_CRYPTO_GENERIC_ERROR;
+    ret = ovsa_crypto_alloc_symmetric_key_slot(&symmetric_index);
+    if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error adding to symmetric keystore array failed since not able to "
                    "store the symmetric key\n");
-        goto end;
+        return ret;
     }
 
-end:
-    if (pthread_mutex_unlock(&g_symmetric_index_lock) != 0) {
+    sym_key = ovsa_crypto_get_symmetric_key(symmetric_index);
+    if (memcpy_s(sym_key->sym_key, MAX_EKEY_SIZE, symmetric_key, symmetric_key_len) != EOK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error adding to symmetric keystore array failed in releasing the "
-                   "mutex with error code = %s\n",
-                   strerror(errno));
-        return OVSA_MUTEX_UNLOCK_FAIL;
+                   "LibOVSA: Error adding to symmetric keystore array failed in getting the "
+                   "symmetric key\n");
+        ovsa_crypto_release_symmetric_key_slot(symmetric_index);
+        return OVSA_MEMIO_ERROR;
     }
 
+    *sym_key_slot = symmetric_index;
     return ret;
 }
 
@@ -449,26 +449,27 @@ ovsa_status_t ovsa_crypto_derive_keyiv_hmac(int sym_key_slot, const char* in_buf
                                             size_t in_buff_len, int* keyiv_hmac_slot) {
     int iklen = 0, ivlen = 0, hmaclen = 0, islen = 0;
     unsigned char tmpkeyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
-    static const char magic[] = "Salted__";
-    ovsa_status_t ret         = OVSA_OK;
-    const EVP_CIPHER* cipher  = NULL;
-    BIO* read_mem             = NULL;
-    BIO* read_bio             = NULL;
-    BIO* keyiv_hmac_bio       = NULL;
-    BIO* keyiv_hmac_write_bio = NULL;
-    BIO* b64                  = NULL;
-    BIO* keyiv_hmac_b64       = NULL;
-    BUF_MEM* keyiv_hmac_ptr   = NULL;
-    EVP_PKEY_CTX* pctx        = NULL;
-    size_t outlen             = 0;
-    size_t secret_len         = 0;
+    static const char magic[]      = "Salted__";
+    ovsa_status_t ret              = OVSA_OK;
+    const EVP_CIPHER* cipher       = NULL;
+    BIO* read_mem                  = NULL;
+    BIO* read_bio                  = NULL;
+    BIO* keyiv_hmac_bio            = NULL;
+    BIO* keyiv_hmac_write_bio      = NULL;
+    BIO* b64                       = NULL;
+    BIO* keyiv_hmac_b64            = NULL;
+    BUF_MEM* keyiv_hmac_ptr        = NULL;
+    EVP_PKEY_CTX* pctx             = NULL;
+    size_t outlen                  = 0;
+    size_t secret_len              = 0;
+    ovsa_sym_key_t* sym_key        = ovsa_crypto_get_symmetric_key(sym_key_slot);
+    ovsa_sym_key_t* keyiv_hmac_key = NULL;
     unsigned char salt[PKCS5_SALT_LEN];
     char mbuff[sizeof(magic) - 1];
     char secret[MAX_EKEY_SIZE];
     char keyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
 
-    if ((sym_key_slot < MIN_KEY_SLOT) || (sym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
-        (in_buff_len == 0) || (keyiv_hmac_slot == NULL)) {
+    if ((sym_key == NULL) || (in_buff == NULL) || (in_buff_len == 0) || (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error generating key/IV/HMAC failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
@@ -505,7 +506,7 @@ ovsa_status_t ovsa_crypto_derive_keyiv_hmac(int sym_key_slot, const char* in_buf
         goto end;
     }
 
-    secret_len = strnlen_s(g_sym_key[sym_key_slot], MAX_EKEY_SIZE);
+    secret_len = strnlen_s(sym_key->sym_key, MAX_EKEY_SIZE);
     if (secret_len == EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error generating key/IV/HMAC failed in getting the size of secret\n");
@@ -515,7 +516,7 @@ ovsa_status_t ovsa_crypto_derive_keyiv_hmac(int sym_key_slot, const char* in_buf
 
     memset_s(secret, MAX_EKEY_SIZE, 0);
 
-    if (memcpy_s(secret, MAX_EKEY_SIZE, g_sym_key[sym_key_slot], secret_len) != EOK) {
+    if (memcpy_s(secret, MAX_EKEY_SIZE, sym_key->sym_key, secret_len) != EOK) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error generating key/IV/HMAC failed in getting the secret\n");
         ret = OVSA_MEMIO_ERROR;
@@ -634,6 +635,17 @@ ovsa_status_t ovsa_crypto_derive_keyiv_hmac(int sym_key_slot, const char* in_buf
         goto end;
     }
 
+    /* Keep the raw key material as well, the cipher setup of the slot skips the decoding */
+    keyiv_hmac_key = ovsa_crypto_get_symmetric_key(*keyiv_hmac_slot);
+    if (memcpy_s(keyiv_hmac_key->keyiv_hmac, MAX_KEYIV_HMAC_LENGTH, tmpkeyiv_hmac,
+                 iklen + ivlen + hmaclen) != EOK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error generating key/IV/HMAC failed in getting the raw key/IV/HMAC\n");
+        ret = OVSA_MEMIO_ERROR;
+        goto end;
+    }
+    keyiv_hmac_key->keyiv_hmac_len = iklen + ivlen + hmaclen;
+
 end:
     OPENSSL_cleanse(keyiv_hmac, MAX_KEYIV_HMAC_LENGTH);
     OPENSSL_cleanse(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH);
@@ -736,35 +748,17 @@ end:
     return ret;
 }
 
-ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, size_t in_buff_len,
-                                      char* magic_salt_buff_ptr, char** out_buff,
-                                      size_t* out_buff_len, int* keyiv_hmac_slot) {
-    unsigned char key[EVP_MAX_KEY_LENGTH], iv[EVP_MAX_IV_LENGTH];
-    unsigned char tmpkeyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
-    int read_len = 0, iklen = 0, ivlen = 0;
-    static const char magic[] = "Salted__";
-    ovsa_status_t ret         = OVSA_OK;
-    const EVP_CIPHER* cipher  = NULL;
-    BUF_MEM* encrypt_ptr      = NULL;
-    unsigned char* buff       = NULL;
-    EVP_CIPHER_CTX* ctx       = NULL;
-    BIO* cipher_bio           = NULL;
-    BIO* write_bio            = NULL;
-    BIO* read_bio             = NULL;
-    BIO* keyiv_hmac_bio       = NULL;
-    BIO* keyiv_hmac_read_bio  = NULL;
-    BIO* benc                 = NULL;
-    BIO* b64                  = NULL;
-    BIO* keyiv_hmac_b64       = NULL;
-    BIO* magic_salt_bio       = NULL;
-    BIO* magic_salt_read_bio  = NULL;
-    BIO* magic_salt_b64       = NULL;
-    size_t keyiv_hmac_len = 0, magic_salt_len = 0;
-    size_t magic_salt_buff_len = 0, magic_salt_buff_ptr_len = 0;
-    char magic_salt[MAX_MAGIC_SALT_LENGTH];
-    char magic_salt_buff[MAX_MAGIC_SALT_LENGTH];
-
-    if ((sym_key_slot < MIN_KEY_SLOT) || (sym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+static ovsa_status_t ovsa_crypto_do_encrypt_mem(int sym_key_slot, const char* in_buff,
+                                                size_t in_buff_len, char* magic_salt_buff_ptr,
+                                                bool b64_format, char** out_buff,
+                                                size_t* out_buff_len, int* keyiv_hmac_slot) {
+    ovsa_status_t ret              = OVSA_OK;
+    size_t magic_salt_buff_ptr_len = 0;
+    size_t encrypt_len             = 0;
+    unsigned char decode_buff[MAX_MAGIC_SALT_LENGTH];
+    char magic_salt[ENCRYPT_HEADER_LEN];
+
+    if ((ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (out_buff == NULL) || (out_buff_len == NULL) ||
         (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err,
@@ -772,27 +766,10 @@ ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, siz
         return OVSA_INVALID_PARAMETER;
     }
 
-    if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the b64 encode "
-                   "method\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    read_bio = BIO_new_mem_buf(in_buff, in_buff_len);
-    if (read_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in creating new BIO for the "
-                   "input buffer\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
+    memset_s(decode_buff, sizeof(decode_buff), 0);
     memset_s(magic_salt, sizeof(magic_salt), 0);
-    memset_s(magic_salt_buff, sizeof(magic_salt_buff), 0);
     if (magic_salt_buff_ptr == NULL) {
-        ret = ovsa_crypto_generate_salt(NULL, magic_salt_buff);
+        ret = ovsa_crypto_init_encrypt_range(sym_key_slot, magic_salt, keyiv_hmac_slot);
         if (ret < OVSA_OK) {
             BIO_printf(g_bio_err,
                        "LibOVSA: Error encrypting the memory buffer failed in generating salt\n");
@@ -808,132 +785,147 @@ ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, siz
             goto end;
         }
 
-        if (memcpy_s(magic_salt_buff, MAX_MAGIC_SALT_LENGTH, magic_salt_buff_ptr,
-                     magic_salt_buff_ptr_len) != EOK) {
+        if (EVP_DecodeBlock(decode_buff, (const unsigned char*)magic_salt_buff_ptr,
+                            (int)magic_salt_buff_ptr_len) < ENCRYPT_HEADER_LEN) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error encrypting the memory buffer failed in decoding the "
+                       "magic_salt buffer\n");
+            ret = OVSA_CRYPTO_GENERIC_ERROR;
+            goto end;
+        }
+        if (memcpy_s(magic_salt, ENCRYPT_HEADER_LEN, decode_buff, ENCRYPT_HEADER_LEN) != EOK) {
             BIO_printf(g_bio_err,
                        "LibOVSA: Error encrypting the memory buffer failed to get the magic_salt "
                        "buffer\n");
             ret = OVSA_MEMIO_ERROR;
             goto end;
         }
-    }
-
-    magic_salt_read_bio = BIO_new(BIO_s_mem());
-    if (magic_salt_read_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting new BIO for the "
-                   "magic_salt\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
 
-    magic_salt_bio = magic_salt_read_bio;
-    if (BIO_puts(magic_salt_read_bio, magic_salt_buff) <= 0) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in writing to magic_salt BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+        ret = ovsa_crypto_derive_keyiv_hmac(sym_key_slot, magic_salt_buff_ptr,
+                                            magic_salt_buff_ptr_len, keyiv_hmac_slot);
+        if (ret < OVSA_OK) {
+            BIO_printf(
+                g_bio_err,
+                "LibOVSA: Error encrypting the memory buffer failed in deriving the key/IV/HMAC\n");
+            goto end;
+        }
     }
 
-    if ((magic_salt_b64 = BIO_new(BIO_f_base64())) == NULL) {
+    /* App needs to free this memory */
+    encrypt_len = ovsa_crypto_get_encrypt_mem_pos(in_buff_len, b64_format);
+    *out_buff   = ovsa_crypto_app_malloc(encrypt_len + NULL_TERMINATOR, "encrypted buffer");
+    if (*out_buff == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the b64 encode "
-                   "method for magic_salt\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+                   "LibOVSA: Error encrypting the memory buffer failed in allocating memory for "
+                   "encrypted buffer\n");
+        ret = OVSA_MEMORY_ALLOC_FAIL;
         goto end;
     }
 
-    BIO_set_flags(magic_salt_b64, BIO_FLAGS_BASE64_NO_NL);
-    magic_salt_bio      = BIO_push(magic_salt_b64, magic_salt_bio);
-    magic_salt_buff_len = strnlen_s(magic_salt_buff, MAX_MAGIC_SALT_LENGTH);
-    if (magic_salt_buff_len == EOK) {
+    /* The whole buffer is one range, encrypted and encoded without any BIO in between */
+    ret = ovsa_crypto_encrypt_mem_range(*keyiv_hmac_slot, magic_salt, in_buff, 0, in_buff_len,
+                                        b64_format, *out_buff);
+    if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the size for "
-                   "magic_salt\n");
-        ret = OVSA_CRYPTO_GENERIC_ERROR;
+                   "LibOVSA: Error encrypting the memory buffer failed in encrypting the buffer\n");
+        ovsa_crypto_openssl_free(out_buff);
         goto end;
     }
+    (*out_buff)[encrypt_len] = '\0';
+    *out_buff_len            = encrypt_len;
 
-    magic_salt_len = BIO_read(magic_salt_bio, magic_salt, magic_salt_buff_len);
-    if (magic_salt_len <= 0) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in reading to magic_salt BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+end:
+    OPENSSL_cleanse(decode_buff, sizeof(decode_buff));
+    OPENSSL_cleanse(magic_salt, sizeof(magic_salt));
+    if (magic_salt_buff_ptr != NULL) {
+        OPENSSL_cleanse(magic_salt_buff_ptr, magic_salt_buff_ptr_len);
     }
-
-    write_bio = BIO_new(BIO_s_mem());
-    if (write_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting new BIO for "
-                   "output buffer\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
     }
+    return ret;
+}
 
-    cipher_bio = write_bio;
-    BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-    cipher_bio = BIO_push(b64, cipher_bio);
+ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, size_t in_buff_len,
+                                      char* magic_salt_buff_ptr, char** out_buff,
+                                      size_t* out_buff_len, int* keyiv_hmac_slot) {
+    return ovsa_crypto_do_encrypt_mem(sym_key_slot, in_buff, in_buff_len, magic_salt_buff_ptr,
+                                      /* b64_format */ true, out_buff, out_buff_len,
+                                      keyiv_hmac_slot);
+}
 
-    /* Write magic and salt to the cipher BIO */
-    if (BIO_write(cipher_bio, magic_salt, sizeof(magic) - 1) != sizeof(magic) - 1 ||
-        BIO_write(cipher_bio, magic_salt + (sizeof(magic) - 1), PKCS5_SALT_LEN) != PKCS5_SALT_LEN) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in writing to cipher BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
+ovsa_status_t ovsa_crypto_encrypt_raw_mem(int sym_key_slot, const char* in_buff,
+                                          size_t in_buff_len, char** out_buff,
+                                          size_t* out_buff_len, int* keyiv_hmac_slot) {
+    return ovsa_crypto_do_encrypt_mem(sym_key_slot, in_buff, in_buff_len, NULL,
+                                      /* b64_format */ false, out_buff, out_buff_len,
+                                      keyiv_hmac_slot);
+}
 
-    ret = ovsa_crypto_derive_keyiv_hmac(sym_key_slot, magic_salt_buff, magic_salt_buff_len,
-                                        keyiv_hmac_slot);
-    if (ret < OVSA_OK) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in deriving the key/IV/HMAC\n");
-        goto end;
+static ovsa_status_t ovsa_crypto_get_keyiv(int keyiv_hmac_slot, unsigned char* key,
+                                           unsigned char* iv) {
+    unsigned char tmpkeyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
+    int iklen = 0, ivlen = 0;
+    ovsa_status_t ret              = OVSA_OK;
+    const EVP_CIPHER* cipher       = NULL;
+    BIO* keyiv_hmac_read_bio       = NULL;
+    BIO* keyiv_hmac_bio            = NULL;
+    BIO* keyiv_hmac_b64            = NULL;
+    size_t keyiv_hmac_len          = 0;
+    ovsa_sym_key_t* keyiv_hmac_key = ovsa_crypto_get_symmetric_key(keyiv_hmac_slot);
+
+    if (keyiv_hmac_key == NULL) {
+        BIO_printf(g_bio_err, "LibOVSA: Error getting the key/iv failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
     }
 
     cipher = EVP_aes_256_ctr();
     iklen  = EVP_CIPHER_key_length(cipher);
     ivlen  = EVP_CIPHER_iv_length(cipher);
 
+    /* Slots derived by ovsa_crypto_derive_keyiv_hmac() carry the decoded key material */
+    if (keyiv_hmac_key->keyiv_hmac_len >= (size_t)(iklen + ivlen)) {
+        if ((memcpy_s(key, EVP_MAX_KEY_LENGTH, keyiv_hmac_key->keyiv_hmac, iklen) != EOK) ||
+            (memcpy_s(iv, EVP_MAX_IV_LENGTH, keyiv_hmac_key->keyiv_hmac + iklen, ivlen) != EOK)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error getting the key/iv failed in copying the key material\n");
+            return OVSA_MEMIO_ERROR;
+        }
+        return OVSA_OK;
+    }
+
     memset_s(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH, 0);
-    memset_s(key, EVP_MAX_KEY_LENGTH, 0);
-    memset_s(iv, EVP_MAX_IV_LENGTH, 0);
 
     keyiv_hmac_read_bio = BIO_new(BIO_s_mem());
     if (keyiv_hmac_read_bio == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting new BIO for the "
+                   "LibOVSA: Error getting the key/iv failed in getting new BIO for the "
                    "keyiv_hmac buffer\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
 
     keyiv_hmac_bio = keyiv_hmac_read_bio;
-    if (BIO_puts(keyiv_hmac_read_bio, g_sym_key[*keyiv_hmac_slot]) <= 0) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in writing to keyiv_hmac BIO\n");
+    if (BIO_puts(keyiv_hmac_read_bio, keyiv_hmac_key->sym_key) <= 0) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error getting the key/iv failed in writing to keyiv_hmac BIO\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
 
     if ((keyiv_hmac_b64 = BIO_new(BIO_f_base64())) == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the b64 encode "
-                   "method for keyiv_hmac\n");
+                   "LibOVSA: Error getting the key/iv failed in getting the b64 encode method "
+                   "for keyiv_hmac\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
 
     keyiv_hmac_bio = BIO_push(keyiv_hmac_b64, keyiv_hmac_bio);
-    keyiv_hmac_len = strnlen_s(g_sym_key[*keyiv_hmac_slot], MAX_KEYIV_HMAC_LENGTH);
+    keyiv_hmac_len = strnlen_s(keyiv_hmac_key->sym_key, MAX_KEYIV_HMAC_LENGTH);
     if (keyiv_hmac_len == EOK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the size for "
+                   "LibOVSA: Error getting the key/iv failed in getting the size for "
                    "keyiv_hmac\n");
         ret = OVSA_CRYPTO_GENERIC_ERROR;
         goto end;
@@ -941,174 +933,162 @@ ovsa_status_t ovsa_crypto_encrypt_mem(int sym_key_slot, const char* in_buff, siz
 
     keyiv_hmac_len = BIO_read(keyiv_hmac_bio, tmpkeyiv_hmac, keyiv_hmac_len);
     if (keyiv_hmac_len <= 0) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in reading to keyiv_hmac BIO\n");
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error getting the key/iv failed in reading to keyiv_hmac BIO\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
 
     /* Split and move data back to buffer */
     if (memcpy_s(key, EVP_MAX_KEY_LENGTH, tmpkeyiv_hmac, iklen) != EOK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the key\n");
+        BIO_printf(g_bio_err, "LibOVSA: Error getting the key/iv failed in getting the key\n");
         ret = OVSA_MEMIO_ERROR;
         goto end;
     }
 
-    if (memcpy_s(iv, EVP_MAX_IV_LENGTH, tmpkeyiv_hmac + EVP_CIPHER_key_length(cipher), ivlen) !=
-        EOK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in getting the iv\n");
+    if (memcpy_s(iv, EVP_MAX_IV_LENGTH, tmpkeyiv_hmac + iklen, ivlen) != EOK) {
+        BIO_printf(g_bio_err, "LibOVSA: Error getting the key/iv failed in getting the iv\n");
         ret = OVSA_MEMIO_ERROR;
         goto end;
     }
 
-    if ((benc = BIO_new(BIO_f_cipher())) == NULL) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in getting the cipher BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
+end:
+    OPENSSL_cleanse(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH);
+    BIO_free_all(keyiv_hmac_read_bio);
+    BIO_free(keyiv_hmac_b64);
+    return ret;
+}
 
-    BIO_get_cipher_ctx(benc, &ctx);
-    if (!EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, 1)) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in setting the cipher\n");
-        ret = OVSA_CRYPTO_EVP_ERROR;
-        goto end;
-    }
+static ovsa_status_t ovsa_crypto_init_cipher_ctx(int keyiv_hmac_slot, size_t offset, int enc,
+                                                 EVP_CIPHER_CTX* ctx) {
+    unsigned char key[EVP_MAX_KEY_LENGTH], iv[EVP_MAX_IV_LENGTH];
+    unsigned char skip_buff[AES_CTR_BLOCK_SIZE];
+    int ivlen = 0, skip_len = 0, i = 0;
+    ovsa_status_t ret         = OVSA_OK;
+    const EVP_CIPHER* cipher  = NULL;
+    unsigned long long blocks = 0;
+    unsigned int carry        = 0;
 
-    if (!EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, 1)) {
+    if ((ovsa_crypto_get_symmetric_key(keyiv_hmac_slot) == NULL) || (ctx == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in setting the key/iv\n");
-        ret = OVSA_CRYPTO_EVP_ERROR;
-        goto end;
-    }
-
-    if (benc != NULL) {
-        cipher_bio = BIO_push(benc, cipher_bio);
+                   "LibOVSA: Error cipher context init failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
     }
 
-    buff = ovsa_crypto_app_malloc(EVP_ENCODE_LENGTH(BUFSIZE), "evp encrypt_mem buffer");
-    if (buff == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in allocating memory for "
-                   "evp encrypt buffer\n");
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        goto end;
-    }
+    cipher = EVP_aes_256_ctr();
+    ivlen  = EVP_CIPHER_iv_length(cipher);
 
-    while (BIO_pending(read_bio) || !BIO_eof(read_bio)) {
-        read_len = BIO_read(read_bio, (char*)buff, BUFSIZE);
-        if (read_len <= 0) {
-            break;
-        }
-        if (BIO_write(cipher_bio, (char*)buff, read_len) != read_len) {
-            BIO_printf(
-                g_bio_err,
-                "LibOVSA: Error encrypting the memory buffer failed in writing to cipher BIO\n");
-            ret = OVSA_CRYPTO_BIO_ERROR;
-            goto end;
-        }
-    }
+    memset_s(key, EVP_MAX_KEY_LENGTH, 0);
+    memset_s(iv, EVP_MAX_IV_LENGTH, 0);
+    memset_s(skip_buff, sizeof(skip_buff), 0);
 
-    if (!BIO_flush(cipher_bio)) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in flushing the cipher BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+    ret = ovsa_crypto_get_keyiv(keyiv_hmac_slot, key, iv);
+    if (ret < OVSA_OK) {
         goto end;
     }
 
-    BIO_get_mem_ptr(cipher_bio, &encrypt_ptr);
-    if (encrypt_ptr == NULL) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed to extract the cipher BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+    /* CTR mode is seekable, move the big endian counter to the block of the offset */
+    blocks = offset / AES_CTR_BLOCK_SIZE;
+    for (i = ivlen - 1; (i >= 0) && ((blocks != 0) || (carry != 0)); i--) {
+        carry += iv[i] + (unsigned int)(blocks & 0xff);
+        iv[i] = (unsigned char)(carry & 0xff);
+        carry >>= 8;
+        blocks >>= 8;
     }
 
-    /* App needs to free this memory */
-    *out_buff = ovsa_crypto_app_malloc(encrypt_ptr->length + NULL_TERMINATOR, "encrypted buffer");
-    if (*out_buff == NULL) {
+    /* A context set up for the cipher before, e.g. of this thread, only takes the new key/iv */
+    if ((EVP_CIPHER_CTX_cipher(ctx) != NULL) &&
+        (EVP_CIPHER_nid(EVP_CIPHER_CTX_cipher(ctx)) == EVP_CIPHER_nid(cipher))) {
+        cipher = NULL;
+    }
+    if (!EVP_CipherInit_ex(ctx, cipher, NULL, key, iv, enc)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error encrypting the memory buffer failed in allocating memory for "
-                   "encrypted buffer\n");
-        ret = OVSA_MEMORY_ALLOC_FAIL;
+                   "LibOVSA: Error cipher context init failed in setting the key/iv\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    *out_buff_len = encrypt_ptr->length;
-    if (memcpy_s(*out_buff, encrypt_ptr->length, encrypt_ptr->data, encrypt_ptr->length) != EOK) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error encrypting the memory buffer failed in getting the output buffer\n");
-        ret = OVSA_MEMIO_ERROR;
-        goto end;
+    /* Consume the key stream in front of the offset within its block */
+    if ((offset % AES_CTR_BLOCK_SIZE) != 0) {
+        if (!EVP_CipherUpdate(ctx, skip_buff, &skip_len, skip_buff,
+                              (int)(offset % AES_CTR_BLOCK_SIZE))) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error cipher context init failed in seeking to the offset\n");
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto end;
+        }
     }
 
 end:
-    OPENSSL_cleanse(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH);
     OPENSSL_cleanse(key, EVP_MAX_KEY_LENGTH);
     OPENSSL_cleanse(iv, EVP_MAX_IV_LENGTH);
-    OPENSSL_cleanse(magic_salt, sizeof(magic_salt));
-    OPENSSL_cleanse(magic_salt_buff, sizeof(magic_salt_buff));
-    if (magic_salt_buff_ptr != NULL) {
-        OPENSSL_cleanse(magic_salt_buff_ptr, magic_salt_buff_ptr_len);
+    OPENSSL_cleanse(skip_buff, sizeof(skip_buff));
+    return ret;
+}
+
+static ovsa_status_t ovsa_crypto_decrypt_chunk(EVP_CIPHER_CTX* ctx, const unsigned char* buff,
+                                               int buff_len, unsigned char* plain_buff,
+                                               ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                               size_t* out_buff_len) {
+    ovsa_status_t ret = OVSA_OK;
+    int decrypt_len   = 0;
+
+    if (buff_len > 0) {
+        if (!EVP_DecryptUpdate(ctx, plain_buff, &decrypt_len, buff, buff_len)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the memory stream failed in decrypting the "
+                       "buffer\n");
+            return OVSA_CRYPTO_EVP_ERROR;
+        }
+    } else {
+        /* An empty chunk finalizes the decryption */
+        if (!EVP_DecryptFinal_ex(ctx, plain_buff, &decrypt_len)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the memory stream failed in finalizing the "
+                       "decryption\n");
+            return OVSA_CRYPTO_EVP_ERROR;
+        }
     }
-    ovsa_crypto_openssl_free((char**)&buff);
-    BIO_free(benc);
-    BIO_free(b64);
-    BIO_free(magic_salt_b64);
-    BIO_free(keyiv_hmac_b64);
-    BIO_free_all(write_bio);
-    BIO_free_all(read_bio);
-    BIO_free_all(keyiv_hmac_read_bio);
-    BIO_free_all(magic_salt_read_bio);
-    if (ret < OVSA_OK) {
-        ERR_print_errors(g_bio_err);
+    if (decrypt_len > 0) {
+        ret = write_cb(write_ctx, (char*)plain_buff, decrypt_len);
+        if (ret < OVSA_OK) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the memory stream failed in writing the "
+                       "decrypted buffer\n");
+            return ret;
+        }
+        *out_buff_len += decrypt_len;
     }
     return ret;
 }
 
-ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, size_t in_buff_len,
-                                      char** out_buff, size_t* out_buff_len, int* keyiv_hmac_slot) {
-    unsigned char key[EVP_MAX_KEY_LENGTH], iv[EVP_MAX_IV_LENGTH];
-    unsigned char tmpkeyiv_hmac[MAX_KEYIV_HMAC_LENGTH];
-    int read_len = 0, iklen = 0, ivlen = 0;
+ovsa_status_t ovsa_crypto_decrypt_mem_stream(int sym_key_slot, const char* in_buff,
+                                             size_t in_buff_len, ovsa_crypto_write_cb_t write_cb,
+                                             void* write_ctx, size_t* out_buff_len,
+                                             int* keyiv_hmac_slot) {
+    int read_len              = 0;
     static const char magic[] = "Salted__";
     ovsa_status_t ret         = OVSA_OK;
-    const EVP_CIPHER* cipher  = NULL;
-    BIO* keyiv_hmac_read_bio  = NULL;
-    BUF_MEM* decrypt_ptr      = NULL;
-    BIO* keyiv_hmac_bio       = NULL;
     unsigned char* buff       = NULL;
+    unsigned char* plain_buff = NULL;
     EVP_CIPHER_CTX* ctx       = NULL;
-    BIO* keyiv_hmac_b64       = NULL;
-    BIO* decrypt_bio          = NULL;
-    BIO* write_bio            = NULL;
     BIO* read_mem             = NULL;
     BIO* read_bio             = NULL;
-    BIO* benc                 = NULL;
     BIO* b64                  = NULL;
-    size_t keyiv_hmac_len     = 0;
     unsigned char salt[PKCS5_SALT_LEN];
     char mbuff[sizeof(magic) - 1];
 
-    if ((sym_key_slot < 0) || (sym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
-        (in_buff_len == 0) || (out_buff == NULL) || (out_buff_len == NULL) ||
+    if ((ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) || (in_buff == NULL) ||
+        (in_buff_len == 0) || (write_cb == NULL) || (out_buff_len == NULL) ||
         (keyiv_hmac_slot == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed with invalid parameter\n");
+                   "LibOVSA: Error decrypting the memory stream failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
     if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting the b64 encode "
+                   "LibOVSA: Error decrypting the memory stream failed in getting the b64 encode "
                    "method\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
@@ -1117,7 +1097,7 @@ ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, siz
     read_mem = BIO_new_mem_buf(in_buff, in_buff_len);
     if (read_mem == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in creating new BIO for the "
+                   "LibOVSA: Error decrypting the memory stream failed in creating new BIO for the "
                    "input buffer\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
@@ -1133,7 +1113,7 @@ ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, siz
         BIO_read(read_bio, (unsigned char*)salt, sizeof(salt)) != sizeof(salt)) {
         BIO_printf(
             g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in reading the input file\n");
+            "LibOVSA: Error decrypting the memory stream failed in reading the input file\n");
         ret = OVSA_CRYPTO_BIO_ERROR;
         goto end;
     }
@@ -1142,193 +1122,970 @@ ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, siz
     if (ret < OVSA_OK) {
         BIO_printf(
             g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in deriving the key/IV/HMAC\n");
+            "LibOVSA: Error decrypting the memory stream failed in deriving the key/IV/HMAC\n");
         goto end;
     }
 
-    cipher = EVP_aes_256_ctr();
-    iklen  = EVP_CIPHER_key_length(cipher);
-    ivlen  = EVP_CIPHER_iv_length(cipher);
-
-    memset_s(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH, 0);
-    memset_s(key, EVP_MAX_KEY_LENGTH, 0);
-    memset_s(iv, EVP_MAX_IV_LENGTH, 0);
-
-    keyiv_hmac_read_bio = BIO_new(BIO_s_mem());
-    if (keyiv_hmac_read_bio == NULL) {
+    /* The write callback may use the context of the thread, the stream has its own */
+    if ((ctx = EVP_CIPHER_CTX_new()) == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting new BIO for the "
-                   "keyiv_hmac buffer\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+                   "LibOVSA: Error decrypting the memory stream failed in getting the cipher "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    keyiv_hmac_bio = keyiv_hmac_read_bio;
-    if (BIO_puts(keyiv_hmac_read_bio, g_sym_key[*keyiv_hmac_slot]) <= 0) {
+    ret = ovsa_crypto_init_cipher_ctx(*keyiv_hmac_slot, 0, 0, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    buff       = ovsa_crypto_app_malloc(DECRYPT_STREAM_CHUNK_SIZE, "evp decrypt_mem buffer");
+    plain_buff = ovsa_crypto_app_malloc(DECRYPT_STREAM_CHUNK_SIZE + EVP_MAX_BLOCK_LENGTH,
+                                        "evp decrypt_mem plain buffer");
+    if ((buff == NULL) || (plain_buff == NULL)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the memory stream failed in allocating memory for "
+                   "evp decrypt buffer\n");
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto end;
+    }
+
+    /* Decrypt chunk by chunk and hand over the plain text without buffering it */
+    *out_buff_len = 0;
+    while (BIO_pending(read_bio) || !BIO_eof(read_bio)) {
+        read_len = BIO_read(read_bio, (char*)buff, DECRYPT_STREAM_CHUNK_SIZE);
+        if (read_len <= 0) {
+            break;
+        }
+        ret = ovsa_crypto_decrypt_chunk(ctx, buff, read_len, plain_buff, write_cb, write_ctx,
+                                        out_buff_len);
+        if (ret < OVSA_OK) {
+            goto end;
+        }
+    }
+    ret = ovsa_crypto_decrypt_chunk(ctx, NULL, 0, plain_buff, write_cb, write_ctx, out_buff_len);
+
+end:
+    OPENSSL_cleanse(salt, sizeof(salt));
+    if (plain_buff != NULL) {
+        OPENSSL_cleanse(plain_buff, DECRYPT_STREAM_CHUNK_SIZE + EVP_MAX_BLOCK_LENGTH);
+    }
+    ovsa_crypto_openssl_free((char**)&buff);
+    ovsa_crypto_openssl_free((char**)&plain_buff);
+    EVP_CIPHER_CTX_free(ctx);
+    BIO_free(b64);
+    BIO_free_all(read_mem);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_derive_raw_keyiv_hmac(int sym_key_slot, const char* in_buff,
+                                                size_t in_buff_len, int* keyiv_hmac_slot) {
+    static const char magic[] = "Salted__";
+    const size_t header_len   = sizeof(magic) - 1 + PKCS5_SALT_LEN;
+    ovsa_status_t ret         = OVSA_OK;
+    int indicator             = 0;
+    char magic_salt_buff[((sizeof(magic) - 1 + PKCS5_SALT_LEN + 2) / 3) * 4 + NULL_TERMINATOR];
+
+    if ((in_buff == NULL) || (in_buff_len < header_len) || (keyiv_hmac_slot == NULL)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error generating raw key/IV/HMAC failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    if ((memcmp_s(in_buff, header_len, magic, sizeof(magic) - 1, &indicator) != EOK) ||
+        (indicator != 0)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error generating raw key/IV/HMAC failed in reading the magic from "
+                   "input buffer\n");
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+
+    /* The key derivation expects the magic and salt in base64 encoded form */
+    memset_s(magic_salt_buff, sizeof(magic_salt_buff), 0);
+    if (EVP_EncodeBlock((unsigned char*)magic_salt_buff, (const unsigned char*)in_buff,
+                        header_len) <= 0) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error generating raw key/IV/HMAC failed in encoding the magic and "
+                   "salt\n");
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+
+    ret = ovsa_crypto_derive_keyiv_hmac(sym_key_slot, magic_salt_buff, strlen(magic_salt_buff),
+                                        keyiv_hmac_slot);
+    OPENSSL_cleanse(magic_salt_buff, sizeof(magic_salt_buff));
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_decrypt_raw_mem_stream(int sym_key_slot, const char* in_buff,
+                                                 size_t in_buff_len,
+                                                 ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                                 size_t* out_buff_len, int* keyiv_hmac_slot) {
+    static const char magic[] = "Salted__";
+    const size_t header_len   = sizeof(magic) - 1 + PKCS5_SALT_LEN;
+    ovsa_status_t ret         = OVSA_OK;
+    unsigned char* plain_buff = NULL;
+    EVP_CIPHER_CTX* ctx       = NULL;
+    size_t offset             = 0;
+    size_t chunk_len          = 0;
+
+    if ((ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) || (in_buff == NULL) ||
+        (in_buff_len < header_len) || (write_cb == NULL) || (out_buff_len == NULL) ||
+        (keyiv_hmac_slot == NULL)) {
         BIO_printf(
             g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in writing to keyiv_hmac BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+            "LibOVSA: Error decrypting the raw memory stream failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    ret = ovsa_crypto_derive_raw_keyiv_hmac(sym_key_slot, in_buff, in_buff_len, keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the raw memory stream failed in deriving the "
+                   "key/IV/HMAC\n");
         goto end;
     }
 
-    if ((keyiv_hmac_b64 = BIO_new(BIO_f_base64())) == NULL) {
+    /* The write callback may use the context of the thread, the stream has its own */
+    if ((ctx = EVP_CIPHER_CTX_new()) == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting the b64 encode "
-                   "method for keyiv_hmac\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+                   "LibOVSA: Error decrypting the memory stream failed in getting the cipher "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    keyiv_hmac_bio = BIO_push(keyiv_hmac_b64, keyiv_hmac_bio);
-    keyiv_hmac_len = strnlen_s(g_sym_key[*keyiv_hmac_slot], MAX_KEYIV_HMAC_LENGTH);
-    if (keyiv_hmac_len == EOK) {
+    ret = ovsa_crypto_init_cipher_ctx(*keyiv_hmac_slot, 0, 0, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    plain_buff = ovsa_crypto_app_malloc(DECRYPT_STREAM_CHUNK_SIZE + EVP_MAX_BLOCK_LENGTH,
+                                        "evp decrypt_mem plain buffer");
+    if (plain_buff == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting the size for "
-                   "keyiv_hmac\n");
+                   "LibOVSA: Error decrypting the raw memory stream failed in allocating memory "
+                   "for evp decrypt buffer\n");
+        ret = OVSA_MEMORY_ALLOC_FAIL;
+        goto end;
+    }
+
+    /* The cipher text is decrypted straight from the input buffer, which may be mapped */
+    *out_buff_len = 0;
+    for (offset = header_len; offset < in_buff_len; offset += chunk_len) {
+        chunk_len = in_buff_len - offset;
+        if (chunk_len > DECRYPT_STREAM_CHUNK_SIZE) {
+            chunk_len = DECRYPT_STREAM_CHUNK_SIZE;
+        }
+        ret = ovsa_crypto_decrypt_chunk(ctx, (const unsigned char*)in_buff + offset,
+                                        (int)chunk_len, plain_buff, write_cb, write_ctx,
+                                        out_buff_len);
+        if (ret < OVSA_OK) {
+            goto end;
+        }
+    }
+    ret = ovsa_crypto_decrypt_chunk(ctx, NULL, 0, plain_buff, write_cb, write_ctx, out_buff_len);
+
+end:
+    if (plain_buff != NULL) {
+        OPENSSL_cleanse(plain_buff, DECRYPT_STREAM_CHUNK_SIZE + EVP_MAX_BLOCK_LENGTH);
+    }
+    ovsa_crypto_openssl_free((char**)&plain_buff);
+    EVP_CIPHER_CTX_free(ctx);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+size_t ovsa_crypto_get_plain_text_len(const char* in_buff, size_t in_buff_len, bool b64_format) {
+    static const char magic[] = "Salted__";
+    size_t header_len         = sizeof(magic) - 1 + PKCS5_SALT_LEN;
+    size_t raw_len            = in_buff_len;
+
+    if (in_buff == NULL) {
+        return 0;
+    }
+    if (b64_format == true) {
+        if ((in_buff_len == 0) || ((in_buff_len % 4) != 0)) {
+            return 0;
+        }
+        /* Exact length of the decoded data, without the padding */
+        raw_len = in_buff_len / 4 * 3;
+        if (in_buff[in_buff_len - 1] == '=') {
+            raw_len--;
+        }
+        if (in_buff[in_buff_len - 2] == '=') {
+            raw_len--;
+        }
+    }
+    return (raw_len > header_len) ? raw_len - header_len : 0;
+}
+
+ovsa_status_t ovsa_crypto_decrypt_mem_range(int keyiv_hmac_slot, const char* in_buff,
+                                            size_t in_buff_len, bool b64_format, size_t offset,
+                                            size_t length, char* out_buff) {
+    static const char magic[] = "Salted__";
+    const size_t header_len   = sizeof(magic) - 1 + PKCS5_SALT_LEN;
+    ovsa_status_t ret         = OVSA_OK;
+    unsigned char* raw_buff   = NULL;
+    const unsigned char* ct   = NULL;
+    EVP_CIPHER_CTX* ctx       = NULL;
+    size_t done               = 0;
+    size_t chunk_len          = 0;
+    size_t raw_pos            = 0;
+    size_t quad_start         = 0;
+    size_t quad_end           = 0;
+    size_t decode_len         = 0;
+    int decrypt_len           = 0;
+
+    if ((in_buff == NULL) || (out_buff == NULL) || (length == 0) ||
+        (offset + length < offset) ||
+        (offset + length > ovsa_crypto_get_plain_text_len(in_buff, in_buff_len, b64_format))) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the memory range failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    /* One shot over the range, the context of the thread is reused */
+    ctx = ovsa_crypto_get_thread_cipher_ctx();
+    if (ctx == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the memory range failed in getting the cipher "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto end;
+    }
+
+    ret = ovsa_crypto_init_cipher_ctx(keyiv_hmac_slot, offset, 0, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    if (b64_format == true) {
+        /* Decoded chunk of DECRYPT_STREAM_CHUNK_SIZE, plus the bytes of the partial quads */
+        raw_buff = ovsa_crypto_app_malloc(DECRYPT_STREAM_CHUNK_SIZE + 6,
+                                          "evp decrypt_mem range buffer");
+        if (raw_buff == NULL) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the memory range failed in allocating memory "
+                       "for the decode buffer\n");
+            ret = OVSA_MEMORY_ALLOC_FAIL;
+            goto end;
+        }
+    }
+
+    /* The cipher text of the range is decrypted straight into the output buffer */
+    for (done = 0; done < length; done += chunk_len) {
+        chunk_len = length - done;
+        if (chunk_len > DECRYPT_STREAM_CHUNK_SIZE) {
+            chunk_len = DECRYPT_STREAM_CHUNK_SIZE;
+        }
+        raw_pos = header_len + offset + done;
+        if (b64_format == true) {
+            /* Every 4 base64 characters decode to 3 bytes, decode the quads of the chunk */
+            quad_start = raw_pos / 3;
+            quad_end   = (raw_pos + chunk_len + 2) / 3;
+            if ((ovsa_base64_decode(in_buff + quad_start * 4, (quad_end - quad_start) * 4,
+                                    raw_buff, &decode_len) != 0) ||
+                (decode_len < raw_pos + chunk_len - quad_start * 3)) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error decrypting the memory range failed in decoding the "
+                           "input buffer\n");
+                ret = OVSA_CRYPTO_GENERIC_ERROR;
+                goto end;
+            }
+            ct = raw_buff + (raw_pos - quad_start * 3);
+        } else {
+            ct = (const unsigned char*)in_buff + raw_pos;
+        }
+        if (!EVP_DecryptUpdate(ctx, (unsigned char*)out_buff + done, &decrypt_len, ct,
+                               (int)chunk_len) ||
+            ((size_t)decrypt_len != chunk_len)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the memory range failed in decrypting the "
+                       "buffer\n");
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto end;
+        }
+    }
+
+end:
+    if (raw_buff != NULL) {
+        OPENSSL_cleanse(raw_buff, DECRYPT_STREAM_CHUNK_SIZE + 6);
+    }
+    ovsa_crypto_openssl_free((char**)&raw_buff);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_init_encrypt_range(int sym_key_slot, char* magic_salt,
+                                             int* keyiv_hmac_slot) {
+    static const char magic[] = "Salted__";
+    ovsa_status_t ret         = OVSA_OK;
+
+    if ((magic_salt == NULL) || (keyiv_hmac_slot == NULL)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error initializing the range encryption failed with invalid "
+                   "parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    /* Same magic and salt as ovsa_crypto_generate_salt(), in raw form */
+    if (memcpy_s(magic_salt, ENCRYPT_HEADER_LEN, magic, sizeof(magic) - 1) != EOK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error initializing the range encryption failed in getting the "
+                   "magic\n");
+        return OVSA_MEMIO_ERROR;
+    }
+    if (RAND_bytes((unsigned char*)magic_salt + sizeof(magic) - 1, PKCS5_SALT_LEN) <= 0) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error initializing the range encryption failed in generating the "
+                   "salt\n");
         ret = OVSA_CRYPTO_GENERIC_ERROR;
         goto end;
     }
 
-    keyiv_hmac_len = BIO_read(keyiv_hmac_bio, tmpkeyiv_hmac, keyiv_hmac_len);
-    if (keyiv_hmac_len <= 0) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in reading to keyiv_hmac BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+    ret = ovsa_crypto_derive_raw_keyiv_hmac(sym_key_slot, magic_salt, ENCRYPT_HEADER_LEN,
+                                            keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error initializing the range encryption failed in deriving the "
+                   "key/IV/HMAC\n");
         goto end;
     }
 
-    /* Split and move data back to buffer */
-    if (memcpy_s(key, EVP_MAX_KEY_LENGTH, tmpkeyiv_hmac, iklen) != EOK) {
+end:
+    if (ret < OVSA_OK) {
+        OPENSSL_cleanse(magic_salt, ENCRYPT_HEADER_LEN);
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_encrypt_mem_range(int keyiv_hmac_slot, const char* magic_salt,
+                                            const char* in_buff, size_t offset, size_t length,
+                                            bool b64_format, char* out_buff) {
+    ovsa_status_t ret       = OVSA_OK;
+    unsigned char* raw_buff = NULL;
+    unsigned char* b64_buff = NULL;
+    unsigned char* dst      = NULL;
+    EVP_CIPHER_CTX* ctx     = NULL;
+    size_t done             = 0;
+    size_t fill             = 0;
+    size_t chunk_len        = 0;
+    size_t raw_pos          = 0;
+    size_t encode_len       = 0;
+    int encrypt_len         = 0;
+
+    if ((in_buff == NULL) || (out_buff == NULL) || (length == 0) ||
+        (offset + length < offset) || ((offset == 0) && (magic_salt == NULL)) ||
+        ((b64_format == true) && (offset != 0) && (((ENCRYPT_HEADER_LEN + offset) % 3) != 0))) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error encrypting the memory range failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    /* One shot over the range, the context of the thread is reused */
+    ctx = ovsa_crypto_get_thread_cipher_ctx();
+    if (ctx == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting the key\n");
-        ret = OVSA_MEMIO_ERROR;
+                   "LibOVSA: Error encrypting the memory range failed in getting the cipher "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    if (memcpy_s(iv, EVP_MAX_IV_LENGTH, tmpkeyiv_hmac + EVP_CIPHER_key_length(cipher), ivlen) !=
-        EOK) {
+    ret = ovsa_crypto_init_cipher_ctx(keyiv_hmac_slot, offset, 1, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    if (b64_format == true) {
+        raw_buff =
+            ovsa_crypto_app_malloc(ENCRYPT_STREAM_CHUNK_SIZE, "evp encrypt_mem range buffer");
+        b64_buff = ovsa_crypto_app_malloc(ENCRYPT_STREAM_CHUNK_SIZE / 3 * 4 + NULL_TERMINATOR,
+                                          "evp encrypt_mem range encode buffer");
+        if ((raw_buff == NULL) || (b64_buff == NULL)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error encrypting the memory range failed in allocating memory "
+                       "for the encode buffer\n");
+            ret = OVSA_MEMORY_ALLOC_FAIL;
+            goto end;
+        }
+    }
+
+    /*
+     * Raw output is encrypted straight into the output buffer. Base64 output goes through the
+     * encode buffer, its chunks are a multiple of 3 bytes so their encodings line up.
+     */
+    while (done < length) {
+        dst  = (b64_format == true) ? raw_buff : (unsigned char*)out_buff + raw_pos;
+        fill = 0;
+        if ((offset == 0) && (raw_pos == 0)) {
+            if (memcpy_s(dst, ENCRYPT_HEADER_LEN, magic_salt, ENCRYPT_HEADER_LEN) != EOK) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error encrypting the memory range failed in writing the "
+                           "magic/salt\n");
+                ret = OVSA_MEMIO_ERROR;
+                goto end;
+            }
+            fill = ENCRYPT_HEADER_LEN;
+        }
+        chunk_len = length - done;
+        if (chunk_len > ENCRYPT_STREAM_CHUNK_SIZE - fill) {
+            chunk_len = ENCRYPT_STREAM_CHUNK_SIZE - fill;
+        }
+        if (!EVP_EncryptUpdate(ctx, dst + fill, &encrypt_len,
+                               (const unsigned char*)in_buff + done, (int)chunk_len) ||
+            ((size_t)encrypt_len != chunk_len)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error encrypting the memory range failed in encrypting the "
+                       "buffer\n");
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto end;
+        }
+        fill += chunk_len;
+        done += chunk_len;
+        if (b64_format == true) {
+            /* ovsa_base64_encode() terminates its output, which must not go past the range */
+            encode_len = ovsa_base64_encode(raw_buff, fill, false, (char*)b64_buff);
+            if (memcpy_s(out_buff + raw_pos / 3 * 4, encode_len, b64_buff, encode_len) != EOK) {
+                BIO_printf(g_bio_err,
+                           "LibOVSA: Error encrypting the memory range failed in encoding the "
+                           "buffer\n");
+                ret = OVSA_CRYPTO_GENERIC_ERROR;
+                goto end;
+            }
+        }
+        raw_pos += fill;
+    }
+
+end:
+    if (raw_buff != NULL) {
+        OPENSSL_cleanse(raw_buff, ENCRYPT_STREAM_CHUNK_SIZE);
+    }
+    ovsa_crypto_openssl_free((char**)&raw_buff);
+    ovsa_crypto_openssl_free((char**)&b64_buff);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+size_t ovsa_crypto_get_encrypt_mem_pos(size_t offset, bool b64_format) {
+    size_t raw_pos = (offset == 0) ? 0 : ENCRYPT_HEADER_LEN + offset;
+
+    if (b64_format == true) {
+        /* Padded encoding, only the last range ends in a partial quad */
+        return (raw_pos + 2) / 3 * 4;
+    }
+    return raw_pos;
+}
+
+static ovsa_status_t ovsa_crypto_init_gcm_ctx(int keyiv_hmac_slot, const char* magic_salt,
+                                              size_t plain_len, size_t offset, int enc,
+                                              EVP_CIPHER_CTX* ctx) {
+    unsigned char key[EVP_MAX_KEY_LENGTH], iv[EVP_MAX_IV_LENGTH];
+    unsigned char aad[ENCRYPT_HEADER_LEN + sizeof(uint64_t)];
+    uint64_t segment         = offset / ENCRYPT_GCM_SEGMENT_SIZE;
+    ovsa_status_t ret        = OVSA_OK;
+    const EVP_CIPHER* cipher = NULL;
+    int aad_len = 0, i = 0;
+
+    if ((ovsa_crypto_get_symmetric_key(keyiv_hmac_slot) == NULL) || (ctx == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting the iv\n");
+                   "LibOVSA: Error GCM cipher context init failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    cipher = EVP_aes_256_gcm();
+
+    memset_s(key, EVP_MAX_KEY_LENGTH, 0);
+    memset_s(iv, EVP_MAX_IV_LENGTH, 0);
+
+    ret = ovsa_crypto_get_keyiv(keyiv_hmac_slot, key, iv);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    /* Every segment has a nonce of its own, the segment index in the last 8 bytes of the IV */
+    for (i = 0; i < 8; i++) {
+        iv[GCM_NONCE_LEN - 1 - i] ^= (unsigned char)((segment >> (i * 8)) & 0xff);
+    }
+
+    /* A context set up for the cipher before, e.g. of this thread, only takes the new key/iv */
+    if ((EVP_CIPHER_CTX_cipher(ctx) != NULL) &&
+        (EVP_CIPHER_nid(EVP_CIPHER_CTX_cipher(ctx)) == EVP_CIPHER_nid(cipher))) {
+        cipher = NULL;
+    }
+    if ((!EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, enc)) ||
+        (!EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, GCM_NONCE_LEN, NULL)) ||
+        (!EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, enc))) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error GCM cipher context init failed in setting the key/iv\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto end;
+    }
+
+    /* Magic, salt and plain text length are authenticated with every segment, so a truncated
+     * or extended buffer fails the tag check */
+    if (memcpy_s(aad, sizeof(aad), magic_salt, ENCRYPT_HEADER_LEN) != EOK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error GCM cipher context init failed in getting the magic/salt\n");
         ret = OVSA_MEMIO_ERROR;
         goto end;
     }
+    for (i = 0; i < 8; i++) {
+        aad[sizeof(aad) - 1 - i] = (unsigned char)(((uint64_t)plain_len >> (i * 8)) & 0xff);
+    }
+    if (!EVP_CipherUpdate(ctx, NULL, &aad_len, aad, sizeof(aad))) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error GCM cipher context init failed in adding the AAD\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto end;
+    }
+
+end:
+    OPENSSL_cleanse(key, EVP_MAX_KEY_LENGTH);
+    OPENSSL_cleanse(iv, EVP_MAX_IV_LENGTH);
+    return ret;
+}
+
+size_t ovsa_crypto_get_gcm_encrypt_pos(size_t offset) {
+    if (offset == 0) {
+        return 0;
+    }
+    /* Each segment in front of the offset, including a partial last one, carries its tag */
+    return ENCRYPT_HEADER_LEN + offset +
+           (offset + ENCRYPT_GCM_SEGMENT_SIZE - 1) / ENCRYPT_GCM_SEGMENT_SIZE * ENCRYPT_GCM_TAG_LEN;
+}
+
+size_t ovsa_crypto_get_gcm_plain_text_len(const char* in_buff, size_t in_buff_len) {
+    const size_t segment_len = ENCRYPT_GCM_SEGMENT_SIZE + ENCRYPT_GCM_TAG_LEN;
+    size_t segments          = 0;
+    size_t body_len          = 0;
+
+    if ((in_buff == NULL) || (in_buff_len <= ENCRYPT_HEADER_LEN)) {
+        return 0;
+    }
+    body_len = in_buff_len - ENCRYPT_HEADER_LEN;
+    segments = (body_len + segment_len - 1) / segment_len;
+    /* The last segment holds at least one byte of cipher text in front of its tag */
+    if (body_len - (segments - 1) * segment_len <= ENCRYPT_GCM_TAG_LEN) {
+        return 0;
+    }
+    return body_len - segments * ENCRYPT_GCM_TAG_LEN;
+}
 
-    write_bio = BIO_new(BIO_s_mem());
-    if (write_bio == NULL) {
+ovsa_status_t ovsa_crypto_encrypt_gcm_range(int keyiv_hmac_slot, const char* magic_salt,
+                                            size_t plain_len, const char* in_buff, size_t offset,
+                                            size_t length, char* out_buff) {
+    ovsa_status_t ret   = OVSA_OK;
+    unsigned char* dst  = (unsigned char*)out_buff;
+    EVP_CIPHER_CTX* ctx = NULL;
+    int encrypt_len     = 0;
+    int final_len       = 0;
+
+    if ((magic_salt == NULL) || (in_buff == NULL) || (out_buff == NULL) || (length == 0) ||
+        (offset >= plain_len) || ((offset % ENCRYPT_GCM_SEGMENT_SIZE) != 0) ||
+        (length != ((plain_len - offset < ENCRYPT_GCM_SEGMENT_SIZE) ? plain_len - offset
+                                                                     : ENCRYPT_GCM_SEGMENT_SIZE))) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in getting new BIO for "
-                   "output buffer\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+                   "LibOVSA: Error encrypting the GCM segment failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    ctx = ovsa_crypto_get_thread_cipher_ctx();
+    if (ctx == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error encrypting the GCM segment failed in getting the cipher "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    decrypt_bio = write_bio;
-    if ((benc = BIO_new(BIO_f_cipher())) == NULL) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in getting the cipher BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+    ret = ovsa_crypto_init_gcm_ctx(keyiv_hmac_slot, magic_salt, plain_len, offset, 1, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    if (offset == 0) {
+        if (memcpy_s(dst, ENCRYPT_HEADER_LEN, magic_salt, ENCRYPT_HEADER_LEN) != EOK) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error encrypting the GCM segment failed in writing the "
+                       "magic/salt\n");
+            ret = OVSA_MEMIO_ERROR;
+            goto end;
+        }
+        dst += ENCRYPT_HEADER_LEN;
+    }
+
+    /* Cipher text and tag of the segment in a single pass */
+    if (!EVP_EncryptUpdate(ctx, dst, &encrypt_len, (const unsigned char*)in_buff, (int)length) ||
+        ((size_t)encrypt_len != length) ||
+        !EVP_EncryptFinal_ex(ctx, dst + encrypt_len, &final_len) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, ENCRYPT_GCM_TAG_LEN, dst + length)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error encrypting the GCM segment failed in encrypting the buffer\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    BIO_get_cipher_ctx(benc, &ctx);
-    if (!EVP_CipherInit_ex(ctx, cipher, NULL, NULL, NULL, 0)) {
+end:
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_decrypt_gcm_range(int keyiv_hmac_slot, const char* in_buff,
+                                            size_t in_buff_len, size_t offset, size_t length,
+                                            char* out_buff) {
+    ovsa_status_t ret       = OVSA_OK;
+    const unsigned char* ct = NULL;
+    EVP_CIPHER_CTX* ctx     = NULL;
+    size_t plain_len        = 0;
+    int decrypt_len         = 0;
+    int final_len           = 0;
+
+    plain_len = ovsa_crypto_get_gcm_plain_text_len(in_buff, in_buff_len);
+    if ((out_buff == NULL) || (length == 0) || (offset >= plain_len) ||
+        ((offset % ENCRYPT_GCM_SEGMENT_SIZE) != 0) ||
+        (length != ((plain_len - offset < ENCRYPT_GCM_SEGMENT_SIZE) ? plain_len - offset
+                                                                     : ENCRYPT_GCM_SEGMENT_SIZE))) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the GCM segment failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    ctx = ovsa_crypto_get_thread_cipher_ctx();
+    if (ctx == NULL) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in setting the cipher\n");
+                   "LibOVSA: Error decrypting the GCM segment failed in getting the cipher "
+                   "context\n");
         ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    if (!EVP_CipherInit_ex(ctx, NULL, NULL, key, iv, 0)) {
+    ret = ovsa_crypto_init_gcm_ctx(keyiv_hmac_slot, in_buff, plain_len, offset, 0, ctx);
+    if (ret < OVSA_OK) {
+        goto end;
+    }
+
+    ct = (const unsigned char*)in_buff + ENCRYPT_HEADER_LEN + offset +
+         offset / ENCRYPT_GCM_SEGMENT_SIZE * ENCRYPT_GCM_TAG_LEN;
+    if (!EVP_DecryptUpdate(ctx, (unsigned char*)out_buff, &decrypt_len, ct, (int)length) ||
+        ((size_t)decrypt_len != length) ||
+        !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, ENCRYPT_GCM_TAG_LEN,
+                             (void*)(ct + length))) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in setting the key/iv\n");
+                   "LibOVSA: Error decrypting the GCM segment failed in decrypting the buffer\n");
         ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
+    if (EVP_DecryptFinal_ex(ctx, (unsigned char*)out_buff + decrypt_len, &final_len) <= 0) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the GCM segment failed in verifying the tag\n");
+        ret = OVSA_CRYPTO_TAG_VALIDATION_FAILED;
+        goto end;
+    }
+
+end:
+    if (ret < OVSA_OK) {
+        /* Plain text of a segment failing the tag check is never handed out */
+        OPENSSL_cleanse(out_buff, length);
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
 
-    if (benc != NULL) {
-        decrypt_bio = BIO_push(benc, decrypt_bio);
+ovsa_status_t ovsa_crypto_decrypt_gcm_mem_stream(int sym_key_slot, const char* in_buff,
+                                                 size_t in_buff_len,
+                                                 ovsa_crypto_write_cb_t write_cb, void* write_ctx,
+                                                 size_t* out_buff_len, int* keyiv_hmac_slot) {
+    ovsa_status_t ret = OVSA_OK;
+    char* plain_buff  = NULL;
+    size_t plain_len  = 0;
+    size_t offset     = 0;
+    size_t length     = 0;
+
+    plain_len = ovsa_crypto_get_gcm_plain_text_len(in_buff, in_buff_len);
+    if ((ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) || (plain_len == 0) ||
+        (write_cb == NULL) || (out_buff_len == NULL) || (keyiv_hmac_slot == NULL)) {
+        BIO_printf(
+            g_bio_err,
+            "LibOVSA: Error decrypting the GCM memory stream failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
     }
 
-    buff = ovsa_crypto_app_malloc(EVP_ENCODE_LENGTH(BUFSIZE), "evp decrypt_mem buffer");
-    if (buff == NULL) {
+    ret = ovsa_crypto_derive_raw_keyiv_hmac(sym_key_slot, in_buff, in_buff_len, keyiv_hmac_slot);
+    if (ret < OVSA_OK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in allocating memory for "
-                   "evp decrypt buffer\n");
+                   "LibOVSA: Error decrypting the GCM memory stream failed in deriving the "
+                   "key/IV/HMAC\n");
+        goto end;
+    }
+
+    plain_buff = ovsa_crypto_app_malloc(ENCRYPT_GCM_SEGMENT_SIZE, "evp decrypt_mem gcm buffer");
+    if (plain_buff == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the GCM memory stream failed in allocating memory "
+                   "for the segment buffer\n");
         ret = OVSA_MEMORY_ALLOC_FAIL;
         goto end;
     }
 
-    while (BIO_pending(read_bio) || !BIO_eof(read_bio)) {
-        read_len = BIO_read(read_bio, (char*)buff, BUFSIZE);
-        if (read_len <= 0) {
-            break;
+    /* The callback only gets the plain text of segments which passed the tag check */
+    *out_buff_len = 0;
+    for (offset = 0; offset < plain_len; offset += length) {
+        length = plain_len - offset;
+        if (length > ENCRYPT_GCM_SEGMENT_SIZE) {
+            length = ENCRYPT_GCM_SEGMENT_SIZE;
         }
-        if (BIO_write(decrypt_bio, (char*)buff, read_len) != read_len) {
-            BIO_printf(
-                g_bio_err,
-                "LibOVSA: Error decrypting the memory buffer failed in writing to decrypt BIO\n");
-            ret = OVSA_CRYPTO_BIO_ERROR;
+        ret = ovsa_crypto_decrypt_gcm_range(*keyiv_hmac_slot, in_buff, in_buff_len, offset,
+                                            length, plain_buff);
+        if (ret < OVSA_OK) {
             goto end;
         }
+        ret = write_cb(write_ctx, plain_buff, length);
+        if (ret < OVSA_OK) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error decrypting the GCM memory stream failed in writing the "
+                       "plain text\n");
+            goto end;
+        }
+        *out_buff_len += length;
     }
 
-    if (!BIO_flush(decrypt_bio)) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in flushing the decrypt BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+end:
+    if (plain_buff != NULL) {
+        OPENSSL_cleanse(plain_buff, ENCRYPT_GCM_SEGMENT_SIZE);
+    }
+    ovsa_crypto_openssl_free(&plain_buff);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_compute_gcm_tags_hash(const char* in_buff, size_t in_buff_len,
+                                                unsigned char* out_buff) {
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_len = 0;
+    ovsa_status_t ret     = OVSA_OK;
+    EVP_MD_CTX* md_ctx    = NULL;
+    size_t plain_len      = 0;
+    size_t offset         = 0;
+    size_t length         = 0;
+
+    plain_len = ovsa_crypto_get_gcm_plain_text_len(in_buff, in_buff_len);
+    if ((plain_len == 0) || (out_buff == NULL)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the GCM tags hash failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    if ((md_ctx = EVP_MD_CTX_new()) == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the GCM tags hash failed in getting the digest "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    BIO_get_mem_ptr(decrypt_bio, &decrypt_ptr);
-    if (decrypt_ptr == NULL) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed to extract the decrypt BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
+    /* Tags authenticate the segments, only the magic/salt and the tags are read */
+    if (!EVP_DigestInit_ex(md_ctx, EVP_sha512(), NULL) ||
+        !EVP_DigestUpdate(md_ctx, in_buff, ENCRYPT_HEADER_LEN)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the GCM tags hash failed in the digest\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto end;
+    }
+    for (offset = 0; offset < plain_len; offset += length) {
+        length = plain_len - offset;
+        if (length > ENCRYPT_GCM_SEGMENT_SIZE) {
+            length = ENCRYPT_GCM_SEGMENT_SIZE;
+        }
+        if (!EVP_DigestUpdate(md_ctx,
+                              in_buff + ovsa_crypto_get_gcm_encrypt_pos(offset + length) -
+                                  ENCRYPT_GCM_TAG_LEN,
+                              ENCRYPT_GCM_TAG_LEN)) {
+            BIO_printf(g_bio_err,
+                       "LibOVSA: Error computing the GCM tags hash failed in the digest\n");
+            ret = OVSA_CRYPTO_EVP_ERROR;
+            goto end;
+        }
+    }
+    if (!EVP_DigestFinal_ex(md_ctx, hash, &hash_len)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the GCM tags hash failed in the digest\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    /* App needs to free this memory */
-    *out_buff = ovsa_crypto_app_malloc(decrypt_ptr->length + NULL_TERMINATOR, "decrypted buffer");
-    if (*out_buff == NULL) {
+    /* Same base64 format as ovsa_crypto_compute_buff_hash() */
+    memset_s(out_buff, HASH_SIZE, 0);
+    EVP_EncodeBlock(out_buff, hash, hash_len);
+
+end:
+    EVP_MD_CTX_free(md_ctx);
+    if (ret < OVSA_OK) {
+        ERR_print_errors(g_bio_err);
+    }
+    return ret;
+}
+
+ovsa_status_t ovsa_crypto_compute_content_hash(int sym_key_slot, const char* in_buff,
+                                               size_t in_buff_len, unsigned char* out_buff) {
+    /* Keeps the content hash apart from any other HMAC computed with the model key */
+    static const char label[] = "OVSA model file content";
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    ovsa_sym_key_t* sym_key = ovsa_crypto_get_symmetric_key(sym_key_slot);
+    ovsa_status_t ret       = OVSA_OK;
+    EVP_MD_CTX* md_ctx      = NULL;
+    EVP_PKEY* pkey          = NULL;
+    size_t secret_len       = 0;
+    size_t hash_len         = sizeof(hash);
+
+    if ((sym_key == NULL) || (in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error decrypting the memory buffer failed in allocating memory for "
-                   "decrypted buffer\n");
-        ret = OVSA_MEMORY_ALLOC_FAIL;
+                   "LibOVSA: Error computing the content hash failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    secret_len = strnlen_s(sym_key->sym_key, MAX_EKEY_SIZE);
+    if (secret_len == EOK) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the content hash failed in getting the size of "
+                   "secret\n");
+        return OVSA_CRYPTO_GENERIC_ERROR;
+    }
+
+    pkey = EVP_PKEY_new_mac_key(EVP_PKEY_HMAC, NULL, (const unsigned char*)sym_key->sym_key,
+                                (int)secret_len);
+    if (pkey == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the content hash failed in loading the hmac key\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
-    *out_buff_len = decrypt_ptr->length;
-    if (memcpy_s(*out_buff, decrypt_ptr->length, decrypt_ptr->data, decrypt_ptr->length) != EOK) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error decrypting the memory buffer failed in getting the output buffer\n");
-        ret = OVSA_MEMIO_ERROR;
+    if ((md_ctx = EVP_MD_CTX_new()) == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error computing the content hash failed in getting the digest "
+                   "context\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
         goto end;
     }
 
+    if ((EVP_DigestSignInit(md_ctx, NULL, EVP_sha512(), NULL, pkey) != 1) ||
+        (EVP_DigestSignUpdate(md_ctx, label, sizeof(label)) != 1) ||
+        (EVP_DigestSignUpdate(md_ctx, in_buff, in_buff_len) != 1) ||
+        (EVP_DigestSignFinal(md_ctx, hash, &hash_len) != 1)) {
+        BIO_printf(g_bio_err, "LibOVSA: Error computing the content hash failed in the hmac\n");
+        ret = OVSA_CRYPTO_EVP_ERROR;
+        goto end;
+    }
+
+    /* Same base64 format as ovsa_crypto_compute_buff_hash() */
+    memset_s(out_buff, HASH_SIZE, 0);
+    EVP_EncodeBlock(out_buff, hash, (int)hash_len);
+
 end:
-    OPENSSL_cleanse(tmpkeyiv_hmac, MAX_KEYIV_HMAC_LENGTH);
-    OPENSSL_cleanse(key, EVP_MAX_KEY_LENGTH);
-    OPENSSL_cleanse(iv, EVP_MAX_IV_LENGTH);
-    OPENSSL_cleanse(salt, sizeof(salt));
-    ovsa_crypto_openssl_free((char**)&buff);
-    BIO_free_all(keyiv_hmac_read_bio);
-    BIO_free(keyiv_hmac_b64);
-    BIO_free(b64);
-    BIO_free_all(read_mem);
-    BIO_free(benc);
-    BIO_free_all(write_bio);
+    OPENSSL_cleanse(hash, sizeof(hash));
+    EVP_MD_CTX_free(md_ctx);
+    EVP_PKEY_free(pkey);
     if (ret < OVSA_OK) {
         ERR_print_errors(g_bio_err);
     }
     return ret;
 }
 
+/* Destination of ovsa_crypto_decrypt_mem(), the plain text is written at the offset */
+typedef struct ovsa_decrypt_mem_buff {
+    char* buff;
+    size_t buff_len;
+    size_t offset;
+} ovsa_decrypt_mem_buff_t;
+
+static ovsa_status_t ovsa_crypto_write_decrypt_mem_buff(void* write_ctx, const char* buff,
+                                                        size_t buff_len) {
+    ovsa_decrypt_mem_buff_t* mem_buff = (ovsa_decrypt_mem_buff_t*)write_ctx;
+
+    if (memcpy_s(mem_buff->buff + mem_buff->offset, mem_buff->buff_len - mem_buff->offset, buff,
+                 buff_len) != EOK) {
+        return OVSA_MEMIO_ERROR;
+    }
+    mem_buff->offset += buff_len;
+    return OVSA_OK;
+}
+
+size_t ovsa_crypto_get_raw_decrypt_mem_len(size_t in_buff_len) {
+    static const char magic[] = "Salted__";
+    size_t header_len         = sizeof(magic) - 1 + PKCS5_SALT_LEN;
+
+    /* CTR mode, the plain text is as long as the cipher text following magic and salt */
+    return (in_buff_len > header_len) ? in_buff_len - header_len : 0;
+}
+
+size_t ovsa_crypto_get_decrypt_mem_len(size_t in_buff_len) {
+    return ovsa_crypto_get_raw_decrypt_mem_len((in_buff_len + 3) / 4 * 3);
+}
+
+ovsa_status_t ovsa_crypto_decrypt_mem(int sym_key_slot, const char* in_buff, size_t in_buff_len,
+                                      char** out_buff, size_t* out_buff_len, int* keyiv_hmac_slot) {
+    ovsa_status_t ret = OVSA_OK;
+    size_t plain_len  = 0;
+    ovsa_decrypt_mem_buff_t mem_buff;
+
+    if ((out_buff == NULL) || (out_buff_len == NULL)) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the memory buffer failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
+    }
+
+    /* App needs to free this memory */
+    mem_buff.buff_len = ovsa_crypto_get_decrypt_mem_len(in_buff_len);
+    mem_buff.offset   = 0;
+    mem_buff.buff =
+        ovsa_crypto_app_malloc(mem_buff.buff_len + NULL_TERMINATOR, "decrypted buffer");
+    if (mem_buff.buff == NULL) {
+        BIO_printf(g_bio_err,
+                   "LibOVSA: Error decrypting the memory buffer failed in allocating memory for "
+                   "decrypted buffer\n");
+        return OVSA_MEMORY_ALLOC_FAIL;
+    }
+
+    /* Unwrapped base64, as ovsa_crypto_encrypt_mem() writes it, is decrypted in one range */
+    plain_len = ovsa_crypto_get_plain_text_len(in_buff, in_buff_len, true);
+    if ((plain_len != 0) && (keyiv_hmac_slot != NULL) &&
+        (memchr(in_buff, '\n', in_buff_len) == NULL)) {
+        ret = ovsa_crypto_derive_keyiv_hmac(sym_key_slot, in_buff, in_buff_len, keyiv_hmac_slot);
+        if (ret == OVSA_OK) {
+            ret = ovsa_crypto_decrypt_mem_range(*keyiv_hmac_slot, in_buff, in_buff_len, true, 0,
+                                                plain_len, mem_buff.buff);
+            *out_buff_len = plain_len;
+        }
+    } else {
+        ret = ovsa_crypto_decrypt_mem_stream(sym_key_slot, in_buff, in_buff_len,
+                                             ovsa_crypto_write_decrypt_mem_buff, &mem_buff,
+                                             out_buff_len, keyiv_hmac_slot);
+    }
+    if (ret < OVSA_OK) {
+        OPENSSL_cleanse(mem_buff.buff, mem_buff.buff_len);
+        ovsa_crypto_openssl_free(&mem_buff.buff);
+        return ret;
+    }
+    *out_buff = mem_buff.buff;
+    return ret;
+}
+
 #ifndef ENABLE_SGX_GRAMINE
 ovsa_status_t ovsa_crypto_derive_unsealing_key(char* magic_salt_buff, int* sym_key_slot) {
     ovsa_status_t ret         = OVSA_OK;
@@ -1427,7 +2184,7 @@ ovsa_status_t ovsa_crypto_encrypt_keystore(int sym_key_slot, const char* enc_key
 
     if (
 #ifndef ENABLE_SGX_GRAMINE
-        (sym_key_slot < MIN_KEY_SLOT) || (sym_key_slot >= MAX_KEY_SLOT) ||
+        (ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) ||
         (magic_salt_buff == NULL) ||
 #endif
         (enc_keystore_name == NULL) || (in_buff == NULL) || (in_buff_len == 0)) {
@@ -1567,7 +2324,7 @@ ovsa_status_t ovsa_crypto_decrypt_keystore(int sym_key_slot, const char* in_buff
     size_t magic_salt_buff_len = 0, encrypted_buff_len = 0;
     ovsa_enc_keystore_t enc_keystore;
 
-    if ((sym_key_slot < MIN_KEY_SLOT) || (sym_key_slot >= MAX_KEY_SLOT) || (in_buff == NULL) ||
+    if ((ovsa_crypto_get_symmetric_key(sym_key_slot) == NULL) || (in_buff == NULL) ||
         (in_buff_len == 0) || (magic_salt_buff == NULL) || (out_buff == NULL) ||
         (out_buff_len == NULL)) {
         BIO_printf(g_bio_err, "LibOVSA: Error decrypting keystore failed with invalid parameter\n");
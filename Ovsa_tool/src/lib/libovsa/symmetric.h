@@ -18,9 +18,8 @@
 #ifndef __OVSA_SYMMETRIC_H_
 #define __OVSA_SYMMETRIC_H_
 
-extern ovsa_isv_keystore_t g_key_store[MAX_KEY_SLOT];
-extern pthread_mutex_t g_symmetric_index_lock;
-extern char g_sym_key[MAX_KEY_SLOT][MAX_EKEY_SIZE];
+#include "keyslot.h"
+
 extern BIO* g_bio_err;
 
 #define PBKDF2_ITERATION_COUNT 10000
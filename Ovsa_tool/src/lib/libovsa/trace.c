@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#include "trace.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_EVENT_SIZE 512
+
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+static int g_trace_fd              = -1;
+static pid_t g_trace_pid;
+
+static __thread pid_t g_trace_tid;
+static __thread char g_trace_id[OVSA_TRACE_ID_SIZE + 1];
+
+static uint64_t ovsa_trace_now_us(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
+}
+
+/*
+ * Opens the trace file for appending. The runtime and the License Service on one host may share
+ * it, every event is a single write and the timestamps of both are on the same monotonic clock.
+ * The opening bracket of the JSON array is written by whoever creates the file, the closing one
+ * may be left out in the Chrome trace event format.
+ */
+static void ovsa_trace_open(void) {
+    const char* path = getenv(OVSA_TRACE_FILE_ENV);
+    struct stat st;
+
+    if ((path == NULL) || (path[0] == '\0'))
+        return;
+    g_trace_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (g_trace_fd < 0)
+        return;
+    if ((fstat(g_trace_fd, &st) == 0) && (st.st_size == 0)) {
+        if (write(g_trace_fd, "[\n", 2) != 2) {
+            close(g_trace_fd);
+            g_trace_fd = -1;
+            return;
+        }
+    }
+    g_trace_pid = getpid();
+}
+
+void ovsa_trace_begin(ovsa_trace_span_t* span, const char* name) {
+    span->name     = name;
+    span->start_us = ovsa_trace_now_us();
+}
+
+void ovsa_trace_end(const ovsa_trace_span_t* span) {
+    uint64_t end_us = ovsa_trace_now_us();
+    char event[TRACE_EVENT_SIZE];
+    int len = 0;
+
+    pthread_once(&g_trace_once, ovsa_trace_open);
+    if (g_trace_fd < 0)
+        return;
+    if (g_trace_tid == 0)
+        g_trace_tid = (pid_t)syscall(SYS_gettid);
+
+    len = snprintf(event, sizeof(event),
+                   "{\"name\":\"%s\",\"cat\":\"ovsa\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,"
+                   "\"pid\":%d,\"tid\":%d,\"args\":{\"cid\":\"%s\"}},\n",
+                   span->name, (unsigned long)span->start_us,
+                   (unsigned long)(end_us - span->start_us), (int)g_trace_pid, (int)g_trace_tid,
+                   g_trace_id);
+    if ((len > 0) && (len < (int)sizeof(event))) {
+        /* A lost event is not worth failing or retrying the traced operation */
+        if (write(g_trace_fd, event, len) != len)
+            return;
+    }
+}
+
+void ovsa_trace_new_correlation_id(void) {
+    uint64_t id = 0;
+
+    /* The ID only joins the spans of one check, the clock is a fallback good enough for it */
+    if (getrandom(&id, sizeof(id), GRND_NONBLOCK) != sizeof(id)) {
+        id = ovsa_trace_now_us() ^ ((uint64_t)syscall(SYS_gettid) << 40);
+        id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        id = (id ^ (id >> 27)) * 0x94d049bb133111ebULL;
+        id = id ^ (id >> 31);
+    }
+    snprintf(g_trace_id, sizeof(g_trace_id), "%016lx", (unsigned long)id);
+}
+
+void ovsa_trace_set_correlation_id(const char* id, size_t len) {
+    size_t index = 0;
+
+    g_trace_id[0] = '\0';
+    if ((id == NULL) || (len != OVSA_TRACE_ID_SIZE))
+        return;
+    /* The ID is written into the JSON of the events as is */
+    for (index = 0; index < len; index++) {
+        if (!(((id[index] >= '0') && (id[index] <= '9')) ||
+              ((id[index] >= 'a') && (id[index] <= 'f'))))
+            return;
+    }
+    memcpy(g_trace_id, id, len);
+    g_trace_id[len] = '\0';
+}
+
+const char* ovsa_trace_get_correlation_id(void) {
+    return g_trace_id;
+}
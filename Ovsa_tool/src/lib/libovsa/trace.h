@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * Copyright 2020-2022 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *****************************************************************************
+ */
+
+#ifndef __OVSA_TRACE_H_
+#define __OVSA_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Tracing spans shared by the runtime and the License Service. It has no dependency on the rest
+ * of libovsa. Spans are written in the Chrome trace event format, one complete event per line,
+ * to the file named by OVSA_TRACE_FILE_ENV. The spans are compiled out unless the callers are
+ * built with ENABLE_TRACE.
+ */
+#define OVSA_TRACE_FILE_ENV "OVSA_TRACE_FILE"
+/* Hex digits of the correlation ID carried from the runtime to the License Service */
+#define OVSA_TRACE_ID_SIZE 16
+
+typedef struct ovsa_trace_span {
+    const char* name;
+    uint64_t start_us;
+} ovsa_trace_span_t;
+
+/** \brief This function starts a span on the monotonic clock.
+ *
+ * \param[out] span  Span to be started.
+ * \param[in]  name  Name of the span, a string literal.
+ */
+void ovsa_trace_begin(ovsa_trace_span_t* span, const char* name);
+
+/** \brief This function writes a span with the correlation ID of the calling thread. Nothing is
+ *         written when OVSA_TRACE_FILE_ENV is not set.
+ *
+ * \param[in]  span  Span started with ovsa_trace_begin().
+ */
+void ovsa_trace_end(const ovsa_trace_span_t* span);
+
+/** \brief This function sets a new random correlation ID for the spans of the calling thread.
+ */
+void ovsa_trace_new_correlation_id(void);
+
+/** \brief This function sets the correlation ID for the spans of the calling thread. An ID that
+ *         is not made of OVSA_TRACE_ID_SIZE hex digits clears it.
+ *
+ * \param[in]  id   Correlation ID, not null terminated.
+ * \param[in]  len  Length of the correlation ID.
+ */
+void ovsa_trace_set_correlation_id(const char* id, size_t len);
+
+/** \brief This function returns the correlation ID of the calling thread.
+ *
+ * \return Correlation ID of OVSA_TRACE_ID_SIZE hex digits, an empty string when there is none
+ */
+const char* ovsa_trace_get_correlation_id(void);
+
+#ifdef ENABLE_TRACE
+#define OVSA_TRACE_SPAN(span)                ovsa_trace_span_t span
+#define OVSA_TRACE_BEGIN(span, name)         ovsa_trace_begin(&(span), name)
+#define OVSA_TRACE_END(span)                 ovsa_trace_end(&(span))
+#define OVSA_TRACE_NEW_CORRELATION_ID()      ovsa_trace_new_correlation_id()
+#define OVSA_TRACE_SET_CORRELATION_ID(id, n) ovsa_trace_set_correlation_id(id, n)
+#else
+#define OVSA_TRACE_SPAN(span)
+#define OVSA_TRACE_BEGIN(span, name) \
+    do {                             \
+    } while (0)
+#define OVSA_TRACE_END(span) \
+    do {                     \
+    } while (0)
+#define OVSA_TRACE_NEW_CORRELATION_ID() \
+    do {                                \
+    } while (0)
+#define OVSA_TRACE_SET_CORRELATION_ID(id, n) \
+    do {                                     \
+    } while (0)
+#endif
+
+#endif /* __OVSA_TRACE_H_ */
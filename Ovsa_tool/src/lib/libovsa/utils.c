@@ -23,16 +23,21 @@
 #include <pthread.h>
 #include <string.h>
 
+#include "base64.h"
+#include "keyslot.h"
+
 BIO* g_bio_err = NULL;
 
+/* Serializes the updates of the certificates of the asymmetric key slots */
 pthread_mutex_t g_asymmetric_index_lock;
-pthread_mutex_t g_symmetric_index_lock;
 
-ovsa_isv_keystore_t g_key_store[MAX_KEY_SLOT];
-char g_sym_key[MAX_KEY_SLOT][MAX_EKEY_SIZE];
+/* Cipher context of each thread, reused by the encryption and decryption of buffers */
+pthread_key_t g_cipher_ctx_key;
 
 static unsigned int ovsa_crypto_initialised = 0;
 
+static void ovsa_crypto_free_cipher_ctx(void* ctx);
+
 static int ovsa_crypto_do_sign_init(EVP_MD_CTX* ctx, EVP_PKEY* pkey, const EVP_MD* md);
 
 static int ovsa_crypto_do_X509_REQ_sign(X509_REQ* req, EVP_PKEY* pkey, const EVP_MD* md);
@@ -137,9 +142,6 @@ ovsa_status_t ovsa_crypto_init(void) {
         return ret;
     }
 
-    memset_s(&g_key_store, sizeof(ovsa_isv_keystore_t) * MAX_KEY_SLOT, 0);
-    memset_s(g_sym_key, sizeof(g_sym_key), 0);
-
     g_bio_err = BIO_new_fp(stdout, BIO_NOCLOSE);
     if (g_bio_err == NULL) {
         OVSA_DBG(DBG_E, "LibOVSA: Error crypto initialization failed in creating a file BIO\n");
@@ -154,10 +156,10 @@ ovsa_status_t ovsa_crypto_init(void) {
         return OVSA_MUTEX_INIT_FAIL;
     }
 
-    if (pthread_mutex_init(&g_symmetric_index_lock, NULL) != 0) {
+    if (pthread_key_create(&g_cipher_ctx_key, ovsa_crypto_free_cipher_ctx) != 0) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error crypto initialization failed in intializing mutex for "
-                   "symmetric index with error code = %s\n",
+                   "LibOVSA: Error crypto initialization failed in creating the key for the "
+                   "cipher contexts with error code = %s\n",
                    strerror(errno));
         return OVSA_MUTEX_INIT_FAIL;
     }
@@ -169,27 +171,14 @@ ovsa_status_t ovsa_crypto_init(void) {
 
 ovsa_status_t ovsa_crypto_deinit(void) {
     ovsa_status_t ret = OVSA_OK;
-    size_t cert_len   = 0;
-    int index         = 0;
-
-    for (index = 0; index < MAX_KEY_SLOT; index++) {
-        if (g_key_store[index].isv_certificate != NULL) {
-            ret = ovsa_get_string_length(g_key_store[index].isv_certificate, &cert_len);
-            if (ret < OVSA_OK) {
-                BIO_printf(g_bio_err,
-                           "LibOVSA: Error crypto deinitialization failed in getting the size of "
-                           "the certificate\n");
-                goto end;
-            }
-            if (cert_len != 0) {
-                ovsa_crypto_openssl_free(&g_key_store[index].isv_certificate);
-            }
-        }
-    }
 
     /* Clear all the keys in asymmetric and symmetric key slots */
-    memset_s(&g_key_store, sizeof(ovsa_isv_keystore_t) * MAX_KEY_SLOT, 0);
-    memset_s(g_sym_key, sizeof(g_sym_key), 0);
+    ovsa_crypto_free_key_slots();
+
+    /* The destructor only runs for the threads exiting, free the context of this one */
+    ovsa_crypto_free_cipher_ctx(pthread_getspecific(g_cipher_ctx_key));
+    pthread_setspecific(g_cipher_ctx_key, NULL);
+    pthread_key_delete(g_cipher_ctx_key);
 
     if (pthread_mutex_destroy(&g_asymmetric_index_lock) != 0) {
         BIO_printf(g_bio_err,
@@ -200,15 +189,6 @@ ovsa_status_t ovsa_crypto_deinit(void) {
         goto end;
     }
 
-    if (pthread_mutex_destroy(&g_symmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error crypto deinitialization failed in destroying the mutex for "
-                   "symmetric index with error code = %s\n",
-                   strerror(errno));
-        ret = OVSA_MUTEX_DESTROY_FAIL;
-        goto end;
-    }
-
     ovsa_crypto_initialised = 0;
 
 end:
@@ -216,70 +196,31 @@ end:
     return ret;
 }
 
-void ovsa_crypto_clear_asymmetric_key_slot(int asym_key_slot) {
-    size_t cert_len = 0;
-    int index       = 0;
+static void ovsa_crypto_free_cipher_ctx(void* ctx) {
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
+}
 
-    if (pthread_mutex_lock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error clearing asymmetric key slot failed in acquiring the mutex with "
-                   "error code = %s\n",
-                   strerror(errno));
-        return;
-    }
+EVP_CIPHER_CTX* ovsa_crypto_get_thread_cipher_ctx(void) {
+    EVP_CIPHER_CTX* ctx = (EVP_CIPHER_CTX*)pthread_getspecific(g_cipher_ctx_key);
 
-    if ((asym_key_slot >= MIN_KEY_SLOT) && (asym_key_slot < (MAX_KEY_SLOT - 1))) {
-        /* Clear primary & secondary certificate from the keystore array */
-        for (index = asym_key_slot; index <= asym_key_slot + 1; index++) {
-            if (g_key_store[index].isv_certificate != NULL) {
-                ovsa_get_string_length(g_key_store[index].isv_certificate, &cert_len);
-                if (cert_len != 0) {
-                    ovsa_crypto_openssl_free(&g_key_store[index].isv_certificate);
-                }
-            }
+    if (ctx == NULL) {
+        ctx = EVP_CIPHER_CTX_new();
+        if ((ctx != NULL) && (pthread_setspecific(g_cipher_ctx_key, ctx) != 0)) {
+            EVP_CIPHER_CTX_free(ctx);
+            ctx = NULL;
         }
-
-        /* Clear primary key from the asymmetric key slot */
-        memset_s(&g_key_store[asym_key_slot], sizeof(ovsa_isv_keystore_t), 0);
-
-        /* Clear secondary key from the asymmetric key slot */
-        memset_s(&g_key_store[asym_key_slot + 1], sizeof(ovsa_isv_keystore_t), 0);
-    }
-
-    if (pthread_mutex_unlock(&g_asymmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error clearing asymmetric key slot failed in releasing the mutex with "
-                   "error code = %s\n",
-                   strerror(errno));
-        return;
     }
+    return ctx;
+}
 
-    return;
+void ovsa_crypto_clear_asymmetric_key_slot(int asym_key_slot) {
+    /* Clear primary & secondary key and certificate from the asymmetric key slot */
+    ovsa_crypto_release_asymmetric_key_slot(asym_key_slot);
 }
 
 void ovsa_crypto_clear_symmetric_key_slot(int sym_key_slot) {
-    if (pthread_mutex_lock(&g_symmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error clearing symmetric key slot failed in acquiring the mutex with "
-                   "error code = %s\n",
-                   strerror(errno));
-        return;
-    }
-
-    if ((sym_key_slot >= MIN_KEY_SLOT) && (sym_key_slot < MAX_KEY_SLOT)) {
-        /* Clears the specified symmetric key from the symmetric key slot */
-        memset_s(&g_sym_key[sym_key_slot], sizeof(g_sym_key[sym_key_slot]), 0);
-    }
-
-    if (pthread_mutex_unlock(&g_symmetric_index_lock) != 0) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error clearing symmetric key slot failed in releasing the mutex with "
-                   "error code = %s\n",
-                   strerror(errno));
-        return;
-    }
-
-    return;
+    /* Clears the specified symmetric key from the symmetric key slot */
+    ovsa_crypto_release_symmetric_key_slot(sym_key_slot);
 }
 
 ovsa_status_t ovsa_crypto_do_sign_verify_hash(unsigned char* buf, BIO* inp, const EVP_PKEY* key,
@@ -1162,97 +1103,75 @@ end:
     return ret;
 }
 
-ovsa_status_t ovsa_crypto_convert_bin_to_base64(const char* in_buff, size_t in_buff_len,
-                                                char** out_buff) {
-    ovsa_status_t ret      = OVSA_OK;
-    BIO* pem_bio           = NULL;
-    BIO* write_bio         = NULL;
-    BIO* b64               = NULL;
-    BUF_MEM* pem_write_ptr = NULL;
+ovsa_status_t ovsa_crypto_compute_buff_hash(const char* in_buff, size_t in_buff_len,
+                                            int hash_alg, unsigned char* out_buff,
+                                            bool b64_format) {
+    const EVP_MD* md      = NULL;
+    unsigned int hash_len = 0;
+    unsigned char hash[EVP_MAX_MD_SIZE];
 
     if ((in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed with invalid parameter\n");
+                   "LibOVSA: Error computing buffer hash failed with invalid parameter\n");
         return OVSA_INVALID_PARAMETER;
     }
 
-    if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed in getting the b64 encode "
-                   "method\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+    /* Default HASH Algorithm is SHA512, unless requested for SHA256 */
+    if (hash_alg == HASH_ALG_SHA256) {
+        md = EVP_sha256();
+    } else if (hash_alg == HASH_ALG_SHA384) {
+        md = EVP_sha384();
+    } else {
+        md = EVP_sha512();
     }
 
-    pem_bio = BIO_new(BIO_s_mem());
-    if (pem_bio == NULL) {
-        BIO_printf(
-            g_bio_err,
-            "LibOVSA: Error converting bin to base64 failed in getting new BIO for the pem\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+    /* One shot digest, the buffer may be binary and is not read through a BIO */
+    if (!EVP_Digest(in_buff, in_buff_len, hash, &hash_len, md, NULL)) {
+        BIO_printf(g_bio_err, "LibOVSA: Error computing buffer hash failed in the digest\n");
+        ERR_print_errors(g_bio_err);
+        return OVSA_CRYPTO_EVP_ERROR;
     }
 
-    write_bio = pem_bio;
-    write_bio = BIO_push(b64, write_bio);
-
-    if (!BIO_write(write_bio, in_buff, in_buff_len)) {
+    memset_s(out_buff, HASH_SIZE, 0);
+    if (b64_format == true) {
+        EVP_EncodeBlock(out_buff, hash, hash_len);
+    } else if (memcpy_s(out_buff, HASH_SIZE, hash, hash_len) != EOK) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed in writing to pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+                   "LibOVSA: Error computing buffer hash failed in getting the output buffer\n");
+        return OVSA_MEMIO_ERROR;
     }
+    return OVSA_OK;
+}
 
-    if (!BIO_flush(write_bio)) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed in flushing the pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
+ovsa_status_t ovsa_crypto_convert_bin_to_base64(const char* in_buff, size_t in_buff_len,
+                                                char** out_buff) {
+    size_t pem_len = 0;
 
-    BIO_get_mem_ptr(write_bio, &pem_write_ptr);
-    if (pem_write_ptr == NULL) {
+    if ((in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL)) {
         BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed to extract the pem BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+                   "LibOVSA: Error converting bin to base64 failed with invalid parameter\n");
+        return OVSA_INVALID_PARAMETER;
     }
 
+    /* Wrapped every 64 characters, the same output as the base64 BIO */
+    pem_len = ovsa_base64_encode_len(in_buff_len, true);
+
     /* App needs to free this memory */
-    *out_buff = ovsa_crypto_app_malloc(pem_write_ptr->length + NULL_TERMINATOR, "pem buffer");
+    *out_buff = ovsa_crypto_app_malloc(pem_len + NULL_TERMINATOR, "pem buffer");
     if (*out_buff == NULL) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error converting bin to base64 failed in allocating memory for "
                    "pem buffer\n");
-        ret = OVSA_MEMORY_ALLOC_FAIL;
-        goto end;
-    }
-
-    if (memcpy_s(*out_buff, pem_write_ptr->length, pem_write_ptr->data, pem_write_ptr->length) !=
-        EOK) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting bin to base64 failed in getting the output buffer\n");
-        ovsa_crypto_openssl_free(out_buff);
-        ret = OVSA_MEMIO_ERROR;
-        goto end;
+        return OVSA_MEMORY_ALLOC_FAIL;
     }
 
-end:
-    BIO_free(b64);
-    BIO_free_all(pem_bio);
-    if (ret < OVSA_OK) {
-        ERR_print_errors(g_bio_err);
-    }
-    return ret;
+    ovsa_base64_encode((const unsigned char*)in_buff, in_buff_len, true, *out_buff);
+    return OVSA_OK;
 }
 
 ovsa_status_t ovsa_crypto_convert_base64_to_bin(const char* in_buff, size_t in_buff_len,
                                                 char* out_buff, size_t* out_buff_len) {
-    ovsa_status_t ret = OVSA_OK;
-    BIO* bin_bio      = NULL;
-    BIO* write_bio    = NULL;
-    BIO* b64          = NULL;
-    size_t bin_len    = 0;
+    size_t bin_len = 0;
 
     if ((in_buff == NULL) || (in_buff_len == 0) || (out_buff == NULL) || (out_buff_len == NULL)) {
         BIO_printf(g_bio_err,
@@ -1260,41 +1179,16 @@ ovsa_status_t ovsa_crypto_convert_base64_to_bin(const char* in_buff, size_t in_b
         return OVSA_INVALID_PARAMETER;
     }
 
-    if ((b64 = BIO_new(BIO_f_base64())) == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting base64 to bin failed in getting the b64 encode "
-                   "method\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    bin_bio = BIO_new_mem_buf(in_buff, in_buff_len);
-    if (bin_bio == NULL) {
-        BIO_printf(g_bio_err,
-                   "LibOVSA: Error converting base64 to bin failed in writing to bin BIO\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
-    }
-
-    write_bio = bin_bio;
-    write_bio = BIO_push(b64, write_bio);
-    bin_len   = BIO_read(write_bio, out_buff, in_buff_len);
-    if (bin_len <= 0) {
+    /* The output never exceeds in_buff_len, the size callers have always provided */
+    if ((ovsa_base64_decode(in_buff, in_buff_len, (unsigned char*)out_buff, &bin_len) != 0) ||
+        (bin_len == 0)) {
         BIO_printf(g_bio_err,
                    "LibOVSA: Error converting base64 to bin failed in reading the bin\n");
-        ret = OVSA_CRYPTO_BIO_ERROR;
-        goto end;
+        return OVSA_CRYPTO_BIO_ERROR;
     }
 
     *out_buff_len = bin_len;
-
-end:
-    BIO_free(b64);
-    BIO_free_all(bin_bio);
-    if (ret < OVSA_OK) {
-        ERR_print_errors(g_bio_err);
-    }
-    return ret;
+    return OVSA_OK;
 }
 
 ovsa_status_t ovsa_crypto_extract_cert_date(const char* cert, char* issue_date, char* expiry_date) {
@@ -19,6 +19,7 @@
 #define __OVSA_UTILS_H_
 
 #include <openssl/bio.h>
+#include <openssl/evp.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -55,6 +56,14 @@ union {
     uint8_t __rnd[16];
 } uuid;
 
+/** \brief This function returns the cipher context of the calling thread, created on first use
+ *         and freed when the thread exits. The context must not be freed by the caller, nor be
+ *         used across a call that may use it in turn.
+ *
+ * \return Cipher context or NULL on failure
+ */
+EVP_CIPHER_CTX* ovsa_crypto_get_thread_cipher_ctx(void);
+
 /** \brief This function generates CSR file based on the contents specified in subject and stores
  *              as on-disk file.
  *
@@ -59,15 +59,6 @@ echo "Changing ownership to OVSA group/user..."
 chown -R ovsa /opt/ovsa 2>&1 | sed 's/^/    /'
 chown -R ovsa /var/OVSA 2>&1 | sed 's/^/    /'
 
-echo "Creating /opt/ovsa/tmp_dir directory..."
-mkdir -vp /opt/ovsa/tmp_dir 2>&1 | sed 's/^/    /'
-echo "Remove stale files inside /opt/ovsa/tmp_dir directory..."
-rm -rf /opt/ovsa/tmp_dir/*
-
-echo "Changing ownership to OVSA user with RD/WR & execution permission"
-chown ovsa:ovsa /opt/ovsa/tmp_dir 2>&1 | sed 's/^/    /'
-chmod 700 /opt/ovsa/tmp_dir 2>&1 | sed 's/^/    /'
-
 echo
 echo "Installing OVSA License Server completed."
 echo